@@ -90,13 +90,18 @@ bool app_update(bool* const quit_now, const uint64_t current_time) {
 		return false;
 	}
 
+	nanotime_step_stats step_stats;
+	prog_app_step_stats_get(&step_stats);
+
 	if (!reset_average) {
 		if (!render_printf("font.fnt", 1u, 8.0f, 8.0f, "\
 			Ticks: %" PRIu64 "\n\n\
 			Current tick duration: %" PRIu64 " ns\n\n\
 			Average tick duration: %" PRIu64 " ns\n\n\
 			Current render frame duration: %" PRIu64 " ns\n\n\
+			App tick jitter: mean %" PRIu64 " ns, max %" PRIu64 " ns, %" PRIu64 " skipped\n\n\
 			Total dynamic memory in use: %.04f MiB\n\n\
+			Scratch memory high water: %.04f KiB\n\n\
 			Total physical memory available: %.04f MiB\n\n\
 			Test text:\n%s",
 
@@ -104,7 +109,11 @@ bool app_update(bool* const quit_now, const uint64_t current_time) {
 			current_tick_duration,
 			average_duration / average_ticks,
 			prog_render_frame_duration_get(),
+			step_stats.jitter_mean,
+			step_stats.jitter_max,
+			step_stats.skips,
 			mem_total() / (double)BYTES_PER_MEBIBYTE,
+			mem_scratch_high_water() / 1024.0,
 			mem_left() / (double)BYTES_PER_MEBIBYTE,
 			text
 		)) {
@@ -120,14 +129,20 @@ bool app_update(bool* const quit_now, const uint64_t current_time) {
 			Current tick duration: %" PRIu64 " ns\n\n\
 			Average tick duration: N/A\n\n\
 			Current render frame duration: %" PRIu64 " ns\n\n\
+			App tick jitter: mean %" PRIu64 " ns, max %" PRIu64 " ns, %" PRIu64 " skipped\n\n\
 			Total dynamic memory in use: %.04f MiB\n\n\
+			Scratch memory high water: %.04f KiB\n\n\
 			Total physical memory available: %.04f MiB\n\n\
 			Test text:\n%s",
 			
 			ticks,
 			current_tick_duration,
 			prog_render_frame_duration_get(),
+			step_stats.jitter_mean,
+			step_stats.jitter_max,
+			step_stats.skips,
 			mem_total() / (double)BYTES_PER_MEBIBYTE,
+			mem_scratch_high_water() / 1024.0,
 			mem_left() / (double)BYTES_PER_MEBIBYTE,
 			text
 		)) {
@@ -23,14 +23,100 @@
  * SOFTWARE.
  */
 
+#include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
+/*
+ * The audio functions don't call into the mixer themselves, they enqueue
+ * commands run by the audio thread, so they never wait on the mixer. Functions
+ * returning bool return whether their command was enqueued, so failures in the
+ * mixer itself are only logged.
+ */
+
+/*
+ * Sounds play on a fixed pool of voices, allocated when audio is initialized,
+ * so playing sounds never reallocates the mixer's channels.
+ */
+#define AUDIO_VOICES 32
+
 void audio_master_volume_set(const float volume);
 
+/*
+ * Play a sound at the default priority of zero, without an instance limit.
+ */
 bool audio_sound_play(const char* const sound_filename, const float volume);
 
+/*
+ * Play a sound on a free voice. When every voice is busy, the oldest playing
+ * sound of the lowest priority not above this sound's priority is stolen; if
+ * every playing sound has a higher priority, the sound isn't played. When
+ * max_instances is nonzero and that many instances of the sound are already
+ * playing, the oldest instance is stolen instead.
+ */
+bool audio_sound_play_priority(const char* const sound_filename, const float volume, const int priority, const size_t max_instances);
+
+/*
+ * Same as audio_sound_play_priority, but the sound starts playing delay
+ * nanoseconds after the call, for scheduling sounds relative to each other
+ * more precisely than the update rate. The sound is stolen or dropped when it
+ * starts, not when it's scheduled.
+ */
+bool audio_sound_play_delayed(const char* const sound_filename, const float volume, const int priority, const size_t max_instances, const uint64_t delay);
+
 void audio_sound_all_stop();
 
+typedef struct audio_voice_stats {
+	/*
+	 * The number of voices currently playing sounds, out of AUDIO_VOICES.
+	 */
+	size_t voices_used;
+
+	/*
+	 * The most voices that have played sounds at once.
+	 */
+	size_t voices_peak;
+
+	/*
+	 * The number of sounds played, the number of playing sounds stolen for
+	 * newer sounds, and the number of sounds not played, as every voice was
+	 * playing a sound of higher priority.
+	 */
+	uint64_t played;
+	uint64_t stolen;
+	uint64_t dropped;
+} audio_voice_stats;
+
+void audio_voice_stats_get(audio_voice_stats* const stats);
+
+typedef struct audio_mixer_stats {
+	/*
+	 * The device's output format, as opened from the audio config.
+	 */
+	int frequency;
+	int channels;
+	int buffer_samples;
+	bool float_mix;
+
+	/*
+	 * The number of buffers mixed, and the number that were mixed too late
+	 * to keep the device fed.
+	 */
+	uint64_t callbacks;
+	uint64_t underruns;
+
+	/*
+	 * The peak mixer load since the stats were last gotten, as a fraction of
+	 * a buffer's duration.
+	 */
+	float load_peak;
+} audio_mixer_stats;
+
+/*
+ * Get the mixer's stats, resetting the peak load.
+ */
+void audio_mixer_stats_get(audio_mixer_stats* const stats);
+
 void audio_music_volume_set(const float volume);
 
 bool audio_music_play(const char* const music_filename);
@@ -1,9 +1,18 @@
 #include "audio/private/audio_private.h"
 #include "main/prog.h"
+#include "main/private/prog_private.h"
 #include "data/data.h"
+#include "data/data_shared.h"
 #include "util/log.h"
+#include "util/mem.h"
+#include "util/nanotime.h"
+#include "util/ini.h"
+#include "util/private/simd.h"
+#include "util/private/threads.h"
 #include "SDL_thread.h"
 #include "SDL_atomic.h"
+#include <stdio.h>
+#include <string.h>
 #include <limits.h>
 #include <assert.h>
 
@@ -14,8 +23,96 @@ static SDL_threadID inited_thread;
 
 static data_cache_object* data_cache = NULL;
 static bool opened_audio = false;
-static int num_active_channels;
-static int num_alloc_channels;
+static SDL_Thread* open_thread = NULL;
+
+/*
+ * Calls into the mixer take the audio device's lock, which is held while the
+ * device's thread mixes, so rather than calling into the mixer directly, the
+ * audio API enqueues commands onto a ring, run by the audio thread. The inited
+ * thread is the only producer and the audio thread the only consumer, so
+ * enqueueing only needs the ring's indices to be atomic, and never waits.
+ */
+#define AUDIO_COMMANDS 256
+
+typedef enum audio_command_type {
+	AUDIO_COMMAND_QUIT,
+	AUDIO_COMMAND_MASTER_VOLUME,
+	AUDIO_COMMAND_SOUND_PLAY,
+	AUDIO_COMMAND_SOUND_ALL_STOP,
+	AUDIO_COMMAND_MUSIC_VOLUME,
+	AUDIO_COMMAND_MUSIC_PLAY,
+	AUDIO_COMMAND_MUSIC_STOP
+} audio_command_type;
+
+typedef struct audio_command {
+	audio_command_type type;
+
+	/*
+	 * The nanotime_now time the command was enqueued at, and how long after
+	 * that to run the command.
+	 */
+	uint64_t time;
+	uint64_t delay;
+
+	union {
+		float volume;
+
+		struct {
+			Mix_Chunk* chunk;
+			float volume;
+			int priority;
+			size_t max_instances;
+		} sound;
+
+		Mix_Music* music;
+	};
+} audio_command;
+
+static audio_command commands[AUDIO_COMMANDS];
+static SDL_atomic_t commands_head;
+static SDL_atomic_t commands_tail;
+static SDL_sem* commands_sem = NULL;
+static SDL_Thread* audio_thread = NULL;
+
+/*
+ * Delayed commands dequeued before they were due, only used in the audio
+ * thread.
+ */
+static audio_command pending[AUDIO_COMMANDS];
+static size_t num_pending;
+
+/*
+ * Each voice is one of the mixer's channels. Whether a voice is playing is
+ * cleared by the mixer's channel finished callback, which runs in the audio
+ * device's thread, so it's atomic; everything else about the voices is only
+ * used in the audio thread.
+ */
+typedef struct audio_voice {
+	SDL_atomic_t playing;
+	const Mix_Chunk* chunk;
+	int priority;
+
+	/*
+	 * The order the voice started playing in, for stealing the oldest sound.
+	 */
+	uint64_t sequence;
+} audio_voice;
+
+static audio_voice voices[AUDIO_VOICES];
+static uint64_t voice_sequence;
+static audio_voice_stats voice_stats;
+
+/*
+ * The audio thread publishes a copy of the stats here after running commands.
+ */
+static SDL_SpinLock voice_stats_lock = 0;
+static audio_voice_stats voice_stats_published;
+
+static void SDLCALL voice_finished(int channel) {
+	if (channel >= 0 && channel < AUDIO_VOICES) {
+		SDL_AtomicSet(&voices[channel].playing, 0);
+	}
+}
 
 #ifdef NDEBUG
 #define assert_inited_thread() ((void)0)
@@ -27,11 +124,213 @@ static void assert_inited_thread() {
 }
 #endif
 
-bool audio_init() {
-	log_printf("Initializing audio\n");
+/*
+ * The output configuration, read from the [audio] section of the audio config
+ * file, falling back to these defaults for missing keys:
+ *
+ * [audio]
+ * frequency = 48000
+ * format = s16
+ * channels = 2
+ * buffer_samples = 2048
+ * float_mix = 0
+ *
+ * The format is s16 or f32. The buffer size is in sample frames; smaller
+ * buffers lower latency, at the risk of underruns. When float_mix is nonzero,
+ * the device is opened with f32 samples, so sounds are converted to floats
+ * once when they're loaded and mixed without clipping between channels, and
+ * the master volume is applied in the post-mix callback, ramped across each
+ * buffer and clamped there instead.
+ */
+#define AUDIO_CONFIG_FILENAME "audio.ini"
+
+typedef struct audio_config {
+	int frequency;
+	Uint16 format;
+	int channels;
+	int buffer_samples;
+	bool float_mix;
+} audio_config;
+
+static audio_config config = {
+	.frequency = 48000,
+	.format = AUDIO_S16SYS,
+	.channels = 2,
+	.buffer_samples = 2048,
+	.float_mix = false
+};
+
+static void config_load() {
+	data_shared_object* const shared = prog_data_shared_get();
+	data_load_status status;
+	data_shared_entry* const entry = data_shared_acquire(shared, DATA_TYPE_RAW, DATA_PATH_SAVE_THEN_RESOURCE, AUDIO_CONFIG_FILENAME, &status);
+	if (entry == NULL) {
+		return;
+	}
+	const data_object* const data = data_shared_data_get(entry);
+
+	ini_view_object* const ini = ini_view_create((const char*)data->raw->bytes, data->raw->size);
+	if (ini == NULL) {
+		data_shared_release(shared, entry);
+		log_printf("Error parsing audio config file \"%s\", using the default audio config\n", AUDIO_CONFIG_FILENAME);
+		return;
+	}
+
+	int value;
+	if (ini_view_getf(ini, ini_view_resolve(ini, "audio", "frequency"), "%d", &value) == 1 && value > 0) {
+		config.frequency = value;
+	}
+	if (ini_view_getf(ini, ini_view_resolve(ini, "audio", "channels"), "%d", &value) == 1 && value > 0) {
+		config.channels = value;
+	}
+	if (ini_view_getf(ini, ini_view_resolve(ini, "audio", "buffer_samples"), "%d", &value) == 1 && value > 0) {
+		config.buffer_samples = value;
+	}
+	if (ini_view_getf(ini, ini_view_resolve(ini, "audio", "float_mix"), "%d", &value) == 1) {
+		config.float_mix = value != 0;
+	}
+	const ini_string format = ini_view_get(ini, ini_view_resolve(ini, "audio", "format"));
+	if (format.text != NULL) {
+		if (format.length == 3u && memcmp(format.text, "s16", 3u) == 0) {
+			config.format = AUDIO_S16SYS;
+		}
+		else if (format.length == 3u && memcmp(format.text, "f32", 3u) == 0) {
+			config.format = AUDIO_F32SYS;
+		}
+		else {
+			log_printf("Unknown audio format \"%.*s\" in the audio config, using the default format\n", (int)format.length, format.text);
+		}
+	}
+	if (config.float_mix) {
+		config.format = AUDIO_F32SYS;
+	}
+	ini_view_destroy(ini);
+	data_shared_release(shared, entry);
+}
+
+/*
+ * Mixer timing, updated by the post-mix callback in the audio device's thread.
+ * A callback arriving more than half a buffer's duration late counts as an
+ * underrun, as the device was left waiting for samples. Load is the larger of
+ * the time spent in the post-mix callback and the lateness of the callback, in
+ * ten-thousandths of the buffer's duration, the peak since the stats were last
+ * read.
+ */
+static uint64_t buffer_duration;
+static uint64_t last_mix_time;
+static SDL_atomic_t mix_callbacks;
+static SDL_atomic_t mix_underruns;
+static SDL_atomic_t mix_load_peak;
+
+/*
+ * The master volume's gain in the float mixing path, stored as the bits of a
+ * float, set by the audio thread and ramped to by the post-mix callback.
+ */
+static SDL_atomic_t master_gain_bits;
+static float master_gain;
+
+static void master_gain_set(const float gain) {
+	int bits;
+	memcpy(&bits, &gain, sizeof(bits));
+	SDL_AtomicSet(&master_gain_bits, bits);
+}
 
+static float master_gain_get() {
+	const int bits = SDL_AtomicGet(&master_gain_bits);
+	float gain;
+	memcpy(&gain, &bits, sizeof(gain));
+	return gain;
+}
+
+/*
+ * Ramp from the current gain to the target gain across the buffer, clamping
+ * the samples to [-1, 1].
+ */
+static void gain_apply(float* const samples, const size_t num_samples) {
+	const float target = master_gain_get();
+	const float step = num_samples > 0u ? (target - master_gain) / (float)num_samples : 0.0f;
+	float gain = master_gain;
+	size_t i = 0u;
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	const simd_float4 low = simd_splat(-1.0f);
+	const simd_float4 high = simd_splat(1.0f);
+	const simd_float4 steps4 = simd_splat(step * 4.0f);
+	simd_float4 gains = simd_set(gain, gain + step, gain + step * 2.0f, gain + step * 3.0f);
+	for (; i + 4u <= num_samples; i += 4u) {
+		const simd_float4 scaled = simd_mul(simd_load(&samples[i]), gains);
+		simd_store(&samples[i], simd_min(simd_max(scaled, low), high));
+		gains = simd_add(gains, steps4);
+	}
+	gain += step * (float)i;
+#endif
+	for (; i < num_samples; i++) {
+		const float scaled = samples[i] * gain;
+		samples[i] = scaled < -1.0f ? -1.0f : scaled > 1.0f ? 1.0f : scaled;
+		gain += step;
+	}
+	master_gain = target;
+}
+
+static void SDLCALL post_mix(void* const udata, Uint8* const stream, const int len) {
+	(void)udata;
+
+	const uint64_t start = nanotime_now();
+	uint64_t lateness = 0u;
+	if (last_mix_time != 0u) {
+		const uint64_t interval = nanotime_interval(last_mix_time, start, nanotime_now_max());
+		if (interval > buffer_duration) {
+			lateness = interval - buffer_duration;
+			if (lateness > buffer_duration / 2u) {
+				SDL_AtomicAdd(&mix_underruns, 1);
+			}
+		}
+	}
+	last_mix_time = start;
+
+	if (config.float_mix) {
+		gain_apply((float*)stream, (size_t)len / sizeof(float));
+	}
+
+	const uint64_t duration = nanotime_interval(start, nanotime_now(), nanotime_now_max());
+	const uint64_t busy = duration > lateness ? duration : lateness;
+	const uint64_t load = buffer_duration > 0u ? busy * UINT64_C(10000) / buffer_duration : 0u;
+	const int load_value = load > INT_MAX ? INT_MAX : (int)load;
+	int peak;
+	do {
+		peak = SDL_AtomicGet(&mix_load_peak);
+	} while (load_value > peak && !SDL_AtomicCAS(&mix_load_peak, peak, load_value));
+	SDL_AtomicAdd(&mix_callbacks, 1);
+}
+
+static bool audio_open() {
+	return Mix_OpenAudio(config.frequency, config.format, config.channels, config.buffer_samples) >= 0;
+}
+
+/*
+ * SDL's error messages are per thread, so the open thread's error is copied
+ * here for audio_init to log.
+ */
+static char open_error[256] = "";
+
+static int SDLCALL open_thread_func(void* const data) {
+	(void)data;
+
+	mem_tag_set(MEM_TAG_AUDIO);
+
+	if (!audio_open()) {
+		snprintf(open_error, sizeof(open_error), "%s", Mix_GetError());
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Create the data cache and load the config, in whichever of audio_open_start
+ * or audio_init is called first, as the config must be loaded before the
+ * device is opened.
+ */
+static bool audio_setup() {
 	assert(data_cache == NULL);
-	assert(!opened_audio);
 
 #ifndef NDEBUG
 	assert(!SDL_AtomicGet(&inited_thread_set));
@@ -48,13 +347,374 @@ bool audio_init() {
 		return false;
 	}
 
-	opened_audio = Mix_OpenAudio(48000, AUDIO_S16SYS, 2, 2048) >= 0;
-	if (!opened_audio) {
-		log_printf("Error opening audio device: %s\n", Mix_GetError());
+	config_load();
+	return true;
+}
+
+bool audio_open_start() {
+	assert(open_thread == NULL);
+	assert(!opened_audio);
+
+	if (data_cache == NULL && !audio_setup()) {
+		return false;
+	}
+
+	open_thread = SDL_CreateThread(open_thread_func, "audio_open_thread", NULL);
+	return open_thread != NULL;
+}
+
+/*
+ * Wait for the open thread, if it was started. Returns false if the thread
+ * failed to open the device.
+ */
+static bool open_thread_wait() {
+	if (open_thread == NULL) {
+		return true;
+	}
+
+	int status;
+	SDL_WaitThread(open_thread, &status);
+	open_thread = NULL;
+	opened_audio = status == 0;
+	return opened_audio;
+}
+
+/*
+ * Choose the voice to play a sound on, setting stolen if a playing sound must
+ * be stopped for it. Returns a negative value if the sound can't be played.
+ */
+static int voice_choose(const Mix_Chunk* const chunk, const int priority, const size_t max_instances, bool* const stolen) {
+	int free_voice = -1;
+	int oldest_instance = -1;
+	size_t num_instances = 0u;
+	int steal_voice = -1;
+	for (int i = 0; i < AUDIO_VOICES; i++) {
+		if (!SDL_AtomicGet(&voices[i].playing)) {
+			if (free_voice < 0) {
+				free_voice = i;
+			}
+			continue;
+		}
+
+		if (voices[i].chunk == chunk) {
+			num_instances++;
+			if (oldest_instance < 0 || voices[i].sequence < voices[oldest_instance].sequence) {
+				oldest_instance = i;
+			}
+		}
+		if (
+			voices[i].priority <= priority &&
+			(
+				steal_voice < 0 ||
+				voices[i].priority < voices[steal_voice].priority ||
+				(voices[i].priority == voices[steal_voice].priority && voices[i].sequence < voices[steal_voice].sequence)
+			)
+		) {
+			steal_voice = i;
+		}
+	}
+
+	if (max_instances > 0u && num_instances >= max_instances) {
+		*stolen = true;
+		return oldest_instance;
+	}
+	else if (free_voice >= 0) {
+		*stolen = false;
+		return free_voice;
+	}
+	else {
+		*stolen = steal_voice >= 0;
+		return steal_voice;
+	}
+}
+
+static void voice_stats_publish() {
+	size_t used = 0u;
+	for (size_t i = 0u; i < AUDIO_VOICES; i++) {
+		used += !!SDL_AtomicGet(&voices[i].playing);
+	}
+	voice_stats.voices_used = used;
+	if (used > voice_stats.voices_peak) {
+		voice_stats.voices_peak = used;
+	}
+
+	SDL_AtomicLock(&voice_stats_lock);
+	voice_stats_published = voice_stats;
+	SDL_AtomicUnlock(&voice_stats_lock);
+}
+
+static void sound_play(Mix_Chunk* const chunk, const float volume, const int priority, const size_t max_instances) {
+	bool stolen;
+	const int voice = voice_choose(chunk, priority, max_instances, &stolen);
+	if (voice < 0) {
+		voice_stats.dropped++;
+		return;
+	}
+	if (stolen) {
+		// Halting calls the finished callback before returning, so the
+		// callback can't clear the playing flag of the new sound.
+		Mix_HaltChannel(voice);
+		voice_stats.stolen++;
+	}
+
+	// The flag is set before playing, so a sound finishing right away
+	// still clears it.
+	SDL_AtomicSet(&voices[voice].playing, 1);
+	voices[voice].chunk = chunk;
+	voices[voice].priority = priority;
+	voices[voice].sequence = voice_sequence++;
+	Mix_Volume(voice, (int)(volume * MIX_MAX_VOLUME));
+	if (Mix_PlayChannel(voice, chunk, 0) < 0) {
+		SDL_AtomicSet(&voices[voice].playing, 0);
+		voices[voice].chunk = NULL;
+		log_deferred_printf("Error playing sound: %s\n", Mix_GetError());
+		return;
+	}
+	voice_stats.played++;
+}
+
+static void command_run(const audio_command* const command) {
+	switch (command->type) {
+	case AUDIO_COMMAND_MASTER_VOLUME:
+		if (config.float_mix) {
+			master_gain_set(command->volume);
+		}
+		else {
+			Mix_MasterVolume((int)(command->volume * MIX_MAX_VOLUME));
+		}
+		break;
+
+	case AUDIO_COMMAND_SOUND_PLAY:
+		sound_play(command->sound.chunk, command->sound.volume, command->sound.priority, command->sound.max_instances);
+		break;
+
+	case AUDIO_COMMAND_SOUND_ALL_STOP:
+		Mix_HaltChannel(-1);
+		break;
+
+	case AUDIO_COMMAND_MUSIC_VOLUME:
+		Mix_VolumeMusic((int)(command->volume * MIX_MAX_VOLUME));
+		break;
+
+	case AUDIO_COMMAND_MUSIC_PLAY:
+		if (Mix_PlayMusic(command->music, -1) < 0) {
+			log_deferred_printf("Error playing music: %s\n", Mix_GetError());
+		}
+		break;
+
+	case AUDIO_COMMAND_MUSIC_STOP:
+		Mix_HaltMusic();
+		break;
+
+	default:
+		break;
+	}
+}
+
+/*
+ * Returns how long until the command is due, zero if it's due now.
+ */
+static uint64_t command_wait_get(const audio_command* const command, const uint64_t now) {
+	const uint64_t elapsed = nanotime_interval(command->time, now, nanotime_now_max());
+	return elapsed >= command->delay ? 0u : command->delay - elapsed;
+}
+
+static int SDLCALL audio_thread_func(void* const data) {
+	(void)data;
+
+	mem_tag_set(MEM_TAG_AUDIO);
+	threads_current_set(THREADS_CLASS_AUDIO);
+
+	bool quit = false;
+	while (!quit) {
+		uint64_t now = nanotime_now();
+
+		// Commands are run in the order they were enqueued in, other than
+		// delayed commands, which wait in the pending list until they're
+		// due. A quit command drops pending commands.
+		const int tail = SDL_AtomicGet(&commands_tail);
+		const int head = SDL_AtomicGet(&commands_head);
+		SDL_MemoryBarrierAcquire();
+		int i;
+		for (i = tail; i != head && !quit; i = (i + 1) % AUDIO_COMMANDS) {
+			const audio_command* const command = &commands[i];
+			if (command->type == AUDIO_COMMAND_QUIT) {
+				quit = true;
+			}
+			else if (command_wait_get(command, now) > 0u && num_pending < AUDIO_COMMANDS) {
+				pending[num_pending++] = *command;
+			}
+			else {
+				command_run(command);
+			}
+		}
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&commands_tail, i);
+		if (quit) {
+			break;
+		}
+
+		now = nanotime_now();
+		uint64_t wait = UINT64_MAX;
+		for (size_t j = 0u; j < num_pending; ) {
+			const uint64_t command_wait = command_wait_get(&pending[j], now);
+			if (command_wait == 0u) {
+				command_run(&pending[j]);
+				pending[j] = pending[--num_pending];
+			}
+			else {
+				if (command_wait < wait) {
+					wait = command_wait;
+				}
+				j++;
+			}
+		}
+		voice_stats_publish();
+
+		if (wait == UINT64_MAX) {
+			SDL_SemWait(commands_sem);
+		}
+		else {
+			const uint64_t wait_ms = (wait + UINT64_C(999999)) / UINT64_C(1000000);
+			SDL_SemWaitTimeout(commands_sem, wait_ms > UINT32_MAX ? UINT32_MAX : (Uint32)wait_ms);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Claim the next command in the ring, returning NULL if the ring is full. The
+ * command is filled in and then enqueued with command_enqueue.
+ */
+static bool commands_full() {
+	return (SDL_AtomicGet(&commands_head) + 1) % AUDIO_COMMANDS == SDL_AtomicGet(&commands_tail);
+}
+
+static audio_command* command_claim(const audio_command_type type, const uint64_t delay) {
+	const int head = SDL_AtomicGet(&commands_head);
+	if (commands_full()) {
+		log_printf("Error enqueueing an audio command, the command queue is full\n");
+		return NULL;
+	}
+	SDL_MemoryBarrierAcquire();
+
+	audio_command* const command = &commands[head];
+	command->type = type;
+	command->time = nanotime_now();
+	command->delay = delay;
+	return command;
+}
+
+static void command_enqueue() {
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&commands_head, (SDL_AtomicGet(&commands_head) + 1) % AUDIO_COMMANDS);
+	SDL_SemPost(commands_sem);
+}
+
+static bool audio_thread_start() {
+	SDL_AtomicSet(&commands_head, 0);
+	SDL_AtomicSet(&commands_tail, 0);
+	num_pending = 0u;
+
+	commands_sem = SDL_CreateSemaphore(0u);
+	if (commands_sem == NULL) {
+		log_printf("Error creating the audio command semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	audio_thread = SDL_CreateThread(audio_thread_func, "audio_thread", NULL);
+	if (audio_thread == NULL) {
+		log_printf("Error creating the audio thread: %s\n", SDL_GetError());
+		SDL_DestroySemaphore(commands_sem);
+		commands_sem = NULL;
+		return false;
+	}
+	return true;
+}
+
+static void audio_thread_stop() {
+	if (audio_thread == NULL) {
+		return;
+	}
+
+	// The quit command has to get into the ring, so wait for the audio thread
+	// to make room if it's full.
+	while (commands_full()) {
+		SDL_SemPost(commands_sem);
+		nanotime_yield();
+	}
+	command_claim(AUDIO_COMMAND_QUIT, 0u);
+	command_enqueue();
+	SDL_WaitThread(audio_thread, NULL);
+	audio_thread = NULL;
+
+	SDL_DestroySemaphore(commands_sem);
+	commands_sem = NULL;
+}
+
+bool audio_init() {
+	log_printf("Initializing audio\n");
+
+	assert(!opened_audio);
+
+	if (data_cache == NULL && !audio_setup()) {
+		return false;
+	}
+
+	if (open_thread != NULL) {
+		if (!open_thread_wait()) {
+			log_printf("Error opening audio device: %s\n", open_error);
+			return false;
+		}
+	}
+	else {
+		opened_audio = audio_open();
+		if (!opened_audio) {
+			log_printf("Error opening audio device: %s\n", Mix_GetError());
+			return false;
+		}
+	}
+	if (Mix_AllocateChannels(AUDIO_VOICES) != AUDIO_VOICES) {
+		log_printf("Error allocating the audio voices: %s\n", Mix_GetError());
+		return false;
+	}
+	for (size_t i = 0u; i < AUDIO_VOICES; i++) {
+		SDL_AtomicSet(&voices[i].playing, 0);
+		voices[i].chunk = NULL;
+	}
+	voice_sequence = 0u;
+	voice_stats = (audio_voice_stats) { 0 };
+	voice_stats_published = voice_stats;
+	Mix_ChannelFinished(voice_finished);
+
+	int frequency;
+	Uint16 format;
+	int channels;
+	if (Mix_QuerySpec(&frequency, &format, &channels) == 0) {
+		log_printf("Error querying the audio device's format: %s\n", Mix_GetError());
+		return false;
+	}
+	if (config.float_mix && format != AUDIO_F32SYS) {
+		log_printf("The audio device doesn't use float samples, not using float mixing\n");
+		config.float_mix = false;
+	}
+	log_printf("Opened audio device at %d Hz, %d channels, %d sample buffers%s\n", frequency, channels, config.buffer_samples, config.float_mix ? ", float mixing" : "");
+	config.frequency = frequency;
+	config.format = format;
+	config.channels = channels;
+	buffer_duration = (uint64_t)config.buffer_samples * NANOTIME_NSEC_PER_SEC / (uint64_t)frequency;
+	last_mix_time = 0u;
+	SDL_AtomicSet(&mix_callbacks, 0);
+	SDL_AtomicSet(&mix_underruns, 0);
+	SDL_AtomicSet(&mix_load_peak, 0);
+	master_gain = 1.0f;
+	master_gain_set(1.0f);
+	Mix_SetPostMix(post_mix, NULL);
+
+	if (!audio_thread_start()) {
 		return false;
 	}
-	num_active_channels = 0;
-	num_alloc_channels = MIX_CHANNELS;
 
 	log_printf("Successfully initialized audio\n");
 
@@ -62,9 +722,17 @@ bool audio_init() {
 }
 
 void audio_deinit() {
-	assert_inited_thread();
+	if (data_cache != NULL) {
+		assert_inited_thread();
+	}
 
+	// The device might still be opening if the program failed to initialize
+	// before audio_init was called.
+	open_thread_wait();
+	audio_thread_stop();
 	if (opened_audio) {
+		Mix_SetPostMix(NULL, NULL);
+		Mix_ChannelFinished(NULL);
 		Mix_CloseAudio();
 		opened_audio = false;
 	}
@@ -81,32 +749,23 @@ void audio_deinit() {
 }
 
 void audio_master_volume_set(const float volume) {
+	assert_inited_thread();
+	assert(audio_thread != NULL);
 	assert(volume >= 0.0f);
 	assert(volume <= 1.0f);
 
-	Mix_MasterVolume(volume * MIX_MAX_VOLUME);
-}
-
-static bool alloc_channel() {
-	assert(num_active_channels < INT_MAX);
-
-	num_active_channels++;
-	if (num_active_channels > num_alloc_channels) {
-		if (Mix_AllocateChannels(num_active_channels) != num_active_channels) {
-			log_printf("Error allocating an audio channel for playing music: %s\n", Mix_GetError());
-			num_active_channels--;
-			return false;
-		}
-		num_alloc_channels = num_active_channels;
+	audio_command* const command = command_claim(AUDIO_COMMAND_MASTER_VOLUME, 0u);
+	if (command == NULL) {
+		return;
 	}
-
-	return true;
+	command->volume = volume;
+	command_enqueue();
 }
 
-bool audio_sound_play(const char* const sound_filename, const float volume) {
+bool audio_sound_play_delayed(const char* const sound_filename, const float volume, const int priority, const size_t max_instances, const uint64_t delay) {
 	assert_inited_thread();
 	assert(data_cache != NULL);
-	assert(opened_audio);
+	assert(audio_thread != NULL);
 	assert(sound_filename != NULL);
 	assert(volume >= 0.0f);
 	assert(volume <= 1.0f);
@@ -117,34 +776,76 @@ bool audio_sound_play(const char* const sound_filename, const float volume) {
 		return false;
 	}
 
-	if (!alloc_channel()) {
+	audio_command* const command = command_claim(AUDIO_COMMAND_SOUND_PLAY, delay);
+	if (command == NULL) {
 		return false;
 	}
-	Mix_VolumeChunk(sound->sound, (int)(volume * MIX_MAX_VOLUME));
-	return Mix_PlayChannel(-1, sound->sound, 0) >= 0;
+	command->sound.chunk = sound->sound;
+	command->sound.volume = volume;
+	command->sound.priority = priority;
+	command->sound.max_instances = max_instances;
+	command_enqueue();
+	return true;
+}
+
+bool audio_sound_play_priority(const char* const sound_filename, const float volume, const int priority, const size_t max_instances) {
+	return audio_sound_play_delayed(sound_filename, volume, priority, max_instances, 0u);
+}
+
+bool audio_sound_play(const char* const sound_filename, const float volume) {
+	return audio_sound_play_delayed(sound_filename, volume, 0, 0u, 0u);
 }
 
 void audio_sound_all_stop() {
 	assert_inited_thread();
-	assert(opened_audio);
+	assert(audio_thread != NULL);
 
-	Mix_HaltGroup(-1);
-	num_active_channels--;
+	if (command_claim(AUDIO_COMMAND_SOUND_ALL_STOP, 0u) != NULL) {
+		command_enqueue();
+	}
 }
 
-void audio_music_volume_set(const float volume) {
+void audio_voice_stats_get(audio_voice_stats* const stats) {
+	assert_inited_thread();
+	assert(stats != NULL);
+
+	SDL_AtomicLock(&voice_stats_lock);
+	*stats = voice_stats_published;
+	SDL_AtomicUnlock(&voice_stats_lock);
+}
+
+void audio_mixer_stats_get(audio_mixer_stats* const stats) {
 	assert_inited_thread();
 	assert(opened_audio);
+	assert(stats != NULL);
+
+	stats->frequency = config.frequency;
+	stats->channels = config.channels;
+	stats->buffer_samples = config.buffer_samples;
+	stats->float_mix = config.float_mix;
+	stats->callbacks = (uint64_t)SDL_AtomicGet(&mix_callbacks);
+	stats->underruns = (uint64_t)SDL_AtomicGet(&mix_underruns);
+	stats->load_peak = (float)SDL_AtomicSet(&mix_load_peak, 0) / 10000.0f;
+}
+
+void audio_music_volume_set(const float volume) {
+	assert_inited_thread();
+	assert(audio_thread != NULL);
 	assert(volume >= 0.0f);
 	assert(volume <= 1.0f);
 
-	Mix_VolumeMusic((int)(volume * MIX_MAX_VOLUME));
+	audio_command* const command = command_claim(AUDIO_COMMAND_MUSIC_VOLUME, 0u);
+	if (command == NULL) {
+		return;
+	}
+	command->volume = volume;
+	command_enqueue();
 }
 
 bool audio_music_play(const char* const music_filename) {
 	assert_inited_thread();
 	assert(data_cache != NULL);
-	assert(opened_audio);
+	assert(audio_thread != NULL);
 	assert(music_filename != NULL);
 
 	data_load_status status;
@@ -153,16 +854,20 @@ bool audio_music_play(const char* const music_filename) {
 		return false;
 	}
 
-	if (!alloc_channel()) {
+	audio_command* const command = command_claim(AUDIO_COMMAND_MUSIC_PLAY, 0u);
+	if (command == NULL) {
 		return false;
 	}
-	return Mix_PlayMusic(music->music, -1) >= 0;
+	command->music = music->music;
+	command_enqueue();
+	return true;
 }
 
 void audio_music_stop() {
 	assert_inited_thread();
-	assert(opened_audio);
+	assert(audio_thread != NULL);
 
-	Mix_HaltMusic();
-	num_active_channels--;
+	if (command_claim(AUDIO_COMMAND_MUSIC_STOP, 0u) != NULL) {
+		command_enqueue();
+	}
 }
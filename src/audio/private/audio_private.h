@@ -25,6 +25,16 @@
 
 #include "audio/audio.h"
 
+/*
+ * Start opening the audio device in its own thread, as opening it can take
+ * hundreds of milliseconds, so the opening is overlapped with the rest of the
+ * program's initialization. Must be called after Mix_Init, and in the thread
+ * that will call audio_init; audio_init waits for the device to finish opening,
+ * or opens it itself if audio_open_start wasn't called. Returns false if the
+ * thread couldn't be started, in which case audio_init opens the device.
+ */
+bool audio_open_start();
+
 bool audio_init();
 
 void audio_deinit();
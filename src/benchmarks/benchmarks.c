@@ -0,0 +1,177 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * The benchmarks have their own main, so SDL shouldn't replace it.
+ */
+#define SDL_MAIN_HANDLED
+
+#include "benchmarks/benchmarks.h"
+#include "main/private/prog_private.h"
+#include "main/main.h"
+#include "util/nanotime.h"
+#include "util/mem.h"
+#include "util/private/mem_private.h"
+#include "SDL.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+/*
+ * Iteration counts are increased until a run takes at least this long.
+ */
+#define MIN_RUN_DURATION (NANOTIME_NSEC_PER_SEC / 10u)
+
+#define NUM_RUNS 3u
+
+volatile uintptr_t benchmark_sink = 0u;
+
+static const char* filter = NULL;
+static bool first_result = true;
+static SDL_threadID main_thread_id = 0;
+
+/*
+ * The util and print code log through the program's thread and path
+ * functions; the benchmarks have no program around them, so these stand in.
+ */
+SDL_threadID main_thread_id_get() {
+	return main_thread_id;
+}
+
+bool main_thread_is_this_thread() {
+	return SDL_ThreadID() == main_thread_id;
+}
+
+const char* prog_save_path_get() {
+	return "";
+}
+
+const char* const prog_this_thread_name_get() {
+	return NULL;
+}
+
+bool prog_this_thread_name_set(const char* const name) {
+	(void)name;
+	return true;
+}
+
+static uint64_t duration_get(const benchmark_func func, void* const data, const size_t iterations) {
+	const uint64_t start = nanotime_now();
+	func(data, iterations);
+	return nanotime_interval(start, nanotime_now(), nanotime_now_max());
+}
+
+void benchmark_run(const char* const name, const benchmark_func func, void* const data) {
+	benchmark_run_bytes(name, func, data, 0u);
+}
+
+void benchmark_run_bytes(const char* const name, const benchmark_func func, void* const data, const size_t bytes_per_op) {
+	if (filter != NULL && strstr(name, filter) == NULL) {
+		return;
+	}
+
+	// Warm up, then find an iteration count taking at least the minimum run
+	// duration, scaling by the shortfall to get there in few runs.
+	func(data, 1u);
+	size_t iterations = 1u;
+	uint64_t duration = duration_get(func, data, iterations);
+	while (duration < MIN_RUN_DURATION) {
+		size_t scale = duration > 0u ? (size_t)(MIN_RUN_DURATION / duration) + 1u : 100u;
+		if (scale > 100u) {
+			scale = 100u;
+		}
+		else if (scale < 2u) {
+			scale = 2u;
+		}
+		iterations *= scale;
+		duration = duration_get(func, data, iterations);
+	}
+
+	uint64_t best = duration;
+	size_t allocs = 0u;
+	for (size_t i = 0u; i < NUM_RUNS; i++) {
+		const size_t allocs_start = mem_num_allocs();
+		duration = duration_get(func, data, iterations);
+		allocs = mem_num_allocs() - allocs_start;
+		if (duration < best) {
+			best = duration;
+		}
+	}
+
+	printf(
+		"%s\t\t{\"name\": \"%s\", \"iterations\": %zu, \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f",
+		first_result ? "" : ",\n",
+		name,
+		iterations,
+		(double)best / (double)iterations,
+		(double)allocs / (double)iterations
+	);
+	if (bytes_per_op > 0u) {
+		printf(", \"bytes_per_op\": %zu", bytes_per_op);
+	}
+	printf("}");
+	fflush(stdout);
+	first_result = false;
+}
+
+int main(int argc, char** argv) {
+	SDL_SetMainReady();
+	main_thread_id = SDL_ThreadID();
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [name filter]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	else if (argc == 2) {
+		filter = argv[1];
+	}
+
+	if (!mem_init()) {
+		fprintf(stderr, "Failed to initialize memory\n");
+		return EXIT_FAILURE;
+	}
+
+	printf(
+		"{\n"
+		"\t\"mem_debug\": %s,\n"
+		"\t\"benchmarks\": [\n",
+	#ifdef MEM_DEBUG
+		"true"
+	#else
+		"false"
+	#endif
+	);
+
+	util_benchmarks_run();
+	print_benchmarks_run();
+	sprites_benchmarks_run();
+	script_benchmarks_run();
+
+	printf("\n\t]\n}\n");
+
+	mem_scratch_destroy();
+	mem_deinit();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Headless microbenchmark harness. Each benchmark is run with increasing
+ * iteration counts until a run takes long enough to time reliably, then the
+ * fastest of several runs at that count is reported, as nanoseconds and
+ * allocations per iteration. Allocations are only counted when MEM_DEBUG is
+ * defined.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Run iterations of the benchmark's operation.
+ */
+typedef void (* benchmark_func)(void* const data, const size_t iterations);
+
+/*
+ * Run and report the named benchmark, unless it's excluded by the name filter
+ * given on the command line.
+ */
+void benchmark_run(const char* const name, const benchmark_func func, void* const data);
+
+/*
+ * Same as benchmark_run, but also reporting the bytes each iteration writes,
+ * for benchmarks of operations bound by memory bandwidth.
+ */
+void benchmark_run_bytes(const char* const name, const benchmark_func func, void* const data, const size_t bytes_per_op);
+
+/*
+ * Benchmarks fold their results into this, so the work isn't optimized away.
+ */
+extern volatile uintptr_t benchmark_sink;
+
+/*
+ * Create binary BMFont data for benchmarking, with num_chars glyphs starting
+ * at the space character and num_pairs kerning pairs among them. Free the
+ * returned data with mem_free.
+ */
+uint8_t* benchmark_font_data_create(const size_t num_chars, const size_t num_pairs, size_t* const size);
+
+void util_benchmarks_run();
+void print_benchmarks_run();
+void sprites_benchmarks_run();
+void script_benchmarks_run();
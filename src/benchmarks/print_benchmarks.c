@@ -0,0 +1,123 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "benchmarks/benchmarks.h"
+#include "render/private/print.h"
+#include "render/private/layers.h"
+#include "data/data_types.h"
+#include "util/font.h"
+#include "util/mem.h"
+#include <stdio.h>
+
+/*
+ * Layers stand-ins, so text layout is measured without a GL context. The
+ * sprites are only touched enough that their generation can't be skipped.
+ */
+bool layers_sprites_add(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_added, sprite_type* const added_sprites) {
+	benchmark_sink += num_added + (uintptr_t)added_sprites;
+	return true;
+}
+
+bool layers_sprites_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const sprite_type* const referenced_sprites) {
+	benchmark_sink += num_referenced + (uintptr_t)referenced_sprites;
+	return true;
+}
+
+/*
+ * Never dereferenced by the stand-ins.
+ */
+static char dummy_layers;
+
+typedef struct print_data {
+	data_font_object* font;
+	const char* string;
+	print_cache_object* cache;
+} print_data;
+
+static void print_layer_string_func(void* const data, const size_t iterations) {
+	print_data* const print = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		print_layer_string(print->font, (layers_object*)&dummy_layers, 0u, 0.0f, 0.0f, 1.0f, print->string);
+	}
+}
+
+static void print_layer_string_cached_func(void* const data, const size_t iterations) {
+	print_data* const print = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		print_layer_string_cached(print->cache, print->font, (layers_object*)&dummy_layers, 0u, 0.0f, 0.0f, 1.0f, print->string);
+		print_cache_restart(print->cache);
+	}
+}
+
+void print_benchmarks_run() {
+	size_t size;
+	uint8_t* const font_data = benchmark_font_data_create(224u, 512u, &size);
+	if (font_data == NULL) {
+		return;
+	}
+	font_object* const font = font_create(font_data, size);
+	mem_free(font_data);
+	if (font == NULL) {
+		fprintf(stderr, "Error creating a font for benchmarking\n");
+		return;
+	}
+
+	static data_texture_object texture;
+	static data_object texture_data = { .texture = &texture };
+	const data_object* textures[] = { &texture_data };
+	data_font_object data_font = {
+		.font = font,
+		.textures = textures
+	};
+
+	static const char* const strings[][2] = {
+		{ "short", "Score: 123456" },
+		{ "paragraph",
+			"The quick brown fox jumps over the lazy dog.\n"
+			"Pack my box with five dozen liquor jugs.\n"
+			"How vexingly quick daft zebras jump!\n"
+			"Sphinx of black quartz, judge my vow.\n"
+		}
+	};
+	print_cache_object* const cache = print_cache_create(1024u * 1024u);
+	for (size_t i = 0u; i < lengthof(strings); i++) {
+		char name[64];
+		print_data print = {
+			.font = &data_font,
+			.string = strings[i][1],
+			.cache = cache
+		};
+		snprintf(name, sizeof(name), "print_layer_string/%s", strings[i][0]);
+		benchmark_run(name, print_layer_string_func, &print);
+		if (cache != NULL) {
+			snprintf(name, sizeof(name), "print_layer_string_cached/%s", strings[i][0]);
+			benchmark_run(name, print_layer_string_cached_func, &print);
+		}
+	}
+	if (cache != NULL) {
+		print_cache_destroy(cache);
+	}
+
+	font_destroy(font);
+}
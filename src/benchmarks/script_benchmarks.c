@@ -0,0 +1,156 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "benchmarks/benchmarks.h"
+#include "script/private/script_render.h"
+#include "render/render.h"
+#include "util/private/mem_private.h"
+#include "lua/lualib.h"
+#include "lua/lauxlib.h"
+#include <stdio.h>
+
+/*
+ * Render API stand-ins, so only the cost of getting sprites from the app code
+ * to the render API is measured, without a GL context.
+ */
+render_handle render_sheet_handle_get(const char* const sheet_filename) {
+	return (render_handle)1u;
+}
+
+render_handle render_font_handle_get(const char* const font_filename) {
+	return (render_handle)1u;
+}
+
+bool render_sprites_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites) {
+	benchmark_sink += num_added + (uintptr_t)added_sprites[num_added - 1u].dst[0];
+	return true;
+}
+
+bool render_string_handle(const render_handle font, const size_t layer_index, const float x, const float y, const char* const string) {
+	benchmark_sink += (uintptr_t)string;
+	return true;
+}
+
+bool render_clear(const float red, const float green, const float blue, const float alpha) {
+	return true;
+}
+
+bool render_layer_camera_set(const size_t layer_index, const camera_type* const camera) {
+	return true;
+}
+
+#define NUM_SPRITES 1024
+
+/*
+ * Each benchmark moves NUM_SPRITES sprites of a grid, then submits them, as
+ * an app would each frame. "batched" moves sprites in place in a sprite array
+ * and submits the array in one call, "translate" moves them all in one call,
+ * and "per_sprite" submits each sprite with its own render.sprites call, the
+ * pattern the batched bindings are designed to avoid.
+ */
+static const char script[] =
+"local sheet = render.sheet('sheet.png')\n"
+"local sprites = render.sprite_array(1024)\n"
+"local single = render.sprite_array(1)\n"
+"for i = 1, 1024 do\n"
+"	sprites:set(i, 0, 0, 16, 16, (i % 32) * 16, (i // 32) * 16, 16, 16)\n"
+"end\n"
+"single:set(1, 0, 0, 16, 16, 0, 0, 16, 16)\n"
+"function batched(frame)\n"
+"	local offset = frame % 16\n"
+"	for i = 1, 1024 do\n"
+"		sprites:move(i, (i % 32) * 16 + offset, (i // 32) * 16)\n"
+"	end\n"
+"	render.sprites(sheet, 0, sprites)\n"
+"end\n"
+"function translate(frame)\n"
+"	sprites:translate(1, 1024, 1, 0)\n"
+"	render.sprites(sheet, 0, sprites)\n"
+"end\n"
+"function per_sprite(frame)\n"
+"	local offset = frame % 16\n"
+"	for i = 1, 1024 do\n"
+"		single:move(1, (i % 32) * 16 + offset, (i // 32) * 16)\n"
+"		render.sprites(sheet, 0, single)\n"
+"	end\n"
+"end\n";
+
+typedef struct script_data {
+	lua_State* lua_state;
+	const char* function;
+} script_data;
+
+static void script_func(void* const data, const size_t iterations) {
+	const script_data* const script = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		lua_getglobal(script->lua_state, script->function);
+		lua_pushinteger(script->lua_state, (lua_Integer)i);
+		if (lua_pcall(script->lua_state, 1, 0, 0) != LUA_OK) {
+			fprintf(stderr, "Error running benchmark script: %s\n", lua_tostring(script->lua_state, -1));
+			lua_pop(script->lua_state, 1);
+			return;
+		}
+	}
+}
+
+static void native_func(void* const data, const size_t iterations) {
+	sprite_type* const sprites = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		const float offset = (float)(i % 16u);
+		for (size_t j = 0u; j < NUM_SPRITES; j++) {
+			sprites[j].dst[0] = (float)((j + 1u) % 32u * 16u) + offset;
+			sprites[j].dst[1] = (float)((j + 1u) / 32u * 16u);
+		}
+		render_sprites_handle((render_handle)1u, 0u, NUM_SPRITES, sprites);
+	}
+}
+
+void script_benchmarks_run() {
+	static sprite_type sprites[NUM_SPRITES];
+	for (size_t i = 0u; i < NUM_SPRITES; i++) {
+		sprites[i] = (sprite_type){ { 0.0f, 0.0f, 16.0f, 16.0f }, { 0.0f, 0.0f, 16.0f, 16.0f } };
+	}
+	benchmark_run("sprites/native_1024", native_func, sprites);
+
+	lua_State* const lua_state = lua_newstate(mem_lua_alloc, NULL);
+	if (lua_state == NULL) {
+		return;
+	}
+	luaL_openlibs(lua_state);
+	script_render_open(lua_state);
+	if (luaL_loadbufferx(lua_state, script, sizeof(script) - 1u, "=benchmark", "t") != LUA_OK || lua_pcall(lua_state, 0, 0, 0) != LUA_OK) {
+		fprintf(stderr, "Error loading benchmark script: %s\n", lua_tostring(lua_state, -1));
+		lua_close(lua_state);
+		return;
+	}
+
+	script_data script = { .lua_state = lua_state, .function = "batched" };
+	benchmark_run("sprites/script_batched_1024", script_func, &script);
+	script.function = "translate";
+	benchmark_run("sprites/script_translate_1024", script_func, &script);
+	script.function = "per_sprite";
+	benchmark_run("sprites/script_per_sprite_1024", script_func, &script);
+
+	lua_close(lua_state);
+}
@@ -0,0 +1,135 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "benchmarks/benchmarks.h"
+#include "render/private/sprite_pack.h"
+#include "render/render_types.h"
+#include "util/mem.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Sprite instance uploads, each operation writing one instance into a buffer
+ * standing in for the mapped streaming vertex buffer, as sprites_draw does, in
+ * the float format and the packed format, so the bytes and time per instance
+ * of the formats can be compared. Sprites submitted as sprite_type are packed
+ * while being written in the packed format; sprites submitted already packed
+ * are only copied.
+ */
+
+typedef struct sprites_data {
+	size_t num_sprites;
+	sprite_type* sprites;
+	packed_sprite_type* packed_sprites;
+	void* buffer;
+} sprites_data;
+
+static void float_upload_func(void* const data, const size_t iterations) {
+	sprites_data* const sprites = data;
+	sprite_type* const dst = sprites->buffer;
+	for (size_t i = 0u; i < iterations; ) {
+		size_t num = iterations - i;
+		if (num > sprites->num_sprites) {
+			num = sprites->num_sprites;
+		}
+		memcpy(dst, sprites->sprites, num * sizeof(sprite_type));
+		i += num;
+	}
+	benchmark_sink ^= (uintptr_t)dst[0].dst[0];
+}
+
+static void packed_upload_func(void* const data, const size_t iterations) {
+	sprites_data* const sprites = data;
+	packed_sprite_type* const dst = sprites->buffer;
+	for (size_t i = 0u; i < iterations; ) {
+		size_t num = iterations - i;
+		if (num > sprites->num_sprites) {
+			num = sprites->num_sprites;
+		}
+		for (size_t j = 0u; j < num; j++) {
+			sprite_pack(&dst[j], &sprites->sprites[j]);
+		}
+		i += num;
+	}
+	benchmark_sink ^= (uintptr_t)dst[0].dst[0];
+}
+
+static void packed_submitted_upload_func(void* const data, const size_t iterations) {
+	sprites_data* const sprites = data;
+	packed_sprite_type* const dst = sprites->buffer;
+	for (size_t i = 0u; i < iterations; ) {
+		size_t num = iterations - i;
+		if (num > sprites->num_sprites) {
+			num = sprites->num_sprites;
+		}
+		memcpy(dst, sprites->packed_sprites, num * sizeof(packed_sprite_type));
+		i += num;
+	}
+	benchmark_sink ^= (uintptr_t)dst[0].dst[0];
+}
+
+void sprites_benchmarks_run() {
+	// The smaller count fits in cache, the larger doesn't, as a frame's worth
+	// of streamed sprites usually doesn't.
+	static const size_t counts[] = { 1024u, 262144u };
+	for (size_t i = 0u; i < lengthof(counts); i++) {
+		sprites_data sprites = {
+			.num_sprites = counts[i],
+			.sprites = mem_malloc(sizeof(sprite_type) * counts[i]),
+			.packed_sprites = mem_malloc(sizeof(packed_sprite_type) * counts[i]),
+			.buffer = mem_malloc(sizeof(sprite_type) * counts[i])
+		};
+		if (sprites.sprites == NULL || sprites.packed_sprites == NULL || sprites.buffer == NULL) {
+			fprintf(stderr, "Error allocating sprites for benchmarking\n");
+			mem_free(sprites.sprites);
+			mem_free(sprites.packed_sprites);
+			mem_free(sprites.buffer);
+			continue;
+		}
+		for (size_t j = 0u; j < counts[i]; j++) {
+			sprite_type* const sprite = &sprites.sprites[j];
+			sprite->src[0] = (float)(j % 32u * 16u);
+			sprite->src[1] = (float)(j / 32u % 32u * 16u);
+			sprite->src[2] = 16.0f;
+			sprite->src[3] = 16.0f;
+			sprite->dst[0] = (float)(j % 640u) + 0.25f;
+			sprite->dst[1] = (float)(j / 640u % 480u) + 0.5f;
+			sprite->dst[2] = 16.0f;
+			sprite->dst[3] = 16.0f;
+			sprite_pack(&sprites.packed_sprites[j], sprite);
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "sprites_upload_float/%zu", counts[i]);
+		benchmark_run_bytes(name, float_upload_func, &sprites, sizeof(sprite_type));
+		snprintf(name, sizeof(name), "sprites_upload_packed/%zu", counts[i]);
+		benchmark_run_bytes(name, packed_upload_func, &sprites, sizeof(packed_sprite_type));
+		snprintf(name, sizeof(name), "sprites_upload_packed_submitted/%zu", counts[i]);
+		benchmark_run_bytes(name, packed_submitted_upload_func, &sprites, sizeof(packed_sprite_type));
+
+		mem_free(sprites.sprites);
+		mem_free(sprites.packed_sprites);
+		mem_free(sprites.buffer);
+	}
+}
@@ -0,0 +1,697 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "benchmarks/benchmarks.h"
+#include "util/private/conqueue.h"
+#include "util/private/mpmcqueue.h"
+#include "util/private/maths_private.h"
+#include "util/dict.h"
+#include "util/queue.h"
+#include "util/str.h"
+#include "util/ini.h"
+#include "util/font.h"
+#include "util/maths.h"
+#include "util/mem.h"
+#include "SDL_thread.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#define MAX_THREADS 8u
+
+/*
+ * Arbitrary non-NULL value for the queues.
+ */
+static char queue_value;
+
+typedef struct dict_data {
+	dict_object* dict;
+	uint32_t num_keys;
+} dict_data;
+
+static void dict_get_func(void* const data, const size_t iterations) {
+	dict_data* const dict = data;
+	uintptr_t sum = 0u;
+	for (size_t i = 0u; i < iterations; i++) {
+		const uint32_t key = (uint32_t)(i % dict->num_keys);
+		void* value;
+		if (dict_get(dict->dict, &key, sizeof(key), &value, NULL)) {
+			sum += *(const uint32_t*)value;
+		}
+	}
+	benchmark_sink ^= sum;
+}
+
+static void dict_set_func(void* const data, const size_t iterations) {
+	dict_data* const dict = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		const uint32_t key = (uint32_t)(i % dict->num_keys);
+		uint32_t value = (uint32_t)i;
+		dict_set(dict->dict, &key, sizeof(key), &value, sizeof(value), NULL, NULL);
+	}
+}
+
+static void dict_benchmarks_run() {
+	static const uint32_t sizes[] = { 16u, 1024u, 65536u };
+	for (size_t i = 0u; i < lengthof(sizes); i++) {
+		dict_data dict = {
+			.dict = dict_create(sizes[i]),
+			.num_keys = sizes[i]
+		};
+		if (dict.dict == NULL) {
+			fprintf(stderr, "Error creating a dictionary for benchmarking\n");
+			continue;
+		}
+		for (uint32_t key = 0u; key < sizes[i]; key++) {
+			dict_set(dict.dict, &key, sizeof(key), &key, sizeof(key), NULL, NULL);
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "dict_get/%" PRIu32, sizes[i]);
+		benchmark_run(name, dict_get_func, &dict);
+		snprintf(name, sizeof(name), "dict_set/%" PRIu32, sizes[i]);
+		benchmark_run(name, dict_set_func, &dict);
+
+		dict_destroy(dict.dict);
+	}
+}
+
+static void queue_func(void* const data, const size_t iterations) {
+	queue_object* const queue = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		queue_enqueue(queue, &queue_value);
+		benchmark_sink ^= (uintptr_t)queue_dequeue(queue);
+	}
+}
+
+/*
+ * Producer and consumer threads for the concurrent queues. Each thread moves
+ * its count of values through the queue.
+ */
+typedef struct queue_thread_data {
+	void* queue;
+	size_t count;
+} queue_thread_data;
+
+static int SDLCALL conqueue_producer_func(void* const data) {
+	queue_thread_data* const thread = data;
+	for (size_t i = 0u; i < thread->count; i++) {
+		conqueue_enqueue(thread->queue, &queue_value);
+	}
+	return 0;
+}
+
+static int SDLCALL mpmcqueue_producer_func(void* const data) {
+	queue_thread_data* const thread = data;
+	for (size_t i = 0u; i < thread->count; i++) {
+		mpmcqueue_enqueue_wait(thread->queue, &queue_value);
+	}
+	return 0;
+}
+
+static int SDLCALL mpmcqueue_consumer_func(void* const data) {
+	queue_thread_data* const thread = data;
+	for (size_t i = 0u; i < thread->count; i++) {
+		mpmcqueue_dequeue_wait(thread->queue);
+	}
+	return 0;
+}
+
+typedef struct queue_contention_data {
+	size_t num_producers;
+	size_t num_consumers;
+} queue_contention_data;
+
+static void threads_split(queue_thread_data* const threads, void* const queue, const size_t num_threads, const size_t total) {
+	for (size_t i = 0u; i < num_threads; i++) {
+		threads[i].queue = queue;
+		threads[i].count = total / num_threads + (i < total % num_threads);
+	}
+}
+
+/*
+ * The calling thread is the single consumer.
+ */
+static void conqueue_func(void* const data, const size_t iterations) {
+	const queue_contention_data* const contention = data;
+	conqueue_object* const queue = conqueue_create();
+	if (queue == NULL) {
+		return;
+	}
+
+	queue_thread_data producers[MAX_THREADS];
+	SDL_Thread* threads[MAX_THREADS];
+	threads_split(producers, queue, contention->num_producers, iterations);
+	for (size_t i = 0u; i < contention->num_producers; i++) {
+		threads[i] = SDL_CreateThread(conqueue_producer_func, "benchmark_producer", &producers[i]);
+	}
+	for (size_t dequeued = 0u; dequeued < iterations; ) {
+		if (conqueue_dequeue(queue) != NULL) {
+			dequeued++;
+		}
+	}
+	for (size_t i = 0u; i < contention->num_producers; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	conqueue_destroy(queue);
+}
+
+static void mpmcqueue_func(void* const data, const size_t iterations) {
+	const queue_contention_data* const contention = data;
+	mpmcqueue_object* const queue = mpmcqueue_create(1024u);
+	if (queue == NULL) {
+		return;
+	}
+
+	queue_thread_data producers[MAX_THREADS];
+	queue_thread_data consumers[MAX_THREADS];
+	SDL_Thread* threads[MAX_THREADS * 2u];
+	threads_split(producers, queue, contention->num_producers, iterations);
+	threads_split(consumers, queue, contention->num_consumers, iterations);
+	for (size_t i = 0u; i < contention->num_producers; i++) {
+		threads[i] = SDL_CreateThread(mpmcqueue_producer_func, "benchmark_producer", &producers[i]);
+	}
+	for (size_t i = 0u; i < contention->num_consumers; i++) {
+		threads[contention->num_producers + i] = SDL_CreateThread(mpmcqueue_consumer_func, "benchmark_consumer", &consumers[i]);
+	}
+	for (size_t i = 0u; i < contention->num_producers + contention->num_consumers; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+
+	mpmcqueue_destroy(queue);
+}
+
+static void queue_benchmarks_run() {
+	queue_object* const queue = queue_create();
+	if (queue != NULL) {
+		benchmark_run("queue/enqueue_dequeue", queue_func, queue);
+		queue_destroy(queue);
+	}
+
+	static const size_t num_producers[] = { 1u, 2u, 4u };
+	for (size_t i = 0u; i < lengthof(num_producers); i++) {
+		char name[64];
+		queue_contention_data contention = {
+			.num_producers = num_producers[i],
+			.num_consumers = 1u
+		};
+		snprintf(name, sizeof(name), "conqueue/%zup1c", num_producers[i]);
+		benchmark_run(name, conqueue_func, &contention);
+		snprintf(name, sizeof(name), "mpmcqueue/%zup1c", num_producers[i]);
+		benchmark_run(name, mpmcqueue_func, &contention);
+
+		// One producer with as many consumers is the case just run.
+		if (num_producers[i] > 1u) {
+			contention.num_consumers = num_producers[i];
+			snprintf(name, sizeof(name), "mpmcqueue/%zup%zuc", num_producers[i], num_producers[i]);
+			benchmark_run(name, mpmcqueue_func, &contention);
+		}
+	}
+}
+
+typedef struct utf8_data {
+	char* text;
+	size_t size;
+	uint32_t* codepoints;
+} utf8_data;
+
+static void utf8_get_func(void* const data, const size_t iterations) {
+	const utf8_data* const utf8 = data;
+	uint32_t sum = 0u;
+	size_t offset = 0u;
+	for (size_t i = 0u; i < iterations; i++) {
+		size_t bytes;
+		sum += utf8_get(utf8->text + offset, &bytes);
+		offset += bytes;
+		if (offset >= utf8->size) {
+			offset = 0u;
+		}
+	}
+	benchmark_sink ^= sum;
+}
+
+static void utf8_strlen_func(void* const data, const size_t iterations) {
+	const utf8_data* const utf8 = data;
+	size_t sum = 0u;
+	for (size_t i = 0u; i < iterations; i++) {
+		sum += utf8_strlen(utf8->text);
+	}
+	benchmark_sink ^= sum;
+}
+
+static void utf8_decode_func(void* const data, const size_t iterations) {
+	const utf8_data* const utf8 = data;
+	size_t sum = 0u;
+	for (size_t i = 0u; i < iterations; i++) {
+		sum += utf8_decode(utf8->text, utf8->size, utf8->codepoints);
+	}
+	benchmark_sink ^= sum;
+}
+
+static void utf8_valid_func(void* const data, const size_t iterations) {
+	const utf8_data* const utf8 = data;
+	size_t sum = 0u;
+	for (size_t i = 0u; i < iterations; i++) {
+		sum += utf8_valid(utf8->text, utf8->size);
+	}
+	benchmark_sink ^= sum;
+}
+
+static void utf8_benchmarks_run() {
+	// Mostly ASCII, with some of each longer encoding, like typical UI text.
+	static const char* const pieces[] = {
+		"The quick brown fox jumps over the lazy dog. ",
+		"\xC3\xA9\xC3\xA8\xC3\xBC ",
+		"\xE3\x81\x82\xE3\x81\x84\xE3\x81\x86 ",
+		"\xF0\x9F\x98\x80 "
+	};
+	utf8_data utf8 = { .size = 4096u };
+	utf8.text = mem_malloc(utf8.size + 1u);
+	utf8.codepoints = mem_malloc(sizeof(uint32_t) * utf8.size);
+	if (utf8.text == NULL || utf8.codepoints == NULL) {
+		mem_free(utf8.text);
+		mem_free(utf8.codepoints);
+		return;
+	}
+	size_t length = 0u;
+	for (size_t i = 0u; ; i = (i + 1u) % lengthof(pieces)) {
+		const size_t piece_length = strlen(pieces[i]);
+		if (length + piece_length > utf8.size) {
+			break;
+		}
+		memcpy(utf8.text + length, pieces[i], piece_length);
+		length += piece_length;
+	}
+	utf8.text[length] = '\0';
+	utf8.size = length;
+
+	benchmark_run("utf8_get", utf8_get_func, &utf8);
+	benchmark_run("utf8_strlen/4KiB", utf8_strlen_func, &utf8);
+	benchmark_run("utf8_decode/4KiB", utf8_decode_func, &utf8);
+	benchmark_run("utf8_valid/4KiB", utf8_valid_func, &utf8);
+
+	// All ASCII, taking only the SIMD path.
+	memset(utf8.text, 'a', utf8.size);
+	benchmark_run("utf8_decode/4KiB_ascii", utf8_decode_func, &utf8);
+
+	mem_free(utf8.text);
+	mem_free(utf8.codepoints);
+}
+
+typedef int (*format_func)(char* buffer, size_t size, const char* format, va_list args);
+
+static int format_call(const format_func func, char* const buffer, const size_t size, const char* const format, ...) {
+	va_list args;
+	va_start(args, format);
+	const int len = func(buffer, size, format, args);
+	va_end(args);
+	return len;
+}
+
+/*
+ * Typical per-frame HUD text.
+ */
+static void format_hud(const format_func func, const size_t iterations) {
+	char buffer[128];
+	for (size_t i = 0u; i < iterations; i++) {
+		benchmark_sink ^= (uintptr_t)format_call(func, buffer, sizeof(buffer), "FPS: %.2f\nFrame %" PRIu64 "\nScore %08d %s", 59.94 + (double)(i & 7u) * 0.01, (uint64_t)i, (int)i, "READY");
+	}
+}
+
+static void vsnprintf_func(void* const data, const size_t iterations) {
+	(void)data;
+	format_hud(vsnprintf, iterations);
+}
+
+static void str_vsnprintf_func(void* const data, const size_t iterations) {
+	(void)data;
+	format_hud(str_vsnprintf, iterations);
+}
+
+static void format_benchmarks_run() {
+	benchmark_run("vsnprintf/hud", vsnprintf_func, NULL);
+	benchmark_run("str_vsnprintf/hud", str_vsnprintf_func, NULL);
+}
+
+typedef struct text_data {
+	char* text;
+	size_t size;
+} text_data;
+
+static void ini_create_func(void* const data, const size_t iterations) {
+	const text_data* const ini_text = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		ini_object* const ini = ini_create(ini_text->text, ini_text->size);
+		if (ini != NULL) {
+			ini_destroy(ini);
+		}
+		benchmark_sink ^= (uintptr_t)ini;
+	}
+}
+
+static void ini_view_create_func(void* const data, const size_t iterations) {
+	const text_data* const ini_text = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		ini_view_object* const view = ini_view_create(ini_text->text, ini_text->size);
+		if (view != NULL) {
+			ini_view_destroy(view);
+		}
+		benchmark_sink ^= (uintptr_t)view;
+	}
+}
+
+typedef struct ini_get_data {
+	ini_object* ini;
+	ini_view_object* view;
+	ini_handle handle;
+} ini_get_data;
+
+static void ini_get_func(void* const data, const size_t iterations) {
+	const ini_get_data* const get = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		benchmark_sink ^= (uintptr_t)ini_get(get->ini, "section_25", "key_10");
+	}
+}
+
+static void ini_view_get_func(void* const data, const size_t iterations) {
+	const ini_get_data* const get = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		benchmark_sink ^= (uintptr_t)ini_view_get(get->view, get->handle).text;
+	}
+}
+
+static void ini_benchmarks_run() {
+	text_data ini_text = { .size = 0u };
+	const size_t capacity = 64u * 1024u;
+	ini_text.text = mem_malloc(capacity);
+	if (ini_text.text == NULL) {
+		return;
+	}
+	for (size_t section = 0u; section < 50u; section++) {
+		ini_text.size += (size_t)snprintf(ini_text.text + ini_text.size, capacity - ini_text.size, "[section_%zu]\n", section);
+		for (size_t key = 0u; key < 20u; key++) {
+			ini_text.size += (size_t)snprintf(ini_text.text + ini_text.size, capacity - ini_text.size, "key_%zu = value %zu\n", key, section * key);
+		}
+	}
+
+	benchmark_run("ini_create/50x20", ini_create_func, &ini_text);
+	benchmark_run("ini_view_create/50x20", ini_view_create_func, &ini_text);
+
+	ini_get_data get = {
+		.ini = ini_create(ini_text.text, ini_text.size),
+		.view = ini_view_create(ini_text.text, ini_text.size)
+	};
+	if (get.ini != NULL && get.view != NULL) {
+		get.handle = ini_view_resolve(get.view, "section_25", "key_10");
+		benchmark_run("ini_get", ini_get_func, &get);
+		benchmark_run("ini_view_get", ini_view_get_func, &get);
+	}
+	ini_destroy(get.ini);
+	ini_view_destroy(get.view);
+
+	mem_free(ini_text.text);
+}
+
+static void put_uint16(uint8_t* const dst, const uint32_t value) {
+	dst[0] = (uint8_t)value;
+	dst[1] = (uint8_t)(value >> 8);
+}
+
+static void put_uint32(uint8_t* const dst, const uint32_t value) {
+	put_uint16(dst, value);
+	put_uint16(dst + 2, value >> 16);
+}
+
+uint8_t* benchmark_font_data_create(const size_t num_chars, const size_t num_pairs, size_t* const size) {
+	static const char font_name[] = "benchmark";
+	static const char page_name[] = "benchmark.png";
+	const size_t info_size = 14u + sizeof(font_name);
+	const size_t common_size = 15u;
+	const size_t pages_size = sizeof(page_name);
+	const size_t chars_size = 20u * num_chars;
+	const size_t pairs_size = 10u * num_pairs;
+	*size = 4u + 5u * 5u + info_size + common_size + pages_size + chars_size + pairs_size;
+
+	uint8_t* const data = mem_calloc(1u, *size);
+	if (data == NULL) {
+		return NULL;
+	}
+	uint8_t* cur = data;
+	memcpy(cur, "BMF\x03", 4u);
+	cur += 4u;
+
+	*cur = 1u;
+	put_uint32(cur + 1u, (uint32_t)info_size);
+	put_uint16(cur + 5u, 16u);
+	memcpy(cur + 5u + 14u, font_name, sizeof(font_name));
+	cur += 5u + info_size;
+
+	*cur = 2u;
+	put_uint32(cur + 1u, (uint32_t)common_size);
+	put_uint16(cur + 5u, 18u);
+	put_uint16(cur + 7u, 14u);
+	put_uint16(cur + 9u, 256u);
+	put_uint16(cur + 11u, 256u);
+	put_uint16(cur + 13u, 1u);
+	cur += 5u + common_size;
+
+	*cur = 3u;
+	put_uint32(cur + 1u, (uint32_t)pages_size);
+	memcpy(cur + 5u, page_name, sizeof(page_name));
+	cur += 5u + pages_size;
+
+	*cur = 4u;
+	put_uint32(cur + 1u, (uint32_t)chars_size);
+	cur += 5u;
+	for (size_t i = 0u; i < num_chars; i++, cur += 20u) {
+		put_uint32(cur + 0u, (uint32_t)(' ' + i));
+		put_uint16(cur + 4u, (uint32_t)(i % 16u * 16u));
+		put_uint16(cur + 6u, (uint32_t)(i / 16u % 16u * 16u));
+		put_uint16(cur + 8u, 12u);
+		put_uint16(cur + 10u, 16u);
+		put_uint16(cur + 16u, 12u);
+	}
+
+	*cur = 5u;
+	put_uint32(cur + 1u, (uint32_t)pairs_size);
+	cur += 5u;
+	for (size_t i = 0u; i < num_pairs; i++, cur += 10u) {
+		put_uint32(cur + 0u, (uint32_t)(' ' + i % num_chars));
+		put_uint32(cur + 4u, (uint32_t)(' ' + (i * 7u + 1u) % num_chars));
+		put_uint16(cur + 8u, (uint32_t)(uint16_t)-1);
+	}
+
+	return data;
+}
+
+static void font_create_func(void* const data, const size_t iterations) {
+	const text_data* const font_data = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		font_object* const font = font_create(font_data->text, font_data->size);
+		if (font != NULL) {
+			font_destroy(font);
+		}
+		benchmark_sink ^= (uintptr_t)font;
+	}
+}
+
+static void font_benchmarks_run() {
+	text_data font_data;
+	font_data.text = (char*)benchmark_font_data_create(224u, 512u, &font_data.size);
+	if (font_data.text == NULL) {
+		return;
+	}
+
+	benchmark_run("font_create/224", font_create_func, &font_data);
+
+	mem_free(font_data.text);
+}
+
+#define NUM_VECTORS 1024u
+
+typedef struct maths_data {
+	mat4 transform;
+	float* src;
+	float* dst;
+	float* sizes;
+} maths_data;
+
+static void mat4_multiply_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	mat4 result;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_multiply(result, maths->transform, maths->transform);
+	}
+	benchmark_sink ^= (uintptr_t)result[0];
+}
+
+static void mat4_multiply_scalar_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	mat4 result;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_multiply_scalar(result, maths->transform, maths->transform);
+	}
+	benchmark_sink ^= (uintptr_t)result[0];
+}
+
+static void mat4_transform_vec4s_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_transform_vec4s(maths->dst, maths->transform, maths->src, NUM_VECTORS);
+	}
+}
+
+static void mat4_transform_vec4s_scalar_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_transform_vec4s_scalar(maths->dst, maths->transform, maths->src, NUM_VECTORS);
+	}
+}
+
+static void mat4_transform_vec2s_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_transform_vec2s(maths->dst, maths->transform, maths->src, NUM_VECTORS);
+	}
+}
+
+static void mat4_transform_vec2s_scalar_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	for (size_t i = 0u; i < iterations; i++) {
+		mat4_transform_vec2s_scalar(maths->dst, maths->transform, maths->src, NUM_VECTORS);
+	}
+}
+
+static void rects_build_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	const vec2 anchor = { 0.5f, 0.5f };
+	for (size_t i = 0u; i < iterations; i++) {
+		rects_build(maths->dst, 8u, maths->src, maths->sizes, anchor, NUM_VECTORS);
+	}
+}
+
+static void rects_build_scalar_func(void* const data, const size_t iterations) {
+	maths_data* const maths = data;
+	const vec2 anchor = { 0.5f, 0.5f };
+	for (size_t i = 0u; i < iterations; i++) {
+		rects_build_scalar(maths->dst, 8u, maths->src, maths->sizes, anchor, NUM_VECTORS);
+	}
+}
+
+/*
+ * Each SIMD kernel is run alongside its scalar reference implementation, to
+ * show what the SIMD implementation gains on the current target.
+ */
+static void maths_benchmarks_run() {
+	maths_data maths;
+	maths.src = mem_malloc(NUM_VECTORS * 4u * sizeof(float));
+	maths.dst = mem_malloc(NUM_VECTORS * 8u * sizeof(float));
+	maths.sizes = mem_malloc(NUM_VECTORS * 2u * sizeof(float));
+	if (maths.src == NULL || maths.dst == NULL || maths.sizes == NULL) {
+		mem_free(maths.src);
+		mem_free(maths.dst);
+		mem_free(maths.sizes);
+		return;
+	}
+	for (size_t i = 0u; i < NUM_VECTORS * 4u; i++) {
+		maths.src[i] = (float)i * 0.25f;
+	}
+	for (size_t i = 0u; i < NUM_VECTORS * 2u; i++) {
+		maths.sizes[i] = (float)(i % 32u) + 1.0f;
+	}
+	const vec3 axis = { 0.0f, 0.0f, 1.0f };
+	mat4_rotate(maths.transform, 0.5f, axis);
+
+	benchmark_run("mat4_multiply", mat4_multiply_func, &maths);
+	benchmark_run("mat4_multiply_scalar", mat4_multiply_scalar_func, &maths);
+	benchmark_run("mat4_transform_vec4s/1024", mat4_transform_vec4s_func, &maths);
+	benchmark_run("mat4_transform_vec4s_scalar/1024", mat4_transform_vec4s_scalar_func, &maths);
+	benchmark_run("mat4_transform_vec2s/1024", mat4_transform_vec2s_func, &maths);
+	benchmark_run("mat4_transform_vec2s_scalar/1024", mat4_transform_vec2s_scalar_func, &maths);
+	benchmark_run("rects_build/1024", rects_build_func, &maths);
+	benchmark_run("rects_build_scalar/1024", rects_build_scalar_func, &maths);
+	benchmark_sink ^= (uintptr_t)maths.dst[NUM_VECTORS];
+
+	mem_free(maths.src);
+	mem_free(maths.dst);
+	mem_free(maths.sizes);
+}
+
+typedef struct mem_thread_data {
+	size_t count;
+} mem_thread_data;
+
+static int SDLCALL mem_thread_func(void* const data) {
+	const mem_thread_data* const thread = data;
+	for (size_t i = 0u; i < thread->count; i++) {
+		void* const mem = mem_malloc(64u);
+		benchmark_sink ^= (uintptr_t)mem;
+		mem_free(mem);
+	}
+	return 0;
+}
+
+static void mem_malloc_func(void* const data, const size_t iterations) {
+	const size_t num_threads = *(const size_t*)data;
+	mem_thread_data threads_data[MAX_THREADS];
+	SDL_Thread* threads[MAX_THREADS];
+	for (size_t i = 0u; i < num_threads; i++) {
+		threads_data[i].count = iterations / num_threads + (i < iterations % num_threads);
+	}
+
+	if (num_threads == 1u) {
+		mem_thread_func(&threads_data[0]);
+		return;
+	}
+	for (size_t i = 0u; i < num_threads; i++) {
+		threads[i] = SDL_CreateThread(mem_thread_func, "benchmark_mem", &threads_data[i]);
+	}
+	for (size_t i = 0u; i < num_threads; i++) {
+		SDL_WaitThread(threads[i], NULL);
+	}
+}
+
+static void mem_benchmarks_run() {
+	static const size_t num_threads[] = { 1u, 3u };
+	for (size_t i = 0u; i < lengthof(num_threads); i++) {
+		char name[64];
+		snprintf(name, sizeof(name), "mem_malloc_free/64B/%zut", num_threads[i]);
+		benchmark_run(name, mem_malloc_func, (void*)&num_threads[i]);
+	}
+}
+
+void util_benchmarks_run() {
+	dict_benchmarks_run();
+	queue_benchmarks_run();
+	utf8_benchmarks_run();
+	format_benchmarks_run();
+	ini_benchmarks_run();
+	font_benchmarks_run();
+	maths_benchmarks_run();
+	mem_benchmarks_run();
+}
@@ -24,7 +24,10 @@
  */
 
 /*
- * File and data management library. This library is not thread-safe.
+ * File and data management library. This library is not thread-safe; each
+ * cache must only be used in one thread, though asynchronous loads are read
+ * and decoded in jobs, only being finished in the cache's thread. Data loaded
+ * in more than one thread can be shared with data/data_shared.h instead.
  */
 
 #include "data/data_types.h"
@@ -46,6 +49,22 @@
  */
 data_cache_object* data_cache_create(const char* const resource_path, const char* const save_path);
 
+/*
+ * Pack files bundle many files into one, looked up in an index, with files
+ * optionally compressed. Packs are searched for files in the resource path
+ * before the loose files there, most recently mounted first; the save path is
+ * never packed. A pack of DATA_PACK_FILENAME_DEFAULT in the resource path is
+ * mounted by data_cache_create, if it exists. Packs are made with the
+ * directmedia_pack tool.
+ */
+#define DATA_PACK_FILENAME_DEFAULT "resource.pack"
+
+/*
+ * Mount a pack file in the resource path. Packs must be mounted before
+ * anything is loaded from the cache. Returns false upon failure.
+ */
+bool data_cache_pack_mount(data_cache_object* const cache, const char* const filename);
+
 /*
  * Destroy a data cache object.
  */
@@ -59,6 +78,33 @@ void data_cache_destroy(data_cache_object* const cache);
  */
 const data_object* data_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, data_load_status* const status);
 
+/*
+ * Create uncached texture data of an existing GL_TEXTURE_2D texture, as if it
+ * had been loaded from the file in the path, for textures loaded outside of the
+ * data library. The data takes ownership of the texture. Returns NULL upon
+ * failure, in which case the texture remains owned by the caller.
+ */
+const data_object* data_texture_create(data_cache_object* const cache, const data_path path, const char* const filename, const GLuint name, const GLsizei width, const GLsizei height, const size_t gpu_size);
+
+/*
+ * Get the full filename of a file in the resource or save path, suitable for
+ * opening the file outside of the data library, such as in another thread. The
+ * caller must free the returned string. Returns NULL upon failure.
+ */
+char* data_filename_get(data_cache_object* const cache, const data_path path, const char* const filename);
+
+/*
+ * Open a file in the resource or save path for reading, searching the packs
+ * for resources, for reading files outside of the data library, such as in
+ * another thread. Returns NULL upon failure.
+ */
+SDL_RWops* data_file_open(data_cache_object* const cache, const data_path path, const char* const filename);
+
+/*
+ * Returns true if the data is in the cache, without loading it.
+ */
+bool data_cache_contains(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename);
+
 /*
  * Unloads uncached data. Returns true if unloading the data was successful,
  * otherwise false. Cached data can't be unloaded, it must be removed first
@@ -74,6 +120,55 @@ bool data_unload(const data_object* const data);
  */
 const data_object* data_cache_get(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, data_load_status* const status, const bool always_load);
 
+/*
+ * Start getting data from the cache asynchronously, reading and decoding the
+ * file in a job, leaving only finishing the load, such as uploading textures,
+ * to the cache's thread. Already cached data is gotten immediately. Poll the
+ * request with data_request_get, and release it with data_request_release
+ * once done with it. Returns NULL upon failure.
+ */
+data_request_object* data_cache_get_async(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename);
+
+/*
+ * Get the data of the request, finishing its load if it's been read and
+ * decoded. Returns NULL while the load is in flight, with a pending status,
+ * and upon failure, with an error or missing status. The data is looked up
+ * in the cache each get, so only use the returned pointer until the data could
+ * be evicted, as with data_cache_get; data no longer cached is reloaded, the
+ * request being pending again until the reload is done.
+ */
+const data_object* data_request_get(data_request_object* const request, data_load_status* const status);
+
+/*
+ * Release the request; a load still in flight is still finished into the
+ * cache by data_cache_update. Requests must be released before their cache is
+ * destroyed.
+ */
+void data_request_release(data_request_object* const request);
+
+/*
+ * Finish the cache's asynchronous loads that have been read and decoded.
+ * Should be called regularly, such as once per frame, while loads are in
+ * flight.
+ */
+void data_cache_update(data_cache_object* const cache);
+
+/*
+ * Intern the data identifier, returning a handle for getting the data with
+ * data_cache_handle_get without building, hashing and looking up a key each
+ * time. Interning the same identifier again returns the same handle. Handles
+ * are valid until the cache is destroyed, whether or not the data is cached.
+ * Returns DATA_HANDLE_NONE upon failure.
+ */
+data_handle data_cache_intern(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename);
+
+/*
+ * Same as data_cache_get without always_load, but for interned data; while the
+ * data is cached, this is just an array index. If load is false and the data
+ * isn't cached, NULL is returned without loading it, with a missing status.
+ */
+const data_object* data_cache_handle_get(data_cache_object* const cache, const data_handle handle, data_load_status* const status, const bool load);
+
 /*
  * Frees cached data. Returns true if there was no error freeing the data;
  * returns false otherwise. It isn't erroneous to attempt freeing data that
@@ -98,7 +193,9 @@ char* data_directory_get(const data_object* const data);
  * or get out of the save path; you maybe should have always_load of
  * data_cache_get be true for repeatedly modified files, or even only use
  * data_load, like for configuration files. Returns true if saving succeeded,
- * otherwise false.
+ * otherwise false. The file is written in the calling thread; to not hold up
+ * the calling thread, queue the save in a data writer (data/data_writer.h)
+ * instead.
  */
 bool data_save(data_cache_object* const cache, const data_type type, const char* const filename, const void* const bytes, const size_t size, const bool add_to_cache);
 
@@ -125,3 +222,106 @@ bool data_cache_remove(const data_object* const data);
  * common between the contexts to reduce the amount of processing.
  */
 bool data_cache_only(data_cache_object* const cache, const data_id* const ids, const size_t count);
+
+/*
+ * Same as data_cache_only, but without blocking: data not in the list is
+ * ungotten immediately, while the list's data is loaded asynchronously, like
+ * data_cache_get_async. Poll the prefetch's progress with
+ * data_prefetch_progress_get, and destroy it once done with it. Returns NULL
+ * upon failure.
+ */
+data_prefetch_object* data_cache_only_async(data_cache_object* const cache, const data_id* const ids, const size_t count);
+
+/*
+ * Get the progress of the prefetch, finishing its loads that have been read
+ * and decoded. num_done and num_failed, which can be NULL, are set to the
+ * numbers of the list's data done loading, including failures, and failed to
+ * load. Returns true once all the list's data is done loading.
+ */
+bool data_prefetch_progress_get(data_prefetch_object* const prefetch, size_t* const num_done, size_t* const num_failed);
+
+/*
+ * Destroy the prefetch; loads still in flight are still finished into the
+ * cache by data_cache_update.
+ */
+void data_prefetch_destroy(data_prefetch_object* const prefetch);
+
+/*
+ * The number of cached data objects of a type, and the bytes they use.
+ */
+typedef struct data_cache_usage {
+	size_t num_cached;
+	size_t cpu_size;
+	size_t gpu_size;
+} data_cache_usage;
+
+/*
+ * Get the usage of the cache by data of the type.
+ */
+void data_cache_usage_get(data_cache_object* const cache, const data_type type, data_cache_usage* const usage);
+
+/*
+ * Set the budgets of CPU and GPU bytes of cached data of the type; SIZE_MAX is
+ * unlimited, the default. When adding data of the type to the cache exceeds a
+ * budget, the least recently gotten data of the type is evicted until the
+ * usage is within the budgets again. Data gotten or added since the last
+ * data_cache_epoch_advance is never evicted, nor is pinned data, so the usage
+ * can exceed the budgets when everything cached is in use.
+ */
+void data_cache_budget_set(data_cache_object* const cache, const data_type type, const size_t cpu_budget, const size_t gpu_budget);
+
+/*
+ * Start a new epoch of the cache, allowing data gotten in previous epochs to
+ * be evicted. Call this when nothing references data gotten from the cache
+ * anymore, other than pinned data, such as at the start of each frame. Caches
+ * never advancing their epoch never evict anything.
+ */
+void data_cache_epoch_advance(data_cache_object* const cache);
+
+/*
+ * Pin cached data, preventing its eviction until it's unpinned as many times
+ * as it was pinned, for data referenced across epochs. Pinned data can still be
+ * explicitly ungotten.
+ */
+void data_cache_pin(const data_object* const data);
+
+void data_cache_unpin(const data_object* const data);
+
+/*
+ * Set the function called with each cached data object just before it's
+ * destroyed, whether evicted, ungotten, removed, dropped by data_cache_only or
+ * replaced, to release anything referencing the data. Pass NULL to not be
+ * notified.
+ */
+void data_cache_evict_func_set(data_cache_object* const cache, void (* const evict)(void* const evict_data, const data_object* const data), void* const evict_data);
+
+/*
+ * Set the size from which raw data files are memory mapped copy-on-write
+ * rather than read into memory, and the access pattern hinted to the OS for
+ * the mappings. SIZE_MAX disables mapping; the defaults are
+ * DATA_RAW_MAP_SIZE_DEFAULT and DATA_RAW_ADVICE_NORMAL. Files that can't be
+ * mapped are read as usual. Mapped files must not be truncated while their
+ * data is loaded. Loads already in flight might use the previous settings.
+ */
+void data_cache_raw_map_set(data_cache_object* const cache, const size_t map_size, const data_raw_advice advice);
+
+/*
+ * Set whether image textures' decoded texels are cached in the save path's
+ * DATA_TEXTURE_BAKE_DIRECTORY, so later loads of unchanged images skip
+ * decoding them; enabled by default. Cached texels are keyed by the images'
+ * paths, sizes and modification times, so changed images are decoded again.
+ */
+void data_cache_texture_bake_set(data_cache_object* const cache, const bool enabled);
+
+/*
+ * The directory in the save path of cached texels of decoded images.
+ */
+#define DATA_TEXTURE_BAKE_DIRECTORY "texture_cache/"
+
+/*
+ * Decode an image like data_texture_decode, but using its texels cached in
+ * the save path instead if they're up to date, caching the texels of images
+ * decoded. The rwops is only read from if the cached texels can't be
+ * used. Can be called in any thread. Returns NULL upon failure.
+ */
+SDL_Surface* data_texture_decode_cached(data_cache_object* const cache, const data_path path, const char* const filename, SDL_RWops* const rwops);
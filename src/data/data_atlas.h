@@ -0,0 +1,67 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/private/data_type_manager.h"
+#include "util/maths.h"
+#include <stddef.h>
+
+/*
+ * Atlases name the sprites packed into sheets by the directmedia_atlas tool,
+ * so sprites can be referenced by name rather than by sheet and src rectangle.
+ * Atlas files are text: A line of DATA_ATLAS_MAGIC and DATA_ATLAS_VERSION,
+ * then a "sheet FILENAME" line per sheet, the filename being relative to the
+ * atlas's directory, then a "sprite SHEET X Y WIDTH HEIGHT NAME" line per
+ * sprite, SHEET being the index of the sprite's sheet among the sheet lines,
+ * and the name running to the end of the line.
+ */
+#define DATA_ATLAS_MAGIC "directmedia_atlas"
+#define DATA_ATLAS_VERSION 1
+
+typedef struct data_atlas_sprite {
+	char* name;
+	size_t sheet;
+	vec4 src;
+} data_atlas_sprite;
+
+typedef struct data_atlas_object {
+	/*
+	 * The filenames of the sheets, in the same path as the atlas.
+	 */
+	char** sheet_filenames;
+	size_t num_sheets;
+
+	/*
+	 * The sprites, sorted by name.
+	 */
+	data_atlas_sprite* sprites;
+	size_t num_sprites;
+} data_atlas_object;
+
+/*
+ * Get the sprite of the name, or NULL if the atlas has no sprite of the name.
+ */
+const data_atlas_sprite* data_atlas_sprite_get(const data_atlas_object* const atlas, const char* const name);
+
+extern const data_type_manager data_type_manager_atlas;
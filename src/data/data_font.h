@@ -36,3 +36,14 @@ typedef struct data_font_object {
 } data_font_object;
 
 extern const data_type_manager data_type_manager_font;
+
+/*
+ * The range, in texels, of the signed distance fields the pages of
+ * DATA_TYPE_FONT_SDF fonts are converted into; the field spans half the range
+ * inside and outside of the glyphs' edges. Fonts should be generated with
+ * spacing between glyphs of at least half the range, so neighbouring glyphs
+ * don't bleed into each other when printed at large scales.
+ */
+#define DATA_FONT_SDF_RANGE 8.0f
+
+extern const data_type_manager data_type_manager_font_sdf;
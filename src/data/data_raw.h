@@ -24,7 +24,9 @@
  */
 
 #include "data/private/data_type_manager.h"
+#include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 /*
  * Raw data.
@@ -36,12 +38,41 @@ typedef struct data_raw_object {
 	size_t size;
 
 	/*
-	 * The raw data chunk. This sort of declaration results in the
-	 * data field being aligned correctly for both pointers and 128-bit
-	 * scalars, which makes the array correct for virtually all platforms
-	 * and data types.
+	 * The raw data chunk, aligned for both pointers and 128-bit scalars,
+	 * which makes it correct for virtually all platforms and data types.
 	 */
-	_Alignas(16) uint8_t bytes[1];
+	uint8_t* bytes;
+
+	/*
+	 * Whether the chunk is a copy-on-write mapping of the file, rather than
+	 * read into memory. Mapped chunks are paged in from the file as they're
+	 * accessed, and writes to them aren't written back to the file.
+	 */
+	bool mapped;
 } data_raw_object;
 
+/*
+ * Access patterns hinted to the OS for mapped raw data.
+ */
+typedef enum data_raw_advice {
+	DATA_RAW_ADVICE_NORMAL,
+
+	/*
+	 * The data will be accessed sequentially, so pages can be read ahead
+	 * aggressively and dropped soon after they're accessed.
+	 */
+	DATA_RAW_ADVICE_SEQUENTIAL,
+
+	/*
+	 * The data will be accessed soon, so reading it in starts immediately.
+	 */
+	DATA_RAW_ADVICE_WILLNEED
+} data_raw_advice;
+
+/*
+ * Raw data files of at least this many bytes are mapped rather than read by
+ * default.
+ */
+#define DATA_RAW_MAP_SIZE_DEFAULT ((size_t)1u << 20)
+
 extern const data_type_manager data_type_manager_raw;
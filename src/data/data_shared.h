@@ -0,0 +1,94 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data_types.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Thread-safe cache of data shared between threads, unlike data caches, which
+ * are each only used in one thread. Entries are reference counted, each thread
+ * keeping the entries it acquired as its handles of the data, and the data is
+ * unloaded once the last reference is released. Entries are spread over
+ * DATA_SHARED_SHARDS shards, each with its own lock, so threads looking up
+ * different data rarely contend; loads are done outside of the locks, and
+ * threads acquiring data another thread is loading wait for that load rather
+ * than loading the data again.
+ *
+ * Only data types that don't need the graphics API are supported, as data
+ * shared between threads can't be tied to the render thread's context:
+ * DATA_TYPE_RAW, DATA_TYPE_SOUND and DATA_TYPE_ATLAS.
+ */
+
+#define DATA_SHARED_SHARDS ((size_t)16u)
+
+typedef struct data_shared_object data_shared_object;
+
+typedef struct data_shared_entry data_shared_entry;
+
+/*
+ * Create a shared cache, with the paths of the same requirements as those of
+ * data_cache_create. Returns NULL upon failure.
+ */
+data_shared_object* data_shared_create(const char* const resource_path, const char* const save_path);
+
+/*
+ * Destroy the shared cache. Every entry must have been released.
+ */
+void data_shared_destroy(data_shared_object* const shared);
+
+/*
+ * Returns true if the data type can be shared.
+ */
+bool data_shared_type_supported(const data_type type);
+
+/*
+ * Acquire a reference of the data, loading it if no thread holds a reference
+ * of it. The data is the same for every thread acquiring the same identifier,
+ * until every reference has been released. Can be called in any thread.
+ * Returns NULL upon failure, with the status of the failed load.
+ */
+data_shared_entry* data_shared_acquire(data_shared_object* const shared, const data_type type, const data_path path, const char* const filename, data_load_status* const status);
+
+/*
+ * Get the data of the acquired entry, valid until the entry is released.
+ */
+const data_object* data_shared_data_get(const data_shared_entry* const entry);
+
+/*
+ * Release a reference of the entry, unloading its data once every reference
+ * has been released. Can be called in any thread.
+ */
+void data_shared_release(data_shared_object* const shared, data_shared_entry* const entry);
+
+/*
+ * The number of entries of the shared cache, and the references held of them.
+ */
+typedef struct data_shared_usage {
+	size_t num_entries;
+	size_t num_references;
+} data_shared_usage;
+
+void data_shared_usage_get(data_shared_object* const shared, data_shared_usage* const usage);
@@ -25,11 +25,61 @@
 
 #include "data/private/data_type_manager.h"
 #include "render/private/opengl.h"
+#include "SDL_surface.h"
+#include "SDL_rwops.h"
 
 typedef struct data_texture_object {
 	GLuint name;
 	float width;
 	float height;
+
+	/*
+	 * The layer the texture was copied into within the renderer's texture
+	 * array, or a negative value if it hasn't been copied into the array.
+	 * Textures with DATA_TEXTURE_ARRAY_EXCLUDED are never copied into the
+	 * array, such as textures rendered into, whose contents change.
+	 */
+	GLint array_layer;
+
+	/*
+	 * Nonzero for signed distance field textures, whose alpha is the distance
+	 * to the edges of shapes rather than coverage, 0.5 on the edges, and
+	 * spanning distance_range texels from 0.0 to 1.0. Distance field textures
+	 * are linearly filtered, and drawn with a shader that turns the distance
+	 * into antialiased coverage at any scale.
+	 */
+	float distance_range;
+
+	/*
+	 * The bytes of GPU memory used by the texture.
+	 */
+	size_t gpu_size;
 } data_texture_object;
 
+#define DATA_TEXTURE_ARRAY_EXCLUDED ((GLint)-2)
+
 extern const data_type_manager data_type_manager_texture;
+
+/*
+ * Decode an image into an SDL_PIXELFORMAT_RGBA32 surface. Doesn't use the
+ * graphics API, so it can be called in any thread. Returns NULL upon failure.
+ */
+SDL_Surface* data_texture_decode(SDL_RWops* const rwops);
+
+/*
+ * Set the sampling parameters of textures on the currently bound GL_TEXTURE_2D
+ * texture.
+ */
+void data_texture_parameters_set();
+
+/*
+ * Returns true if the bytes start with the identifier of KTX2 files.
+ */
+bool data_texture_is_ktx2(const void* const bytes, const size_t size);
+
+/*
+ * Create a texture of a KTX2 file in memory, uploading block compressed
+ * formats without decoding them if the GPU supports them. The created texture
+ * is left bound to GL_TEXTURE_2D. Returns 0 upon failure.
+ */
+GLuint data_texture_ktx2_upload(const void* const bytes, const size_t size, GLsizei* const width, GLsizei* const height, size_t* const gpu_size);
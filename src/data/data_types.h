@@ -28,6 +28,10 @@
 #include "data/data_font.h"
 #include "data/data_sound.h"
 #include "data/data_music.h"
+#include "data/data_atlas.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 
 typedef enum data_type {
 	/*
@@ -55,6 +59,18 @@ typedef enum data_type {
 	 */
 	DATA_TYPE_MUSIC,
 
+	/*
+	 * Names of sprites packed into sheets.
+	 */
+	DATA_TYPE_ATLAS,
+
+	/*
+	 * Bitmap fonts, with their pages converted into signed distance fields
+	 * when loaded, for printing at any scale. Uses the font member of data
+	 * objects.
+	 */
+	DATA_TYPE_FONT_SDF,
+
 	/*
 	 * The number of valid data types.
 	 */
@@ -113,20 +129,59 @@ typedef struct data_id {
 typedef enum data_load_status {
 	DATA_LOAD_STATUS_SUCCESS,
 	DATA_LOAD_STATUS_ERROR,
-	DATA_LOAD_STATUS_MISSING
+	DATA_LOAD_STATUS_MISSING,
+
+	/*
+	 * An asynchronous load is still in flight.
+	 */
+	DATA_LOAD_STATUS_PENDING
 } data_load_status;
 
 typedef struct data_cache_object data_cache_object;
 
+typedef struct data_request_object data_request_object;
+
+typedef struct data_prefetch_object data_prefetch_object;
+
+/*
+ * Handle of a data identifier interned in a data cache with
+ * data_cache_intern, valid for the lifetime of the cache. DATA_HANDLE_NONE is
+ * never a valid handle.
+ */
+typedef uint32_t data_handle;
+
+#define DATA_HANDLE_NONE ((data_handle)0u)
+
 typedef struct data_object {
 	data_id id;
 	data_cache_object* cache;
 
+	/*
+	 * The following fields are managed by the data cache, for accounting and
+	 * eviction of cached data. The sizes are those of the data when it was
+	 * added to the cache, and the epoch is the cache's epoch when the data was
+	 * last gotten from the cache.
+	 */
+	bool cached;
+	size_t cpu_size;
+	size_t gpu_size;
+	size_t pins;
+	uint64_t epoch;
+	struct data_object* lru_prev;
+	struct data_object* lru_next;
+
+	/*
+	 * The handle interned for the data's key, if any, whose slot references
+	 * the data while it's cached.
+	 */
+	data_handle handle;
+
 	union {
 		data_raw_object* raw;
 		data_font_object* font;
 		data_texture_object* texture;
 		data_sound_object* sound;
 		data_music_object* music;
+		data_atlas_object* atlas;
 	};
 } data_object;
@@ -0,0 +1,79 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * Write-behind saving of files into the save path, so saves don't hold up the
+ * threads making them. Writes are queued, copying the bytes, and written by the
+ * writer's own thread, in the order the files were first queued. Until a
+ * file's queued writes are started, repeated saves of the file are coalesced
+ * into the last save, and appends are batched into one write, appending to a
+ * queued save's bytes if there is one. Saved files are written to a temporary
+ * file first, which then replaces the file, so a save that's interrupted never
+ * leaves a partially written file in place of the previous one.
+ *
+ * The functions of a writer can be called from any thread. Queueing only fails
+ * upon allocation failures, as the files are written later; write errors are
+ * reported by data_writer_flush.
+ */
+
+typedef struct data_writer_object data_writer_object;
+
+/*
+ * Create a writer, for the save path of the same requirements as that of
+ * data_cache_create. Returns NULL upon failure.
+ */
+data_writer_object* data_writer_create(const char* const save_path);
+
+/*
+ * Flush the writer, then destroy it.
+ */
+void data_writer_destroy(data_writer_object* const writer);
+
+/*
+ * Queue saving the bytes into the file, replacing the file. Returns false upon
+ * failure.
+ */
+bool data_writer_save(data_writer_object* const writer, const char* const filename, const void* const bytes, const size_t size);
+
+/*
+ * Queue replacing the file with an empty file. Returns false upon failure.
+ */
+bool data_writer_recreate(data_writer_object* const writer, const char* const filename);
+
+/*
+ * Queue appending the bytes to the file, creating the file if it doesn't exist.
+ * Returns false upon failure.
+ */
+bool data_writer_append(data_writer_object* const writer, const char* const filename, const void* const bytes, const size_t size);
+
+/*
+ * Wait until every queued write has been written, including those queued by
+ * other threads while waiting. Returns false if any write since the previous
+ * flush failed.
+ */
+bool data_writer_flush(data_writer_object* const writer);
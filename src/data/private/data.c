@@ -24,19 +24,118 @@
 
 #include "data/data.h"
 #include "data/private/data_type_manager.h"
+#include "data/private/data_private.h"
 #include "util/dict.h"
 #include "util/str.h"
+#include "util/log.h"
 #include "util/mem.h"
+#include "util/jobs.h"
+#include "util/trace.h"
 #include "SDL.h"
 #include "SDL_mixer.h"
 #include "SDL_image.h"
 #include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
 
+/*
+ * An interned data identifier, with its prebuilt key, and the data while it's
+ * cached.
+ */
+typedef struct interned_type {
+	data_id id;
+	void* key;
+	size_t key_size;
+	data_object* data;
+} interned_type;
+
+/*
+ * Asynchronous loads are read and decoded in jobs, then finished in the
+ * cache's thread, uploading and caching the data. Requests in flight are listed
+ * in their cache, and own their data until it's finished. Requests keep their
+ * ID until released, as done requests look their data up in the cache each
+ * get, reloading it if it's no longer cached.
+ */
+struct data_request_object {
+	data_cache_object* cache;
+	data_request_object* prev;
+	data_request_object* next;
+	data_type type;
+	data_path path;
+	char* filename;
+	void* key;
+	size_t key_size;
+
+	/*
+	 * The data being loaded, only valid while the load is in flight.
+	 */
+	data_object* data;
+
+	/*
+	 * The file decoded by the job, for types with a decode function.
+	 */
+	void* decoded;
+
+	/*
+	 * The status of the job plus one, set once it's done, before which only
+	 * the job accesses the data.
+	 */
+	SDL_atomic_t loaded;
+
+	data_load_status status;
+	bool done;
+	bool released;
+};
+
+#define PACKS_MAX 16u
+
+struct data_prefetch_object {
+	size_t num_requests;
+	data_request_object* requests[];
+};
+
+/*
+ * Cached data of each type is kept in a list ordered from the most recently
+ * gotten to the least recently gotten, evicting from the least recently gotten
+ * end when over budget.
+ */
 struct data_cache_object {
 	char* resource_path;
 	char* save_path;
 	dict_object* data;
+
+	/*
+	 * Handles index interned, offset by one, and handle_indices maps keys to
+	 * handles.
+	 */
+	interned_type* interned;
+	size_t num_interned;
+	size_t interned_capacity;
+	dict_object* handle_indices;
+
+	data_request_object* requests;
+	jobs_counter_type loads;
+
+	data_object* lru_heads[DATA_TYPE_NUM];
+	data_object* lru_tails[DATA_TYPE_NUM];
+	data_cache_usage usages[DATA_TYPE_NUM];
+	size_t cpu_budgets[DATA_TYPE_NUM];
+	size_t gpu_budgets[DATA_TYPE_NUM];
+	uint64_t epoch;
+
+	void (* evict)(void* const evict_data, const data_object* const data);
+	void* evict_data;
+
+	size_t raw_map_size;
+	data_raw_advice raw_advice;
+	bool texture_bake;
+
+	/*
+	 * Packs are searched for resources before the resource path, most
+	 * recently mounted first.
+	 */
+	data_pack_object* packs[PACKS_MAX];
+	size_t num_packs;
 };
 
 static const data_type_manager* const type_managers[DATA_TYPE_NUM] = {
@@ -44,9 +143,14 @@ static const data_type_manager* const type_managers[DATA_TYPE_NUM] = {
 	&data_type_manager_texture,
 	&data_type_manager_font,
 	&data_type_manager_sound,
-	&data_type_manager_music
+	&data_type_manager_music,
+	&data_type_manager_atlas,
+	&data_type_manager_font_sdf
 };
 
+static void request_finish(data_request_object* const request, const bool cache_data);
+static void request_free(data_request_object* const request);
+
 data_cache_object* data_cache_create(const char* const resource_path, const char* const save_path) {
 	assert(resource_path != NULL);
 	assert(save_path != NULL);
@@ -86,19 +190,248 @@ data_cache_object* data_cache_create(const char* const resource_path, const char
 		mem_free(cache);
 		return NULL;
 	}
-	
+
+	cache->handle_indices = dict_create(1u);
+	if (cache->handle_indices == NULL) {
+		dict_destroy(cache->data);
+		mem_free(cache->save_path);
+		mem_free(cache->resource_path);
+		mem_free(cache);
+		return NULL;
+	}
+	cache->interned = NULL;
+	cache->num_interned = 0u;
+	cache->interned_capacity = 0u;
+	cache->requests = NULL;
+	jobs_counter_init(&cache->loads);
+
+	for (size_t type = 0u; type < DATA_TYPE_NUM; type++) {
+		cache->lru_heads[type] = NULL;
+		cache->lru_tails[type] = NULL;
+		cache->usages[type] = (data_cache_usage) { 0 };
+		cache->cpu_budgets[type] = SIZE_MAX;
+		cache->gpu_budgets[type] = SIZE_MAX;
+	}
+	cache->epoch = 0u;
+	cache->evict = NULL;
+	cache->evict_data = NULL;
+	cache->raw_map_size = DATA_RAW_MAP_SIZE_DEFAULT;
+	cache->raw_advice = DATA_RAW_ADVICE_NORMAL;
+	cache->texture_bake = true;
+	cache->num_packs = 0u;
+
+	char* const pack_filename = alloc_sprintf("%s%s", cache->resource_path, DATA_PACK_FILENAME_DEFAULT);
+	if (pack_filename != NULL) {
+		data_pack_object* const pack = data_pack_open(pack_filename);
+		if (pack != NULL) {
+			cache->packs[cache->num_packs++] = pack;
+		}
+		mem_free(pack_filename);
+	}
+
 	return cache;
 }
 
+bool data_cache_pack_mount(data_cache_object* const cache, const char* const filename) {
+	assert(cache != NULL);
+	assert(filename != NULL);
+
+	if (cache->num_packs == PACKS_MAX) {
+		log_printf("Error: Too many packs mounted to mount \"%s\"\n", filename);
+		return false;
+	}
+
+	char* const full_filename = alloc_sprintf("%s%s", cache->resource_path, filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	data_pack_object* const pack = data_pack_open(full_filename);
+	mem_free(full_filename);
+	if (pack == NULL) {
+		return false;
+	}
+	cache->packs[cache->num_packs++] = pack;
+	return true;
+}
+
 void data_cache_destroy(data_cache_object* const cache) {
 	assert(cache != NULL);
 
+	/*
+	 * Loads in flight are waited on, then dropped as failed.
+	 */
+	jobs_wait(&cache->loads);
+	while (cache->requests != NULL) {
+		data_request_object* const request = cache->requests;
+		request_finish(request, false);
+		if (request->released) {
+			request_free(request);
+		}
+	}
+
 	mem_free(cache->resource_path);
 	mem_free(cache->save_path);
 	dict_destroy(cache->data);
+	for (size_t i = 0u; i < cache->num_interned; i++) {
+		mem_free((char*)cache->interned[i].id.filename);
+		mem_free(cache->interned[i].key);
+	}
+	mem_free(cache->interned);
+	dict_destroy(cache->handle_indices);
+	for (size_t i = 0u; i < cache->num_packs; i++) {
+		data_pack_close(cache->packs[i]);
+	}
 	mem_free(cache);
 }
 
+static void cache_fields_init(data_object* const data) {
+	data->cached = false;
+	data->cpu_size = 0u;
+	data->gpu_size = 0u;
+	data->pins = 0u;
+	data->epoch = 0u;
+	data->lru_prev = NULL;
+	data->lru_next = NULL;
+	data->handle = DATA_HANDLE_NONE;
+}
+
+/*
+ * Reference the data from the slot of the handle interned for the key, if
+ * any.
+ */
+static void handle_link(data_cache_object* const cache, const void* const key, const size_t key_size, data_object* const data) {
+	data_handle* handle;
+	if (cache->num_interned > 0u && dict_get(cache->handle_indices, key, key_size, (void**)&handle, NULL)) {
+		cache->interned[*handle - 1u].data = data;
+		data->handle = *handle;
+	}
+}
+
+static void handle_unlink(data_object* const data) {
+	if (data->handle != DATA_HANDLE_NONE) {
+		data->cache->interned[data->handle - 1u].data = NULL;
+		data->handle = DATA_HANDLE_NONE;
+	}
+}
+
+static void lru_unlink(data_object* const data) {
+	data_cache_object* const cache = data->cache;
+	const data_type type = data->id.type;
+
+	if (data->lru_prev != NULL) {
+		data->lru_prev->lru_next = data->lru_next;
+	}
+	else {
+		cache->lru_heads[type] = data->lru_next;
+	}
+	if (data->lru_next != NULL) {
+		data->lru_next->lru_prev = data->lru_prev;
+	}
+	else {
+		cache->lru_tails[type] = data->lru_prev;
+	}
+	data->lru_prev = NULL;
+	data->lru_next = NULL;
+}
+
+static void lru_push(data_object* const data) {
+	data_cache_object* const cache = data->cache;
+	const data_type type = data->id.type;
+
+	data->lru_prev = NULL;
+	data->lru_next = cache->lru_heads[type];
+	if (cache->lru_heads[type] != NULL) {
+		cache->lru_heads[type]->lru_prev = data;
+	}
+	else {
+		cache->lru_tails[type] = data;
+	}
+	cache->lru_heads[type] = data;
+	data->epoch = cache->epoch;
+}
+
+/*
+ * Move cached data to the most recently gotten end of its list.
+ */
+static void lru_touch(const data_object* const data) {
+	data_object* const touched = (data_object*)data;
+	lru_unlink(touched);
+	lru_push(touched);
+}
+
+/*
+ * The dictionary's destroy function of cached data, removing the data from the
+ * accounting before destroying it. Every path dropping cached data goes through
+ * here, whether evicted, ungotten, removed or dropped by data_cache_only, so
+ * the cache's evict function is called here.
+ */
+static bool cached_destroy(void* const value) {
+	data_object* const data = value;
+	if (data->cached) {
+		data_cache_object* const cache = data->cache;
+		if (cache->evict != NULL) {
+			cache->evict(cache->evict_data, data);
+		}
+		data_cache_usage* const usage = &data->cache->usages[data->id.type];
+		lru_unlink(data);
+		handle_unlink(data);
+		usage->num_cached--;
+		usage->cpu_size -= data->cpu_size;
+		usage->gpu_size -= data->gpu_size;
+		data->cached = false;
+	}
+	return type_managers[data->id.type]->destroy(data);
+}
+
+static bool over_budget(const data_cache_object* const cache, const data_type type) {
+	return
+		cache->usages[type].cpu_size > cache->cpu_budgets[type] ||
+		cache->usages[type].gpu_size > cache->gpu_budgets[type];
+}
+
+static void evict(data_cache_object* const cache, const data_type type) {
+	data_object* data = cache->lru_tails[type];
+	while (data != NULL && over_budget(cache, type)) {
+		/*
+		 * Everything more recently gotten than data of the current epoch is
+		 * in the current epoch too.
+		 */
+		if (data->epoch == cache->epoch) {
+			break;
+		}
+
+		data_object* const prev = data->lru_prev;
+		if (data->pins == 0u) {
+			if (!data_cache_unget(cache, data->id.type, data->id.path, data->id.filename)) {
+				break;
+			}
+		}
+		data = prev;
+	}
+}
+
+/*
+ * Add the data to the cache's dictionary, replacing any data with the same key
+ * already cached, then evict data if over budget.
+ */
+static bool cache_insert(data_cache_object* const cache, const void* const key, const size_t key_size, data_object* const data) {
+	if (!dict_set(cache->data, key, key_size, (void*)data, sizeof(data), cached_destroy, NULL)) {
+		return false;
+	}
+
+	type_managers[data->id.type]->size(data, &data->cpu_size, &data->gpu_size);
+	data_cache_usage* const usage = &cache->usages[data->id.type];
+	usage->num_cached++;
+	usage->cpu_size += data->cpu_size;
+	usage->gpu_size += data->gpu_size;
+	data->cached = true;
+	lru_push(data);
+	handle_link(cache, key, key_size, data);
+
+	evict(cache, data->id.type);
+	return true;
+}
+
 static size_t get_key_size(const data_id* const id) {
 	return dict_tokey(NULL, 0u, 3u, &id->type, sizeof(id->type), &id->path, sizeof(id->path), id->filename, strlen(id->filename));
 }
@@ -118,30 +451,44 @@ static void* get_key(const data_id* const id, size_t* const key_size) {
 	return key;
 }
 
-const data_object* data_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, data_load_status* const status) {
-	assert(cache != NULL);
-	assert(type >= 0);
-	assert(type < DATA_TYPE_NUM);
-	assert(path >= 0);
-	assert(path < DATA_PATH_NUM);
-	assert(filename != NULL);
+/*
+ * Get the key in the calling thread's scratch arena, for keys only needed
+ * during a lookup, released by rewinding to the mark.
+ */
+static void* get_key_scratch(const data_id* const id, size_t* const key_size, mem_arena_mark* const mark) {
+	assert(id != NULL);
+	assert(strlen(id->filename) > 0u);
+	assert(key_size != NULL);
+	assert(mark != NULL);
 
-	if (path == DATA_PATH_SAVE_THEN_RESOURCE) {
-		const data_object* const data = data_load(cache, type, DATA_PATH_SAVE, filename, status);
-		if (data != NULL) {
-			return data;
-		}
-		else if (*status != DATA_LOAD_STATUS_MISSING) {
-			return NULL;
-		}
-		return data_load(cache, type, DATA_PATH_RESOURCE, filename, status);
+	mem_arena_object* const scratch = mem_scratch_get();
+	if (scratch == NULL) {
+		return NULL;
 	}
-
-	if (status != NULL) {
-		*status = DATA_LOAD_STATUS_SUCCESS;
+	*mark = mem_arena_mark_get(scratch);
+	const size_t size = get_key_size(id);
+	void* const key = mem_arena_alloc(scratch, size, 1u);
+	if (key == NULL) {
+		return NULL;
 	}
+	dict_tokey(key, size, 3u, &id->type, sizeof(id->type), &id->path, sizeof(id->path), id->filename, strlen(id->filename));
+	*key_size = size;
+	return key;
+}
+
+static void key_release(const mem_arena_mark mark) {
+	mem_arena_rewind(mem_scratch_get(), mark);
+}
 
-	data_object* data = NULL;
+static SDL_RWops* file_open(const data_cache_object* const cache, const data_path path, const char* const filename, data_load_status* const status) {
+	if (path == DATA_PATH_RESOURCE) {
+		for (size_t i = cache->num_packs; i > 0u; i--) {
+			SDL_RWops* const rwops = data_pack_file_open(cache->packs[i - 1u], filename, status);
+			if (rwops != NULL || *status != DATA_LOAD_STATUS_MISSING) {
+				return rwops;
+			}
+		}
+	}
 
 	const char* const base_path =
 		path == DATA_PATH_RESOURCE ? cache->resource_path :
@@ -151,28 +498,19 @@ const data_object* data_load(data_cache_object* const cache, const data_type typ
 
 	char* const full_filename = alloc_sprintf("%s%s", base_path, filename);
 	if (full_filename == NULL) {
-		if (status != NULL) {
-			*status = DATA_LOAD_STATUS_ERROR;
-		}
+		*status = DATA_LOAD_STATUS_ERROR;
 		return NULL;
 	}
 
 	SDL_RWops* const rwops = SDL_RWFromFile(full_filename, "rb");
-	if (rwops == NULL) {
-		mem_free(full_filename);
-		if (status != NULL) {
-			*status = DATA_LOAD_STATUS_MISSING;
-		}
-		return NULL;
-	}
 	mem_free(full_filename);
-    
-    data = (data_object*)mem_malloc(sizeof(data_object));
+	*status = rwops != NULL ? DATA_LOAD_STATUS_SUCCESS : DATA_LOAD_STATUS_MISSING;
+	return rwops;
+}
+
+static data_object* data_alloc(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename) {
+	data_object* const data = (data_object*)mem_malloc(sizeof(data_object));
 	if (data == NULL) {
-		SDL_RWclose(rwops);
-		if (status != NULL) {
-			*status = DATA_LOAD_STATUS_ERROR;
-		}
 		return NULL;
 	}
 	data->id.type = type;
@@ -180,13 +518,31 @@ const data_object* data_load(data_cache_object* const cache, const data_type typ
 	data->id.filename = (const char*)alloc_sprintf("%s", filename);
 	if (data->id.filename == NULL) {
 		mem_free(data);
+		return NULL;
+	}
+	data->cache = cache;
+	cache_fields_init(data);
+	return data;
+}
+
+static const data_object* data_file_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, data_load_status* const status) {
+	data_load_status open_status;
+	SDL_RWops* const rwops = file_open(cache, path, filename, &open_status);
+	if (status != NULL) {
+		*status = open_status;
+	}
+	if (rwops == NULL) {
+		return NULL;
+	}
+
+	data_object* const data = data_alloc(cache, type, path, filename);
+	if (data == NULL) {
 		SDL_RWclose(rwops);
 		if (status != NULL) {
 			*status = DATA_LOAD_STATUS_ERROR;
 		}
 		return NULL;
 	}
-	data->cache = cache;
 
 	if (!type_managers[type]->create((void*)data, rwops)) {
 		mem_free((char*)data->id.filename);
@@ -201,20 +557,188 @@ const data_object* data_load(data_cache_object* const cache, const data_type typ
 	return data;
 }
 
+const data_object* data_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, data_load_status* const status) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(path >= 0);
+	assert(path < DATA_PATH_NUM);
+	assert(filename != NULL);
+
+	if (path == DATA_PATH_SAVE_THEN_RESOURCE) {
+		const data_object* const data = data_load(cache, type, DATA_PATH_SAVE, filename, status);
+		if (data != NULL) {
+			return data;
+		}
+		else if (*status != DATA_LOAD_STATUS_MISSING) {
+			return NULL;
+		}
+		return data_load(cache, type, DATA_PATH_RESOURCE, filename, status);
+	}
+
+	trace_begin("data_load");
+	const mem_tag_type tag = mem_tag_set(MEM_TAG_DATA);
+	const data_object* const data = data_file_load(cache, type, path, filename, status);
+	mem_tag_set(tag);
+	trace_end();
+	return data;
+}
+
+const data_object* data_decoded_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, void* const decoded) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(type_managers[type]->upload != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+	assert(decoded != NULL);
+
+	data_object* const data = data_alloc(cache, type, path, filename);
+	if (data == NULL) {
+		type_managers[type]->discard(decoded);
+		return NULL;
+	}
+	if (!type_managers[type]->upload(data, decoded)) {
+		mem_free((char*)data->id.filename);
+		mem_free(data);
+		return NULL;
+	}
+	return data;
+}
+
+const data_object* data_texture_create(data_cache_object* const cache, const data_path path, const char* const filename, const GLuint name, const GLsizei width, const GLsizei height, const size_t gpu_size) {
+	assert(cache != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+	assert(width > 0);
+	assert(height > 0);
+
+	data_object* const data = (data_object*)mem_malloc(sizeof(data_object));
+	if (data == NULL) {
+		return NULL;
+	}
+	data->id.type = DATA_TYPE_TEXTURE;
+	data->id.path = path;
+	data->id.filename = (const char*)alloc_sprintf("%s", filename);
+	if (data->id.filename == NULL) {
+		mem_free(data);
+		return NULL;
+	}
+	data->cache = cache;
+	cache_fields_init(data);
+
+	data->texture = mem_calloc(1u, sizeof(data_texture_object));
+	if (data->texture == NULL) {
+		mem_free((char*)data->id.filename);
+		mem_free(data);
+		return NULL;
+	}
+	data->texture->name = name;
+	data->texture->width = width;
+	data->texture->height = height;
+	data->texture->array_layer = -1;
+	data->texture->gpu_size = gpu_size;
+
+	return data;
+}
+
+char* data_filename_get(data_cache_object* const cache, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+
+	return alloc_sprintf("%s%s", path == DATA_PATH_RESOURCE ? cache->resource_path : cache->save_path, filename);
+}
+
+SDL_RWops* data_file_open(data_cache_object* const cache, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+
+	data_load_status status;
+	return file_open(cache, path, filename, &status);
+}
+
+bool data_file_packed(data_cache_object* const cache, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(filename != NULL);
+
+	if (path != DATA_PATH_RESOURCE) {
+		return false;
+	}
+	for (size_t i = 0u; i < cache->num_packs; i++) {
+		if (data_pack_contains(cache->packs[i], filename)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool data_file_stat(data_cache_object* const cache, const data_path path, const char* const filename, uint64_t* const size, int64_t* const mtime) {
+	assert(cache != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+	assert(size != NULL);
+	assert(mtime != NULL);
+
+	if (path == DATA_PATH_RESOURCE) {
+		for (size_t i = cache->num_packs; i > 0u; i--) {
+			if (data_pack_file_stat(cache->packs[i - 1u], filename, size, mtime)) {
+				return true;
+			}
+		}
+	}
+
+	char* const full_filename = data_filename_get(cache, path, filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	const bool success = data_stat(full_filename, size, mtime);
+	mem_free(full_filename);
+	return success;
+}
+
+bool data_cache_contains(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(path >= 0);
+	assert(path < DATA_PATH_NUM);
+	assert(filename != NULL);
+
+	size_t key_size;
+	data_id id = {
+		.type = type,
+		.path = path,
+		.filename = filename
+	};
+
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&id, &key_size, &key_mark);
+	if (key == NULL) {
+		return false;
+	}
+	const bool contains = dict_get(cache->data, key, key_size, NULL, NULL);
+	key_release(key_mark);
+
+	return contains;
+}
+
 bool data_unload(const data_object* const data) {
 	assert(data != NULL);
 
 	size_t key_size;
-	void* const key = get_key(&data->id, &key_size);
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&data->id, &key_size, &key_mark);
 	if (key == NULL) {
 		return false;
 	}
 
 	if (dict_get(data->cache->data, key, key_size, NULL, NULL)) {
-		mem_free(key);
+		key_release(key_mark);
 		return false;
 	}
-	mem_free(key);
+	key_release(key_mark);
 
 	return type_managers[data->id.type]->destroy((void*)data);
 }
@@ -240,45 +764,149 @@ const data_object* data_cache_get(data_cache_object* const cache, const data_typ
 		.filename = filename
 	};
 
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&id, &key_size, &key_mark);
+	if (key == NULL) {
+		if (status != NULL) {
+			*status = DATA_LOAD_STATUS_ERROR;
+		}
+		return NULL;
+	}
+	const data_object* data = NULL;
+	success = dict_get(cache->data, key, key_size, (void**)&data, NULL);
+	if (success) {
+		if (!always_load) {
+			key_release(key_mark);
+			lru_touch(data);
+			return data;
+		}
+		else {
+			data_cache_unget(cache, type, path, filename);
+		}
+	}
+
+	data = data_load(cache, type, path, filename, status);
+	if (data == NULL) {
+		key_release(key_mark);
+		if (status != NULL) {
+			*status = DATA_LOAD_STATUS_ERROR;
+		}
+		return NULL;
+	}
+
+	success = cache_insert(cache, key, key_size, (data_object*)data);
+	if (!success) {
+		type_managers[type]->destroy((void*)data);
+		key_release(key_mark);
+		if (status != NULL) {
+			*status = DATA_LOAD_STATUS_ERROR;
+		}
+		return NULL;
+	}
+
+	key_release(key_mark);
+	return data;
+}
+
+data_handle data_cache_intern(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(path >= 0);
+	assert(path < DATA_PATH_NUM);
+	assert(filename != NULL);
+
+	size_t key_size;
+	data_id id = {
+		.type = type,
+		.path = path,
+		.filename = filename
+	};
+
 	void* const key = get_key(&id, &key_size);
 	if (key == NULL) {
-		if (status != NULL) {
-			*status = DATA_LOAD_STATUS_ERROR;
-		}
-		return NULL;
+		return DATA_HANDLE_NONE;
 	}
-	const data_object* data = NULL;
-	success = dict_get(cache->data, key, key_size, (void**)&data, NULL);
-	if (success) {
-		if (!always_load) {
+	data_handle* found;
+	if (dict_get(cache->handle_indices, key, key_size, (void**)&found, NULL)) {
+		mem_free(key);
+		return *found;
+	}
+
+	if (cache->num_interned == cache->interned_capacity) {
+		const size_t capacity = cache->interned_capacity > 0u ? cache->interned_capacity * 2u : 16u;
+		interned_type* const interned = mem_realloc(cache->interned, capacity * sizeof(interned_type));
+		if (interned == NULL) {
 			mem_free(key);
-			return data;
+			return DATA_HANDLE_NONE;
 		}
-		else {
-			data_cache_unget(cache, type, path, filename);
+		cache->interned = interned;
+		cache->interned_capacity = capacity;
+	}
+
+	id.filename = alloc_sprintf("%s", filename);
+	if (id.filename == NULL) {
+		mem_free(key);
+		return DATA_HANDLE_NONE;
+	}
+	data_handle handle = (data_handle)(cache->num_interned + 1u);
+	if (!dict_set(cache->handle_indices, key, key_size, &handle, sizeof(handle), NULL, NULL)) {
+		mem_free((char*)id.filename);
+		mem_free(key);
+		return DATA_HANDLE_NONE;
+	}
+
+	interned_type* const interned = &cache->interned[cache->num_interned++];
+	interned->id = id;
+	interned->key = key;
+	interned->key_size = key_size;
+	interned->data = NULL;
+
+	// The data might already be cached from getting it by filename.
+	data_object* data;
+	if (dict_get(cache->data, key, key_size, (void**)&data, NULL)) {
+		interned->data = data;
+		data->handle = handle;
+	}
+
+	return handle;
+}
+
+const data_object* data_cache_handle_get(data_cache_object* const cache, const data_handle handle, data_load_status* const status, const bool load) {
+	assert(cache != NULL);
+	assert(handle != DATA_HANDLE_NONE && handle <= cache->num_interned);
+
+	interned_type* const interned = &cache->interned[handle - 1u];
+	if (interned->data != NULL) {
+		if (status != NULL) {
+			*status = DATA_LOAD_STATUS_SUCCESS;
 		}
+		lru_touch(interned->data);
+		return interned->data;
+	}
+	else if (!load) {
+		if (status != NULL) {
+			*status = DATA_LOAD_STATUS_MISSING;
+		}
+		return NULL;
 	}
 
-	data = data_load(cache, type, path, filename, status);
+	const data_object* const data = data_load(cache, interned->id.type, interned->id.path, interned->id.filename, status);
 	if (data == NULL) {
-		mem_free(key);
 		if (status != NULL) {
 			*status = DATA_LOAD_STATUS_ERROR;
 		}
 		return NULL;
 	}
 
-	success = dict_set(cache->data, key, key_size, (void*)data, sizeof(data), type_managers[type]->destroy_by_dict, NULL);
-	if (!success) {
-		type_managers[type]->destroy((void*)data);
-		mem_free(key);
+	if (!cache_insert(cache, interned->key, interned->key_size, (data_object*)data)) {
+		type_managers[interned->id.type]->destroy((void*)data);
 		if (status != NULL) {
 			*status = DATA_LOAD_STATUS_ERROR;
 		}
 		return NULL;
 	}
 
-	mem_free(key);
 	return data;
 }
 
@@ -297,17 +925,15 @@ bool data_cache_unget(data_cache_object* const cache, const data_type type, cons
 		.filename = filename
 	};
 
-	void* const key = get_key(&id, &key_size);
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&id, &key_size, &key_mark);
 	if (key == NULL) {
 		return false;
 	}
 
-	if (!dict_set(cache->data, key, key_size, NULL, 0u, NULL, NULL)) {
-		return false;
-	}
-
-	mem_free(key);
-	return true;
+	const bool set = dict_set(cache->data, key, key_size, NULL, 0u, NULL, NULL);
+	key_release(key_mark);
+	return set;
 }
 
 char* data_directory_get(const data_object* const data) {
@@ -387,30 +1013,32 @@ bool data_save(data_cache_object*const cache, const data_type type, const char*c
 			return false;
 		}
 		data->cache = cache;
+		cache_fields_init(data);
 
 		size_t key_size;
-		void* const key = get_key(&data->id, &key_size);
+		mem_arena_mark key_mark;
+		void* const key = get_key_scratch(&data->id, &key_size, &key_mark);
 		if (key == NULL) {
 			type_managers[type]->destroy(data);
 			return false;
 		}
 
 		if (!data_cache_unget(cache, type, DATA_PATH_SAVE, filename)) {
-			mem_free(key);
+			key_release(key_mark);
 			type_managers[type]->destroy(data);
 			return false;
 		}
 
 		SDL_RWops* const temp_rwops = SDL_RWFromConstMem(bytes, size);
 		if (temp_rwops == NULL) {
-			mem_free(key);
+			key_release(key_mark);
 			mem_free((char*)data->id.filename);
 			mem_free(data);
 			return false;
 		}
 
 		if (!type_managers[type]->create((void*)data, temp_rwops)) {
-			mem_free(key);
+			key_release(key_mark);
 			mem_free((char*)data->id.filename);
 			mem_free(data);
 			SDL_RWclose(temp_rwops);
@@ -418,19 +1046,19 @@ bool data_save(data_cache_object*const cache, const data_type type, const char*c
 		}
 
 		if (SDL_RWclose(temp_rwops) < 0) {
-			mem_free(key);
+			key_release(key_mark);
 			type_managers[type]->destroy(data);
 			return false;
 		}
 
-		const bool success = dict_set(cache->data, key, key_size, (void*)data, sizeof(data), type_managers[type]->destroy_by_dict, NULL);
+		const bool success = cache_insert(cache, key, key_size, data);
 		if (!success) {
-			mem_free(key);
+			key_release(key_mark);
 			type_managers[type]->destroy((void*)data);
 			return false;
 		}
 
-		mem_free(key);
+		key_release(key_mark);
 	}
 
 	return true;
@@ -488,23 +1116,24 @@ bool data_append(data_cache_object* const cache, const char* const filename, con
 
 bool data_cache_add(const data_object* const data) {
 	size_t key_size;
-	void* const key = get_key(&data->id, &key_size);
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&data->id, &key_size, &key_mark);
 	if (key == NULL) {
 		return false;
 	}
 
 	if (!data_cache_unget(data->cache, data->id.type, data->id.path, data->id.filename)) {
-		mem_free(key);
+		key_release(key_mark);
 		return false;
 	}
 
-	const bool success = dict_set(data->cache->data, key, key_size, (void*)data, sizeof(data), type_managers[data->id.type]->destroy_by_dict, NULL);
+	const bool success = cache_insert(data->cache, key, key_size, (data_object*)data);
 	if (!success) {
-		mem_free(key);
+		key_release(key_mark);
 		return false;
 	}
 
-	mem_free(key);
+	key_release(key_mark);
 	return true;
 }
 
@@ -512,52 +1141,70 @@ bool data_cache_remove(const data_object* const data) {
 	assert(data != NULL);
 
 	size_t key_size;
-	void* const key = get_key(&data->id, &key_size);
+	mem_arena_mark key_mark;
+	void* const key = get_key_scratch(&data->id, &key_size, &key_mark);
 	if (key == NULL) {
 		return false;
 	}
 
 	void* value = NULL;
 	if (!dict_remove(data->cache->data, key, key_size, &value, NULL) || data != value) {
-		mem_free(key);
+		key_release(key_mark);
 		return false;
 	}
 
-	mem_free(key);
+	data_object* const removed = value;
+	data_cache_usage* const usage = &removed->cache->usages[removed->id.type];
+	lru_unlink(removed);
+	handle_unlink(removed);
+	usage->num_cached--;
+	usage->cpu_size -= removed->cpu_size;
+	usage->gpu_size -= removed->gpu_size;
+	removed->cached = false;
+
+	key_release(key_mark);
 	return true;
 }
 
-bool data_cache_only(data_cache_object* const cache, const data_id* const ids, const size_t count) {
-	assert(cache != NULL);
-	assert(count == 0u || (ids != NULL && count > 0u));
-
-	bool success;
-
+/*
+ * Unget cached data not in the list.
+ */
+static bool cache_keep_only(data_cache_object* const cache, const data_id* const ids, const size_t count) {
 	if (count == 0u) {
-		const bool status = dict_only(cache->data, 0u, NULL, NULL);
-		return status;
+		return dict_only(cache->data, 0u, NULL, NULL);
 	}
-    
-    void** const keys = (void**)mem_malloc(count * sizeof(void*));
-	if (keys == NULL) {
+
+	mem_arena_object* const scratch = mem_scratch_get();
+	if (scratch == NULL) {
 		return false;
 	}
-    size_t* const key_sizes = (size_t*)mem_malloc(count * sizeof(size_t));
-	if (key_sizes == NULL) {
-		mem_free(keys);
+	const mem_arena_mark mark = mem_arena_mark_get(scratch);
+	void** const keys = mem_arena_alloc(scratch, count * sizeof(void*), sizeof(void*));
+	size_t* const key_sizes = mem_arena_alloc(scratch, count * sizeof(size_t), sizeof(size_t));
+	if (keys == NULL || key_sizes == NULL) {
+		mem_arena_rewind(scratch, mark);
 		return false;
 	}
 	for (size_t i = 0u; i < count; i++) {
-		keys[i] = get_key(&ids[i], &key_sizes[i]);
+		mem_arena_mark key_mark;
+		keys[i] = get_key_scratch(&ids[i], &key_sizes[i], &key_mark);
+		if (keys[i] == NULL) {
+			mem_arena_rewind(scratch, mark);
+			return false;
+		}
 	}
 
-	success = dict_only(cache->data, count, (const void* const*)keys, key_sizes);
-	if (!success) {
-		for (size_t i = 0u; i < count; i++) {
-			mem_free(keys[i]);
-		}
-		mem_free(key_sizes);
-		mem_free(keys);
+	const bool success = dict_only(cache->data, count, (const void* const*)keys, key_sizes);
+
+	mem_arena_rewind(scratch, mark);
+	return success;
+}
+
+bool data_cache_only(data_cache_object* const cache, const data_id* const ids, const size_t count) {
+	assert(cache != NULL);
+	assert(count == 0u || (ids != NULL && count > 0u));
+
+	if (!cache_keep_only(cache, ids, count)) {
 		return false;
 	}
 
@@ -565,19 +1212,414 @@ bool data_cache_only(data_cache_object* const cache, const data_id* const ids, c
 		data_load_status status;
 		(void)data_cache_get(cache, ids[i].type, ids[i].path, ids[i].filename, &status, false);
 		if (status != DATA_LOAD_STATUS_SUCCESS) {
-			for (size_t i = 0u; i < count; i++) {
-				mem_free(keys[i]);
-			}
-			mem_free(key_sizes);
-			mem_free(keys);
 			return false;
 		}
 	}
 
-	for (size_t i = 0u; i < count; i++) {
-		mem_free(keys[i]);
+	return true;
+}
+
+static void request_load(void* const job_data) {
+	data_request_object* const request = job_data;
+	data_object* const data = request->data;
+	const data_type_manager* const manager = type_managers[data->id.type];
+	const mem_tag_type tag = mem_tag_set(MEM_TAG_DATA);
+
+	const bool save_first = data->id.path == DATA_PATH_SAVE_THEN_RESOURCE;
+	const data_path paths[2] = {
+		save_first ? DATA_PATH_SAVE : data->id.path,
+		save_first ? DATA_PATH_RESOURCE : data->id.path
+	};
+	data_load_status status = DATA_LOAD_STATUS_MISSING;
+	SDL_RWops* rwops = NULL;
+	for (size_t i = 0u; i < (save_first ? 2u : 1u); i++) {
+		rwops = file_open(data->cache, paths[i], data->id.filename, &status);
+		if (rwops != NULL) {
+			data->id.path = paths[i];
+			break;
+		}
+		else if (status != DATA_LOAD_STATUS_MISSING) {
+			break;
+		}
+	}
+
+	if (rwops != NULL) {
+		if (manager->decode != NULL) {
+			request->decoded = manager->decode(data, rwops);
+			SDL_RWclose(rwops);
+			status = request->decoded != NULL ? DATA_LOAD_STATUS_SUCCESS : DATA_LOAD_STATUS_ERROR;
+		}
+		else if (manager->create(data, rwops)) {
+			status = DATA_LOAD_STATUS_SUCCESS;
+		}
+		else {
+			SDL_RWclose(rwops);
+			status = DATA_LOAD_STATUS_ERROR;
+		}
+	}
+
+	mem_tag_set(tag);
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&request->loaded, (int)status + 1);
+}
+
+/*
+ * Finish the loaded request in the cache's thread, uploading the data and
+ * caching it, or dropping it as failed if cache_data is false. Data cached by
+ * something else while the request was in flight is kept, the request's data
+ * being dropped.
+ */
+static void request_finish(data_request_object* const request, const bool cache_data) {
+	assert(!request->done);
+
+	data_cache_object* const cache = request->cache;
+	data_load_status status = (data_load_status)(SDL_AtomicGet(&request->loaded) - 1);
+	SDL_MemoryBarrierAcquire();
+
+	data_object* data = request->data;
+	const data_type_manager* const manager = type_managers[data->id.type];
+	bool created = false;
+	if (status == DATA_LOAD_STATUS_SUCCESS && !cache_data) {
+		if (manager->decode == NULL) {
+			manager->destroy(data);
+			data = NULL;
+		}
+		status = DATA_LOAD_STATUS_ERROR;
+	}
+	else if (status == DATA_LOAD_STATUS_SUCCESS) {
+		if (manager->decode == NULL) {
+			created = true;
+		}
+		else {
+			created = manager->upload(data, request->decoded);
+			request->decoded = NULL;
+			if (!created) {
+				status = DATA_LOAD_STATUS_ERROR;
+			}
+		}
+	}
+
+	request->data = NULL;
+	if (created) {
+		data_object* cached;
+		if (dict_get(cache->data, request->key, request->key_size, (void**)&cached, NULL)) {
+			manager->destroy(data);
+			lru_touch(cached);
+		}
+		else if (!cache_insert(cache, request->key, request->key_size, data)) {
+			manager->destroy(data);
+			status = DATA_LOAD_STATUS_ERROR;
+		}
+	}
+	else {
+		if (request->decoded != NULL) {
+			manager->discard(request->decoded);
+			request->decoded = NULL;
+		}
+		if (data != NULL) {
+			mem_free((char*)data->id.filename);
+			mem_free(data);
+		}
+	}
+
+	if (request->prev != NULL) {
+		request->prev->next = request->next;
+	}
+	else {
+		cache->requests = request->next;
+	}
+	if (request->next != NULL) {
+		request->next->prev = request->prev;
+	}
+	request->prev = NULL;
+	request->next = NULL;
+
+	request->status = status;
+	request->done = true;
+}
+
+/*
+ * Start loading the request's data in a job, listing the request in its cache.
+ */
+static bool request_start(data_request_object* const request) {
+	data_cache_object* const cache = request->cache;
+
+	request->data = data_alloc(cache, request->type, request->path, request->filename);
+	if (request->data == NULL) {
+		return false;
+	}
+	request->decoded = NULL;
+	SDL_AtomicSet(&request->loaded, 0);
+	request->status = DATA_LOAD_STATUS_PENDING;
+	request->done = false;
+
+	request->prev = NULL;
+	request->next = cache->requests;
+	if (cache->requests != NULL) {
+		cache->requests->prev = request;
 	}
-	mem_free(key_sizes);
-	mem_free(keys);
+	cache->requests = request;
+
+	jobs_run(request_load, request, &cache->loads);
 	return true;
 }
+
+static void request_free(data_request_object* const request) {
+	mem_free(request->key);
+	mem_free(request->filename);
+	mem_free(request);
+}
+
+data_request_object* data_cache_get_async(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(path >= 0);
+	assert(path < DATA_PATH_NUM);
+	assert(filename != NULL);
+
+	data_request_object* const request = mem_malloc(sizeof(data_request_object));
+	if (request == NULL) {
+		return NULL;
+	}
+	request->cache = cache;
+	request->prev = NULL;
+	request->next = NULL;
+	request->type = type;
+	request->path = path;
+	request->data = NULL;
+	request->decoded = NULL;
+	request->released = false;
+
+	const data_id id = {
+		.type = type,
+		.path = path,
+		.filename = filename
+	};
+	request->key = get_key(&id, &request->key_size);
+	if (request->key == NULL) {
+		mem_free(request);
+		return NULL;
+	}
+	request->filename = alloc_sprintf("%s", filename);
+	if (request->filename == NULL) {
+		mem_free(request->key);
+		mem_free(request);
+		return NULL;
+	}
+
+	data_object* cached;
+	if (dict_get(cache->data, request->key, request->key_size, (void**)&cached, NULL)) {
+		lru_touch(cached);
+		SDL_AtomicSet(&request->loaded, (int)DATA_LOAD_STATUS_SUCCESS + 1);
+		request->status = DATA_LOAD_STATUS_SUCCESS;
+		request->done = true;
+		return request;
+	}
+
+	if (!request_start(request)) {
+		request_free(request);
+		return NULL;
+	}
+	return request;
+}
+
+/*
+ * Finish the request if it's been loaded, returning its status, without
+ * looking its data up.
+ */
+static data_load_status request_poll(data_request_object* const request) {
+	if (!request->done && SDL_AtomicGet(&request->loaded) != 0) {
+		request_finish(request, true);
+	}
+	return request->done ? request->status : DATA_LOAD_STATUS_PENDING;
+}
+
+const data_object* data_request_get(data_request_object* const request, data_load_status* const status) {
+	assert(request != NULL);
+	assert(!request->released);
+
+	request_poll(request);
+
+	/*
+	 * The data is looked up each get, as it could've been evicted, ungotten
+	 * or removed since the last get; the load is restarted if it's no longer
+	 * cached, as data_cache_get would reload it.
+	 */
+	const data_object* data = NULL;
+	if (request->done && request->status == DATA_LOAD_STATUS_SUCCESS) {
+		data_object* cached;
+		if (dict_get(request->cache->data, request->key, request->key_size, (void**)&cached, NULL)) {
+			lru_touch(cached);
+			data = cached;
+		}
+		else if (!request_start(request)) {
+			request->status = DATA_LOAD_STATUS_ERROR;
+		}
+	}
+
+	if (status != NULL) {
+		*status = request->done ? request->status : DATA_LOAD_STATUS_PENDING;
+	}
+	return data;
+}
+
+void data_request_release(data_request_object* const request) {
+	assert(request != NULL);
+	assert(!request->released);
+
+	if (request->done) {
+		request_free(request);
+	}
+	else {
+		request->released = true;
+	}
+}
+
+void data_cache_update(data_cache_object* const cache) {
+	assert(cache != NULL);
+
+	data_request_object* request = cache->requests;
+	while (request != NULL) {
+		data_request_object* const next = request->next;
+		if (SDL_AtomicGet(&request->loaded) != 0) {
+			request_finish(request, true);
+			if (request->released) {
+				request_free(request);
+			}
+		}
+		request = next;
+	}
+}
+
+data_prefetch_object* data_cache_only_async(data_cache_object* const cache, const data_id* const ids, const size_t count) {
+	assert(cache != NULL);
+	assert(count == 0u || (ids != NULL && count > 0u));
+
+	if (!cache_keep_only(cache, ids, count)) {
+		return NULL;
+	}
+
+	data_prefetch_object* const prefetch = mem_malloc(sizeof(data_prefetch_object) + count * sizeof(data_request_object*));
+	if (prefetch == NULL) {
+		return NULL;
+	}
+	for (prefetch->num_requests = 0u; prefetch->num_requests < count; prefetch->num_requests++) {
+		const data_id* const id = &ids[prefetch->num_requests];
+		data_request_object* const request = data_cache_get_async(cache, id->type, id->path, id->filename);
+		if (request == NULL) {
+			data_prefetch_destroy(prefetch);
+			return NULL;
+		}
+		prefetch->requests[prefetch->num_requests] = request;
+	}
+	return prefetch;
+}
+
+bool data_prefetch_progress_get(data_prefetch_object* const prefetch, size_t* const num_done, size_t* const num_failed) {
+	assert(prefetch != NULL);
+
+	size_t done = 0u;
+	size_t failed = 0u;
+	for (size_t i = 0u; i < prefetch->num_requests; i++) {
+		// Prefetched data evicted after loading isn't reloaded, so prefetches
+		// beyond the budget still finish.
+		const data_load_status status = request_poll(prefetch->requests[i]);
+		if (status != DATA_LOAD_STATUS_PENDING) {
+			done++;
+			if (status != DATA_LOAD_STATUS_SUCCESS) {
+				failed++;
+			}
+		}
+	}
+
+	if (num_done != NULL) {
+		*num_done = done;
+	}
+	if (num_failed != NULL) {
+		*num_failed = failed;
+	}
+	return done == prefetch->num_requests;
+}
+
+void data_prefetch_destroy(data_prefetch_object* const prefetch) {
+	assert(prefetch != NULL);
+
+	for (size_t i = 0u; i < prefetch->num_requests; i++) {
+		data_request_release(prefetch->requests[i]);
+	}
+	mem_free(prefetch);
+}
+
+void data_cache_usage_get(data_cache_object* const cache, const data_type type, data_cache_usage* const usage) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+	assert(usage != NULL);
+
+	*usage = cache->usages[type];
+}
+
+void data_cache_budget_set(data_cache_object* const cache, const data_type type, const size_t cpu_budget, const size_t gpu_budget) {
+	assert(cache != NULL);
+	assert(type >= 0);
+	assert(type < DATA_TYPE_NUM);
+
+	cache->cpu_budgets[type] = cpu_budget;
+	cache->gpu_budgets[type] = gpu_budget;
+	evict(cache, type);
+}
+
+void data_cache_epoch_advance(data_cache_object* const cache) {
+	assert(cache != NULL);
+
+	cache->epoch++;
+}
+
+void data_cache_pin(const data_object* const data) {
+	assert(data != NULL);
+
+	((data_object*)data)->pins++;
+}
+
+void data_cache_unpin(const data_object* const data) {
+	assert(data != NULL);
+	assert(data->pins > 0u);
+
+	((data_object*)data)->pins--;
+}
+
+void data_cache_evict_func_set(data_cache_object* const cache, void (* const evict)(void* const evict_data, const data_object* const data), void* const evict_data) {
+	assert(cache != NULL);
+
+	cache->evict = evict;
+	cache->evict_data = evict_data;
+}
+
+void data_cache_raw_map_set(data_cache_object* const cache, const size_t map_size, const data_raw_advice advice) {
+	assert(cache != NULL);
+
+	cache->raw_map_size = map_size;
+	cache->raw_advice = advice;
+}
+
+void data_cache_raw_map_get(const data_cache_object* const cache, size_t* const map_size, data_raw_advice* const advice) {
+	assert(cache != NULL);
+	assert(map_size != NULL);
+	assert(advice != NULL);
+
+	*map_size = cache->raw_map_size;
+	*advice = cache->raw_advice;
+}
+
+void data_cache_texture_bake_set(data_cache_object* const cache, const bool enabled) {
+	assert(cache != NULL);
+
+	cache->texture_bake = enabled;
+}
+
+bool data_cache_texture_bake_get(const data_cache_object* const cache) {
+	assert(cache != NULL);
+
+	return cache->texture_bake;
+}
@@ -0,0 +1,209 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data.h"
+#include "data/private/data_private.h"
+#include "util/log.h"
+#include "util/str.h"
+#include "util/mem.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void atlas_free(data_atlas_object* const atlas) {
+	if (atlas->sheet_filenames != NULL) {
+		for (size_t i = 0u; i < atlas->num_sheets; i++) {
+			mem_free(atlas->sheet_filenames[i]);
+		}
+		mem_free(atlas->sheet_filenames);
+	}
+	if (atlas->sprites != NULL) {
+		for (size_t i = 0u; i < atlas->num_sprites; i++) {
+			mem_free(atlas->sprites[i].name);
+		}
+		mem_free(atlas->sprites);
+	}
+	mem_free(atlas);
+}
+
+static int sprite_compare(const void* const lhs, const void* const rhs) {
+	return strcmp(((const data_atlas_sprite*)lhs)->name, ((const data_atlas_sprite*)rhs)->name);
+}
+
+/*
+ * Parse the lines of the atlas, which are modified in place. Counting the
+ * lines first would need a pass of its own, so the arrays are grown instead.
+ */
+static bool lines_parse(data_atlas_object* const atlas, char* lines, const char* const directory) {
+	size_t sheets_size = 0u;
+	size_t sprites_size = 0u;
+	bool header = false;
+	while (*lines != '\0') {
+		char* const line = lines;
+		char* const end = line + strcspn(line, "\r\n");
+		lines = end + strspn(end, "\r\n");
+		*end = '\0';
+		if (*line == '\0') {
+			continue;
+		}
+
+		int version;
+		int name_offset = -1;
+		size_t sheet;
+		int x, y, w, h;
+		if (!header) {
+			if (
+				strncmp(line, DATA_ATLAS_MAGIC " ", sizeof(DATA_ATLAS_MAGIC)) != 0 ||
+				sscanf(line + sizeof(DATA_ATLAS_MAGIC), "%d", &version) != 1 ||
+				version != DATA_ATLAS_VERSION
+			) {
+				return false;
+			}
+			header = true;
+		}
+		else if (sscanf(line, "sheet %n", &name_offset) == 0 && name_offset > 0 && line[name_offset] != '\0') {
+			if (atlas->num_sheets == sheets_size) {
+				const size_t new_size = sheets_size > 0u ? sheets_size * 2u : 4u;
+				char** const new_sheet_filenames = mem_realloc(atlas->sheet_filenames, new_size * sizeof(char*));
+				if (new_sheet_filenames == NULL) {
+					return false;
+				}
+				atlas->sheet_filenames = new_sheet_filenames;
+				sheets_size = new_size;
+			}
+			atlas->sheet_filenames[atlas->num_sheets] = alloc_sprintf("%s%s", directory, line + name_offset);
+			if (atlas->sheet_filenames[atlas->num_sheets] == NULL) {
+				return false;
+			}
+			atlas->num_sheets++;
+		}
+		else if (
+			sscanf(line, "sprite %zu %d %d %d %d %n", &sheet, &x, &y, &w, &h, &name_offset) == 5 &&
+			name_offset > 0 && line[name_offset] != '\0' &&
+			sheet < atlas->num_sheets
+		) {
+			if (atlas->num_sprites == sprites_size) {
+				const size_t new_size = sprites_size > 0u ? sprites_size * 2u : 64u;
+				data_atlas_sprite* const new_sprites = mem_realloc(atlas->sprites, new_size * sizeof(data_atlas_sprite));
+				if (new_sprites == NULL) {
+					return false;
+				}
+				atlas->sprites = new_sprites;
+				sprites_size = new_size;
+			}
+			data_atlas_sprite* const sprite = &atlas->sprites[atlas->num_sprites];
+			sprite->name = alloc_sprintf("%s", line + name_offset);
+			if (sprite->name == NULL) {
+				return false;
+			}
+			sprite->sheet = sheet;
+			sprite->src[0] = (float)x;
+			sprite->src[1] = (float)y;
+			sprite->src[2] = (float)w;
+			sprite->src[3] = (float)h;
+			atlas->num_sprites++;
+		}
+		else {
+			return false;
+		}
+	}
+	return header;
+}
+
+static bool create(data_object* const data, SDL_RWops* const rwops) {
+	const Sint64 size = SDL_RWsize(rwops);
+	if (size <= 0 || (uint64_t)size >= SIZE_MAX) {
+		return false;
+	}
+
+	char* const lines = mem_malloc((size_t)size + 1u);
+	if (lines == NULL) {
+		return false;
+	}
+	const size_t read = SDL_RWread(rwops, lines, 1u, size);
+	if (read == 0u || read != (size_t)size) {
+		mem_free(lines);
+		return false;
+	}
+	lines[size] = '\0';
+
+	data_atlas_object* const atlas = mem_calloc(1u, sizeof(data_atlas_object));
+	char* const directory = data_directory_get(data);
+	if (atlas == NULL || directory == NULL) {
+		if (atlas != NULL) {
+			mem_free(atlas);
+		}
+		if (directory != NULL) {
+			mem_free(directory);
+		}
+		mem_free(lines);
+		return false;
+	}
+
+	const bool parsed = lines_parse(atlas, lines, directory);
+	mem_free(directory);
+	mem_free(lines);
+	if (!parsed) {
+		log_printf("Error parsing atlas \"%s\"\n", data->id.filename);
+		atlas_free(atlas);
+		return false;
+	}
+	if (atlas->num_sprites > 0u) {
+		qsort(atlas->sprites, atlas->num_sprites, sizeof(data_atlas_sprite), sprite_compare);
+	}
+
+	SDL_RWclose(rwops);
+
+	data->atlas = atlas;
+	return true;
+}
+
+static bool destroy(data_object* const data) {
+	atlas_free(data->atlas);
+	mem_free((void*)data->id.filename);
+	mem_free((void*)data);
+
+	return true;
+}
+
+/*
+ * Only the arrays are counted, not the names, so the CPU size is approximate.
+ */
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	*cpu_size =
+		sizeof(data_atlas_object) +
+		data->atlas->num_sheets * sizeof(char*) +
+		data->atlas->num_sprites * sizeof(data_atlas_sprite);
+	*gpu_size = 0u;
+}
+
+const data_atlas_sprite* data_atlas_sprite_get(const data_atlas_object* const atlas, const char* const name) {
+	if (atlas->num_sprites == 0u) {
+		return NULL;
+	}
+	const data_atlas_sprite key = { .name = (char*)name };
+	return bsearch(&key, atlas->sprites, atlas->num_sprites, sizeof(data_atlas_sprite), sprite_compare);
+}
+
+DATA_TYPE_MANAGER_DEFINITION(data_type_manager_atlas, create, destroy, size);
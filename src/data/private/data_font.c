@@ -23,93 +23,357 @@
  */
 
 #include "data/data.h"
+#include "data/private/data_private.h"
 #include "render/private/opengl.h"
 #include "util/str.h"
 #include "util/mem.h"
+#include "SDL_surface.h"
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
 
-static bool create(data_object* const data, SDL_RWops* const rwops) {
+/*
+ * A font decoded in any thread, with its pages' textures decoded, but not yet
+ * uploaded. The pages of distance field fonts are surfaces of the generated
+ * fields, while other fonts' pages are decoded textures.
+ */
+typedef struct font_decoded {
+	bool field;
+	font_object* font;
+	char** page_filenames;
+	void** pages;
+} font_decoded;
+
+static void discard(void* const decoded_data) {
+	font_decoded* const decoded = decoded_data;
+	if (decoded->font != NULL) {
+		for (size_t page = 0u; page < decoded->font->num_pages; page++) {
+			if (decoded->pages != NULL && decoded->pages[page] != NULL) {
+				if (decoded->field) {
+					SDL_FreeSurface(decoded->pages[page]);
+				}
+				else {
+					data_type_manager_texture.discard(decoded->pages[page]);
+				}
+			}
+			if (decoded->page_filenames != NULL) {
+				mem_free(decoded->page_filenames[page]);
+			}
+		}
+		font_destroy(decoded->font);
+	}
+	mem_free(decoded->pages);
+	mem_free(decoded->page_filenames);
+	mem_free(decoded);
+}
+
+#define FIELD_INF 1e20f
+
+/*
+ * Compute the squared Euclidean distance transform of the n samples of f into
+ * d, as in Felzenszwalb and Huttenlocher's "Distance Transforms of Sampled
+ * Functions". v and z are scratch arrays of n and n + 1 elements.
+ */
+static void field_transform(const float* const f, const size_t n, float* const d, size_t* const v, float* const z) {
+	size_t k = 0u;
+	v[0] = 0u;
+	z[0] = -FIELD_INF;
+	z[1] = FIELD_INF;
+	for (size_t q = 1u; q < n; q++) {
+		float s;
+		for (;;) {
+			const size_t r = v[k];
+			s = ((f[q] + (float)q * (float)q) - (f[r] + (float)r * (float)r)) / (2.0f * (float)q - 2.0f * (float)r);
+			if (s > z[k] || k == 0u) {
+				break;
+			}
+			k--;
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1u] = FIELD_INF;
+	}
+
+	k = 0u;
+	for (size_t q = 0u; q < n; q++) {
+		while (z[k + 1u] < (float)q) {
+			k++;
+		}
+		const float offset = (float)q - (float)v[k];
+		d[q] = offset * offset + f[v[k]];
+	}
+}
+
+/*
+ * Transform the grid of squared distances in place, first along columns, then
+ * along rows.
+ */
+static void field_transform_grid(float* const grid, const size_t width, const size_t height, float* const f, float* const d, size_t* const v, float* const z) {
+	for (size_t x = 0u; x < width; x++) {
+		for (size_t y = 0u; y < height; y++) {
+			f[y] = grid[y * width + x];
+		}
+		field_transform(f, height, d, v, z);
+		for (size_t y = 0u; y < height; y++) {
+			grid[y * width + x] = d[y];
+		}
+	}
+	for (size_t y = 0u; y < height; y++) {
+		memcpy(f, grid + y * width, sizeof(float) * width);
+		field_transform(f, width, grid + y * width, v, z);
+	}
+}
+
+/*
+ * Replace the page's pixels with a signed distance field of its glyphs, in
+ * the alpha channel of white pixels. Pixels at least half opaque are inside
+ * the glyphs, and the edges are halfway between inside and outside pixels.
+ */
+static bool field_generate(SDL_Surface* const surface) {
+	const size_t width = (size_t)surface->w;
+	const size_t height = (size_t)surface->h;
+	const size_t n = width > height ? width : height;
+	if (width == 0u || height == 0u) {
+		return true;
+	}
+
+	float* const outside = mem_malloc(sizeof(float) * width * height * 2u);
+	float* const scratch = mem_malloc(sizeof(float) * (n * 3u + 1u));
+	size_t* const v = mem_malloc(sizeof(size_t) * n);
+	if (outside == NULL || scratch == NULL || v == NULL) {
+		mem_free(outside);
+		mem_free(scratch);
+		mem_free(v);
+		return false;
+	}
+	float* const inside = outside + width * height;
+
+	unsigned char* const pixels = surface->pixels;
+	for (size_t y = 0u; y < height; y++) {
+		for (size_t x = 0u; x < width; x++) {
+			const bool is_inside = pixels[y * (size_t)surface->pitch + x * 4u + 3u] >= 128u;
+			outside[y * width + x] = is_inside ? 0.0f : FIELD_INF;
+			inside[y * width + x] = is_inside ? FIELD_INF : 0.0f;
+		}
+	}
+	field_transform_grid(outside, width, height, scratch, scratch + n, v, scratch + n * 2u);
+	field_transform_grid(inside, width, height, scratch, scratch + n, v, scratch + n * 2u);
+
+	for (size_t y = 0u; y < height; y++) {
+		for (size_t x = 0u; x < width; x++) {
+			const size_t i = y * width + x;
+			const float distance = inside[i] > 0.0f ?
+				sqrtf(inside[i]) - 0.5f :
+				0.5f - sqrtf(outside[i]);
+			float value = 0.5f + distance / DATA_FONT_SDF_RANGE;
+			value = value < 0.0f ? 0.0f : value > 1.0f ? 1.0f : value;
+
+			unsigned char* const pixel = pixels + y * (size_t)surface->pitch + x * 4u;
+			pixel[0] = 255u;
+			pixel[1] = 255u;
+			pixel[2] = 255u;
+			pixel[3] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+
+	mem_free(outside);
+	mem_free(scratch);
+	mem_free(v);
+	return true;
+}
+
+static void* font_decode(const data_object* const data, SDL_RWops* const rwops, const bool field) {
 	const Sint64 size = SDL_RWsize(rwops);
 	if (size <= 0) {
-		return false;
+		return NULL;
 	}
 
 	void* bytes = mem_malloc(size);
 	if (bytes == NULL) {
-		return false;
+		return NULL;
 	}
 
 	const size_t read = SDL_RWread(rwops, bytes, 1u, size);
 	if (read == 0u || read != size) {
 		mem_free(bytes);
-		return false;
-	}
-    
-    data_font_object* const font = (data_font_object*)mem_malloc(sizeof(data_font_object));
-	if (font == NULL) {
-		mem_free(bytes);
-		return false;
+		return NULL;
 	}
 
-	font->font = font_create(bytes, size);
-	if (font->font == NULL) {
-		mem_free(font);
+	font_decoded* const decoded = mem_calloc(1u, sizeof(font_decoded));
+	if (decoded == NULL) {
 		mem_free(bytes);
-		return false;
+		return NULL;
 	}
 
+	decoded->field = field;
+	decoded->font = font_create(bytes, size);
 	mem_free(bytes);
+	if (decoded->font == NULL) {
+		discard(decoded);
+		return NULL;
+	}
 
-    font->textures = (const data_object**)mem_malloc(font->font->num_pages * sizeof(data_object*));
-	if (font->textures == NULL) {
-		font_destroy(font->font);
-		mem_free(font);
-		return false;
+	decoded->page_filenames = mem_calloc(decoded->font->num_pages, sizeof(char*));
+	decoded->pages = mem_calloc(decoded->font->num_pages, sizeof(void*));
+	if (decoded->page_filenames == NULL || decoded->pages == NULL) {
+		discard(decoded);
+		return NULL;
 	}
 
 	char* const directory = data_directory_get(data);
 	if (directory == NULL) {
-		mem_free(font->textures);
-		font_destroy(font->font);
-		mem_free(font);
-		return false;
+		discard(decoded);
+		return NULL;
 	}
 
-	for (size_t page = 0u; page < font->font->num_pages; page++) {
-		char* const page_filename = alloc_sprintf("%s%s", directory, font->font->page_names[page]);
-		if (page_filename == NULL) {
-			for (size_t i = 0u; i < page; i++) {
-				data_unload(data->font->textures[page]);
-			}
+	for (size_t page = 0u; page < decoded->font->num_pages; page++) {
+		decoded->page_filenames[page] = alloc_sprintf("%s%s", directory, decoded->font->page_names[page]);
+		if (decoded->page_filenames[page] == NULL) {
 			mem_free(directory);
-			mem_free(font->textures);
-			font_destroy(font->font);
-			mem_free(font);
-			return false;
+			discard(decoded);
+			return NULL;
+		}
+
+		SDL_RWops* const page_rwops = data_file_open(data->cache, data->id.path, decoded->page_filenames[page]);
+		if (page_rwops == NULL) {
+			mem_free(directory);
+			discard(decoded);
+			return NULL;
+		}
+		decoded->pages[page] = field ?
+			(void*)data_texture_decode(page_rwops) :
+			data_type_manager_texture.decode(NULL, page_rwops);
+		SDL_RWclose(page_rwops);
+		if (decoded->pages[page] == NULL || (field && !field_generate(decoded->pages[page]))) {
+			mem_free(directory);
+			discard(decoded);
+			return NULL;
 		}
+	}
+	mem_free(directory);
+
+	return decoded;
+}
+
+static void* decode(const data_object* const data, SDL_RWops* const rwops) {
+	return font_decode(data, rwops, false);
+}
+
+static void* field_decode(const data_object* const data, SDL_RWops* const rwops) {
+	return font_decode(data, rwops, true);
+}
 
-		const data_object* const page_data = data_load(data->cache, DATA_TYPE_TEXTURE, data->id.path, page_filename, NULL);
-		mem_free(page_filename);
+/*
+ * Upload the distance field of a page into a linearly filtered texture, kept
+ * out of the texture array, as the array is sampled without filtering. Takes
+ * ownership of the surface.
+ */
+static const data_object* field_page_upload(data_object* const data, const char* const filename, SDL_Surface* const surface) {
+	GLuint name;
+	glGenTextures(1, &name);
+	if (opengl_error("Error from glGenTextures while loading a font: ")) {
+		SDL_FreeSurface(surface);
+		return NULL;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, name);
+	data_texture_parameters_set();
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / 4);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	const GLsizei width = surface->w;
+	const GLsizei height = surface->h;
+	SDL_FreeSurface(surface);
+	if (opengl_error("Error from glTexImage2D while loading a font: ")) {
+		glDeleteTextures(1, &name);
+		return NULL;
+	}
+	opengl_label(GL_TEXTURE, name, filename);
+
+	const data_object* const page = data_texture_create(data->cache, data->id.path, filename, name, width, height, (size_t)width * height * 4u);
+	if (page == NULL) {
+		glDeleteTextures(1, &name);
+		return NULL;
+	}
+	page->texture->array_layer = DATA_TEXTURE_ARRAY_EXCLUDED;
+	page->texture->distance_range = DATA_FONT_SDF_RANGE;
+	return page;
+}
 
-		if (page_data == NULL) {
+static bool upload(data_object* const data, void* const decoded_data) {
+	font_decoded* const decoded = decoded_data;
+	const size_t num_pages = decoded->font->num_pages;
+
+	data_font_object* const font = (data_font_object*)mem_malloc(sizeof(data_font_object));
+	if (font == NULL) {
+		discard(decoded);
+		return false;
+	}
+
+	font->textures = (const data_object**)mem_malloc(num_pages * sizeof(data_object*));
+	if (font->textures == NULL) {
+		mem_free(font);
+		discard(decoded);
+		return false;
+	}
+
+	for (size_t page = 0u; page < num_pages; page++) {
+		void* const page_decoded = decoded->pages[page];
+		decoded->pages[page] = NULL;
+		font->textures[page] = decoded->field ?
+			field_page_upload(data, decoded->page_filenames[page], page_decoded) :
+			data_decoded_load(data->cache, DATA_TYPE_TEXTURE, data->id.path, decoded->page_filenames[page], page_decoded);
+		if (font->textures[page] == NULL) {
 			for (size_t i = 0u; i < page; i++) {
-				data_unload(data->font->textures[page]);
+				data_unload(font->textures[i]);
 			}
-			mem_free(directory);
 			mem_free(font->textures);
-			font_destroy(font->font);
 			mem_free(font);
+			discard(decoded);
 			return false;
 		}
-		font->textures[page] = page_data;
 	}
-	mem_free(directory);
 
-	SDL_RWclose(rwops);
+	font->font = decoded->font;
+	decoded->font = NULL;
+	for (size_t page = 0u; page < num_pages; page++) {
+		mem_free(decoded->page_filenames[page]);
+	}
+	discard(decoded);
 
 	data->font = font;
 	return true;
 }
 
+static bool create(data_object* const data, SDL_RWops* const rwops) {
+	void* const decoded = decode(data, rwops);
+	if (decoded == NULL) {
+		return false;
+	}
+	if (!upload(data, decoded)) {
+		return false;
+	}
+
+	SDL_RWclose(rwops);
+	return true;
+}
+
+static bool field_create(data_object* const data, SDL_RWops* const rwops) {
+	void* const decoded = field_decode(data, rwops);
+	if (decoded == NULL) {
+		return false;
+	}
+	if (!upload(data, decoded)) {
+		return false;
+	}
+
+	SDL_RWclose(rwops);
+	return true;
+}
+
 static bool destroy(data_object* const data) {
 	for (size_t page = 0u; page < data->font->font->num_pages; page++) {
 		data_unload(data->font->textures[page]);
@@ -123,4 +387,21 @@ static bool destroy(data_object* const data) {
 	return status;
 }
 
-DATA_TYPE_MANAGER_DEFINITION(data_type_manager_font, create, destroy);
+/*
+ * Only the fixed-size parts of the font's tables are counted, so the CPU size
+ * is approximate. The pages' textures are owned by the font, so they're
+ * counted as part of the font.
+ */
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	*cpu_size = sizeof(data_font_object) + sizeof(font_object) + data->font->font->num_pages * sizeof(data_object*);
+	*gpu_size = 0u;
+	for (size_t page = 0u; page < data->font->font->num_pages; page++) {
+		size_t page_cpu_size, page_gpu_size;
+		data_type_manager_texture.size(data->font->textures[page], &page_cpu_size, &page_gpu_size);
+		*cpu_size += page_cpu_size;
+		*gpu_size += page_gpu_size;
+	}
+}
+
+DATA_TYPE_MANAGER_ASYNC_DEFINITION(data_type_manager_font, create, destroy, size, decode, upload, discard);
+DATA_TYPE_MANAGER_ASYNC_DEFINITION(data_type_manager_font_sdf, field_create, destroy, size, field_decode, upload, discard);
@@ -0,0 +1,171 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/private/data_private.h"
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+
+void* data_map(const char* const full_filename, size_t* const size, const data_raw_advice advice) {
+	const DWORD flags = advice == DATA_RAW_ADVICE_SEQUENTIAL ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_ATTRIBUTE_NORMAL;
+	const HANDLE file = CreateFileA(full_filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return NULL;
+	}
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0 || (uint64_t)file_size.QuadPart > SIZE_MAX) {
+		CloseHandle(file);
+		return NULL;
+	}
+	const HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0u, 0u, NULL);
+	CloseHandle(file);
+	if (mapping == NULL) {
+		return NULL;
+	}
+	void* const bytes = MapViewOfFile(mapping, FILE_MAP_COPY, 0u, 0u, (SIZE_T)file_size.QuadPart);
+	CloseHandle(mapping);
+	if (bytes == NULL) {
+		return NULL;
+	}
+
+#if defined(_WIN32_WINNT) && _WIN32_WINNT >= 0x0602
+	if (advice == DATA_RAW_ADVICE_WILLNEED) {
+		WIN32_MEMORY_RANGE_ENTRY range = { bytes, (SIZE_T)file_size.QuadPart };
+		(void)PrefetchVirtualMemory(GetCurrentProcess(), 1u, &range, 0u);
+	}
+#endif
+
+	*size = (size_t)file_size.QuadPart;
+	return bytes;
+}
+
+void data_unmap(void* const bytes, const size_t size) {
+	(void)size;
+	UnmapViewOfFile(bytes);
+}
+
+bool data_stat(const char* const full_filename, uint64_t* const size, int64_t* const mtime) {
+	WIN32_FILE_ATTRIBUTE_DATA info;
+	if (!GetFileAttributesExA(full_filename, GetFileExInfoStandard, &info) || (info.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		return false;
+	}
+	*size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+	*mtime = (int64_t)(((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime);
+	return true;
+}
+
+bool data_directory_create(const char* const full_path) {
+	return CreateDirectoryA(full_path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+}
+
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+
+void* data_map(const char* const full_filename, size_t* const size, const data_raw_advice advice) {
+	const int fd = open(full_filename, O_RDONLY);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size <= 0 || (uintmax_t)info.st_size > SIZE_MAX) {
+		close(fd);
+		return NULL;
+	}
+	void* const bytes = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (bytes == MAP_FAILED) {
+		return NULL;
+	}
+
+	if (advice == DATA_RAW_ADVICE_SEQUENTIAL) {
+		(void)posix_madvise(bytes, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+	}
+	else if (advice == DATA_RAW_ADVICE_WILLNEED) {
+		(void)posix_madvise(bytes, (size_t)info.st_size, POSIX_MADV_WILLNEED);
+	}
+
+	*size = (size_t)info.st_size;
+	return bytes;
+}
+
+void data_unmap(void* const bytes, const size_t size) {
+	munmap(bytes, size);
+}
+
+bool data_stat(const char* const full_filename, uint64_t* const size, int64_t* const mtime) {
+	struct stat info;
+	if (stat(full_filename, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size < 0) {
+		return false;
+	}
+	*size = (uint64_t)info.st_size;
+#if defined(__APPLE__)
+	*mtime = (int64_t)info.st_mtimespec.tv_sec * 1000000000 + info.st_mtimespec.tv_nsec;
+#else
+	*mtime = (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool data_directory_create(const char* const full_path) {
+	struct stat info;
+	return mkdir(full_path, 0755) == 0 || (errno == EEXIST && stat(full_path, &info) == 0 && S_ISDIR(info.st_mode));
+}
+
+#else
+void* data_map(const char* const full_filename, size_t* const size, const data_raw_advice advice) {
+	(void)full_filename;
+	(void)size;
+	(void)advice;
+	return NULL;
+}
+
+void data_unmap(void* const bytes, const size_t size) {
+	(void)bytes;
+	(void)size;
+}
+
+bool data_stat(const char* const full_filename, uint64_t* const size, int64_t* const mtime) {
+	(void)full_filename;
+	(void)size;
+	(void)mtime;
+	return false;
+}
+
+bool data_directory_create(const char* const full_path) {
+	(void)full_path;
+	return false;
+}
+
+#endif
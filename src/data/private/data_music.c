@@ -23,14 +23,26 @@
  */
 
 #include "data/data.h"
+#include "data/private/data_private.h"
 #include "util/mem.h"
 
 static bool create(data_object* const data, SDL_RWops* const rwops) {
+	// SDL_mixer streams music from rwops as it plays, in the audio device's
+	// thread, so files not already in memory are read ahead by a stream, to
+	// keep reads from storage out of the audio callback.
+	SDL_RWops* music_rwops = rwops;
+	if (rwops->type != SDL_RWOPS_MEMORY && rwops->type != SDL_RWOPS_MEMORY_RO) {
+		SDL_RWops* const stream = data_stream_open(rwops);
+		if (stream != NULL) {
+			music_rwops = stream;
+		}
+	}
+
 	// NOTE: SDL_mixer doesn't fully load in the data from rwops if freesrc is
 	// 0, it loads the data later when playback is requested; it does fully load
 	// if freesrc is 1, though. So, to force immediate loading, freesrc of 1 is
 	// used here.
-	data->music = Mix_LoadMUS_RW(rwops, 1);
+	data->music = Mix_LoadMUS_RW(music_rwops, 1);
 
 	return data->music != NULL;
 }
@@ -43,7 +55,16 @@ static bool destroy(data_object* const data) {
 	return true;
 }
 
+/*
+ * SDL_mixer's music objects are opaque, so the bytes they use aren't known.
+ */
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	(void)data;
+	*cpu_size = 0u;
+	*gpu_size = 0u;
+}
+
 static bool create(data_object* const data, SDL_RWops* const rwops);
 static bool destroy(data_object* const data);
 
-DATA_TYPE_MANAGER_DEFINITION(data_type_manager_music, create, destroy);
+DATA_TYPE_MANAGER_DEFINITION(data_type_manager_music, create, destroy, size);
@@ -0,0 +1,333 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/private/data_private.h"
+#include "data/private/data_pack_format.h"
+#include "util/lz4.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#ifdef PACK_ZSTD
+#include <zstd.h>
+#endif
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+
+struct data_pack_object {
+	uint8_t* bytes;
+	size_t size;
+
+	/*
+	 * Whether the pack is mapped, rather than read into memory, for platforms
+	 * without mapping support.
+	 */
+	bool mapped;
+
+	/*
+	 * The pack file's modification time when opened, shared by its files.
+	 */
+	int64_t mtime;
+
+	size_t num_entries;
+	const uint8_t* index;
+	const uint8_t* names;
+	size_t names_size;
+};
+
+typedef struct pack_entry {
+	uint64_t name_hash;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t stored_size;
+	uint32_t name_offset;
+	uint16_t name_size;
+	uint16_t compression;
+} pack_entry;
+
+static uint16_t read_u16(const uint8_t* const bytes) {
+	return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t* const bytes) {
+	return
+		(uint32_t)bytes[0] |
+		((uint32_t)bytes[1] << 8) |
+		((uint32_t)bytes[2] << 16) |
+		((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t read_u64(const uint8_t* const bytes) {
+	return (uint64_t)read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+static void entry_read(const data_pack_object* const pack, const size_t i, pack_entry* const entry) {
+	const uint8_t* const bytes = pack->index + i * DATA_PACK_ENTRY_SIZE;
+	entry->name_hash = read_u64(bytes);
+	entry->offset = read_u64(bytes + 8);
+	entry->size = read_u64(bytes + 16);
+	entry->stored_size = read_u64(bytes + 24);
+	entry->name_offset = read_u32(bytes + 32);
+	entry->name_size = read_u16(bytes + 36);
+	entry->compression = read_u16(bytes + 38);
+}
+
+static bool pack_validate(data_pack_object* const pack) {
+	if (pack->size < DATA_PACK_HEADER_SIZE || memcmp(pack->bytes, DATA_PACK_MAGIC, DATA_PACK_MAGIC_SIZE) != 0) {
+		log_printf("Error: Not a pack file\n");
+		return false;
+	}
+	if (read_u32(pack->bytes + 8) != DATA_PACK_VERSION) {
+		log_printf("Error: Unsupported pack version %u\n", (unsigned)read_u32(pack->bytes + 8));
+		return false;
+	}
+
+	const uint64_t num_entries = read_u32(pack->bytes + 12);
+	const uint64_t index_offset = read_u64(pack->bytes + 16);
+	const uint64_t names_offset = read_u64(pack->bytes + 24);
+	if (
+		index_offset > pack->size ||
+		num_entries > (pack->size - index_offset) / DATA_PACK_ENTRY_SIZE ||
+		names_offset > pack->size
+	) {
+		log_printf("Error: Invalid pack index\n");
+		return false;
+	}
+	pack->num_entries = (size_t)num_entries;
+	pack->index = pack->bytes + index_offset;
+	pack->names = pack->bytes + names_offset;
+	pack->names_size = pack->size - (size_t)names_offset;
+
+	/*
+	 * Every entry is validated up front, so lookups don't have to. Entries are
+	 * read through SDL_RWops, which only supports int sizes.
+	 */
+	for (size_t i = 0u; i < pack->num_entries; i++) {
+		pack_entry entry;
+		entry_read(pack, i, &entry);
+		if (
+			entry.offset > pack->size ||
+			entry.stored_size > pack->size - entry.offset ||
+			entry.name_offset > pack->names_size ||
+			entry.name_size > pack->names_size - entry.name_offset ||
+			entry.size == 0u ||
+			entry.size > INT_MAX ||
+			(entry.compression == DATA_PACK_COMPRESSION_NONE && entry.stored_size != entry.size)
+		) {
+			log_printf("Error: Invalid pack entry %zu\n", i);
+			return false;
+		}
+	}
+	return true;
+}
+
+data_pack_object* data_pack_open(const char* const full_filename) {
+	assert(full_filename != NULL);
+
+	data_pack_object* const pack = mem_malloc(sizeof(data_pack_object));
+	if (pack == NULL) {
+		return NULL;
+	}
+
+	pack->bytes = data_map(full_filename, &pack->size, DATA_RAW_ADVICE_NORMAL);
+	pack->mapped = pack->bytes != NULL;
+	if (!pack->mapped) {
+		SDL_RWops* const rwops = SDL_RWFromFile(full_filename, "rb");
+		if (rwops == NULL) {
+			mem_free(pack);
+			return NULL;
+		}
+		const Sint64 size = SDL_RWsize(rwops);
+		if (size <= 0 || (uint64_t)size > SIZE_MAX || (pack->bytes = mem_malloc((size_t)size)) == NULL) {
+			SDL_RWclose(rwops);
+			mem_free(pack);
+			return NULL;
+		}
+		pack->size = (size_t)size;
+		if (SDL_RWread(rwops, pack->bytes, 1u, pack->size) != pack->size) {
+			log_printf("Error reading the pack file \"%s\"\n", full_filename);
+			SDL_RWclose(rwops);
+			mem_free(pack->bytes);
+			mem_free(pack);
+			return NULL;
+		}
+		SDL_RWclose(rwops);
+	}
+
+	uint64_t file_size;
+	if (!data_stat(full_filename, &file_size, &pack->mtime)) {
+		pack->mtime = 0;
+	}
+
+	if (!pack_validate(pack)) {
+		log_printf("Error opening the pack file \"%s\"\n", full_filename);
+		data_pack_close(pack);
+		return NULL;
+	}
+	return pack;
+}
+
+void data_pack_close(data_pack_object* const pack) {
+	assert(pack != NULL);
+
+	if (pack->mapped) {
+		data_unmap(pack->bytes, pack->size);
+	}
+	else {
+		mem_free(pack->bytes);
+	}
+	mem_free(pack);
+}
+
+/*
+ * Binary search the index, ordered by (name hash, name). Returns false if the
+ * pack has no entry of the file.
+ */
+static bool entry_find(const data_pack_object* const pack, const char* const filename, pack_entry* const entry) {
+	const size_t filename_size = strlen(filename);
+	const uint64_t hash = data_pack_hash(filename, filename_size);
+
+	size_t low = 0u;
+	size_t high = pack->num_entries;
+	while (low < high) {
+		const size_t mid = low + (high - low) / 2u;
+		entry_read(pack, mid, entry);
+
+		int order;
+		if (entry->name_hash != hash) {
+			order = entry->name_hash < hash ? -1 : 1;
+		}
+		else {
+			const size_t common_size = entry->name_size < filename_size ? entry->name_size : filename_size;
+			order = memcmp(pack->names + entry->name_offset, filename, common_size);
+			if (order == 0 && entry->name_size != filename_size) {
+				order = entry->name_size < filename_size ? -1 : 1;
+			}
+		}
+
+		if (order == 0) {
+			return true;
+		}
+		else if (order < 0) {
+			low = mid + 1u;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return false;
+}
+
+bool data_pack_contains(const data_pack_object* const pack, const char* const filename) {
+	assert(pack != NULL);
+	assert(filename != NULL);
+
+	pack_entry entry;
+	return entry_find(pack, filename, &entry);
+}
+
+bool data_pack_file_stat(const data_pack_object* const pack, const char* const filename, uint64_t* const size, int64_t* const mtime) {
+	assert(pack != NULL);
+	assert(filename != NULL);
+	assert(size != NULL);
+	assert(mtime != NULL);
+
+	pack_entry entry;
+	if (!entry_find(pack, filename, &entry)) {
+		return false;
+	}
+	*size = entry.size;
+	*mtime = pack->mtime;
+	return true;
+}
+
+/*
+ * Decompressed files are read from memory owned by the rwops, freed along with
+ * it.
+ */
+static int SDLCALL owned_mem_close(SDL_RWops* const rwops) {
+	mem_free(rwops->hidden.mem.base);
+	SDL_FreeRW(rwops);
+	return 0;
+}
+
+SDL_RWops* data_pack_file_open(const data_pack_object* const pack, const char* const filename, data_load_status* const status) {
+	assert(pack != NULL);
+	assert(filename != NULL);
+	assert(status != NULL);
+
+	pack_entry entry;
+	if (!entry_find(pack, filename, &entry)) {
+		*status = DATA_LOAD_STATUS_MISSING;
+		return NULL;
+	}
+	*status = DATA_LOAD_STATUS_ERROR;
+
+	const uint8_t* const stored = pack->bytes + entry.offset;
+	if (entry.compression == DATA_PACK_COMPRESSION_NONE) {
+		SDL_RWops* const rwops = SDL_RWFromConstMem(stored, (int)entry.size);
+		if (rwops != NULL) {
+			*status = DATA_LOAD_STATUS_SUCCESS;
+		}
+		return rwops;
+	}
+
+	uint8_t* const bytes = mem_malloc((size_t)entry.size);
+	if (bytes == NULL) {
+		return NULL;
+	}
+	bool decompressed = false;
+	switch (entry.compression) {
+	case DATA_PACK_COMPRESSION_LZ4:
+		decompressed = lz4_decompress(stored, (size_t)entry.stored_size, bytes, (size_t)entry.size);
+		break;
+
+	case DATA_PACK_COMPRESSION_ZSTD:
+#ifdef PACK_ZSTD
+		decompressed = ZSTD_decompress(bytes, (size_t)entry.size, stored, (size_t)entry.stored_size) == (size_t)entry.size;
+#else
+		log_printf("Error: Zstd compressed pack entries aren't supported by this build\n");
+#endif
+		break;
+
+	default:
+		log_printf("Error: Unknown pack compression %u\n", (unsigned)entry.compression);
+		break;
+	}
+	if (!decompressed) {
+		log_printf("Error decompressing \"%s\" from a pack\n", filename);
+		mem_free(bytes);
+		return NULL;
+	}
+
+	SDL_RWops* const rwops = SDL_RWFromMem(bytes, (int)entry.size);
+	if (rwops == NULL) {
+		mem_free(bytes);
+		return NULL;
+	}
+	rwops->close = owned_mem_close;
+	*status = DATA_LOAD_STATUS_SUCCESS;
+	return rwops;
+}
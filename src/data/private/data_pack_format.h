@@ -0,0 +1,77 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * The format of pack files, shared by the data library and the packer tool.
+ * All integers are little endian.
+ *
+ * A pack starts with a header, followed by the entries' files, each starting
+ * at a multiple of DATA_PACK_ALIGNMENT bytes, then the index, sorted by
+ * (name hash, name) for binary searching, then the names, without
+ * terminators. Files are stored either as-is, or as a single compressed block.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DATA_PACK_MAGIC "DMFPACK"
+#define DATA_PACK_MAGIC_SIZE 8u
+#define DATA_PACK_VERSION 1u
+#define DATA_PACK_ALIGNMENT 4096u
+
+/*
+ * The header:
+ *     magic[8], version u32, num_entries u32, index_offset u64, names_offset u64
+ */
+#define DATA_PACK_HEADER_SIZE 32u
+
+/*
+ * Each entry of the index:
+ *     name_hash u64, offset u64, size u64, stored_size u64,
+ *     name_offset u32, name_size u16, compression u16
+ * name_offset is relative to names_offset; size is the file's size, and
+ * stored_size the size of the stored bytes, the same as size for uncompressed
+ * entries.
+ */
+#define DATA_PACK_ENTRY_SIZE 40u
+
+typedef enum data_pack_compression {
+	DATA_PACK_COMPRESSION_NONE,
+	DATA_PACK_COMPRESSION_LZ4,
+	DATA_PACK_COMPRESSION_ZSTD
+} data_pack_compression;
+
+/*
+ * The hash of entry names, 64-bit FNV-1a. Names are relative to the resource
+ * path, with forward slashes, exactly as passed to the data library.
+ */
+static inline uint64_t data_pack_hash(const char* const name, const size_t size) {
+	uint64_t hash = UINT64_C(0xCBF29CE484222325);
+	for (size_t i = 0u; i < size; i++) {
+		hash ^= (uint8_t)name[i];
+		hash *= UINT64_C(0x100000001B3);
+	}
+	return hash;
+}
@@ -0,0 +1,120 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data.h"
+
+/*
+ * Create uncached data of the file from a file decoded by the type's manager,
+ * in the cache's thread, always taking ownership of the decoded file. Returns
+ * NULL upon failure.
+ */
+const data_object* data_decoded_load(data_cache_object* const cache, const data_type type, const data_path path, const char* const filename, void* const decoded);
+
+/*
+ * Get the cache's raw data mapping settings, set with data_cache_raw_map_set.
+ */
+void data_cache_raw_map_get(const data_cache_object* const cache, size_t* const map_size, data_raw_advice* const advice);
+
+/*
+ * Map the whole file copy-on-write, with the access pattern hinted to the OS,
+ * setting size to the file's size. Returns NULL if the file can't be mapped,
+ * including on platforms without mapping support. Can be called in any thread.
+ */
+void* data_map(const char* const full_filename, size_t* const size, const data_raw_advice advice);
+
+void data_unmap(void* const bytes, const size_t size);
+
+/*
+ * Get the size and last modification time of the file, the time being in
+ * platform-specific units, only meaningful compared to other times from
+ * data_stat. Returns false if the file doesn't exist, or on platforms without
+ * support. Can be called in any thread.
+ */
+bool data_stat(const char* const full_filename, uint64_t* const size, int64_t* const mtime);
+
+/*
+ * Create the directory, if it doesn't already exist. Returns true if the
+ * directory exists afterward.
+ */
+bool data_directory_create(const char* const full_path);
+
+/*
+ * Open a stream reading from src, read ahead in a background thread, so reads
+ * from the stream rarely wait on storage. Closing the stream closes src. On
+ * failure, returns NULL, leaving src open. Can be called in any thread, and
+ * the stream can be read in any one thread at a time.
+ */
+SDL_RWops* data_stream_open(SDL_RWops* const src);
+
+/*
+ * Get the size and last modification time of the file, like data_stat. Files
+ * in mounted packs get their unpacked size and the time of the pack. Can be
+ * called in any thread.
+ */
+bool data_file_stat(data_cache_object* const cache, const data_path path, const char* const filename, uint64_t* const size, int64_t* const mtime);
+
+/*
+ * Returns true if the file is in a pack mounted in the cache, rather than a
+ * loose file. Can be called in any thread.
+ */
+bool data_file_packed(data_cache_object* const cache, const data_path path, const char* const filename);
+
+/*
+ * Pack files mounted in caches, mapped whole when opened. Packs are immutable
+ * once opened, so they can be read in any thread.
+ */
+typedef struct data_pack_object data_pack_object;
+
+/*
+ * Open the pack file, validating its header and index. Returns NULL upon
+ * failure, without logging if the file doesn't exist.
+ */
+data_pack_object* data_pack_open(const char* const full_filename);
+
+void data_pack_close(data_pack_object* const pack);
+
+/*
+ * Returns true if the pack has an entry of the file.
+ */
+bool data_pack_contains(const data_pack_object* const pack, const char* const filename);
+
+/*
+ * Open the file in the pack, decompressing it if it's compressed. Uncompressed
+ * files are read straight from the pack's mapping. Returns NULL upon failure,
+ * with a missing status if the pack has no entry of the file.
+ */
+SDL_RWops* data_pack_file_open(const data_pack_object* const pack, const char* const filename, data_load_status* const status);
+
+/*
+ * Get the size and last modification time of the file in the pack, the time
+ * being that of the pack. Returns false if the pack has no entry of the file.
+ */
+bool data_pack_file_stat(const data_pack_object* const pack, const char* const filename, uint64_t* const size, int64_t* const mtime);
+
+/*
+ * Get whether texture decodes are cached in the save path, set with
+ * data_cache_texture_bake_set.
+ */
+bool data_cache_texture_bake_get(const data_cache_object* const cache);
@@ -23,23 +23,79 @@
  */
 
 #include "data/data.h"
+#include "data/private/data_private.h"
 #include "util/mem.h"
 #include <stdlib.h>
 
+/*
+ * Read raw data's bytes follow the object, at the first 16-byte aligned offset.
+ */
+#define RAW_BYTES_OFFSET ((sizeof(data_raw_object) + 15u) & ~(size_t)15u)
+
+static bool map_create(data_object* const data, const size_t size) {
+	size_t map_size;
+	data_raw_advice advice;
+	data_cache_raw_map_get(data->cache, &map_size, &advice);
+	if (
+		size < map_size ||
+		(data->id.path != DATA_PATH_RESOURCE && data->id.path != DATA_PATH_SAVE) ||
+		data_file_packed(data->cache, data->id.path, data->id.filename)
+	) {
+		return false;
+	}
+
+	char* const full_filename = data_filename_get(data->cache, data->id.path, data->id.filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	size_t mapped_size;
+	void* const bytes = data_map(full_filename, &mapped_size, advice);
+	mem_free(full_filename);
+	if (bytes == NULL) {
+		return false;
+	}
+	else if (mapped_size != size) {
+		data_unmap(bytes, mapped_size);
+		return false;
+	}
+
+	data_raw_object* const raw = mem_malloc(sizeof(data_raw_object));
+	if (raw == NULL) {
+		data_unmap(bytes, size);
+		return false;
+	}
+	raw->size = size;
+	raw->bytes = bytes;
+	raw->mapped = true;
+
+	data->raw = raw;
+	return true;
+}
+
 static bool create(data_object* const data, SDL_RWops* const rwops) {
 	const Sint64 size = SDL_RWsize(rwops);
-	if (size <= 0) {
+	if (size <= 0 || (uint64_t)size > SIZE_MAX - RAW_BYTES_OFFSET) {
 		return false;
 	}
 
-	const size_t base_size = offsetof(data_raw_object, bytes) + size;
-	const size_t align = 16u - (base_size % 16u);
-    data_raw_object* const raw = (data_raw_object*)mem_aligned_alloc(16u, base_size + (align % 16u));
+	/*
+	 * Large files are mapped, so they're never copied, and are paged in and
+	 * out by the OS like any other file; mapping can fail, such as for files
+	 * on filesystems not supporting it, in which case the file is read.
+	 */
+	if (map_create(data, (size_t)size)) {
+		SDL_RWclose(rwops);
+		return true;
+	}
+
+	data_raw_object* const raw = (data_raw_object*)mem_aligned_alloc(16u, RAW_BYTES_OFFSET + (size_t)size);
 	if (raw == NULL) {
 		return false;
 	}
 
 	raw->size = size;
+	raw->bytes = (uint8_t*)raw + RAW_BYTES_OFFSET;
+	raw->mapped = false;
 
 	const size_t read = SDL_RWread(rwops, raw->bytes, 1u, size);
 	if (read == 0u || read != size) {
@@ -54,11 +110,26 @@ static bool create(data_object* const data, SDL_RWops* const rwops) {
 }
 
 static bool destroy(data_object* const data) {
-	mem_aligned_free((void*)data->raw);
+	if (data->raw->mapped) {
+		data_unmap(data->raw->bytes, data->raw->size);
+		mem_free((void*)data->raw);
+	}
+	else {
+		mem_aligned_free((void*)data->raw);
+	}
 	mem_free((void*)data->id.filename);
 	mem_free((void*)data);
 
 	return true;
 }
 
-DATA_TYPE_MANAGER_DEFINITION(data_type_manager_raw, create, destroy);
+/*
+ * Mapped bytes are in the OS's page cache rather than the heap, paged out as
+ * needed, so only the object itself is counted for them.
+ */
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	*cpu_size = data->raw->mapped ? sizeof(data_raw_object) : RAW_BYTES_OFFSET + data->raw->size;
+	*gpu_size = 0u;
+}
+
+DATA_TYPE_MANAGER_DEFINITION(data_type_manager_raw, create, destroy, size);
@@ -0,0 +1,305 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data_shared.h"
+#include "data/data.h"
+#include "util/dict.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * An entry's pointer is stable for as long as it's referenced, so threads hold
+ * onto entries, rather than looking them up again. An entry is listed in its
+ * shard while it's loading, so other threads acquiring the same data wait for
+ * the load; all access of the fields other than the key and the data is done
+ * with the shard locked.
+ */
+struct data_shared_entry {
+	size_t shard;
+	void* key;
+	size_t key_size;
+	const data_object* data;
+	size_t references;
+	bool loading;
+	data_load_status status;
+};
+
+typedef struct shard_object {
+	SDL_mutex* lock;
+
+	/*
+	 * Signaled when any of the shard's loads finishes.
+	 */
+	SDL_cond* loaded;
+
+	dict_object* entries;
+} shard_object;
+
+struct data_shared_object {
+	/*
+	 * Only used for data_load and data_unload, which only read the cache,
+	 * so they can be called in any thread; nothing is ever cached in it.
+	 */
+	data_cache_object* cache;
+
+	shard_object shards[DATA_SHARED_SHARDS];
+};
+
+bool data_shared_type_supported(const data_type type) {
+	switch (type) {
+	case DATA_TYPE_RAW:
+	case DATA_TYPE_SOUND:
+	case DATA_TYPE_ATLAS:
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+data_shared_object* data_shared_create(const char* const resource_path, const char* const save_path) {
+	data_shared_object* const shared = mem_calloc(1u, sizeof(data_shared_object));
+	if (shared == NULL) {
+		log_printf("Error allocating shared data cache\n");
+		return NULL;
+	}
+
+	shared->cache = data_cache_create(resource_path, save_path);
+	if (shared->cache == NULL) {
+		log_printf("Error creating the shared data cache's data cache\n");
+		mem_free(shared);
+		return NULL;
+	}
+
+	for (size_t i = 0u; i < DATA_SHARED_SHARDS; i++) {
+		shard_object* const shard = &shared->shards[i];
+		shard->lock = SDL_CreateMutex();
+		shard->loaded = SDL_CreateCond();
+		shard->entries = dict_create(1u);
+		if (shard->lock == NULL || shard->loaded == NULL || shard->entries == NULL) {
+			log_printf("Error creating shared data cache shard: %s\n", SDL_GetError());
+			data_shared_destroy(shared);
+			return NULL;
+		}
+	}
+
+	return shared;
+}
+
+/*
+ * Count the references of a shard's entries.
+ */
+static bool usage_count(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size) {
+	(void)key;
+	(void)key_size;
+	(void)value_size;
+	data_shared_usage* const usage = data;
+	const data_shared_entry* const entry = value;
+	usage->num_entries++;
+	usage->num_references += entry->references;
+	return true;
+}
+
+void data_shared_destroy(data_shared_object* const shared) {
+	assert(shared != NULL);
+
+	for (size_t i = 0u; i < DATA_SHARED_SHARDS; i++) {
+		shard_object* const shard = &shared->shards[i];
+		if (shard->entries != NULL) {
+			#ifndef NDEBUG
+			data_shared_usage usage = { 0 };
+			dict_map(shard->entries, &usage, usage_count);
+			assert(usage.num_entries == 0u);
+			#endif
+			dict_destroy(shard->entries);
+		}
+		if (shard->loaded != NULL) {
+			SDL_DestroyCond(shard->loaded);
+		}
+		if (shard->lock != NULL) {
+			SDL_DestroyMutex(shard->lock);
+		}
+	}
+
+	if (shared->cache != NULL) {
+		data_cache_destroy(shared->cache);
+	}
+	mem_free(shared);
+}
+
+/*
+ * Entries are owned by their references, not by the dictionaries listing them.
+ */
+static bool entry_unlist(void* const data) {
+	(void)data;
+	return true;
+}
+
+static void entry_free(data_shared_entry* const entry) {
+	mem_free(entry->key);
+	mem_free(entry);
+}
+
+/*
+ * FNV-1a of the key, choosing the entry's shard.
+ */
+static size_t shard_get(const void* const key, const size_t key_size) {
+	const uint8_t* const bytes = key;
+	uint32_t hash = UINT32_C(2166136261);
+	for (size_t i = 0u; i < key_size; i++) {
+		hash ^= bytes[i];
+		hash *= UINT32_C(16777619);
+	}
+	return hash % DATA_SHARED_SHARDS;
+}
+
+data_shared_entry* data_shared_acquire(data_shared_object* const shared, const data_type type, const data_path path, const char* const filename, data_load_status* const status) {
+	assert(shared != NULL);
+	assert(data_shared_type_supported(type));
+	assert(path >= 0);
+	assert(path < DATA_PATH_NUM);
+	assert(filename != NULL);
+	assert(status != NULL);
+
+	const size_t key_size = dict_tokey(NULL, 0u, 3u, &type, sizeof(type), &path, sizeof(path), filename, strlen(filename));
+	void* const key = mem_malloc(key_size);
+	if (key == NULL) {
+		log_printf("Error allocating shared data key\n");
+		*status = DATA_LOAD_STATUS_ERROR;
+		return NULL;
+	}
+	dict_tokey(key, key_size, 3u, &type, sizeof(type), &path, sizeof(path), filename, strlen(filename));
+
+	const size_t shard_index = shard_get(key, key_size);
+	shard_object* const shard = &shared->shards[shard_index];
+
+	SDL_LockMutex(shard->lock);
+	data_shared_entry* entry;
+	if (dict_get(shard->entries, key, key_size, (void**)&entry, NULL)) {
+		mem_free(key);
+		entry->references++;
+		while (entry->loading) {
+			SDL_CondWait(shard->loaded, shard->lock);
+		}
+		if (entry->data != NULL) {
+			SDL_UnlockMutex(shard->lock);
+			*status = DATA_LOAD_STATUS_SUCCESS;
+			return entry;
+		}
+
+		/*
+		 * The load failed, and the loader already unlisted the entry, so
+		 * the next acquire loads the data again.
+		 */
+		*status = entry->status;
+		if (--entry->references == 0u) {
+			entry_free(entry);
+		}
+		SDL_UnlockMutex(shard->lock);
+		return NULL;
+	}
+
+	entry = mem_calloc(1u, sizeof(data_shared_entry));
+	if (entry == NULL || !dict_set(shard->entries, key, key_size, entry, sizeof(data_shared_entry), entry_unlist, NULL)) {
+		SDL_UnlockMutex(shard->lock);
+		log_printf("Error adding shared data entry\n");
+		mem_free(entry);
+		mem_free(key);
+		*status = DATA_LOAD_STATUS_ERROR;
+		return NULL;
+	}
+	entry->shard = shard_index;
+	entry->key = key;
+	entry->key_size = key_size;
+	entry->references = 1u;
+	entry->loading = true;
+	SDL_UnlockMutex(shard->lock);
+
+	const data_object* const data = data_load(shared->cache, type, path, filename, status);
+
+	SDL_LockMutex(shard->lock);
+	entry->data = data;
+	entry->status = *status;
+	entry->loading = false;
+	if (data == NULL) {
+		dict_set(shard->entries, key, key_size, NULL, 0u, NULL, NULL);
+		if (--entry->references == 0u) {
+			entry_free(entry);
+		}
+		entry = NULL;
+	}
+	SDL_CondBroadcast(shard->loaded);
+	SDL_UnlockMutex(shard->lock);
+
+	return entry;
+}
+
+const data_object* data_shared_data_get(const data_shared_entry* const entry) {
+	assert(entry != NULL);
+	assert(entry->data != NULL);
+
+	return entry->data;
+}
+
+void data_shared_release(data_shared_object* const shared, data_shared_entry* const entry) {
+	assert(shared != NULL);
+	assert(entry != NULL);
+
+	shard_object* const shard = &shared->shards[entry->shard];
+	SDL_LockMutex(shard->lock);
+	assert(entry->references > 0u);
+	assert(!entry->loading);
+	const bool last = --entry->references == 0u;
+	if (last) {
+		dict_set(shard->entries, entry->key, entry->key_size, NULL, 0u, NULL, NULL);
+	}
+	SDL_UnlockMutex(shard->lock);
+
+	/*
+	 * Unlisted, so no other thread can reach the entry anymore, and the
+	 * data is unloaded without holding up the shard.
+	 */
+	if (last) {
+		data_unload(entry->data);
+		entry_free(entry);
+	}
+}
+
+void data_shared_usage_get(data_shared_object* const shared, data_shared_usage* const usage) {
+	assert(shared != NULL);
+	assert(usage != NULL);
+
+	usage->num_entries = 0u;
+	usage->num_references = 0u;
+	for (size_t i = 0u; i < DATA_SHARED_SHARDS; i++) {
+		shard_object* const shard = &shared->shards[i];
+		SDL_LockMutex(shard->lock);
+		dict_map(shard->entries, usage, usage_count);
+		SDL_UnlockMutex(shard->lock);
+	}
+}
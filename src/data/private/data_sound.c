@@ -26,6 +26,9 @@
 #include "util/mem.h"
 
 static bool create(data_object* const data, SDL_RWops* const rwops) {
+	// Sounds are decoded in full, and converted to the opened device's
+	// format, when they're loaded, so playing them never decodes or
+	// resamples.
 	Mix_Chunk* const sound = Mix_LoadWAV_RW(rwops, 1);
 	if (sound == NULL) {
 		return false;
@@ -44,7 +47,12 @@ static bool destroy(data_object* const data) {
 }
 
 
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	*cpu_size = sizeof(Mix_Chunk) + data->sound->alen;
+	*gpu_size = 0u;
+}
+
 static bool create(data_object* const data, SDL_RWops* const rwops);
 static bool destroy(data_object* const data);
 
-DATA_TYPE_MANAGER_DEFINITION(data_type_manager_sound, create, destroy);
+DATA_TYPE_MANAGER_DEFINITION(data_type_manager_sound, create, destroy, size);
@@ -0,0 +1,422 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/private/data_private.h"
+#include "util/private/threads.h"
+#include "util/mem.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+#include "SDL_atomic.h"
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Streams read ahead of their reader into a ring, filled by one read-ahead
+ * thread shared by all open streams, so reads only copy out of memory, unless
+ * the reader outpaces the read-ahead thread. The start of the file is kept in
+ * memory, as decoders return to it when looping.
+ */
+#define DATA_STREAM_RING_SIZE ((size_t)256u << 10)
+#define DATA_STREAM_HEAD_SIZE ((size_t)64u << 10)
+#define DATA_STREAM_CHUNK_SIZE ((size_t)32u << 10)
+
+typedef struct data_stream {
+	struct data_stream* next;
+
+	/*
+	 * The source is only used by the read-ahead thread after the stream is
+	 * opened.
+	 */
+	SDL_RWops* src;
+	Sint64 src_pos;
+	Sint64 size;
+
+	uint8_t* head;
+	size_t head_size;
+
+	/*
+	 * The ring holds filled bytes of the file starting at offset start, the
+	 * first at ring index first. The read-ahead thread only writes to the
+	 * ring outside of the filled bytes, and the reader only reads the filled
+	 * bytes, so the mutex only guards the fields, not the ring's bytes. The
+	 * generation changes when the reader seeks outside of the filled bytes,
+	 * so the read-ahead thread discards a read started before the seek.
+	 */
+	SDL_mutex* mutex;
+	SDL_cond* filled_cond;
+	uint8_t* ring;
+	Sint64 start;
+	size_t first;
+	size_t filled;
+	uint64_t generation;
+	bool error;
+
+	Sint64 pos;
+} data_stream;
+
+static SDL_SpinLock streams_lock = 0;
+static size_t num_streams = 0u;
+static SDL_mutex* streams_mutex = NULL;
+static data_stream* streams = NULL;
+static SDL_sem* streams_sem = NULL;
+static SDL_atomic_t streams_quit;
+static SDL_Thread* streams_thread = NULL;
+
+/*
+ * Fill the stream's ring with the next chunk of the file. Returns true if
+ * bytes were read.
+ */
+static bool stream_fill(data_stream* const stream) {
+	SDL_LockMutex(stream->mutex);
+	const Sint64 offset = stream->start + (Sint64)stream->filled;
+	if (stream->error || stream->filled == DATA_STREAM_RING_SIZE || offset >= stream->size) {
+		SDL_UnlockMutex(stream->mutex);
+		return false;
+	}
+	const size_t index = (stream->first + stream->filled) % DATA_STREAM_RING_SIZE;
+	size_t count = DATA_STREAM_RING_SIZE - stream->filled;
+	if (count > DATA_STREAM_RING_SIZE - index) {
+		count = DATA_STREAM_RING_SIZE - index;
+	}
+	if (count > DATA_STREAM_CHUNK_SIZE) {
+		count = DATA_STREAM_CHUNK_SIZE;
+	}
+	if ((Sint64)count > stream->size - offset) {
+		count = (size_t)(stream->size - offset);
+	}
+	const uint64_t generation = stream->generation;
+	SDL_UnlockMutex(stream->mutex);
+
+	size_t num_read = 0u;
+	if (stream->src_pos == offset || SDL_RWseek(stream->src, offset, RW_SEEK_SET) == offset) {
+		num_read = SDL_RWread(stream->src, stream->ring + index, 1u, count);
+		stream->src_pos = offset + (Sint64)num_read;
+	}
+	else {
+		stream->src_pos = -1;
+	}
+
+	SDL_LockMutex(stream->mutex);
+	if (generation == stream->generation) {
+		stream->filled += num_read;
+		if (num_read < count) {
+			stream->error = true;
+		}
+	}
+	SDL_CondBroadcast(stream->filled_cond);
+	SDL_UnlockMutex(stream->mutex);
+	return num_read > 0u;
+}
+
+static int SDLCALL streams_thread_func(void* const data) {
+	(void)data;
+
+	mem_tag_set(MEM_TAG_DATA);
+	threads_current_set(THREADS_CLASS_BACKGROUND);
+
+	while (!SDL_AtomicGet(&streams_quit)) {
+		bool filled = false;
+		SDL_LockMutex(streams_mutex);
+		for (data_stream* stream = streams; stream != NULL; stream = stream->next) {
+			filled = stream_fill(stream) || filled;
+		}
+		SDL_UnlockMutex(streams_mutex);
+
+		// Streams post the semaphore when there's room to fill, so the
+		// thread only waits once every stream is full.
+		if (!filled) {
+			SDL_SemWait(streams_sem);
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Move the filled bytes to start at offset, discarding the filled bytes if
+ * offset isn't in them. Called with the stream's mutex locked.
+ */
+static void stream_window_move(data_stream* const stream, const Sint64 offset) {
+	if (offset >= stream->start && offset <= stream->start + (Sint64)stream->filled) {
+		const size_t consumed = (size_t)(offset - stream->start);
+		stream->first = (stream->first + consumed) % DATA_STREAM_RING_SIZE;
+		stream->filled -= consumed;
+		stream->start = offset;
+	}
+	else {
+		stream->first = 0u;
+		stream->filled = 0u;
+		stream->start = offset;
+		stream->generation++;
+		stream->error = false;
+	}
+	SDL_SemPost(streams_sem);
+}
+
+static Sint64 SDLCALL stream_size(SDL_RWops* const rwops) {
+	const data_stream* const stream = rwops->hidden.unknown.data1;
+	return stream->size;
+}
+
+static Sint64 SDLCALL stream_seek(SDL_RWops* const rwops, const Sint64 offset, const int whence) {
+	data_stream* const stream = rwops->hidden.unknown.data1;
+
+	Sint64 pos;
+	switch (whence) {
+	case RW_SEEK_SET:
+		pos = offset;
+		break;
+
+	case RW_SEEK_CUR:
+		pos = stream->pos + offset;
+		break;
+
+	case RW_SEEK_END:
+		pos = stream->size + offset;
+		break;
+
+	default:
+		return SDL_SetError("Unknown seek whence %d", whence);
+	}
+	if (pos < 0) {
+		return SDL_SetError("Seek before the start of the stream");
+	}
+	stream->pos = pos;
+	return pos;
+}
+
+static size_t SDLCALL stream_read(SDL_RWops* const rwops, void* const ptr, const size_t size, const size_t maxnum) {
+	data_stream* const stream = rwops->hidden.unknown.data1;
+	if (size == 0u || maxnum == 0u || stream->pos >= stream->size) {
+		return 0u;
+	}
+
+	size_t total = size * maxnum;
+	if ((Sint64)total > stream->size - stream->pos) {
+		total = (size_t)(stream->size - stream->pos);
+	}
+	uint8_t* dst = ptr;
+	size_t num_read = 0u;
+
+	if (stream->pos < (Sint64)stream->head_size) {
+		size_t count = stream->head_size - (size_t)stream->pos;
+		if (count > total) {
+			count = total;
+		}
+		memcpy(dst, stream->head + stream->pos, count);
+		num_read += count;
+		stream->pos += (Sint64)count;
+	}
+
+	SDL_LockMutex(stream->mutex);
+	if (num_read < total) {
+		stream_window_move(stream, stream->pos);
+	}
+	else if (stream->start != (Sint64)stream->head_size && stream->pos < (Sint64)stream->head_size) {
+		// Reading from the head after seeking back to it, so the ring is
+		// refilled from the end of the head, ready for the read that leaves
+		// the head.
+		stream_window_move(stream, (Sint64)stream->head_size);
+	}
+	while (num_read < total) {
+		if (stream->filled == 0u) {
+			if (stream->error) {
+				break;
+			}
+			SDL_CondWait(stream->filled_cond, stream->mutex);
+			continue;
+		}
+
+		size_t count = stream->filled;
+		if (count > DATA_STREAM_RING_SIZE - stream->first) {
+			count = DATA_STREAM_RING_SIZE - stream->first;
+		}
+		if (count > total - num_read) {
+			count = total - num_read;
+		}
+		memcpy(dst + num_read, stream->ring + stream->first, count);
+		num_read += count;
+		stream->pos += (Sint64)count;
+		stream_window_move(stream, stream->pos);
+	}
+	SDL_UnlockMutex(stream->mutex);
+
+	return num_read / size;
+}
+
+static size_t SDLCALL stream_write(SDL_RWops* const rwops, const void* const ptr, const size_t size, const size_t num) {
+	(void)rwops;
+	(void)ptr;
+	(void)size;
+	(void)num;
+	SDL_SetError("Streams are read-only");
+	return 0u;
+}
+
+static void streams_release() {
+	SDL_AtomicLock(&streams_lock);
+	assert(num_streams > 0u);
+	if (--num_streams == 0u) {
+		SDL_AtomicSet(&streams_quit, 1);
+		SDL_SemPost(streams_sem);
+		SDL_WaitThread(streams_thread, NULL);
+		streams_thread = NULL;
+		SDL_DestroySemaphore(streams_sem);
+		streams_sem = NULL;
+		SDL_DestroyMutex(streams_mutex);
+		streams_mutex = NULL;
+	}
+	SDL_AtomicUnlock(&streams_lock);
+}
+
+/*
+ * Start the read-ahead thread for the first stream opened. Returns false if
+ * the thread couldn't be started.
+ */
+static bool streams_acquire() {
+	SDL_AtomicLock(&streams_lock);
+	if (num_streams == 0u) {
+		streams_mutex = SDL_CreateMutex();
+		streams_sem = SDL_CreateSemaphore(0u);
+		SDL_AtomicSet(&streams_quit, 0);
+		if (streams_mutex != NULL && streams_sem != NULL) {
+			streams_thread = SDL_CreateThread(streams_thread_func, "data_stream_thread", NULL);
+		}
+		if (streams_thread == NULL) {
+			if (streams_sem != NULL) {
+				SDL_DestroySemaphore(streams_sem);
+				streams_sem = NULL;
+			}
+			if (streams_mutex != NULL) {
+				SDL_DestroyMutex(streams_mutex);
+				streams_mutex = NULL;
+			}
+			SDL_AtomicUnlock(&streams_lock);
+			return false;
+		}
+	}
+	num_streams++;
+	SDL_AtomicUnlock(&streams_lock);
+	return true;
+}
+
+static void stream_destroy(data_stream* const stream) {
+	if (stream->filled_cond != NULL) {
+		SDL_DestroyCond(stream->filled_cond);
+	}
+	if (stream->mutex != NULL) {
+		SDL_DestroyMutex(stream->mutex);
+	}
+	if (stream->ring != NULL) {
+		mem_free(stream->ring);
+	}
+	if (stream->head != NULL) {
+		mem_free(stream->head);
+	}
+	mem_free(stream);
+}
+
+static int SDLCALL stream_close(SDL_RWops* const rwops) {
+	data_stream* const stream = rwops->hidden.unknown.data1;
+
+	// Holding the streams mutex keeps the read-ahead thread from using
+	// the stream while it's removed.
+	SDL_LockMutex(streams_mutex);
+	for (data_stream** link = &streams; *link != NULL; link = &(*link)->next) {
+		if (*link == stream) {
+			*link = stream->next;
+			break;
+		}
+	}
+	SDL_UnlockMutex(streams_mutex);
+	streams_release();
+
+	const int status = SDL_RWclose(stream->src);
+	stream_destroy(stream);
+	SDL_FreeRW(rwops);
+	return status;
+}
+
+SDL_RWops* data_stream_open(SDL_RWops* const src) {
+	assert(src != NULL);
+
+	const Sint64 size = SDL_RWsize(src);
+	if (size < 0) {
+		return NULL;
+	}
+
+	data_stream* const stream = mem_calloc(1u, sizeof(data_stream));
+	if (stream == NULL) {
+		return NULL;
+	}
+	stream->src = src;
+	stream->size = size;
+	stream->head_size = (Sint64)DATA_STREAM_HEAD_SIZE < size ? DATA_STREAM_HEAD_SIZE : (size_t)size;
+	stream->head = mem_malloc(stream->head_size > 0u ? stream->head_size : 1u);
+	stream->ring = mem_malloc(DATA_STREAM_RING_SIZE);
+	stream->mutex = SDL_CreateMutex();
+	stream->filled_cond = SDL_CreateCond();
+	if (stream->head == NULL || stream->ring == NULL || stream->mutex == NULL || stream->filled_cond == NULL) {
+		stream_destroy(stream);
+		return NULL;
+	}
+
+	// The head is read in the opening thread, as decoders read the start of
+	// the file right away.
+	if (
+		SDL_RWseek(src, 0, RW_SEEK_SET) != 0 ||
+		SDL_RWread(src, stream->head, 1u, stream->head_size) != stream->head_size
+	) {
+		stream_destroy(stream);
+		return NULL;
+	}
+	stream->src_pos = (Sint64)stream->head_size;
+	stream->start = (Sint64)stream->head_size;
+
+	SDL_RWops* const rwops = SDL_AllocRW();
+	if (rwops == NULL) {
+		stream_destroy(stream);
+		return NULL;
+	}
+	rwops->size = stream_size;
+	rwops->seek = stream_seek;
+	rwops->read = stream_read;
+	rwops->write = stream_write;
+	rwops->close = stream_close;
+	rwops->type = SDL_RWOPS_UNKNOWN;
+	rwops->hidden.unknown.data1 = stream;
+
+	if (!streams_acquire()) {
+		SDL_FreeRW(rwops);
+		stream_destroy(stream);
+		return NULL;
+	}
+	SDL_LockMutex(streams_mutex);
+	stream->next = streams;
+	streams = stream;
+	SDL_UnlockMutex(streams_mutex);
+	SDL_SemPost(streams_sem);
+
+	return rwops;
+}
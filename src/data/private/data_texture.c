@@ -22,57 +22,391 @@
  * SOFTWARE.
  */
 
-#include "data/data_types.h"
+#include "data/data.h"
 #include "util/log.h"
 #include "util/mem.h"
 #include "SDL_image.h"
 #include "SDL_surface.h"
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
 
-static bool create(data_object* const data, SDL_RWops* const rwops) {
-	data->texture = mem_calloc(1u, sizeof(data_texture_object));
-	if (data->texture == NULL) {
-		log_printf("Error allocating data while loading a texture\n");
-		return false;
-	}
-
+SDL_Surface* data_texture_decode(SDL_RWops* const rwops) {
 	SDL_Surface* surface = IMG_Load_RW(rwops, 0);
 	if (surface == NULL) {
-		return false;
+		return NULL;
 	}
 
 	if (surface->format->format != SDL_PIXELFORMAT_RGBA32) {
 		SDL_Surface* const old_surface = surface;
 		surface = SDL_ConvertSurfaceFormat(old_surface, SDL_PIXELFORMAT_RGBA32, 0);
 		SDL_FreeSurface(old_surface);
-		if (surface == NULL) {
-			return false;
+	}
+
+	return surface;
+}
+
+void data_texture_parameters_set() {
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+}
+
+/*
+ * KTX2 files are uploaded as-is in their block compressed formats, without
+ * decoding them, when the GPU supports the format. Otherwise, they're decoded
+ * on the CPU, if there's a decoder for the format. sRGB formats are treated as
+ * their UNORM counterparts, the same as images loaded with SDL_image. Only the
+ * base level is used, as sheets are sampled without mipmaps.
+ */
+static const unsigned char ktx2_identifier[12] = { 0xABu, 'K', 'T', 'X', ' ', '2', '0', 0xBBu, '\r', '\n', 0x1Au, '\n' };
+#define KTX2_HEADER_SIZE 80u
+#define KTX2_LEVEL_SIZE 24u
+
+typedef void (* ktx2_decode_func)(const unsigned char* const blocks, const uint32_t width, const uint32_t height, unsigned char* const pixels);
+
+static void bc3_decode(const unsigned char* const blocks, const uint32_t width, const uint32_t height, unsigned char* const pixels);
+
+typedef struct ktx2_format {
+	uint32_t vk_format;
+	GLenum internal_format;
+
+	/*
+	 * The extension required for the format, or OPENGL_EXTENSION_NUM if the
+	 * format is uncompressed.
+	 */
+	opengl_extension_type extension;
+
+	/*
+	 * Decoder used when the extension isn't supported; NULL if there's none.
+	 */
+	ktx2_decode_func decode;
+} ktx2_format;
+
+static const ktx2_format ktx2_formats[] = {
+	{ 37u, GL_RGBA8, OPENGL_EXTENSION_NUM, NULL }, // VK_FORMAT_R8G8B8A8_UNORM
+	{ 43u, GL_RGBA8, OPENGL_EXTENSION_NUM, NULL }, // VK_FORMAT_R8G8B8A8_SRGB
+	{ 137u, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, OPENGL_EXTENSION_TEXTURE_COMPRESSION_S3TC, bc3_decode }, // VK_FORMAT_BC3_UNORM_BLOCK
+	{ 138u, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, OPENGL_EXTENSION_TEXTURE_COMPRESSION_S3TC, bc3_decode }, // VK_FORMAT_BC3_SRGB_BLOCK
+	{ 145u, GL_COMPRESSED_RGBA_BPTC_UNORM, OPENGL_EXTENSION_TEXTURE_COMPRESSION_BPTC, NULL }, // VK_FORMAT_BC7_UNORM_BLOCK
+	{ 146u, GL_COMPRESSED_RGBA_BPTC_UNORM, OPENGL_EXTENSION_TEXTURE_COMPRESSION_BPTC, NULL }, // VK_FORMAT_BC7_SRGB_BLOCK
+	{ 151u, GL_COMPRESSED_RGBA8_ETC2_EAC, OPENGL_EXTENSION_TEXTURE_COMPRESSION_ETC2, NULL }, // VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK
+	{ 152u, GL_COMPRESSED_RGBA8_ETC2_EAC, OPENGL_EXTENSION_TEXTURE_COMPRESSION_ETC2, NULL }, // VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK
+	{ 157u, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, OPENGL_EXTENSION_TEXTURE_COMPRESSION_ASTC, NULL }, // VK_FORMAT_ASTC_4x4_UNORM_BLOCK
+	{ 158u, GL_COMPRESSED_RGBA_ASTC_4x4_KHR, OPENGL_EXTENSION_TEXTURE_COMPRESSION_ASTC, NULL } // VK_FORMAT_ASTC_4x4_SRGB_BLOCK
+};
+
+static uint32_t read_u32(const unsigned char* const bytes) {
+	return
+		(uint32_t)bytes[0] |
+		((uint32_t)bytes[1] << 8) |
+		((uint32_t)bytes[2] << 16) |
+		((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t read_u64(const unsigned char* const bytes) {
+	return (uint64_t)read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+/*
+ * Decode BC3 (DXT5) blocks into RGBA8 pixels.
+ */
+static void bc3_decode(const unsigned char* const blocks, const uint32_t width, const uint32_t height, unsigned char* const pixels) {
+	const uint32_t blocks_x = (width + 3u) / 4u;
+	const uint32_t blocks_y = (height + 3u) / 4u;
+	for (uint32_t block_y = 0u; block_y < blocks_y; block_y++) {
+		for (uint32_t block_x = 0u; block_x < blocks_x; block_x++) {
+			const unsigned char* const block = blocks + ((size_t)block_y * blocks_x + block_x) * 16u;
+
+			unsigned alphas[8];
+			alphas[0] = block[0];
+			alphas[1] = block[1];
+			if (alphas[0] > alphas[1]) {
+				for (unsigned i = 1u; i <= 6u; i++) {
+					alphas[1u + i] = ((7u - i) * alphas[0] + i * alphas[1]) / 7u;
+				}
+			}
+			else {
+				for (unsigned i = 1u; i <= 4u; i++) {
+					alphas[1u + i] = ((5u - i) * alphas[0] + i * alphas[1]) / 5u;
+				}
+				alphas[6] = 0u;
+				alphas[7] = 255u;
+			}
+			const uint64_t alpha_bits = read_u64(block) >> 16;
+
+			unsigned colors[4][3];
+			for (unsigned i = 0u; i < 2u; i++) {
+				const unsigned color = block[8u + i * 2u] | ((unsigned)block[9u + i * 2u] << 8);
+				const unsigned red = (color >> 11) & 0x1Fu;
+				const unsigned green = (color >> 5) & 0x3Fu;
+				const unsigned blue = color & 0x1Fu;
+				colors[i][0] = (red << 3) | (red >> 2);
+				colors[i][1] = (green << 2) | (green >> 4);
+				colors[i][2] = (blue << 3) | (blue >> 2);
+			}
+			for (unsigned channel = 0u; channel < 3u; channel++) {
+				colors[2][channel] = (2u * colors[0][channel] + colors[1][channel]) / 3u;
+				colors[3][channel] = (colors[0][channel] + 2u * colors[1][channel]) / 3u;
+			}
+			const uint32_t color_bits = read_u32(block + 12);
+
+			for (uint32_t y = 0u; y < 4u; y++) {
+				for (uint32_t x = 0u; x < 4u; x++) {
+					const uint32_t pixel_x = block_x * 4u + x;
+					const uint32_t pixel_y = block_y * 4u + y;
+					if (pixel_x >= width || pixel_y >= height) {
+						continue;
+					}
+
+					const unsigned i = y * 4u + x;
+					const unsigned* const color = colors[(color_bits >> (i * 2u)) & 0x3u];
+					unsigned char* const pixel = pixels + ((size_t)pixel_y * width + pixel_x) * 4u;
+					pixel[0] = (unsigned char)color[0];
+					pixel[1] = (unsigned char)color[1];
+					pixel[2] = (unsigned char)color[2];
+					pixel[3] = (unsigned char)alphas[(alpha_bits >> (i * 3u)) & 0x7u];
+				}
+			}
 		}
 	}
-	
+}
+
+bool data_texture_is_ktx2(const void* const bytes, const size_t size) {
+	return size >= sizeof(ktx2_identifier) && memcmp(bytes, ktx2_identifier, sizeof(ktx2_identifier)) == 0;
+}
+
+GLuint data_texture_ktx2_upload(const void* const bytes, const size_t size, GLsizei* const width, GLsizei* const height, size_t* const gpu_size) {
+	assert(bytes != NULL);
+	assert(width != NULL);
+	assert(height != NULL);
+	assert(gpu_size != NULL);
+
+	const unsigned char* const file = bytes;
+	if (!data_texture_is_ktx2(bytes, size) || size < KTX2_HEADER_SIZE + KTX2_LEVEL_SIZE) {
+		log_printf("Error: Invalid KTX2 file\n");
+		return 0u;
+	}
+
+	const uint32_t vk_format = read_u32(file + 12);
+	const uint32_t pixel_width = read_u32(file + 20);
+	const uint32_t pixel_height = read_u32(file + 24);
+	const uint32_t pixel_depth = read_u32(file + 28);
+	const uint32_t layer_count = read_u32(file + 32);
+	const uint32_t face_count = read_u32(file + 36);
+	const uint32_t supercompression_scheme = read_u32(file + 44);
+	if (
+		pixel_width == 0u || pixel_width > INT32_MAX ||
+		pixel_height == 0u || pixel_height > INT32_MAX ||
+		pixel_depth != 0u ||
+		layer_count > 1u ||
+		face_count != 1u ||
+		supercompression_scheme != 0u
+	) {
+		log_printf("Error: Unsupported KTX2 file; only 2D textures without supercompression are supported\n");
+		return 0u;
+	}
+
+	const ktx2_format* format = NULL;
+	for (size_t i = 0u; i < lengthof(ktx2_formats); i++) {
+		if (ktx2_formats[i].vk_format == vk_format) {
+			format = &ktx2_formats[i];
+			break;
+		}
+	}
+	if (format == NULL) {
+		log_printf("Error: Unsupported KTX2 format %u\n", (unsigned)vk_format);
+		return 0u;
+	}
+
+	const uint64_t level_offset = read_u64(file + KTX2_HEADER_SIZE);
+	const uint64_t level_length = read_u64(file + KTX2_HEADER_SIZE + 8u);
+	const bool compressed = format->extension != OPENGL_EXTENSION_NUM;
+	const uint64_t expected_length = compressed ?
+		(uint64_t)((pixel_width + 3u) / 4u) * ((pixel_height + 3u) / 4u) * 16u :
+		(uint64_t)pixel_width * pixel_height * 4u;
+	if (level_offset > size || level_length > size - level_offset || level_length < expected_length) {
+		log_printf("Error: Invalid KTX2 file\n");
+		return 0u;
+	}
+	const unsigned char* const level = file + level_offset;
+
 	GLuint name;
 	glGenTextures(1, &name);
 	if (opengl_error("Error from glGenTextures while loading a texture: ")) {
-		SDL_FreeSurface(surface);
-		return false;
+		return 0u;
 	}
-
 	glBindTexture(GL_TEXTURE_2D, name);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
-	if (opengl_error("Error from glTexImage2D while loading a texture: ")) {
-		SDL_FreeSurface(surface);
+	data_texture_parameters_set();
+
+	*gpu_size = (size_t)pixel_width * pixel_height * 4u;
+	if (!compressed) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei)pixel_width, (GLsizei)pixel_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+	}
+	else if (opengl_extension_supported(format->extension)) {
+		glCompressedTexImage2D(GL_TEXTURE_2D, 0, format->internal_format, (GLsizei)pixel_width, (GLsizei)pixel_height, 0, (GLsizei)expected_length, level);
+		*gpu_size = (size_t)expected_length;
+	}
+	else if (format->decode != NULL) {
+		unsigned char* const pixels = mem_malloc((size_t)pixel_width * pixel_height * 4u);
+		if (pixels == NULL) {
+			glDeleteTextures(1, &name);
+			return 0u;
+		}
+		format->decode(level, pixel_width, pixel_height, pixels);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, (GLsizei)pixel_width, (GLsizei)pixel_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		mem_free(pixels);
+	}
+	else {
+		log_printf("Error: KTX2 format %u isn't supported by the GPU, and can't be decoded\n", (unsigned)vk_format);
+		glDeleteTextures(1, &name);
+		return 0u;
+	}
+	if (opengl_error("Error uploading a KTX2 texture: ")) {
 		glDeleteTextures(1, &name);
+		return 0u;
+	}
+
+	*width = (GLsizei)pixel_width;
+	*height = (GLsizei)pixel_height;
+	return name;
+}
+
+/*
+ * A texture decoded in any thread, either a surface, or a whole KTX2 file.
+ */
+typedef struct texture_decoded {
+	SDL_Surface* surface;
+	unsigned char* ktx2_bytes;
+	size_t ktx2_size;
+} texture_decoded;
+
+static bool ktx2_read(texture_decoded* const decoded, SDL_RWops* const rwops, const Sint64 start) {
+	const Sint64 end = SDL_RWseek(rwops, 0, RW_SEEK_END);
+	if (end < start || SDL_RWseek(rwops, start, RW_SEEK_SET) < 0) {
 		return false;
 	}
+	const size_t size = (size_t)(end - start);
 
-	SDL_RWclose(rwops);
+	unsigned char* const bytes = mem_malloc(size);
+	if (bytes == NULL) {
+		return false;
+	}
+	if (SDL_RWread(rwops, bytes, 1u, size) != size) {
+		mem_free(bytes);
+		return false;
+	}
+
+	decoded->ktx2_bytes = bytes;
+	decoded->ktx2_size = size;
+	return true;
+}
+
+static void* decode(const data_object* const data, SDL_RWops* const rwops) {
+	texture_decoded* const decoded = mem_calloc(1u, sizeof(texture_decoded));
+	if (decoded == NULL) {
+		log_printf("Error allocating data while loading a texture\n");
+		return NULL;
+	}
+
+	const Sint64 start = SDL_RWtell(rwops);
+	unsigned char identifier[sizeof(ktx2_identifier)];
+	if (start >= 0 && SDL_RWread(rwops, identifier, 1u, sizeof(identifier)) == sizeof(identifier) && data_texture_is_ktx2(identifier, sizeof(identifier))) {
+		if (!ktx2_read(decoded, rwops, start)) {
+			mem_free(decoded);
+			return NULL;
+		}
+		return decoded;
+	}
+	if (start < 0 || SDL_RWseek(rwops, start, RW_SEEK_SET) < 0) {
+		mem_free(decoded);
+		return NULL;
+	}
+
+	decoded->surface = data_texture_decode_cached(data->cache, data->id.path, data->id.filename, rwops);
+	if (decoded->surface == NULL) {
+		mem_free(decoded);
+		return NULL;
+	}
+	return decoded;
+}
+
+static void discard(void* const decoded_data) {
+	texture_decoded* const decoded = decoded_data;
+	if (decoded->surface != NULL) {
+		SDL_FreeSurface(decoded->surface);
+	}
+	mem_free(decoded->ktx2_bytes);
+	mem_free(decoded);
+}
+
+static bool upload(data_object* const data, void* const decoded_data) {
+	texture_decoded* const decoded = decoded_data;
+
+	data->texture = mem_calloc(1u, sizeof(data_texture_object));
+	if (data->texture == NULL) {
+		log_printf("Error allocating data while loading a texture\n");
+		discard(decoded);
+		return false;
+	}
+
+	GLuint name;
+	GLsizei width, height;
+	size_t gpu_size;
+	if (decoded->ktx2_bytes != NULL) {
+		name = data_texture_ktx2_upload(decoded->ktx2_bytes, decoded->ktx2_size, &width, &height, &gpu_size);
+		if (name == 0u) {
+			discard(decoded);
+			mem_free(data->texture);
+			return false;
+		}
+	}
+	else {
+		SDL_Surface* const surface = decoded->surface;
+		glGenTextures(1, &name);
+		if (opengl_error("Error from glGenTextures while loading a texture: ")) {
+			discard(decoded);
+			mem_free(data->texture);
+			return false;
+		}
+
+		glBindTexture(GL_TEXTURE_2D, name);
+		data_texture_parameters_set();
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, surface->pitch / 4);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, surface->w, surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, surface->pixels);
+		glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+		if (opengl_error("Error from glTexImage2D while loading a texture: ")) {
+			discard(decoded);
+			glDeleteTextures(1, &name);
+			mem_free(data->texture);
+			return false;
+		}
+		width = surface->w;
+		height = surface->h;
+		gpu_size = (size_t)surface->w * surface->h * 4u;
+	}
+	discard(decoded);
+	opengl_label(GL_TEXTURE, name, data->id.filename);
 
 	data->texture->name = name;
-	data->texture->width = surface->w;
-	data->texture->height = surface->h;
+	data->texture->width = width;
+	data->texture->height = height;
+	data->texture->array_layer = -1;
+	data->texture->gpu_size = gpu_size;
+	return true;
+}
+
+static bool create(data_object* const data, SDL_RWops* const rwops) {
+	void* const decoded = decode(data, rwops);
+	if (decoded == NULL) {
+		return false;
+	}
+	if (!upload(data, decoded)) {
+		return false;
+	}
+
+	SDL_RWclose(rwops);
 	return true;
 }
 
@@ -88,4 +422,9 @@ static bool destroy(data_object* const data) {
 static bool create(data_object* const data, SDL_RWops* const rwops);
 static bool destroy(data_object* const data);
 
-DATA_TYPE_MANAGER_DEFINITION(data_type_manager_texture, create, destroy);
+static void size(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size) {
+	*cpu_size = sizeof(data_texture_object);
+	*gpu_size = data->texture->gpu_size;
+}
+
+DATA_TYPE_MANAGER_ASYNC_DEFINITION(data_type_manager_texture, create, destroy, size, decode, upload, discard);
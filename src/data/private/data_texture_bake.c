@@ -0,0 +1,276 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data_texture.h"
+#include "data/private/data_private.h"
+#include "util/str.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Baked textures are the texels of decoded images, RGBA8 in row order, after a
+ * header identifying the image they were decoded from; all header fields are
+ * little endian:
+ *
+ * magic[8], version u32, path u32, source_size u64, source_mtime i64,
+ * width u32, height u32, filename_size u32, flags u32, filename[filename_size]
+ *
+ * No flags are defined yet; texels are stored with straight alpha, as sheets
+ * are sampled.
+ */
+static const char bake_magic[8] = { 'D', 'M', 'F', 'T', 'E', 'X', 'C', '\0' };
+#define BAKE_VERSION 1u
+#define BAKE_HEADER_SIZE 48u
+
+typedef struct bake_header {
+	uint32_t path;
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint32_t filename_size;
+	uint32_t flags;
+} bake_header;
+
+static uint32_t read_u32(const unsigned char* const bytes) {
+	return
+		(uint32_t)bytes[0] |
+		((uint32_t)bytes[1] << 8) |
+		((uint32_t)bytes[2] << 16) |
+		((uint32_t)bytes[3] << 24);
+}
+
+static uint64_t read_u64(const unsigned char* const bytes) {
+	return (uint64_t)read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+static void write_u32(unsigned char* const bytes, const uint32_t value) {
+	bytes[0] = (unsigned char)value;
+	bytes[1] = (unsigned char)(value >> 8);
+	bytes[2] = (unsigned char)(value >> 16);
+	bytes[3] = (unsigned char)(value >> 24);
+}
+
+static void write_u64(unsigned char* const bytes, const uint64_t value) {
+	write_u32(bytes, (uint32_t)value);
+	write_u32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+/*
+ * Get the full filename of the baked texture of the file, named by a hash of
+ * the file's path and filename; collisions are caught by the filename stored
+ * in the header. The suffix is appended after the hash.
+ */
+static char* bake_filename_get(data_cache_object* const cache, const data_path path, const char* const filename, const char* const suffix) {
+	uint64_t hash = UINT64_C(0xCBF29CE484222325);
+	hash = (hash ^ (uint64_t)path) * UINT64_C(0x100000001B3);
+	for (const char* c = filename; *c != '\0'; c++) {
+		hash = (hash ^ (unsigned char)*c) * UINT64_C(0x100000001B3);
+	}
+
+	char* const bake_filename = alloc_sprintf(DATA_TEXTURE_BAKE_DIRECTORY "%08lx%08lx%s", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xFFFFFFFFu), suffix);
+	if (bake_filename == NULL) {
+		return NULL;
+	}
+	char* const full_filename = data_filename_get(cache, DATA_PATH_SAVE, bake_filename);
+	mem_free(bake_filename);
+	return full_filename;
+}
+
+static bool texels_size_valid(const uint32_t width, const uint32_t height) {
+	return width > 0u && height > 0u && width <= INT_MAX / 4 && height <= INT_MAX / 4 && (uint64_t)width * height * 4u <= INT_MAX;
+}
+
+/*
+ * Read the baked texture of the file, if it was baked from the file as it is
+ * now. Returns NULL if it can't be used.
+ */
+static SDL_Surface* bake_read(const char* const full_filename, const bake_header* const expected, const char* const filename) {
+	SDL_RWops* const rwops = SDL_RWFromFile(full_filename, "rb");
+	if (rwops == NULL) {
+		return NULL;
+	}
+
+	unsigned char header[BAKE_HEADER_SIZE];
+	if (SDL_RWread(rwops, header, 1u, sizeof(header)) != sizeof(header) || memcmp(header, bake_magic, sizeof(bake_magic)) != 0) {
+		SDL_RWclose(rwops);
+		return NULL;
+	}
+	const uint32_t width = read_u32(header + 36);
+	const uint32_t height = read_u32(header + 40);
+	if (
+		read_u32(header + 8) != BAKE_VERSION ||
+		read_u32(header + 12) != expected->path ||
+		read_u64(header + 16) != expected->source_size ||
+		(int64_t)read_u64(header + 24) != expected->source_mtime ||
+		read_u32(header + 32) != expected->filename_size ||
+		read_u32(header + 44) != expected->flags ||
+		!texels_size_valid(width, height)
+	) {
+		SDL_RWclose(rwops);
+		return NULL;
+	}
+
+	char* const stored_filename = mem_malloc(expected->filename_size);
+	if (stored_filename == NULL) {
+		SDL_RWclose(rwops);
+		return NULL;
+	}
+	const bool same_file =
+		SDL_RWread(rwops, stored_filename, 1u, expected->filename_size) == expected->filename_size &&
+		memcmp(stored_filename, filename, expected->filename_size) == 0;
+	mem_free(stored_filename);
+	if (!same_file) {
+		SDL_RWclose(rwops);
+		return NULL;
+	}
+
+	/*
+	 * The texels are read straight into the surface, as they're already in
+	 * the surface's format.
+	 */
+	SDL_Surface* const surface = SDL_CreateRGBSurfaceWithFormat(0u, (int)width, (int)height, 32, SDL_PIXELFORMAT_RGBA32);
+	if (surface == NULL) {
+		SDL_RWclose(rwops);
+		return NULL;
+	}
+	const size_t row_size = (size_t)width * 4u;
+	bool success = true;
+	if ((size_t)surface->pitch == row_size) {
+		success = SDL_RWread(rwops, surface->pixels, row_size, height) == height;
+	}
+	else {
+		for (uint32_t y = 0u; y < height && success; y++) {
+			success = SDL_RWread(rwops, (unsigned char*)surface->pixels + (size_t)y * surface->pitch, 1u, row_size) == row_size;
+		}
+	}
+	SDL_RWclose(rwops);
+	if (!success) {
+		SDL_FreeSurface(surface);
+		return NULL;
+	}
+	return surface;
+}
+
+/*
+ * Bake the decoded surface, writing it to a temporary file renamed into place
+ * once complete, so a partial bake is never read, even if the program exits
+ * while baking.
+ */
+static void bake_write(data_cache_object* const cache, const data_path path, const char* const filename, const char* const full_filename, const bake_header* const header, const SDL_Surface* const surface) {
+	char* const directory = data_filename_get(cache, DATA_PATH_SAVE, DATA_TEXTURE_BAKE_DIRECTORY);
+	if (directory == NULL) {
+		return;
+	}
+	const bool directory_exists = data_directory_create(directory);
+	mem_free(directory);
+	if (!directory_exists) {
+		return;
+	}
+
+	char suffix[32];
+	snprintf(suffix, sizeof(suffix), ".%lu.tmp", (unsigned long)SDL_ThreadID());
+	char* const temp_filename = bake_filename_get(cache, path, filename, suffix);
+	if (temp_filename == NULL) {
+		return;
+	}
+	SDL_RWops* const rwops = SDL_RWFromFile(temp_filename, "wb");
+	if (rwops == NULL) {
+		mem_free(temp_filename);
+		return;
+	}
+
+	unsigned char header_bytes[BAKE_HEADER_SIZE];
+	memcpy(header_bytes, bake_magic, sizeof(bake_magic));
+	write_u32(header_bytes + 8, BAKE_VERSION);
+	write_u32(header_bytes + 12, header->path);
+	write_u64(header_bytes + 16, header->source_size);
+	write_u64(header_bytes + 24, (uint64_t)header->source_mtime);
+	write_u32(header_bytes + 32, header->filename_size);
+	write_u32(header_bytes + 36, (uint32_t)surface->w);
+	write_u32(header_bytes + 40, (uint32_t)surface->h);
+	write_u32(header_bytes + 44, header->flags);
+	bool success =
+		SDL_RWwrite(rwops, header_bytes, 1u, sizeof(header_bytes)) == sizeof(header_bytes) &&
+		SDL_RWwrite(rwops, filename, 1u, header->filename_size) == header->filename_size;
+	const size_t row_size = (size_t)surface->w * 4u;
+	for (int y = 0; y < surface->h && success; y++) {
+		success = SDL_RWwrite(rwops, (const unsigned char*)surface->pixels + (size_t)y * surface->pitch, 1u, row_size) == row_size;
+	}
+	success = SDL_RWclose(rwops) == 0 && success;
+
+	/*
+	 * rename doesn't replace existing files on all platforms, so an outdated
+	 * bake is removed first.
+	 */
+	if (success) {
+		remove(full_filename);
+		success = rename(temp_filename, full_filename) == 0;
+	}
+	if (!success) {
+		log_printf("Error caching the decoded texels of \"%s\"\n", filename);
+		remove(temp_filename);
+	}
+	mem_free(temp_filename);
+}
+
+SDL_Surface* data_texture_decode_cached(data_cache_object* const cache, const data_path path, const char* const filename, SDL_RWops* const rwops) {
+	assert(cache != NULL);
+	assert(path == DATA_PATH_RESOURCE || path == DATA_PATH_SAVE);
+	assert(filename != NULL);
+	assert(rwops != NULL);
+
+	bake_header header;
+	const size_t filename_size = strlen(filename);
+	if (
+		!data_cache_texture_bake_get(cache) ||
+		filename_size == 0u ||
+		filename_size > UINT32_MAX ||
+		!data_file_stat(cache, path, filename, &header.source_size, &header.source_mtime)
+	) {
+		return data_texture_decode(rwops);
+	}
+	header.path = (uint32_t)path;
+	header.filename_size = (uint32_t)filename_size;
+	header.flags = 0u;
+
+	char* const full_filename = bake_filename_get(cache, path, filename, ".rgba");
+	if (full_filename == NULL) {
+		return data_texture_decode(rwops);
+	}
+
+	SDL_Surface* surface = bake_read(full_filename, &header, filename);
+	if (surface == NULL) {
+		surface = data_texture_decode(rwops);
+		if (surface != NULL && texels_size_valid((uint32_t)surface->w, (uint32_t)surface->h)) {
+			bake_write(cache, path, filename, full_filename, &header, surface);
+		}
+	}
+	mem_free(full_filename);
+	return surface;
+}
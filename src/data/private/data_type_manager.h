@@ -24,6 +24,7 @@
  */
 
 #include "SDL_rwops.h"
+#include <stddef.h>
 #include <stdbool.h>
 
 typedef struct data_object data_object;
@@ -31,16 +32,43 @@ typedef struct data_object data_object;
 typedef struct data_type_manager {
 	bool (* create)(data_object* const data, SDL_RWops* const rwops);
 	bool (* destroy)(data_object* const data);
-	bool (* destroy_by_dict)(void* const data);
+
+	/*
+	 * Get the bytes used by the data in CPU memory and GPU memory.
+	 */
+	void (* size)(const data_object* const data, size_t* const cpu_size, size_t* const gpu_size);
+
+	/*
+	 * Optional split of create, for asynchronous loading: decode reads and
+	 * decodes the file without using the cache or the graphics API, so it can
+	 * run in any thread, returning NULL upon failure; upload then creates the
+	 * data from the decoded file in the cache's thread, always taking
+	 * ownership of the decoded file; discard frees decoded files never
+	 * uploaded. The caller closes rwops after decode. Types without decode
+	 * have their create run in other threads instead, so it must not use the
+	 * cache or the graphics API.
+	 */
+	void* (* decode)(const data_object* const data, SDL_RWops* const rwops);
+	bool (* upload)(data_object* const data, void* const decoded);
+	void (* discard)(void* const decoded);
 } data_type_manager;
 
-#define DATA_TYPE_MANAGER_DEFINITION(manager_name, create_func, destroy_func) \
-static bool manager_name##_destroy_by_dict(void* const data) { \
-	return destroy_func((data_object*)data); \
-} \
-\
+#define DATA_TYPE_MANAGER_DEFINITION(manager_name, create_func, destroy_func, size_func) \
+const data_type_manager manager_name = { \
+	.create = create_func, \
+	.destroy = destroy_func, \
+	.size = size_func, \
+	.decode = NULL, \
+	.upload = NULL, \
+	.discard = NULL \
+};
+
+#define DATA_TYPE_MANAGER_ASYNC_DEFINITION(manager_name, create_func, destroy_func, size_func, decode_func, upload_func, discard_func) \
 const data_type_manager manager_name = { \
 	.create = create_func, \
 	.destroy = destroy_func, \
-	.destroy_by_dict = manager_name##_destroy_by_dict \
+	.size = size_func, \
+	.decode = decode_func, \
+	.upload = upload_func, \
+	.discard = discard_func \
 };
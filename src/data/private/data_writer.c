@@ -0,0 +1,384 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "data/data_writer.h"
+#include "util/private/threads.h"
+#include "util/dict.h"
+#include "util/str.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#endif
+
+/*
+ * Queueing waits for the writer to catch up if more than this many bytes are
+ * queued, so a writer that can't keep up doesn't take all the memory.
+ */
+#define DATA_WRITER_QUEUED_MAX ((size_t)64u << 20)
+
+#define DATA_WRITER_TEMP_SUFFIX ".tmp"
+
+/*
+ * The queued writes of a file, either the file's full contents, replacing the
+ * file, or bytes appended to the file.
+ */
+typedef struct write_object write_object;
+
+struct write_object {
+	write_object* next;
+	char* filename;
+	bool replace;
+	uint8_t* bytes;
+	size_t size;
+	size_t capacity;
+};
+
+struct data_writer_object {
+	char* save_path;
+	SDL_Thread* thread;
+	SDL_mutex* lock;
+
+	/*
+	 * Signaled when writes are queued, and when quitting.
+	 */
+	SDL_cond* queued_cond;
+
+	/*
+	 * Signaled when a write is done.
+	 */
+	SDL_cond* written_cond;
+
+	/*
+	 * The queued writes, in order, and by filename, for coalescing. A write
+	 * is removed from both once it's started, so writes queued after that
+	 * go into a new write.
+	 */
+	write_object* head;
+	write_object* tail;
+	dict_object* writes;
+	size_t queued_size;
+
+	bool writing;
+	bool failed;
+	bool quit;
+};
+
+static bool write_unlist(void* const data) {
+	(void)data;
+	return true;
+}
+
+static void write_free(write_object* const write) {
+	mem_free(write->bytes);
+	mem_free(write->filename);
+	mem_free(write);
+}
+
+/*
+ * Replace dst with src, where dst may exist.
+ */
+static bool file_replace(const char* const src, const char* const dst) {
+#ifdef _WIN32
+	if (!MoveFileExA(src, dst, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+		log_printf("Error replacing file \"%s\" with \"%s\"\n", dst, src);
+		return false;
+	}
+#else
+	if (rename(src, dst) != 0) {
+		log_printf("Error replacing file \"%s\" with \"%s\"\n", dst, src);
+		return false;
+	}
+#endif
+	return true;
+}
+
+static bool write_file(const char* const full_filename, const char* const mode, const void* const bytes, const size_t size) {
+	SDL_RWops* const rwops = SDL_RWFromFile(full_filename, mode);
+	if (rwops == NULL) {
+		log_printf("Error opening file \"%s\" for writing: %s\n", full_filename, SDL_GetError());
+		return false;
+	}
+
+	if (size > 0u && SDL_RWwrite(rwops, bytes, 1u, size) < size) {
+		log_printf("Error writing file \"%s\": %s\n", full_filename, SDL_GetError());
+		SDL_RWclose(rwops);
+		return false;
+	}
+
+	if (SDL_RWclose(rwops) < 0) {
+		log_printf("Error closing file \"%s\": %s\n", full_filename, SDL_GetError());
+		return false;
+	}
+	return true;
+}
+
+static bool write_do(const data_writer_object* const writer, const write_object* const write) {
+	char* const full_filename = alloc_sprintf("%s%s", writer->save_path, write->filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+
+	bool success;
+	if (write->replace) {
+		char* const temp_filename = alloc_sprintf("%s%s", full_filename, DATA_WRITER_TEMP_SUFFIX);
+		if (temp_filename == NULL) {
+			mem_free(full_filename);
+			return false;
+		}
+		success =
+			write_file(temp_filename, "wb", write->bytes, write->size) &&
+			file_replace(temp_filename, full_filename);
+		mem_free(temp_filename);
+	}
+	else {
+		success = write_file(full_filename, "ab", write->bytes, write->size);
+	}
+
+	mem_free(full_filename);
+	return success;
+}
+
+static int SDLCALL writer_thread_func(void* const data) {
+	data_writer_object* const writer = data;
+
+	mem_tag_set(MEM_TAG_DATA);
+	threads_current_set(THREADS_CLASS_BACKGROUND);
+
+	SDL_LockMutex(writer->lock);
+	while (true) {
+		while (writer->head == NULL && !writer->quit) {
+			SDL_CondWait(writer->queued_cond, writer->lock);
+		}
+		if (writer->head == NULL) {
+			break;
+		}
+
+		write_object* const write = writer->head;
+		writer->head = write->next;
+		if (writer->head == NULL) {
+			writer->tail = NULL;
+		}
+		dict_set(writer->writes, write->filename, strlen(write->filename), NULL, 0u, NULL, NULL);
+		writer->writing = true;
+		SDL_UnlockMutex(writer->lock);
+
+		const bool success = write_do(writer, write);
+
+		SDL_LockMutex(writer->lock);
+		writer->queued_size -= write->size;
+		writer->writing = false;
+		if (!success) {
+			writer->failed = true;
+		}
+		SDL_CondBroadcast(writer->written_cond);
+		SDL_UnlockMutex(writer->lock);
+
+		write_free(write);
+		SDL_LockMutex(writer->lock);
+	}
+	SDL_UnlockMutex(writer->lock);
+
+	return 0;
+}
+
+data_writer_object* data_writer_create(const char* const save_path) {
+	assert(save_path != NULL);
+
+	data_writer_object* const writer = mem_calloc(1u, sizeof(data_writer_object));
+	if (writer == NULL) {
+		log_printf("Error allocating the data writer\n");
+		return NULL;
+	}
+
+	writer->save_path = alloc_sprintf("%s", save_path);
+	writer->lock = SDL_CreateMutex();
+	writer->queued_cond = SDL_CreateCond();
+	writer->written_cond = SDL_CreateCond();
+	writer->writes = dict_create(1u);
+	if (writer->save_path == NULL || writer->lock == NULL || writer->queued_cond == NULL || writer->written_cond == NULL || writer->writes == NULL) {
+		log_printf("Error creating the data writer: %s\n", SDL_GetError());
+		data_writer_destroy(writer);
+		return NULL;
+	}
+
+	writer->thread = SDL_CreateThread(writer_thread_func, "data_writer_thread", writer);
+	if (writer->thread == NULL) {
+		log_printf("Error creating the data writer thread: %s\n", SDL_GetError());
+		data_writer_destroy(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+void data_writer_destroy(data_writer_object* const writer) {
+	assert(writer != NULL);
+
+	if (writer->thread != NULL) {
+		if (!data_writer_flush(writer)) {
+			log_printf("Error writing queued files\n");
+		}
+		SDL_LockMutex(writer->lock);
+		writer->quit = true;
+		SDL_CondSignal(writer->queued_cond);
+		SDL_UnlockMutex(writer->lock);
+		SDL_WaitThread(writer->thread, NULL);
+	}
+	assert(writer->head == NULL);
+
+	if (writer->writes != NULL) {
+		dict_destroy(writer->writes);
+	}
+	if (writer->written_cond != NULL) {
+		SDL_DestroyCond(writer->written_cond);
+	}
+	if (writer->queued_cond != NULL) {
+		SDL_DestroyCond(writer->queued_cond);
+	}
+	if (writer->lock != NULL) {
+		SDL_DestroyMutex(writer->lock);
+	}
+	if (writer->save_path != NULL) {
+		mem_free(writer->save_path);
+	}
+	mem_free(writer);
+}
+
+/*
+ * Queue the write, with the writer locked. If replace is true, the file's
+ * queued writes are replaced, otherwise the bytes are appended to them.
+ */
+static bool queue(data_writer_object* const writer, const char* const filename, const bool replace, const void* const bytes, const size_t size) {
+	assert(filename != NULL);
+	assert(strlen(filename) > 0u);
+
+	while (writer->queued_size > DATA_WRITER_QUEUED_MAX) {
+		SDL_CondWait(writer->written_cond, writer->lock);
+	}
+
+	write_object* write;
+	if (!dict_get(writer->writes, filename, strlen(filename), (void**)&write, NULL)) {
+		write = mem_calloc(1u, sizeof(write_object));
+		if (write == NULL) {
+			log_printf("Error allocating queued write\n");
+			return false;
+		}
+		write->filename = alloc_sprintf("%s", filename);
+		if (write->filename == NULL || !dict_set(writer->writes, filename, strlen(filename), write, sizeof(write_object), write_unlist, NULL)) {
+			log_printf("Error queueing write of file \"%s\"\n", filename);
+			write_free(write);
+			return false;
+		}
+		if (writer->tail != NULL) {
+			writer->tail->next = write;
+		}
+		else {
+			writer->head = write;
+		}
+		writer->tail = write;
+	}
+
+	// Grown before changing the write, so it's left as it was upon failure.
+	const size_t start = replace ? 0u : write->size;
+	if (start + size > write->capacity) {
+		size_t capacity = write->capacity > 0u ? write->capacity : (size_t)256u;
+		while (capacity < start + size) {
+			capacity *= 2u;
+		}
+		uint8_t* const bytes_realloc = mem_realloc(write->bytes, capacity);
+		if (bytes_realloc == NULL) {
+			log_printf("Error allocating queued write of file \"%s\"\n", filename);
+			return false;
+		}
+		write->bytes = bytes_realloc;
+		write->capacity = capacity;
+	}
+	if (replace) {
+		write->replace = true;
+	}
+	if (size > 0u) {
+		memcpy(write->bytes + start, bytes, size);
+	}
+	writer->queued_size = writer->queued_size - write->size + start + size;
+	write->size = start + size;
+
+	SDL_CondSignal(writer->queued_cond);
+	return true;
+}
+
+bool data_writer_save(data_writer_object* const writer, const char* const filename, const void* const bytes, const size_t size) {
+	assert(writer != NULL);
+	assert(bytes != NULL || size == 0u);
+
+	SDL_LockMutex(writer->lock);
+	const bool queued = queue(writer, filename, true, bytes, size);
+	SDL_UnlockMutex(writer->lock);
+	return queued;
+}
+
+bool data_writer_recreate(data_writer_object* const writer, const char* const filename) {
+	assert(writer != NULL);
+
+	SDL_LockMutex(writer->lock);
+	const bool queued = queue(writer, filename, true, NULL, 0u);
+	SDL_UnlockMutex(writer->lock);
+	return queued;
+}
+
+bool data_writer_append(data_writer_object* const writer, const char* const filename, const void* const bytes, const size_t size) {
+	assert(writer != NULL);
+	assert(bytes != NULL);
+	assert(size > 0u);
+
+	SDL_LockMutex(writer->lock);
+	const bool queued = queue(writer, filename, false, bytes, size);
+	SDL_UnlockMutex(writer->lock);
+	return queued;
+}
+
+bool data_writer_flush(data_writer_object* const writer) {
+	assert(writer != NULL);
+
+	SDL_LockMutex(writer->lock);
+	while (writer->head != NULL || writer->writing) {
+		SDL_CondWait(writer->written_cond, writer->lock);
+	}
+	const bool success = !writer->failed;
+	writer->failed = false;
+	SDL_UnlockMutex(writer->lock);
+	return success;
+}
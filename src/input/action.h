@@ -30,6 +30,7 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /*
@@ -104,3 +105,104 @@ bool action_bool_get(const size_t set, const size_t action);
  * would return false.
  */
 float action_float_get(const size_t set, const size_t action);
+
+/*
+ * Each action can be bound to up to this many inputs.
+ */
+#define ACTION_BINDINGS_MAX 4
+
+typedef enum action_binding_type {
+	ACTION_BINDING_NONE,
+
+	/*
+	 * A keyboard key, by SDL_Scancode, the key's physical position, not
+	 * the symbol the keyboard layout gives it.
+	 */
+	ACTION_BINDING_KEY,
+
+	/*
+	 * A mouse button, by SDL_BUTTON_* index.
+	 */
+	ACTION_BINDING_MOUSE_BUTTON,
+
+	/*
+	 * A button of any game controller, by SDL_GameControllerButton.
+	 */
+	ACTION_BINDING_CONTROLLER_BUTTON
+} action_binding_type;
+
+typedef struct action_binding {
+	action_binding_type type;
+	int code;
+} action_binding;
+
+/*
+ * Bind the input to the action at binding index, from zero to
+ * ACTION_BINDINGS_MAX - 1, replacing the input already bound there. Binding
+ * ACTION_BINDING_NONE unbinds the index. Returns false if the set, action, or
+ * binding is invalid.
+ */
+bool action_bind(const size_t set, const size_t action, const size_t index, const action_binding binding);
+
+/*
+ * Get the input bound to the action at binding index. Unbound indices, and
+ * invalid sets and actions, get ACTION_BINDING_NONE.
+ */
+action_binding action_binding_get(const size_t set, const size_t action, const size_t index);
+
+/*
+ * Restore the default bindings of all the action sets. The default keyboard
+ * bindings are chosen by key symbol, so they follow the keyboard layout.
+ */
+void action_bindings_default();
+
+/*
+ * A change of an action's state, caused by an input bound to the action being
+ * pressed or released. Events are recorded as they're received, so presses
+ * and releases between ticks aren't missed, even when a press and its release
+ * both happen between ticks.
+ */
+typedef struct action_event {
+	size_t set;
+	size_t action;
+	bool pressed;
+
+	/*
+	 * When the input was received, in SDL ticks, and estimated in
+	 * nanotime_now time.
+	 */
+	uint32_t timestamp;
+	uint64_t time;
+} action_event;
+
+/*
+ * Get the oldest action event not yet gotten, in the order they were received.
+ * Returns false if there are no more events. The events of up to 256 inputs
+ * are kept, then the oldest are dropped.
+ */
+bool action_event_next(action_event* const event);
+
+typedef struct action_input_stats {
+	/*
+	 * The number of action events received, and how long after their input
+	 * they were first seen by a tick, in nanoseconds, since the stats were
+	 * last gotten.
+	 */
+	uint64_t events;
+	uint64_t event_age_mean;
+	uint64_t event_age_max;
+
+	/*
+	 * The number of times controllers were polled by the input thread, and
+	 * the number of controller changes that couldn't be published before
+	 * ticks read them, since the stats were last gotten. Both are zero
+	 * without the input thread.
+	 */
+	uint64_t polls;
+	uint64_t polls_dropped;
+} action_input_stats;
+
+/*
+ * Get the input stats, resetting them.
+ */
+void action_input_stats_get(action_input_stats* const stats);
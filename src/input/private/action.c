@@ -22,51 +22,581 @@
  * SOFTWARE.
  */
 
-#include "input/action.h"
+#include "input/private/action_private.h"
+#include "util/private/threads.h"
+#include "util/nanotime.h"
+#include "util/log.h"
 #include "SDL.h"
 #include "SDL_keyboard.h"
+#include "SDL_gamecontroller.h"
+#include "SDL_thread.h"
+#include "SDL_atomic.h"
+#include <string.h>
 #include <assert.h>
 
-bool action_bool_get(const size_t set, const size_t action) {
-	const Uint8* const keys = SDL_GetKeyboardState(NULL);
-	SDL_Scancode scancode;
-
-	switch (set) {
-	case ACTION_SET_BASIC_MENU:
-		switch (action) {
-		case BASIC_MENU_UP:       scancode = SDL_GetScancodeFromKey(SDLK_UP); break;
-		case BASIC_MENU_DOWN:     scancode = SDL_GetScancodeFromKey(SDLK_DOWN); break;
-		case BASIC_MENU_LEFT:     scancode = SDL_GetScancodeFromKey(SDLK_LEFT); break;
-		case BASIC_MENU_RIGHT:    scancode = SDL_GetScancodeFromKey(SDLK_RIGHT); break;
-		case BASIC_MENU_POSITIVE: scancode = SDL_GetScancodeFromKey(SDLK_RETURN); break;
-		case BASIC_MENU_NEGATIVE: scancode = SDL_GetScancodeFromKey(SDLK_ESCAPE); break;
-		default: return false;
-		}
-		if (scancode == SDL_SCANCODE_UNKNOWN) return false;
-		else return !!keys[scancode];
+/*
+ * Action states are bitmasks of a set's actions, so sets have at most 32
+ * actions.
+ */
+#define ACTION_SET_ACTIONS_MAX 32
+#define ACTION_EVENTS 256
+
+static const size_t set_num_actions[ACTION_SET_NUM_BUILTIN] = {
+	[ACTION_SET_BASIC_MENU] = BASIC_MENU_NUM_ACTIONS
+};
+
+static action_binding bindings[ACTION_SET_NUM_BUILTIN][ACTION_SET_ACTIONS_MAX][ACTION_BINDINGS_MAX];
+
+/*
+ * The bindings, compiled into masks of the actions each input is bound to,
+ * rebuilt whenever a binding changes, so queries and events don't search the
+ * bindings.
+ */
+static uint32_t key_actions[ACTION_SET_NUM_BUILTIN][SDL_NUM_SCANCODES];
+static uint32_t mouse_button_actions[ACTION_SET_NUM_BUILTIN][32];
+static uint32_t controller_button_actions[ACTION_SET_NUM_BUILTIN][SDL_CONTROLLER_BUTTON_MAX];
+
+/*
+ * The actions active as of the last sample.
+ */
+static uint32_t action_states[ACTION_SET_NUM_BUILTIN];
+
+/*
+ * The number of bound inputs held down for each action, so an action bound to
+ * multiple inputs only has events for its first press and last release.
+ */
+static uint8_t action_holds[ACTION_SET_NUM_BUILTIN][ACTION_SET_ACTIONS_MAX];
+
+static action_event events[ACTION_EVENTS];
+static size_t events_start;
+static size_t num_events;
+
+/*
+ * The ages of the events at the sample they're first seen in, since the stats
+ * were last gotten.
+ */
+static size_t events_unaged;
+static uint64_t events_aged;
+static uint64_t events_age_total;
+static uint64_t events_age_max;
+
+/*
+ * Controllers are opened and closed in the main thread with the joysticks
+ * locked, so the input thread can poll them with the joysticks locked.
+ */
+#define ACTION_CONTROLLERS 8
+
+static SDL_GameController* controllers[ACTION_CONTROLLERS];
+
+/*
+ * The buttons held on each controller, as of the last sample, as masks of
+ * SDL_GameControllerButton.
+ */
+static uint32_t controller_buttons[ACTION_CONTROLLERS];
+
+#ifdef INPUT_THREAD
+/*
+ * The input thread polls the controllers at ACTION_POLL_RATE, publishing
+ * changes of their buttons into a ring, with the time each change was seen.
+ * The input thread is the only producer and the main thread the only
+ * consumer, so the ring only needs its indices to be atomic. Only controllers
+ * are polled in the input thread, as SDL only allows the keyboard and mouse
+ * to be pumped in the main thread.
+ */
+#define ACTION_POLL_RATE 1000
+#define ACTION_POLLS 256
+
+typedef struct controller_poll {
+	uint64_t time;
+	uint32_t timestamp;
+	size_t controller;
+	uint32_t buttons;
+} controller_poll;
+
+static controller_poll polls[ACTION_POLLS];
+static SDL_atomic_t polls_head;
+static SDL_atomic_t polls_tail;
+static SDL_atomic_t polls_count;
+static SDL_atomic_t polls_dropped;
+static SDL_atomic_t input_thread_quit;
+static SDL_Thread* input_thread = NULL;
+#endif
+
+static bool action_valid(const size_t set, const size_t action) {
+	return set < ACTION_SET_NUM_BUILTIN && action < set_num_actions[set];
+}
+
+static void bindings_compile() {
+	memset(key_actions, 0, sizeof(key_actions));
+	memset(mouse_button_actions, 0, sizeof(mouse_button_actions));
+	memset(controller_button_actions, 0, sizeof(controller_button_actions));
+	for (size_t set = 0u; set < ACTION_SET_NUM_BUILTIN; set++) {
+		for (size_t action = 0u; action < set_num_actions[set]; action++) {
+			for (size_t i = 0u; i < ACTION_BINDINGS_MAX; i++) {
+				const action_binding binding = bindings[set][action][i];
+				switch (binding.type) {
+				case ACTION_BINDING_KEY:
+					key_actions[set][binding.code] |= UINT32_C(1) << action;
+					break;
+
+				case ACTION_BINDING_MOUSE_BUTTON:
+					mouse_button_actions[set][binding.code - 1] |= UINT32_C(1) << action;
+					break;
+
+				case ACTION_BINDING_CONTROLLER_BUTTON:
+					controller_button_actions[set][binding.code] |= UINT32_C(1) << action;
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+	}
+	memset(action_holds, 0, sizeof(action_holds));
+}
+
+static void default_bind(const size_t set, const size_t action, const SDL_Keycode key, const SDL_GameControllerButton button) {
+	const SDL_Scancode scancode = SDL_GetScancodeFromKey(key);
+	if (scancode != SDL_SCANCODE_UNKNOWN) {
+		bindings[set][action][0] = (action_binding) { .type = ACTION_BINDING_KEY, .code = (int)scancode };
+	}
+	bindings[set][action][1] = (action_binding) { .type = ACTION_BINDING_CONTROLLER_BUTTON, .code = (int)button };
+}
+
+void action_bindings_default() {
+	memset(bindings, 0, sizeof(bindings));
+
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_UP, SDLK_UP, SDL_CONTROLLER_BUTTON_DPAD_UP);
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_DOWN, SDLK_DOWN, SDL_CONTROLLER_BUTTON_DPAD_DOWN);
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_LEFT, SDLK_LEFT, SDL_CONTROLLER_BUTTON_DPAD_LEFT);
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_RIGHT, SDLK_RIGHT, SDL_CONTROLLER_BUTTON_DPAD_RIGHT);
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_POSITIVE, SDLK_RETURN, SDL_CONTROLLER_BUTTON_A);
+	default_bind(ACTION_SET_BASIC_MENU, BASIC_MENU_NEGATIVE, SDLK_ESCAPE, SDL_CONTROLLER_BUTTON_B);
+
+	bindings_compile();
+}
+
+#ifdef INPUT_THREAD
+static int SDLCALL input_thread_func(void* const data) {
+	(void)data;
+
+	threads_current_set(THREADS_CLASS_INPUT);
+
+	uint32_t last_buttons[ACTION_CONTROLLERS] = { 0u };
+	const uint64_t poll_duration = NANOTIME_NSEC_PER_SEC / ACTION_POLL_RATE;
+	while (!SDL_AtomicGet(&input_thread_quit)) {
+		const uint64_t start = nanotime_now();
+		const uint32_t timestamp = SDL_GetTicks();
+
+		SDL_LockJoysticks();
+		SDL_GameControllerUpdate();
+		for (size_t i = 0u; i < ACTION_CONTROLLERS; i++) {
+			uint32_t buttons = 0u;
+			if (controllers[i] != NULL) {
+				for (int button = 0; button < SDL_CONTROLLER_BUTTON_MAX; button++) {
+					if (SDL_GameControllerGetButton(controllers[i], (SDL_GameControllerButton)button)) {
+						buttons |= UINT32_C(1) << button;
+					}
+				}
+			}
+			if (buttons == last_buttons[i]) {
+				continue;
+			}
+
+			const int head = SDL_AtomicGet(&polls_head);
+			const int next = (head + 1) % ACTION_POLLS;
+			if (next == SDL_AtomicGet(&polls_tail)) {
+				// The change is dropped, so it's seen again next poll.
+				SDL_AtomicAdd(&polls_dropped, 1);
+				continue;
+			}
+			SDL_MemoryBarrierAcquire();
+			polls[head] = (controller_poll) {
+				.time = start,
+				.timestamp = timestamp,
+				.controller = i,
+				.buttons = buttons
+			};
+			SDL_MemoryBarrierRelease();
+			SDL_AtomicSet(&polls_head, next);
+			last_buttons[i] = buttons;
+		}
+		SDL_UnlockJoysticks();
+		SDL_AtomicAdd(&polls_count, 1);
+
+		const uint64_t elapsed = nanotime_interval(start, nanotime_now(), nanotime_now_max());
+		if (elapsed < poll_duration) {
+			nanotime_sleep(poll_duration - elapsed);
+		}
+	}
+
+	return 0;
+}
+#endif
+
+void action_init() {
+	events_start = 0u;
+	num_events = 0u;
+	events_aged = 0u;
+	events_age_total = 0u;
+	events_age_max = 0u;
+	memset(action_states, 0, sizeof(action_states));
+	memset(controllers, 0, sizeof(controllers));
+	memset(controller_buttons, 0, sizeof(controller_buttons));
+	action_bindings_default();
+
+#ifdef INPUT_THREAD
+	SDL_AtomicSet(&polls_head, 0);
+	SDL_AtomicSet(&polls_tail, 0);
+	SDL_AtomicSet(&polls_count, 0);
+	SDL_AtomicSet(&polls_dropped, 0);
+	SDL_AtomicSet(&input_thread_quit, 0);
+	input_thread = SDL_CreateThread(input_thread_func, "input_thread", NULL);
+	if (input_thread == NULL) {
+		log_printf("Error creating the input thread, controllers will only be polled once per tick: %s\n", SDL_GetError());
+	}
+#endif
+}
+
+void action_deinit() {
+#ifdef INPUT_THREAD
+	if (input_thread != NULL) {
+		SDL_AtomicSet(&input_thread_quit, 1);
+		SDL_WaitThread(input_thread, NULL);
+		input_thread = NULL;
+	}
+#endif
+
+	SDL_LockJoysticks();
+	for (size_t i = 0u; i < ACTION_CONTROLLERS; i++) {
+		if (controllers[i] != NULL) {
+			SDL_GameControllerClose(controllers[i]);
+			controllers[i] = NULL;
+		}
+	}
+	SDL_UnlockJoysticks();
+}
+
+/*
+ * Whether controller button changes come from the input thread, rather than
+ * from events.
+ */
+static bool controllers_polled() {
+#ifdef INPUT_THREAD
+	return input_thread != NULL;
+#else
+	return false;
+#endif
+}
+
+bool action_bind(const size_t set, const size_t action, const size_t index, const action_binding binding) {
+	if (!action_valid(set, action) || index >= ACTION_BINDINGS_MAX) {
+		return false;
+	}
+
+	switch (binding.type) {
+	case ACTION_BINDING_NONE:
+		break;
+
+	case ACTION_BINDING_KEY:
+		if (binding.code <= SDL_SCANCODE_UNKNOWN || binding.code >= SDL_NUM_SCANCODES) {
+			return false;
+		}
+		break;
+
+	case ACTION_BINDING_MOUSE_BUTTON:
+		if (binding.code < 1 || binding.code > 32) {
+			return false;
+		}
+		break;
+
+	case ACTION_BINDING_CONTROLLER_BUTTON:
+		if (binding.code < 0 || binding.code >= SDL_CONTROLLER_BUTTON_MAX) {
+			return false;
+		}
+		break;
+
 	default:
 		return false;
 	}
+
+	bindings[set][action][index] = binding;
+	bindings_compile();
+	return true;
 }
 
-float action_float_get(const size_t set, const size_t action) {
-	const Uint8* const keys = SDL_GetKeyboardState(NULL);
-	SDL_Scancode scancode;
-
-	switch (set) {
-	case ACTION_SET_BASIC_MENU:
-		switch (action) {
-		case BASIC_MENU_UP:       scancode = SDL_GetScancodeFromKey(SDLK_UP); break;
-		case BASIC_MENU_DOWN:     scancode = SDL_GetScancodeFromKey(SDLK_DOWN); break;
-		case BASIC_MENU_LEFT:     scancode = SDL_GetScancodeFromKey(SDLK_LEFT); break;
-		case BASIC_MENU_RIGHT:    scancode = SDL_GetScancodeFromKey(SDLK_RIGHT); break;
-		case BASIC_MENU_POSITIVE: scancode = SDL_GetScancodeFromKey(SDLK_RETURN); break;
-		case BASIC_MENU_NEGATIVE: scancode = SDL_GetScancodeFromKey(SDLK_ESCAPE); break;
-		default: return 0.0f;
-		}
-		if (scancode == SDL_SCANCODE_UNKNOWN) return 0.0f;
-		else return keys[scancode] ? 1.0f : 0.0f;
+action_binding action_binding_get(const size_t set, const size_t action, const size_t index) {
+	if (!action_valid(set, action) || index >= ACTION_BINDINGS_MAX) {
+		return (action_binding) { .type = ACTION_BINDING_NONE };
+	}
+	return bindings[set][action][index];
+}
+
+static void event_push(const size_t set, const size_t action, const bool pressed, const uint32_t timestamp, const uint64_t time) {
+	if (num_events == ACTION_EVENTS) {
+		events_start = (events_start + 1u) % ACTION_EVENTS;
+		num_events--;
+	}
+	events[(events_start + num_events) % ACTION_EVENTS] = (action_event) {
+		.set = set,
+		.action = action,
+		.pressed = pressed,
+		.timestamp = timestamp,
+		.time = time
+	};
+	num_events++;
+	events_unaged++;
+}
+
+/*
+ * Push events for the actions an input is bound to, pressed or released.
+ */
+static void actions_change(const size_t set, uint32_t actions, const bool pressed, const uint32_t timestamp, const uint64_t time) {
+	while (actions != 0u) {
+		size_t action = 0u;
+		while (!(actions & (UINT32_C(1) << action))) {
+			action++;
+		}
+		actions &= ~(UINT32_C(1) << action);
+
+		uint8_t* const holds = &action_holds[set][action];
+		if (pressed) {
+			if ((*holds)++ == 0u) {
+				event_push(set, action, true, timestamp, time);
+			}
+		}
+		else if (*holds > 0u && --*holds == 0u) {
+			event_push(set, action, false, timestamp, time);
+		}
+	}
+}
+
+/*
+ * Estimate when an SDL event happened in nanotime_now time, relative to now,
+ * as SDL's timestamps are in its own clock.
+ */
+static uint64_t event_time_get(const uint32_t timestamp) {
+	const uint32_t ticks = SDL_GetTicks();
+	const uint64_t now = nanotime_now();
+	const uint64_t age = (uint64_t)(ticks - timestamp) * UINT64_C(1000000);
+	return age < now ? now - age : 0u;
+}
+
+static void controller_buttons_change(const size_t controller, const uint32_t buttons, const uint32_t timestamp, const uint64_t time) {
+	const uint32_t changed = buttons ^ controller_buttons[controller];
+	for (int button = 0; button < SDL_CONTROLLER_BUTTON_MAX; button++) {
+		const uint32_t mask = UINT32_C(1) << button;
+		if (changed & mask) {
+			for (size_t set = 0u; set < ACTION_SET_NUM_BUILTIN; set++) {
+				actions_change(set, controller_button_actions[set][button], !!(buttons & mask), timestamp, time);
+			}
+		}
+	}
+	controller_buttons[controller] = buttons;
+}
+
+static void controller_open(const int device_index) {
+	SDL_LockJoysticks();
+	for (size_t i = 0u; i < ACTION_CONTROLLERS; i++) {
+		if (controllers[i] == NULL) {
+			controllers[i] = SDL_GameControllerOpen(device_index);
+			if (controllers[i] == NULL) {
+				log_printf("Error opening a controller: %s\n", SDL_GetError());
+			}
+			break;
+		}
+	}
+	SDL_UnlockJoysticks();
+}
+
+static void controller_close(const SDL_JoystickID id) {
+	SDL_LockJoysticks();
+	for (size_t i = 0u; i < ACTION_CONTROLLERS; i++) {
+		if (controllers[i] != NULL && SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i])) == id) {
+			SDL_GameControllerClose(controllers[i]);
+			controllers[i] = NULL;
+			if (!controllers_polled()) {
+				controller_buttons_change(i, 0u, SDL_GetTicks(), nanotime_now());
+			}
+			break;
+		}
+	}
+	SDL_UnlockJoysticks();
+}
+
+/*
+ * Get the slot of the open controller, or ACTION_CONTROLLERS if it's not open.
+ */
+static size_t controller_find(const SDL_JoystickID id) {
+	size_t i;
+	for (i = 0u; i < ACTION_CONTROLLERS; i++) {
+		if (controllers[i] != NULL && SDL_JoystickInstanceID(SDL_GameControllerGetJoystick(controllers[i])) == id) {
+			break;
+		}
+	}
+	return i;
+}
+
+void action_event_handle(const SDL_Event* const event) {
+	assert(event != NULL);
+
+	switch (event->type) {
+	case SDL_KEYDOWN:
+	case SDL_KEYUP:
+		if (event->key.repeat || event->key.keysym.scancode >= SDL_NUM_SCANCODES) {
+			break;
+		}
+		for (size_t set = 0u; set < ACTION_SET_NUM_BUILTIN; set++) {
+			actions_change(set, key_actions[set][event->key.keysym.scancode], event->type == SDL_KEYDOWN, event->key.timestamp, event_time_get(event->key.timestamp));
+		}
+		break;
+
+	case SDL_MOUSEBUTTONDOWN:
+	case SDL_MOUSEBUTTONUP:
+		if (event->button.button < 1u || event->button.button > 32u) {
+			break;
+		}
+		for (size_t set = 0u; set < ACTION_SET_NUM_BUILTIN; set++) {
+			actions_change(set, mouse_button_actions[set][event->button.button - 1u], event->type == SDL_MOUSEBUTTONDOWN, event->button.timestamp, event_time_get(event->button.timestamp));
+		}
+		break;
+
+	case SDL_CONTROLLERDEVICEADDED:
+		controller_open(event->cdevice.which);
+		break;
+
+	case SDL_CONTROLLERDEVICEREMOVED:
+		controller_close(event->cdevice.which);
+		break;
+
+	case SDL_CONTROLLERBUTTONDOWN:
+	case SDL_CONTROLLERBUTTONUP: {
+		if (controllers_polled() || event->cbutton.button >= SDL_CONTROLLER_BUTTON_MAX) {
+			break;
+		}
+		const size_t controller = controller_find(event->cbutton.which);
+		if (controller == ACTION_CONTROLLERS) {
+			break;
+		}
+		const uint32_t mask = UINT32_C(1) << event->cbutton.button;
+		const uint32_t buttons = event->type == SDL_CONTROLLERBUTTONDOWN ?
+			controller_buttons[controller] | mask :
+			controller_buttons[controller] & ~mask;
+		controller_buttons_change(controller, buttons, event->cbutton.timestamp, event_time_get(event->cbutton.timestamp));
+		break;
+	}
+
+	case SDL_KEYMAPCHANGED:
+		// The default bindings are by key symbol, so they're rebuilt for
+		// the new layout, which also replaces rebound keys.
+		action_bindings_default();
+		break;
+
 	default:
-		return 0.0f;
+		break;
+	}
+}
+
+static bool controller_button_held(const int button) {
+	for (size_t i = 0u; i < ACTION_CONTROLLERS; i++) {
+		if (controller_buttons[i] & (UINT32_C(1) << button)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+void action_sample() {
+#ifdef INPUT_THREAD
+	if (input_thread != NULL) {
+		const int tail = SDL_AtomicGet(&polls_tail);
+		const int head = SDL_AtomicGet(&polls_head);
+		SDL_MemoryBarrierAcquire();
+		int i;
+		for (i = tail; i != head; i = (i + 1) % ACTION_POLLS) {
+			const controller_poll* const poll = &polls[i];
+			controller_buttons_change(poll->controller, poll->buttons, poll->timestamp, poll->time);
+		}
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&polls_tail, i);
+	}
+#endif
+
+	// Events not yet aged were received since the last sample, so this is
+	// the first sample they're seen in.
+	const uint64_t now = nanotime_now();
+	const size_t num_new = num_events < events_unaged ? num_events : events_unaged;
+	for (size_t i = num_events - num_new; i < num_events; i++) {
+		const action_event* const event = &events[(events_start + i) % ACTION_EVENTS];
+		const uint64_t age = nanotime_interval(event->time, now, nanotime_now_max());
+		events_aged++;
+		events_age_total += age;
+		if (age > events_age_max) {
+			events_age_max = age;
+		}
 	}
+	events_unaged = 0u;
+
+	const Uint8* const keys = SDL_GetKeyboardState(NULL);
+	const Uint32 buttons = SDL_GetMouseState(NULL, NULL);
+	for (size_t set = 0u; set < ACTION_SET_NUM_BUILTIN; set++) {
+		uint32_t states = 0u;
+		for (size_t action = 0u; action < set_num_actions[set]; action++) {
+			for (size_t i = 0u; i < ACTION_BINDINGS_MAX; i++) {
+				const action_binding binding = bindings[set][action][i];
+				if (
+					(binding.type == ACTION_BINDING_KEY && keys[binding.code]) ||
+					(binding.type == ACTION_BINDING_MOUSE_BUTTON && (buttons & SDL_BUTTON(binding.code))) ||
+					(binding.type == ACTION_BINDING_CONTROLLER_BUTTON && controller_button_held(binding.code))
+				) {
+					states |= UINT32_C(1) << action;
+					break;
+				}
+			}
+		}
+		action_states[set] = states;
+	}
+}
+
+bool action_event_next(action_event* const event) {
+	assert(event != NULL);
+
+	if (num_events == 0u) {
+		return false;
+	}
+	*event = events[events_start];
+	events_start = (events_start + 1u) % ACTION_EVENTS;
+	num_events--;
+	return true;
+}
+
+bool action_bool_get(const size_t set, const size_t action) {
+	if (!action_valid(set, action)) {
+		return false;
+	}
+	return !!(action_states[set] & (UINT32_C(1) << action));
+}
+
+float action_float_get(const size_t set, const size_t action) {
+	return action_bool_get(set, action) ? 1.0f : 0.0f;
+}
+
+void action_input_stats_get(action_input_stats* const stats) {
+	assert(stats != NULL);
+
+	stats->events = events_aged;
+	stats->event_age_mean = events_aged > 0u ? events_age_total / events_aged : 0u;
+	stats->event_age_max = events_age_max;
+#ifdef INPUT_THREAD
+	stats->polls = (uint64_t)SDL_AtomicSet(&polls_count, 0);
+	stats->polls_dropped = (uint64_t)SDL_AtomicSet(&polls_dropped, 0);
+#else
+	stats->polls = 0u;
+	stats->polls_dropped = 0u;
+#endif
+
+	events_aged = 0u;
+	events_age_total = 0u;
+	events_age_max = 0u;
 }
@@ -0,0 +1,52 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "input/action.h"
+#include "SDL_events.h"
+
+/*
+ * Compile the default bindings, and start the input thread polling
+ * controllers, if INPUT_THREAD is defined. Must be called after the video
+ * subsystem is initialized, as looking up keys by symbol uses the keyboard
+ * layout.
+ */
+void action_init();
+
+/*
+ * Stop the input thread, if it was started, and close the controllers.
+ */
+void action_deinit();
+
+/*
+ * Record the action events caused by an event. Called for each event received
+ * by the main thread.
+ */
+void action_event_handle(const SDL_Event* const event);
+
+/*
+ * Update the actions' states from the current input state, called after events
+ * are pumped.
+ */
+void action_sample();
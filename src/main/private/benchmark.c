@@ -0,0 +1,541 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "main/private/benchmark.h"
+#include "main/private/prog_private.h"
+#include "main/main.h"
+#include "render/render.h"
+#include "render/private/capture.h"
+#include "util/str.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "util/nanotime.h"
+#include "SDL.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+/*
+ * Frames run before recording starts, so the initial loading of sheets and
+ * fonts and the warming of caches aren't counted.
+ */
+#define WARMUP_FRAMES UINT64_C(60)
+
+#define SCREEN_WIDTH 640.0f
+#define SCREEN_HEIGHT 480.0f
+#define SPRITE_SIZE 16.0f
+
+#define SPRITES_COUNT 20000u
+#define SPRITES_RUN 256u
+#define LAYERS_COUNT 256u
+#define LAYER_SPRITES 64u
+#define TEXT_LINES 40u
+#define CHURN_SPRITES 64u
+
+typedef enum benchmark_scene {
+	SCENE_SPRITES,
+	SCENE_TEXT,
+	SCENE_LAYERS,
+	SCENE_CHURN,
+	SCENE_REPLAY
+} benchmark_scene;
+
+static const char* const scene_names[] = {
+	[SCENE_SPRITES] = "sprites",
+	[SCENE_TEXT] = "text",
+	[SCENE_LAYERS] = "layers",
+	[SCENE_CHURN] = "churn",
+	[SCENE_REPLAY] = "replay"
+};
+
+#ifdef MEM_DEBUG
+static const char* const tag_names[] = {
+	[MEM_TAG_NONE] = "none",
+	[MEM_TAG_RENDER] = "render",
+	[MEM_TAG_DATA] = "data",
+	[MEM_TAG_LOG] = "log",
+	[MEM_TAG_AUDIO] = "audio"
+};
+#endif
+
+static const char* const sheets[] = {
+	"sprite.png",
+	"font_0.png"
+};
+
+static const char* const paragraph = "\
+Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do eiusmod tempor\n\
+incididunt ut labore et dolore magna aliqua. Ut enim ad minim veniam, quis\n\
+nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo consequat.\n\
+";
+
+/*
+ * Samples of a measurement, in milliseconds, one per recorded frame at most.
+ */
+typedef struct samples_type {
+	double* values;
+	size_t count;
+} samples_type;
+
+static bool benchmarking = false;
+static benchmark_scene scene;
+static uint64_t num_frames;
+static char* report_filename = NULL;
+static render_settings_type settings;
+static sprite_type* sprites = NULL;
+static char* capture_filename = NULL;
+static capture_replay_object* replay = NULL;
+
+static uint64_t frame;
+static uint64_t last_draws;
+static size_t last_allocs;
+static size_t frame_allocs_total;
+static size_t frame_allocs_max;
+#ifdef MEM_DEBUG
+static size_t last_tag_allocs[MEM_TAG_COUNT];
+static size_t frame_tag_allocs_total[MEM_TAG_COUNT];
+static size_t frame_tag_allocs_max[MEM_TAG_COUNT];
+#endif
+static samples_type tick_samples;
+static samples_type render_samples;
+static samples_type gpu_samples;
+
+bool benchmark_init(const char* const scene_name, const uint64_t frames, const char* const filename, const char* const capture) {
+	assert(main_thread_is_this_thread());
+	assert(!benchmarking);
+	assert(scene_name != NULL && filename != NULL);
+
+	size_t i;
+	for (i = 0u; i < lengthof(scene_names); i++) {
+		if (strcmp(scene_name, scene_names[i]) == 0) {
+			break;
+		}
+	}
+	if (i == lengthof(scene_names)) {
+		log_printf("Error: Unknown benchmark scene \"%s\"\n", scene_name);
+		return false;
+	}
+	if (frames == 0u) {
+		log_printf("Error: The benchmark must run for at least one frame\n");
+		return false;
+	}
+	if ((benchmark_scene)i == SCENE_REPLAY && capture == NULL) {
+		log_printf("Error: The replay benchmark needs a capture, from --benchmark-capture\n");
+		return false;
+	}
+	scene = (benchmark_scene)i;
+	num_frames = frames;
+
+	settings = (render_settings_type) {
+		.width = SCREEN_WIDTH,
+		.height = SCREEN_HEIGHT,
+		.texture_budget = scene == SCENE_CHURN ? 1u : 0u
+	};
+
+	report_filename = alloc_sprintf("%s", filename);
+	sprites = mem_malloc(sizeof(sprite_type) * SPRITES_COUNT);
+	tick_samples.values = mem_malloc(sizeof(double) * (size_t)num_frames);
+	render_samples.values = mem_malloc(sizeof(double) * (size_t)num_frames);
+	gpu_samples.values = mem_malloc(sizeof(double) * (size_t)num_frames);
+	if (
+		report_filename == NULL ||
+		sprites == NULL ||
+		tick_samples.values == NULL ||
+		render_samples.values == NULL ||
+		gpu_samples.values == NULL
+	) {
+		log_printf("Error allocating memory for the benchmark\n");
+		benchmarking = true;
+		benchmark_deinit();
+		return false;
+	}
+
+	if (scene == SCENE_REPLAY) {
+		capture_filename = alloc_sprintf("%s", capture);
+		char* const full_capture_filename = alloc_sprintf("%s%s", prog_save_path_get(), capture);
+		if (capture_filename != NULL && full_capture_filename != NULL) {
+			replay = capture_replay_create(full_capture_filename);
+		}
+		mem_free(full_capture_filename);
+		if (replay == NULL) {
+			benchmarking = true;
+			benchmark_deinit();
+			return false;
+		}
+	}
+	tick_samples.count = 0u;
+	render_samples.count = 0u;
+	gpu_samples.count = 0u;
+
+	frame = 0u;
+	prog_render_draw_get(NULL, &last_draws);
+	last_allocs = mem_num_allocs();
+	frame_allocs_total = 0u;
+	frame_allocs_max = 0u;
+	#ifdef MEM_DEBUG
+	mem_stats stats;
+	mem_stats_get(&stats);
+	for (size_t i = 0u; i < MEM_TAG_COUNT; i++) {
+		last_tag_allocs[i] = stats.tag_allocs[i];
+		frame_tag_allocs_total[i] = 0u;
+		frame_tag_allocs_max[i] = 0u;
+	}
+	#endif
+
+	benchmarking = true;
+	log_printf("Running the \"%s\" benchmark for %" PRIu64 " frames\n", scene_names[scene], num_frames);
+
+	return true;
+}
+
+void benchmark_deinit() {
+	if (!benchmarking) {
+		return;
+	}
+
+	mem_free(report_filename);
+	mem_free(sprites);
+	mem_free(tick_samples.values);
+	mem_free(render_samples.values);
+	mem_free(gpu_samples.values);
+	mem_free(capture_filename);
+	if (replay != NULL) {
+		capture_replay_destroy(replay);
+	}
+	report_filename = NULL;
+	sprites = NULL;
+	tick_samples.values = NULL;
+	render_samples.values = NULL;
+	gpu_samples.values = NULL;
+	capture_filename = NULL;
+	replay = NULL;
+
+	benchmarking = false;
+}
+
+/*
+ * Fill in count sprites moving deterministically over the screen, the same on
+ * every run.
+ */
+static void sprites_generate(const size_t first, const size_t count) {
+	const float t = (float)frame;
+	for (size_t i = 0u; i < count; i++) {
+		const size_t n = first + i;
+		const float x = fmodf((float)n * 37.0f + t * (float)(n % 7u + 1u), SCREEN_WIDTH - SPRITE_SIZE);
+		const float y = fmodf((float)n * 53.0f + t * (float)(n % 5u + 1u) * 0.5f, SCREEN_HEIGHT - SPRITE_SIZE);
+		sprites[i] = (sprite_type) {
+			.src = { 0.0f, 0.0f, SPRITE_SIZE, SPRITE_SIZE },
+			.dst = { x, y, SPRITE_SIZE, SPRITE_SIZE }
+		};
+	}
+}
+
+static bool scene_sprites_update() {
+	// Alternating sheets every run of sprites, so sheets are switched often.
+	for (size_t start = 0u; start < SPRITES_COUNT; start += SPRITES_RUN) {
+		const size_t count = SPRITES_COUNT - start < SPRITES_RUN ? SPRITES_COUNT - start : SPRITES_RUN;
+		sprites_generate(start, count);
+		if (!render_sprites(sheets[start / SPRITES_RUN % lengthof(sheets)], 0u, count, sprites)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool scene_text_update() {
+	if (!render_string("font.fnt", 0u, 8.0f, 8.0f, paragraph)) {
+		return false;
+	}
+	for (size_t i = 0u; i < TEXT_LINES; i++) {
+		if (!render_printf("font.fnt", 0u, 8.0f, 56.0f + (float)i * 10.0f, "Line %zu of frame %" PRIu64 ": %08" PRIx64, i, frame, (frame + 1u) * (uint64_t)(i * 2654435761u))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool scene_layers_update() {
+	for (size_t layer = 0u; layer < LAYERS_COUNT; layer++) {
+		sprites_generate(layer * LAYER_SPRITES, LAYER_SPRITES);
+		if (!render_sprites(sheets[layer % lengthof(sheets)], layer, LAYER_SPRITES, sprites)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool scene_churn_update() {
+	sprites_generate(0u, CHURN_SPRITES);
+	return render_sprites(sheets[frame % lengthof(sheets)], 0u, CHURN_SPRITES, sprites);
+}
+
+bool benchmark_update() {
+	assert(benchmarking);
+
+	// Captured frames are replayed in a loop, each from its own render_start
+	// to its render_end.
+	if (scene == SCENE_REPLAY) {
+		return capture_replay_frame(replay, frame % capture_replay_frames_get(replay));
+	}
+
+	if (!render_start(&settings) || !render_clear(0.0f, 0.0f, 0.0f, 1.0f)) {
+		return false;
+	}
+
+	bool updated = false;
+	switch (scene) {
+	case SCENE_SPRITES:
+		updated = scene_sprites_update();
+		break;
+
+	case SCENE_TEXT:
+		updated = scene_text_update();
+		break;
+
+	case SCENE_LAYERS:
+		updated = scene_layers_update();
+		break;
+
+	case SCENE_CHURN:
+		updated = scene_churn_update();
+		break;
+
+	case SCENE_REPLAY:
+		break;
+	}
+	if (!updated) {
+		return false;
+	}
+
+	return render_end();
+}
+
+static int sample_compare(const void* const lhs, const void* const rhs) {
+	const double a = *(const double*)lhs;
+	const double b = *(const double*)rhs;
+	return (a > b) - (a < b);
+}
+
+/*
+ * Nearest-rank percentile of sorted samples.
+ */
+static double percentile_get(const samples_type* const samples, const unsigned percent) {
+	size_t rank = (samples->count * percent + 99u) / 100u;
+	if (rank == 0u) {
+		rank = 1u;
+	}
+	return samples->values[rank - 1u];
+}
+
+typedef struct report_type {
+	SDL_RWops* file;
+	bool failed;
+} report_type;
+
+static void report_printf(report_type* const report, const char* const format, ...) {
+	char text[256];
+	va_list args;
+	va_start(args, format);
+	const int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	if (report->failed || length < 0 || (size_t)length >= sizeof(text) || SDL_RWwrite(report->file, text, 1u, (size_t)length) != (size_t)length) {
+		report->failed = true;
+	}
+}
+
+static void report_string(report_type* const report, const char* const string) {
+	report_printf(report, "\"");
+	for (const char* c = string; *c != '\0'; c++) {
+		if (*c == '"' || *c == '\\') {
+			report_printf(report, "\\%c", *c);
+		}
+		else if ((unsigned char)*c < 0x20u) {
+			report_printf(report, "\\u%04x", (unsigned)(unsigned char)*c);
+		}
+		else {
+			report_printf(report, "%c", *c);
+		}
+	}
+	report_printf(report, "\"");
+}
+
+static void report_samples(report_type* const report, const char* const name, samples_type* const samples, const bool last) {
+	report_printf(report, "\t\"%s\": ", name);
+	if (samples->count == 0u) {
+		report_printf(report, "null%s\n", last ? "" : ",");
+		return;
+	}
+	qsort(samples->values, samples->count, sizeof(double), sample_compare);
+	report_printf(report,
+		"{\"samples\": %zu, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+		samples->count,
+		percentile_get(samples, 50u),
+		percentile_get(samples, 95u),
+		percentile_get(samples, 99u),
+		samples->values[samples->count - 1u],
+		last ? "" : ","
+	);
+}
+
+static bool report_write() {
+	char* const full_filename = alloc_sprintf("%s%s", prog_save_path_get(), report_filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	report_type report = {
+		.file = SDL_RWFromFile(full_filename, "wb"),
+		.failed = false
+	};
+	if (report.file == NULL) {
+		log_printf("Error opening the benchmark report file \"%s\": %s\n", full_filename, SDL_GetError());
+		mem_free(full_filename);
+		return false;
+	}
+
+	const char* vendor;
+	const char* renderer;
+	const char* version;
+	prog_opengl_strings_get(&vendor, &renderer, &version);
+
+	report_printf(&report, "{\n\t\"scene\": \"%s\",\n\t\"frames\": %" PRIu64 ",\n", scene_names[scene], num_frames);
+	if (scene == SCENE_REPLAY) {
+		report_printf(&report, "\t\"capture\": ");
+		report_string(&report, capture_filename);
+		report_printf(&report, ",\n\t\"capture_frames\": %" PRIu64 ",\n", capture_replay_frames_get(replay));
+	}
+	report_printf(&report, "\t\"version\": ");
+	report_string(&report, app_version);
+	report_printf(&report, ",\n\t\"gl_vendor\": ");
+	report_string(&report, vendor);
+	report_printf(&report, ",\n\t\"gl_renderer\": ");
+	report_string(&report, renderer);
+	report_printf(&report, ",\n\t\"gl_version\": ");
+	report_string(&report, version);
+	report_printf(&report, ",\n");
+
+	report_samples(&report, "cpu_tick_ms", &tick_samples, false);
+	report_samples(&report, "render_thread_ms", &render_samples, false);
+	report_samples(&report, "gpu_ms", &gpu_samples, false);
+
+	// Allocations are only counted with memory debugging.
+	#ifdef MEM_DEBUG
+	report_printf(&report,
+		"\t\"allocs_per_frame\": {\"mean\": %.2f, \"max\": %zu, \"tags\": {",
+		(double)frame_allocs_total / (double)num_frames,
+		frame_allocs_max
+	);
+	for (size_t i = 0u; i < MEM_TAG_COUNT; i++) {
+		report_printf(&report,
+			"%s\"%s\": {\"mean\": %.2f, \"max\": %zu}",
+			i > 0u ? ", " : "",
+			tag_names[i],
+			(double)frame_tag_allocs_total[i] / (double)num_frames,
+			frame_tag_allocs_max[i]
+		);
+	}
+	report_printf(&report, "}},\n");
+
+	mem_stats stats;
+	mem_stats_get(&stats);
+	report_printf(&report, "\t\"alloc_sizes\": [");
+	for (size_t i = 0u; i < MEM_HISTOGRAM_BUCKETS; i++) {
+		report_printf(&report, "%s%zu", i > 0u ? ", " : "", stats.histogram[i]);
+	}
+	report_printf(&report, "]\n");
+	#else
+	report_printf(&report, "\t\"allocs_per_frame\": null\n");
+	#endif
+	report_printf(&report, "}\n");
+
+	const bool closed = SDL_RWclose(report.file) == 0;
+	if (report.failed || !closed) {
+		log_printf("Error writing the benchmark report file \"%s\"\n", full_filename);
+		mem_free(full_filename);
+		return false;
+	}
+	log_printf("Wrote the benchmark report to \"%s\"\n", full_filename);
+	mem_free(full_filename);
+	return true;
+}
+
+bool benchmark_tick_end(const uint64_t tick_duration, bool* const quit) {
+	assert(benchmarking);
+
+	*quit = false;
+
+	// One render sample is recorded per frame drawn since the previous tick,
+	// the latest draw's, as the render thread doesn't draw every frame
+	// submitted, and might draw more than once between ticks.
+	uint64_t render_duration;
+	uint64_t draws;
+	prog_render_draw_get(&render_duration, &draws);
+	const size_t allocs = mem_num_allocs();
+	const bool recording = frame >= WARMUP_FRAMES;
+	if (recording) {
+		tick_samples.values[tick_samples.count++] = tick_duration / 1000000.0;
+
+		if (draws != last_draws) {
+			render_samples.values[render_samples.count++] = render_duration / 1000000.0;
+
+			render_stats_type stats;
+			render_stats_get(&stats);
+			if (stats.gpu_timed) {
+				gpu_samples.values[gpu_samples.count++] = stats.frame_gpu_milliseconds;
+			}
+		}
+
+		const size_t frame_allocs = allocs - last_allocs;
+		frame_allocs_total += frame_allocs;
+		if (frame_allocs > frame_allocs_max) {
+			frame_allocs_max = frame_allocs;
+		}
+	}
+	last_draws = draws;
+	last_allocs = allocs;
+
+	#ifdef MEM_DEBUG
+	mem_stats stats;
+	mem_stats_get(&stats);
+	for (size_t i = 0u; i < MEM_TAG_COUNT; i++) {
+		if (recording) {
+			const size_t frame_tag_allocs = stats.tag_allocs[i] - last_tag_allocs[i];
+			frame_tag_allocs_total[i] += frame_tag_allocs;
+			if (frame_tag_allocs > frame_tag_allocs_max[i]) {
+				frame_tag_allocs_max[i] = frame_tag_allocs;
+			}
+		}
+		last_tag_allocs[i] = stats.tag_allocs[i];
+	}
+	#endif
+	frame++;
+
+	if (frame == WARMUP_FRAMES + num_frames) {
+		*quit = true;
+		return report_write();
+	}
+	return true;
+}
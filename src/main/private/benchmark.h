@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Built-in render stress benchmarks, run in place of the app when the program
+ * is started with --benchmark <scene>. Each scene submits deterministic
+ * content every tick, for a fixed number of frames after a warmup; then the
+ * CPU tick time, render thread draw time, GPU frame time and allocations per
+ * frame are written as a JSON report in the save path, and the program quits.
+ * The scenes are:
+ *
+ * sprites: many sprites across multiple sheets, in one layer.
+ * text: heavy text, mostly changing every frame, so the layout cache misses.
+ * layers: many layers of sprites.
+ * churn: sheets drawn in alternate frames under a tiny texture budget, so each
+ * frame reloads a sheet.
+ * replay: frames captured with render_capture_start, replayed in a loop, from
+ * the capture file in the save path given with --benchmark-capture.
+ */
+
+#define BENCHMARK_FRAMES_DEFAULT UINT64_C(1000)
+
+/*
+ * Prepare to run the scene for num_frames frames, writing the report to the
+ * named file in the save path. capture is the filename of the capture the
+ * replay scene replays, or NULL for other scenes. Returns false if the scene
+ * doesn't exist or preparation failed. Must only be called in the main thread,
+ * after the renderer has been initialized.
+ */
+bool benchmark_init(const char* const scene, const uint64_t num_frames, const char* const report_filename, const char* const capture);
+
+void benchmark_deinit();
+
+/*
+ * Submit the scene's content for the current tick, in place of app_update.
+ */
+bool benchmark_update();
+
+/*
+ * Record the tick, which took tick_duration nanoseconds of CPU time in the
+ * main thread. *quit is set to true once every frame has been recorded and the
+ * report written. Returns false if writing the report failed.
+ */
+bool benchmark_tick_end(const uint64_t tick_duration, bool* const quit);
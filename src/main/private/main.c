@@ -26,6 +26,7 @@
 #include "main/private/prog_private.h"
 #include "util/private/mem_private.h"
 #include "util/private/log_private.h"
+#include "util/private/threads.h"
 #include "app/app.h"
 #include "SDL.h"
 #include <stdlib.h>
@@ -84,10 +85,7 @@ int main(int argc, char** argv) {
 		return EXIT_FAILURE;
 	}
 
-#ifdef REALTIME
-	SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "1");
-	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL);
-#endif
+	threads_current_set(THREADS_CLASS_APP);
 
 	quit_status_type quit_status;
 	for (
@@ -97,15 +95,13 @@ int main(int argc, char** argv) {
 	) {
 	}
 
-#ifdef REALTIME
-	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_NORMAL);
-	SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "0");
-#endif
+	threads_current_reset();
 
 	prog_deinit();
 	log_printf("Shut down program\n");
 	SDL_Quit();
 
+	mem_scratch_destroy();
 	if (!mem_deinit()) {
 		quit_status = QUIT_FAILURE;
 	}
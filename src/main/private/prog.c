@@ -23,21 +23,32 @@
  */
 
 #include "main/private/prog_private.h"
+#include "main/private/benchmark.h"
 #include "audio/private/audio_private.h"
+#include "input/private/action_private.h"
+#include "script/private/script_private.h"
 #include "render/private/render_private.h"
+#include "render/private/capture.h"
 #include "render/private/opengl.h"
 #include "util/private/log_private.h"
+#include "util/private/tasks_private.h"
+#include "util/private/threads.h"
 #include "util/private/mem_private.h"
 #include "main/main.h"
+#include "data/data_shared.h"
+#include "data/data_writer.h"
 #include "util/str.h"
+#include "util/ini.h"
 #include "util/log.h"
 #include "util/nanotime.h"
+#include "util/jobs.h"
+#include "util/private/trace_private.h"
 #include "app/app.h"
-#include "lua/lauxlib.h"
 #include "SDL.h"
 #include "SDL_mixer.h"
 #include "SDL_image.h"
 #include <inttypes.h>
+#include <string.h>
 #include <assert.h>
 
 static SDL_atomic_t quit_status = { QUIT_NOT };
@@ -46,11 +57,25 @@ static char* resource_path = NULL;
 static char* save_path = NULL;
 static bool paths_inited = false;
 
+/*
+ * Created before the threads using it are started, and destroyed after they're
+ * finished, so it's the same for every thread while they're running.
+ */
+static data_shared_object* data_shared = NULL;
+static data_writer_object* data_writer = NULL;
+
 static bool img_inited_flag = false;
 static bool mix_inited_flag = false;
 static bool window_inited_flag = false;
 static bool audio_inited_flag = false;
+static bool audio_open_started_flag = false;
 static bool libs_inited_flag = false;
+static bool jobs_inited_flag = false;
+static bool log_deferred_inited_flag = false;
+static bool trace_inited_flag = false;
+static bool benchmark_inited_flag = false;
+static bool script_inited_flag = false;
+static bool tasks_inited_flag = false;
 
 static SDL_atomic_t sync_threads_mem_barrier = { 0 };
 static SDL_sem* log_filename_sem = NULL;
@@ -94,6 +119,13 @@ static int render_height = 0;
  */
 static SDL_atomic_t render_stepper_init_flag = { 0 };
 
+/*
+ * Set by the main thread upon window events, which can change what's on screen
+ * without the frames changing, so the render thread draws the next frame even
+ * if it's idle.
+ */
+static SDL_atomic_t render_redraw_flag = { 0 };
+
 /*
  * On platforms whose pointers are 64-bit or larger, we can use pointer atomics
  * instead of spinlocks. uintptr_t support is required for this to be fully
@@ -106,14 +138,110 @@ static SDL_atomic_t render_stepper_init_flag = { 0 };
 #ifdef SPINLOCK_FOR_UINT64
 static SDL_SpinLock render_frame_duration_lock;
 static uint64_t render_frame_duration = 0u;
+static SDL_SpinLock input_latency_lock;
+static uint64_t input_latency = 0u;
 #else
 static void* render_frame_duration = NULL;
+static void* input_latency = NULL;
 #endif
 
+static SDL_atomic_t low_latency_flag = { 0 };
+static SDL_atomic_t interpolation_flag = { 0 };
+
+/*
+ * The duration of the latest frame draw in the render thread, and the number
+ * of frames drawn, for benchmarking; and the number of idle frames skipped.
+ */
+static SDL_SpinLock render_draw_lock;
+static uint64_t render_draw_duration = 0u;
+static uint64_t render_draws = 0u;
+static uint64_t render_idle_skips = 0u;
+
+/*
+ * The OpenGL implementation's strings, set by the render thread before the app
+ * is initialized.
+ */
+static char opengl_vendor[128] = "";
+static char opengl_renderer[128] = "";
+static char opengl_version[128] = "";
+
+/*
+ * The time input was last sampled in the main thread, sent along with each
+ * frame in low latency mode, and the input time of the latest frame drawn, only
+ * used in the render thread.
+ */
+static uint64_t input_sample_time = 0u;
+static uint64_t drawn_input_time = 0u;
+
+/*
+ * In low latency mode, frames are started this fraction of the refresh
+ * duration earlier than the estimated time needed to draw them, as a margin for
+ * frames taking longer than estimated.
+ */
+#define LOW_LATENCY_MARGIN_DIVISOR UINT64_C(8)
+
 static nanotime_step_data main_stepper;
 
 static SDL_atomic_t prog_inited_flag = { 0 };
 
+/*
+ * Initialization runs as a graph of stages, with stages independent of each
+ * other overlapped in separate threads:
+ *
+ * jobs -> libs -+-> render thread -+-> render (render thread) -+-> app
+ *               |                  \-> audio -----------------/
+ *               \-> audio device (audio open thread) -/
+ *
+ * The audio device is opened while the window is created and the render thread
+ * compiles shaders and mounts the resource pack, and the audio data cache is
+ * created while the render thread initializes. No stage after libs waits on
+ * another until app initialization, which needs them all. Every stage's times
+ * are recorded, and logged once the program has initialized; the audio stage
+ * starts when the device starts opening.
+ */
+typedef enum startup_stage {
+	STARTUP_STAGE_JOBS,
+	STARTUP_STAGE_LIBS,
+	STARTUP_STAGE_RENDER_THREAD,
+	STARTUP_STAGE_RENDER,
+	STARTUP_STAGE_AUDIO,
+	STARTUP_STAGE_APP,
+	STARTUP_STAGE_NUM
+} startup_stage;
+
+static const char* const startup_stage_names[STARTUP_STAGE_NUM] = {
+	"jobs",
+	"libs",
+	"render thread",
+	"render",
+	"audio",
+	"app"
+};
+
+static uint64_t startup_time;
+static uint64_t startup_starts[STARTUP_STAGE_NUM];
+static uint64_t startup_ends[STARTUP_STAGE_NUM];
+
+static void startup_stage_begin(const startup_stage stage) {
+	startup_starts[stage] = nanotime_now();
+}
+
+static void startup_stage_end(const startup_stage stage) {
+	startup_ends[stage] = nanotime_now();
+}
+
+static void startup_times_log() {
+	const uint64_t now_max = nanotime_now_max();
+	for (startup_stage stage = 0; stage < STARTUP_STAGE_NUM; stage++) {
+		log_printf("Startup stage %s: started at %.3f ms, took %.3f ms\n",
+			startup_stage_names[stage],
+			nanotime_interval(startup_time, startup_starts[stage], now_max) / 1000000.0,
+			nanotime_interval(startup_starts[stage], startup_ends[stage], now_max) / 1000000.0
+		);
+	}
+	log_printf("Startup took %.3f ms in total\n", nanotime_interval(startup_time, nanotime_now(), now_max) / 1000000.0);
+}
+
 /*
  * Some platforms don't work properly when attempting to create an OpenGL
  * context in a non-main thread. Managing creation/destruction of the context in
@@ -293,9 +421,79 @@ static void paths_deinit() {
 	paths_inited = false;
 }
 
+/*
+ * Loads the thread scheduling config, overriding the defaults of the classes
+ * that have a section in the config file. Each thread applies its class' config
+ * itself when it starts, so this has to be run before any threads are started.
+ */
+static void threads_config_load() {
+	data_load_status status;
+	data_shared_entry* const entry = data_shared_acquire(data_shared, DATA_TYPE_RAW, DATA_PATH_SAVE_THEN_RESOURCE, THREADS_CONFIG_FILENAME, &status);
+	if (entry == NULL) {
+		return;
+	}
+	const data_object* const data = data_shared_data_get(entry);
+
+	ini_view_object* const ini = ini_view_create((const char*)data->raw->bytes, data->raw->size);
+	if (ini == NULL) {
+		data_shared_release(data_shared, entry);
+		log_printf("Error parsing thread config file \"%s\", using the default thread config\n", THREADS_CONFIG_FILENAME);
+		return;
+	}
+
+	for (threads_class class = 0; class < THREADS_CLASS_NUM; class++) {
+		const char* const section = threads_class_name_get(class);
+		threads_config config;
+		threads_config_get(class, &config);
+
+		const ini_string cores = ini_view_get(ini, ini_view_resolve(ini, section, "cores"));
+		if (cores.text != NULL && !threads_cores_parse(cores.text, cores.length, &config.cores)) {
+			log_printf("Invalid cores \"%.*s\" for the %s threads in the thread config, using the default cores\n", (int)cores.length, cores.text, section);
+		}
+
+		const ini_string priority = ini_view_get(ini, ini_view_resolve(ini, section, "priority"));
+		if (priority.text != NULL) {
+			threads_priority i;
+			for (i = 0; i < THREADS_PRIORITY_NUM; i++) {
+				const char* const name = threads_priority_name_get(i);
+				if (priority.length == strlen(name) && memcmp(priority.text, name, priority.length) == 0) {
+					break;
+				}
+			}
+			if (i < THREADS_PRIORITY_NUM) {
+				config.priority = i;
+			}
+			else {
+				log_printf("Unknown priority \"%.*s\" for the %s threads in the thread config, using the default priority\n", (int)priority.length, priority.text, section);
+			}
+		}
+
+		threads_config_set(class, &config);
+	}
+
+	ini_view_destroy(ini);
+	data_shared_release(data_shared, entry);
+}
+
 static bool libs_init() {
 	log_printf("Initializing libraries\n");
 
+	// The audio device is opened in its own thread while the rest of the
+	// program initializes, after SDL_mixer is initialized, as initializing
+	// SDL_mixer while opening the device isn't thread safe.
+	if (Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3 | MIX_INIT_MOD) != (MIX_INIT_OGG | MIX_INIT_MP3 | MIX_INIT_MOD)) {
+		log_printf("Error: %s\n", Mix_GetError());
+		prog_deinit();
+		return false;
+	}
+	mix_inited_flag = true;
+
+	startup_stage_begin(STARTUP_STAGE_AUDIO);
+	audio_open_started_flag = audio_open_start();
+	if (!audio_open_started_flag) {
+		log_printf("Failed to start opening the audio device in its own thread, opening it later\n");
+	}
+
 	if (
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3) < 0 ||
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3) < 0 ||
@@ -304,6 +502,9 @@ static bool libs_init() {
 		SDL_GL_SetAttribute(SDL_GL_GREEN_SIZE, 8) < 0 ||
 		SDL_GL_SetAttribute(SDL_GL_BLUE_SIZE, 8) < 0 ||
 		SDL_GL_SetAttribute(SDL_GL_ALPHA_SIZE, 8) < 0
+#ifdef OPENGL_DEBUG
+		|| SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG) < 0
+#endif
 	) {
 		log_printf("Error: %s\n", SDL_GetError());
 		prog_deinit();
@@ -323,13 +524,6 @@ static bool libs_init() {
 	render_height = 480;
 	SDL_AtomicUnlock(&render_size_lock);
 
-	if (Mix_Init(MIX_INIT_OGG | MIX_INIT_MP3 | MIX_INIT_MOD) != (MIX_INIT_OGG | MIX_INIT_MP3 | MIX_INIT_MOD)) {
-		log_printf("Error: %s\n", Mix_GetError());
-		prog_deinit();
-		return false;
-	}
-	mix_inited_flag = true;
-
 	if (IMG_Init(IMG_INIT_PNG) != IMG_INIT_PNG) {
 		log_printf("Error: %s\n", IMG_GetError());
 		prog_deinit();
@@ -337,6 +531,8 @@ static bool libs_init() {
 	}
 	img_inited_flag = true;
 
+	action_init();
+
 	libs_inited_flag = true;
 	log_printf("Successfully initialized libraries\n");
 
@@ -348,6 +544,7 @@ static void libs_deinit() {
 		return;
 	}
 
+	action_deinit();
 	if (img_inited_flag) {
 		IMG_Quit();
 	}
@@ -445,7 +642,49 @@ static uint64_t frame_duration_get() {
 	}
 }
 
+static void render_low_latency_set(frames_object* const frames, const bool low_latency) {
+	log_printf("Switching to %s frame pacing\n", low_latency ? "low latency" : "default");
+	if (SDL_GL_SetSwapInterval(low_latency ? 1 : 0) < 0) {
+		log_printf("Error setting the swap interval for %s frame pacing: %s\n", low_latency ? "low latency" : "default", SDL_GetError());
+	}
+	frames_synced_set(frames, low_latency);
+}
+
+static void render_stats_set(const uint64_t frame_duration, const uint64_t latency) {
+#ifdef SPINLOCK_FOR_UINT64
+	SDL_AtomicLock(&render_frame_duration_lock);
+	render_frame_duration = frame_duration;
+	SDL_AtomicUnlock(&render_frame_duration_lock);
+	SDL_AtomicLock(&input_latency_lock);
+	input_latency = latency;
+	SDL_AtomicUnlock(&input_latency_lock);
+#else
+	SDL_AtomicSetPtr(&render_frame_duration, (void*)(uintptr_t)frame_duration);
+	SDL_AtomicSetPtr(&input_latency, (void*)(uintptr_t)latency);
+#endif
+}
+
+static void render_draw_record(const uint64_t duration) {
+	SDL_AtomicLock(&render_draw_lock);
+	render_draw_duration = duration;
+	render_draws++;
+	SDL_AtomicUnlock(&render_draw_lock);
+}
+
+static void render_idle_skips_record(const uint64_t idle_skips) {
+	SDL_AtomicLock(&render_draw_lock);
+	render_idle_skips = idle_skips;
+	SDL_AtomicUnlock(&render_draw_lock);
+}
+
+static void opengl_string_copy(char* const dst, const size_t size, const GLenum name) {
+	const GLubyte* const string = glGetString(name);
+	snprintf(dst, size, "%s", string != NULL ? (const char*)string : "");
+}
+
 static int SDLCALL render_thread_func(void* data) {
+	mem_tag_set(MEM_TAG_RENDER);
+
 	// Ensure quit_status in this thread is at the oldest the first value
 	// written in the main thread.
 	SDL_AtomicGet(&quit_status);
@@ -466,9 +705,12 @@ static int SDLCALL render_thread_func(void* data) {
 	log_printf("Successfully set render thread's log filename (log_render.txt)\n");
 #endif
 
+	threads_current_set(THREADS_CLASS_RENDER);
+
 	SEM_POST(log_filename_sem);
 
 	SEM_WAIT(render_start_sem);
+	startup_stage_begin(STARTUP_STAGE_RENDER);
 
 	log_printf("Getting window object for rendering\n");
 	SDL_Window* const window = prog_window_get();
@@ -527,9 +769,17 @@ static int SDLCALL render_thread_func(void* data) {
 		return EXIT_FAILURE;
 	}
 
+	opengl_string_copy(opengl_vendor, sizeof(opengl_vendor), GL_VENDOR);
+	opengl_string_copy(opengl_renderer, sizeof(opengl_renderer), GL_RENDERER);
+	opengl_string_copy(opengl_version, sizeof(opengl_version), GL_VERSION);
+	log_printf("OpenGL vendor: %s\n", opengl_vendor);
+	log_printf("OpenGL renderer: %s\n", opengl_renderer);
+	log_printf("OpenGL version: %s\n", opengl_version);
+
 	SDL_MemoryBarrierRelease();
 	SDL_AtomicSetPtr((void**)&render_frames, frames);
 
+	startup_stage_end(STARTUP_STAGE_RENDER);
 	SEM_POST(init_app_sem);
 
 	log_printf("Entering the render loop\n");
@@ -553,8 +803,22 @@ static int SDLCALL render_thread_func(void* data) {
 	stepper.sleep_duration = 0u;
 	bool skipped = false;
 	frames_status_type last_status = FRAMES_STATUS_NO_PRESENT;
+
+	// In low latency mode, the stepper isn't used; instead, each frame is
+	// started at the time scheduled from the timing of the previous frame,
+	// estimating the next vertical blank as one refresh duration after the
+	// previous frame was presented.
+	bool low_latency = false;
+	bool scheduled = false;
+
+	// While interpolating, the latest frame is redrawn at the display's
+	// refresh rate, so the render thread doesn't wait for each app tick.
+	bool interpolation = false;
+	uint64_t next_start = 0u;
+	uint64_t work_estimate = 0u;
+	uint64_t last_presented = 0u;
 	while (true) {
-		if (SDL_SemWait(render_now_sem) < 0) {
+		if ((interpolation ? SDL_SemTryWait(render_now_sem) : SDL_SemWait(render_now_sem)) < 0) {
 			log_printf("Error waiting to render in the render thread: %s\n", SDL_GetError());
 			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
 			exit_code = EXIT_FAILURE;
@@ -565,7 +829,45 @@ static int SDLCALL render_thread_func(void* data) {
 			break;
 		}
 
+		if (!!SDL_AtomicGet(&low_latency_flag) != low_latency) {
+			low_latency = !low_latency;
+			render_low_latency_set(frames, low_latency);
+			scheduled = false;
+			work_estimate = 0u;
+			render_stats_set(0u, 0u);
+		}
+
+		if ((!low_latency && SDL_AtomicGet(&interpolation_flag)) != interpolation) {
+			interpolation = !interpolation;
+			log_printf("Switching interpolation between app ticks %s\n", interpolation ? "on" : "off");
+			frames_interpolated_set(frames, interpolation);
+			render_interpolated_set(interpolation);
+			skipped = true;
+		}
+
+		if (low_latency && scheduled) {
+			const uint64_t now = nanotime_now();
+			if (now < next_start) {
+				nanotime_sleep(next_start - now);
+			}
+		}
+
+		if (SDL_AtomicCAS(&render_redraw_flag, 1, 0)) {
+			frames_redraw(frames);
+		}
+
+		const uint64_t draw_start = nanotime_now();
+		trace_begin("frames_draw_latest");
 		const frames_status_type frames_status = frames_draw_latest(frames);
+		trace_end();
+		mem_scratch_reset();
+		if (frames_status == FRAMES_STATUS_PRESENT) {
+			render_draw_record(nanotime_interval(draw_start, nanotime_now(), now_max));
+		}
+		else if (frames_status == FRAMES_STATUS_IDLE) {
+			render_idle_skips_record(frames_idle_skips_get(frames));
+		}
+		trace_frame("render frame");
 		if (frames_status == FRAMES_STATUS_ERROR) {
 			log_printf("Error drawing latest frame\n");
 			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
@@ -574,8 +876,39 @@ static int SDLCALL render_thread_func(void* data) {
 		}
 
 		const uint64_t frame_duration = frame_duration_get();
+		frames_timing_type timing;
+		if (low_latency) {
+			if (frames_status == FRAMES_STATUS_PRESENT && frames_timing_get(frames, &timing)) {
+				// The estimate rises immediately to slower frames, but only
+				// decays slowly, so one fast frame doesn't make the next miss
+				// its vertical blank.
+				const uint64_t work = nanotime_interval(timing.started, timing.finished, now_max);
+				if (work > work_estimate) {
+					work_estimate = work;
+				}
+				else {
+					work_estimate -= (work_estimate - work) / 8u;
+				}
+
+				const uint64_t lead = work_estimate + frame_duration / LOW_LATENCY_MARGIN_DIVISOR;
+				next_start = timing.presented + (lead < frame_duration ? frame_duration - lead : 0u);
+				scheduled = true;
+
+				render_stats_set(
+					last_presented != 0u ? nanotime_interval(last_presented, timing.presented, now_max) : frame_duration,
+					drawn_input_time != 0u && timing.presented > drawn_input_time ? timing.presented - drawn_input_time : 0u
+				);
+				last_presented = timing.presented;
+			}
+
+			// Switching back to default pacing always starts a new step.
+			skipped = true;
+			last_status = frames_status;
+			continue;
+		}
+		last_presented = 0u;
 		uint64_t max_duration;
-		if (SDL_AtomicGet(&app_thread_inited) && app_tick_duration > frame_duration) {
+		if (!interpolation && SDL_AtomicGet(&app_thread_inited) && app_tick_duration > frame_duration) {
 			max_duration = app_tick_duration;
 		}
 		else {
@@ -590,21 +923,20 @@ static int SDLCALL render_thread_func(void* data) {
 		// However, we *do* want to take advantage of the accumulator
 		// accounting in nanotime_step, so we don't want to always reinitialize
 		// the stepper, which resets the accumulator to zero.
-		if (skipped || stepper.sleep_duration != max_duration || last_status != FRAMES_STATUS_PRESENT || SDL_AtomicCAS(&render_stepper_init_flag, 1, 0)) {
+		//
+		// Restarting keeps the stepper's sleep calibration, only the first
+		// step having to calibrate from scratch.
+		if (stepper.sleep_duration == 0u) {
 			nanotime_step_init(&stepper, max_duration, now_max, nanotime_now, nanotime_sleep);
 		}
+		else if (skipped || stepper.sleep_duration != max_duration || (last_status != FRAMES_STATUS_PRESENT && last_status != FRAMES_STATUS_IDLE) || SDL_AtomicCAS(&render_stepper_init_flag, 1, 0)) {
+			nanotime_step_restart(&stepper, max_duration);
+		}
 		last_status = frames_status;
 
 		const uint64_t start = stepper.sleep_point;
 		skipped = !nanotime_step(&stepper);
-		const uint64_t interval = nanotime_interval(start, stepper.sleep_point, now_max);
-#ifdef SPINLOCK_FOR_UINT64
-		SDL_AtomicLock(&render_frame_rate_lock);
-		render_frame_duration = interval;
-		SDL_AtomicUnlock(&render_frame_rate_lock);
-#else
-		SDL_AtomicSetPtr(&render_frame_duration, (void*)(uintptr_t)interval);
-#endif
+		render_stats_set(nanotime_interval(start, stepper.sleep_point, now_max), 0u);
 	}
 
 	log_printf("Broke out of the render loop\n");
@@ -723,17 +1055,20 @@ static bool app_thread_init() {
 	SDL_AtomicGetPtr((void**)&render_frames);
 	SDL_MemoryBarrierAcquire();
 
-	log_printf("Initializing Lua scripting support\n");
-	// TODO: Implement Lua scripting support for app code. For now, this just
-	// tests that the Lua library is available and working.
-	lua_State* const lua_state = lua_newstate(mem_lua_alloc, NULL);
-	if (lua_state != NULL) {
-		lua_close(lua_state);
+	log_printf("Initializing the task scheduler\n");
+	if (!tasks_init()) {
+		log_printf("Error initializing the task scheduler\n");
+		return false;
 	}
-	else {
+	tasks_inited_flag = true;
+	log_printf("Successfully initialized the task scheduler\n");
+
+	log_printf("Initializing Lua scripting support\n");
+	if (!script_init()) {
 		log_printf("Error setting up Lua scripting for the app\n");
 		return false;
 	}
+	script_inited_flag = true;
 	log_printf("Successfully initialized Lua scripting support\n");
 
 	log_printf("Initializing the app API\n");
@@ -802,6 +1137,62 @@ bool prog_init(const int argc, char** const argv) {
 		}
 	}
 
+	data_shared = data_shared_create(resource_path, save_path);
+	if (data_shared == NULL) {
+		log_printf("Error creating the shared data cache\n");
+		goto fail;
+	}
+
+	// Loaded as soon as the config file can be read, before any of the
+	// program's threads are started, as each applies its config when it
+	// starts; the data writer and log writer threads are started next.
+	threads_config_load();
+
+	data_writer = data_writer_create(save_path);
+	if (data_writer == NULL) {
+		log_printf("Error creating the data writer\n");
+		goto fail;
+	}
+
+	const char* benchmark_scene = NULL;
+	uint64_t benchmark_frames = BENCHMARK_FRAMES_DEFAULT;
+	const char* benchmark_report = "benchmark.json";
+	const char* benchmark_capture = NULL;
+	const char* capture = NULL;
+	uint64_t capture_frames = CAPTURE_FRAMES_DEFAULT;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--low-latency") == 0) {
+			prog_low_latency_set(true);
+		}
+		else if (strcmp(argv[i], "--interpolate") == 0) {
+			prog_interpolation_set(true);
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0 && argc > i + 1) {
+			benchmark_scene = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "--benchmark-frames") == 0 && argc > i + 1) {
+			benchmark_frames = strtoull(argv[i + 1], NULL, 10);
+			i++;
+		}
+		else if (strcmp(argv[i], "--benchmark-report") == 0 && argc > i + 1) {
+			benchmark_report = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "--benchmark-capture") == 0 && argc > i + 1) {
+			benchmark_capture = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && argc > i + 1) {
+			capture = argv[i + 1];
+			i++;
+		}
+		else if (strcmp(argv[i], "--capture-frames") == 0 && argc > i + 1) {
+			capture_frames = strtoull(argv[i + 1], NULL, 10);
+			i++;
+		}
+	}
+
 	log_printf("Initializing thread-safe log support\n");
 #ifdef STDOUT_LOG
 	{
@@ -836,6 +1227,35 @@ bool prog_init(const int argc, char** const argv) {
 	log_printf("Successfully set log filename for the main thread (log_main.txt)\n");
 #endif
 
+	#ifdef STDOUT_LOG
+	log_deferred_inited_flag = log_deferred_init("stdout");
+	#else
+	log_deferred_inited_flag = log_deferred_init("log_deferred.txt");
+	#endif
+	assert(log_deferred_inited_flag);
+	if (!log_deferred_inited_flag) {
+		log_printf("Failed initializing deferred logging\n");
+		goto fail;
+	}
+
+	trace_inited_flag = trace_init();
+	assert(trace_inited_flag);
+	if (!trace_inited_flag) {
+		goto fail;
+	}
+
+	// The job system is initialized in the main thread, so app_update can
+	// push jobs to its own deque.
+	startup_time = nanotime_now();
+	startup_stage_begin(STARTUP_STAGE_JOBS);
+	jobs_inited_flag = jobs_init(0u);
+	assert(jobs_inited_flag);
+	if (!jobs_inited_flag) {
+		goto fail;
+	}
+	startup_stage_end(STARTUP_STAGE_JOBS);
+
+	startup_stage_begin(STARTUP_STAGE_LIBS);
 	{
 		const bool inited = libs_init();
 		assert(inited);
@@ -843,25 +1263,52 @@ bool prog_init(const int argc, char** const argv) {
 			goto fail;
 		}
 	}
+	startup_stage_end(STARTUP_STAGE_LIBS);
 
+	// The render thread is started before audio is initialized, so the
+	// render thread initializes while audio is initialized in this thread.
+	startup_stage_begin(STARTUP_STAGE_RENDER_THREAD);
+	{
+		const bool inited = render_thread_init();
+		assert(inited);
+		if (!inited) {
+			goto fail;
+		}
+	}
+	startup_stage_end(STARTUP_STAGE_RENDER_THREAD);
+
+	if (!audio_open_started_flag) {
+		startup_stage_begin(STARTUP_STAGE_AUDIO);
+	}
 	audio_inited_flag = audio_init();
+	audio_open_started_flag = false;
 	assert(audio_inited_flag);
 	if (!audio_inited_flag) {
+		// The render thread is already running, so it must be told to quit.
+		SDL_AtomicSet(&quit_status, QUIT_FAILURE);
 		goto fail;
 	}
+	startup_stage_end(STARTUP_STAGE_AUDIO);
 
+	startup_stage_begin(STARTUP_STAGE_APP);
 	{
-		const bool inited = render_thread_init();
+		const bool inited = app_thread_init();
 		assert(inited);
 		if (!inited) {
 			goto fail;
 		}
 	}
+	startup_stage_end(STARTUP_STAGE_APP);
+	startup_times_log();
 
-	{
-		const bool inited = app_thread_init();
-		assert(inited);
-		if (!inited) {
+	if (capture != NULL && (capture_frames == 0u || !render_capture_start(capture, capture_frames))) {
+		log_printf("Failed to start capturing frames to \"%s\"\n", capture);
+		goto fail;
+	}
+
+	if (benchmark_scene != NULL) {
+		benchmark_inited_flag = benchmark_init(benchmark_scene, benchmark_frames, benchmark_report, benchmark_capture);
+		if (!benchmark_inited_flag) {
 			goto fail;
 		}
 	}
@@ -880,13 +1327,59 @@ bool prog_init(const int argc, char** const argv) {
 void prog_deinit() {
 	assert(main_thread_is_this_thread());
 
+	if (tasks_inited_flag) {
+		tasks_deinit();
+		tasks_inited_flag = false;
+	}
+
+	if (script_inited_flag) {
+		script_deinit();
+		script_inited_flag = false;
+	}
+
 	render_thread_deinit();
 
 	sems_deinit();
 
-	if (audio_inited_flag) {
+	if (benchmark_inited_flag) {
+		benchmark_deinit();
+		benchmark_inited_flag = false;
+	}
+
+	if (jobs_inited_flag) {
+		jobs_deinit();
+		jobs_inited_flag = false;
+	}
+
+	if (trace_inited_flag) {
+		if (!trace_export("trace.json")) {
+			log_printf("Error exporting the trace\n");
+		}
+		trace_deinit();
+		trace_inited_flag = false;
+	}
+
+	if (log_deferred_inited_flag) {
+		if (!log_deferred_deinit()) {
+			log_printf("Error deinitializing deferred logging\n");
+		}
+		log_deferred_inited_flag = false;
+	}
+
+	if (audio_inited_flag || audio_open_started_flag) {
 		audio_deinit();
 		audio_inited_flag = false;
+		audio_open_started_flag = false;
+	}
+
+	if (data_writer != NULL) {
+		data_writer_destroy(data_writer);
+		data_writer = NULL;
+	}
+
+	if (data_shared != NULL) {
+		data_shared_destroy(data_shared);
+		data_shared = NULL;
 	}
 
 	paths_deinit();
@@ -915,6 +1408,18 @@ bool prog_inited() {
 	return !!current_prog_inited_flag;
 }
 
+data_shared_object* prog_data_shared_get() {
+	assert(data_shared != NULL);
+
+	return data_shared;
+}
+
+data_writer_object* prog_data_writer_get() {
+	assert(data_writer != NULL);
+
+	return data_writer;
+}
+
 SDL_Window* prog_window_get() {
 	SDL_Window* const current_window = SDL_AtomicGetPtr((void**)&window);
 	SDL_MemoryBarrierAcquire();
@@ -929,6 +1434,13 @@ void prog_render_size_get(size_t* const width, size_t* const height) {
 	SDL_AtomicUnlock(&render_size_lock);;
 }
 
+void prog_app_step_stats_get(nanotime_step_stats* const stats) {
+	assert(main_thread_is_this_thread());
+	assert(stats != NULL);
+
+	nanotime_step_stats_get(&main_stepper, stats);
+}
+
 uint64_t prog_render_frame_duration_get() {
 #ifdef SPINLOCK_FOR_UINT64
 	SDL_AtomicLock(&render_frame_duration_lock);
@@ -940,6 +1452,66 @@ uint64_t prog_render_frame_duration_get() {
 #endif
 }
 
+void prog_low_latency_set(const bool low_latency) {
+	SDL_AtomicSet(&low_latency_flag, low_latency ? 1 : 0);
+}
+
+bool prog_low_latency_get() {
+	return !!SDL_AtomicGet(&low_latency_flag);
+}
+
+void prog_interpolation_set(const bool interpolation) {
+	SDL_AtomicSet(&interpolation_flag, interpolation ? 1 : 0);
+}
+
+bool prog_interpolation_get() {
+	return !!SDL_AtomicGet(&interpolation_flag);
+}
+
+void prog_app_tick_get(uint64_t* const point, uint64_t* const duration) {
+	assert(main_thread_is_this_thread());
+	assert(point != NULL);
+	assert(duration != NULL);
+
+	*point = main_stepper.sleep_point;
+	*duration = app_tick_duration;
+}
+
+void prog_render_draw_get(uint64_t* const duration, uint64_t* const draws) {
+	SDL_AtomicLock(&render_draw_lock);
+	if (duration != NULL) {
+		*duration = render_draw_duration;
+	}
+	if (draws != NULL) {
+		*draws = render_draws;
+	}
+	SDL_AtomicUnlock(&render_draw_lock);
+}
+
+void prog_opengl_strings_get(const char** const vendor, const char** const renderer, const char** const version) {
+	*vendor = opengl_vendor;
+	*renderer = opengl_renderer;
+	*version = opengl_version;
+}
+
+uint64_t prog_render_idle_skips_get() {
+	SDL_AtomicLock(&render_draw_lock);
+	const uint64_t idle_skips = render_idle_skips;
+	SDL_AtomicUnlock(&render_draw_lock);
+	return idle_skips;
+}
+
+uint64_t prog_input_latency_get() {
+#ifdef SPINLOCK_FOR_UINT64
+	SDL_AtomicLock(&input_latency_lock);
+	const uint64_t latency = input_latency;
+	SDL_AtomicUnlock(&input_latency_lock);
+	return latency;
+#else
+	return (uint64_t)(uintptr_t)SDL_AtomicGetPtr(&input_latency);
+#endif
+}
+
 static void SDLCALL thread_name_destructor(void* name) {
 	mem_free(name);
 }
@@ -1006,6 +1578,7 @@ static int SDLCALL event_filter(void* userdata, SDL_Event* event) {
 	switch (event->type) {
 	case SDL_WINDOWEVENT:
 		SDL_AtomicSet(&render_stepper_init_flag, 1);
+		SDL_AtomicSet(&render_redraw_flag, 1);
 		switch (event->window.event) {
 		case SDL_WINDOWEVENT_SIZE_CHANGED:
 			SDL_AtomicLock(&render_size_lock);
@@ -1024,11 +1597,62 @@ static int SDLCALL event_filter(void* userdata, SDL_Event* event) {
 		break;
 
 	default:
+		action_event_handle(event);
 		break;
 	}
 	return 1;
 }
 
+void prog_input_sample() {
+	assert(main_thread_is_this_thread());
+
+	SDL_PumpEvents();
+	SDL_FilterEvents(event_filter, NULL);
+	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+	action_sample();
+	input_sample_time = nanotime_now();
+}
+
+static bool input_time_update_func(void* const state) {
+	drawn_input_time = *(const uint64_t*)state;
+
+	return true;
+}
+
+/*
+ * Send the time input was last sampled along with the frame, for the render
+ * thread to measure the frame's latency once it's presented.
+ */
+static bool input_time_send() {
+	uint64_t* const state = frames_alloc(render_frames, sizeof(uint64_t));
+	if (state == NULL) {
+		return false;
+	}
+	*state = input_sample_time;
+
+	static const command_funcs funcs = {
+		.update = input_time_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, state);
+}
+
+/*
+ * The time left in the current app tick, before the main stepper's deadline.
+ */
+static uint64_t tick_time_left() {
+	if (main_stepper.accumulator >= main_stepper.sleep_duration) {
+		return 0u;
+	}
+
+	const uint64_t total = main_stepper.sleep_duration - main_stepper.accumulator;
+	const uint64_t elapsed = nanotime_interval(main_stepper.sleep_point, nanotime_now(), main_stepper.now_max);
+	return elapsed < total ? total - elapsed : 0u;
+}
+
 quit_status_type prog_update() {
 	#ifndef NDEBUG
 	const int prog_inited = SDL_AtomicGet(&prog_inited_flag);
@@ -1037,9 +1661,9 @@ quit_status_type prog_update() {
 	#endif
 	assert(main_thread_is_this_thread());
 
-	SDL_PumpEvents();
-	SDL_FilterEvents(event_filter, NULL);
-	SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+	trace_begin("prog_update");
+	const uint64_t tick_start = nanotime_now();
+	prog_input_sample();
 	if (quit_prog) {
 		log_printf("Quitting program due to a program quit request\n");
 		SDL_AtomicSet(&quit_status, QUIT_SUCCESS);
@@ -1058,7 +1682,11 @@ quit_status_type prog_update() {
 
 	bool quit_app = false;
 	{
-		const bool updated = app_update(&quit_app, main_stepper.sleep_point);
+		trace_begin("app_update");
+		const bool updated = benchmark_inited_flag ?
+			benchmark_update() :
+			app_update(&quit_app, main_stepper.sleep_point);
+		trace_end();
 		assert(updated);
 		if (!updated) {
 			log_printf("Quitting due to an app update error\n");
@@ -1067,6 +1695,16 @@ quit_status_type prog_update() {
 		}
 	}
 
+	if (prog_low_latency_get()) {
+		const bool sent = input_time_send();
+		assert(sent);
+		if (!sent) {
+			log_printf("Quitting due to an error sending the input time to the render thread\n");
+			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
+			goto quit;
+		}
+	}
+
 	{
 		const bool ended = frames_end(render_frames);
 		assert(ended);
@@ -1080,12 +1718,35 @@ quit_status_type prog_update() {
 	if (SDL_SemValue(render_now_sem) == 0) {
 		SDL_SemPost(render_now_sem);
 	}
+	mem_scratch_reset();
+
+	if (benchmark_inited_flag) {
+		const bool recorded = benchmark_tick_end(nanotime_interval(tick_start, nanotime_now(), nanotime_now_max()), &quit_app);
+		if (!recorded) {
+			log_printf("Quitting due to an error writing the benchmark report\n");
+			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
+			goto quit;
+		}
+	}
+
+	{
+		trace_begin("tasks_run");
+		const bool ran = tasks_run(tick_time_left());
+		trace_end();
+		assert(ran);
+		if (!ran) {
+			log_printf("Quitting due to a task error\n");
+			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
+			goto quit;
+		}
+	}
 
 #ifdef STDOUT_LOG
 	{
-		const bool errored = main_stepper.accumulator < main_stepper.sleep_duration && !log_all_output_dequeue(main_stepper.sleep_duration - main_stepper.accumulator);
-		assert(!errored);
-		if (errored) {
+		log_stats stats;
+		log_stats_get(&stats);
+		trace_counter("log queue depth", (double)stats.depth);
+		if (stats.failed) {
 			printf("Quitting due to an error in outputting messages to the unified log output\n");
 			SDL_AtomicSet(&quit_status, QUIT_FAILURE);
 			goto quit;
@@ -1099,17 +1760,29 @@ quit_status_type prog_update() {
 		goto quit;
 	}
 
-	if (!nanotime_step(&main_stepper)) {
+	trace_begin("app tick sleep");
+	const bool stepped = nanotime_step(&main_stepper);
+	trace_end();
+	/*
+	 * This function only runs in the main thread, so static variables are
+	 * allowed.
+	 */
+	static bool skipping = false;
+	if (!stepped) {
 		SDL_AtomicSet(&render_stepper_init_flag, 1);
-		/*
-		 * This function only runs in the main thread, so static variables are
-		 * allowed.
-		 */
-		static uint64_t skips = 0u;
-		skips++;
-		log_printf("Skipped %" PRIu64 " app tick sleeps so far\n", skips);
+		nanotime_step_stats stats;
+		nanotime_step_stats_get(&main_stepper, &stats);
+		// Only the start of each run of skips is logged, the full counts
+		// being available from prog_app_step_stats_get.
+		if (!skipping) {
+			log_printf("Skipped %" PRIu64 " app tick sleeps so far\n", stats.skips);
+		}
+		trace_counter("app tick sleeps skipped", (double)stats.skips);
 	}
+	skipping = !stepped;
 
 	quit:
+	trace_end();
+	trace_frame("app tick");
 	return (quit_status_type)SDL_AtomicGet(&quit_status);
 }
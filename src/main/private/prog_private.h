@@ -24,6 +24,7 @@
  */
 
 #include "main/prog.h"
+#include "data/data_shared.h"
 #include "SDL.h"
 
 /*
@@ -62,6 +63,31 @@ const char* const prog_this_thread_name_get();
  */
 quit_status_type prog_update();
 
+/*
+ * Get the start time and duration of the current app tick. Must only be called
+ * in the main thread.
+ */
+void prog_app_tick_get(uint64_t* const point, uint64_t* const duration);
+
+/*
+ * Get the duration of the render thread's latest frame draw, and the number of
+ * frames drawn so far. Either pointer may be NULL. Can be called from any
+ * thread.
+ */
+void prog_render_draw_get(uint64_t* const duration, uint64_t* const draws);
+
+/*
+ * Get the OpenGL implementation's vendor, renderer and version strings. Only
+ * valid once the program has been initialized.
+ */
+void prog_opengl_strings_get(const char** const vendor, const char** const renderer, const char** const version);
+
+/*
+ * Returns the program's shared data cache, for data loaded in more than one
+ * thread. Can be called from any thread, while the program is initialized.
+ */
+data_shared_object* prog_data_shared_get();
+
 /*
  * Returns the program's window.
  */
@@ -23,6 +23,7 @@
  * SOFTWARE.
  */
 
+#include "data/data_writer.h"
 #include "util/nanotime.h"
 #include <stdlib.h>
 #include <stdbool.h>
@@ -86,6 +87,64 @@ void prog_render_size_get(size_t* const width, size_t* const height);
  */
 uint64_t prog_render_frame_duration_get();
 
+/*
+ * Get the statistics of app tick pacing: the jitter of app tick sleeps, how
+ * many sleeps were skipped to catch up, and the current calibration. Must only
+ * be called in the main thread.
+ */
+void prog_app_step_stats_get(nanotime_step_stats* const stats);
+
+/*
+ * Set whether rendering is paced for low latency, rather than throughput. In
+ * low latency mode, the render thread waits on the GPU to finish each frame,
+ * syncs presents to vertical blank, and starts drawing each frame just in time
+ * to make the next vertical blank, as estimated from how long recent frames
+ * took, so frames spend as little time queued as possible. Off by default, or
+ * on if the program is started with --low-latency. Can be called from any
+ * thread.
+ */
+void prog_low_latency_set(const bool low_latency);
+bool prog_low_latency_get();
+
+/*
+ * Set whether the render thread interpolates between app ticks. While
+ * interpolating, the render thread draws at the display's refresh rate rather
+ * than once per app tick, redrawing the latest app tick's frame with its
+ * tracked sprites, from render_sprites_tracked, blended from their positions
+ * in the previous tick; so motion is smooth on displays faster than the tick
+ * rate, at the cost of a tick of latency. Off by default, or on if the program
+ * is started with --interpolate. Low latency mode takes precedence, turning
+ * interpolation off while it's on. Can be called from any thread.
+ */
+void prog_interpolation_set(const bool interpolation);
+bool prog_interpolation_get();
+
+/*
+ * Read pending input events now, so actions read after it are as recent as
+ * possible. Input is always sampled at the start of each app update; apps that
+ * do work before reading input can call this right before reading input, to
+ * cut latency further. Must only be called in the main thread, during
+ * app_update.
+ */
+void prog_input_sample();
+
+/*
+ * Returns the measured duration from when input was last sampled for the
+ * latest presented frame, to when the GPU finished presenting the frame. Only
+ * measured in low latency mode; 0 is returned otherwise, or before any frame
+ * has been measured.
+ */
+uint64_t prog_input_latency_get();
+
+/*
+ * Returns how many frames the render thread has skipped drawing and presenting
+ * so far, as their content was identical to the frame already on screen, with
+ * no window events since it was drawn. Frames are only skipped if all their
+ * commands are of plain drawing, without effects on later frames, and while
+ * not interpolating. Can be called from any thread.
+ */
+uint64_t prog_render_idle_skips_get();
+
 /*
  * Returns the current resource path.
  */
@@ -95,3 +154,10 @@ const char* prog_resource_path_get();
  * Returns the current save path.
  */
 const char* prog_save_path_get();
+
+/*
+ * Returns the program's data writer, for saves that shouldn't hold up the
+ * thread making them. Queued writes are all written before the program quits.
+ * Can be called from any thread, while the program is initialized.
+ */
+data_writer_object* prog_data_writer_get();
@@ -0,0 +1,729 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/capture.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+/*
+ * Arrays of sprites are padded to start at multiples of the alignment from the
+ * start of the file, so replay can pass them to the render API in place.
+ */
+#define CAPTURE_ALIGNMENT ((size_t)8u)
+
+#define CAPTURE_BYTE_ORDER UINT32_C(0x01020304)
+
+struct capture_object {
+	char* filename;
+	uint64_t num_frames;
+	uint64_t frames;
+
+	unsigned char* bytes;
+	size_t size;
+	size_t capacity;
+	bool failed;
+
+	/*
+	 * Whether each handle has been defined, indexed by handle.
+	 */
+	bool* defined;
+	size_t defined_size;
+};
+
+static void bytes_write(capture_object* const capture, const void* const data, const size_t size) {
+	if (capture->failed) {
+		return;
+	}
+	if (size > capture->capacity - capture->size) {
+		size_t capacity = capture->capacity > 0u ? capture->capacity : (size_t)4096u;
+		while (size > capacity - capture->size) {
+			capacity *= 2u;
+		}
+		unsigned char* const bytes = mem_realloc(capture->bytes, capacity);
+		if (bytes == NULL) {
+			log_printf("Error allocating memory for the render capture\n");
+			capture->failed = true;
+			return;
+		}
+		capture->bytes = bytes;
+		capture->capacity = capacity;
+	}
+	memcpy(capture->bytes + capture->size, data, size);
+	capture->size += size;
+}
+
+static void u8_write(capture_object* const capture, const uint8_t value) {
+	bytes_write(capture, &value, sizeof(value));
+}
+
+static void u32_write(capture_object* const capture, const uint32_t value) {
+	bytes_write(capture, &value, sizeof(value));
+}
+
+static void u64_write(capture_object* const capture, const uint64_t value) {
+	bytes_write(capture, &value, sizeof(value));
+}
+
+static void f32_write(capture_object* const capture, const float value) {
+	bytes_write(capture, &value, sizeof(value));
+}
+
+static void align_write(capture_object* const capture) {
+	static const unsigned char padding[CAPTURE_ALIGNMENT] = { 0u };
+	bytes_write(capture, padding, (CAPTURE_ALIGNMENT - capture->size % CAPTURE_ALIGNMENT) % CAPTURE_ALIGNMENT);
+}
+
+/*
+ * Strings are stored with their length, including the terminator, which is
+ * stored too.
+ */
+static void string_write(capture_object* const capture, const char* const string) {
+	const size_t size = strlen(string) + 1u;
+	u32_write(capture, (uint32_t)size);
+	bytes_write(capture, string, size);
+}
+
+capture_object* capture_create(const char* const filename, const uint64_t num_frames) {
+	assert(filename != NULL);
+	assert(num_frames > 0u);
+
+	capture_object* const capture = mem_calloc(1u, sizeof(capture_object));
+	if (capture == NULL) {
+		return NULL;
+	}
+	capture->filename = mem_malloc(strlen(filename) + 1u);
+	if (capture->filename == NULL) {
+		mem_free(capture);
+		return NULL;
+	}
+	strcpy(capture->filename, filename);
+	capture->num_frames = num_frames;
+
+	bytes_write(capture, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1u);
+	u32_write(capture, CAPTURE_VERSION);
+	u32_write(capture, CAPTURE_BYTE_ORDER);
+	u32_write(capture, (uint32_t)sizeof(sprite_type));
+	u32_write(capture, (uint32_t)sizeof(packed_sprite_type));
+	u32_write(capture, (uint32_t)sizeof(sprite_ex_type));
+	if (capture->failed) {
+		capture_destroy(capture);
+		return NULL;
+	}
+
+	return capture;
+}
+
+void capture_destroy(capture_object* const capture) {
+	assert(capture != NULL);
+
+	mem_free(capture->filename);
+	mem_free(capture->bytes);
+	mem_free(capture->defined);
+	mem_free(capture);
+}
+
+bool capture_handle(capture_object* const capture, const render_handle handle, const data_type type, const char* const filename) {
+	assert(capture != NULL);
+	assert(handle != RENDER_HANDLE_NONE);
+	assert(filename != NULL);
+
+	if (handle >= capture->defined_size) {
+		size_t defined_size = capture->defined_size > 0u ? capture->defined_size : (size_t)64u;
+		while (handle >= defined_size) {
+			defined_size *= 2u;
+		}
+		bool* const defined = mem_realloc(capture->defined, sizeof(bool) * defined_size);
+		if (defined == NULL) {
+			log_printf("Error allocating memory for the render capture\n");
+			capture->failed = true;
+			return false;
+		}
+		memset(defined + capture->defined_size, 0, sizeof(bool) * (defined_size - capture->defined_size));
+		capture->defined = defined;
+		capture->defined_size = defined_size;
+	}
+	if (capture->defined[handle]) {
+		return !capture->failed;
+	}
+	capture->defined[handle] = true;
+
+	u8_write(capture, CAPTURE_RECORD_HANDLE);
+	u32_write(capture, handle);
+	u32_write(capture, (uint32_t)type);
+	string_write(capture, filename);
+	return !capture->failed;
+}
+
+bool capture_start(capture_object* const capture, const render_settings_type* const settings) {
+	assert(capture != NULL);
+	assert(settings != NULL);
+
+	u8_write(capture, CAPTURE_RECORD_START);
+	f32_write(capture, settings->width);
+	f32_write(capture, settings->height);
+	u8_write(capture, settings->packed_sprites);
+	u8_write(capture, settings->layer_stats);
+	u64_write(capture, settings->texture_budget);
+	u8_write(capture, settings->cull_sprites);
+	u8_write(capture, settings->dynamic_resolution);
+	f32_write(capture, settings->target_gpu_milliseconds);
+	f32_write(capture, settings->min_resolution_scale);
+	u8_write(capture, settings->nearest_upscale);
+	return !capture->failed;
+}
+
+static bool capture_write(capture_object* const capture) {
+	SDL_RWops* const file = SDL_RWFromFile(capture->filename, "wb");
+	if (file == NULL) {
+		log_printf("Error opening the render capture file \"%s\": %s\n", capture->filename, SDL_GetError());
+		return false;
+	}
+	const bool written = SDL_RWwrite(file, capture->bytes, 1u, capture->size) == capture->size;
+	const bool closed = SDL_RWclose(file) == 0;
+	if (!written || !closed) {
+		log_printf("Error writing the render capture file \"%s\"\n", capture->filename);
+		return false;
+	}
+	log_printf("Wrote %" PRIu64 " captured frames to \"%s\"\n", capture->frames, capture->filename);
+	return true;
+}
+
+bool capture_end(capture_object* const capture, bool* const done) {
+	assert(capture != NULL);
+	assert(done != NULL);
+
+	*done = false;
+	u8_write(capture, CAPTURE_RECORD_END);
+	if (capture->failed) {
+		return false;
+	}
+
+	capture->frames++;
+	if (capture->frames == capture->num_frames) {
+		*done = true;
+		return capture_write(capture);
+	}
+	return true;
+}
+
+bool capture_clear(capture_object* const capture, const float red, const float green, const float blue, const float alpha) {
+	assert(capture != NULL);
+
+	u8_write(capture, CAPTURE_RECORD_CLEAR);
+	f32_write(capture, red);
+	f32_write(capture, green);
+	f32_write(capture, blue);
+	f32_write(capture, alpha);
+	return !capture->failed;
+}
+
+bool capture_sprites(capture_object* const capture, const capture_record_type type, const render_handle sheet, const size_t layer_index, const size_t num_added, const void* const added_sprites, const size_t sprite_size) {
+	assert(capture != NULL);
+	assert(
+		type == CAPTURE_RECORD_SPRITES ||
+		type == CAPTURE_RECORD_PACKED_SPRITES ||
+		type == CAPTURE_RECORD_SPRITES_EX
+	);
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(added_sprites != NULL);
+
+	u8_write(capture, (uint8_t)type);
+	u32_write(capture, sheet);
+	u32_write(capture, (uint32_t)layer_index);
+	u32_write(capture, (uint32_t)num_added);
+	align_write(capture);
+	bytes_write(capture, added_sprites, sprite_size * num_added);
+	return !capture->failed;
+}
+
+bool capture_string(capture_object* const capture, const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const string) {
+	assert(capture != NULL);
+	assert(font != RENDER_HANDLE_NONE);
+	assert(string != NULL);
+
+	u8_write(capture, CAPTURE_RECORD_STRING);
+	u32_write(capture, font);
+	u32_write(capture, (uint32_t)layer_index);
+	f32_write(capture, x);
+	f32_write(capture, y);
+	f32_write(capture, scale);
+	string_write(capture, string);
+	return !capture->failed;
+}
+
+bool capture_camera(capture_object* const capture, const size_t layer_index, const camera_type* const camera) {
+	assert(capture != NULL);
+
+	u8_write(capture, CAPTURE_RECORD_CAMERA);
+	u32_write(capture, (uint32_t)layer_index);
+	u8_write(capture, camera != NULL);
+	if (camera != NULL) {
+		f32_write(capture, camera->x);
+		f32_write(capture, camera->y);
+		f32_write(capture, camera->zoom);
+		f32_write(capture, camera->rotation);
+	}
+	return !capture->failed;
+}
+
+struct capture_replay_object {
+	unsigned char* bytes;
+	size_t size;
+
+	/*
+	 * The offsets of the start records of the frames.
+	 */
+	size_t* frame_starts;
+	uint64_t num_frames;
+
+	/*
+	 * The render API handles of the capture's handles, indexed by captured
+	 * handle.
+	 */
+	render_handle* handles;
+	size_t handles_size;
+};
+
+/*
+ * Reads past the end of the capture fail the cursor, reading zeros, so the
+ * fields of a record can all be read before checking for failure.
+ */
+typedef struct capture_cursor {
+	const unsigned char* bytes;
+	size_t size;
+	size_t offset;
+	bool failed;
+} capture_cursor;
+
+static const void* bytes_read(capture_cursor* const cursor, const size_t size) {
+	if (cursor->failed || size > cursor->size - cursor->offset) {
+		cursor->failed = true;
+		return NULL;
+	}
+	const void* const bytes = cursor->bytes + cursor->offset;
+	cursor->offset += size;
+	return bytes;
+}
+
+static uint8_t u8_read(capture_cursor* const cursor) {
+	uint8_t value = 0u;
+	const void* const bytes = bytes_read(cursor, sizeof(value));
+	if (bytes != NULL) {
+		memcpy(&value, bytes, sizeof(value));
+	}
+	return value;
+}
+
+static uint32_t u32_read(capture_cursor* const cursor) {
+	uint32_t value = 0u;
+	const void* const bytes = bytes_read(cursor, sizeof(value));
+	if (bytes != NULL) {
+		memcpy(&value, bytes, sizeof(value));
+	}
+	return value;
+}
+
+static uint64_t u64_read(capture_cursor* const cursor) {
+	uint64_t value = 0u;
+	const void* const bytes = bytes_read(cursor, sizeof(value));
+	if (bytes != NULL) {
+		memcpy(&value, bytes, sizeof(value));
+	}
+	return value;
+}
+
+static float f32_read(capture_cursor* const cursor) {
+	float value = 0.0f;
+	const void* const bytes = bytes_read(cursor, sizeof(value));
+	if (bytes != NULL) {
+		memcpy(&value, bytes, sizeof(value));
+	}
+	return value;
+}
+
+static void align_read(capture_cursor* const cursor) {
+	bytes_read(cursor, (CAPTURE_ALIGNMENT - cursor->offset % CAPTURE_ALIGNMENT) % CAPTURE_ALIGNMENT);
+}
+
+static const char* string_read(capture_cursor* const cursor) {
+	const uint32_t size = u32_read(cursor);
+	const char* const string = bytes_read(cursor, size);
+	if (string == NULL || size == 0u || string[size - 1u] != '\0') {
+		cursor->failed = true;
+		return NULL;
+	}
+	return string;
+}
+
+/*
+ * The sprites of a record of sprites, following its type byte.
+ */
+typedef struct capture_sprites_type {
+	render_handle sheet;
+	size_t layer_index;
+	size_t num_added;
+	const void* added_sprites;
+} capture_sprites_type;
+
+static size_t sprite_size_get(const capture_record_type type) {
+	switch (type) {
+	case CAPTURE_RECORD_SPRITES:
+		return sizeof(sprite_type);
+
+	case CAPTURE_RECORD_PACKED_SPRITES:
+		return sizeof(packed_sprite_type);
+
+	default:
+		return sizeof(sprite_ex_type);
+	}
+}
+
+static void sprites_read(capture_cursor* const cursor, const capture_record_type type, capture_sprites_type* const sprites) {
+	sprites->sheet = u32_read(cursor);
+	sprites->layer_index = u32_read(cursor);
+	sprites->num_added = u32_read(cursor);
+	align_read(cursor);
+	const size_t sprite_size = sprite_size_get(type);
+	if (sprites->num_added > SIZE_MAX / sprite_size) {
+		cursor->failed = true;
+		return;
+	}
+	sprites->added_sprites = bytes_read(cursor, sprite_size * sprites->num_added);
+}
+
+static bool replay_handle_check(capture_replay_object* const replay, const render_handle handle) {
+	return handle < replay->handles_size && replay->handles[handle] != RENDER_HANDLE_NONE;
+}
+
+/*
+ * Read a handle record, getting the render API handle of the captured handle.
+ */
+static bool replay_handle_read(capture_replay_object* const replay, capture_cursor* const cursor) {
+	const render_handle handle = u32_read(cursor);
+	const data_type type = (data_type)u32_read(cursor);
+	const char* const filename = string_read(cursor);
+	if (cursor->failed || handle == RENDER_HANDLE_NONE) {
+		return false;
+	}
+
+	if (handle >= replay->handles_size) {
+		size_t handles_size = replay->handles_size > 0u ? replay->handles_size : (size_t)64u;
+		while (handle >= handles_size) {
+			handles_size *= 2u;
+		}
+		render_handle* const handles = mem_realloc(replay->handles, sizeof(render_handle) * handles_size);
+		if (handles == NULL) {
+			return false;
+		}
+		memset(handles + replay->handles_size, 0, sizeof(render_handle) * (handles_size - replay->handles_size));
+		replay->handles = handles;
+		replay->handles_size = handles_size;
+	}
+
+	switch (type) {
+	case DATA_TYPE_TEXTURE:
+		replay->handles[handle] = render_sheet_handle_get(filename);
+		break;
+
+	case DATA_TYPE_FONT:
+		replay->handles[handle] = render_font_handle_get(filename);
+		break;
+
+	case DATA_TYPE_FONT_SDF:
+		replay->handles[handle] = render_font_sdf_handle_get(filename);
+		break;
+
+	default:
+		log_printf("Error: Render capture handle of unsupported data type %u\n", (unsigned)type);
+		return false;
+	}
+	return replay->handles[handle] != RENDER_HANDLE_NONE;
+}
+
+/*
+ * Read every record once, validating them, getting the handles and indexing
+ * the frames, so replaying frames needn't validate anything.
+ */
+static bool replay_index(capture_replay_object* const replay) {
+	capture_cursor cursor = { .bytes = replay->bytes, .size = replay->size };
+
+	const void* const magic = bytes_read(&cursor, sizeof(CAPTURE_MAGIC) - 1u);
+	const uint32_t version = u32_read(&cursor);
+	const uint32_t byte_order = u32_read(&cursor);
+	const uint32_t sprite_size = u32_read(&cursor);
+	const uint32_t packed_sprite_size = u32_read(&cursor);
+	const uint32_t sprite_ex_size = u32_read(&cursor);
+	if (cursor.failed || memcmp(magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC) - 1u) != 0) {
+		log_printf("Error: The file isn't a render capture\n");
+		return false;
+	}
+	if (
+		version != CAPTURE_VERSION ||
+		byte_order != CAPTURE_BYTE_ORDER ||
+		sprite_size != sizeof(sprite_type) ||
+		packed_sprite_size != sizeof(packed_sprite_type) ||
+		sprite_ex_size != sizeof(sprite_ex_type)
+	) {
+		log_printf("Error: The render capture is of an unsupported version or platform\n");
+		return false;
+	}
+
+	size_t frame_starts_size = 0u;
+	bool in_frame = false;
+	while (cursor.offset < cursor.size) {
+		const size_t start = cursor.offset;
+		const capture_record_type type = (capture_record_type)u8_read(&cursor);
+		if (type != CAPTURE_RECORD_HANDLE && (type == CAPTURE_RECORD_START) == in_frame) {
+			log_printf("Error: Render capture record outside of a frame, or frame started twice\n");
+			return false;
+		}
+
+		bool valid = true;
+		switch (type) {
+		case CAPTURE_RECORD_HANDLE:
+			valid = replay_handle_read(replay, &cursor);
+			break;
+
+		case CAPTURE_RECORD_START:
+			bytes_read(&cursor, sizeof(float) * 2u + 2u + sizeof(uint64_t) + 1u);
+			if (replay->num_frames == frame_starts_size) {
+				frame_starts_size = frame_starts_size > 0u ? frame_starts_size * 2u : (size_t)64u;
+				size_t* const frame_starts = mem_realloc(replay->frame_starts, sizeof(size_t) * frame_starts_size);
+				if (frame_starts == NULL) {
+					return false;
+				}
+				replay->frame_starts = frame_starts;
+			}
+			replay->frame_starts[replay->num_frames] = start;
+			in_frame = true;
+			break;
+
+		case CAPTURE_RECORD_END:
+			replay->num_frames++;
+			in_frame = false;
+			break;
+
+		case CAPTURE_RECORD_CLEAR:
+			bytes_read(&cursor, sizeof(float) * 4u);
+			break;
+
+		case CAPTURE_RECORD_SPRITES:
+		case CAPTURE_RECORD_PACKED_SPRITES:
+		case CAPTURE_RECORD_SPRITES_EX: {
+			capture_sprites_type sprites;
+			sprites_read(&cursor, type, &sprites);
+			valid = replay_handle_check(replay, sprites.sheet) && sprites.layer_index < RENDER_LAYERS_MAX;
+			break;
+		}
+
+		case CAPTURE_RECORD_STRING: {
+			const render_handle font = u32_read(&cursor);
+			const size_t layer_index = u32_read(&cursor);
+			bytes_read(&cursor, sizeof(float) * 2u);
+			const float scale = f32_read(&cursor);
+			string_read(&cursor);
+			valid = replay_handle_check(replay, font) && layer_index < RENDER_LAYERS_MAX && scale > 0.0f;
+			break;
+		}
+
+		case CAPTURE_RECORD_CAMERA: {
+			const size_t layer_index = u32_read(&cursor);
+			if (u8_read(&cursor)) {
+				bytes_read(&cursor, sizeof(float) * 4u);
+			}
+			valid = layer_index < RENDER_LAYERS_MAX;
+			break;
+		}
+
+		default:
+			valid = false;
+			break;
+		}
+		if (!valid || cursor.failed) {
+			log_printf("Error: Invalid render capture record at offset %zu\n", start);
+			return false;
+		}
+	}
+
+	if (replay->num_frames == 0u) {
+		log_printf("Error: The render capture has no complete frames\n");
+		return false;
+	}
+	return true;
+}
+
+capture_replay_object* capture_replay_create(const char* const filename) {
+	assert(filename != NULL);
+
+	capture_replay_object* const replay = mem_calloc(1u, sizeof(capture_replay_object));
+	if (replay == NULL) {
+		return NULL;
+	}
+
+	SDL_RWops* const file = SDL_RWFromFile(filename, "rb");
+	if (file == NULL) {
+		log_printf("Error opening the render capture file \"%s\": %s\n", filename, SDL_GetError());
+		mem_free(replay);
+		return NULL;
+	}
+	const Sint64 size = SDL_RWsize(file);
+	if (size > 0) {
+		replay->bytes = mem_malloc((size_t)size);
+		replay->size = (size_t)size;
+	}
+	const bool read = replay->bytes != NULL && SDL_RWread(file, replay->bytes, 1u, replay->size) == replay->size;
+	SDL_RWclose(file);
+	if (!read) {
+		log_printf("Error reading the render capture file \"%s\"\n", filename);
+		capture_replay_destroy(replay);
+		return NULL;
+	}
+
+	if (!replay_index(replay)) {
+		log_printf("Error loading the render capture file \"%s\"\n", filename);
+		capture_replay_destroy(replay);
+		return NULL;
+	}
+	return replay;
+}
+
+void capture_replay_destroy(capture_replay_object* const replay) {
+	assert(replay != NULL);
+
+	mem_free(replay->bytes);
+	mem_free(replay->frame_starts);
+	mem_free(replay->handles);
+	mem_free(replay);
+}
+
+uint64_t capture_replay_frames_get(capture_replay_object* const replay) {
+	assert(replay != NULL);
+
+	return replay->num_frames;
+}
+
+bool capture_replay_frame(capture_replay_object* const replay, const uint64_t frame) {
+	assert(replay != NULL);
+	assert(frame < replay->num_frames);
+
+	capture_cursor cursor = {
+		.bytes = replay->bytes,
+		.size = replay->size,
+		.offset = replay->frame_starts[frame]
+	};
+	for (;;) {
+		const capture_record_type type = (capture_record_type)u8_read(&cursor);
+		bool success = true;
+		switch (type) {
+		case CAPTURE_RECORD_HANDLE:
+			bytes_read(&cursor, sizeof(uint32_t) * 2u);
+			string_read(&cursor);
+			break;
+
+		case CAPTURE_RECORD_START: {
+			render_settings_type settings = { 0 };
+			settings.width = f32_read(&cursor);
+			settings.height = f32_read(&cursor);
+			settings.packed_sprites = u8_read(&cursor);
+			settings.layer_stats = u8_read(&cursor);
+			settings.texture_budget = (size_t)u64_read(&cursor);
+			settings.cull_sprites = u8_read(&cursor);
+			settings.dynamic_resolution = u8_read(&cursor);
+			settings.target_gpu_milliseconds = f32_read(&cursor);
+			settings.min_resolution_scale = f32_read(&cursor);
+			settings.nearest_upscale = u8_read(&cursor);
+			success = render_start(&settings);
+			break;
+		}
+
+		case CAPTURE_RECORD_END:
+			return render_end();
+
+		case CAPTURE_RECORD_CLEAR: {
+			const float red = f32_read(&cursor);
+			const float green = f32_read(&cursor);
+			const float blue = f32_read(&cursor);
+			const float alpha = f32_read(&cursor);
+			success = render_clear(red, green, blue, alpha);
+			break;
+		}
+
+		case CAPTURE_RECORD_SPRITES:
+		case CAPTURE_RECORD_PACKED_SPRITES:
+		case CAPTURE_RECORD_SPRITES_EX: {
+			capture_sprites_type sprites;
+			sprites_read(&cursor, type, &sprites);
+			const render_handle sheet = replay->handles[sprites.sheet];
+			if (type == CAPTURE_RECORD_SPRITES) {
+				success = render_sprites_handle(sheet, sprites.layer_index, sprites.num_added, sprites.added_sprites);
+			}
+			else if (type == CAPTURE_RECORD_PACKED_SPRITES) {
+				success = render_packed_sprites_handle(sheet, sprites.layer_index, sprites.num_added, sprites.added_sprites);
+			}
+			else {
+				success = render_sprites_ex_handle(sheet, sprites.layer_index, sprites.num_added, sprites.added_sprites);
+			}
+			break;
+		}
+
+		case CAPTURE_RECORD_STRING: {
+			const render_handle font = replay->handles[u32_read(&cursor)];
+			const size_t layer_index = u32_read(&cursor);
+			const float x = f32_read(&cursor);
+			const float y = f32_read(&cursor);
+			const float scale = f32_read(&cursor);
+			const char* const string = string_read(&cursor);
+			success = render_string_scaled_handle(font, layer_index, x, y, scale, string);
+			break;
+		}
+
+		case CAPTURE_RECORD_CAMERA: {
+			const size_t layer_index = u32_read(&cursor);
+			if (u8_read(&cursor)) {
+				camera_type camera;
+				camera.x = f32_read(&cursor);
+				camera.y = f32_read(&cursor);
+				camera.zoom = f32_read(&cursor);
+				camera.rotation = f32_read(&cursor);
+				success = render_layer_camera_set(layer_index, &camera);
+			}
+			else {
+				success = render_layer_camera_set(layer_index, NULL);
+			}
+			break;
+		}
+
+		default:
+			assert(false);
+			return false;
+		}
+		if (!success) {
+			return false;
+		}
+	}
+}
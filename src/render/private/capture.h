@@ -0,0 +1,125 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/render.h"
+#include "data/data_types.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Capture of the render API calls of frames into a compact binary file, and
+ * replay of the captured frames through the render API, so frames built
+ * dynamically by an app can be reproduced offline as benchmarks.
+ *
+ * A capture starts with a header of CAPTURE_MAGIC, CAPTURE_VERSION, a byte
+ * order check value and the sizes of the sprite types, followed by records,
+ * each a type byte and its fields. Everything is in the capturing machine's
+ * byte order, and sprites are stored in their in-memory layout, so captures
+ * only replay on machines of the same byte order. Handles are stored as the
+ * capturing process's handles, each defined by a handle record of its data
+ * type and filename before its first use.
+ */
+
+/*
+ * The number of frames the program captures when started with --capture
+ * <file>, unless set with --capture-frames.
+ */
+#define CAPTURE_FRAMES_DEFAULT UINT64_C(600)
+
+#define CAPTURE_MAGIC "DMCAPTUR"
+#define CAPTURE_VERSION UINT32_C(2)
+
+typedef enum capture_record_type {
+	CAPTURE_RECORD_HANDLE,
+	CAPTURE_RECORD_START,
+	CAPTURE_RECORD_END,
+	CAPTURE_RECORD_CLEAR,
+	CAPTURE_RECORD_SPRITES,
+	CAPTURE_RECORD_PACKED_SPRITES,
+	CAPTURE_RECORD_SPRITES_EX,
+	CAPTURE_RECORD_STRING,
+	CAPTURE_RECORD_CAMERA,
+	CAPTURE_RECORD_NUM
+} capture_record_type;
+
+typedef struct capture_object capture_object;
+
+/*
+ * Create a capture of num_frames frames, written to the file at the full
+ * filename once the last frame has ended. Returns NULL upon failure.
+ */
+capture_object* capture_create(const char* const filename, const uint64_t num_frames);
+
+void capture_destroy(capture_object* const capture);
+
+/*
+ * Define the handle in the capture, if it isn't already defined. Must be
+ * called before recording anything using the handle.
+ */
+bool capture_handle(capture_object* const capture, const render_handle handle, const data_type type, const char* const filename);
+
+bool capture_start(capture_object* const capture, const render_settings_type* const settings);
+
+/*
+ * End the current frame. Once the last frame has ended, the capture is
+ * written, and *done is set to true; the capture must then be destroyed.
+ */
+bool capture_end(capture_object* const capture, bool* const done);
+
+bool capture_clear(capture_object* const capture, const float red, const float green, const float blue, const float alpha);
+
+/*
+ * Record num_added sprites of the record type, one of CAPTURE_RECORD_SPRITES,
+ * CAPTURE_RECORD_PACKED_SPRITES or CAPTURE_RECORD_SPRITES_EX, with the size of
+ * the type's sprites.
+ */
+bool capture_sprites(capture_object* const capture, const capture_record_type type, const render_handle sheet, const size_t layer_index, const size_t num_added, const void* const added_sprites, const size_t sprite_size);
+
+bool capture_string(capture_object* const capture, const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const string);
+
+bool capture_camera(capture_object* const capture, const size_t layer_index, const camera_type* const camera);
+
+/*
+ * Replay of a capture file, loaded entirely into memory.
+ */
+typedef struct capture_replay_object capture_replay_object;
+
+/*
+ * Load the capture at the full filename, getting render API handles for the
+ * capture's handles. Must only be called in the main thread, after the
+ * renderer has been initialized. Returns NULL upon failure.
+ */
+capture_replay_object* capture_replay_create(const char* const filename);
+
+void capture_replay_destroy(capture_replay_object* const replay);
+
+uint64_t capture_replay_frames_get(capture_replay_object* const replay);
+
+/*
+ * Make the render API calls of the captured frame, from render_start to
+ * render_end. Must be called where the app updates.
+ */
+bool capture_replay_frame(capture_replay_object* const replay, const uint64_t frame);
@@ -0,0 +1,213 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/cull.h"
+#include "util/private/simd.h"
+#include <stdbool.h>
+#include <assert.h>
+
+/*
+ * Each group of four sprites' dst rectangles is tested at once, producing a
+ * mask with bit i set if the i-th sprite is visible.
+ */
+#if defined(SIMD_SSE2)
+typedef __m128 dst_vector;
+
+static inline dst_vector dst_load(const float* const dst) {
+	return _mm_loadu_ps(dst);
+}
+
+static inline dst_vector packed_dst_load(const int16_t* const dst) {
+	const __m128i packed = _mm_loadl_epi64((const __m128i*)dst);
+	const __m128i widened = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+	return _mm_mul_ps(_mm_cvtepi32_ps(widened), _mm_set1_ps(1.0f / PACKED_SPRITE_DST_SCALE));
+}
+
+static inline unsigned visible_mask(dst_vector x, dst_vector y, dst_vector w, dst_vector h, const vec4 bounds) {
+	_MM_TRANSPOSE4_PS(x, y, w, h);
+	const __m128 x1 = _mm_add_ps(x, w);
+	const __m128 y1 = _mm_add_ps(y, h);
+	const __m128 visible = _mm_and_ps(
+		_mm_and_ps(
+			_mm_cmpgt_ps(_mm_max_ps(x, x1), _mm_set1_ps(bounds[0])),
+			_mm_cmplt_ps(_mm_min_ps(x, x1), _mm_set1_ps(bounds[2]))
+		),
+		_mm_and_ps(
+			_mm_cmpgt_ps(_mm_max_ps(y, y1), _mm_set1_ps(bounds[1])),
+			_mm_cmplt_ps(_mm_min_ps(y, y1), _mm_set1_ps(bounds[3]))
+		)
+	);
+	return (unsigned)_mm_movemask_ps(visible);
+}
+#elif defined(SIMD_NEON)
+typedef float32x4_t dst_vector;
+
+static inline dst_vector dst_load(const float* const dst) {
+	return vld1q_f32(dst);
+}
+
+static inline dst_vector packed_dst_load(const int16_t* const dst) {
+	return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(dst))), 1.0f / PACKED_SPRITE_DST_SCALE);
+}
+
+static inline unsigned visible_mask(const dst_vector d0, const dst_vector d1, const dst_vector d2, const dst_vector d3, const vec4 bounds) {
+	const float32x4x2_t t01 = vtrnq_f32(d0, d1);
+	const float32x4x2_t t23 = vtrnq_f32(d2, d3);
+	const float32x4_t x = vcombine_f32(vget_low_f32(t01.val[0]), vget_low_f32(t23.val[0]));
+	const float32x4_t y = vcombine_f32(vget_low_f32(t01.val[1]), vget_low_f32(t23.val[1]));
+	const float32x4_t w = vcombine_f32(vget_high_f32(t01.val[0]), vget_high_f32(t23.val[0]));
+	const float32x4_t h = vcombine_f32(vget_high_f32(t01.val[1]), vget_high_f32(t23.val[1]));
+
+	const float32x4_t x1 = vaddq_f32(x, w);
+	const float32x4_t y1 = vaddq_f32(y, h);
+	const uint32x4_t visible = vandq_u32(
+		vandq_u32(
+			vcgtq_f32(vmaxq_f32(x, x1), vdupq_n_f32(bounds[0])),
+			vcltq_f32(vminq_f32(x, x1), vdupq_n_f32(bounds[2]))
+		),
+		vandq_u32(
+			vcgtq_f32(vmaxq_f32(y, y1), vdupq_n_f32(bounds[1])),
+			vcltq_f32(vminq_f32(y, y1), vdupq_n_f32(bounds[3]))
+		)
+	);
+	const uint32x4_t bits = vandq_u32(visible, (uint32x4_t) { 1u, 2u, 4u, 8u });
+	return (unsigned)(vgetq_lane_u32(bits, 0) | vgetq_lane_u32(bits, 1) | vgetq_lane_u32(bits, 2) | vgetq_lane_u32(bits, 3));
+}
+#endif
+
+static inline bool rect_visible(const float x, const float y, const float w, const float h, const vec4 bounds) {
+	const float x1 = x + w;
+	const float y1 = y + h;
+	return
+		(x > x1 ? x : x1) > bounds[0] &&
+		(x < x1 ? x : x1) < bounds[2] &&
+		(y > y1 ? y : y1) > bounds[1] &&
+		(y < y1 ? y : y1) < bounds[3];
+}
+
+/*
+ * Move the visible sprites of a group of four to the end of the visible
+ * sprites so far. Sprites are only ever moved towards the start, so the moves
+ * never overwrite sprites yet to be tested.
+ */
+#define COMPACT_GROUP(sprites, i, mask, num_visible) \
+do { \
+	if ((mask) == 0xFu && (num_visible) == (i)) { \
+		(num_visible) += 4u; \
+	} \
+	else { \
+		for (size_t j = 0u; j < 4u; j++) { \
+			if ((mask) & (1u << j)) { \
+				(sprites)[(num_visible)++] = (sprites)[(i) + j]; \
+			} \
+		} \
+	} \
+} while (false)
+
+size_t cull_sprites(sprite_type* const sprites, const size_t num_sprites, const vec4 bounds) {
+	assert(num_sprites == 0u || sprites != NULL);
+	assert(bounds != NULL);
+
+	size_t num_visible = 0u;
+	size_t i = 0u;
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	for (; i + 4u <= num_sprites; i += 4u) {
+		const unsigned mask = visible_mask(
+			dst_load(sprites[i + 0u].dst),
+			dst_load(sprites[i + 1u].dst),
+			dst_load(sprites[i + 2u].dst),
+			dst_load(sprites[i + 3u].dst),
+			bounds
+		);
+		COMPACT_GROUP(sprites, i, mask, num_visible);
+	}
+#endif
+	for (; i < num_sprites; i++) {
+		const float* const dst = sprites[i].dst;
+		if (rect_visible(dst[0], dst[1], dst[2], dst[3], bounds)) {
+			sprites[num_visible++] = sprites[i];
+		}
+	}
+
+	return num_visible;
+}
+
+size_t cull_packed_sprites(packed_sprite_type* const sprites, const size_t num_sprites, const vec4 bounds) {
+	assert(num_sprites == 0u || sprites != NULL);
+	assert(bounds != NULL);
+
+	size_t num_visible = 0u;
+	size_t i = 0u;
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	for (; i + 4u <= num_sprites; i += 4u) {
+		const unsigned mask = visible_mask(
+			packed_dst_load(sprites[i + 0u].dst),
+			packed_dst_load(sprites[i + 1u].dst),
+			packed_dst_load(sprites[i + 2u].dst),
+			packed_dst_load(sprites[i + 3u].dst),
+			bounds
+		);
+		COMPACT_GROUP(sprites, i, mask, num_visible);
+	}
+#endif
+	for (; i < num_sprites; i++) {
+		const int16_t* const dst = sprites[i].dst;
+		const float scale = 1.0f / PACKED_SPRITE_DST_SCALE;
+		if (rect_visible(dst[0] * scale, dst[1] * scale, dst[2] * scale, dst[3] * scale, bounds)) {
+			sprites[num_visible++] = sprites[i];
+		}
+	}
+
+	return num_visible;
+}
+
+size_t cull_sprites_ex(sprite_ex_type* const sprites, const size_t num_sprites, const vec4 bounds) {
+	assert(num_sprites == 0u || sprites != NULL);
+	assert(bounds != NULL);
+
+	size_t num_visible = 0u;
+	for (size_t i = 0u; i < num_sprites; i++) {
+		const sprite_ex_type* const sprite = &sprites[i];
+
+		/*
+		 * However the sprite is rotated, its corners are no farther from the
+		 * origin than the farthest scaled corner of the unrotated sprite.
+		 */
+		const float origin_x = sprite->dst[0] + sprite->origin[0];
+		const float origin_y = sprite->dst[1] + sprite->origin[1];
+		const float left = fabsf(sprite->origin[0]);
+		const float right = fabsf(sprite->dst[2] - sprite->origin[0]);
+		const float top = fabsf(sprite->origin[1]);
+		const float bottom = fabsf(sprite->dst[3] - sprite->origin[1]);
+		const float extent_x = (left > right ? left : right) * fabsf(sprite->scale[0]);
+		const float extent_y = (top > bottom ? top : bottom) * fabsf(sprite->scale[1]);
+		const float radius = sqrtf(extent_x * extent_x + extent_y * extent_y);
+
+		if (rect_visible(origin_x - radius, origin_y - radius, radius * 2.0f, radius * 2.0f, bounds)) {
+			sprites[num_visible++] = *sprite;
+		}
+	}
+
+	return num_visible;
+}
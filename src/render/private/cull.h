@@ -0,0 +1,54 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Culling of sprites outside of a rectangle, compacting the visible sprites in
+ * place, keeping their order. Four sprites are tested at a time with SSE2 or
+ * NEON where available. A sprite is visible if its dst rectangle overlaps the
+ * bounds; sprites only touching the bounds' edges are culled. Negative dst
+ * dimensions are supported.
+ */
+
+#include "render/render_types.h"
+#include "util/maths.h"
+#include <stddef.h>
+
+/*
+ * The bounds are in the order left, top, right, bottom. Each function returns
+ * the number of visible sprites, which are moved to the start of the array.
+ */
+size_t cull_sprites(sprite_type* const sprites, const size_t num_sprites, const vec4 bounds);
+
+/*
+ * The bounds are in pixels, like the bounds for sprite_type sprites.
+ */
+size_t cull_packed_sprites(packed_sprite_type* const sprites, const size_t num_sprites, const vec4 bounds);
+
+/*
+ * Extended sprites are tested with a conservative bounding square around their
+ * transformed dst rectangle, so some sprites just outside of the bounds are
+ * kept.
+ */
+size_t cull_sprites_ex(sprite_ex_type* const sprites, const size_t num_sprites, const vec4 bounds);
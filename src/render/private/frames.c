@@ -25,28 +25,404 @@
 #include "render/private/frames.h"
 #include "render/private/opengl.h"
 #include "main/private/prog_private.h"
-#include "util/private/conqueue.h"
 #include "util/log.h"
-#include "util/queue.h"
 #include "util/mem.h"
+#include "util/nanotime.h"
 #include "SDL.h"
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
-typedef struct command_object {
+/*
+ * The size of the first arena chunk of a new frame. Frames that have needed
+ * more than this get a single chunk large enough for their total usage when
+ * recycled, so steady-state frames allocate nothing.
+ */
+#define MIN_CHUNK_SIZE ((size_t)4096u)
+
+#define ALLOC_ALIGNMENT _Alignof(max_align_t)
+
+/*
+ * Frame hashes are 64-bit multiply-xorshift hashes, hashing four words at a
+ * time in independent lanes, so hashing large sprite arrays isn't bound by
+ * the latency of the multiplies.
+ */
+#define HASH_SEED UINT64_C(0x9E3779B97F4A7C15)
+#define HASH_MULTIPLIER UINT64_C(0xFF51AFD7ED558CCD)
+
+typedef struct frame_chunk frame_chunk;
+struct frame_chunk {
+	frame_chunk* next;
+	size_t size;
+	size_t pos;
+	max_align_t data[];
+};
+
+typedef struct command_object command_object;
+struct command_object {
+	command_object* next;
 	command_funcs funcs;
 	void* state;
-} command_object;
+};
+
+/*
+ * A run of commands sharing an ordering key.
+ */
+typedef struct frame_segment frame_segment;
+struct frame_segment {
+	frame_segment* next;
+	uint64_t key;
+	command_object* commands;
+	command_object** commands_tail;
+};
+
+typedef struct frame_object frame_object;
+struct frame_object {
+	frame_object* next;
+
+	/*
+	 * The frame's commands in execution order, only valid once the frame has
+	 * been ended.
+	 */
+	command_object* commands;
+
+	/*
+	 * Commands are recorded into segments. The producer's own commands go into
+	 * the last of its segments, starting with the frame's embedded segment,
+	 * and each submitted list adds a segment to lists. frames_end merges the
+	 * segments into commands, in ascending key order.
+	 */
+	frame_segment segment;
+	frame_segment* segment_last;
+	frame_segment* lists;
+	size_t num_segments;
+
+	/*
+	 * All command state of a frame is allocated from this chunk list, with the
+	 * newest chunk at the head. The whole list is reset in one shot when the
+	 * frame is retired. The chunks of submitted lists are kept apart, and
+	 * freed when the frame is retired.
+	 */
+	frame_chunk* chunks;
+	size_t used;
+	frame_chunk* list_chunks;
+
+	/*
+	 * The content hash of the producer's commands, and the sum of the hashes
+	 * of submitted lists, summed so the order lists are submitted in doesn't
+	 * matter; frames_end folds the lists' hashes into the frame's. The frame
+	 * is only hashed if all its commands are stateless and hashed.
+	 */
+	uint64_t hash;
+	uint64_t lists_hash;
+	bool hashed;
+};
 
-typedef struct frame_object {
-	queue_object* commands;
-} frame_object;
+struct frames_list_object {
+	frames_object* frames;
+	bool recording;
+	uint64_t key;
+	command_object* commands;
+	command_object** commands_tail;
+
+	/*
+	 * The list's own arena, handed over to the frame on submission. The next
+	 * recording's first chunk is sized for the last recording's usage.
+	 */
+	frame_chunk* chunks;
+	size_t used;
+	size_t last_used;
+
+	uint64_t hash;
+	bool hashed;
+};
+
+struct frames_object {
+	/*
+	 * Frames ended by the producer, newest first. The consumer takes the
+	 * whole list at once.
+	 */
+	frame_object* pending_frames;
+
+	/*
+	 * Retired frames, pushed by the consumer and popped by the producer. Only
+	 * the producer pops, so there's no ABA problem.
+	 */
+	frame_object* free_frames;
 
-typedef struct frames_object {
-	conqueue_object* frame_queues;
 	frame_object* next_latest_frame;
-	frame_object* latest_frame;
-} frames_object;
+
+	/*
+	 * The list each thread is recording into, if any, and the lock for
+	 * submitting lists to the frame being produced.
+	 */
+	SDL_TLSID list_tls;
+	SDL_SpinLock lists_lock;
+
+	gpu_timer_object* gpu_timer;
+
+	/*
+	 * While interpolating, the latest drawn frame is held rather than retired,
+	 * so it can be redrawn until the next frame arrives.
+	 */
+	bool interpolated;
+	frame_object* held_frame;
+
+	bool synced;
+	bool timed;
+	frames_timing_type timing;
+
+	/*
+	 * The hash of the frame on screen, only valid if the frame was hashed and
+	 * nothing has forced a redraw since, and the number of idle frames
+	 * skipped.
+	 */
+	uint64_t drawn_hash;
+	bool drawn_valid;
+	bool redraw;
+	uint64_t idle_skips;
+};
+
+/*
+ * Frames taking longer than this are so far behind that their timing is
+ * meaningless, so waits for them give up.
+ */
+#define SYNC_TIMEOUT (NANOTIME_NSEC_PER_SEC / 4u)
+
+
+static void chunks_free(frame_chunk* chunk) {
+	for (frame_chunk* next; chunk != NULL; chunk = next) {
+		next = chunk->next;
+		mem_free(chunk);
+	}
+}
+
+static frame_chunk* frame_chunk_create(const size_t size) {
+	frame_chunk* const chunk = mem_malloc(offsetof(frame_chunk, data) + size);
+	if (chunk == NULL) {
+		return NULL;
+	}
+	chunk->next = NULL;
+	chunk->size = size;
+	chunk->pos = 0u;
+	return chunk;
+}
+
+static void* chunks_alloc(frame_chunk** const chunks, size_t* const used, const size_t size) {
+	assert(size <= SIZE_MAX - ALLOC_ALIGNMENT);
+
+	const size_t aligned_size = (size + ALLOC_ALIGNMENT - 1u) & ~(ALLOC_ALIGNMENT - 1u);
+
+	frame_chunk* chunk = *chunks;
+	if (chunk == NULL || chunk->size - chunk->pos < aligned_size) {
+		size_t new_chunk_size = chunk != NULL ? chunk->size * 2u : MIN_CHUNK_SIZE;
+		if (new_chunk_size < aligned_size) {
+			new_chunk_size = aligned_size;
+		}
+		chunk = frame_chunk_create(new_chunk_size);
+		if (chunk == NULL) {
+			return NULL;
+		}
+		chunk->next = *chunks;
+		*chunks = chunk;
+	}
+
+	void* const mem = (unsigned char*)chunk->data + chunk->pos;
+	chunk->pos += aligned_size;
+	*used += aligned_size;
+	return mem;
+}
+
+static uint64_t hash_mix(uint64_t hash, const uint64_t word) {
+	hash ^= word;
+	hash *= HASH_MULTIPLIER;
+	return hash ^ (hash >> 32);
+}
+
+static uint64_t hash_bytes(uint64_t hash, const void* const data, size_t size) {
+	const unsigned char* bytes = data;
+	const uint64_t length = size;
+
+	if (size >= sizeof(uint64_t) * 4u) {
+		uint64_t lanes[4] = { hash, hash + 1u, hash + 2u, hash + 3u };
+		for (; size >= sizeof(lanes); size -= sizeof(lanes), bytes += sizeof(lanes)) {
+			uint64_t words[4];
+			memcpy(words, bytes, sizeof(words));
+			for (size_t i = 0u; i < 4u; i++) {
+				lanes[i] = hash_mix(lanes[i], words[i]);
+			}
+		}
+		hash = hash_mix(hash_mix(lanes[0], lanes[1]), hash_mix(lanes[2], lanes[3]));
+	}
+	for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, bytes, sizeof(word));
+		hash = hash_mix(hash, word);
+	}
+	if (size > 0u) {
+		uint64_t word = 0u;
+		memcpy(&word, bytes, size);
+		hash = hash_mix(hash, word);
+	}
+	return hash_mix(hash, length);
+}
+
+/*
+ * Hash the command's functions into the hash, clearing hashed if the command
+ * can't be skipped when idle.
+ */
+static uint64_t hash_command(const uint64_t hash, bool* const hashed, const command_funcs* const funcs) {
+	*hashed = *hashed && funcs->stateless && funcs->hashed;
+	const uint64_t update_hash = hash_bytes(hash, &funcs->update, sizeof(funcs->update));
+	return hash_bytes(update_hash, &funcs->draw, sizeof(funcs->draw));
+}
+
+static void* frame_alloc(frame_object* const frame, const size_t size) {
+	return chunks_alloc(&frame->chunks, &frame->used, size);
+}
+
+/*
+ * Reset a frame for reuse. If the frame needed more than its first chunk, the
+ * chunks are replaced with a single chunk large enough for all of it.
+ */
+static void frame_reset(frame_object* const frame) {
+	if (frame->chunks != NULL && frame->chunks->next != NULL) {
+		const size_t used = frame->used;
+		chunks_free(frame->chunks);
+		frame->chunks = frame_chunk_create(used);
+	}
+	else if (frame->chunks != NULL) {
+		frame->chunks->pos = 0u;
+	}
+	chunks_free(frame->list_chunks);
+	frame->list_chunks = NULL;
+
+	frame->commands = NULL;
+	frame->segment.next = NULL;
+	frame->segment.key = 0u;
+	frame->segment.commands = NULL;
+	frame->segment.commands_tail = &frame->segment.commands;
+	frame->segment_last = &frame->segment;
+	frame->lists = NULL;
+	frame->num_segments = 1u;
+	frame->used = 0u;
+
+	frame->hash = HASH_SEED;
+	frame->lists_hash = 0u;
+	frame->hashed = true;
+}
+
+static void frame_destroy(frame_object* const frame) {
+	chunks_free(frame->chunks);
+	chunks_free(frame->list_chunks);
+	mem_slab_free(frame, sizeof(frame_object));
+}
+
+/*
+ * Merge the frame's segments into its command list. Ties between the
+ * producer's segments and lists go to the producer's segments, and the
+ * producer's segments keep their order among themselves.
+ */
+static bool frame_merge(frame_object* const frame) {
+	if (frame->lists == NULL && frame->segment.next == NULL) {
+		frame->commands = frame->segment.commands;
+		return true;
+	}
+
+	frame_segment** const sorted = frame_alloc(frame, sizeof(frame_segment*) * frame->num_segments);
+	if (sorted == NULL) {
+		return false;
+	}
+	size_t num_sorted = 0u;
+	for (frame_segment* segment = &frame->segment; segment != NULL; segment = segment->next) {
+		sorted[num_sorted++] = segment;
+	}
+	for (frame_segment* segment = frame->lists; segment != NULL; segment = segment->next) {
+		sorted[num_sorted++] = segment;
+	}
+	assert(num_sorted == frame->num_segments);
+
+	// There are only about as many segments as there are recording threads,
+	// so a stable insertion sort is enough.
+	for (size_t i = 1u; i < num_sorted; i++) {
+		frame_segment* const segment = sorted[i];
+		size_t j = i;
+		for (; j > 0u && sorted[j - 1u]->key > segment->key; j--) {
+			sorted[j] = sorted[j - 1u];
+		}
+		sorted[j] = segment;
+	}
+
+	command_object** tail = &frame->commands;
+	for (size_t i = 0u; i < num_sorted; i++) {
+		if (sorted[i]->commands != NULL) {
+			*tail = sorted[i]->commands;
+			tail = sorted[i]->commands_tail;
+		}
+	}
+	*tail = NULL;
+
+	return true;
+}
+
+static void frames_push(frame_object** const list, frame_object* const frame) {
+	frame_object* head;
+	do {
+		head = SDL_AtomicGetPtr((void**)list);
+		SDL_MemoryBarrierAcquire();
+		frame->next = head;
+		SDL_MemoryBarrierRelease();
+	} while (!SDL_AtomicCASPtr((void**)list, head, frame));
+}
+
+static frame_object* frames_pop(frame_object** const list) {
+	frame_object* head;
+	do {
+		head = SDL_AtomicGetPtr((void**)list);
+		SDL_MemoryBarrierAcquire();
+		if (head == NULL) {
+			return NULL;
+		}
+	} while (!SDL_AtomicCASPtr((void**)list, head, head->next));
+	return head;
+}
+
+/*
+ * Take all pending frames, returned in oldest-to-newest order.
+ */
+static frame_object* frames_take_pending(frames_object* const frames) {
+	frame_object* frame = SDL_AtomicSetPtr((void**)&frames->pending_frames, NULL);
+	SDL_MemoryBarrierAcquire();
+
+	frame_object* oldest = NULL;
+	while (frame != NULL) {
+		frame_object* const next = frame->next;
+		frame->next = oldest;
+		oldest = frame;
+		frame = next;
+	}
+	return oldest;
+}
+
+/*
+ * Retire frames, destroying any commands left in them without executing those
+ * commands.
+ */
+static void frames_retire_all(frames_object* const frames, frame_object* frame) {
+	while (frame != NULL) {
+		frame_object* const next = frame->next;
+		for (command_object* command = frame->commands; command != NULL; command = command->next) {
+			if (command->funcs.destroy != NULL) {
+				command->funcs.destroy(command->state);
+			}
+		}
+		frame_reset(frame);
+		frames_push(&frames->free_frames, frame);
+		frame = next;
+	}
+}
 
 frames_object* frames_create() {
 	frames_object* const frames = mem_calloc(1u, sizeof(frames_object));
@@ -54,8 +430,9 @@ frames_object* frames_create() {
 		return NULL;
 	}
 
-	frames->frame_queues = conqueue_create();
-	if (frames->frame_queues == NULL) {
+	frames->list_tls = SDL_TLSCreate();
+	if (frames->list_tls == 0) {
+		log_printf("Error creating the thread local storage of frames' command lists: %s\n", SDL_GetError());
 		mem_free(frames);
 		return NULL;
 	}
@@ -65,65 +442,232 @@ frames_object* frames_create() {
 
 bool frames_destroy(frames_object* const frames) {
 	assert(frames != NULL);
-	assert(frames->frame_queues != NULL);
-
-	for (
-		frame_object* frame = (frame_object*)conqueue_dequeue(frames->frame_queues);
-		frame != NULL;
-		queue_destroy(frame->commands), mem_free(frame), frame = (frame_object*)conqueue_dequeue(frames->frame_queues)
-	) {
-		for (
-			command_object* command = (command_object*)queue_dequeue(frame->commands);
-			command != NULL;
-			mem_free(command), command = (command_object*)queue_dequeue(frame->commands)
-		) {
-			if (command->funcs.update != NULL && !command->funcs.update(command->state)) {
-				return false;
+
+	bool success = true;
+	for (frame_object* frame = frames_take_pending(frames), * next; frame != NULL; frame = next) {
+		next = frame->next;
+		for (command_object* command = frame->commands; command != NULL; command = command->next) {
+			if (success && command->funcs.update != NULL && !command->funcs.stateless && !command->funcs.update(command->state)) {
+				success = false;
 			}
 
 			if (command->funcs.destroy != NULL) {
 				command->funcs.destroy(command->state);
 			}
 		}
+		frame_destroy(frame);
 		glFlush();
 	}
-	conqueue_destroy(frames->frame_queues);
+
+	for (frame_object* frame = frames_pop(&frames->free_frames); frame != NULL; frame = frames_pop(&frames->free_frames)) {
+		frame_destroy(frame);
+	}
+
+	if (frames->next_latest_frame != NULL) {
+		frame_destroy(frames->next_latest_frame);
+	}
+
+	if (frames->held_frame != NULL) {
+		for (command_object* command = frames->held_frame->commands; command != NULL; command = command->next) {
+			if (command->funcs.destroy != NULL) {
+				command->funcs.destroy(command->state);
+			}
+		}
+		frame_destroy(frames->held_frame);
+	}
+
 	mem_free(frames);
 
-	return true;
+	return success;
 }
 
 bool frames_start(frames_object* const frames) {
 	assert(frames != NULL);
-	assert(frames->frame_queues != NULL);
+	assert(frames->next_latest_frame == NULL);
 
-	frame_object* const next_frame = mem_malloc(sizeof(frame_object));
+	frame_object* next_frame = frames_pop(&frames->free_frames);
 	if (next_frame == NULL) {
-		return false;
+		next_frame = mem_slab_alloc(sizeof(frame_object));
+		if (next_frame == NULL) {
+			return false;
+		}
+		*next_frame = (frame_object) { 0 };
+		frame_reset(next_frame);
 	}
 
-	next_frame->commands = queue_create();
-	if (next_frame->commands == NULL) {
-		mem_free(next_frame);
+	frames->next_latest_frame = next_frame;
+
+	return true;
+}
+
+bool frames_end(frames_object* const frames) {
+	assert(frames != NULL);
+	assert(frames->next_latest_frame != NULL);
+	assert(SDL_TLSGet(frames->list_tls) == NULL);
+
+	// Submissions by recording threads are synchronized by taking the lock.
+	SDL_AtomicLock(&frames->lists_lock);
+	SDL_AtomicUnlock(&frames->lists_lock);
+	frame_object* const frame = frames->next_latest_frame;
+	if (!frame_merge(frame)) {
 		return false;
 	}
+	frame->hash = hash_mix(frame->hash, frame->lists_hash);
 
-	frames->next_latest_frame = next_frame;
+	frames_push(&frames->pending_frames, frames->next_latest_frame);
+	frames->next_latest_frame = NULL;
+	return true;
+}
+
+void* frames_alloc(frames_object* const frames, const size_t size) {
+	assert(frames != NULL);
+	assert(frames->next_latest_frame != NULL);
+
+	frames_list_object* const list = SDL_TLSGet(frames->list_tls);
+	if (list != NULL) {
+		return chunks_alloc(&list->chunks, &list->used, size);
+	}
+	return frame_alloc(frames->next_latest_frame, size);
+}
+
+bool frames_key_set(frames_object* const frames, const uint64_t key) {
+	assert(frames != NULL);
+	assert(frames->next_latest_frame != NULL);
+	assert(SDL_TLSGet(frames->list_tls) == NULL);
+
+	frame_object* const frame = frames->next_latest_frame;
+	frame->hash = hash_mix(frame->hash, key);
+	if (frame->segment_last->key == key) {
+		return true;
+	}
+	else if (frame->segment_last->commands == NULL) {
+		frame->segment_last->key = key;
+		return true;
+	}
+
+	frame_segment* const segment = frame_alloc(frame, sizeof(frame_segment));
+	if (segment == NULL) {
+		return false;
+	}
+	segment->next = NULL;
+	segment->key = key;
+	segment->commands = NULL;
+	segment->commands_tail = &segment->commands;
+	frame->segment_last->next = segment;
+	frame->segment_last = segment;
+	frame->num_segments++;
 
 	return true;
 }
 
-bool frames_end(frames_object* const frames) {
+void frames_hash(frames_object* const frames, const void* const data, const size_t size) {
+	assert(frames != NULL);
 	assert(frames->next_latest_frame != NULL);
+	assert(data != NULL || size == 0u);
 
-	if (!conqueue_enqueue(frames->frame_queues, frames->next_latest_frame)) {
-		queue_destroy(frames->next_latest_frame->commands);
-		mem_free(frames->next_latest_frame);
+	frames_list_object* const list = SDL_TLSGet(frames->list_tls);
+	if (list != NULL) {
+		list->hash = hash_bytes(list->hash, data, size);
+	}
+	else {
+		frames->next_latest_frame->hash = hash_bytes(frames->next_latest_frame->hash, data, size);
+	}
+}
+
+void frames_redraw(frames_object* const frames) {
+	assert(frames != NULL);
+
+	frames->redraw = true;
+}
+
+uint64_t frames_idle_skips_get(frames_object* const frames) {
+	assert(frames != NULL);
+
+	return frames->idle_skips;
+}
+
+frames_list_object* frames_list_create(frames_object* const frames) {
+	assert(frames != NULL);
+
+	frames_list_object* const list = mem_calloc(1u, sizeof(frames_list_object));
+	if (list == NULL) {
+		return NULL;
+	}
+	list->frames = frames;
+	list->commands_tail = &list->commands;
+
+	return list;
+}
+
+void frames_list_destroy(frames_list_object* const list) {
+	assert(list != NULL);
+	assert(!list->recording);
+
+	chunks_free(list->chunks);
+	mem_free(list);
+}
+
+bool frames_list_begin(frames_list_object* const list, const uint64_t key) {
+	assert(list != NULL);
+	assert(!list->recording);
+	assert(SDL_TLSGet(list->frames->list_tls) == NULL);
+
+	if (SDL_TLSSet(list->frames->list_tls, list, NULL) < 0) {
+		log_printf("Error beginning recording of a command list: %s\n", SDL_GetError());
 		return false;
 	}
+	list->recording = true;
+	list->key = key;
+	list->commands = NULL;
+	list->commands_tail = &list->commands;
+	list->used = 0u;
+	list->hash = hash_mix(HASH_SEED, key);
+	list->hashed = true;
+	if (list->chunks == NULL && list->last_used > MIN_CHUNK_SIZE) {
+		list->chunks = frame_chunk_create(list->last_used);
+	}
+
+	return true;
+}
+
+bool frames_list_end(frames_list_object* const list) {
+	assert(list != NULL);
+	assert(list->recording);
+	assert(list->frames->next_latest_frame != NULL);
+
+	frames_object* const frames = list->frames;
+	list->recording = false;
+	SDL_TLSSet(frames->list_tls, NULL, NULL);
+
+	frame_segment* const segment = chunks_alloc(&list->chunks, &list->used, sizeof(frame_segment));
+	if (segment == NULL) {
+		return false;
+	}
+	segment->key = list->key;
+	segment->commands = list->commands;
+	segment->commands_tail = list->commands != NULL ? list->commands_tail : &segment->commands;
+
+	frame_chunk* last_chunk = list->chunks;
+	while (last_chunk->next != NULL) {
+		last_chunk = last_chunk->next;
+	}
+
+	SDL_AtomicLock(&frames->lists_lock);
+	frame_object* const frame = frames->next_latest_frame;
+	segment->next = frame->lists;
+	frame->lists = segment;
+	frame->num_segments++;
+	last_chunk->next = frame->list_chunks;
+	frame->list_chunks = list->chunks;
+	frame->lists_hash += hash_mix(list->hash, list->key);
+	frame->hashed = frame->hashed && list->hashed;
+	SDL_AtomicUnlock(&frames->lists_lock);
+
+	list->chunks = NULL;
+	list->last_used = list->used;
+	list->commands = NULL;
+	list->commands_tail = &list->commands;
 
-	SDL_MemoryBarrierRelease();
-	SDL_AtomicSetPtr((void**)&frames->latest_frame, frames->next_latest_frame);
 	return true;
 }
 
@@ -134,88 +678,258 @@ bool frames_enqueue_command(
 ) {
 	assert(frames != NULL);
 	assert(frames->next_latest_frame != NULL);
-	assert(frames->next_latest_frame->commands != NULL);
 	assert(funcs != NULL);
 
-	queue_object* const commands = frames->next_latest_frame->commands;
+	frames_list_object* const list = SDL_TLSGet(frames->list_tls);
+	if (list != NULL) {
+		command_object* const command = chunks_alloc(&list->chunks, &list->used, sizeof(command_object));
+		if (command == NULL) {
+			return false;
+		}
+		command->next = NULL;
+		command->funcs = *funcs;
+		command->state = state;
+		list->hash = hash_command(list->hash, &list->hashed, funcs);
+
+		*list->commands_tail = command;
+		list->commands_tail = &command->next;
 
-	command_object* const command = mem_malloc(sizeof(command_object));
+		return true;
+	}
+
+	frame_object* const frame = frames->next_latest_frame;
+	command_object* const command = frame_alloc(frame, sizeof(command_object));
 	if (command == NULL) {
 		return false;
 	}
 	
+	command->next = NULL;
 	command->funcs = *funcs;
 	command->state = state;
-	
-	if (!queue_enqueue(commands, command)) {
-		mem_free(command);
-		return false;
-	}
+	frame->hash = hash_command(frame->hash, &frame->hashed, funcs);
+
+	frame_segment* const segment = frame->segment_last;
+	*segment->commands_tail = command;
+	segment->commands_tail = &command->next;
 
 	return true;
 }
 
+/*
+ * Wait for the GPU to finish all commands issued so far, returning the time it
+ * was seen finished, or 0 if it couldn't be waited on.
+ */
+static uint64_t gpu_finish_wait() {
+	GLsync const fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0u);
+	if (fence == NULL) {
+		opengl_error("Error from glFenceSync in frames_draw_latest: ");
+		return 0u;
+	}
+	const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, SYNC_TIMEOUT);
+	glDeleteSync(fence);
+	if (status == GL_WAIT_FAILED) {
+		opengl_error("Error from glClientWaitSync in frames_draw_latest: ");
+		return 0u;
+	}
+	else if (status == GL_TIMEOUT_EXPIRED) {
+		return 0u;
+	}
+	return nanotime_now();
+}
+
 frames_status_type frames_draw_latest(frames_object* const frames) {
 	assert(frames != NULL);
-	assert(frames->frame_queues != NULL);
 
-	frame_object* const latest_frame = SDL_AtomicGetPtr((void**)&frames->latest_frame);
-	SDL_MemoryBarrierAcquire();
+	const uint64_t started = frames->synced ? nanotime_now() : 0u;
 
-	if (latest_frame == NULL) {
+	frame_object* const first = frames_take_pending(frames);
+	frame_object* const held = frames->held_frame;
+	if (first == NULL && held == NULL) {
 		return FRAMES_STATUS_NO_FRAMES;
 	}
 
+	/*
+	 * An idle frame's image is already on screen. Stale frames of idle frames
+	 * must be hashed too, as they're only skippable if they have no effects.
+	 * Held frames are redrawn for interpolation, so they're never idle.
+	 */
+	if (first != NULL && held == NULL && !frames->interpolated && frames->drawn_valid && !frames->redraw) {
+		bool idle = true;
+		frame_object* latest = first;
+		for (; idle && latest != NULL; latest = latest->next) {
+			idle = latest->hashed && (latest->next != NULL || latest->hash == frames->drawn_hash);
+		}
+		if (idle) {
+			frames_retire_all(frames, first);
+			frames->idle_skips++;
+			return FRAMES_STATUS_IDLE;
+		}
+	}
+	frames->redraw = false;
+	frames->drawn_valid = false;
+
 	size_t screen_size[2];
 	prog_render_size_get(&screen_size[0], &screen_size[1]);
 	glDisable(GL_SCISSOR_TEST);
 	glViewport(0, 0, screen_size[0], screen_size[1]);
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	if (frames->gpu_timer != NULL) {
+		gpu_timer_timestamp(frames->gpu_timer, FRAMES_ZONE_CLEAR);
+	}
 	glClear(GL_COLOR_BUFFER_BIT);
+	if (frames->gpu_timer != NULL) {
+		gpu_timer_timestamp(frames->gpu_timer, GPU_TIMER_ZONE_NONE);
+	}
 
-	bool latest_frame_found = false;
-	for (
-		frame_object* frame = (frame_object*)conqueue_dequeue(frames->frame_queues);
-		frame != NULL;
-		queue_destroy(frame->commands), mem_free(frame), frame = (frame_object*)conqueue_dequeue(frames->frame_queues)
-	) {
-		const bool draw_now = frame == latest_frame;
-		for (
-			command_object* command = (command_object*)queue_dequeue(frame->commands);
-			command != NULL;
-			mem_free(command), command = (command_object*)queue_dequeue(frame->commands)
-		) {
-			if (command->funcs.update != NULL && !command->funcs.update(command->state)) {
+	if (first == NULL) {
+		/*
+		 * Redraw the held frame. Only its stateless commands are executed
+		 * again, as the others' effects persist from when it was first drawn.
+		 */
+		for (command_object* command = held->commands; command != NULL; command = command->next) {
+			if (
+				command->funcs.stateless && (
+					(command->funcs.update != NULL && !command->funcs.update(command->state)) ||
+					(command->funcs.draw != NULL && !command->funcs.draw(command->state))
+				)
+			) {
+				frames->held_frame = NULL;
+				frames_retire_all(frames, held);
 				return FRAMES_STATUS_ERROR;
 			}
+		}
+	}
 
-			if (draw_now && command->funcs.draw != NULL && !command->funcs.draw(command->state)) {
+	/*
+	 * The commands of a frame being held are kept for redrawing, so they're
+	 * only destroyed when the frame is retired.
+	 */
+	const bool hold = frames->interpolated;
+	for (frame_object* frame = first, * next; frame != NULL; frame = next) {
+		next = frame->next;
+		const bool draw_now = next == NULL;
+		const bool keep = draw_now && hold;
+		bool updated = false;
+		for (command_object* command = frame->commands; command != NULL; command = command->next) {
+			const bool update_now = command->funcs.update != NULL && (draw_now || !command->funcs.stateless);
+			updated = updated || update_now;
+			if (
+				(update_now && !command->funcs.update(command->state)) ||
+				(draw_now && command->funcs.draw != NULL && !command->funcs.draw(command->state))
+			) {
+				if (!keep) {
+					frame->commands = command;
+				}
+				frames_retire_all(frames, first);
 				return FRAMES_STATUS_ERROR;
 			}
 			
-			if (command->funcs.destroy != NULL) {
+			if (!keep && command->funcs.destroy != NULL) {
 				command->funcs.destroy(command->state);
 			}
 		}
+		if (!keep) {
+			frame->commands = NULL;
+		}
 
-		if (frame != latest_frame) {
+		if (!draw_now && updated) {
 			glFlush();
 		}
+	}
+
+	const uint64_t finished = frames->synced ? gpu_finish_wait() : 0u;
+
+	SDL_Window* const window = prog_window_get();
+	assert(window != NULL);
+	SDL_GL_SwapWindow(window);
+	if (frames->gpu_timer != NULL) {
+		gpu_timer_frame_end(frames->gpu_timer);
+	}
+
+	/*
+	 * Commands may have forced the next frame to be drawn while this one was
+	 * drawn, such as when depending on resources still loading.
+	 */
+	if (first != NULL) {
+		frame_object* latest = first;
+		while (latest->next != NULL) {
+			latest = latest->next;
+		}
+		frames->drawn_hash = latest->hash;
+		frames->drawn_valid = latest->hashed && !frames->redraw && !hold;
+	}
+
+	if (frames->synced && finished != 0u) {
+		const uint64_t presented = gpu_finish_wait();
+		if (presented != 0u) {
+			frames->timing.started = started;
+			frames->timing.finished = finished;
+			frames->timing.presented = presented;
+			frames->timed = true;
+		}
+	}
+
+	/*
+	 * Frames are only retired after the latest frame has been drawn, so command
+	 * updates can hand frame memory to the renderer for drawing without
+	 * copying it. A new frame replaces the held frame.
+	 */
+	if (first != NULL) {
+		if (held != NULL) {
+			frames_retire_all(frames, held);
+			frames->held_frame = NULL;
+		}
+		if (hold) {
+			frame_object* before_latest = NULL;
+			frame_object* latest = first;
+			for (; latest->next != NULL; latest = latest->next) {
+				before_latest = latest;
+			}
+			if (before_latest != NULL) {
+				before_latest->next = NULL;
+				frames_retire_all(frames, first);
+			}
+			frames->held_frame = latest;
+		}
 		else {
-			SDL_MemoryBarrierRelease();
-			SDL_AtomicCASPtr((void**)&frames->latest_frame, latest_frame, NULL);
-			SDL_MemoryBarrierAcquire();
-			latest_frame_found = true;
+			frames_retire_all(frames, first);
 		}
 	}
+	return FRAMES_STATUS_PRESENT;
+}
+
+void frames_gpu_timer_set(frames_object* const frames, gpu_timer_object* const timer) {
+	assert(frames != NULL);
 
-	if (latest_frame_found) {
-		SDL_Window* const window = prog_window_get();
-		assert(window != NULL);
-		SDL_GL_SwapWindow(window);
-		return FRAMES_STATUS_PRESENT;
+	frames->gpu_timer = timer;
+}
+
+void frames_interpolated_set(frames_object* const frames, const bool interpolated) {
+	assert(frames != NULL);
+
+	frames->interpolated = interpolated;
+	if (!interpolated && frames->held_frame != NULL) {
+		frames_retire_all(frames, frames->held_frame);
+		frames->held_frame = NULL;
 	}
-	else {
-		return FRAMES_STATUS_NO_PRESENT;
+}
+
+void frames_synced_set(frames_object* const frames, const bool synced) {
+	assert(frames != NULL);
+
+	frames->synced = synced;
+	if (!synced) {
+		frames->timed = false;
 	}
 }
+
+bool frames_timing_get(frames_object* const frames, frames_timing_type* const timing) {
+	assert(frames != NULL);
+	assert(timing != NULL);
+
+	if (!frames->timed) {
+		return false;
+	}
+	*timing = frames->timing;
+	return true;
+}
@@ -35,24 +35,47 @@
  */
 
 /*
- * TODO: Implement a "current-frame-only temporary memory allocator" mechanism
- * provided by frames_object, that accumulates the amount of memory allocated
- * per frame, creating a single memory chunk for temporary allocations for later
- * frames, and use that mechanism in the rest of the code.
+ * Each frame owns an arena that command state can be allocated from with
+ * frames_alloc; the arena is reset in one shot once the render thread retires
+ * the frame, and retired frames are recycled for later frames, so a steady
+ * state of similar frames allocates nothing.
  */
 
+#include "render/private/gpu_timer.h"
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct frames_object frames_object;
 
+/*
+ * The zone of the GPU timer that frames_draw_latest times its clear of the
+ * screen in. Other users of the timer must use other zones.
+ */
+#define FRAMES_ZONE_CLEAR ((size_t)0u)
+
 typedef bool (* command_update_func)(void* const state);
 typedef bool (* command_draw_func)(void* const state);
 typedef void (* command_destroy_func)(void* const state);
 
+/*
+ * When the producer has ended multiple frames since the last
+ * frames_draw_latest, only the latest frame is drawn, and the older stale
+ * frames are only replayed for their effects on later frames. Commands that
+ * declare themselves stateless, only affecting the frame they're in, have their
+ * update skipped in stale frames; only their destroy is called. Commands with
+ * effects that persist beyond their frame, such as resource loads or edits of
+ * retained objects, must not be stateless, so they're always updated.
+ *
+ * Commands that declare themselves hashed have had everything their update and
+ * draw depend on fed to frames_hash by their producer; see frames_hash.
+ */
 typedef struct command_funcs {
 	command_update_func update;
 	command_draw_func draw;
 	command_destroy_func destroy;
+	bool stateless;
+	bool hashed;
 } command_funcs;
 
 typedef enum frames_status_type {
@@ -60,6 +83,7 @@ typedef enum frames_status_type {
 	FRAMES_STATUS_NO_START,
 	FRAMES_STATUS_NO_PRESENT,
 	FRAMES_STATUS_NO_FRAMES,
+	FRAMES_STATUS_IDLE,
 	FRAMES_STATUS_ERROR
 } frames_status_type;
 
@@ -71,10 +95,138 @@ bool frames_start(frames_object* const frames);
 
 bool frames_end(frames_object* const frames);
 
+/*
+ * Allocate memory in the arena of the frame currently being produced, aligned
+ * for any type. The memory remains valid until the render thread has destroyed
+ * the frame's commands, so it needn't be freed; command state and payloads
+ * should be allocated this way. Frames are only retired at the end of the
+ * frames_draw_latest call they were drawn or skipped in, so command updates
+ * can pass the memory on to the renderer to be read when drawing, as long as
+ * the renderer drops such references before the next frames_draw_latest.
+ * Must only be called in the producer thread,
+ * between frames_start and frames_end. Returns NULL upon failure.
+ */
+void* frames_alloc(frames_object* const frames, const size_t size);
+
 bool frames_enqueue_command(
 	frames_object* const frames,
 	const command_funcs* const funcs,
 	void* const state
 );
 
+/*
+ * Set the ordering key of the commands the producer enqueues from now on in the
+ * current frame; see frames_list_begin. The key is 0 at the start of each
+ * frame. Must only be called in the producer thread, between frames_start and
+ * frames_end.
+ */
+bool frames_key_set(frames_object* const frames, const uint64_t key);
+
+/*
+ * Each frame has a content hash, over the commands enqueued in it, the ordering
+ * keys set in it, and the data producers feed to frames_hash. When the latest
+ * frame's hash equals that of the frame drawn before it, and every command of
+ * the pending frames is both stateless and hashed, the frame is idle: drawing
+ * it would reproduce the image already on screen, so frames_draw_latest skips
+ * drawing and presenting it, retiring it without executing its commands, and
+ * returns FRAMES_STATUS_IDLE. Producers of hashed commands must feed
+ * frames_hash all the data the command reads, but never data that changes
+ * without changing the image, like timestamps. Frames of unhashed commands are
+ * always drawn.
+ *
+ * Must be called where frames_alloc can be, and records into the calling
+ * thread's command list, if it's recording.
+ */
+void frames_hash(frames_object* const frames, const void* const data, const size_t size);
+
+/*
+ * Force the next frame to be drawn, even if it's idle, for when the image on
+ * screen can change without the frames' content changing, such as on window
+ * events, or when commands being drawn depend on resources still loading.
+ * Must only be called in the render thread, possibly from command updates or
+ * draws.
+ */
+void frames_redraw(frames_object* const frames);
+
+/*
+ * Returns the number of frames skipped as idle so far. Must only be called in
+ * the render thread.
+ */
+uint64_t frames_idle_skips_get(frames_object* const frames);
+
+/*
+ * Command lists let threads other than the producer record commands into the
+ * frame being produced, concurrently. While a thread is recording into a
+ * list, frames_alloc and frames_enqueue_command called in that thread record
+ * into the list, rather than directly into the frame, so any code enqueueing
+ * commands can record into lists unchanged. Each list only records in one
+ * thread at a time, but any number of lists can record at once.
+ *
+ * Lists are created and destroyed by the producer, while not recording.
+ */
+typedef struct frames_list_object frames_list_object;
+
+frames_list_object* frames_list_create(frames_object* const frames);
+void frames_list_destroy(frames_list_object* const list);
+
+/*
+ * Begin recording into the list in the calling thread, which must not already
+ * be recording. Must be called between the producer's frames_start and
+ * frames_end.
+ */
+bool frames_list_begin(frames_list_object* const list, const uint64_t key);
+
+/*
+ * End recording into the list, submitting its commands to the frame being
+ * produced, which must happen before the producer's frames_end. At
+ * frames_end, the frame's commands are merged in ascending key order, the
+ * producer's commands going before lists' commands of the same key, so the
+ * order of commands is deterministic as long as the keys of a frame's lists
+ * are unique.
+ */
+bool frames_list_end(frames_list_object* const list);
+
 frames_status_type frames_draw_latest(frames_object* const frames);
+
+/*
+ * Set the GPU timer used to time drawn frames, or NULL to not time them. The
+ * timer's frames are ended by frames_draw_latest after presenting each frame.
+ * Must only be called in the render thread.
+ */
+void frames_gpu_timer_set(frames_object* const frames, gpu_timer_object* const timer);
+
+/*
+ * Set whether frames are held for interpolation. While held, the latest drawn
+ * frame isn't retired until a newer frame is drawn, and frames_draw_latest
+ * redraws it whenever no newer frame is pending, executing only its stateless
+ * commands again; commands of held frames are only destroyed once the frames
+ * are retired. Stateless commands may thus be updated and drawn more than once.
+ * Not held by default. Must only be called in the render thread.
+ */
+void frames_interpolated_set(frames_object* const frames, const bool interpolated);
+
+/*
+ * Times of the latest frame drawn while synced, as from nanotime_now: when
+ * frames_draw_latest started, when the GPU finished drawing the frame, and
+ * when the GPU finished presenting it.
+ */
+typedef struct frames_timing_type {
+	uint64_t started;
+	uint64_t finished;
+	uint64_t presented;
+} frames_timing_type;
+
+/*
+ * Set whether frames_draw_latest waits on fences for the GPU to finish drawing
+ * and presenting each frame, so the real completion times of frames are
+ * known. Syncing keeps the GPU from queueing frames behind the CPU, trading
+ * throughput for latency. Not synced by default. Must only be called in the
+ * render thread.
+ */
+void frames_synced_set(frames_object* const frames, const bool synced);
+
+/*
+ * Get the timing of the latest frame drawn while synced. Returns false if no
+ * frame has been drawn while synced yet.
+ */
+bool frames_timing_get(frames_object* const frames, frames_timing_type* const timing);
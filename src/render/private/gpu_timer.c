@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/gpu_timer.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Frames' results are read back this many frames after they were recorded,
+ * by when the GPU has usually finished with them.
+ */
+#define NUM_TIMER_FRAMES 4u
+
+struct gpu_timer_object {
+	size_t max_timestamps;
+	GLuint* queries;
+	size_t* zones;
+	size_t lengths[NUM_TIMER_FRAMES];
+	size_t frame;
+
+	uint64_t* results;
+	size_t* result_zones;
+	size_t results_length;
+	bool results_available;
+	uint64_t results_count;
+};
+
+gpu_timer_object* gpu_timer_create(const size_t max_timestamps) {
+	assert(max_timestamps > 0u);
+	assert(max_timestamps <= SIZE_MAX / NUM_TIMER_FRAMES / sizeof(size_t));
+
+	GLint counter_bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+	if (opengl_error("Error from glGetQueryiv in gpu_timer_create: ")) {
+		return NULL;
+	}
+	if (counter_bits == 0) {
+		log_printf("The OpenGL implementation doesn't support timestamps, GPU times aren't available\n");
+		return NULL;
+	}
+
+	gpu_timer_object* const timer = mem_calloc(1u, sizeof(gpu_timer_object));
+	if (timer == NULL) {
+		return NULL;
+	}
+
+	timer->max_timestamps = max_timestamps;
+	timer->queries = mem_malloc(NUM_TIMER_FRAMES * max_timestamps * sizeof(GLuint));
+	timer->zones = mem_malloc(NUM_TIMER_FRAMES * max_timestamps * sizeof(size_t));
+	timer->results = mem_malloc(max_timestamps * sizeof(uint64_t));
+	timer->result_zones = mem_malloc(max_timestamps * sizeof(size_t));
+	if (timer->queries == NULL || timer->zones == NULL || timer->results == NULL || timer->result_zones == NULL) {
+		gpu_timer_destroy(timer);
+		return NULL;
+	}
+
+	glGenQueries((GLsizei)(NUM_TIMER_FRAMES * max_timestamps), timer->queries);
+	if (opengl_error("Error from glGenQueries in gpu_timer_create: ")) {
+		mem_free(timer->queries);
+		timer->queries = NULL;
+		gpu_timer_destroy(timer);
+		return NULL;
+	}
+
+	return timer;
+}
+
+void gpu_timer_destroy(gpu_timer_object* const timer) {
+	assert(timer != NULL);
+
+	if (timer->queries != NULL) {
+		glDeleteQueries((GLsizei)(NUM_TIMER_FRAMES * timer->max_timestamps), timer->queries);
+		mem_free(timer->queries);
+	}
+	if (timer->zones != NULL) {
+		mem_free(timer->zones);
+	}
+	if (timer->results != NULL) {
+		mem_free(timer->results);
+	}
+	if (timer->result_zones != NULL) {
+		mem_free(timer->result_zones);
+	}
+	mem_free(timer);
+}
+
+bool gpu_timer_timestamp(gpu_timer_object* const timer, const size_t zone) {
+	assert(timer != NULL);
+
+	size_t* const length = &timer->lengths[timer->frame];
+	if (*length == timer->max_timestamps) {
+		return false;
+	}
+
+	const size_t index = timer->frame * timer->max_timestamps + *length;
+	glQueryCounter(timer->queries[index], GL_TIMESTAMP);
+	timer->zones[index] = zone;
+	(*length)++;
+
+	return true;
+}
+
+void gpu_timer_frame_end(gpu_timer_object* const timer) {
+	assert(timer != NULL);
+
+	timer->frame = (timer->frame + 1u) % NUM_TIMER_FRAMES;
+	const size_t length = timer->lengths[timer->frame];
+	if (length == 0u) {
+		return;
+	}
+	timer->lengths[timer->frame] = 0u;
+
+	/*
+	 * Queries complete in order, so all the frame's results are available if
+	 * the last one is.
+	 */
+	const GLuint* const queries = &timer->queries[timer->frame * timer->max_timestamps];
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(queries[length - 1u], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available) {
+		return;
+	}
+
+	for (size_t i = 0u; i < length; i++) {
+		GLuint64 result;
+		glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &result);
+		timer->results[i] = result;
+	}
+	memcpy(timer->result_zones, &timer->zones[timer->frame * timer->max_timestamps], length * sizeof(size_t));
+	timer->results_length = length;
+	timer->results_available = true;
+	timer->results_count++;
+}
+
+bool gpu_timer_results_available(gpu_timer_object* const timer) {
+	assert(timer != NULL);
+
+	return timer->results_available;
+}
+
+uint64_t gpu_timer_results_count(gpu_timer_object* const timer) {
+	assert(timer != NULL);
+
+	return timer->results_count;
+}
+
+size_t gpu_timer_results_zones(gpu_timer_object* const timer, const size_t** const zones) {
+	assert(timer != NULL);
+	assert(zones != NULL);
+
+	*zones = timer->result_zones;
+	return timer->results_length;
+}
+
+double gpu_timer_zone_milliseconds(gpu_timer_object* const timer, const size_t zone) {
+	assert(timer != NULL);
+
+	uint64_t nanoseconds = 0u;
+	for (size_t i = 0u; i + 1u < timer->results_length; i++) {
+		if (timer->result_zones[i] == zone) {
+			nanoseconds += timer->results[i + 1u] - timer->results[i];
+		}
+	}
+
+	return nanoseconds / 1000000.0;
+}
+
+double gpu_timer_frame_milliseconds(gpu_timer_object* const timer) {
+	assert(timer != NULL);
+
+	if (timer->results_length < 2u) {
+		return 0.0;
+	}
+
+	return (timer->results[timer->results_length - 1u] - timer->results[0u]) / 1000000.0;
+}
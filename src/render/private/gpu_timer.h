@@ -0,0 +1,95 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * GPU timer, recording GL_TIMESTAMP queries into a ring of frames, so each
+ * frame's results are read back a few frames later without stalling. Each
+ * timestamp is tagged with a zone, the time from a timestamp to the next one in
+ * the frame being attributed to the zone of the earlier timestamp, so a frame's
+ * GPU time is divided up between zones just by recording timestamps at the
+ * boundaries of zones. Time after a timestamp of zone GPU_TIMER_ZONE_NONE isn't
+ * attributed to any zone. Results of frames that still aren't available by the
+ * time their slot in the ring is reused are dropped rather than waited on.
+ */
+
+#include "render/private/opengl.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct gpu_timer_object gpu_timer_object;
+
+#define GPU_TIMER_ZONE_NONE SIZE_MAX
+
+/*
+ * Create a GPU timer able to record up to max_timestamps timestamps per frame.
+ * Returns NULL if creation failed, or if the OpenGL implementation doesn't
+ * support timestamps.
+ */
+gpu_timer_object* gpu_timer_create(const size_t max_timestamps);
+
+void gpu_timer_destroy(gpu_timer_object* const timer);
+
+/*
+ * Record a timestamp starting the zone in the current frame. Timestamps beyond
+ * the per-frame maximum are ignored, returning false.
+ */
+bool gpu_timer_timestamp(gpu_timer_object* const timer, const size_t zone);
+
+/*
+ * End the current frame, reading back the results of the oldest frame in the
+ * ring if they're available.
+ */
+void gpu_timer_frame_end(gpu_timer_object* const timer);
+
+/*
+ * Whether results of any frame have been read back yet.
+ */
+bool gpu_timer_results_available(gpu_timer_object* const timer);
+
+/*
+ * The number of frames whose results have been read back, so users can tell
+ * newly read back results from the latest results being read again.
+ */
+uint64_t gpu_timer_results_count(gpu_timer_object* const timer);
+
+/*
+ * Get the zones of the timestamps of the latest read back frame, in the order
+ * they were recorded, so zones can be reported against the frame they were
+ * measured in, rather than the frame being drawn. Returns the number of zones.
+ */
+size_t gpu_timer_results_zones(gpu_timer_object* const timer, const size_t** const zones);
+
+/*
+ * The GPU time attributed to the zone in the latest read back frame, in
+ * milliseconds.
+ */
+double gpu_timer_zone_milliseconds(gpu_timer_object* const timer, const size_t zone);
+
+/*
+ * The GPU time from the first to the last timestamp of the latest read back
+ * frame, in milliseconds.
+ */
+double gpu_timer_frame_milliseconds(gpu_timer_object* const timer);
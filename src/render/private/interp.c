@@ -0,0 +1,200 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/interp.h"
+#include "util/mem.h"
+#include <string.h>
+#include <assert.h>
+
+#define MIN_CAPACITY ((size_t)256u)
+
+/*
+ * Open addressing hash tables of IDs to dsts. Entries are only valid if their
+ * stamp matches the table's, so a table is emptied by changing its stamp.
+ */
+typedef struct interp_entry {
+	uint32_t id;
+	uint32_t stamp;
+	vec4 dst;
+} interp_entry;
+
+typedef struct interp_table {
+	interp_entry* entries;
+	size_t capacity;
+	size_t count;
+	uint32_t stamp;
+} interp_table;
+
+struct interp_object {
+	interp_table previous;
+	interp_table current;
+	uint32_t next_stamp;
+};
+
+static inline size_t id_hash(const uint32_t id) {
+	return (size_t)(id * UINT32_C(0x9E3779B1));
+}
+
+static interp_entry* table_find(const interp_table* const table, const uint32_t id) {
+	if (table->capacity == 0u) {
+		return NULL;
+	}
+	const size_t mask = table->capacity - 1u;
+	for (size_t i = id_hash(id) & mask; ; i = (i + 1u) & mask) {
+		interp_entry* const entry = &table->entries[i];
+		if (entry->stamp != table->stamp) {
+			return NULL;
+		}
+		else if (entry->id == id) {
+			return entry;
+		}
+	}
+}
+
+/*
+ * Insert the ID if it isn't already in the table, returning its entry. The
+ * table must have room.
+ */
+static interp_entry* table_insert(interp_table* const table, const uint32_t id) {
+	const size_t mask = table->capacity - 1u;
+	for (size_t i = id_hash(id) & mask; ; i = (i + 1u) & mask) {
+		interp_entry* const entry = &table->entries[i];
+		if (entry->stamp != table->stamp) {
+			entry->id = id;
+			entry->stamp = table->stamp;
+			table->count++;
+			return entry;
+		}
+		else if (entry->id == id) {
+			return entry;
+		}
+	}
+}
+
+/*
+ * Make room for num_added more entries, keeping the load at most one half.
+ */
+static bool table_reserve(interp_table* const table, const size_t num_added) {
+	if (table->count + num_added <= table->capacity / 2u) {
+		return true;
+	}
+
+	size_t capacity = table->capacity > 0u ? table->capacity : MIN_CAPACITY;
+	while (table->count + num_added > capacity / 2u) {
+		if (capacity > SIZE_MAX / 2u / sizeof(interp_entry)) {
+			return false;
+		}
+		capacity *= 2u;
+	}
+	interp_entry* const entries = mem_calloc(capacity, sizeof(interp_entry));
+	if (entries == NULL) {
+		return false;
+	}
+
+	// Stamps are never zero, so the zeroed entries are all empty.
+	interp_table grown = {
+		.entries = entries,
+		.capacity = capacity,
+		.count = 0u,
+		.stamp = table->stamp
+	};
+	for (size_t i = 0u; i < table->capacity; i++) {
+		const interp_entry* const entry = &table->entries[i];
+		if (entry->stamp == table->stamp) {
+			memcpy(table_insert(&grown, entry->id)->dst, entry->dst, sizeof(vec4));
+		}
+	}
+	mem_free(table->entries);
+	*table = grown;
+	return true;
+}
+
+interp_object* interp_create() {
+	interp_object* const interp = mem_calloc(1u, sizeof(interp_object));
+	if (interp == NULL) {
+		return NULL;
+	}
+	interp->previous.stamp = 1u;
+	interp->current.stamp = 2u;
+	interp->next_stamp = 3u;
+	return interp;
+}
+
+void interp_destroy(interp_object* const interp) {
+	assert(interp != NULL);
+
+	mem_free(interp->previous.entries);
+	mem_free(interp->current.entries);
+	mem_free(interp);
+}
+
+void interp_tick(interp_object* const interp) {
+	assert(interp != NULL);
+
+	const interp_table previous = interp->previous;
+	interp->previous = interp->current;
+	interp->current = previous;
+	interp->current.count = 0u;
+	interp->current.stamp = interp->next_stamp;
+
+	// On wraparound, old stamps could come back into use, so both tables are
+	// truly emptied, only losing one tick's interpolation.
+	if (++interp->next_stamp == 0u) {
+		interp_table* const tables[] = { &interp->previous, &interp->current };
+		for (size_t i = 0u; i < lengthof(tables); i++) {
+			if (tables[i]->entries != NULL) {
+				memset(tables[i]->entries, 0, sizeof(interp_entry) * tables[i]->capacity);
+			}
+			tables[i]->count = 0u;
+			tables[i]->stamp = (uint32_t)(i + 1u);
+		}
+		interp->next_stamp = 3u;
+	}
+}
+
+bool interp_resolve(interp_object* const interp, const size_t num_sprites, const uint32_t* const ids, const sprite_type* const sprites, vec4* const from) {
+	assert(interp != NULL);
+	assert(num_sprites == 0u || (ids != NULL && sprites != NULL && from != NULL));
+
+	const bool reserved = table_reserve(&interp->current, num_sprites);
+	for (size_t i = 0u; i < num_sprites; i++) {
+		const interp_entry* const previous = table_find(&interp->previous, ids[i]);
+		memcpy(from[i], previous != NULL ? previous->dst : sprites[i].dst, sizeof(vec4));
+		if (reserved) {
+			memcpy(table_insert(&interp->current, ids[i])->dst, sprites[i].dst, sizeof(vec4));
+		}
+	}
+	return reserved;
+}
+
+void interp_blend(const size_t num_sprites, const sprite_type* const sprites, const vec4* const from, const float alpha, sprite_type* const blended) {
+	assert(num_sprites == 0u || (sprites != NULL && from != NULL && blended != NULL));
+
+	for (size_t i = 0u; i < num_sprites; i++) {
+		memcpy(blended[i].src, sprites[i].src, sizeof(vec4));
+		for (size_t j = 0u; j < 4u; j++) {
+			blended[i].dst[j] = from[i][j] + (sprites[i].dst[j] - from[i][j]) * alpha;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Interpolation of tracked sprites between app ticks. Each tick's tracked
+ * sprites are recorded by ID; resolving a tick's sprites finds where the
+ * sprite of the same ID was in the previous tick, then blending draws the
+ * sprites part of the way from there to where they are now. IDs only carry
+ * over from one tick to the next, so sprites missing for a tick start over.
+ */
+
+#include "render/render_types.h"
+#include "util/maths.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct interp_object interp_object;
+
+interp_object* interp_create();
+
+void interp_destroy(interp_object* const interp);
+
+/*
+ * Start a new tick. The sprites recorded since the last call become the
+ * previous tick's sprites.
+ */
+void interp_tick(interp_object* const interp);
+
+/*
+ * Record the tick's sprites under their IDs, and get the dst of each sprite in
+ * the previous tick into from, or the sprite's current dst if the ID wasn't in
+ * the previous tick. Returns false on allocation failure, in which case all
+ * the sprites get their current dst.
+ */
+bool interp_resolve(interp_object* const interp, const size_t num_sprites, const uint32_t* const ids, const sprite_type* const sprites, vec4* const from);
+
+/*
+ * Write the sprites into blended, with each dst blended from from by alpha,
+ * where 0.0f gives from and 1.0f gives the sprites' own dst.
+ */
+void interp_blend(const size_t num_sprites, const sprite_type* const sprites, const vec4* const from, const float alpha, sprite_type* const blended);
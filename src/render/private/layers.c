@@ -28,116 +28,443 @@
 
 #include "render/private/layers.h"
 #include "render/private/sprites.h"
+#include "render/private/tilemap.h"
+#include "render/private/particles.h"
+#include "render/private/opengl.h"
 #include "data/data_texture.h"
+#include "util/log.h"
+#include "util/maths.h"
 #include "util/mem.h"
 #include "SDL_video.h"
+#include <stdint.h>
+#include <string.h>
 #include <assert.h>
 
-#define ALIGN_BOTH_BUMP(type_a, type_b) ( \
-	_Alignof(type_a) > _Alignof(type_b) ? \
-		_Alignof(type_a) - _Alignof(type_b) : \
-		_Alignof(type_b) - _Alignof(type_a) \
-)
+/*
+ * Every submission is recorded with a 64-bit sort key, and the records are
+ * radix sorted when drawing, so there's no per-layer state beyond the sort
+ * flags, and the number of layers is only bounded by the key's layer field.
+ * From most to least significant, the key fields are:
+ *
+ * layer: The layer index.
+ * blend: The blend mode; currently always zero, as all sprites use alpha
+ * blending.
+ * sheet: Zero, unless the layer is sorted by sheet, in which case it's derived
+ * from the sheet's texture name, grouping sprites of the same sheet together.
+ * order: The submission order.
+ */
+#define KEY_ORDER_BITS 24u
+#define KEY_SHEET_BITS 20u
+#define KEY_BLEND_BITS 4u
+#define KEY_LAYER_BITS 16u
 
-#define SIZEOF_TAILED_ARRAY_STRUCT(struct_type, array_type, array_elements) \
-	(sizeof(struct_type) + (array_elements) * sizeof(array_type) + ALIGN_BOTH_BUMP(struct_type, array_type))
+#define KEY_ORDER_SHIFT 0u
+#define KEY_SHEET_SHIFT (KEY_ORDER_SHIFT + KEY_ORDER_BITS)
+#define KEY_BLEND_SHIFT (KEY_SHEET_SHIFT + KEY_SHEET_BITS)
+#define KEY_LAYER_SHIFT (KEY_BLEND_SHIFT + KEY_BLEND_BITS)
 
-typedef struct sprites_sequence {
-	size_t length;
-	size_t size;
-	data_texture_object* sheet;
-	sprite_type sprites[];
-} sprites_sequence;
+#define KEY_FIELD(value, field) (((uint64_t)(value) & ((UINT64_C(1) << KEY_##field##_BITS) - 1u)) << KEY_##field##_SHIFT)
 
-typedef struct sprites_layer {
+#define MAX_RECORDS ((size_t)1u << KEY_ORDER_BITS)
+
+/*
+ * A record's sprites are either copied into the layers' storage, in which case
+ * sprites is NULL and storage_start is the index of the first sprite in the
+ * storage, or referenced in memory owned by the caller. The type of the record
+ * determines the type of its sprites; batch records draw the batch instead,
+ * tilemap records draw the tiles of the tilemap within the record's bounds, and
+ * emitter records draw the emitter's particles.
+ * Only sprite_type sprites are ever copied into the storage.
+ */
+typedef enum layers_record_type {
+	RECORD_SPRITES,
+	RECORD_PACKED,
+	RECORD_EXTENDED,
+	RECORD_BATCH,
+	RECORD_TILEMAP,
+	RECORD_EMITTER
+} layers_record_type;
+
+typedef struct layers_record {
+	data_texture_object* sheet;
+	sprites_batch_object* batch;
+	tilemap_object* tilemap;
+	vec4 bounds;
+	emitter_object* emitter;
+	const void* sprites;
+	size_t storage_start;
 	size_t length;
-	size_t size;
-	sprites_sequence* sequences[];
-} sprites_layer;
+	layers_record_type type;
+} layers_record;
+
+typedef struct layers_sort_item {
+	uint64_t key;
+	size_t record;
+} layers_sort_item;
+
+/*
+ * A cached layer renders into the texture of its framebuffer, created when the
+ * layer is first drawn, and recreated when the viewport size changes. hash is
+ * the hash of everything drawn into the texture, so the layer is only rendered
+ * again when the hash of what's submitted differs, or the cache is invalid.
+ */
+typedef struct layers_cache {
+	size_t layer_index;
+	GLuint framebuffer;
+	data_texture_object texture;
+	uint64_t hash;
+	bool valid;
+} layers_cache;
+
+typedef struct layers_camera {
+	size_t layer_index;
+	camera_type camera;
+} layers_camera;
 
 struct layers_object {
 	sprites_object* sprites;
-	size_t size;
-	sprites_layer** layers;
+	sprites_format_type format;
+	texture_array_object* texture_array;
+
+	layers_record* records;
+	size_t records_length;
+	size_t records_size;
+
+	/*
+	 * The sort items are sorted between the two arrays, the sorted items ending
+	 * up in items.
+	 */
+	layers_sort_item* items;
+	layers_sort_item* items_temp;
+
+	sprite_type* storage;
+	size_t storage_length;
+	size_t storage_size;
+
+	bool* sheet_sorted;
+	size_t sheet_sorted_size;
+
+	layers_cache* caches;
+	size_t caches_length;
+	vec2 screen;
+
+	layers_camera* cameras;
+	size_t cameras_length;
+
+	bool stats_enabled;
+	gpu_timer_object* timer;
+	size_t other_zone;
+	size_t layer_zone_base;
+	layers_stats_type stats[LAYERS_STATS_MAX];
+	size_t stats_length;
 };
 
-layers_object* layers_create(const size_t num_layers) {
+layers_object* layers_create(const sprites_format_type format, texture_array_object* const texture_array) {
 	layers_object* const layers = mem_calloc(1u, sizeof(layers_object));
 	if (layers == NULL) {
 		return NULL;
 	}
 
-	layers->sprites = sprites_create(0u);
+	layers->sprites = sprites_create(0u, format, texture_array);
 	if (layers->sprites == NULL) {
 		mem_free(layers);
 		return NULL;
 	}
+	layers->format = format;
+	layers->texture_array = texture_array;
+
+	return layers;
+}
+
+bool layers_format_set(layers_object* const layers, const sprites_format_type format) {
+	assert(layers != NULL);
 
-	if (num_layers == 0u) {
-		return layers;
+	if (format == layers->format) {
+		return true;
 	}
 
-	layers->layers = mem_calloc(num_layers, sizeof(sprites_layer*));
-	if (layers->layers == NULL) {
-		sprites_destroy(layers->sprites);
-		mem_free(layers);
-		return NULL;
+	sprites_object* const new_sprites = sprites_create(0u, format, layers->texture_array);
+	if (new_sprites == NULL) {
+		return false;
 	}
+	sprites_destroy(layers->sprites);
+	layers->sprites = new_sprites;
+	layers->format = format;
 
-	layers->size = num_layers;
+	return true;
+}
 
-	return layers;
+static void cache_target_delete(layers_cache* const cache) {
+	if (cache->framebuffer != 0u) {
+		glDeleteFramebuffers(1, &cache->framebuffer);
+		cache->framebuffer = 0u;
+	}
+	if (cache->texture.name != 0u) {
+		glDeleteTextures(1, &cache->texture.name);
+		cache->texture.name = 0u;
+	}
+	cache->valid = false;
 }
 
 void layers_destroy(layers_object* const layers) {
-	if (layers->layers != NULL) {
-		for (size_t i = 0u; i < layers->size; i++) {
-			sprites_layer* const layer = layers->layers[i];
-			if (layer == NULL) {
-				continue;
-			}
-			for (size_t j = 0u; j < layer->size; j++) {
-				sprites_sequence* const sequence = layer->sequences[j];
-				if (sequence == NULL) {
-					continue;
-				}
-				mem_free(sequence);
-			}
-			mem_free(layer);
-		}
-		mem_free(layers->layers);
+	for (size_t i = 0u; i < layers->caches_length; i++) {
+		cache_target_delete(&layers->caches[i]);
+	}
+	if (layers->caches != NULL) {
+		mem_free(layers->caches);
+	}
+	if (layers->records != NULL) {
+		mem_free(layers->records);
+	}
+	if (layers->items != NULL) {
+		mem_free(layers->items);
+	}
+	if (layers->items_temp != NULL) {
+		mem_free(layers->items_temp);
+	}
+	if (layers->storage != NULL) {
+		mem_free(layers->storage);
+	}
+	if (layers->sheet_sorted != NULL) {
+		mem_free(layers->sheet_sorted);
+	}
+	if (layers->cameras != NULL) {
+		mem_free(layers->cameras);
 	}
 	sprites_destroy(layers->sprites);
 	mem_free(layers);
 }
 
 void layers_restart(layers_object* const layers) {
-	for (size_t i = 0u; i < layers->size; i++) {
-		sprites_layer* const layer = layers->layers[i];
-		if (layer == NULL) {
-			continue;
-		}
-		for (size_t j = 0u; j < layer->size; j++) {
-			sprites_sequence* const sequence = layer->sequences[j];
-			if (sequence != NULL) {
-				sequence->length = 0u;
-			}
-		}
-		layer->length = 0u;
-	}
+	layers->records_length = 0u;
+	layers->storage_length = 0u;
 }
 
 void layers_screen_reset(layers_object* const layers) {
 	sprites_screen_reset(layers->sprites);
+	layers->screen[0] = 0.0f;
+	layers->screen[1] = 0.0f;
 }
 
 void layers_screen_set(layers_object* const layers, const float width, const float height) {
 	sprites_screen_set(layers->sprites, width, height);
+	layers->screen[0] = width;
+	layers->screen[1] = height;
+}
+
+bool layers_sheet_sorted_set(layers_object* const layers, const size_t layer_index, const bool sheet_sorted) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+
+	if (layer_index >= layers->sheet_sorted_size) {
+		if (!sheet_sorted) {
+			return true;
+		}
+		const size_t new_size = layer_index * 2u + 1u < LAYERS_MAX ? layer_index * 2u + 1u : LAYERS_MAX;
+		bool* const new_sheet_sorted = mem_realloc(layers->sheet_sorted, sizeof(bool) * new_size);
+		if (new_sheet_sorted == NULL) {
+			return false;
+		}
+		memset(new_sheet_sorted + layers->sheet_sorted_size, 0, sizeof(bool) * (new_size - layers->sheet_sorted_size));
+		layers->sheet_sorted = new_sheet_sorted;
+		layers->sheet_sorted_size = new_size;
+	}
+	layers->sheet_sorted[layer_index] = sheet_sorted;
+
+	return true;
+}
+
+static layers_cache* cache_get(layers_object* const layers, const size_t layer_index) {
+	for (size_t i = 0u; i < layers->caches_length; i++) {
+		if (layers->caches[i].layer_index == layer_index) {
+			return &layers->caches[i];
+		}
+	}
+	return NULL;
+}
+
+bool layers_cached_set(layers_object* const layers, const size_t layer_index, const bool cached) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+
+	layers_cache* const cache = cache_get(layers, layer_index);
+	if (cached == (cache != NULL)) {
+		return true;
+	}
+	else if (!cached) {
+		cache_target_delete(cache);
+		*cache = layers->caches[--layers->caches_length];
+		return true;
+	}
+
+	layers_cache* const new_caches = mem_realloc(layers->caches, sizeof(layers_cache) * (layers->caches_length + 1u));
+	if (new_caches == NULL) {
+		return false;
+	}
+	layers->caches = new_caches;
+
+	layers_cache* const new_cache = &layers->caches[layers->caches_length++];
+	*new_cache = (layers_cache) {
+		.layer_index = layer_index,
+		.framebuffer = 0u,
+		.texture = {
+			.name = 0u,
+			.array_layer = DATA_TEXTURE_ARRAY_EXCLUDED
+		},
+		.hash = 0u,
+		.valid = false
+	};
+
+	return true;
+}
+
+void layers_invalidate(layers_object* const layers, const size_t layer_index) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+
+	layers_cache* const cache = cache_get(layers, layer_index);
+	if (cache != NULL) {
+		cache->valid = false;
+	}
+}
+
+static layers_camera* camera_get(layers_object* const layers, const size_t layer_index) {
+	for (size_t i = 0u; i < layers->cameras_length; i++) {
+		if (layers->cameras[i].layer_index == layer_index) {
+			return &layers->cameras[i];
+		}
+	}
+	return NULL;
+}
+
+bool layers_camera_set(layers_object* const layers, const size_t layer_index, const camera_type* const camera) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+
+	layers_camera* const found = camera_get(layers, layer_index);
+	if (camera == NULL) {
+		if (found != NULL) {
+			*found = layers->cameras[--layers->cameras_length];
+		}
+		return true;
+	}
+	else if (found != NULL) {
+		found->camera = *camera;
+		return true;
+	}
+
+	layers_camera* const new_cameras = mem_realloc(layers->cameras, sizeof(layers_camera) * (layers->cameras_length + 1u));
+	if (new_cameras == NULL) {
+		return false;
+	}
+	layers->cameras = new_cameras;
+	layers->cameras[layers->cameras_length++] = (layers_camera) {
+		.layer_index = layer_index,
+		.camera = *camera
+	};
+
+	return true;
+}
+
+void layers_camera_bounds_get(layers_object* const layers, const size_t layer_index, const vec4 bounds, vec4 layer_bounds) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+
+	const layers_camera* const found = camera_get(layers, layer_index);
+	if (found == NULL || found->camera.zoom == 0.0f) {
+		memcpy(layer_bounds, bounds, sizeof(vec4));
+		return;
+	}
+
+	/*
+	 * The corners of the bounds are taken back into the layer by the inverse
+	 * of the camera's transform, about the center of the screen, or of the
+	 * bounds if the screen isn't set.
+	 */
+	const camera_type* const camera = &found->camera;
+	const float center[2] = {
+		layers->screen[0] > 0.0f ? layers->screen[0] * 0.5f : (bounds[0] + bounds[2]) * 0.5f,
+		layers->screen[1] > 0.0f ? layers->screen[1] * 0.5f : (bounds[1] + bounds[3]) * 0.5f
+	};
+	const float c = cosf(camera->rotation) / camera->zoom;
+	const float s = sinf(camera->rotation) / camera->zoom;
+	for (size_t corner = 0u; corner < 4u; corner++) {
+		const float dx = bounds[(corner & 1u) ? 2u : 0u] - center[0];
+		const float dy = bounds[(corner & 2u) ? 3u : 1u] - center[1];
+		const float x = camera->x + dx * c + dy * s;
+		const float y = camera->y - dx * s + dy * c;
+		if (corner == 0u || x < layer_bounds[0]) layer_bounds[0] = x;
+		if (corner == 0u || y < layer_bounds[1]) layer_bounds[1] = y;
+		if (corner == 0u || x > layer_bounds[2]) layer_bounds[2] = x;
+		if (corner == 0u || y > layer_bounds[3]) layer_bounds[3] = y;
+	}
+}
+
+/*
+ * Build the transform of the camera, from the layer's coordinates to the
+ * screen's.
+ */
+static void camera_transform(const camera_type* const camera, const vec2 screen, mat4 transform) {
+	const vec3 to_origin = { -camera->x, -camera->y, 0.0f };
+	const vec4 zoom = { camera->zoom, camera->zoom, 1.0f, 1.0f };
+	const vec3 to_center = { screen[0] * 0.5f, screen[1] * 0.5f, 0.0f };
+	mat4_identity(transform);
+	mat4_translate(transform, to_origin);
+	mat4_scale(transform, zoom);
+	mat4_rotatez(transform, MATHS_TO_DEGREES(camera->rotation));
+	mat4_translate(transform, to_center);
+}
+
+/*
+ * Get a new record, placed in the layer. The record's fields other than the
+ * sheet must be filled in by the caller.
+ */
+static layers_record* record_next(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index) {
+	assert(layer_index < LAYERS_MAX);
+
+	if (layers->records_length == MAX_RECORDS) {
+		return NULL;
+	}
+	else if (layers->records_length == layers->records_size) {
+		const size_t new_size = layers->records_size > 0u ? layers->records_size * 2u : 64u;
+		layers_record* const new_records = mem_realloc(layers->records, sizeof(layers_record) * new_size);
+		if (new_records == NULL) {
+			return NULL;
+		}
+		layers->records = new_records;
+
+		layers_sort_item* const new_items = mem_realloc(layers->items, sizeof(layers_sort_item) * new_size);
+		if (new_items == NULL) {
+			return NULL;
+		}
+		layers->items = new_items;
+
+		layers_sort_item* const new_items_temp = mem_realloc(layers->items_temp, sizeof(layers_sort_item) * new_size);
+		if (new_items_temp == NULL) {
+			return NULL;
+		}
+		layers->items_temp = new_items_temp;
+
+		layers->records_size = new_size;
+	}
+
+	const size_t record_index = layers->records_length++;
+	const bool sheet_sorted = sheet != NULL && layer_index < layers->sheet_sorted_size && layers->sheet_sorted[layer_index];
+	layers->items[record_index].key =
+		KEY_FIELD(layer_index, LAYER) |
+		KEY_FIELD(0u, BLEND) |
+		KEY_FIELD(sheet_sorted ? sheet->name : 0u, SHEET) |
+		KEY_FIELD(record_index, ORDER);
+	layers->items[record_index].record = record_index;
+
+	layers_record* const record = &layers->records[record_index];
+	record->sheet = sheet;
+	return record;
 }
 
 bool layers_sprites_add(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_added, sprite_type* const added_sprites) {
 	assert(layers != NULL);
-	assert(layer_index < layers->size);
+	assert(layer_index < LAYERS_MAX);
 	assert(sheet != NULL);
 	assert(added_sprites != NULL);
 
@@ -145,80 +472,532 @@ bool layers_sprites_add(layers_object* const layers, data_texture_object* const
 		return true;
 	}
 
-	sprites_layer* layer = layers->layers[layer_index];
-	if (layer == NULL) {
-		sprites_layer* const new_layer = mem_calloc(1u, SIZEOF_TAILED_ARRAY_STRUCT(sprites_layer, sprites_sequence*, 1u));
-		if (new_layer == NULL) {
+	if (layers->storage_length + num_added > layers->storage_size) {
+		const size_t new_size = (layers->storage_length + num_added) * 2u;
+		sprite_type* const new_storage = mem_realloc(layers->storage, sizeof(sprite_type) * new_size);
+		if (new_storage == NULL) {
 			return false;
 		}
-		new_layer->size = 1u;
-		layers->layers[layer_index] = new_layer;
-		layer = new_layer;
+		layers->storage = new_storage;
+		layers->storage_size = new_size;
 	}
-	else if (layer->length + 1u > layer->size) {
-		const size_t new_layer_length = layer->length + 1u;
-		sprites_layer* const new_layer = mem_realloc(layer, SIZEOF_TAILED_ARRAY_STRUCT(sprites_layer, sprites_sequence*, new_layer_length * 2u));
-		if (new_layer == NULL) {
-			return false;
+
+	layers_record* const record = record_next(layers, sheet, layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	memcpy(layers->storage + layers->storage_length, added_sprites, num_added * sizeof(sprite_type));
+	record->batch = NULL;
+	record->sprites = NULL;
+	record->storage_start = layers->storage_length;
+	record->length = num_added;
+	record->type = RECORD_SPRITES;
+	layers->storage_length += num_added;
+
+	return true;
+}
+
+bool layers_sprites_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const sprite_type* const referenced_sprites) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(sheet != NULL);
+	assert(referenced_sprites != NULL);
+
+	if (num_referenced == 0u) {
+		return true;
+	}
+
+	layers_record* const record = record_next(layers, sheet, layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->batch = NULL;
+	record->sprites = referenced_sprites;
+	record->length = num_referenced;
+	record->type = RECORD_SPRITES;
+
+	return true;
+}
+
+bool layers_packed_sprites_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const packed_sprite_type* const referenced_sprites) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(sheet != NULL);
+	assert(referenced_sprites != NULL);
+
+	if (num_referenced == 0u) {
+		return true;
+	}
+
+	layers_record* const record = record_next(layers, sheet, layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->batch = NULL;
+	record->sprites = referenced_sprites;
+	record->length = num_referenced;
+	record->type = RECORD_PACKED;
+
+	return true;
+}
+
+bool layers_sprites_ex_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const sprite_ex_type* const referenced_sprites) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(sheet != NULL);
+	assert(referenced_sprites != NULL);
+
+	if (num_referenced == 0u) {
+		return true;
+	}
+
+	layers_record* const record = record_next(layers, sheet, layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->batch = NULL;
+	record->sprites = referenced_sprites;
+	record->length = num_referenced;
+	record->type = RECORD_EXTENDED;
+
+	return true;
+}
+
+bool layers_batch_add(layers_object* const layers, const size_t layer_index, sprites_batch_object* const batch) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(batch != NULL);
+
+	layers_record* const record = record_next(layers, sprites_batch_sheet_get(batch), layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->batch = batch;
+	record->sprites = NULL;
+	record->length = 0u;
+	record->type = RECORD_BATCH;
+
+	return true;
+}
+
+bool layers_tilemap_add(layers_object* const layers, const size_t layer_index, tilemap_object* const tilemap, const vec4 bounds) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(tilemap != NULL);
+	assert(bounds != NULL);
+
+	layers_record* const record = record_next(layers, tilemap_sheet_get(tilemap), layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->tilemap = tilemap;
+	vec4_copy(record->bounds, bounds);
+	record->sprites = NULL;
+	record->length = 0u;
+	record->type = RECORD_TILEMAP;
+
+	return true;
+}
+
+bool layers_emitter_add(layers_object* const layers, const size_t layer_index, emitter_object* const emitter) {
+	assert(layers != NULL);
+	assert(layer_index < LAYERS_MAX);
+	assert(emitter != NULL);
+
+	layers_record* const record = record_next(layers, emitter_sheet_get(emitter), layer_index);
+	if (record == NULL) {
+		return false;
+	}
+
+	record->emitter = emitter;
+	record->sprites = NULL;
+	record->length = 0u;
+	record->type = RECORD_EMITTER;
+
+	return true;
+}
+
+/*
+ * Least-significant-digit radix sort of the items by key, a byte at a time.
+ * Passes over bytes that are the same in all keys are skipped, so typically
+ * only a few of the eight passes are made.
+ */
+static void items_sort(layers_object* const layers) {
+	const size_t num_items = layers->records_length;
+	size_t counts[8u][256u];
+	memset(counts, 0, sizeof(counts));
+	for (size_t i = 0u; i < num_items; i++) {
+		const uint64_t key = layers->items[i].key;
+		for (size_t digit = 0u; digit < 8u; digit++) {
+			counts[digit][(key >> (digit * 8u)) & 0xFFu]++;
 		}
-		memset(new_layer->sequences + new_layer->size, 0, (new_layer_length * 2u - new_layer->size) * sizeof(sprites_sequence*));
-		new_layer->size = new_layer_length * 2u;
-		layers->layers[layer_index] = new_layer;
-		layer = new_layer;
 	}
 
-	sprites_sequence* sequence = layer->sequences[layer->length];
-	if (sequence == NULL) {
-		sprites_sequence* const new_sequence = mem_malloc(SIZEOF_TAILED_ARRAY_STRUCT(sprites_sequence, sprite_type, num_added * 2u));
-		if (new_sequence == NULL) {
-			return false;
+	for (size_t digit = 0u; digit < 8u; digit++) {
+		size_t* const digit_counts = counts[digit];
+		if (digit_counts[(layers->items[0u].key >> (digit * 8u)) & 0xFFu] == num_items) {
+			continue;
+		}
+
+		size_t offset = 0u;
+		for (size_t i = 0u; i < 256u; i++) {
+			const size_t count = digit_counts[i];
+			digit_counts[i] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0u; i < num_items; i++) {
+			const layers_sort_item item = layers->items[i];
+			layers->items_temp[digit_counts[(item.key >> (digit * 8u)) & 0xFFu]++] = item;
 		}
-		new_sequence->length = 0u;
-		new_sequence->size = num_added * 2u;
-		layer->sequences[layer->length] = new_sequence;
-		sequence = new_sequence;
+
+		layers_sort_item* const sorted = layers->items_temp;
+		layers->items_temp = layers->items;
+		layers->items = sorted;
 	}
-	else if (num_added > sequence->size) {
-		sprites_sequence* const new_sequence = mem_realloc(sequence, SIZEOF_TAILED_ARRAY_STRUCT(sprites_sequence, sprite_type, num_added + sequence->size));
-		if (new_sequence == NULL) {
+}
+
+static size_t item_layer_get(const layers_sort_item* const item) {
+	return (size_t)((item->key >> KEY_LAYER_SHIFT) & ((UINT64_C(1) << KEY_LAYER_BITS) - 1u));
+}
+
+static bool tilemap_record_draw(void* const data, const mat4 view, sprites_stats_type* const stats) {
+	layers_record* const record = data;
+	return tilemap_draw(record->tilemap, record->bounds, view, stats);
+}
+
+static bool emitter_record_draw(void* const data, const mat4 view, sprites_stats_type* const stats) {
+	layers_record* const record = data;
+	return emitter_draw(record->emitter, view, stats);
+}
+
+/*
+ * Add the sorted records from start up to, but not including, end.
+ */
+static bool records_add(layers_object* const layers, const size_t start, const size_t end) {
+	for (size_t i = start; i < end; i++) {
+		layers_record* const record = &layers->records[layers->items[i].record];
+
+		bool added;
+		switch (record->type) {
+		case RECORD_BATCH:
+			added = sprites_add_batch(layers->sprites, record->batch);
+			break;
+
+		case RECORD_TILEMAP:
+			added = sprites_add_draw(layers->sprites, tilemap_record_draw, record);
+			break;
+
+		case RECORD_EMITTER:
+			added = sprites_add_draw(layers->sprites, emitter_record_draw, record);
+			break;
+
+		case RECORD_PACKED:
+			added = sprites_add_packed(layers->sprites, record->sheet, record->length, record->sprites);
+			break;
+
+		case RECORD_EXTENDED:
+			added = sprites_add_ex(layers->sprites, record->sheet, record->length, record->sprites);
+			break;
+
+		default: {
+			const sprite_type* const sprites = record->sprites != NULL ? record->sprites : layers->storage + record->storage_start;
+			added = sprites_add(layers->sprites, record->sheet, record->length, sprites);
+			break;
+		}
+		}
+		if (!added) {
 			return false;
 		}
-		new_sequence->size = num_added + sequence->size;
-		layer->sequences[layer->length] = new_sequence;
-		sequence = new_sequence;
 	}
 
-	sequence->sheet = sheet;
-	sequence->length = num_added;
+	return true;
+}
+
+/*
+ * 64-bit FNV-1a, applied a word at a time rather than a byte at a time, as
+ * whole layers of sprites are hashed every frame.
+ */
+#define HASH_BASIS UINT64_C(14695981039346656037)
+#define HASH_PRIME UINT64_C(1099511628211)
+
+static uint64_t hash_bytes(uint64_t hash, const void* const bytes, const size_t size) {
+	const unsigned char* const src = bytes;
+	size_t i = 0u;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, src + i, sizeof(uint64_t));
+		hash = (hash ^ word) * HASH_PRIME;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ src[i]) * HASH_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t hash_value(const uint64_t hash, const uint64_t value) {
+	return (hash ^ value) * HASH_PRIME;
+}
+
+/*
+ * Hash everything affecting what the records from start to end draw: The
+ * sheets, the sprites, the screen, the viewport, the format, and the camera.
+ * Batches, tilemaps and emitters are hashed by their version, rather than
+ * their sprites, tiles or particles.
+ */
+static uint64_t records_hash(layers_object* const layers, const size_t start, const size_t end, const vec2 screen, const GLint viewport[4], const layers_camera* const camera) {
+	uint64_t hash = HASH_BASIS;
+	hash = hash_bytes(hash, screen, sizeof(vec2));
+	hash = hash_bytes(hash, viewport, sizeof(GLint) * 4u);
+	hash = hash_value(hash, layers->format);
+	hash = hash_value(hash, camera != NULL);
+	if (camera != NULL) {
+		hash = hash_bytes(hash, &camera->camera, sizeof(camera_type));
+	}
+	for (size_t i = start; i < end; i++) {
+		const layers_record* const record = &layers->records[layers->items[i].record];
+
+		hash = hash_value(hash, record->type);
+		hash = hash_value(hash, record->length);
+		if (record->sheet != NULL) {
+			hash = hash_value(hash, record->sheet->name);
+			hash = hash_bytes(hash, &record->sheet->width, sizeof(float));
+			hash = hash_bytes(hash, &record->sheet->height, sizeof(float));
+		}
+		switch (record->type) {
+		case RECORD_BATCH:
+			hash = hash_value(hash, (uint64_t)(uintptr_t)record->batch);
+			hash = hash_value(hash, sprites_batch_version_get(record->batch));
+			break;
+
+		case RECORD_TILEMAP:
+			hash = hash_value(hash, (uint64_t)(uintptr_t)record->tilemap);
+			hash = hash_value(hash, tilemap_version_get(record->tilemap));
+			hash = hash_bytes(hash, record->bounds, sizeof(vec4));
+			break;
+
+		case RECORD_EMITTER:
+			hash = hash_value(hash, (uint64_t)(uintptr_t)record->emitter);
+			hash = hash_value(hash, emitter_version_get(record->emitter));
+			break;
+
+		case RECORD_PACKED:
+			hash = hash_bytes(hash, record->sprites, sizeof(packed_sprite_type) * record->length);
+			break;
+
+		case RECORD_EXTENDED:
+			hash = hash_bytes(hash, record->sprites, sizeof(sprite_ex_type) * record->length);
+			break;
+
+		default: {
+			const sprite_type* const sprites = record->sprites != NULL ? record->sprites : layers->storage + record->storage_start;
+			hash = hash_bytes(hash, sprites, sizeof(sprite_type) * record->length);
+			break;
+		}
+		}
+	}
+	return hash;
+}
+
+/*
+ * Make sure the cache's framebuffer exists, with a texture of the size of the
+ * viewport.
+ */
+static bool cache_target_get(layers_cache* const cache, const GLsizei width, const GLsizei height) {
+	if (cache->framebuffer != 0u && cache->texture.width == (float)width && cache->texture.height == (float)height) {
+		return true;
+	}
+	cache_target_delete(cache);
 
-	memcpy(sequence->sprites, added_sprites, num_added * sizeof(sprite_type));
-	layer->length++;
+	glGenTextures(1, &cache->texture.name);
+	if (opengl_error("Error from glGenTextures in layers_draw: ")) {
+		cache->texture.name = 0u;
+		return false;
+	}
+	glBindTexture(GL_TEXTURE_2D, cache->texture.name);
+	opengl_label(GL_TEXTURE, cache->texture.name, "layer cache");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	if (opengl_error("Error from glTexImage2D in layers_draw: ")) {
+		cache_target_delete(cache);
+		return false;
+	}
+	cache->texture.width = (float)width;
+	cache->texture.height = (float)height;
+	cache->texture.array_layer = DATA_TEXTURE_ARRAY_EXCLUDED;
+	cache->texture.gpu_size = (size_t)width * (size_t)height * 4u;
+
+	GLint framebuffer;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+	glGenFramebuffers(1, &cache->framebuffer);
+	if (opengl_error("Error from glGenFramebuffers in layers_draw: ")) {
+		cache->framebuffer = 0u;
+		cache_target_delete(cache);
+		return false;
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, cache->framebuffer);
+	opengl_label(GL_FRAMEBUFFER, cache->framebuffer, "layer cache");
+	glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, cache->texture.name, 0);
+	const bool complete = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)framebuffer);
+	if (!complete) {
+		log_printf("Error in layers_draw: A layer cache's framebuffer is incomplete\n");
+		cache_target_delete(cache);
+		return false;
+	}
 
 	return true;
 }
 
+/*
+ * Add the records from start to end of a layer, viewed through its camera if
+ * it has one, the view changing back to screen coordinates afterwards.
+ */
+static bool camera_records_add(layers_object* const layers, const size_t start, const size_t end, const vec2 screen, const layers_camera* const camera) {
+	if (camera == NULL) {
+		return records_add(layers, start, end);
+	}
+
+	mat4 transform;
+	camera_transform(&camera->camera, screen, transform);
+	return
+		sprites_add_view(layers->sprites, transform) &&
+		records_add(layers, start, end) &&
+		sprites_add_view(layers->sprites, NULL);
+}
+
+/*
+ * Add the records from start to end of a cached layer, only rendering them
+ * into the cache's texture if they've changed, then add the texture, covering
+ * the screen. Layers fall back to being drawn uncached if the cache's
+ * framebuffer can't be created.
+ */
+static bool cached_records_add(layers_object* const layers, layers_cache* const cache, const size_t start, const size_t end, const vec2 screen, const GLint viewport[4], const layers_camera* const camera) {
+	if (!cache_target_get(cache, viewport[2], viewport[3])) {
+		return camera_records_add(layers, start, end, screen, camera);
+	}
+
+	const uint64_t hash = records_hash(layers, start, end, screen, viewport, camera);
+	if (!cache->valid || hash != cache->hash) {
+		if (
+			!sprites_add_target(layers->sprites, cache->framebuffer, viewport[2], viewport[3], SPRITES_BLEND_ALPHA) ||
+			!camera_records_add(layers, start, end, screen, camera)
+		) {
+			return false;
+		}
+		cache->hash = hash;
+		cache->valid = true;
+	}
+
+	/*
+	 * The texture is upside down relative to the screen, so it's drawn
+	 * mirrored vertically.
+	 */
+	const sprite_ex_type composite = {
+		.src = { 0.0f, 0.0f, cache->texture.width, cache->texture.height },
+		.dst = { 0.0f, 0.0f, screen[0], screen[1] },
+		.origin = { screen[0] * 0.5f, screen[1] * 0.5f },
+		.scale = { 1.0f, -1.0f },
+		.tint = { 1.0f, 1.0f, 1.0f, 1.0f },
+		.rotation = 0.0f
+	};
+	return
+		sprites_add_target(layers->sprites, 0u, 0, 0, SPRITES_BLEND_PREMULTIPLIED) &&
+		sprites_add_ex(layers->sprites, &cache->texture, 1u, &composite) &&
+		sprites_add_target(layers->sprites, 0u, 0, 0, SPRITES_BLEND_ALPHA);
+}
+
 bool layers_draw(layers_object* const layers) {
 	assert(layers != NULL);
 
 	sprites_restart(layers->sprites);
 
-	for (size_t i = 0u; i < layers->size; i++) {
-		sprites_layer* const layer = layers->layers[i];
-		if (layer == NULL) {
-			continue;
+	if (layers->records_length > 0u) {
+		items_sort(layers);
+	}
+
+	GLint viewport[4] = { 0 };
+	vec2 screen = { layers->screen[0], layers->screen[1] };
+	if (layers->caches_length > 0u || layers->cameras_length > 0u) {
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		if (screen[0] <= 0.0f || screen[1] <= 0.0f) {
+			screen[0] = (float)viewport[2];
+			screen[1] = (float)viewport[3];
 		}
+	}
 
-		for (size_t j = 0u; j < layer->length; j++) {
-			sprites_sequence* const sequence = layer->sequences[j];
-			if (sequence == NULL) {
-				continue;
+	layers->stats_length = 0u;
+	size_t num_layers = 0u;
+	for (size_t start = 0u, end; start < layers->records_length; start = end) {
+		const size_t layer_index = item_layer_get(&layers->items[start]);
+		for (end = start + 1u; end < layers->records_length && item_layer_get(&layers->items[end]) == layer_index; end++);
+
+		if (layers->stats_enabled && num_layers <= LAYERS_STATS_MAX) {
+			if (num_layers < LAYERS_STATS_MAX) {
+				if (!sprites_add_timestamp(layers->sprites, layers->timer, layers->layer_zone_base + layer_index)) {
+					return false;
+				}
+				layers->stats[num_layers].layer_index = layer_index;
+			}
+			else if (!sprites_add_timestamp(layers->sprites, layers->timer, layers->other_zone)) {
+				return false;
 			}
+			num_layers++;
+		}
 
-			if (!sprites_add(layers->sprites, sequence->sheet, sequence->length, sequence->sprites)) {
+		layers_cache* const cache = cache_get(layers, layer_index);
+		const layers_camera* const camera = camera_get(layers, layer_index);
+		if (cache != NULL && viewport[2] > 0 && viewport[3] > 0) {
+			if (!cached_records_add(layers, cache, start, end, screen, viewport, camera)) {
+				cache->valid = false;
 				return false;
 			}
 		}
+		else if (!camera_records_add(layers, start, end, screen, camera)) {
+			return false;
+		}
 	}
 
-	return sprites_draw(layers->sprites);
+	if (!sprites_draw(layers->sprites)) {
+		for (size_t i = 0u; i < layers->caches_length; i++) {
+			layers->caches[i].valid = false;
+		}
+		return false;
+	}
+
+	layers->stats_length = num_layers < LAYERS_STATS_MAX ? num_layers : LAYERS_STATS_MAX;
+	for (size_t i = 0u; i < layers->stats_length; i++) {
+		sprites_timestamp_stats_get(layers->sprites, i, &layers->stats[i].stats);
+	}
+
+	return true;
+}
+
+void layers_stats_set(layers_object* const layers, const bool enabled, gpu_timer_object* const timer, const size_t other_zone, const size_t layer_zone_base) {
+	assert(layers != NULL);
+
+	layers->stats_enabled = enabled;
+	layers->timer = timer;
+	layers->other_zone = other_zone;
+	layers->layer_zone_base = layer_zone_base;
+}
+
+size_t layers_stats_get(layers_object* const layers, sprites_stats_type* const total, layers_stats_type layer_stats[LAYERS_STATS_MAX]) {
+	assert(layers != NULL);
+	assert(total != NULL);
+	assert(layer_stats != NULL);
+
+	sprites_stats_get(layers->sprites, total);
+	memcpy(layer_stats, layers->stats, layers->stats_length * sizeof(layers_stats_type));
+
+	return layers->stats_length;
 }
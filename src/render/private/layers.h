@@ -28,33 +28,156 @@
  */
 
 #include "render/render_types.h"
+#include "render/private/texture_array.h"
+#include "render/private/sprites.h"
+#include "render/private/tilemap.h"
+#include "render/private/particles.h"
 #include "data/data_texture.h"
 #include <stdbool.h>
 #include <stddef.h>
 
 typedef struct layers_object layers_object;
 
-layers_object* layers_create(const size_t num_layers);
+/*
+ * Layers are drawn from least-layer-index-to-greatest, back-to-front, and layer
+ * indices must be less than LAYERS_MAX; there's no cost to using many layers,
+ * or leaving layers unused.
+ */
+#define LAYERS_MAX ((size_t)1u << 16)
+
+/*
+ * The format and texture array are passed on to the layers' sprites object;
+ * see sprites_create.
+ */
+layers_object* layers_create(const sprites_format_type format, texture_array_object* const texture_array);
 void layers_destroy(layers_object* const layers);
 
-#if 0
-bool layers_shrink(layers_object* const layers); // TODO
-bool layers_resize_num_layers(layers_object* const layers, const size_t num_layers); // TODO
-bool layers_shrink_num_layers(layers_object* const layers); // TODO
-bool layers_resize_layer(layers_object* const layers, const size_t layer_index, const size_t num_sprites); // TODO
-bool layers_shrink_layer(layers_object* const layers, const size_t layer_index); // TODO
-#endif
+/*
+ * Change the format of the layers' sprites object. The screen must be set again
+ * after changing the format.
+ */
+bool layers_format_set(layers_object* const layers, const sprites_format_type format);
 
 void layers_restart(layers_object* const layers);
 
 void layers_screen_reset(layers_object* const layers);
 void layers_screen_set(layers_object* const layers, const float width, const float height);
 
+/*
+ * Set whether sprites of a layer are grouped together by sheet, instead of
+ * drawn in submission order. Sheet sorting can reduce the number of draws of
+ * layers mixing many sheets, where the order of overlapping sprites of
+ * different sheets doesn't matter. Layers are drawn in submission order by
+ * default.
+ */
+bool layers_sheet_sorted_set(layers_object* const layers, const size_t layer_index, const bool sheet_sorted);
+
+/*
+ * Set whether a layer is cached, rendered into an offscreen texture the size of
+ * the viewport that's then drawn to the screen. A cached layer is only
+ * rendered again when what's submitted to it changes, or it's invalidated;
+ * otherwise, drawing the layer is just drawing the texture. Caching suits
+ * layers that are expensive to draw but rarely change, such as backgrounds of
+ * many sprites; layers that change every frame just cost a texture's worth of
+ * extra fill. The sprites submitted are compared by content, so sheets changed
+ * without their texture changing, such as reloaded under the same texture,
+ * require invalidating. Layers aren't cached by default.
+ */
+bool layers_cached_set(layers_object* const layers, const size_t layer_index, const bool cached);
+
+/*
+ * Force a cached layer to be rendered again the next time it's drawn. Does
+ * nothing for layers that aren't cached.
+ */
+void layers_invalidate(layers_object* const layers, const size_t layer_index);
+
+/*
+ * Set the camera of a layer, transforming all the layer's sprites on the GPU,
+ * or NULL to draw the layer in screen coordinates, the default. A layer's
+ * camera persists until changed, and changing it only costs a view change when
+ * drawing, so scrolling layers needn't rewrite their sprites.
+ */
+bool layers_camera_set(layers_object* const layers, const size_t layer_index, const camera_type* const camera);
+
+/*
+ * Get the rectangle of a layer's coordinates covering the bounds on screen,
+ * both in the order left, top, right, bottom, for culling the layer's sprites
+ * against; just the bounds for layers without a camera. Rotated cameras get
+ * the bounding rectangle of the rotated bounds.
+ */
+void layers_camera_bounds_get(layers_object* const layers, const size_t layer_index, const vec4 bounds, vec4 layer_bounds);
+
 /*
  * Add sprites to a layer. Sprites added to a layer are drawn in submission
- * order. And layers are drawn from least-layer-index-to-greatest,
- * back-to-front.
+ * order, unless the layer is sheet sorted.
  */
 bool layers_sprites_add(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_added, sprite_type* const added_sprites);
 
+/*
+ * Add sprites to a layer without copying them, the layer only referencing the
+ * caller's memory. The referenced sprites must remain valid and unmodified
+ * until they have been drawn by layers_draw, or the layers are restarted.
+ */
+bool layers_sprites_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const sprite_type* const referenced_sprites);
+
+/*
+ * Same as layers_sprites_reference, but for packed sprites.
+ */
+bool layers_packed_sprites_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const packed_sprite_type* const referenced_sprites);
+
+/*
+ * Same as layers_sprites_reference, but for extended sprites.
+ */
+bool layers_sprites_ex_reference(layers_object* const layers, data_texture_object* const sheet, const size_t layer_index, const size_t num_referenced, const sprite_ex_type* const referenced_sprites);
+
+/*
+ * Add a batch to a layer, drawn in order with the other sprites of the layer.
+ * The batch must remain valid until the layers have been drawn or restarted.
+ */
+bool layers_batch_add(layers_object* const layers, const size_t layer_index, sprites_batch_object* const batch);
+
+/*
+ * Add a tilemap to a layer, drawn in order with the other sprites of the layer,
+ * only the tiles within the bounds, in the layer's coordinates, being drawn.
+ * The tilemap must remain valid until the layers have been drawn or restarted.
+ */
+bool layers_tilemap_add(layers_object* const layers, const size_t layer_index, tilemap_object* const tilemap, const vec4 bounds);
+
+/*
+ * Add an emitter's particles to a layer, drawn in order with the other sprites
+ * of the layer. The emitter must remain valid until the layers have been drawn
+ * or restarted.
+ */
+bool layers_emitter_add(layers_object* const layers, const size_t layer_index, emitter_object* const emitter);
+
+/*
+ * Draw all the sprites added since the last restart. Sprites are sorted by
+ * layer here, so submission is just appending records.
+ */
 bool layers_draw(layers_object* const layers);
+
+/*
+ * Stats are gathered for at most this many layers per draw.
+ */
+#define LAYERS_STATS_MAX ((size_t)64u)
+
+typedef struct layers_stats_type {
+	size_t layer_index;
+	sprites_stats_type stats;
+} layers_stats_type;
+
+/*
+ * Set whether stats are gathered per layer. While enabled, each layer's GPU
+ * time is recorded in zone layer_zone_base + the layer's index of the timer,
+ * if it isn't NULL, and layers beyond the first LAYERS_STATS_MAX drawn are
+ * recorded in other_zone. Sprites of different layers are never drawn together
+ * while enabled. Disabled by default.
+ */
+void layers_stats_set(layers_object* const layers, const bool enabled, gpu_timer_object* const timer, const size_t other_zone, const size_t layer_zone_base);
+
+/*
+ * Get the stats of the last layers_draw, the total of all the layers, and the
+ * stats of up to LAYERS_STATS_MAX of the drawn layers, lowest layer first, if
+ * per layer stats are enabled. Returns the number of layers' stats.
+ */
+size_t layers_stats_get(layers_object* const layers, sprites_stats_type* const total, layers_stats_type layer_stats[LAYERS_STATS_MAX]);
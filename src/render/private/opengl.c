@@ -25,12 +25,15 @@
 #include "render/private/opengl.h"
 #include "main/private/prog_private.h"
 #include "main/main.h"
+#include "util/str.h"
 #include "util/log.h"
 #include "util/mem.h"
 #include "SDL.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <string.h>
+#include <assert.h>
 
 /*
  * Although it might be fine to directly pass SDL_GL_GetProcAddress to
@@ -43,8 +46,303 @@ static void* get_proc_address(const char* name) {
 	return SDL_GL_GetProcAddress(name);
 }
 
+PFNGLBUFFERSTORAGEPROC opengl_glBufferStorage = NULL;
+PFNGLGETPROGRAMBINARYPROC opengl_glGetProgramBinary = NULL;
+PFNGLPROGRAMBINARYPROC opengl_glProgramBinary = NULL;
+PFNGLPROGRAMPARAMETERIPROC opengl_glProgramParameteri = NULL;
+PFNGLDEBUGMESSAGECALLBACKPROC opengl_glDebugMessageCallback = NULL;
+PFNGLDEBUGMESSAGECONTROLPROC opengl_glDebugMessageControl = NULL;
+PFNGLOBJECTLABELPROC opengl_glObjectLabel = NULL;
+PFNGLPUSHDEBUGGROUPPROC opengl_glPushDebugGroup = NULL;
+PFNGLPOPDEBUGGROUPPROC opengl_glPopDebugGroup = NULL;
+PFNGLCREATEBUFFERSPROC opengl_glCreateBuffers = NULL;
+PFNGLNAMEDBUFFERSTORAGEPROC opengl_glNamedBufferStorage = NULL;
+PFNGLNAMEDBUFFERSUBDATAPROC opengl_glNamedBufferSubData = NULL;
+PFNGLMAPNAMEDBUFFERRANGEPROC opengl_glMapNamedBufferRange = NULL;
+PFNGLUNMAPNAMEDBUFFERPROC opengl_glUnmapNamedBuffer = NULL;
+PFNGLCOPYNAMEDBUFFERSUBDATAPROC opengl_glCopyNamedBufferSubData = NULL;
+PFNGLCREATEVERTEXARRAYSPROC opengl_glCreateVertexArrays = NULL;
+PFNGLENABLEVERTEXARRAYATTRIBPROC opengl_glEnableVertexArrayAttrib = NULL;
+PFNGLVERTEXARRAYATTRIBFORMATPROC opengl_glVertexArrayAttribFormat = NULL;
+PFNGLVERTEXARRAYATTRIBIFORMATPROC opengl_glVertexArrayAttribIFormat = NULL;
+PFNGLVERTEXARRAYATTRIBBINDINGPROC opengl_glVertexArrayAttribBinding = NULL;
+PFNGLVERTEXARRAYBINDINGDIVISORPROC opengl_glVertexArrayBindingDivisor = NULL;
+PFNGLVERTEXARRAYVERTEXBUFFERPROC opengl_glVertexArrayVertexBuffer = NULL;
+PFNGLBINDTEXTUREUNITPROC opengl_glBindTextureUnit = NULL;
+PFNGLMULTIDRAWARRAYSINDIRECTPROC opengl_glMultiDrawArraysIndirect = NULL;
+
+static bool extensions_supported[OPENGL_EXTENSION_NUM];
+
+static opengl_backend_type backend = OPENGL_BACKEND_GL33;
+
+/*
+ * A hash of the driver's identifying strings, combined into the keys of
+ * cached program binaries, as binaries are only valid for the driver that
+ * created them.
+ */
+static uint64_t driver_hash;
+
+#define HASH_BASIS UINT64_C(0xCBF29CE484222325)
+
+static uint64_t hash_string(uint64_t hash, const char* const string) {
+	if (string != NULL) {
+		for (const char* c = string; *c != '\0'; c++) {
+			hash = (hash ^ (unsigned char)*c) * UINT64_C(0x100000001B3);
+		}
+	}
+	// The terminator is hashed too, so consecutive strings can't run together.
+	return hash * UINT64_C(0x100000001B3);
+}
+
+static bool version_at_least(const int major, const int minor) {
+	return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+#ifdef OPENGL_DEBUG
+static const char* debug_source_name(const GLenum source) {
+	switch (source) {
+	case GL_DEBUG_SOURCE_API:
+		return "API";
+	case GL_DEBUG_SOURCE_WINDOW_SYSTEM:
+		return "window system";
+	case GL_DEBUG_SOURCE_SHADER_COMPILER:
+		return "shader compiler";
+	case GL_DEBUG_SOURCE_THIRD_PARTY:
+		return "third party";
+	case GL_DEBUG_SOURCE_APPLICATION:
+		return "application";
+	default:
+		return "other";
+	}
+}
+
+static const char* debug_type_name(const GLenum type) {
+	switch (type) {
+	case GL_DEBUG_TYPE_ERROR:
+		return "error";
+	case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR:
+		return "deprecated behavior";
+	case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:
+		return "undefined behavior";
+	case GL_DEBUG_TYPE_PORTABILITY:
+		return "portability";
+	case GL_DEBUG_TYPE_PERFORMANCE:
+		return "performance";
+	default:
+		return "other";
+	}
+}
+
+static const char* debug_severity_name(const GLenum severity) {
+	switch (severity) {
+	case GL_DEBUG_SEVERITY_HIGH:
+		return "high";
+	case GL_DEBUG_SEVERITY_MEDIUM:
+		return "medium";
+	case GL_DEBUG_SEVERITY_LOW:
+		return "low";
+	default:
+		return "notification";
+	}
+}
+
+/*
+ * Debug output isn't synchronous, so the callback can be called in any
+ * thread, including the driver's own threads, which deferred logging
+ * supports.
+ */
+static void APIENTRY debug_message_callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param) {
+	(void)length;
+	(void)user_param;
+
+	log_deferred_printf("OpenGL %s %s message %u, %s severity: %s\n", debug_source_name(source), debug_type_name(type), (unsigned)id, debug_severity_name(severity), message);
+}
+
+static void debug_load() {
+	extensions_supported[OPENGL_EXTENSION_DEBUG] = false;
+	if (!version_at_least(4, 3) && !SDL_GL_ExtensionSupported("GL_KHR_debug")) {
+		log_printf("OpenGL debug output is not supported\n");
+		return;
+	}
+
+	opengl_glDebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC)get_proc_address("glDebugMessageCallback");
+	opengl_glDebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC)get_proc_address("glDebugMessageControl");
+	opengl_glObjectLabel = (PFNGLOBJECTLABELPROC)get_proc_address("glObjectLabel");
+	opengl_glPushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC)get_proc_address("glPushDebugGroup");
+	opengl_glPopDebugGroup = (PFNGLPOPDEBUGGROUPPROC)get_proc_address("glPopDebugGroup");
+	if (
+		opengl_glDebugMessageCallback == NULL ||
+		opengl_glDebugMessageControl == NULL ||
+		opengl_glObjectLabel == NULL ||
+		opengl_glPushDebugGroup == NULL ||
+		opengl_glPopDebugGroup == NULL
+	) {
+		log_printf("OpenGL debug output is not supported\n");
+		return;
+	}
+	extensions_supported[OPENGL_EXTENSION_DEBUG] = true;
+
+	glDebugMessageCallback(debug_message_callback, NULL);
+	// Notifications are too frequent to log, and debug group pushes and pops
+	// are only for external tools.
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+	glEnable(GL_DEBUG_OUTPUT);
+	log_printf("OpenGL debug output is enabled\n");
+}
+
+void opengl_label(const GLenum identifier, const GLuint name, const char* const label) {
+	if (extensions_supported[OPENGL_EXTENSION_DEBUG] && name != 0u) {
+		glObjectLabel(identifier, name, -1, label);
+	}
+}
+
+void opengl_group_push(const char* const name) {
+	if (extensions_supported[OPENGL_EXTENSION_DEBUG]) {
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0u, -1, name);
+	}
+}
+
+void opengl_group_pop() {
+	if (extensions_supported[OPENGL_EXTENSION_DEBUG]) {
+		glPopDebugGroup();
+	}
+}
+#endif
+
+static void extensions_load() {
+	opengl_glBufferStorage = NULL;
+	if (version_at_least(4, 4) || SDL_GL_ExtensionSupported("GL_ARB_buffer_storage")) {
+		opengl_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)get_proc_address("glBufferStorage");
+	}
+	extensions_supported[OPENGL_EXTENSION_BUFFER_STORAGE] = opengl_glBufferStorage != NULL;
+	log_printf("OpenGL buffer storage is %s\n", extensions_supported[OPENGL_EXTENSION_BUFFER_STORAGE] ? "supported" : "not supported");
+
+	extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_S3TC] = SDL_GL_ExtensionSupported("GL_EXT_texture_compression_s3tc");
+	extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_BPTC] = version_at_least(4, 2) || SDL_GL_ExtensionSupported("GL_ARB_texture_compression_bptc");
+	extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_ETC2] = version_at_least(4, 3) || SDL_GL_ExtensionSupported("GL_ARB_ES3_compatibility");
+	extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_ASTC] = SDL_GL_ExtensionSupported("GL_KHR_texture_compression_astc_ldr");
+	log_printf(
+		"OpenGL texture compression support: S3TC %s, BPTC %s, ETC2 %s, ASTC %s\n",
+		extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_S3TC] ? "yes" : "no",
+		extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_BPTC] ? "yes" : "no",
+		extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_ETC2] ? "yes" : "no",
+		extensions_supported[OPENGL_EXTENSION_TEXTURE_COMPRESSION_ASTC] ? "yes" : "no"
+	);
+
+	opengl_glGetProgramBinary = NULL;
+	opengl_glProgramBinary = NULL;
+	opengl_glProgramParameteri = NULL;
+	extensions_supported[OPENGL_EXTENSION_GET_PROGRAM_BINARY] = false;
+	if (version_at_least(4, 1) || SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) {
+		opengl_glGetProgramBinary = (PFNGLGETPROGRAMBINARYPROC)get_proc_address("glGetProgramBinary");
+		opengl_glProgramBinary = (PFNGLPROGRAMBINARYPROC)get_proc_address("glProgramBinary");
+		opengl_glProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC)get_proc_address("glProgramParameteri");
+		GLint num_formats = 0;
+		if (opengl_glGetProgramBinary != NULL && opengl_glProgramBinary != NULL && opengl_glProgramParameteri != NULL) {
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		}
+		extensions_supported[OPENGL_EXTENSION_GET_PROGRAM_BINARY] = num_formats > 0;
+	}
+	extensions_supported[OPENGL_EXTENSION_PARALLEL_SHADER_COMPILE] = SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile");
+	log_printf(
+		"OpenGL program binaries are %s, parallel shader compiles are %s\n",
+		extensions_supported[OPENGL_EXTENSION_GET_PROGRAM_BINARY] ? "supported" : "not supported",
+		extensions_supported[OPENGL_EXTENSION_PARALLEL_SHADER_COMPILE] ? "supported" : "not supported"
+	);
+
+	extensions_supported[OPENGL_EXTENSION_DIRECT_STATE_ACCESS] = false;
+	if (version_at_least(4, 5) || SDL_GL_ExtensionSupported("GL_ARB_direct_state_access")) {
+		opengl_glCreateBuffers = (PFNGLCREATEBUFFERSPROC)get_proc_address("glCreateBuffers");
+		opengl_glNamedBufferStorage = (PFNGLNAMEDBUFFERSTORAGEPROC)get_proc_address("glNamedBufferStorage");
+		opengl_glNamedBufferSubData = (PFNGLNAMEDBUFFERSUBDATAPROC)get_proc_address("glNamedBufferSubData");
+		opengl_glMapNamedBufferRange = (PFNGLMAPNAMEDBUFFERRANGEPROC)get_proc_address("glMapNamedBufferRange");
+		opengl_glUnmapNamedBuffer = (PFNGLUNMAPNAMEDBUFFERPROC)get_proc_address("glUnmapNamedBuffer");
+		opengl_glCopyNamedBufferSubData = (PFNGLCOPYNAMEDBUFFERSUBDATAPROC)get_proc_address("glCopyNamedBufferSubData");
+		opengl_glCreateVertexArrays = (PFNGLCREATEVERTEXARRAYSPROC)get_proc_address("glCreateVertexArrays");
+		opengl_glEnableVertexArrayAttrib = (PFNGLENABLEVERTEXARRAYATTRIBPROC)get_proc_address("glEnableVertexArrayAttrib");
+		opengl_glVertexArrayAttribFormat = (PFNGLVERTEXARRAYATTRIBFORMATPROC)get_proc_address("glVertexArrayAttribFormat");
+		opengl_glVertexArrayAttribIFormat = (PFNGLVERTEXARRAYATTRIBIFORMATPROC)get_proc_address("glVertexArrayAttribIFormat");
+		opengl_glVertexArrayAttribBinding = (PFNGLVERTEXARRAYATTRIBBINDINGPROC)get_proc_address("glVertexArrayAttribBinding");
+		opengl_glVertexArrayBindingDivisor = (PFNGLVERTEXARRAYBINDINGDIVISORPROC)get_proc_address("glVertexArrayBindingDivisor");
+		opengl_glVertexArrayVertexBuffer = (PFNGLVERTEXARRAYVERTEXBUFFERPROC)get_proc_address("glVertexArrayVertexBuffer");
+		opengl_glBindTextureUnit = (PFNGLBINDTEXTUREUNITPROC)get_proc_address("glBindTextureUnit");
+		extensions_supported[OPENGL_EXTENSION_DIRECT_STATE_ACCESS] =
+			opengl_glCreateBuffers != NULL &&
+			opengl_glNamedBufferStorage != NULL &&
+			opengl_glNamedBufferSubData != NULL &&
+			opengl_glMapNamedBufferRange != NULL &&
+			opengl_glUnmapNamedBuffer != NULL &&
+			opengl_glCopyNamedBufferSubData != NULL &&
+			opengl_glCreateVertexArrays != NULL &&
+			opengl_glEnableVertexArrayAttrib != NULL &&
+			opengl_glVertexArrayAttribFormat != NULL &&
+			opengl_glVertexArrayAttribIFormat != NULL &&
+			opengl_glVertexArrayAttribBinding != NULL &&
+			opengl_glVertexArrayBindingDivisor != NULL &&
+			opengl_glVertexArrayVertexBuffer != NULL &&
+			opengl_glBindTextureUnit != NULL;
+	}
+
+	opengl_glMultiDrawArraysIndirect = NULL;
+	if (
+		version_at_least(4, 3) ||
+		(SDL_GL_ExtensionSupported("GL_ARB_multi_draw_indirect") && SDL_GL_ExtensionSupported("GL_ARB_base_instance"))
+	) {
+		opengl_glMultiDrawArraysIndirect = (PFNGLMULTIDRAWARRAYSINDIRECTPROC)get_proc_address("glMultiDrawArraysIndirect");
+	}
+	extensions_supported[OPENGL_EXTENSION_MULTI_DRAW_INDIRECT] = opengl_glMultiDrawArraysIndirect != NULL;
+	log_printf(
+		"OpenGL direct state access is %s, multi-draw indirect is %s\n",
+		extensions_supported[OPENGL_EXTENSION_DIRECT_STATE_ACCESS] ? "supported" : "not supported",
+		extensions_supported[OPENGL_EXTENSION_MULTI_DRAW_INDIRECT] ? "supported" : "not supported"
+	);
+
+#ifdef OPENGL_DEBUG
+	debug_load();
+#else
+	extensions_supported[OPENGL_EXTENSION_DEBUG] = false;
+#endif
+
+	driver_hash = HASH_BASIS;
+	driver_hash = hash_string(driver_hash, (const char*)glGetString(GL_VENDOR));
+	driver_hash = hash_string(driver_hash, (const char*)glGetString(GL_RENDERER));
+	driver_hash = hash_string(driver_hash, (const char*)glGetString(GL_VERSION));
+}
+
 bool opengl_init() {
-	return !!gladLoadGLLoader(get_proc_address);
+	if (!gladLoadGLLoader(get_proc_address)) {
+		return false;
+	}
+
+	extensions_load();
+	return true;
+}
+
+bool opengl_extension_supported(const opengl_extension_type extension) {
+	assert(extension < OPENGL_EXTENSION_NUM);
+
+	return extensions_supported[extension];
+}
+
+void opengl_backend_select() {
+	if (
+		extensions_supported[OPENGL_EXTENSION_BUFFER_STORAGE] &&
+		extensions_supported[OPENGL_EXTENSION_DIRECT_STATE_ACCESS] &&
+		extensions_supported[OPENGL_EXTENSION_MULTI_DRAW_INDIRECT]
+	) {
+		backend = OPENGL_BACKEND_GL45;
+		log_printf("Using the OpenGL 4.5 backend (OpenGL %d.%d)\n", GLVersion.major, GLVersion.minor);
+	}
+	else {
+		backend = OPENGL_BACKEND_GL33;
+		log_printf("Using the OpenGL 3.3 backend (OpenGL %d.%d)\n", GLVersion.major, GLVersion.minor);
+	}
+}
+
+opengl_backend_type opengl_backend_get() {
+	return backend;
 }
 
 opengl_context_object opengl_context_create() {
@@ -154,34 +452,301 @@ GLuint opengl_shader_create(const GLenum type, const GLchar* const src) {
 	}
 }
 
-GLuint opengl_program_create(const GLchar* const vertex_src, const GLchar* const fragment_src) {
-	const GLuint vertex_shader = opengl_shader_create(GL_VERTEX_SHADER, vertex_src);
-	if (vertex_shader == 0u) {
+/*
+ * Cached program binaries are stored in the save path, one file per program,
+ * with a little endian header:
+ *
+ * magic[8], version u32, binary_format u32, key u64, binary_size u32, 0 u32
+ */
+static const char program_cache_magic[8] = { 'D', 'M', 'F', 'P', 'R', 'O', 'G', '\0' };
+#define PROGRAM_CACHE_VERSION 1u
+#define PROGRAM_CACHE_HEADER_SIZE 32u
+
+static uint32_t read_u32(const unsigned char* const bytes) {
+	return
+		(uint32_t)bytes[0] |
+		((uint32_t)bytes[1] << 8) |
+		((uint32_t)bytes[2] << 16) |
+		((uint32_t)bytes[3] << 24);
+}
+
+static void write_u32(unsigned char* const bytes, const uint32_t value) {
+	bytes[0] = (unsigned char)value;
+	bytes[1] = (unsigned char)(value >> 8);
+	bytes[2] = (unsigned char)(value >> 16);
+	bytes[3] = (unsigned char)(value >> 24);
+}
+
+static char* program_cache_filename_get(const uint64_t key) {
+	return alloc_sprintf("%sshader_cache_%08lx%08lx.bin", prog_save_path_get(), (unsigned long)(key >> 32), (unsigned long)(key & 0xFFFFFFFFu));
+}
+
+/*
+ * Load the cached binary of the key into the program. Returns false if there's
+ * no usable cached binary, such as after a driver update.
+ */
+static bool program_cache_load(const GLuint program, const uint64_t key) {
+	char* const filename = program_cache_filename_get(key);
+	if (filename == NULL) {
+		return false;
+	}
+	SDL_RWops* const rwops = SDL_RWFromFile(filename, "rb");
+	mem_free(filename);
+	if (rwops == NULL) {
+		return false;
+	}
+
+	unsigned char header[PROGRAM_CACHE_HEADER_SIZE];
+	if (
+		SDL_RWread(rwops, header, 1u, sizeof(header)) != sizeof(header) ||
+		memcmp(header, program_cache_magic, sizeof(program_cache_magic)) != 0 ||
+		read_u32(header + 8) != PROGRAM_CACHE_VERSION ||
+		read_u32(header + 16) != (uint32_t)key ||
+		read_u32(header + 20) != (uint32_t)(key >> 32) ||
+		read_u32(header + 24) == 0u ||
+		read_u32(header + 24) > INT32_MAX
+	) {
+		SDL_RWclose(rwops);
+		return false;
+	}
+	const GLenum format = (GLenum)read_u32(header + 12);
+	const size_t size = read_u32(header + 24);
+
+	void* const binary = mem_malloc(size);
+	if (binary == NULL) {
+		SDL_RWclose(rwops);
+		return false;
+	}
+	const bool read = SDL_RWread(rwops, binary, 1u, size) == size;
+	SDL_RWclose(rwops);
+	if (!read) {
+		mem_free(binary);
+		return false;
+	}
+
+	glProgramBinary(program, format, binary, (GLsizei)size);
+	mem_free(binary);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	// Rejected binaries generate no error, but clear any error anyway.
+	(void)glGetError();
+	return linked == GL_TRUE;
+}
+
+static void program_cache_save(const GLuint program, const uint64_t key) {
+	GLint size = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+	if (size <= 0) {
+		return;
+	}
+	void* const binary = mem_malloc((size_t)size);
+	if (binary == NULL) {
+		return;
+	}
+	GLsizei length = 0;
+	GLenum format = 0u;
+	glGetProgramBinary(program, size, &length, &format, binary);
+	if (opengl_error("Error getting a program binary to cache: ") || length <= 0) {
+		mem_free(binary);
+		return;
+	}
+
+	unsigned char header[PROGRAM_CACHE_HEADER_SIZE];
+	memcpy(header, program_cache_magic, sizeof(program_cache_magic));
+	write_u32(header + 8, PROGRAM_CACHE_VERSION);
+	write_u32(header + 12, (uint32_t)format);
+	write_u32(header + 16, (uint32_t)key);
+	write_u32(header + 20, (uint32_t)(key >> 32));
+	write_u32(header + 24, (uint32_t)length);
+	write_u32(header + 28, 0u);
+
+	char* const filename = program_cache_filename_get(key);
+	SDL_RWops* const rwops = filename != NULL ? SDL_RWFromFile(filename, "wb") : NULL;
+	if (rwops != NULL) {
+		const bool written =
+			SDL_RWwrite(rwops, header, 1u, sizeof(header)) == sizeof(header) &&
+			SDL_RWwrite(rwops, binary, 1u, (size_t)length) == (size_t)length;
+		if (SDL_RWclose(rwops) < 0 || !written) {
+			// A partially written binary is removed, so it's never loaded.
+			log_printf("Error caching a program binary\n");
+			remove(filename);
+		}
+	}
+	if (filename != NULL) {
+		mem_free(filename);
+	}
+	mem_free(binary);
+}
+
+bool opengl_program_build_start(opengl_program_build* const build, const GLchar* const vertex_src, const GLchar* const fragment_src) {
+	assert(build != NULL);
+	assert(vertex_src != NULL);
+	assert(fragment_src != NULL);
+
+	build->program = 0u;
+	build->vertex_shader = 0u;
+	build->fragment_shader = 0u;
+	build->key = hash_string(hash_string(driver_hash, vertex_src), fragment_src);
+
+	const bool cacheable = opengl_extension_supported(OPENGL_EXTENSION_GET_PROGRAM_BINARY);
+	if (cacheable) {
+		const GLuint program = glCreateProgram();
+		if (program != 0u && program_cache_load(program, build->key)) {
+			build->program = program;
+			return true;
+		}
+		if (program != 0u) {
+			glDeleteProgram(program);
+		}
+	}
+
+	// Compile statuses aren't checked until the build is finished, so the
+	// driver can compile in the background.
+	build->vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+	build->fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+	build->program = glCreateProgram();
+	if (build->vertex_shader == 0u || build->fragment_shader == 0u || build->program == 0u) {
+		log_printf("Error creating OpenGL program object.\n");
+		opengl_program_build_cancel(build);
+		return false;
+	}
+	glShaderSource(build->vertex_shader, 1, &vertex_src, NULL);
+	glCompileShader(build->vertex_shader);
+	glShaderSource(build->fragment_shader, 1, &fragment_src, NULL);
+	glCompileShader(build->fragment_shader);
+
+	glAttachShader(build->program, build->vertex_shader);
+	glAttachShader(build->program, build->fragment_shader);
+	if (cacheable) {
+		glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	glLinkProgram(build->program);
+
+	return true;
+}
+
+bool opengl_program_build_done(const opengl_program_build* const build) {
+	assert(build != NULL);
+
+	if (build->vertex_shader == 0u) {
+		return true;
+	}
+	else if (!opengl_extension_supported(OPENGL_EXTENSION_PARALLEL_SHADER_COMPILE)) {
+		return false;
+	}
+	GLint done = GL_TRUE;
+	glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+static bool shader_compiled(const GLuint shader, const char* const type) {
+	GLint compiled;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled) {
+		return true;
+	}
+
+	GLint info_log_length;
+	GLchar* info_log;
+	glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &info_log_length);
+	info_log = mem_malloc(info_log_length);
+	glGetShaderInfoLog(shader, info_log_length, NULL, info_log);
+	log_printf("Error compiling %s shader. OpenGL shader info log:\n%s\n", type, info_log);
+	mem_free(info_log);
+	return false;
+}
+
+GLuint opengl_program_build_finish(opengl_program_build* const build) {
+	assert(build != NULL);
+	assert(build->program != 0u);
+
+	// Loaded from the cache.
+	if (build->vertex_shader == 0u) {
+		const GLuint program = build->program;
+		build->program = 0u;
+		return program;
+	}
+
+	if (!shader_compiled(build->vertex_shader, "vertex") || !shader_compiled(build->fragment_shader, "fragment")) {
+		opengl_program_build_cancel(build);
 		return 0u;
 	}
-	const GLuint fragment_shader = opengl_shader_create(GL_FRAGMENT_SHADER, fragment_src);
-	if (fragment_shader == 0u) {
+
+	const GLuint program = build->program;
+	glDetachShader(program, build->vertex_shader);
+	glDetachShader(program, build->fragment_shader);
+	glDeleteShader(build->vertex_shader);
+	glDeleteShader(build->fragment_shader);
+	build->vertex_shader = 0u;
+	build->fragment_shader = 0u;
+	build->program = 0u;
+
+	GLint linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked) {
+		if (opengl_extension_supported(OPENGL_EXTENSION_GET_PROGRAM_BINARY)) {
+			program_cache_save(program, build->key);
+		}
+		return program;
+	}
+	else {
+		GLint info_log_length;
+		GLchar* info_log;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
+		info_log = mem_malloc(info_log_length);
+		glGetProgramInfoLog(program, info_log_length, NULL, info_log);
+		log_printf("Error linking shading program. OpenGL program info log:\n%s\n", info_log);
+		mem_free(info_log);
+		glDeleteProgram(program);
+		return 0u;
+	}
+}
+
+void opengl_program_build_cancel(opengl_program_build* const build) {
+	assert(build != NULL);
+
+	if (build->vertex_shader != 0u) {
+		glDeleteShader(build->vertex_shader);
+	}
+	if (build->fragment_shader != 0u) {
+		glDeleteShader(build->fragment_shader);
+	}
+	if (build->program != 0u) {
+		glDeleteProgram(build->program);
+	}
+	build->program = 0u;
+	build->vertex_shader = 0u;
+	build->fragment_shader = 0u;
+}
+
+GLuint opengl_program_create(const GLchar* const vertex_src, const GLchar* const fragment_src) {
+	opengl_program_build build;
+	if (!opengl_program_build_start(&build, vertex_src, fragment_src)) {
 		return 0u;
 	}
+	return opengl_program_build_finish(&build);
+}
 
+GLuint opengl_feedback_program_create(const GLchar* const vertex_src, const GLsizei num_varyings, const GLchar* const* const varyings) {
+	assert(vertex_src != NULL);
+	assert(num_varyings > 0);
+	assert(varyings != NULL);
+
+	const GLuint shader = opengl_shader_create(GL_VERTEX_SHADER, vertex_src);
+	if (shader == 0u) {
+		return 0u;
+	}
 	const GLuint program = glCreateProgram();
 	if (program == 0u) {
 		log_printf("Error creating OpenGL program object.\n");
-		glDeleteShader(vertex_shader);
-		glDeleteShader(fragment_shader);
+		glDeleteShader(shader);
 		return 0u;
 	}
-
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-
+	glAttachShader(program, shader);
+	glTransformFeedbackVaryings(program, num_varyings, varyings, GL_INTERLEAVED_ATTRIBS);
 	glLinkProgram(program);
-
-	glDetachShader(program, vertex_shader);
-	glDetachShader(program, fragment_shader);
-
-	glDeleteShader(vertex_shader);
-	glDeleteShader(fragment_shader);
+	glDetachShader(program, shader);
+	glDeleteShader(shader);
 
 	GLint linked;
 	glGetProgramiv(program, GL_LINK_STATUS, &linked);
@@ -194,13 +759,14 @@ GLuint opengl_program_create(const GLchar* const vertex_src, const GLchar* const
 		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &info_log_length);
 		info_log = mem_malloc(info_log_length);
 		glGetProgramInfoLog(program, info_log_length, NULL, info_log);
-		log_printf("Error linking shading program. OpenGL program info log:\n%s\n", info_log);
+		log_printf("Error linking transform feedback program. OpenGL program info log:\n%s\n", info_log);
 		mem_free(info_log);
 		glDeleteProgram(program);
 		return 0u;
 	}
 }
 
+#ifndef OPENGL_NO_ERROR_CHECKS
 bool opengl_error(const char* const format, ...) {
 	GLenum error = glGetError();
 	if (error != GL_NO_ERROR) {
@@ -242,3 +808,4 @@ bool opengl_error(const char* const format, ...) {
 		return false;
 	}
 }
+#endif
@@ -25,10 +25,211 @@
 
 #include "SDL_video.h"
 #include "render/private/glad.h"
+#include <stdint.h>
 #include <stdbool.h>
 
 typedef SDL_GLContext opengl_context_object;
 
+/*
+ * OpenGL functionality newer than OpenGL 3.3 Core, that's only available on
+ * some platforms. opengl_init loads the functions of each extension the
+ * platform supports, so always check opengl_extension_supported before using
+ * the functions or enums of an extension.
+ */
+typedef enum opengl_extension_type {
+	/*
+	 * ARB_buffer_storage, core since OpenGL 4.4. Provides glBufferStorage,
+	 * for immutable buffer storage that can be persistently mapped.
+	 */
+	OPENGL_EXTENSION_BUFFER_STORAGE,
+
+	/*
+	 * Block compressed texture formats. Only the formats' enums are used, with
+	 * glCompressedTexImage2D. S3TC is EXT_texture_compression_s3tc, for BC1-3;
+	 * BPTC is ARB_texture_compression_bptc, core since OpenGL 4.2, for BC7;
+	 * ETC2 is ARB_ES3_compatibility, core since OpenGL 4.3; ASTC is
+	 * KHR_texture_compression_astc_ldr.
+	 */
+	OPENGL_EXTENSION_TEXTURE_COMPRESSION_S3TC,
+	OPENGL_EXTENSION_TEXTURE_COMPRESSION_BPTC,
+	OPENGL_EXTENSION_TEXTURE_COMPRESSION_ETC2,
+	OPENGL_EXTENSION_TEXTURE_COMPRESSION_ASTC,
+
+	/*
+	 * ARB_get_program_binary, core since OpenGL 4.1. Provides
+	 * glGetProgramBinary and glProgramBinary, for caching linked programs.
+	 * Only reported as supported if the platform has at least one program
+	 * binary format.
+	 */
+	OPENGL_EXTENSION_GET_PROGRAM_BINARY,
+
+	/*
+	 * KHR_parallel_shader_compile. Only the GL_COMPLETION_STATUS_KHR enum is
+	 * used, to poll for compiles and links completing without blocking.
+	 */
+	OPENGL_EXTENSION_PARALLEL_SHADER_COMPILE,
+
+	/*
+	 * KHR_debug, core since OpenGL 4.3. Provides the debug message callback,
+	 * object labels and debug groups. Only loaded in OPENGL_DEBUG builds.
+	 */
+	OPENGL_EXTENSION_DEBUG,
+
+	/*
+	 * ARB_direct_state_access, core since OpenGL 4.5. Provides editing objects
+	 * by name, without binding them, and vertex array attribute formats
+	 * separate from the buffers they're read from.
+	 */
+	OPENGL_EXTENSION_DIRECT_STATE_ACCESS,
+
+	/*
+	 * ARB_multi_draw_indirect, core since OpenGL 4.3, along with the base
+	 * instances of ARB_base_instance, core since OpenGL 4.2. Provides
+	 * glMultiDrawArraysIndirect, for many draws sourced from a buffer of
+	 * commands in one call.
+	 */
+	OPENGL_EXTENSION_MULTI_DRAW_INDIRECT,
+
+	OPENGL_EXTENSION_NUM
+} opengl_extension_type;
+
+/*
+ * The rendering backends, selected by opengl_backend_select by what the
+ * context supports. The OpenGL 4.5 backend edits objects with direct state
+ * access, uses immutable buffer storage, and batches draws with multi-draw
+ * indirect; the OpenGL 3.3 backend binds objects to edit them, and is used
+ * wherever the OpenGL 4.5 backend isn't supported.
+ */
+typedef enum opengl_backend_type {
+	OPENGL_BACKEND_GL33,
+	OPENGL_BACKEND_GL45,
+	OPENGL_BACKEND_NUM
+} opengl_backend_type;
+
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#define GL_BUFFER_IMMUTABLE_STORAGE 0x821F
+#define GL_BUFFER_STORAGE_FLAGS 0x8220
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+extern PFNGLBUFFERSTORAGEPROC opengl_glBufferStorage;
+#define glBufferStorage opengl_glBufferStorage
+
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+extern PFNGLGETPROGRAMBINARYPROC opengl_glGetProgramBinary;
+extern PFNGLPROGRAMBINARYPROC opengl_glProgramBinary;
+extern PFNGLPROGRAMPARAMETERIPROC opengl_glProgramParameteri;
+#define glGetProgramBinary opengl_glGetProgramBinary
+#define glProgramBinary opengl_glProgramBinary
+#define glProgramParameteri opengl_glProgramParameteri
+
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+
+#define GL_DEBUG_OUTPUT 0x92E0
+#define GL_DEBUG_SOURCE_API 0x8246
+#define GL_DEBUG_SOURCE_WINDOW_SYSTEM 0x8247
+#define GL_DEBUG_SOURCE_SHADER_COMPILER 0x8248
+#define GL_DEBUG_SOURCE_THIRD_PARTY 0x8249
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#define GL_DEBUG_TYPE_ERROR 0x824C
+#define GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR 0x824D
+#define GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR 0x824E
+#define GL_DEBUG_TYPE_PORTABILITY 0x824F
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#define GL_DEBUG_TYPE_PUSH_GROUP 0x8269
+#define GL_DEBUG_TYPE_POP_GROUP 0x826A
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_BUFFER 0x82E0
+#define GL_SHADER 0x82E1
+#define GL_PROGRAM 0x82E2
+#define GL_VERTEX_ARRAY 0x8074
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECALLBACKPROC)(GLDEBUGPROC callback, const void* userParam);
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECONTROLPROC)(GLenum source, GLenum type, GLenum severity, GLsizei count, const GLuint* ids, GLboolean enabled);
+typedef void (APIENTRYP PFNGLOBJECTLABELPROC)(GLenum identifier, GLuint name, GLsizei length, const GLchar* label);
+typedef void (APIENTRYP PFNGLPUSHDEBUGGROUPPROC)(GLenum source, GLuint id, GLsizei length, const GLchar* message);
+typedef void (APIENTRYP PFNGLPOPDEBUGGROUPPROC)(void);
+extern PFNGLDEBUGMESSAGECALLBACKPROC opengl_glDebugMessageCallback;
+extern PFNGLDEBUGMESSAGECONTROLPROC opengl_glDebugMessageControl;
+extern PFNGLOBJECTLABELPROC opengl_glObjectLabel;
+extern PFNGLPUSHDEBUGGROUPPROC opengl_glPushDebugGroup;
+extern PFNGLPOPDEBUGGROUPPROC opengl_glPopDebugGroup;
+#define glDebugMessageCallback opengl_glDebugMessageCallback
+#define glDebugMessageControl opengl_glDebugMessageControl
+#define glObjectLabel opengl_glObjectLabel
+#define glPushDebugGroup opengl_glPushDebugGroup
+#define glPopDebugGroup opengl_glPopDebugGroup
+
+typedef void (APIENTRYP PFNGLCREATEBUFFERSPROC)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRYP PFNGLNAMEDBUFFERSTORAGEPROC)(GLuint buffer, GLsizeiptr size, const void* data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLNAMEDBUFFERSUBDATAPROC)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data);
+typedef void* (APIENTRYP PFNGLMAPNAMEDBUFFERRANGEPROC)(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRYP PFNGLUNMAPNAMEDBUFFERPROC)(GLuint buffer);
+typedef void (APIENTRYP PFNGLCOPYNAMEDBUFFERSUBDATAPROC)(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size);
+typedef void (APIENTRYP PFNGLCREATEVERTEXARRAYSPROC)(GLsizei n, GLuint* arrays);
+typedef void (APIENTRYP PFNGLENABLEVERTEXARRAYATTRIBPROC)(GLuint vaobj, GLuint index);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBFORMATPROC)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLboolean normalized, GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBIFORMATPROC)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type, GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBBINDINGPROC)(GLuint vaobj, GLuint attribindex, GLuint bindingindex);
+typedef void (APIENTRYP PFNGLVERTEXARRAYBINDINGDIVISORPROC)(GLuint vaobj, GLuint bindingindex, GLuint divisor);
+typedef void (APIENTRYP PFNGLVERTEXARRAYVERTEXBUFFERPROC)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset, GLsizei stride);
+typedef void (APIENTRYP PFNGLBINDTEXTUREUNITPROC)(GLuint unit, GLuint texture);
+extern PFNGLCREATEBUFFERSPROC opengl_glCreateBuffers;
+extern PFNGLNAMEDBUFFERSTORAGEPROC opengl_glNamedBufferStorage;
+extern PFNGLNAMEDBUFFERSUBDATAPROC opengl_glNamedBufferSubData;
+extern PFNGLMAPNAMEDBUFFERRANGEPROC opengl_glMapNamedBufferRange;
+extern PFNGLUNMAPNAMEDBUFFERPROC opengl_glUnmapNamedBuffer;
+extern PFNGLCOPYNAMEDBUFFERSUBDATAPROC opengl_glCopyNamedBufferSubData;
+extern PFNGLCREATEVERTEXARRAYSPROC opengl_glCreateVertexArrays;
+extern PFNGLENABLEVERTEXARRAYATTRIBPROC opengl_glEnableVertexArrayAttrib;
+extern PFNGLVERTEXARRAYATTRIBFORMATPROC opengl_glVertexArrayAttribFormat;
+extern PFNGLVERTEXARRAYATTRIBIFORMATPROC opengl_glVertexArrayAttribIFormat;
+extern PFNGLVERTEXARRAYATTRIBBINDINGPROC opengl_glVertexArrayAttribBinding;
+extern PFNGLVERTEXARRAYBINDINGDIVISORPROC opengl_glVertexArrayBindingDivisor;
+extern PFNGLVERTEXARRAYVERTEXBUFFERPROC opengl_glVertexArrayVertexBuffer;
+extern PFNGLBINDTEXTUREUNITPROC opengl_glBindTextureUnit;
+#define glCreateBuffers opengl_glCreateBuffers
+#define glNamedBufferStorage opengl_glNamedBufferStorage
+#define glNamedBufferSubData opengl_glNamedBufferSubData
+#define glMapNamedBufferRange opengl_glMapNamedBufferRange
+#define glUnmapNamedBuffer opengl_glUnmapNamedBuffer
+#define glCopyNamedBufferSubData opengl_glCopyNamedBufferSubData
+#define glCreateVertexArrays opengl_glCreateVertexArrays
+#define glEnableVertexArrayAttrib opengl_glEnableVertexArrayAttrib
+#define glVertexArrayAttribFormat opengl_glVertexArrayAttribFormat
+#define glVertexArrayAttribIFormat opengl_glVertexArrayAttribIFormat
+#define glVertexArrayAttribBinding opengl_glVertexArrayAttribBinding
+#define glVertexArrayBindingDivisor opengl_glVertexArrayBindingDivisor
+#define glVertexArrayVertexBuffer opengl_glVertexArrayVertexBuffer
+#define glBindTextureUnit opengl_glBindTextureUnit
+
+/*
+ * The commands in GL_DRAW_INDIRECT_BUFFER read by glMultiDrawArraysIndirect.
+ */
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+typedef struct opengl_draw_arrays_command {
+	GLuint count;
+	GLuint instance_count;
+	GLuint first;
+	GLuint base_instance;
+} opengl_draw_arrays_command;
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTPROC)(GLenum mode, const void* indirect, GLsizei drawcount, GLsizei stride);
+extern PFNGLMULTIDRAWARRAYSINDIRECTPROC opengl_glMultiDrawArraysIndirect;
+#define glMultiDrawArraysIndirect opengl_glMultiDrawArraysIndirect
+
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_RGBA8_ETC2_EAC 0x9278
+#define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+
 /*
  * Does necessary preparation before OpenGL can be used. Must be called before
  * any OpenGL functions (opengl_*, gl*) are called. Returns true if loading was
@@ -36,6 +237,24 @@ typedef SDL_GLContext opengl_context_object;
  */
 bool opengl_init();
 
+/*
+ * Returns true if the extension was found and loaded by opengl_init.
+ */
+bool opengl_extension_supported(const opengl_extension_type extension);
+
+/*
+ * Select the backend to render with, the OpenGL 4.5 backend where the context
+ * supports all it uses, otherwise the OpenGL 3.3 backend. Must be called in the
+ * render thread before any objects that depend on the backend are created.
+ */
+void opengl_backend_select();
+
+/*
+ * Returns the backend selected by opengl_backend_select, the OpenGL 3.3 backend
+ * if none was selected.
+ */
+opengl_backend_type opengl_backend_get();
+
 /*
  * Create an OpenGL context for the current application window. Must only be
  * called in the main thread.
@@ -62,15 +281,93 @@ GLuint opengl_shader_create(const GLenum type, const GLchar* const src);
 
 /*
  * Create an OpenGL shading program object with only vertex and fragment
- * shaders. Returns 0 if creation failed.
+ * shaders. Returns 0 if creation failed. Same as starting a build and
+ * immediately finishing it.
  */
 GLuint opengl_program_create(const GLchar* const vertex_src, const GLchar* const fragment_src);
 
+/*
+ * Create a program of only a vertex shader, whose outputs named by varyings
+ * are captured interleaved by transform feedback, for drawing with
+ * GL_RASTERIZER_DISCARD enabled. Such programs aren't cached. Returns 0 if
+ * creation failed.
+ */
+GLuint opengl_feedback_program_create(const GLchar* const vertex_src, const GLsizei num_varyings, const GLchar* const* const varyings);
+
+/*
+ * Programs are built in two steps, so that builds can proceed in the
+ * background while other work is done, when the driver compiles in parallel.
+ * Linked programs are cached in the save path as program binaries, where
+ * supported, keyed by a hash of the sources and the driver's GL_VENDOR,
+ * GL_RENDERER and GL_VERSION strings; later builds of the same sources load the
+ * cached binaries instead of compiling, falling back to compiling if a cached
+ * binary is rejected. The fields are private.
+ */
+typedef struct opengl_program_build {
+	GLuint program;
+	GLuint vertex_shader;
+	GLuint fragment_shader;
+	uint64_t key;
+} opengl_program_build;
+
+/*
+ * Start building a program, loading it from the cache, or starting its
+ * compile and link. Returns false if the build couldn't be started.
+ */
+bool opengl_program_build_start(opengl_program_build* const build, const GLchar* const vertex_src, const GLchar* const fragment_src);
+
+/*
+ * Returns true if the build is known to be done, so finishing it won't block.
+ * Without KHR_parallel_shader_compile, only builds loaded from the cache are
+ * known to be done.
+ */
+bool opengl_program_build_done(const opengl_program_build* const build);
+
+/*
+ * Finish building the program, waiting for it to link, and caching it if it
+ * was compiled. Returns the program, or 0 if the build failed.
+ */
+GLuint opengl_program_build_finish(opengl_program_build* const build);
+
+/*
+ * Abandon a started build, deleting its objects.
+ */
+void opengl_program_build_cancel(opengl_program_build* const build);
+
 /*
  * Indicates if a previous OpenGL API call generated an error. This function
  * will log the particular OpenGL error, along with the provided error message
  * if the format pointer isn't NULL, and returns true; otherwise, if there's no
  * error at the point this function is called, nothing is logged, and false is
  * returned.
+ *
+ * Each check is a glGetError round trip, which stalls some drivers, so builds
+ * with OPENGL_NO_ERROR_CHECKS compile the checks out, always indicating no
+ * error. In those builds, errors are only reported by OPENGL_DEBUG's message
+ * callback.
  */
+#ifdef OPENGL_NO_ERROR_CHECKS
+static inline bool opengl_no_error() {
+	return false;
+}
+#define opengl_error(...) opengl_no_error()
+#else
 bool opengl_error(const char* const format, ...);
+#endif
+
+/*
+ * Instrumentation for GPU debuggers and profilers, using KHR_debug. In
+ * OPENGL_DEBUG builds, a debug context is requested, and the driver's debug
+ * messages are logged asynchronously, through deferred logging; objects can
+ * be labeled, and commands grouped into named passes. In other builds, these
+ * compile to nothing. Labels and group names are copied by the driver.
+ */
+#ifdef OPENGL_DEBUG
+void opengl_label(const GLenum identifier, const GLuint name, const char* const label);
+void opengl_group_push(const char* const name);
+void opengl_group_pop();
+#else
+#define opengl_label(identifier, name, label) ((void)0)
+#define opengl_group_push(name) ((void)0)
+#define opengl_group_pop() ((void)0)
+#endif
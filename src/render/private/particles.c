@@ -0,0 +1,425 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/particles.h"
+#include "render/private/opengl.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include <math.h>
+#include <assert.h>
+
+#define POSITION_LOCATION 0
+#define VELOCITY_LOCATION 1
+#define LIFE_LOCATION 2
+
+#define GLSL_STRINGIFY(x) #x
+#define GLSL_VALUE(x) GLSL_STRINGIFY(x)
+#define GLSL_LOCATION(location) "layout(location = " GLSL_VALUE(location) ") "
+
+/*
+ * A particle, as stored in the emitters' buffers. life is the particle's age
+ * and lifetime in ticks, particles being dead once their age reaches their
+ * lifetime, so zeroed particles are dead.
+ */
+typedef struct particle_type {
+	vec2 position;
+	vec2 velocity;
+	vec2 life;
+} particle_type;
+
+/*
+ * Each step, the particles of the ring of slots from spawn_start up to
+ * spawn_start + spawn_count are respawned, and all others are integrated a
+ * tick. The randoms of spawned particles are hashed from their slot, the step,
+ * and which random of the particle it is.
+ */
+static const char* const step_src = "\
+#version 330\n\
+" GLSL_LOCATION(POSITION_LOCATION) "in vec2 position;\
+" GLSL_LOCATION(VELOCITY_LOCATION) "in vec2 velocity;\
+" GLSL_LOCATION(LIFE_LOCATION) "in vec2 life;\
+out vec2 out_position;\
+out vec2 out_velocity;\
+out vec2 out_life;\
+uniform uint spawn_start;\
+uniform uint spawn_count;\
+uniform uint capacity;\
+uniform uint seed;\
+uniform vec2 origin;\
+uniform vec2 direction;\
+uniform vec2 speed;\
+uniform vec2 lifetime;\
+uniform vec2 acceleration;\
+float random(uint slot, uint which) {\
+	uint n = slot * 0x9E3779B9u ^ (seed * 3u + which) * 0x85EBCA6Bu;\
+	n = (n ^ 61u) ^ (n >> 16u);\
+	n *= 9u;\
+	n ^= n >> 4u;\
+	n *= 0x27D4EB2Du;\
+	n ^= n >> 15u;\
+	return float(n) * (1.0 / 4294967295.0);\
+}\
+void main() {\
+	uint slot = uint(gl_VertexID);\
+	if ((slot + capacity - spawn_start) % capacity < spawn_count) {\
+		float angle = direction.x + (random(slot, 0u) * 2.0 - 1.0) * direction.y;\
+		out_position = origin;\
+		out_velocity = vec2(cos(angle), sin(angle)) * mix(speed.x, speed.y, random(slot, 1u));\
+		out_life = vec2(0.0, mix(lifetime.x, lifetime.y, random(slot, 2u)));\
+	}\
+	else {\
+		out_velocity = velocity + acceleration;\
+		out_position = position + out_velocity;\
+		out_life = vec2(life.x + 1.0, life.y);\
+	}\
+}\
+";
+
+static const GLchar* const step_varyings[] = {
+	"out_position",
+	"out_velocity",
+	"out_life"
+};
+
+/*
+ * Each instance is a particle, dead particles being collapsed onto a point
+ * outside of clip space, so they produce no fragments.
+ */
+static const char* const vertex_src = "\
+#version 330\n\
+" GLSL_LOCATION(POSITION_LOCATION) "in vec2 position;\
+" GLSL_LOCATION(LIFE_LOCATION) "in vec2 life;\
+out vec2 f_position;\
+out vec4 f_tint;\
+uniform mat4 view;\
+uniform vec4 src;\
+uniform vec2 sheet_dimensions;\
+uniform vec2 size;\
+uniform vec4 tint_start;\
+uniform vec4 tint_end;\
+const vec2 vertices[6] = vec2[] (\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 0.0),\
+	vec2(0.0, 0.0),\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 1.0),\
+	vec2(1.0, 0.0)\
+);\
+void main() {\
+	if (life.x >= life.y) {\
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\
+		f_position = vec2(0.0);\
+		f_tint = vec4(0.0);\
+		return;\
+	}\
+	float t = life.x / life.y;\
+	float width = mix(size.x, size.y, t);\
+	vec2 vertex = vertices[gl_VertexID % 6];\
+	gl_Position = view * vec4(position + (vertex - 0.5) * vec2(width, width * src.w / src.z), 0.0, 1.0);\
+	f_position = (src.xy + vertex * src.zw) * sheet_dimensions;\
+	f_tint = mix(tint_start, tint_end, t);\
+}\
+";
+
+static const char* const fragment_src = "\
+#version 330\n\
+in vec2 f_position;\
+in vec4 f_tint;\
+out vec4 out_color;\
+uniform sampler2D sheet;\
+void main() {\
+	out_color = texture(sheet, f_position) * f_tint;\
+}\
+";
+
+struct particles_object {
+	GLuint step_program;
+	GLint spawn_start_location;
+	GLint spawn_count_location;
+	GLint capacity_location;
+	GLint seed_location;
+	GLint origin_location;
+	GLint direction_location;
+	GLint speed_location;
+	GLint lifetime_location;
+	GLint acceleration_location;
+
+	GLuint program;
+	GLint view_location;
+	GLint src_location;
+	GLint sheet_dimensions_location;
+	GLint size_location;
+	GLint tint_start_location;
+	GLint tint_end_location;
+};
+
+/*
+ * The particles are in buffers[current], stepped into the other buffer. Each
+ * buffer has a vertex array for stepping, with a vertex per particle, and one
+ * for drawing, with an instance per particle.
+ */
+struct emitter_object {
+	particles_object* particles;
+	data_texture_object* sheet;
+	size_t capacity;
+	GLuint buffers[2];
+	GLuint step_arrays[2];
+	GLuint draw_arrays[2];
+	size_t current;
+
+	emitter_type params;
+	float spawn_remainder;
+	size_t spawn_next;
+	uint32_t steps;
+
+	uint64_t version;
+};
+
+/*
+ * Emitter versions are taken from one counter, so they're unique across all
+ * emitters, even emitters created where a destroyed emitter was.
+ */
+static uint64_t next_emitter_version = 0u;
+
+particles_object* particles_create() {
+	particles_object* const particles = mem_calloc(1u, sizeof(particles_object));
+	if (particles == NULL) {
+		return NULL;
+	}
+
+	particles->step_program = opengl_feedback_program_create(step_src, (GLsizei)(sizeof(step_varyings) / sizeof(*step_varyings)), step_varyings);
+	particles->program = opengl_program_create(vertex_src, fragment_src);
+	if (particles->step_program == 0u || particles->program == 0u) {
+		log_printf("Error creating the particle programs\n");
+		particles_destroy(particles);
+		return NULL;
+	}
+
+	opengl_label(GL_PROGRAM, particles->step_program, "particle step program");
+	particles->spawn_start_location = glGetUniformLocation(particles->step_program, "spawn_start");
+	particles->spawn_count_location = glGetUniformLocation(particles->step_program, "spawn_count");
+	particles->capacity_location = glGetUniformLocation(particles->step_program, "capacity");
+	particles->seed_location = glGetUniformLocation(particles->step_program, "seed");
+	particles->origin_location = glGetUniformLocation(particles->step_program, "origin");
+	particles->direction_location = glGetUniformLocation(particles->step_program, "direction");
+	particles->speed_location = glGetUniformLocation(particles->step_program, "speed");
+	particles->lifetime_location = glGetUniformLocation(particles->step_program, "lifetime");
+	particles->acceleration_location = glGetUniformLocation(particles->step_program, "acceleration");
+
+	glUseProgram(particles->program);
+	opengl_label(GL_PROGRAM, particles->program, "particle program");
+	glUniform1i(glGetUniformLocation(particles->program, "sheet"), 0);
+	particles->view_location = glGetUniformLocation(particles->program, "view");
+	particles->src_location = glGetUniformLocation(particles->program, "src");
+	particles->sheet_dimensions_location = glGetUniformLocation(particles->program, "sheet_dimensions");
+	particles->size_location = glGetUniformLocation(particles->program, "size");
+	particles->tint_start_location = glGetUniformLocation(particles->program, "tint_start");
+	particles->tint_end_location = glGetUniformLocation(particles->program, "tint_end");
+
+	return particles;
+}
+
+void particles_destroy(particles_object* const particles) {
+	assert(particles != NULL);
+
+	if (particles->step_program != 0u) {
+		glDeleteProgram(particles->step_program);
+	}
+	if (particles->program != 0u) {
+		glDeleteProgram(particles->program);
+	}
+	mem_free(particles);
+}
+
+static void attrib_point(const GLuint location, const size_t offset, const GLuint divisor) {
+	glEnableVertexAttribArray(location);
+	glVertexAttribPointer(location, 2, GL_FLOAT, GL_FALSE, sizeof(particle_type), (const void*)offset);
+	glVertexAttribDivisor(location, divisor);
+}
+
+emitter_object* emitter_create(particles_object* const particles, data_texture_object* const sheet, const size_t capacity) {
+	assert(particles != NULL);
+	assert(sheet != NULL);
+	assert(capacity > 0u);
+
+	if (capacity > (size_t)INT32_MAX / sizeof(particle_type)) {
+		log_printf("Error: An emitter capacity of %zu particles is unsupported\n", capacity);
+		return NULL;
+	}
+
+	emitter_object* const emitter = mem_calloc(1u, sizeof(emitter_object));
+	if (emitter == NULL) {
+		return NULL;
+	}
+	emitter->particles = particles;
+	emitter->sheet = sheet;
+	emitter->capacity = capacity;
+	emitter->version = next_emitter_version++;
+
+	particle_type* const dead = mem_calloc(capacity, sizeof(particle_type));
+	if (dead == NULL) {
+		mem_free(emitter);
+		return NULL;
+	}
+
+	glGenBuffers(2, emitter->buffers);
+	glGenVertexArrays(2, emitter->step_arrays);
+	glGenVertexArrays(2, emitter->draw_arrays);
+	if (opengl_error("Error from creating buffers in emitter_create: ")) {
+		mem_free(dead);
+		emitter_destroy(emitter);
+		return NULL;
+	}
+	for (size_t i = 0u; i < 2u; i++) {
+		glBindBuffer(GL_ARRAY_BUFFER, emitter->buffers[i]);
+		opengl_label(GL_BUFFER, emitter->buffers[i], "emitter particles");
+		glBufferData(GL_ARRAY_BUFFER, sizeof(particle_type) * capacity, dead, GL_STREAM_COPY);
+
+		glBindVertexArray(emitter->step_arrays[i]);
+		attrib_point(POSITION_LOCATION, offsetof(particle_type, position), 0u);
+		attrib_point(VELOCITY_LOCATION, offsetof(particle_type, velocity), 0u);
+		attrib_point(LIFE_LOCATION, offsetof(particle_type, life), 0u);
+
+		glBindVertexArray(emitter->draw_arrays[i]);
+		attrib_point(POSITION_LOCATION, offsetof(particle_type, position), 1u);
+		attrib_point(LIFE_LOCATION, offsetof(particle_type, life), 1u);
+	}
+	glBindVertexArray(0u);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+	mem_free(dead);
+	if (opengl_error("Error from initializing buffers in emitter_create: ")) {
+		emitter_destroy(emitter);
+		return NULL;
+	}
+
+	return emitter;
+}
+
+void emitter_destroy(emitter_object* const emitter) {
+	assert(emitter != NULL);
+
+	glDeleteVertexArrays(2, emitter->draw_arrays);
+	glDeleteVertexArrays(2, emitter->step_arrays);
+	glDeleteBuffers(2, emitter->buffers);
+	mem_free(emitter);
+}
+
+data_texture_object* emitter_sheet_get(emitter_object* const emitter) {
+	assert(emitter != NULL);
+
+	return emitter->sheet;
+}
+
+bool emitter_step(emitter_object* const emitter, const emitter_type* const params) {
+	assert(emitter != NULL);
+	assert(params != NULL);
+
+	particles_object* const particles = emitter->particles;
+	emitter->params = *params;
+
+	/*
+	 * Fractional rates are carried over between steps, so a rate of 0.5
+	 * spawns a particle every other step.
+	 */
+	const float spawns = params->rate > 0.0f ? params->rate + emitter->spawn_remainder : 0.0f;
+	size_t spawn_count = 0u;
+	if (spawns >= (float)emitter->capacity) {
+		spawn_count = emitter->capacity;
+		emitter->spawn_remainder = 0.0f;
+	}
+	else if (spawns >= 1.0f) {
+		spawn_count = (size_t)spawns;
+		emitter->spawn_remainder = spawns - (float)spawn_count;
+	}
+	else {
+		emitter->spawn_remainder = spawns;
+	}
+	const size_t spawn_start = emitter->spawn_next;
+	emitter->spawn_next = (emitter->spawn_next + spawn_count) % emitter->capacity;
+
+	glUseProgram(particles->step_program);
+	glUniform1ui(particles->spawn_start_location, (GLuint)spawn_start);
+	glUniform1ui(particles->spawn_count_location, (GLuint)spawn_count);
+	glUniform1ui(particles->capacity_location, (GLuint)emitter->capacity);
+	glUniform1ui(particles->seed_location, emitter->steps++);
+	glUniform2f(particles->origin_location, params->position[0], params->position[1]);
+	glUniform2f(particles->direction_location, params->angle, params->spread);
+	glUniform2f(particles->speed_location, params->speed_min, params->speed_max);
+	glUniform2f(particles->lifetime_location, params->lifetime_min, params->lifetime_max);
+	glUniform2f(particles->acceleration_location, params->acceleration[0], params->acceleration[1]);
+
+	const size_t next = emitter->current ^ 1u;
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(emitter->step_arrays[emitter->current]);
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0u, emitter->buffers[next]);
+	glBeginTransformFeedback(GL_POINTS);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)emitter->capacity);
+	glEndTransformFeedback();
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0u, 0u);
+	glBindVertexArray(0u);
+	glDisable(GL_RASTERIZER_DISCARD);
+	if (opengl_error("Error from transform feedback in emitter_step: ")) {
+		return false;
+	}
+
+	emitter->current = next;
+	emitter->version = next_emitter_version++;
+	return true;
+}
+
+uint64_t emitter_version_get(emitter_object* const emitter) {
+	assert(emitter != NULL);
+
+	return emitter->version;
+}
+
+bool emitter_draw(emitter_object* const emitter, const mat4 view, sprites_stats_type* const stats) {
+	assert(emitter != NULL);
+	assert(view != NULL);
+	assert(stats != NULL);
+
+	const emitter_type* const params = &emitter->params;
+	if (!(params->src[2] > 0.0f) || !(params->src[3] > 0.0f)) {
+		return true;
+	}
+
+	particles_object* const particles = emitter->particles;
+	glUseProgram(particles->program);
+	glUniformMatrix4fv(particles->view_location, 1, GL_FALSE, view);
+	glUniform4fv(particles->src_location, 1, params->src);
+	glUniform2f(particles->sheet_dimensions_location, 1.0f / emitter->sheet->width, 1.0f / emitter->sheet->height);
+	glUniform2f(particles->size_location, params->size_start, params->size_end);
+	glUniform4fv(particles->tint_start_location, 1, params->tint_start);
+	glUniform4fv(particles->tint_end_location, 1, params->tint_end);
+	glBindTexture(GL_TEXTURE_2D, emitter->sheet->name);
+	glBindVertexArray(emitter->draw_arrays[emitter->current]);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)emitter->capacity);
+	if (opengl_error("Error from glDrawArraysInstanced in emitter_draw: ")) {
+		return false;
+	}
+
+	stats->draws++;
+	stats->instances += emitter->capacity;
+	return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Particle emitters simulated entirely on the GPU. Each emitter keeps its
+ * particles in a pair of vertex buffers, each step spawning, moving and aging
+ * the particles of one buffer into the other with transform feedback, so the
+ * CPU's cost per step is only the emitter's parameters, however many particles
+ * there are. All functions must be called in the render thread.
+ */
+
+#include "render/render_types.h"
+#include "render/private/sprites.h"
+#include "data/data_texture.h"
+#include "util/maths.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The particles object holds the shader programs shared by all emitters, and
+ * must outlive all the emitters created with it.
+ */
+typedef struct particles_object particles_object;
+typedef struct emitter_object emitter_object;
+
+particles_object* particles_create();
+void particles_destroy(particles_object* const particles);
+
+/*
+ * Create an emitter of up to capacity live particles, drawn with the sheet.
+ * Spawned particles replace the oldest particles, so capacity should be at
+ * least the rate times the longest lifetime. Returns NULL upon failure.
+ */
+emitter_object* emitter_create(particles_object* const particles, data_texture_object* const sheet, const size_t capacity);
+void emitter_destroy(emitter_object* const emitter);
+data_texture_object* emitter_sheet_get(emitter_object* const emitter);
+
+/*
+ * Step the emitter's particles one tick with the parameters, which are also
+ * used in drawing the particles until the next step.
+ */
+bool emitter_step(emitter_object* const emitter, const emitter_type* const params);
+
+/*
+ * Returns a version that changes whenever the emitter is stepped.
+ */
+uint64_t emitter_version_get(emitter_object* const emitter);
+
+/*
+ * Draw the emitter's live particles with the view from the emitter's layer's
+ * coordinates to clip space, in one instanced draw.
+ */
+bool emitter_draw(emitter_object* const emitter, const mat4 view, sprites_stats_type* const stats);
@@ -23,73 +23,134 @@
  */
 
 #include "render/private/print.h"
+#include "util/dict.h"
 #include "util/str.h"
 #include "util/log.h"
 #include "util/mem.h"
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <stdarg.h>
 #include <float.h>
 #include <assert.h>
 
-bool print_layer_string(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const char* const string) {
-	assert(font != NULL);
-	assert(layers != NULL);
-	assert(x >= -FLT_MAX);
-	assert(x <= FLT_MAX);
-	assert(y >= -FLT_MAX);
-	assert(y <= FLT_MAX);
-	assert(string != NULL);
+/*
+ * A run of consecutive glyphs of the same page of the font.
+ */
+typedef struct print_run {
+	size_t page;
+	size_t start;
+	size_t num_sprites;
+} print_run;
 
-	/*
-	 * TODO: Create a new font generator that sets the Unicode bit properly. It
-	 * seems the AngelCode generator has a bug, where it doesn't set the
-	 * Unicode bit for Unicode binary format fonts.
-	 */
-	//if (!(font->font->bits1 & FONT_BITS1_UNICODE)) {
-	if (font->font->format != FONT_FORMAT_BINARY && !(font->font->bits1 & FONT_BITS1_UNICODE)) {
-		log_printf("Error: Font used for printing text is not a Unicode font\n");
-		return false;
+/*
+ * Growable arrays that text is laid out into, reused between layouts. With an
+ * arena, the arrays are allocated from the arena instead, for one layout.
+ */
+typedef struct print_scratch {
+	mem_arena_object* arena;
+	sprite_type* sprites;
+	size_t sprites_size;
+	print_run* runs;
+	size_t runs_length;
+	size_t runs_size;
+} print_scratch;
+
+/*
+ * A cached layout, in a single allocation along with its runs, sprites and
+ * key. Layouts are kept in least-recently-used order, most recent first.
+ */
+typedef struct print_layout {
+	struct print_layout* prev;
+	struct print_layout* next;
+	uint64_t last_frame;
+	size_t num_bytes;
+	size_t num_runs;
+	const print_run* runs;
+	const sprite_type* sprites;
+	const void* key;
+	size_t key_size;
+} print_layout;
+
+struct print_cache_object {
+	dict_object* layouts;
+	print_layout* most_recent;
+	print_layout* least_recent;
+	size_t max_bytes;
+	uint64_t frame;
+
+	unsigned char* key;
+	size_t key_size;
+	size_t key_capacity;
+
+	print_scratch scratch;
+
+	print_cache_stats_type stats;
+};
+
+static void scratch_free(print_scratch* const scratch) {
+	if (scratch->sprites != NULL) {
+		mem_free(scratch->sprites);
 	}
+	if (scratch->runs != NULL) {
+		mem_free(scratch->runs);
+	}
+}
+
+/*
+ * Lay the decoded string out into the scratch arrays. Returns false on
+ * allocation failure.
+ */
+static bool layout_codepoints(data_font_object* const font, const float x, const float y, const float scale, const uint32_t* const codepoints, const size_t len, print_scratch* const scratch) {
+	scratch->runs_length = 0u;
 
-	const size_t len = utf8_strlen(string);
 	if (len == 0u) {
 		return true;
 	}
 
-	float print_x = x, print_y = y;
-	size_t bytes;
-	uint32_t c = utf8_get(string, &bytes);
-	if (c == UINT32_C(0xFFFD) && bytes == 1u) {
-		return false;
+	if (scratch->arena != NULL) {
+		scratch->sprites = mem_arena_alloc(scratch->arena, sizeof(sprite_type) * len, _Alignof(sprite_type));
+		scratch->runs = mem_arena_alloc(scratch->arena, sizeof(print_run) * len, _Alignof(print_run));
+		if (scratch->sprites == NULL || scratch->runs == NULL) {
+			return false;
+		}
+		scratch->sprites_size = len;
+		scratch->runs_size = len;
 	}
-
-	const char* s = string + bytes;
-
-	sprite_type* const sprites = mem_malloc(sizeof(sprite_type) * len);
-	if (sprites == NULL) {
-		return false;
+	if (len > scratch->sprites_size) {
+		sprite_type* const new_sprites = mem_realloc(scratch->sprites, sizeof(sprite_type) * len);
+		if (new_sprites == NULL) {
+			return false;
+		}
+		scratch->sprites = new_sprites;
+		scratch->sprites_size = len;
 	}
-
-	size_t sequence_len = 0u;
-	size_t sequence_page = font->font->num_pages;
-
-	for (uint32_t next_c = 0u; c != 0u; c = next_c, s += bytes) {
-		next_c = utf8_get(s, &bytes);
-		if (next_c == UINT32_C(0xFFFD) && bytes == 1u) {
+	if (len > scratch->runs_size) {
+		print_run* const new_runs = mem_realloc(scratch->runs, sizeof(print_run) * len);
+		if (new_runs == NULL) {
 			return false;
 		}
+		scratch->runs = new_runs;
+		scratch->runs_size = len;
+	}
+
+	float print_x = x, print_y = y;
+
+	sprite_type* const sprites = scratch->sprites;
+	size_t num_sprites = 0u;
+	print_run* run = NULL;
+
+	for (size_t i = 0u; i < len; i++) {
+		const uint32_t c = codepoints[i];
+		const uint32_t next_c = i + 1u < len ? codepoints[i + 1u] : 0u;
 		if (c == '\n' || c == '\r') {
 			print_x = x;
-			print_y += font->font->line_h;
+			print_y += font->font->line_h * scale;
 			if (
 				(c == '\n' && next_c == '\r') ||
 				(c == '\r' && next_c == '\n')
 			) {
-				s += bytes;
-				next_c = utf8_get(s, &bytes);
-				if (next_c == UINT32_C(0xFFFD) && bytes == 1u) {
-					return false;
-				}
+				i++;
 			}
 			continue;
 		}
@@ -99,65 +160,364 @@ bool print_layer_string(data_font_object* const font, layers_object* const layer
 			continue;
 		}
 
-		if (sequence_page == font->font->num_pages) {
-			sequence_page = font_c->page;
-		}
-		if (sequence_page != font_c->page) {
-			if (!layers_sprites_add(layers, font->textures[sequence_page]->texture, layer_index, sequence_len, sprites)) {
-				mem_free(sprites);
-				return false;
-			}
-			sequence_len = 0u;
-			sequence_page = font_c->page;
+		if (run == NULL || run->page != font_c->page) {
+			run = &scratch->runs[scratch->runs_length++];
+			run->page = font_c->page;
+			run->start = num_sprites;
+			run->num_sprites = 0u;
 		}
 
-		sprites[sequence_len].src[0] = font_c->x;
-		sprites[sequence_len].src[1] = font_c->y;
-		sprites[sequence_len].src[2] = font_c->w;
-		sprites[sequence_len].src[3] = font_c->h;
+		sprites[num_sprites].src[0] = font_c->x;
+		sprites[num_sprites].src[1] = font_c->y;
+		sprites[num_sprites].src[2] = font_c->w;
+		sprites[num_sprites].src[3] = font_c->h;
 
-		sprites[sequence_len].dst[0] = print_x + font_c->x_offset;
-		sprites[sequence_len].dst[1] = print_y + font_c->y_offset;
-		sprites[sequence_len].dst[2] = font_c->w;
-		sprites[sequence_len].dst[3] = font_c->h;
+		sprites[num_sprites].dst[0] = print_x + font_c->x_offset * scale;
+		sprites[num_sprites].dst[1] = print_y + font_c->y_offset * scale;
+		sprites[num_sprites].dst[2] = font_c->w * scale;
+		sprites[num_sprites].dst[3] = font_c->h * scale;
 
-		sequence_len++;
+		num_sprites++;
+		run->num_sprites++;
 
-		print_x += font_c->x_advance;
+		print_x += font_c->x_advance * scale;
 		ptrdiff_t amount;
 		if (font_kerning_amount_get(font->font, c, next_c, &amount)) {
-			print_x += amount;
+			print_x += amount * scale;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Lay the string out into the scratch arrays, decoding it into the scratch
+ * arena first. Returns false on invalid UTF-8 or allocation failure.
+ */
+static bool layout(data_font_object* const font, const float x, const float y, const float scale, const char* const string, print_scratch* const scratch) {
+	const size_t size = strlen(string);
+	if (size == 0u) {
+		scratch->runs_length = 0u;
+		return true;
+	}
+
+	// With an arena, the caller frees everything allocated from the arena for
+	// the layout, so the codepoints are left for it to free.
+	mem_arena_object* const arena = scratch->arena != NULL ? scratch->arena : mem_scratch_get();
+	if (arena == NULL) {
+		return false;
+	}
+	const mem_arena_mark mark = mem_arena_mark_get(arena);
+	uint32_t* const codepoints = mem_arena_alloc(arena, sizeof(uint32_t) * size, _Alignof(uint32_t));
+	bool success = false;
+	if (codepoints != NULL) {
+		const size_t len = utf8_decode(string, size, codepoints);
+		success = len != SIZE_MAX && layout_codepoints(font, x, y, scale, codepoints, len, scratch);
+	}
+	if (scratch->arena == NULL) {
+		mem_arena_rewind(arena, mark);
+	}
+	return success;
+}
+
+static bool unicode_check(data_font_object* const font) {
+	/*
+	 * TODO: Create a new font generator that sets the Unicode bit properly. It
+	 * seems the AngelCode generator has a bug, where it doesn't set the
+	 * Unicode bit for Unicode binary format fonts.
+	 */
+	//if (!(font->font->bits1 & FONT_BITS1_UNICODE)) {
+	if (font->font->format != FONT_FORMAT_BINARY && !(font->font->bits1 & FONT_BITS1_UNICODE)) {
+		log_printf("Error: Font used for printing text is not a Unicode font\n");
+		return false;
+	}
+
+	return true;
+}
+
+bool print_layer_string(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const string) {
+	assert(font != NULL);
+	assert(layers != NULL);
+	assert(x >= -FLT_MAX);
+	assert(x <= FLT_MAX);
+	assert(y >= -FLT_MAX);
+	assert(y <= FLT_MAX);
+	assert(scale > 0.0f);
+	assert(string != NULL);
+
+	if (!unicode_check(font)) {
+		return false;
+	}
+
+	mem_arena_object* const arena = mem_scratch_get();
+	if (arena == NULL) {
+		return false;
+	}
+	const mem_arena_mark mark = mem_arena_mark_get(arena);
+	print_scratch scratch = { .arena = arena };
+	bool success = layout(font, x, y, scale, string, &scratch);
+	for (size_t i = 0u; success && i < scratch.runs_length; i++) {
+		const print_run* const run = &scratch.runs[i];
+		success = layers_sprites_add(layers, font->textures[run->page]->texture, layer_index, run->num_sprites, scratch.sprites + run->start);
+	}
+	mem_arena_rewind(arena, mark);
+
+	return success;
+}
+
+print_cache_object* print_cache_create(const size_t max_bytes) {
+	print_cache_object* const cache = mem_calloc(1u, sizeof(print_cache_object));
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->layouts = dict_create(64u);
+	if (cache->layouts == NULL) {
+		mem_free(cache);
+		return NULL;
+	}
+	cache->max_bytes = max_bytes;
+
+	return cache;
+}
+
+static bool layout_destroy(void* const data) {
+	mem_free(data);
+	return true;
+}
+
+void print_cache_destroy(print_cache_object* const cache) {
+	assert(cache != NULL);
+
+	dict_destroy(cache->layouts);
+	if (cache->key != NULL) {
+		mem_free(cache->key);
+	}
+	scratch_free(&cache->scratch);
+	mem_free(cache);
+}
+
+void print_cache_restart(print_cache_object* const cache) {
+	assert(cache != NULL);
+
+	cache->frame++;
+}
+
+void print_cache_stats_get(print_cache_object* const cache, print_cache_stats_type* const stats) {
+	assert(cache != NULL);
+	assert(stats != NULL);
+
+	*stats = cache->stats;
+}
+
+static void layout_unlink(print_cache_object* const cache, print_layout* const entry) {
+	if (entry->prev != NULL) {
+		entry->prev->next = entry->next;
+	}
+	else {
+		cache->most_recent = entry->next;
+	}
+	if (entry->next != NULL) {
+		entry->next->prev = entry->prev;
+	}
+	else {
+		cache->least_recent = entry->prev;
+	}
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+static void layout_link(print_cache_object* const cache, print_layout* const entry) {
+	entry->prev = NULL;
+	entry->next = cache->most_recent;
+	if (cache->most_recent != NULL) {
+		cache->most_recent->prev = entry;
+	}
+	else {
+		cache->least_recent = entry;
+	}
+	cache->most_recent = entry;
+}
+
+/*
+ * Evict least recently used layouts until num_bytes more fit in the cache.
+ * Layouts used in the current frame might still be referenced by the layers,
+ * so they're never evicted, which can leave the cache over its budget until
+ * later frames.
+ */
+static bool layouts_evict(print_cache_object* const cache, const size_t num_bytes) {
+	while (
+		cache->least_recent != NULL &&
+		cache->least_recent->last_frame != cache->frame &&
+		cache->stats.num_bytes + num_bytes > cache->max_bytes
+	) {
+		print_layout* const entry = cache->least_recent;
+		layout_unlink(cache, entry);
+		cache->stats.num_bytes -= entry->num_bytes;
+		cache->stats.num_layouts--;
+		cache->stats.evictions++;
+		if (!dict_set(cache->layouts, entry->key, entry->key_size, NULL, 0u, NULL, NULL)) {
+			return false;
 		}
 	}
 
-	if (!layers_sprites_add(layers, font->textures[sequence_page]->texture, layer_index, sequence_len, sprites)) {
-		mem_free(sprites);
+	return cache->stats.num_bytes + num_bytes <= cache->max_bytes;
+}
+
+/*
+ * Copy the laid out scratch into a new layout, cached under the current key.
+ * Returns NULL if the layout doesn't fit in the cache, or upon failure.
+ */
+static print_layout* layout_insert(print_cache_object* const cache) {
+	const print_scratch* const scratch = &cache->scratch;
+	const size_t num_sprites = scratch->runs_length > 0u ?
+		scratch->runs[scratch->runs_length - 1u].start + scratch->runs[scratch->runs_length - 1u].num_sprites :
+		0u;
+	const size_t runs_offset = sizeof(print_layout);
+	const size_t sprites_offset = runs_offset + sizeof(print_run) * scratch->runs_length;
+	const size_t key_offset = sprites_offset + sizeof(sprite_type) * num_sprites;
+	const size_t num_bytes = key_offset + cache->key_size;
+
+	if (num_bytes > cache->max_bytes || !layouts_evict(cache, num_bytes)) {
+		return NULL;
+	}
+
+	unsigned char* const data = mem_malloc(num_bytes);
+	if (data == NULL) {
+		return NULL;
+	}
+	print_layout* const entry = (print_layout*)data;
+	entry->last_frame = cache->frame;
+	entry->num_bytes = num_bytes;
+	entry->num_runs = scratch->runs_length;
+	memcpy(data + runs_offset, scratch->runs, sizeof(print_run) * scratch->runs_length);
+	entry->runs = (const print_run*)(data + runs_offset);
+	memcpy(data + sprites_offset, scratch->sprites, sizeof(sprite_type) * num_sprites);
+	entry->sprites = (const sprite_type*)(data + sprites_offset);
+	memcpy(data + key_offset, cache->key, cache->key_size);
+	entry->key = data + key_offset;
+	entry->key_size = cache->key_size;
+
+	if (!dict_set(cache->layouts, entry->key, entry->key_size, entry, num_bytes, layout_destroy, NULL)) {
+		mem_free(data);
+		return NULL;
+	}
+	layout_link(cache, entry);
+	cache->stats.num_bytes += num_bytes;
+	cache->stats.num_layouts++;
+
+	return entry;
+}
+
+bool print_layer_string_cached(print_cache_object* const cache, data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const string) {
+	assert(cache != NULL);
+	assert(font != NULL);
+	assert(layers != NULL);
+	assert(x >= -FLT_MAX);
+	assert(x <= FLT_MAX);
+	assert(y >= -FLT_MAX);
+	assert(y <= FLT_MAX);
+	assert(scale > 0.0f);
+	assert(string != NULL);
+
+	if (!unicode_check(font)) {
 		return false;
 	}
 
-	mem_free(sprites);
+	const size_t string_size = strlen(string);
+	const size_t key_size = dict_tokey(NULL, 0u, 5u,
+		&font, sizeof(font),
+		&x, sizeof(x),
+		&y, sizeof(y),
+		&scale, sizeof(scale),
+		string, string_size
+	);
+	if (key_size > cache->key_capacity) {
+		unsigned char* const new_key = mem_realloc(cache->key, key_size);
+		if (new_key == NULL) {
+			return false;
+		}
+		cache->key = new_key;
+		cache->key_capacity = key_size;
+	}
+	cache->key_size = dict_tokey(cache->key, key_size, 5u,
+		&font, sizeof(font),
+		&x, sizeof(x),
+		&y, sizeof(y),
+		&scale, sizeof(scale),
+		string, string_size
+	);
+
+	void* value;
+	print_layout* entry = NULL;
+	if (dict_get(cache->layouts, cache->key, cache->key_size, &value, NULL)) {
+		entry = value;
+		entry->last_frame = cache->frame;
+		layout_unlink(cache, entry);
+		layout_link(cache, entry);
+		cache->stats.hits++;
+	}
+	else {
+		cache->stats.misses++;
+		if (!layout(font, x, y, scale, string, &cache->scratch)) {
+			return false;
+		}
+		entry = layout_insert(cache);
+		if (entry == NULL) {
+			/*
+			 * Too large to cache, so the laid-out scratch is copied into the
+			 * layers, as the scratch is reused by the next layout.
+			 */
+			const print_scratch* const scratch = &cache->scratch;
+			for (size_t i = 0u; i < scratch->runs_length; i++) {
+				const print_run* const run = &scratch->runs[i];
+				if (!layers_sprites_add(layers, font->textures[run->page]->texture, layer_index, run->num_sprites, scratch->sprites + run->start)) {
+					return false;
+				}
+			}
+			return true;
+		}
+	}
+
+	/*
+	 * Layouts used in the current frame aren't evicted before the next
+	 * restart, so the layers can reference the cached sprites directly.
+	 */
+	for (size_t i = 0u; i < entry->num_runs; i++) {
+		const print_run* const run = &entry->runs[i];
+		if (!layers_sprites_reference(layers, font->textures[run->page]->texture, layer_index, run->num_sprites, entry->sprites + run->start)) {
+			return false;
+		}
+	}
 
 	return true;
 }
 
-bool print_layer_formatted(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const char* const format, ...) {
+bool print_layer_formatted(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const format, ...) {
 	assert(font != NULL);
 	assert(layers != NULL);
 	assert(x >= -FLT_MAX);
 	assert(x <= FLT_MAX);
 	assert(y >= -FLT_MAX);
 	assert(y <= FLT_MAX);
+	assert(scale > 0.0f);
 	assert(format != NULL);
 
+	mem_arena_object* const arena = mem_scratch_get();
+	if (arena == NULL) {
+		return false;
+	}
+	const mem_arena_mark mark = mem_arena_mark_get(arena);
 	va_list args;
 	va_start(args, format);
-	char* const text = alloc_vsprintf(format, args);
+	char* const text = mem_arena_vsprintf(arena, format, args);
 	va_end(args);
 	if (text == NULL) {
+		mem_arena_rewind(arena, mark);
 		return false;
 	}
 
-	const bool success = print_layer_string(font, layers, layer_index, x, y, text);
-	mem_free(text);
+	const bool success = print_layer_string(font, layers, layer_index, x, y, scale, text);
+	mem_arena_rewind(arena, mark);
 	return success;
 }
@@ -26,6 +26,7 @@
 #include "render/private/layers.h"
 #include "data/data_types.h"
 #include <stddef.h>
+#include <stdint.h>
 
 /*
  * Generate graphical text using a bitmap font. Only supports UTF-8 fonts and
@@ -33,11 +34,41 @@
  */
 
 /*
- * Print the string at the requested position.
+ * Print the string at the requested position, with the font's glyphs, line
+ * height and advances multiplied by scale.
  */
-bool print_layer_string(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const char* const string);
+bool print_layer_string(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const string);
+
+/*
+ * Cache of text layouts, keyed by font, origin, scale and string contents, so
+ * repeatedly printing the same text skips decoding and glyph lookups, and the
+ * cached sprites are referenced by the layers without copying. Least recently
+ * used layouts are evicted to keep the cache within max_bytes, though layouts
+ * printed since the last print_cache_restart are never evicted, as the layers
+ * might still reference them; call print_cache_restart once the layers have
+ * been drawn, before printing the next frame's text.
+ */
+typedef struct print_cache_object print_cache_object;
+
+typedef struct print_cache_stats_type {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t num_layouts;
+	size_t num_bytes;
+} print_cache_stats_type;
+
+print_cache_object* print_cache_create(const size_t max_bytes);
+void print_cache_destroy(print_cache_object* const cache);
+void print_cache_restart(print_cache_object* const cache);
+void print_cache_stats_get(print_cache_object* const cache, print_cache_stats_type* const stats);
+
+/*
+ * Same as print_layer_string, but using the cache.
+ */
+bool print_layer_string_cached(print_cache_object* const cache, data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const string);
 
 /*
  * Print the formatted text at the requested position.
  */
-bool print_layer_formatted(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const char* const format, ...);
+bool print_layer_formatted(data_font_object* const font, layers_object* const layers, const size_t layer_index, const float x, const float y, const float scale, const char* const format, ...);
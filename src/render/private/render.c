@@ -26,27 +26,288 @@
 #include "render/private/sprites.h"
 #include "render/private/layers.h"
 #include "render/private/print.h"
+#include "render/private/texture_array.h"
+#include "render/private/gpu_timer.h"
+#include "render/private/texture_loader.h"
+#include "render/private/cull.h"
+#include "render/private/interp.h"
+#include "render/private/tilemap.h"
+#include "render/private/particles.h"
+#include "render/private/capture.h"
+#include "render/private/resolution.h"
 #include "render/private/opengl.h"
 #include "data/data_texture.h"
 #include "main/prog.h"
+#include "main/private/prog_private.h"
+#include "main/main.h"
 #include "data/data.h"
+#include "data/data_shared.h"
 #include "util/log.h"
-#include "util/str.h"
 #include "util/mem.h"
 #include "util/maths.h"
+#include "util/dict.h"
+#include "util/str.h"
+#include "util/nanotime.h"
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <stdarg.h>
 #include <assert.h>
 
 static frames_object* render_frames;
 static const render_settings_type* current_settings = NULL;
 static data_cache_object* data_cache;
-#define NUM_LAYERS 2u
 static layers_object* layers;
+static sprites_format_type layers_format;
+_Static_assert(RENDER_LAYERS_MAX <= LAYERS_MAX, "The render API's layers must fit in the layers library's layers");
 static sprites_object* sprites;
 
+/*
+ * Sheets loaded with render_texture_load are uploaded at most
+ * TEXTURE_UPLOAD_BUDGET bytes per frame. Without the loader, they're loaded
+ * synchronously.
+ */
+#define TEXTURE_UPLOAD_BUDGET ((size_t)4u << 20)
+static texture_loader_object* texture_loader;
+
+struct render_texture_load_object {
+	const char* sheet_filename;
+	SDL_atomic_t status;
+
+	/*
+	 * Held by the app thread until released, and by the render thread until
+	 * the load completes.
+	 */
+	SDL_atomic_t refs;
+};
+
+/*
+ * Sheets are added to the texture array as they're drawn, so sprites of
+ * different sheets can be drawn together. Sheets larger than the array's layers
+ * are drawn separately. Every sheet in the array takes a whole
+ * TEXTURE_ARRAY_SIZE by TEXTURE_ARRAY_SIZE RGBA layer, 4 MiB at the default
+ * size, however small the sheet is, so builds with many small sheets can lower
+ * the size through the TEXTURE_ARRAY_SIZE CMake setting, trading how large a
+ * sheet can be batched for memory. A size of 0 disables the array.
+ */
+#ifndef TEXTURE_ARRAY_SIZE
+#define TEXTURE_ARRAY_SIZE 1024
+#endif
+static texture_array_object* texture_array;
+
+/*
+ * Batches are only accessed in the render thread once created. Destroyed
+ * batches might still be referenced by the layers until the frame is drawn, so
+ * they're only freed after drawing.
+ */
+struct render_batch_object {
+	size_t layer_index;
+	size_t num_sprites;
+
+	/*
+	 * The sheet's data is pinned in the cache while the batch exists.
+	 */
+	const data_object* sheet;
+	sprites_batch_object* batch;
+	render_batch_object* prev;
+	render_batch_object* next;
+};
+/*
+ * Layouts of printed text are cached within PRINT_CACHE_SIZE bytes. The
+ * cache's stats are published for the app thread at the start of each frame.
+ */
+#define PRINT_CACHE_SIZE ((size_t)1u << 20)
+static print_cache_object* print_cache;
+static SDL_SpinLock print_cache_stats_lock;
+static render_print_cache_stats_type print_cache_stats;
+
+/*
+ * The frame's draws are timed on the GPU in these zones, each layer having its
+ * own zone when layer stats are enabled; the other layers' zone is for layers
+ * beyond those reported. The stats are published for the app thread after each
+ * frame is drawn.
+ */
+enum {
+	RENDER_ZONE_CLEAR = FRAMES_ZONE_CLEAR,
+	RENDER_ZONE_SPRITES,
+	RENDER_ZONE_LAYERS,
+	RENDER_ZONE_UPSCALE,
+	RENDER_ZONE_OTHER_LAYERS,
+	RENDER_ZONE_LAYER_FIRST
+};
+#define GPU_TIMER_MAX_TIMESTAMPS 256u
+_Static_assert(GPU_TIMER_MAX_TIMESTAMPS >= 8u + RENDER_STATS_LAYERS_MAX + 1u, "The timer must have room for each pass and reported layer");
+_Static_assert(RENDER_STATS_LAYERS_MAX <= LAYERS_STATS_MAX, "The reported layers must fit in the layers library's stats");
+static gpu_timer_object* gpu_timer;
+static SDL_SpinLock render_stats_lock;
+static render_stats_type render_stats;
+
+static render_batch_object* live_batches;
+static render_batch_object* destroyed_batches;
+
+/*
+ * Tilemaps are managed like batches, destroyed tilemaps only being freed after
+ * drawing. If the tilemaps object couldn't be created, creating tilemaps fails.
+ */
+struct render_tilemap_object {
+	size_t layer_index;
+	size_t width;
+	size_t height;
+
+	/*
+	 * The sheet's data is pinned in the cache while the tilemap exists.
+	 */
+	const data_object* sheet;
+	tilemap_object* tilemap;
+	render_tilemap_object* prev;
+	render_tilemap_object* next;
+};
+static tilemaps_object* tilemaps;
+static render_tilemap_object* live_tilemaps;
+static render_tilemap_object* destroyed_tilemaps;
+
+/*
+ * Emitters are managed like batches too. If the particles object couldn't be
+ * created, creating emitters fails.
+ */
+struct render_emitter_object {
+	size_t layer_index;
+
+	/*
+	 * The sheet's data is pinned in the cache while the emitter exists.
+	 */
+	const data_object* sheet;
+	emitter_object* emitter;
+	render_emitter_object* prev;
+	render_emitter_object* next;
+};
+static particles_object* particles;
+static render_emitter_object* live_emitters;
+static render_emitter_object* destroyed_emitters;
+
+/*
+ * Sheets and fonts are interned into handles by any thread calling the render
+ * API, including threads recording into render lists, each handle being its
+ * slot's index plus one. Lookups and inserts of the handle dicts are guarded
+ * by handles_lock, a slot's type and filename being written before the lock
+ * is released, publishing the slot along with its handle. Handles only reach
+ * the render thread in commands, so the render thread can always read the
+ * slots of the handles it gets. The slots' data handles are interned in and
+ * only accessed by the render thread.
+ */
+#define RENDER_HANDLES_MAX ((size_t)4096u)
+typedef struct handle_slot_type {
+	data_type type;
+	char* filename;
+	data_handle data;
+} handle_slot_type;
+static handle_slot_type handle_slots[RENDER_HANDLES_MAX];
+static size_t num_handles;
+static SDL_SpinLock handles_lock;
+static dict_object* sheet_handles;
+static dict_object* font_handles;
+static dict_object* sdf_font_handles;
+
+/*
+ * Atlases are looked up where sprites are submitted, in the app thread, so
+ * they're acquired from the shared data cache, keeping the app thread's entries
+ * by filename until render_deinit.
+ */
+static dict_object* atlas_entries;
+
+/*
+ * The capture from render_capture_start, recording the render API calls made
+ * in the main thread from the next render_start on. Capture errors only stop
+ * the capture, without failing the frames captured.
+ */
+static capture_object* capture;
+static bool capture_framing;
+
+/*
+ * The bounds sprites are culled against when the cull_sprites setting is
+ * enabled, updated at the start of each frame.
+ */
+static bool cull_enabled;
+static vec4 cull_bounds;
+static size_t num_culled;
+
+/*
+ * Tracked sprites are interpolated while frames are interpolated, each frame
+ * being blended from the previous tick by interp_alpha, which is updated each
+ * time the frame is drawn. If the interpolator couldn't be created, tracked
+ * sprites are drawn as given.
+ */
+static interp_object* interp;
+static bool interpolated;
+static float interp_alpha;
+
+/*
+ * With the dynamic_resolution setting enabled, frames are drawn into the
+ * resolution object's framebuffer from render_start's update on, then upscaled
+ * to the screen at render_end's draw. The scale is updated once per newly read
+ * back GPU time, counted by resolution_results. The resolution object is only
+ * created if the GPU timer was, as the scale can't be adjusted without it.
+ */
+static resolution_object* resolution;
+static bool resolution_active;
+static bool resolution_nearest;
+static uint64_t resolution_results;
+
+static void tilemaps_free(render_tilemap_object* tilemap_objects) {
+	while (tilemap_objects != NULL) {
+		render_tilemap_object* const next = tilemap_objects->next;
+		if (tilemap_objects->tilemap != NULL) {
+			tilemap_destroy(tilemap_objects->tilemap);
+			data_cache_unpin(tilemap_objects->sheet);
+		}
+		mem_free(tilemap_objects);
+		tilemap_objects = next;
+	}
+}
+
+static void emitters_free(render_emitter_object* emitters) {
+	while (emitters != NULL) {
+		render_emitter_object* const next = emitters->next;
+		if (emitters->emitter != NULL) {
+			emitter_destroy(emitters->emitter);
+			data_cache_unpin(emitters->sheet);
+		}
+		mem_free(emitters);
+		emitters = next;
+	}
+}
+
+static void batches_free(render_batch_object* batches) {
+	while (batches != NULL) {
+		render_batch_object* const next = batches->next;
+		if (batches->batch != NULL) {
+			sprites_batch_destroy(batches->batch);
+			data_cache_unpin(batches->sheet);
+		}
+		mem_free(batches);
+		batches = next;
+	}
+}
+
+/*
+ * Sheets dropped from the cache, whether evicted or dropped by ungets,
+ * removals or data_cache_only, are no longer referenced by anything to be
+ * drawn, so their layers in the texture array are reused.
+ */
+static void sheet_evict(void* const evict_data, const data_object* const data) {
+	(void)evict_data;
+	if (data->id.type == DATA_TYPE_TEXTURE && texture_array != NULL) {
+		texture_array_layer_release(texture_array, data->texture);
+	}
+}
+
 bool render_init(frames_object* const frames) {
 	log_printf("Initializing the render API\n");
 
+	// Selected first, as the sprites and layers are created for the backend.
+	opengl_backend_select();
+
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	glEnable(GL_CULL_FACE);
@@ -55,9 +316,114 @@ bool render_init(frames_object* const frames) {
 	if (data_cache == NULL) {
 		return false;
 	}
+	data_cache_evict_func_set(data_cache, sheet_evict, NULL);
+
+	texture_loader = texture_loader_create(data_cache, TEXTURE_UPLOAD_BUDGET);
+	if (texture_loader == NULL) {
+		log_printf("Failed to create the texture loader, loading textures synchronously\n");
+	}
+
+	print_cache = print_cache_create(PRINT_CACHE_SIZE);
+	if (print_cache == NULL) {
+		if (texture_loader != NULL) {
+			texture_loader_destroy(texture_loader);
+			texture_loader = NULL;
+		}
+		data_cache_destroy(data_cache);
+		data_cache = NULL;
+		return false;
+	}
+	SDL_AtomicLock(&print_cache_stats_lock);
+	print_cache_stats = (render_print_cache_stats_type) { 0 };
+	SDL_AtomicUnlock(&print_cache_stats_lock);
+
+	live_batches = NULL;
+	destroyed_batches = NULL;
+
+	gpu_timer = gpu_timer_create(GPU_TIMER_MAX_TIMESTAMPS);
+	if (gpu_timer == NULL) {
+		log_printf("Failed to create the GPU timer, GPU times won't be available\n");
+	}
+	SDL_AtomicLock(&render_stats_lock);
+	render_stats = (render_stats_type) { 0 };
+	SDL_AtomicUnlock(&render_stats_lock);
+
+	texture_array = NULL;
+	if (TEXTURE_ARRAY_SIZE > 0) {
+		texture_array = texture_array_create(TEXTURE_ARRAY_SIZE, TEXTURE_ARRAY_SIZE);
+		if (texture_array == NULL) {
+			log_printf("Failed to create the sprite texture array, drawing sprites without it\n");
+		}
+	}
+
+	/*
+	 * The sprites and layers are created up front, rather than in the first
+	 * render_start, as stateful commands of skipped frames can use them before
+	 * any render_start has been run.
+	 */
+	sprites = sprites_create(0u, SPRITES_FORMAT_FLOAT, texture_array);
+	layers_format = SPRITES_FORMAT_FLOAT;
+	layers = layers_create(layers_format, texture_array);
+	if (sprites == NULL || layers == NULL) {
+		if (sprites != NULL) {
+			sprites_destroy(sprites);
+			sprites = NULL;
+		}
+		if (layers != NULL) {
+			layers_destroy(layers);
+			layers = NULL;
+		}
+		if (texture_array != NULL) {
+			texture_array_destroy(texture_array);
+			texture_array = NULL;
+		}
+		if (gpu_timer != NULL) {
+			gpu_timer_destroy(gpu_timer);
+			gpu_timer = NULL;
+		}
+		print_cache_destroy(print_cache);
+		print_cache = NULL;
+		if (texture_loader != NULL) {
+			texture_loader_destroy(texture_loader);
+			texture_loader = NULL;
+		}
+		data_cache_destroy(data_cache);
+		data_cache = NULL;
+		return false;
+	}
+
+	frames_gpu_timer_set(frames, gpu_timer);
+
+	resolution = NULL;
+	resolution_active = false;
+	resolution_results = 0u;
+	if (gpu_timer != NULL) {
+		resolution = resolution_create();
+		if (resolution == NULL) {
+			log_printf("Failed to create the dynamic resolution framebuffer, drawing frames at full resolution\n");
+		}
+	}
+
+	interp = interp_create();
+	if (interp == NULL) {
+		log_printf("Failed to create the sprite interpolator, drawing tracked sprites without interpolation\n");
+	}
+	interpolated = false;
+	interp_alpha = 1.0f;
 
-	layers = NULL;
-	sprites = NULL;
+	live_tilemaps = NULL;
+	destroyed_tilemaps = NULL;
+	tilemaps = tilemaps_create();
+	if (tilemaps == NULL) {
+		log_printf("Failed to create the tilemap renderer, tilemaps can't be created\n");
+	}
+
+	live_emitters = NULL;
+	destroyed_emitters = NULL;
+	particles = particles_create();
+	if (particles == NULL) {
+		log_printf("Failed to create the particle renderer, emitters can't be created\n");
+	}
 
 	SDL_MemoryBarrierRelease();
 	SDL_AtomicSetPtr((void**)&render_frames, frames);
@@ -68,12 +434,67 @@ bool render_init(frames_object* const frames) {
 }
 
 void render_deinit() {
+	if (interp != NULL) {
+		interp_destroy(interp);
+		interp = NULL;
+	}
+
 	if (sprites != NULL) {
 		sprites_destroy(sprites);
+		sprites = NULL;
 	}
 
 	if (layers != NULL) {
 		layers_destroy(layers);
+		layers = NULL;
+	}
+
+	if (print_cache != NULL) {
+		print_cache_destroy(print_cache);
+		print_cache = NULL;
+	}
+
+	batches_free(live_batches);
+	batches_free(destroyed_batches);
+	live_batches = NULL;
+	destroyed_batches = NULL;
+
+	tilemaps_free(live_tilemaps);
+	tilemaps_free(destroyed_tilemaps);
+	live_tilemaps = NULL;
+	destroyed_tilemaps = NULL;
+	if (tilemaps != NULL) {
+		tilemaps_destroy(tilemaps);
+		tilemaps = NULL;
+	}
+
+	emitters_free(live_emitters);
+	emitters_free(destroyed_emitters);
+	live_emitters = NULL;
+	destroyed_emitters = NULL;
+	if (particles != NULL) {
+		particles_destroy(particles);
+		particles = NULL;
+	}
+
+	if (texture_array != NULL) {
+		texture_array_destroy(texture_array);
+		texture_array = NULL;
+	}
+
+	if (resolution != NULL) {
+		resolution_destroy(resolution);
+		resolution = NULL;
+	}
+
+	if (gpu_timer != NULL) {
+		gpu_timer_destroy(gpu_timer);
+		gpu_timer = NULL;
+	}
+
+	if (texture_loader != NULL) {
+		texture_loader_destroy(texture_loader);
+		texture_loader = NULL;
 	}
 
 	if (data_cache != NULL) {
@@ -81,39 +502,135 @@ void render_deinit() {
 	}
 
 	data_cache = NULL;
+
+	/*
+	 * The app thread is no longer rendering by now, so the handles it interned
+	 * can be freed here.
+	 */
+	for (size_t i = 0u; i < num_handles; i++) {
+		mem_free(handle_slots[i].filename);
+		handle_slots[i].filename = NULL;
+		handle_slots[i].data = DATA_HANDLE_NONE;
+	}
+	num_handles = 0u;
+	if (sheet_handles != NULL) {
+		dict_destroy(sheet_handles);
+		sheet_handles = NULL;
+	}
+	if (font_handles != NULL) {
+		dict_destroy(font_handles);
+		font_handles = NULL;
+	}
+	if (sdf_font_handles != NULL) {
+		dict_destroy(sdf_font_handles);
+		sdf_font_handles = NULL;
+	}
+	if (atlas_entries != NULL) {
+		dict_destroy(atlas_entries);
+		atlas_entries = NULL;
+	}
+	if (capture != NULL) {
+		capture_destroy(capture);
+		capture = NULL;
+		capture_framing = false;
+	}
 	SDL_MemoryBarrierRelease();
 	SDL_AtomicSetPtr((void**)&render_frames, NULL);
 }
 
+/*
+ * The tick's start time and duration are recorded with the settings, for
+ * interpolating the frame the tick produced.
+ */
+typedef struct render_start_object {
+	render_settings_type settings;
+	uint64_t tick_point;
+	uint64_t tick_duration;
+	bool started;
+} render_start_object;
+
 static bool render_start_update_func(void* const state) {
-	const render_settings_type* const settings = state;
+	render_start_object* const start = state;
+	const render_settings_type* const settings = &start->settings;
 
-	if (sprites == NULL) {
-		sprites = sprites_create(0u);
-		if (sprites == NULL) {
-			return false;
+	/*
+	 * Held frames are started again each time they're redrawn, but only
+	 * start a new tick of tracked sprites the first time.
+	 */
+	if (!start->started) {
+		if (interp != NULL) {
+			interp_tick(interp);
 		}
+		start->started = true;
 	}
-	else {
-		sprites_restart(sprites);
+
+	/*
+	 * Frames are drawn one tick behind, so the tick's sprites are fully
+	 * reached one tick after the tick started.
+	 */
+	interp_alpha = 1.0f;
+	if (interpolated && start->tick_duration > 0u) {
+		const uint64_t now = nanotime_now();
+		const uint64_t since = now > start->tick_point ? now - start->tick_point : 0u;
+		if (since < start->tick_duration) {
+			interp_alpha = (float)((double)since / (double)start->tick_duration);
+		}
 	}
 
-	size_t render_width, render_height;
-	prog_render_size_get(&render_width, &render_height);
+	sprites_restart(sprites);
 
-	if (layers == NULL) {
-		layers = layers_create(NUM_LAYERS);
-		if (layers == NULL) {
+	/*
+	 * The previous frame has been drawn, so sheets it drew can be evicted.
+	 */
+	data_cache_epoch_advance(data_cache);
+	data_cache_update(data_cache);
+	data_cache_budget_set(data_cache, DATA_TYPE_TEXTURE, SIZE_MAX, settings->texture_budget > 0u ? settings->texture_budget : SIZE_MAX);
+
+	if (texture_loader != NULL) {
+		opengl_group_push("texture uploads");
+		const bool updated = texture_loader_update(texture_loader);
+		opengl_group_pop();
+		if (!updated) {
 			return false;
 		}
+		else if (texture_loader_busy(texture_loader)) {
+			// Loads only progress while frames are drawn.
+			frames_redraw(render_frames);
+		}
 	}
-	else {
-		layers_restart(layers);
+
+	size_t render_width, render_height;
+	prog_render_size_get(&render_width, &render_height);
+
+	const sprites_format_type format = settings->packed_sprites ? SPRITES_FORMAT_PACKED : SPRITES_FORMAT_FLOAT;
+	if (!layers_format_set(layers, format)) {
+		return false;
 	}
+	layers_format = format;
+	layers_restart(layers);
+	layers_stats_set(layers, settings->layer_stats, gpu_timer, RENDER_ZONE_OTHER_LAYERS, RENDER_ZONE_LAYER_FIRST);
 
 	sprites_screen_set(sprites, settings->width, settings->height);
 	layers_screen_set(layers, settings->width, settings->height);
 
+	cull_enabled = settings->cull_sprites;
+	cull_bounds[0] = 0.0f;
+	cull_bounds[1] = 0.0f;
+	cull_bounds[2] = settings->width;
+	cull_bounds[3] = settings->height;
+	num_culled = 0u;
+
+	print_cache_stats_type stats;
+	print_cache_stats_get(print_cache, &stats);
+	SDL_AtomicLock(&print_cache_stats_lock);
+	print_cache_stats.hits = stats.hits;
+	print_cache_stats.misses = stats.misses;
+	print_cache_stats.evictions = stats.evictions;
+	print_cache_stats.num_layouts = stats.num_layouts;
+	print_cache_stats.num_bytes = stats.num_bytes;
+	SDL_AtomicUnlock(&print_cache_stats_lock);
+	print_cache_restart(print_cache);
+
 	const float render_aspect = (float)render_width / (float)render_height;
 	const float screen_aspect = (float)settings->width / (float)settings->height;
 	GLint set_x, set_y;
@@ -137,63 +654,319 @@ static bool render_start_update_func(void* const state) {
 		set_y = (GLint)((render_height - set_height) / 2);
 	}
 
-	glEnable(GL_SCISSOR_TEST);
-	glScissor(set_x, set_y, set_width, set_height);
-	glViewport(set_x, set_y, set_width, set_height);;
+	resolution_active = false;
+	if (settings->dynamic_resolution && resolution != NULL) {
+		const uint64_t results = gpu_timer_results_count(gpu_timer);
+		if (results != resolution_results) {
+			resolution_results = results;
+			const double target_milliseconds = settings->target_gpu_milliseconds > 0.0f ?
+				(double)settings->target_gpu_milliseconds :
+				prog_render_frame_duration_get() * 0.9 / 1000000.0;
+			const float min_scale = settings->min_resolution_scale > 0.0f ?
+				fminf(settings->min_resolution_scale, 1.0f) :
+				RESOLUTION_MIN_SCALE_DEFAULT;
+			resolution_update(resolution, gpu_timer_frame_milliseconds(gpu_timer), target_milliseconds, min_scale);
+		}
+		resolution_nearest = settings->nearest_upscale;
+		resolution_active = resolution_begin(resolution, set_x, set_y, set_width, set_height);
+	}
+	if (!resolution_active) {
+		glEnable(GL_SCISSOR_TEST);
+		glScissor(set_x, set_y, set_width, set_height);
+		glViewport(set_x, set_y, set_width, set_height);;
+	}
 
 	return true;
 }
 
+bool render_capture_start(const char* const filename, const uint64_t num_frames) {
+	assert(main_thread_is_this_thread());
+	assert(filename != NULL);
+	assert(num_frames > 0u);
+
+	if (capture != NULL) {
+		log_printf("Error: Frames are already being captured\n");
+		return false;
+	}
+	char* const full_filename = alloc_sprintf("%s%s", prog_save_path_get(), filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	capture = capture_create(full_filename, num_frames);
+	mem_free(full_filename);
+	capture_framing = false;
+	return capture != NULL;
+}
+
+bool render_capturing() {
+	return capture != NULL;
+}
+
+static void capture_stop() {
+	log_printf("Error capturing frames, stopping the capture\n");
+	capture_destroy(capture);
+	capture = NULL;
+	capture_framing = false;
+}
+
+/*
+ * Returns true if calls of the current thread are being captured.
+ */
+static bool capture_active() {
+	return capture_framing && main_thread_is_this_thread();
+}
+
+static bool capture_handle_define(const render_handle handle) {
+	const handle_slot_type* const slot = &handle_slots[handle - 1u];
+	return capture_handle(capture, handle, slot->type, slot->filename);
+}
+
 bool render_start(const render_settings_type* const settings) {
 	assert(settings != NULL);
 
+	if (capture != NULL && main_thread_is_this_thread()) {
+		capture_framing = true;
+		if (!capture_start(capture, settings)) {
+			capture_stop();
+		}
+	}
+
+	render_start_object* const start = frames_alloc(render_frames, sizeof(render_start_object));
+	if (start == NULL) {
+		return false;
+	}
+	start->settings = *settings;
+	prog_app_tick_get(&start->tick_point, &start->tick_duration);
+	start->started = false;
+
+	// The tick timing only affects interpolated frames, which are never idle,
+	// so it's left out of the hash.
+	frames_hash(render_frames, &settings->width, sizeof(settings->width));
+	frames_hash(render_frames, &settings->height, sizeof(settings->height));
+	frames_hash(render_frames, &settings->packed_sprites, sizeof(settings->packed_sprites));
+	frames_hash(render_frames, &settings->layer_stats, sizeof(settings->layer_stats));
+	frames_hash(render_frames, &settings->texture_budget, sizeof(settings->texture_budget));
+	frames_hash(render_frames, &settings->cull_sprites, sizeof(settings->cull_sprites));
+	frames_hash(render_frames, &settings->dynamic_resolution, sizeof(settings->dynamic_resolution));
+	frames_hash(render_frames, &settings->target_gpu_milliseconds, sizeof(settings->target_gpu_milliseconds));
+	frames_hash(render_frames, &settings->min_resolution_scale, sizeof(settings->min_resolution_scale));
+	frames_hash(render_frames, &settings->nearest_upscale, sizeof(settings->nearest_upscale));
+
 	static const command_funcs funcs = {
 		.update = render_start_update_func,
 		.draw = NULL,
-		.destroy = NULL
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
 	};
 
-	return frames_enqueue_command(render_frames, &funcs, (void*)settings);
+	return frames_enqueue_command(render_frames, &funcs, start);
+}
+
+void render_interpolated_set(const bool interpolate) {
+	interpolated = interpolate;
+}
+
+static void render_stats_publish() {
+	sprites_stats_type sprites_stats;
+	sprites_stats_get(sprites, &sprites_stats);
+	sprites_stats_type layers_total;
+	layers_stats_type layer_stats[LAYERS_STATS_MAX];
+	size_t num_layers = layers_stats_get(layers, &layers_total, layer_stats);
+	if (num_layers > RENDER_STATS_LAYERS_MAX) {
+		num_layers = RENDER_STATS_LAYERS_MAX;
+	}
+	const bool gpu_timed = gpu_timer != NULL && gpu_timer_results_available(gpu_timer);
+	data_cache_usage texture_usage;
+	data_cache_usage_get(data_cache, DATA_TYPE_TEXTURE, &texture_usage);
+
+	SDL_AtomicLock(&render_stats_lock);
+	render_stats.draws = sprites_stats.draws + layers_total.draws;
+	render_stats.instances = sprites_stats.instances + layers_total.instances;
+	render_stats.bytes = sprites_stats.bytes + layers_total.bytes;
+	render_stats.gpu_timed = gpu_timed;
+	if (gpu_timed) {
+		render_stats.frame_gpu_milliseconds = gpu_timer_frame_milliseconds(gpu_timer);
+		render_stats.clear_gpu_milliseconds = gpu_timer_zone_milliseconds(gpu_timer, RENDER_ZONE_CLEAR);
+		render_stats.sprites_gpu_milliseconds = gpu_timer_zone_milliseconds(gpu_timer, RENDER_ZONE_SPRITES);
+		render_stats.layers_gpu_milliseconds =
+			gpu_timer_zone_milliseconds(gpu_timer, RENDER_ZONE_LAYERS) +
+			gpu_timer_zone_milliseconds(gpu_timer, RENDER_ZONE_OTHER_LAYERS);
+		render_stats.upscale_gpu_milliseconds = gpu_timer_zone_milliseconds(gpu_timer, RENDER_ZONE_UPSCALE);
+	}
+	render_stats.culled = num_culled;
+	render_stats.textures_cached = texture_usage.num_cached;
+	render_stats.texture_gpu_bytes = texture_usage.gpu_size;
+	render_stats.resolution_scale = resolution_active ? resolution_scale_get(resolution) : 1.0f;
+	render_stats.num_layers = num_layers;
+	for (size_t i = 0u; i < num_layers; i++) {
+		render_layer_stats_type* const stats = &render_stats.layers[i];
+		stats->layer_index = layer_stats[i].layer_index;
+		stats->draws = layer_stats[i].stats.draws;
+		stats->instances = layer_stats[i].stats.instances;
+		stats->bytes = layer_stats[i].stats.bytes;
+	}
+
+	// The read back frame records which layers it drew in its zones, so
+	// layers' times are reported against the layers of that frame.
+	render_stats.num_gpu_layers = 0u;
+	if (gpu_timed) {
+		const size_t* zones;
+		const size_t num_zones = gpu_timer_results_zones(gpu_timer, &zones);
+		for (size_t i = 0u; i < num_zones && render_stats.num_gpu_layers < RENDER_STATS_LAYERS_MAX; i++) {
+			if (zones[i] == GPU_TIMER_ZONE_NONE || zones[i] < RENDER_ZONE_LAYER_FIRST) {
+				continue;
+			}
+			const size_t layer_index = zones[i] - RENDER_ZONE_LAYER_FIRST;
+			size_t j;
+			for (j = 0u; j < render_stats.num_gpu_layers && render_stats.gpu_layers[j].layer_index != layer_index; j++);
+			if (j < render_stats.num_gpu_layers) {
+				continue;
+			}
+			render_layer_gpu_stats_type* const stats = &render_stats.gpu_layers[render_stats.num_gpu_layers++];
+			stats->layer_index = layer_index;
+			stats->gpu_milliseconds = gpu_timer_zone_milliseconds(gpu_timer, zones[i]);
+			render_stats.layers_gpu_milliseconds += stats->gpu_milliseconds;
+		}
+	}
+	SDL_AtomicUnlock(&render_stats_lock);
+}
+
+/*
+ * Upscale the frame to the screen, if it was drawn at a dynamic resolution,
+ * leaving the screen's framebuffer bound even if drawing the frame failed.
+ */
+static bool resolution_finish() {
+	if (!resolution_active) {
+		return true;
+	}
+	opengl_group_push("upscale");
+	const bool upscaled = resolution_end(resolution, resolution_nearest);
+	opengl_group_pop();
+	return upscaled;
 }
 
 static bool render_end_draw_func(void* const state) {
-	if (!sprites_draw(sprites)) return false;
-	if (!layers_draw(layers)) return false;
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, RENDER_ZONE_SPRITES);
+	}
+	opengl_group_push("sprites");
+	const bool sprites_drawn = sprites_draw(sprites);
+	opengl_group_pop();
+	if (!sprites_drawn) {
+		resolution_finish();
+		resolution_active = false;
+		return false;
+	}
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, RENDER_ZONE_LAYERS);
+	}
+	opengl_group_push("layers");
+	const bool layers_drawn = layers_draw(layers);
+	opengl_group_pop();
+	if (!layers_drawn) {
+		resolution_finish();
+		resolution_active = false;
+		return false;
+	}
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, RENDER_ZONE_UPSCALE);
+	}
+	const bool upscaled = resolution_finish();
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, GPU_TIMER_ZONE_NONE);
+	}
 
-	return true;
+	render_stats_publish();
+	resolution_active = false;
+
+	batches_free(destroyed_batches);
+	destroyed_batches = NULL;
+	tilemaps_free(destroyed_tilemaps);
+	destroyed_tilemaps = NULL;
+	emitters_free(destroyed_emitters);
+	destroyed_emitters = NULL;
+
+	return upscaled;
 }
 
 bool render_end() {
+	if (capture_active()) {
+		bool done;
+		if (!capture_end(capture, &done)) {
+			capture_stop();
+		}
+		else if (done) {
+			capture_destroy(capture);
+			capture = NULL;
+			capture_framing = false;
+		}
+	}
+
 	static const command_funcs funcs = {
 		.update = NULL,
 		.draw = render_end_draw_func,
-		.destroy = NULL
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
 	};
 
-	return frames_enqueue_command(render_frames, &funcs, NULL);
+	return
+		frames_key_set(render_frames, UINT64_MAX) &&
+		frames_enqueue_command(render_frames, &funcs, NULL);
+}
+
+render_list_object* render_list_create() {
+	return (render_list_object*)frames_list_create(render_frames);
+}
+
+void render_list_destroy(render_list_object* const list) {
+	assert(list != NULL);
+
+	frames_list_destroy((frames_list_object*)list);
+}
+
+bool render_list_begin(render_list_object* const list, const uint64_t key) {
+	assert(list != NULL);
+	assert(key < UINT64_MAX);
+
+	return frames_list_begin((frames_list_object*)list, key);
+}
+
+bool render_list_end(render_list_object* const list) {
+	assert(list != NULL);
+
+	return frames_list_end((frames_list_object*)list);
+}
+
+bool render_order_set(const uint64_t key) {
+	return frames_key_set(render_frames, key);
 }
 
 static bool render_clear_draw_func(void* const state) {
 	const vecptr color = (vecptr)state;
 	glClearColor(color[0], color[1], color[2], color[3]);
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, RENDER_ZONE_CLEAR);
+	}
 	glClear(GL_COLOR_BUFFER_BIT);
+	if (gpu_timer != NULL) {
+		gpu_timer_timestamp(gpu_timer, GPU_TIMER_ZONE_NONE);
+	}
 
 	return true;
 }
 
-static void render_clear_destroy_func(void* const state) {
-	const vecptr color = state;
-	mem_free(color);
-}
-
 bool render_clear(const float red, const float green, const float blue, const float alpha) {
 	static const command_funcs funcs = {
 		.update = NULL,
 		.draw = render_clear_draw_func,
-		.destroy = render_clear_destroy_func
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
 	};
 
-	vecptr color = mem_malloc(sizeof(vec4));
+	vecptr color = frames_alloc(render_frames, sizeof(vec4));
 	if (color == NULL) {
 		return false;
 	}
@@ -201,150 +974,1489 @@ bool render_clear(const float red, const float green, const float blue, const fl
 	color[1] = green;
 	color[2] = blue;
 	color[3] = alpha;
+	frames_hash(render_frames, color, sizeof(vec4));
+	if (capture_active() && !capture_clear(capture, red, green, blue, alpha)) {
+		capture_stop();
+	}
 
 	return frames_enqueue_command(render_frames, &funcs, color);
 }
 
-typedef struct render_sprites_object {
-	const char* sheet_filename;
-	size_t layer_index;
-	size_t num_added;
-	sprite_type* added_sprites;
-} render_sprites_object;
+static render_handle handle_get(dict_object** const handles, const data_type type, const char* const filename) {
+	assert(filename != NULL);
 
-static bool render_sprites_update_func(void* const state) {
-	render_sprites_object* const s = state;
+	const size_t filename_size = strlen(filename);
+	render_handle handle = RENDER_HANDLE_NONE;
+	bool full = false;
+	SDL_AtomicLock(&handles_lock);
+	render_handle* found;
+	if (*handles != NULL && dict_get(*handles, filename, filename_size, (void**)&found, NULL)) {
+		handle = *found;
+	}
+	else if (*handles != NULL || (*handles = dict_create(64u)) != NULL) {
+		if (num_handles == RENDER_HANDLES_MAX) {
+			full = true;
+		}
+		else {
+			handle_slot_type* const slot = &handle_slots[num_handles];
+			slot->filename = alloc_sprintf("%s", filename);
+			if (slot->filename != NULL) {
+				slot->type = type;
+				slot->data = DATA_HANDLE_NONE;
 
-	const data_object* const data = data_cache_get(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, s->sheet_filename, NULL, false);
-	if (data == NULL) {
-		return false;
+				render_handle new_handle = (render_handle)(num_handles + 1u);
+				if (dict_set(*handles, filename, filename_size, &new_handle, sizeof(new_handle), NULL, NULL)) {
+					num_handles++;
+					handle = new_handle;
+				}
+				else {
+					mem_free(slot->filename);
+					slot->filename = NULL;
+				}
+			}
+		}
 	}
-	assert(s->layer_index < NUM_LAYERS);
-	const bool success = layers_sprites_add(layers, data->texture, s->layer_index, s->num_added, s->added_sprites);
-	mem_free(s->added_sprites);
-	mem_free(s);
-	return success;
+	SDL_AtomicUnlock(&handles_lock);
+	if (full) {
+		log_printf("Error: Too many sheets and fonts to get a handle for \"%s\"\n", filename);
+	}
+	return handle;
 }
 
-bool render_sprites(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites) {
-	assert(sheet_filename != NULL);
-	assert(added_sprites != NULL);
+render_handle render_sheet_handle_get(const char* const sheet_filename) {
+	return handle_get(&sheet_handles, DATA_TYPE_TEXTURE, sheet_filename);
+}
 
-	if (num_added == 0u) {
-		return true;
+render_handle render_font_handle_get(const char* const font_filename) {
+	return handle_get(&font_handles, DATA_TYPE_FONT, font_filename);
+}
+
+render_handle render_font_sdf_handle_get(const char* const font_filename) {
+	return handle_get(&sdf_font_handles, DATA_TYPE_FONT_SDF, font_filename);
+}
+
+static bool atlas_entry_release(void* const data) {
+	data_shared_release(prog_data_shared_get(), data);
+	return true;
+}
+
+/*
+ * Get an atlas, acquiring it from the shared data cache the first time it's
+ * looked up.
+ */
+static const data_object* atlas_get(const char* const atlas_filename) {
+	if (atlas_entries == NULL && (atlas_entries = dict_create(1u)) == NULL) {
+		return NULL;
 	}
 
-	render_sprites_object* const s = mem_malloc(sizeof(render_sprites_object));
-	if (s == NULL) {
-		return false;
+	data_shared_entry* entry;
+	if (dict_get(atlas_entries, atlas_filename, strlen(atlas_filename), (void**)&entry, NULL)) {
+		return data_shared_data_get(entry);
 	}
 
-	s->sheet_filename = sheet_filename;
-	s->layer_index = layer_index;
-	s->num_added = num_added;
-	s->added_sprites = mem_malloc(sizeof(sprite_type) * num_added);
-	if (s->added_sprites == NULL) {
-		mem_free(s);
-		return false;
+	data_load_status status;
+	entry = data_shared_acquire(prog_data_shared_get(), DATA_TYPE_ATLAS, DATA_PATH_RESOURCE, atlas_filename, &status);
+	if (entry == NULL) {
+		return NULL;
 	}
-	memcpy(s->added_sprites, added_sprites, sizeof(sprite_type) * num_added);
+	if (!dict_set(atlas_entries, atlas_filename, strlen(atlas_filename), entry, sizeof(data_shared_entry*), atlas_entry_release, NULL)) {
+		data_shared_release(prog_data_shared_get(), entry);
+		return NULL;
+	}
+	return data_shared_data_get(entry);
+}
+
+bool render_atlas_sprite_get(const char* const atlas_filename, const char* const name, render_handle* const sheet, vec4 src) {
+	assert(atlas_filename != NULL);
+	assert(name != NULL);
+	assert(sheet != NULL);
+	assert(src != NULL);
+
+	const data_object* const data = atlas_get(atlas_filename);
+	if (data == NULL) {
+		return false;
+	}
+	const data_atlas_sprite* const sprite = data_atlas_sprite_get(data->atlas, name);
+	if (sprite == NULL) {
+		log_printf("Error: Atlas \"%s\" has no sprite \"%s\"\n", atlas_filename, name);
+		return false;
+	}
+
+	*sheet = render_sheet_handle_get(data->atlas->sheet_filenames[sprite->sheet]);
+	if (*sheet == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	vec4_copy(src, sprite->src);
+	return true;
+}
+
+/*
+ * Get the data of a handle, interning it into the data cache the first time.
+ * If load is false and the data isn't cached, NULL is returned.
+ */
+static const data_object* handle_data_get(const render_handle handle, const bool load) {
+	assert(handle != RENDER_HANDLE_NONE && handle <= RENDER_HANDLES_MAX);
+
+	handle_slot_type* const slot = &handle_slots[handle - 1u];
+	if (slot->data == DATA_HANDLE_NONE) {
+		slot->data = data_cache_intern(data_cache, slot->type, DATA_PATH_RESOURCE, slot->filename);
+		if (slot->data == DATA_HANDLE_NONE) {
+			return NULL;
+		}
+	}
+	return data_cache_handle_get(data_cache, slot->data, NULL, load);
+}
+
+/*
+ * Get the texture of a sheet, loading it synchronously if it isn't cached. If
+ * the sheet is still being loaded asynchronously, the texture is NULL, without
+ * failing, so the sheet's sprites are skipped.
+ */
+static bool sheet_get(const render_handle sheet, data_texture_object** const texture) {
+	const data_object* data = handle_data_get(sheet, false);
+	if (data == NULL) {
+		if (texture_loader != NULL && texture_loader_pending(texture_loader, handle_slots[sheet - 1u].filename)) {
+			// The sprites will be drawn once the sheet is loaded, changing
+			// the image, even if the frames don't change.
+			frames_redraw(render_frames);
+			*texture = NULL;
+			return true;
+		}
+
+		data = handle_data_get(sheet, true);
+		if (data == NULL) {
+			return false;
+		}
+	}
+	*texture = data->texture;
+	return true;
+}
+
+/*
+ * Hash what a command of sprites draws, for idle frame detection.
+ */
+static void sprites_hash(const render_handle sheet, const size_t layer_index, const void* const added_sprites, const size_t size) {
+	frames_hash(render_frames, &sheet, sizeof(sheet));
+	frames_hash(render_frames, &layer_index, sizeof(layer_index));
+	frames_hash(render_frames, added_sprites, size);
+}
+
+typedef struct render_sprites_object {
+	render_handle sheet;
+	size_t layer_index;
+	size_t num_reserved;
+	size_t num_added;
+	sprite_type added_sprites[];
+} render_sprites_object;
+
+static bool render_sprites_update_func(void* const state) {
+	render_sprites_object* const s = state;
+
+	data_texture_object* texture;
+	if (!sheet_get(s->sheet, &texture)) {
+		return false;
+	}
+	else if (texture == NULL) {
+		return true;
+	}
+	assert(s->layer_index < RENDER_LAYERS_MAX);
+
+	/*
+	 * The sprites are in frame memory, which stays valid until after the
+	 * frame has been drawn, so the layer can just reference them, after
+	 * culling them in place.
+	 */
+	if (cull_enabled) {
+		vec4 bounds;
+		layers_camera_bounds_get(layers, s->layer_index, cull_bounds, bounds);
+		const size_t num_visible = cull_sprites(s->added_sprites, s->num_added, bounds);
+		num_culled += s->num_added - num_visible;
+		s->num_added = num_visible;
+		if (num_visible == 0u) {
+			return true;
+		}
+	}
+	return layers_sprites_reference(layers, texture, s->layer_index, s->num_added, s->added_sprites);
+}
+
+sprite_type* render_sprites_reserve(const char* const sheet_filename, const size_t layer_index, const size_t num_reserved) {
+	assert(sheet_filename != NULL);
+
+	const render_handle sheet = render_sheet_handle_get(sheet_filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return NULL;
+	}
+	return render_sprites_reserve_handle(sheet, layer_index, num_reserved);
+}
+
+sprite_type* render_sprites_reserve_handle(const render_handle sheet, const size_t layer_index, const size_t num_reserved) {
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(num_reserved > 0u);
+	assert(num_reserved <= (SIZE_MAX - sizeof(render_sprites_object)) / sizeof(sprite_type));
+
+	render_sprites_object* const s = frames_alloc(render_frames, sizeof(render_sprites_object) + sizeof(sprite_type) * num_reserved);
+	if (s == NULL) {
+		return NULL;
+	}
+
+	s->sheet = sheet;
+	s->layer_index = layer_index;
+	s->num_reserved = num_reserved;
+	s->num_added = 0u;
+
+	return s->added_sprites;
+}
+
+bool render_sprites_commit(sprite_type* const reserved_sprites, const size_t num_committed) {
+	assert(reserved_sprites != NULL);
+
+	render_sprites_object* const s = (render_sprites_object*)((unsigned char*)reserved_sprites - offsetof(render_sprites_object, added_sprites));
+	assert(num_committed <= s->num_reserved);
+
+	if (num_committed == 0u) {
+		return true;
+	}
+	s->num_added = num_committed;
+	sprites_hash(s->sheet, s->layer_index, s->added_sprites, sizeof(sprite_type) * num_committed);
+	if (capture_active() && (
+		!capture_handle_define(s->sheet) ||
+		!capture_sprites(capture, CAPTURE_RECORD_SPRITES, s->sheet, s->layer_index, num_committed, s->added_sprites, sizeof(sprite_type))
+	)) {
+		capture_stop();
+	}
+
+	static const command_funcs funcs = {
+		.update = render_sprites_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+bool render_sprites(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites) {
+	assert(sheet_filename != NULL);
+
+	const render_handle sheet = render_sheet_handle_get(sheet_filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	return render_sprites_handle(sheet, layer_index, num_added, added_sprites);
+}
+
+bool render_sprites_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites) {
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(added_sprites != NULL);
+
+	if (num_added == 0u) {
+		return true;
+	}
+
+	sprite_type* const reserved_sprites = render_sprites_reserve_handle(sheet, layer_index, num_added);
+	if (reserved_sprites == NULL) {
+		return false;
+	}
+	memcpy(reserved_sprites, added_sprites, sizeof(sprite_type) * num_added);
+
+	return render_sprites_commit(reserved_sprites, num_added);
+}
+
+typedef struct render_tracked_sprites_object {
+	render_handle sheet;
+	size_t layer_index;
+	size_t num_added;
+	bool resolved;
+	uint32_t* ids;
+	vec4* from;
+	sprite_type* drawn;
+	sprite_type added_sprites[];
+} render_tracked_sprites_object;
+
+static bool render_tracked_sprites_update_func(void* const state) {
+	render_tracked_sprites_object* const s = state;
+
+	/*
+	 * The sprites are recorded for the next tick even if their sheet is still
+	 * loading, so they're interpolated from here once it's loaded.
+	 */
+	if (!s->resolved) {
+		if (interp == NULL || !interp_resolve(interp, s->num_added, s->ids, s->added_sprites, s->from)) {
+			for (size_t i = 0u; i < s->num_added; i++) {
+				memcpy(s->from[i], s->added_sprites[i].dst, sizeof(vec4));
+			}
+		}
+		s->resolved = true;
+	}
+
+	data_texture_object* texture;
+	if (!sheet_get(s->sheet, &texture)) {
+		return false;
+	}
+	else if (texture == NULL) {
+		return true;
+	}
+	assert(s->layer_index < RENDER_LAYERS_MAX);
+
+	/*
+	 * The blended sprites are rewritten each time the frame is drawn, so they
+	 * can be culled in place.
+	 */
+	interp_blend(s->num_added, s->added_sprites, s->from, interp_alpha, s->drawn);
+	size_t num_drawn = s->num_added;
+	if (cull_enabled) {
+		vec4 bounds;
+		layers_camera_bounds_get(layers, s->layer_index, cull_bounds, bounds);
+		num_drawn = cull_sprites(s->drawn, s->num_added, bounds);
+		num_culled += s->num_added - num_drawn;
+		if (num_drawn == 0u) {
+			return true;
+		}
+	}
+	return layers_sprites_reference(layers, texture, s->layer_index, num_drawn, s->drawn);
+}
+
+bool render_sprites_tracked(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites, const uint32_t* const ids) {
+	assert(sheet_filename != NULL);
+
+	const render_handle sheet = render_sheet_handle_get(sheet_filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	return render_sprites_tracked_handle(sheet, layer_index, num_added, added_sprites, ids);
+}
+
+bool render_sprites_tracked_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites, const uint32_t* const ids) {
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(added_sprites != NULL);
+	assert(ids != NULL);
+	assert(num_added <= (SIZE_MAX - sizeof(render_tracked_sprites_object)) / (sizeof(sprite_type) * 2u + sizeof(vec4) + sizeof(uint32_t)));
+
+	if (num_added == 0u) {
+		return true;
+	}
+
+	render_tracked_sprites_object* const s = frames_alloc(render_frames, sizeof(render_tracked_sprites_object) + sizeof(sprite_type) * num_added);
+	vec4* const from = frames_alloc(render_frames, sizeof(vec4) * num_added);
+	sprite_type* const drawn = frames_alloc(render_frames, sizeof(sprite_type) * num_added);
+	uint32_t* const ids_copy = frames_alloc(render_frames, sizeof(uint32_t) * num_added);
+	if (s == NULL || from == NULL || drawn == NULL || ids_copy == NULL) {
+		return false;
+	}
+
+	s->sheet = sheet;
+	s->layer_index = layer_index;
+	s->num_added = num_added;
+	s->resolved = false;
+	s->ids = ids_copy;
+	s->from = from;
+	s->drawn = drawn;
+	memcpy(s->added_sprites, added_sprites, sizeof(sprite_type) * num_added);
+	memcpy(ids_copy, ids, sizeof(uint32_t) * num_added);
+	sprites_hash(sheet, layer_index, added_sprites, sizeof(sprite_type) * num_added);
+	frames_hash(render_frames, ids, sizeof(uint32_t) * num_added);
+	// Replayed frames aren't interpolated, so tracked sprites are captured as
+	// plain sprites.
+	if (capture_active() && (
+		!capture_handle_define(sheet) ||
+		!capture_sprites(capture, CAPTURE_RECORD_SPRITES, sheet, layer_index, num_added, added_sprites, sizeof(sprite_type))
+	)) {
+		capture_stop();
+	}
+
+	static const command_funcs funcs = {
+		.update = render_tracked_sprites_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+typedef struct render_layer_sheet_sorted_object {
+	size_t layer_index;
+	bool sheet_sorted;
+} render_layer_sheet_sorted_object;
+
+static bool render_layer_sheet_sorted_update_func(void* const state) {
+	const render_layer_sheet_sorted_object* const s = state;
+
+	return layers_sheet_sorted_set(layers, s->layer_index, s->sheet_sorted);
+}
+
+bool render_layer_sheet_sorted_set(const size_t layer_index, const bool sheet_sorted) {
+	assert(layer_index < RENDER_LAYERS_MAX);
+
+	render_layer_sheet_sorted_object* const s = frames_alloc(render_frames, sizeof(render_layer_sheet_sorted_object));
+	if (s == NULL) {
+		return false;
+	}
+	s->layer_index = layer_index;
+	s->sheet_sorted = sheet_sorted;
+
+	static const command_funcs funcs = {
+		.update = render_layer_sheet_sorted_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+typedef struct render_layer_cached_object {
+	size_t layer_index;
+	bool cached;
+} render_layer_cached_object;
+
+static bool render_layer_cached_update_func(void* const state) {
+	const render_layer_cached_object* const s = state;
+
+	return layers_cached_set(layers, s->layer_index, s->cached);
+}
+
+bool render_layer_cached_set(const size_t layer_index, const bool cached) {
+	assert(layer_index < RENDER_LAYERS_MAX);
+
+	render_layer_cached_object* const s = frames_alloc(render_frames, sizeof(render_layer_cached_object));
+	if (s == NULL) {
+		return false;
+	}
+	s->layer_index = layer_index;
+	s->cached = cached;
+
+	static const command_funcs funcs = {
+		.update = render_layer_cached_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+typedef struct render_layer_camera_object {
+	size_t layer_index;
+	bool has_camera;
+	camera_type camera;
+} render_layer_camera_object;
+
+static bool render_layer_camera_update_func(void* const state) {
+	const render_layer_camera_object* const s = state;
+
+	return layers_camera_set(layers, s->layer_index, s->has_camera ? &s->camera : NULL);
+}
+
+bool render_layer_camera_set(const size_t layer_index, const camera_type* const camera) {
+	assert(layer_index < RENDER_LAYERS_MAX);
+
+	render_layer_camera_object* const s = frames_alloc(render_frames, sizeof(render_layer_camera_object));
+	if (s == NULL) {
+		return false;
+	}
+	s->layer_index = layer_index;
+	s->has_camera = camera != NULL;
+	if (camera != NULL) {
+		s->camera = *camera;
+	}
+	if (capture_active() && !capture_camera(capture, layer_index, camera)) {
+		capture_stop();
+	}
+
+	static const command_funcs funcs = {
+		.update = render_layer_camera_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+static bool render_layer_invalidate_update_func(void* const state) {
+	layers_invalidate(layers, *(const size_t*)state);
+
+	return true;
+}
+
+bool render_layer_invalidate(const size_t layer_index) {
+	assert(layer_index < RENDER_LAYERS_MAX);
+
+	size_t* const s = frames_alloc(render_frames, sizeof(size_t));
+	if (s == NULL) {
+		return false;
+	}
+	*s = layer_index;
+
+	static const command_funcs funcs = {
+		.update = render_layer_invalidate_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+typedef struct render_packed_sprites_object {
+	render_handle sheet;
+	size_t layer_index;
+	size_t num_added;
+	packed_sprite_type added_sprites[];
+} render_packed_sprites_object;
+
+static bool render_packed_sprites_update_func(void* const state) {
+	render_packed_sprites_object* const s = state;
+
+	data_texture_object* texture;
+	if (!sheet_get(s->sheet, &texture)) {
+		return false;
+	}
+	else if (texture == NULL) {
+		return true;
+	}
+	assert(s->layer_index < RENDER_LAYERS_MAX);
+
+	if (cull_enabled) {
+		vec4 bounds;
+		layers_camera_bounds_get(layers, s->layer_index, cull_bounds, bounds);
+		const size_t num_visible = cull_packed_sprites(s->added_sprites, s->num_added, bounds);
+		num_culled += s->num_added - num_visible;
+		s->num_added = num_visible;
+		if (num_visible == 0u) {
+			return true;
+		}
+	}
+	return layers_packed_sprites_reference(layers, texture, s->layer_index, s->num_added, s->added_sprites);
+}
+
+bool render_packed_sprites(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const packed_sprite_type* const added_sprites) {
+	assert(sheet_filename != NULL);
+
+	const render_handle sheet = render_sheet_handle_get(sheet_filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	return render_packed_sprites_handle(sheet, layer_index, num_added, added_sprites);
+}
+
+bool render_packed_sprites_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const packed_sprite_type* const added_sprites) {
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(added_sprites != NULL);
+	assert(num_added <= (SIZE_MAX - sizeof(render_packed_sprites_object)) / sizeof(packed_sprite_type));
+
+	if (num_added == 0u) {
+		return true;
+	}
+
+	render_packed_sprites_object* const s = frames_alloc(render_frames, sizeof(render_packed_sprites_object) + sizeof(packed_sprite_type) * num_added);
+	if (s == NULL) {
+		return false;
+	}
+
+	s->sheet = sheet;
+	s->layer_index = layer_index;
+	s->num_added = num_added;
+	memcpy(s->added_sprites, added_sprites, sizeof(packed_sprite_type) * num_added);
+	sprites_hash(sheet, layer_index, added_sprites, sizeof(packed_sprite_type) * num_added);
+	if (capture_active() && (
+		!capture_handle_define(sheet) ||
+		!capture_sprites(capture, CAPTURE_RECORD_PACKED_SPRITES, sheet, layer_index, num_added, added_sprites, sizeof(packed_sprite_type))
+	)) {
+		capture_stop();
+	}
+
+	static const command_funcs funcs = {
+		.update = render_packed_sprites_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+typedef struct render_sprites_ex_object {
+	render_handle sheet;
+	size_t layer_index;
+	size_t num_added;
+	sprite_ex_type added_sprites[];
+} render_sprites_ex_object;
+
+static bool render_sprites_ex_update_func(void* const state) {
+	render_sprites_ex_object* const s = state;
+
+	data_texture_object* texture;
+	if (!sheet_get(s->sheet, &texture)) {
+		return false;
+	}
+	else if (texture == NULL) {
+		return true;
+	}
+	assert(s->layer_index < RENDER_LAYERS_MAX);
+
+	if (cull_enabled) {
+		vec4 bounds;
+		layers_camera_bounds_get(layers, s->layer_index, cull_bounds, bounds);
+		const size_t num_visible = cull_sprites_ex(s->added_sprites, s->num_added, bounds);
+		num_culled += s->num_added - num_visible;
+		s->num_added = num_visible;
+		if (num_visible == 0u) {
+			return true;
+		}
+	}
+	return layers_sprites_ex_reference(layers, texture, s->layer_index, s->num_added, s->added_sprites);
+}
+
+bool render_sprites_ex(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_ex_type* const added_sprites) {
+	assert(sheet_filename != NULL);
+
+	const render_handle sheet = render_sheet_handle_get(sheet_filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	return render_sprites_ex_handle(sheet, layer_index, num_added, added_sprites);
+}
+
+bool render_sprites_ex_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_ex_type* const added_sprites) {
+	assert(sheet != RENDER_HANDLE_NONE);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(added_sprites != NULL);
+	assert(num_added <= (SIZE_MAX - sizeof(render_sprites_ex_object)) / sizeof(sprite_ex_type));
+
+	if (num_added == 0u) {
+		return true;
+	}
+
+	render_sprites_ex_object* const s = frames_alloc(render_frames, sizeof(render_sprites_ex_object) + sizeof(sprite_ex_type) * num_added);
+	if (s == NULL) {
+		return false;
+	}
+
+	s->sheet = sheet;
+	s->layer_index = layer_index;
+	s->num_added = num_added;
+	memcpy(s->added_sprites, added_sprites, sizeof(sprite_ex_type) * num_added);
+	sprites_hash(sheet, layer_index, added_sprites, sizeof(sprite_ex_type) * num_added);
+	if (capture_active() && (
+		!capture_handle_define(sheet) ||
+		!capture_sprites(capture, CAPTURE_RECORD_SPRITES_EX, sheet, layer_index, num_added, added_sprites, sizeof(sprite_ex_type))
+	)) {
+		capture_stop();
+	}
+
+	static const command_funcs funcs = {
+		.update = render_sprites_ex_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, s);
+}
+
+static void render_texture_load_done(void* const data, const bool success) {
+	render_texture_load_object* const load = data;
+
+	SDL_AtomicSet(&load->status, success ? RENDER_TEXTURE_LOAD_RESIDENT : RENDER_TEXTURE_LOAD_FAILED);
+	if (SDL_AtomicDecRef(&load->refs)) {
+		mem_free(load);
+	}
+}
+
+static bool render_texture_load_update_func(void* const state) {
+	render_texture_load_object* const load = state;
+
+	if (data_cache_contains(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, load->sheet_filename)) {
+		render_texture_load_done(load, true);
+		return true;
+	}
+	else if (texture_loader == NULL) {
+		const data_object* const data = data_cache_get(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, load->sheet_filename, NULL, false);
+		render_texture_load_done(load, data != NULL);
+		return true;
+	}
+	else if (!texture_loader_load(texture_loader, load->sheet_filename, render_texture_load_done, load)) {
+		render_texture_load_done(load, false);
+		return false;
+	}
+
+	return true;
+}
+
+render_texture_load_object* render_texture_load(const char* const sheet_filename) {
+	assert(sheet_filename != NULL);
+
+	render_texture_load_object* const load = mem_malloc(sizeof(render_texture_load_object));
+	if (load == NULL) {
+		return NULL;
+	}
+	load->sheet_filename = sheet_filename;
+	SDL_AtomicSet(&load->status, RENDER_TEXTURE_LOAD_PENDING);
+	SDL_AtomicSet(&load->refs, 2);
+
+	static const command_funcs funcs = {
+		.update = render_texture_load_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	if (!frames_enqueue_command(render_frames, &funcs, load)) {
+		mem_free(load);
+		return NULL;
+	}
+
+	return load;
+}
+
+render_texture_load_status render_texture_load_status_get(render_texture_load_object* const load) {
+	assert(load != NULL);
+
+	return (render_texture_load_status)SDL_AtomicGet(&load->status);
+}
+
+void render_texture_load_release(render_texture_load_object* const load) {
+	assert(load != NULL);
+
+	if (SDL_AtomicDecRef(&load->refs)) {
+		mem_free(load);
+	}
+}
+
+typedef struct render_batch_create_object {
+	render_batch_object* batch;
+	const char* sheet_filename;
+	sprite_type sprites[];
+} render_batch_create_object;
+
+static bool render_batch_create_update_func(void* const state) {
+	render_batch_create_object* const c = state;
+
+	const data_object* const data = data_cache_get(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, c->sheet_filename, NULL, false);
+	if (data == NULL) {
+		return false;
+	}
+
+	c->batch->batch = sprites_batch_create(layers_format, texture_array, data->texture, c->batch->num_sprites, c->sprites);
+	if (c->batch->batch == NULL) {
+		return false;
+	}
+	c->batch->sheet = data;
+	data_cache_pin(data);
+
+	c->batch->prev = NULL;
+	c->batch->next = live_batches;
+	if (live_batches != NULL) {
+		live_batches->prev = c->batch;
+	}
+	live_batches = c->batch;
+
+	return true;
+}
+
+render_batch_object* render_batch_create(const char* const sheet_filename, const size_t layer_index, const size_t num_sprites, const sprite_type* const batch_sprites) {
+	assert(sheet_filename != NULL);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(num_sprites == 0u || batch_sprites != NULL);
+	assert(num_sprites <= (SIZE_MAX - sizeof(render_batch_create_object)) / sizeof(sprite_type));
+
+	render_batch_create_object* const c = frames_alloc(render_frames, sizeof(render_batch_create_object) + sizeof(sprite_type) * num_sprites);
+	if (c == NULL) {
+		return NULL;
+	}
+
+	render_batch_object* const batch = mem_malloc(sizeof(render_batch_object));
+	if (batch == NULL) {
+		return NULL;
+	}
+	batch->layer_index = layer_index;
+	batch->num_sprites = num_sprites;
+	batch->sheet = NULL;
+	batch->batch = NULL;
+	batch->prev = NULL;
+	batch->next = NULL;
+
+	c->batch = batch;
+	c->sheet_filename = sheet_filename;
+	if (num_sprites > 0u) {
+		memcpy(c->sprites, batch_sprites, sizeof(sprite_type) * num_sprites);
+	}
+
+	static const command_funcs funcs = {
+		.update = render_batch_create_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	if (!frames_enqueue_command(render_frames, &funcs, c)) {
+		mem_free(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+typedef struct render_batch_update_object {
+	render_batch_object* batch;
+	size_t start;
+	size_t num_updated;
+	sprite_type sprites[];
+} render_batch_update_object;
+
+static bool render_batch_update_update_func(void* const state) {
+	render_batch_update_object* const u = state;
+	if (u->batch->batch == NULL) {
+		log_printf("Error: Updating a batch that failed to be created\n");
+		return false;
+	}
+
+	return sprites_batch_update(u->batch->batch, u->start, u->num_updated, u->sprites);
+}
+
+bool render_batch_update(render_batch_object* const batch, const size_t start, const size_t num_updated, const sprite_type* const updated_sprites) {
+	assert(batch != NULL);
+	assert(start <= batch->num_sprites);
+	assert(num_updated <= batch->num_sprites - start);
+	assert(num_updated == 0u || updated_sprites != NULL);
+
+	if (num_updated == 0u) {
+		return true;
+	}
+
+	render_batch_update_object* const u = frames_alloc(render_frames, sizeof(render_batch_update_object) + sizeof(sprite_type) * num_updated);
+	if (u == NULL) {
+		return false;
+	}
+
+	u->batch = batch;
+	u->start = start;
+	u->num_updated = num_updated;
+	memcpy(u->sprites, updated_sprites, sizeof(sprite_type) * num_updated);
 
 	static const command_funcs funcs = {
-		.update = render_sprites_update_func,
+		.update = render_batch_update_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, u);
+}
+
+static bool render_batch_destroy_update_func(void* const state) {
+	render_batch_object* const batch = state;
+
+	if (batch->prev != NULL) {
+		batch->prev->next = batch->next;
+	}
+	else if (live_batches == batch) {
+		live_batches = batch->next;
+	}
+	if (batch->next != NULL) {
+		batch->next->prev = batch->prev;
+	}
+
+	batch->prev = NULL;
+	batch->next = destroyed_batches;
+	destroyed_batches = batch;
+
+	return true;
+}
+
+bool render_batch_destroy(render_batch_object* const batch) {
+	assert(batch != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_batch_destroy_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, batch);
+}
+
+static bool render_batch_draw_update_func(void* const state) {
+	render_batch_object* const batch = state;
+	if (batch->batch == NULL) {
+		log_printf("Error: Drawing a batch that failed to be created\n");
+		return false;
+	}
+
+	return layers_batch_add(layers, batch->layer_index, batch->batch);
+}
+
+bool render_batch_draw(render_batch_object* const batch) {
+	assert(batch != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_batch_draw_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	// Batches only change through commands that aren't stateless, so frames
+	// changing a batch are never idle, and the batch is hashed by identity.
+	frames_hash(render_frames, &batch, sizeof(batch));
+
+	return frames_enqueue_command(render_frames, &funcs, batch);
+}
+
+typedef struct render_tilemap_create_object {
+	render_tilemap_object* tilemap;
+	const char* sheet_filename;
+	float tile_width;
+	float tile_height;
+	bool has_tiles;
+	uint16_t tiles[];
+} render_tilemap_create_object;
+
+static bool render_tilemap_create_update_func(void* const state) {
+	render_tilemap_create_object* const c = state;
+
+	if (tilemaps == NULL) {
+		return false;
+	}
+
+	const data_object* const data = data_cache_get(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, c->sheet_filename, NULL, false);
+	if (data == NULL) {
+		return false;
+	}
+
+	c->tilemap->tilemap = tilemap_create(tilemaps, data->texture, c->tilemap->width, c->tilemap->height, c->tile_width, c->tile_height, c->has_tiles ? c->tiles : NULL);
+	if (c->tilemap->tilemap == NULL) {
+		return false;
+	}
+	c->tilemap->sheet = data;
+	data_cache_pin(data);
+
+	c->tilemap->prev = NULL;
+	c->tilemap->next = live_tilemaps;
+	if (live_tilemaps != NULL) {
+		live_tilemaps->prev = c->tilemap;
+	}
+	live_tilemaps = c->tilemap;
+
+	return true;
+}
+
+render_tilemap_object* render_tilemap_create(const char* const sheet_filename, const size_t layer_index, const size_t width, const size_t height, const float tile_width, const float tile_height, const uint16_t* const tiles) {
+	assert(sheet_filename != NULL);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(width > 0u && height > 0u);
+	assert(tile_width > 0.0f && tile_height > 0.0f);
+	assert(tiles == NULL || width <= (SIZE_MAX - sizeof(render_tilemap_create_object)) / sizeof(uint16_t) / height);
+
+	const size_t tiles_size = tiles != NULL ? sizeof(uint16_t) * width * height : 0u;
+	render_tilemap_create_object* const c = frames_alloc(render_frames, sizeof(render_tilemap_create_object) + tiles_size);
+	if (c == NULL) {
+		return NULL;
+	}
+
+	render_tilemap_object* const tilemap = mem_malloc(sizeof(render_tilemap_object));
+	if (tilemap == NULL) {
+		return NULL;
+	}
+	tilemap->layer_index = layer_index;
+	tilemap->width = width;
+	tilemap->height = height;
+	tilemap->sheet = NULL;
+	tilemap->tilemap = NULL;
+	tilemap->prev = NULL;
+	tilemap->next = NULL;
+
+	c->tilemap = tilemap;
+	c->sheet_filename = sheet_filename;
+	c->tile_width = tile_width;
+	c->tile_height = tile_height;
+	c->has_tiles = tiles != NULL;
+	if (tiles != NULL) {
+		memcpy(c->tiles, tiles, tiles_size);
+	}
+
+	static const command_funcs funcs = {
+		.update = render_tilemap_create_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	if (!frames_enqueue_command(render_frames, &funcs, c)) {
+		mem_free(tilemap);
+		return NULL;
+	}
+
+	return tilemap;
+}
+
+typedef struct render_tilemap_update_object {
+	render_tilemap_object* tilemap;
+	size_t x;
+	size_t y;
+	size_t width;
+	size_t height;
+	uint16_t tiles[];
+} render_tilemap_update_object;
+
+static bool render_tilemap_update_update_func(void* const state) {
+	render_tilemap_update_object* const u = state;
+	assert(u->tilemap->tilemap != NULL);
+
+	tilemap_update(u->tilemap->tilemap, u->x, u->y, u->width, u->height, u->tiles);
+	return true;
+}
+
+bool render_tilemap_update(render_tilemap_object* const tilemap, const size_t x, const size_t y, const size_t width, const size_t height, const uint16_t* const tiles) {
+	assert(tilemap != NULL);
+	assert(x <= tilemap->width && width <= tilemap->width - x);
+	assert(y <= tilemap->height && height <= tilemap->height - y);
+	assert(width == 0u || height == 0u || tiles != NULL);
+
+	if (width == 0u || height == 0u) {
+		return true;
+	}
+
+	render_tilemap_update_object* const u = frames_alloc(render_frames, sizeof(render_tilemap_update_object) + sizeof(uint16_t) * width * height);
+	if (u == NULL) {
+		return false;
+	}
+
+	u->tilemap = tilemap;
+	u->x = x;
+	u->y = y;
+	u->width = width;
+	u->height = height;
+	memcpy(u->tiles, tiles, sizeof(uint16_t) * width * height);
+
+	static const command_funcs funcs = {
+		.update = render_tilemap_update_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, u);
+}
+
+static bool render_tilemap_destroy_update_func(void* const state) {
+	render_tilemap_object* const tilemap = state;
+
+	if (tilemap->prev != NULL) {
+		tilemap->prev->next = tilemap->next;
+	}
+	else if (live_tilemaps == tilemap) {
+		live_tilemaps = tilemap->next;
+	}
+	if (tilemap->next != NULL) {
+		tilemap->next->prev = tilemap->prev;
+	}
+
+	tilemap->prev = NULL;
+	tilemap->next = destroyed_tilemaps;
+	destroyed_tilemaps = tilemap;
+
+	return true;
+}
+
+bool render_tilemap_destroy(render_tilemap_object* const tilemap) {
+	assert(tilemap != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_tilemap_destroy_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, tilemap);
+}
+
+static bool render_tilemap_draw_update_func(void* const state) {
+	render_tilemap_object* const tilemap = state;
+	assert(tilemap->tilemap != NULL);
+
+	/*
+	 * Only the tiles visible through the layer's camera are drawn, so the
+	 * cost of drawing a tilemap doesn't grow with its size.
+	 */
+	vec4 bounds;
+	layers_camera_bounds_get(layers, tilemap->layer_index, cull_bounds, bounds);
+	return layers_tilemap_add(layers, tilemap->layer_index, tilemap->tilemap, bounds);
+}
+
+bool render_tilemap_draw(render_tilemap_object* const tilemap) {
+	assert(tilemap != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_tilemap_draw_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	// Like batches, tilemaps only change through commands that aren't
+	// stateless, so the tilemap is hashed by identity.
+	frames_hash(render_frames, &tilemap, sizeof(tilemap));
+
+	return frames_enqueue_command(render_frames, &funcs, tilemap);
+}
+
+typedef struct render_emitter_create_object {
+	render_emitter_object* emitter;
+	const char* sheet_filename;
+	size_t capacity;
+} render_emitter_create_object;
+
+static bool render_emitter_create_update_func(void* const state) {
+	render_emitter_create_object* const c = state;
+
+	if (particles == NULL) {
+		return false;
+	}
+
+	const data_object* const data = data_cache_get(data_cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, c->sheet_filename, NULL, false);
+	if (data == NULL) {
+		return false;
+	}
+
+	c->emitter->emitter = emitter_create(particles, data->texture, c->capacity);
+	if (c->emitter->emitter == NULL) {
+		return false;
+	}
+	c->emitter->sheet = data;
+	data_cache_pin(data);
+
+	c->emitter->prev = NULL;
+	c->emitter->next = live_emitters;
+	if (live_emitters != NULL) {
+		live_emitters->prev = c->emitter;
+	}
+	live_emitters = c->emitter;
+
+	return true;
+}
+
+render_emitter_object* render_emitter_create(const char* const sheet_filename, const size_t layer_index, const size_t capacity) {
+	assert(sheet_filename != NULL);
+	assert(layer_index < RENDER_LAYERS_MAX);
+	assert(capacity > 0u);
+
+	render_emitter_create_object* const c = frames_alloc(render_frames, sizeof(render_emitter_create_object));
+	if (c == NULL) {
+		return NULL;
+	}
+
+	render_emitter_object* const emitter = mem_malloc(sizeof(render_emitter_object));
+	if (emitter == NULL) {
+		return NULL;
+	}
+	emitter->layer_index = layer_index;
+	emitter->sheet = NULL;
+	emitter->emitter = NULL;
+	emitter->prev = NULL;
+	emitter->next = NULL;
+
+	c->emitter = emitter;
+	c->sheet_filename = sheet_filename;
+	c->capacity = capacity;
+
+	static const command_funcs funcs = {
+		.update = render_emitter_create_update_func,
 		.draw = NULL,
-		.destroy = NULL
+		.destroy = NULL,
+		.stateless = false
 	};
 
-	if (!frames_enqueue_command(render_frames, &funcs, s)) {
-		mem_free(s->added_sprites);
-		mem_free(s);
+	if (!frames_enqueue_command(render_frames, &funcs, c)) {
+		mem_free(emitter);
+		return NULL;
+	}
+
+	return emitter;
+}
+
+typedef struct render_emitter_update_object {
+	render_emitter_object* emitter;
+	emitter_type params;
+} render_emitter_update_object;
+
+static bool render_emitter_update_update_func(void* const state) {
+	render_emitter_update_object* const u = state;
+	assert(u->emitter->emitter != NULL);
+
+	return emitter_step(u->emitter->emitter, &u->params);
+}
+
+bool render_emitter_update(render_emitter_object* const emitter, const emitter_type* const params) {
+	assert(emitter != NULL);
+	assert(params != NULL);
+
+	render_emitter_update_object* const u = frames_alloc(render_frames, sizeof(render_emitter_update_object));
+	if (u == NULL) {
 		return false;
 	}
 
+	u->emitter = emitter;
+	u->params = *params;
+
+	static const command_funcs funcs = {
+		.update = render_emitter_update_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, u);
+}
+
+static bool render_emitter_destroy_update_func(void* const state) {
+	render_emitter_object* const emitter = state;
+
+	if (emitter->prev != NULL) {
+		emitter->prev->next = emitter->next;
+	}
+	else if (live_emitters == emitter) {
+		live_emitters = emitter->next;
+	}
+	if (emitter->next != NULL) {
+		emitter->next->prev = emitter->prev;
+	}
+
+	emitter->prev = NULL;
+	emitter->next = destroyed_emitters;
+	destroyed_emitters = emitter;
+
 	return true;
 }
 
+bool render_emitter_destroy(render_emitter_object* const emitter) {
+	assert(emitter != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_emitter_destroy_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = false
+	};
+
+	return frames_enqueue_command(render_frames, &funcs, emitter);
+}
+
+static bool render_emitter_draw_update_func(void* const state) {
+	render_emitter_object* const emitter = state;
+	assert(emitter->emitter != NULL);
+
+	return layers_emitter_add(layers, emitter->layer_index, emitter->emitter);
+}
+
+bool render_emitter_draw(render_emitter_object* const emitter) {
+	assert(emitter != NULL);
+
+	static const command_funcs funcs = {
+		.update = render_emitter_draw_update_func,
+		.draw = NULL,
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
+	};
+
+	// Emitters only change through commands that aren't stateless, so the
+	// emitter is hashed by identity.
+	frames_hash(render_frames, &emitter, sizeof(emitter));
+
+	return frames_enqueue_command(render_frames, &funcs, emitter);
+}
+
 typedef struct render_print_object {
-	const char* font_filename;
+	render_handle font;
 	size_t layer_index;
 	float x;
 	float y;
+	float scale;
 	char* string;
 } render_print_object;
 
+static void print_hash(const render_print_object* const p, const size_t len) {
+	frames_hash(render_frames, &p->font, sizeof(p->font));
+	frames_hash(render_frames, &p->layer_index, sizeof(p->layer_index));
+	frames_hash(render_frames, &p->x, sizeof(p->x));
+	frames_hash(render_frames, &p->y, sizeof(p->y));
+	frames_hash(render_frames, &p->scale, sizeof(p->scale));
+	frames_hash(render_frames, p->string, len);
+}
+
+static void print_capture(const render_print_object* const p) {
+	if (capture_active() && (
+		!capture_handle_define(p->font) ||
+		!capture_string(capture, p->font, p->layer_index, p->x, p->y, p->scale, p->string)
+	)) {
+		capture_stop();
+	}
+}
+
 static bool render_print_update_func(void* const state) {
 	render_print_object* const p = state;
-	const data_object* const font = data_cache_get(data_cache, DATA_TYPE_FONT, DATA_PATH_RESOURCE, p->font_filename, NULL, false);
+	const data_object* const font = handle_data_get(p->font, true);
 	if (font == NULL) {
 		return false;
 	}
-	const bool success = print_layer_string(font->font, layers, p->layer_index, p->x, p->y, p->string);
-	mem_free((char*)p->string);
-	mem_free(p);
-	return success;
+	return print_layer_string_cached(print_cache, font->font, layers, p->layer_index, p->x, p->y, p->scale, p->string);
 }
 
 bool render_string(const char* const font_filename, const size_t layer_index, const float x, const float y, const char* const string) {
-	render_print_object* const p = mem_malloc(sizeof(render_print_object));
+	const render_handle font = render_font_handle_get(font_filename);
+	if (font == RENDER_HANDLE_NONE) {
+		return false;
+	}
+	return render_string_handle(font, layer_index, x, y, string);
+}
+
+bool render_string_handle(const render_handle font, const size_t layer_index, const float x, const float y, const char* const string) {
+	return render_string_scaled_handle(font, layer_index, x, y, 1.0f, string);
+}
+
+bool render_string_scaled_handle(const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const string) {
+	assert(font != RENDER_HANDLE_NONE);
+	assert(scale > 0.0f);
+
+	render_print_object* const p = frames_alloc(render_frames, sizeof(render_print_object));
 	if (p == NULL) {
 		return false;
 	}
 
-	p->font_filename = font_filename;
+	p->font = font;
 	p->layer_index = layer_index;
 	p->x = x;
 	p->y = y;
+	p->scale = scale;
 	const size_t size = strlen(string) + 1u;
-	p->string = mem_malloc(size);
+	p->string = frames_alloc(render_frames, size);
 	if (p->string == NULL) {
-		mem_free(p);
 		return false;
 	}
 	memcpy(p->string, string, size);
+	print_hash(p, size - 1u);
+	print_capture(p);
 
 	static const command_funcs funcs = {
 		.update = render_print_update_func,
 		.draw = NULL,
-		.destroy = NULL
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
 	};
-	if (!frames_enqueue_command(render_frames, &funcs, p)) {
-		mem_free((char*)p->string);
-		mem_free(p);
-		return false;
-	}
-
-	return true;
+	return frames_enqueue_command(render_frames, &funcs, p);
 }
 
-bool render_printf(const char* const font_filename, const size_t layer_index, const float x, const float y, const char* const format, ...) {
-	render_print_object* const p = mem_malloc(sizeof(render_print_object));
+#define PRINT_FORMAT_BUFFER_SIZE 1024u
+
+static bool print_vformat(const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const format, va_list args) {
+	assert(font != RENDER_HANDLE_NONE);
+	assert(scale > 0.0f);
+
+	render_print_object* const p = frames_alloc(render_frames, sizeof(render_print_object));
 	if (p == NULL) {
 		return false;
 	}
 
-	p->font_filename = font_filename;
+	p->font = font;
 	p->layer_index = layer_index;
 	p->x = x;
 	p->y = y;
-	va_list args;
-	va_start(args, format);
-	p->string = alloc_vsprintf(format, args);
-	va_end(args);
+	p->scale = scale;
+
+	/*
+	 * Format once into the stack buffer, then copy into frame memory; only
+	 * strings too long for the buffer get formatted a second time, directly
+	 * into frame memory.
+	 */
+	char buffer[PRINT_FORMAT_BUFFER_SIZE];
+	va_list retry_args;
+	va_copy(retry_args, args);
+	const int len = str_vsnprintf(buffer, sizeof(buffer), format, args);
+	if (len < 0) {
+		va_end(retry_args);
+		return false;
+	}
+	p->string = frames_alloc(render_frames, (size_t)len + 1u);
 	if (p->string == NULL) {
-		mem_free(p);
+		va_end(retry_args);
 		return false;
 	}
+	if ((size_t)len < sizeof(buffer)) {
+		memcpy(p->string, buffer, (size_t)len + 1u);
+	}
+	else {
+		str_vsnprintf(p->string, (size_t)len + 1u, format, retry_args);
+	}
+	va_end(retry_args);
+	print_hash(p, (size_t)len);
+	print_capture(p);
 
 	static const command_funcs funcs = {
 		.update = render_print_update_func,
 		.draw = NULL,
-		.destroy = NULL
+		.destroy = NULL,
+		.stateless = true,
+		.hashed = true
 	};
-	if (!frames_enqueue_command(render_frames, &funcs, p)) {
-		mem_free((char*)p->string);
-		mem_free(p);
+	return frames_enqueue_command(render_frames, &funcs, p);
+}
+
+bool render_printf(const char* const font_filename, const size_t layer_index, const float x, const float y, const char* const format, ...) {
+	const render_handle font = render_font_handle_get(font_filename);
+	if (font == RENDER_HANDLE_NONE) {
 		return false;
 	}
 
-	return true;
+	va_list args;
+	va_start(args, format);
+	const bool success = print_vformat(font, layer_index, x, y, 1.0f, format, args);
+	va_end(args);
+	return success;
+}
+
+bool render_printf_handle(const render_handle font, const size_t layer_index, const float x, const float y, const char* const format, ...) {
+	va_list args;
+	va_start(args, format);
+	const bool success = print_vformat(font, layer_index, x, y, 1.0f, format, args);
+	va_end(args);
+	return success;
+}
+
+bool render_printf_scaled_handle(const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const format, ...) {
+	va_list args;
+	va_start(args, format);
+	const bool success = print_vformat(font, layer_index, x, y, scale, format, args);
+	va_end(args);
+	return success;
+}
+
+void render_print_cache_stats_get(render_print_cache_stats_type* const stats) {
+	assert(stats != NULL);
+
+	SDL_AtomicLock(&print_cache_stats_lock);
+	*stats = print_cache_stats;
+	SDL_AtomicUnlock(&print_cache_stats_lock);
+}
+
+void render_stats_get(render_stats_type* const stats) {
+	assert(stats != NULL);
+
+	SDL_AtomicLock(&render_stats_lock);
+	*stats = render_stats;
+	SDL_AtomicUnlock(&render_stats_lock);
 }
@@ -30,3 +30,10 @@
 bool render_init(frames_object* const frames);
 
 void render_deinit();
+
+/*
+ * Set whether tracked sprites are interpolated between ticks, which must
+ * match whether the frames are interpolated. Must only be called in the
+ * render thread.
+ */
+void render_interpolated_set(const bool interpolate);
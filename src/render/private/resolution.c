@@ -0,0 +1,241 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/resolution.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include <math.h>
+#include <assert.h>
+
+/*
+ * Scales are kept to multiples of SCALE_STEP, so the scale doesn't wander
+ * with the noise of the measured times, and the layers' caches, sized to the
+ * viewport, are only reallocated when the scale actually changes.
+ */
+#define SCALE_STEP (1.0f / 16.0f)
+
+/*
+ * The scale is only raised while frames take less than this fraction of the
+ * target, as most frames fill fewer pixels once raised.
+ */
+#define RAISE_HEADROOM 0.75
+
+/*
+ * GPU times are read back a few frames after the frames are drawn, so this
+ * many frames are measured after each change before the scale is changed
+ * again, otherwise the times of frames drawn at the old scale would change it
+ * again.
+ */
+#define SETTLE_FRAMES 8u
+
+struct resolution_object {
+	GLuint framebuffer;
+	GLuint renderbuffer;
+	GLsizei width;
+	GLsizei height;
+
+	float scale;
+	unsigned settle;
+
+	/*
+	 * The rect of the default framebuffer, and the scaled size, of the frame
+	 * being drawn.
+	 */
+	GLint rect[4];
+	GLsizei scaled[2];
+};
+
+resolution_object* resolution_create() {
+	resolution_object* const resolution = mem_calloc(1u, sizeof(resolution_object));
+	if (resolution == NULL) {
+		return NULL;
+	}
+
+	glGenFramebuffers(1, &resolution->framebuffer);
+	if (opengl_error("Error from glGenFramebuffers in resolution_create: ")) {
+		mem_free(resolution);
+		return NULL;
+	}
+	glGenRenderbuffers(1, &resolution->renderbuffer);
+	if (opengl_error("Error from glGenRenderbuffers in resolution_create: ")) {
+		glDeleteFramebuffers(1, &resolution->framebuffer);
+		mem_free(resolution);
+		return NULL;
+	}
+	resolution->scale = 1.0f;
+
+	return resolution;
+}
+
+void resolution_destroy(resolution_object* const resolution) {
+	assert(resolution != NULL);
+
+	glDeleteFramebuffers(1, &resolution->framebuffer);
+	glDeleteRenderbuffers(1, &resolution->renderbuffer);
+	mem_free(resolution);
+}
+
+void resolution_update(resolution_object* const resolution, const double gpu_milliseconds, const double target_milliseconds, const float min_scale) {
+	assert(resolution != NULL);
+	assert(min_scale > 0.0f && min_scale <= 1.0f);
+
+	if (resolution->settle > 0u) {
+		resolution->settle--;
+		return;
+	}
+	if (!(gpu_milliseconds > 0.0) || !(target_milliseconds > 0.0)) {
+		return;
+	}
+
+	/*
+	 * The time of fill rate bound frames is about proportional to the number
+	 * of pixels drawn, so the scale that meets the target is the current
+	 * scale times the square root of the fraction of the time over the
+	 * target. Drops go straight to that scale, but raises only go up a step,
+	 * as times under the target don't tell how much time the frame's other
+	 * work takes.
+	 */
+	float scale = resolution->scale;
+	if (gpu_milliseconds > target_milliseconds) {
+		const float fit = scale * (float)sqrt(target_milliseconds / gpu_milliseconds);
+		scale = floorf(fit / SCALE_STEP) * SCALE_STEP;
+		if (scale >= resolution->scale) {
+			scale = resolution->scale - SCALE_STEP;
+		}
+	}
+	else if (gpu_milliseconds < target_milliseconds * RAISE_HEADROOM) {
+		scale = (floorf(scale / SCALE_STEP + 0.5f) + 1.0f) * SCALE_STEP;
+	}
+
+	if (scale < min_scale) {
+		scale = min_scale;
+	}
+	else if (scale > 1.0f) {
+		scale = 1.0f;
+	}
+	if (scale != resolution->scale) {
+		log_printf("Changing the resolution scale from %.4f to %.4f, frames took %.3f ms of the GPU's time, with a target of %.3f ms\n", resolution->scale, scale, gpu_milliseconds, target_milliseconds);
+		resolution->scale = scale;
+		resolution->settle = SETTLE_FRAMES;
+	}
+}
+
+float resolution_scale_get(const resolution_object* const resolution) {
+	assert(resolution != NULL);
+
+	return resolution->scale;
+}
+
+/*
+ * Make sure the renderbuffer is allocated at the size of the rect.
+ */
+static bool storage_get(resolution_object* const resolution, const GLsizei width, const GLsizei height) {
+	if (resolution->width == width && resolution->height == height) {
+		return true;
+	}
+	resolution->width = 0;
+	resolution->height = 0;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, resolution->renderbuffer);
+	opengl_label(GL_RENDERBUFFER, resolution->renderbuffer, "dynamic resolution");
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0u);
+	if (opengl_error("Error from glRenderbufferStorage in resolution_begin: ")) {
+		return false;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolution->framebuffer);
+	opengl_label(GL_FRAMEBUFFER, resolution->framebuffer, "dynamic resolution");
+	glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, resolution->renderbuffer);
+	const bool complete = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
+	if (!complete) {
+		log_printf("Error in resolution_begin: The dynamic resolution framebuffer is incomplete\n");
+		return false;
+	}
+
+	resolution->width = width;
+	resolution->height = height;
+	return true;
+}
+
+bool resolution_begin(resolution_object* const resolution, const GLint x, const GLint y, const GLsizei width, const GLsizei height) {
+	assert(resolution != NULL);
+	assert(width > 0 && height > 0);
+
+	if (!storage_get(resolution, width, height)) {
+		return false;
+	}
+
+	resolution->rect[0] = x;
+	resolution->rect[1] = y;
+	resolution->rect[2] = width;
+	resolution->rect[3] = height;
+	resolution->scaled[0] = (GLsizei)(width * resolution->scale + 0.5f);
+	resolution->scaled[1] = (GLsizei)(height * resolution->scale + 0.5f);
+	if (resolution->scaled[0] < 1) {
+		resolution->scaled[0] = 1;
+	}
+	if (resolution->scaled[1] < 1) {
+		resolution->scaled[1] = 1;
+	}
+
+	/*
+	 * The whole framebuffer is cleared, not just the scaled rect, so linear
+	 * filtering at the edges of the rect blends with black, as at the edges
+	 * of the screen, not with what older frames left there.
+	 */
+	GLfloat clear_color[4];
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, clear_color);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, resolution->framebuffer);
+	glDisable(GL_SCISSOR_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	glClearColor(clear_color[0], clear_color[1], clear_color[2], clear_color[3]);
+
+	glEnable(GL_SCISSOR_TEST);
+	glScissor(0, 0, resolution->scaled[0], resolution->scaled[1]);
+	glViewport(0, 0, resolution->scaled[0], resolution->scaled[1]);
+
+	return !opengl_error("Error in resolution_begin: ");
+}
+
+bool resolution_end(resolution_object* const resolution, const bool nearest) {
+	assert(resolution != NULL);
+
+	const GLint* const rect = resolution->rect;
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, resolution->framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0u);
+	glScissor(rect[0], rect[1], rect[2], rect[3]);
+	glViewport(rect[0], rect[1], rect[2], rect[3]);
+	glBlitFramebuffer(
+		0, 0, resolution->scaled[0], resolution->scaled[1],
+		rect[0], rect[1], rect[0] + rect[2], rect[1] + rect[3],
+		GL_COLOR_BUFFER_BIT,
+		nearest ? GL_NEAREST : GL_LINEAR
+	);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0u);
+
+	return !opengl_error("Error from glBlitFramebuffer in resolution_end: ");
+}
@@ -0,0 +1,78 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Dynamic resolution scaling. Frames are drawn into an offscreen framebuffer at
+ * a fraction of the resolution of the letterboxed screen rect, then upscaled
+ * into the rect. The scale is adjusted from the frames' measured GPU times,
+ * lowered while frames take longer than the target, and raised a step at a
+ * time once there's headroom again, so frames bound by fill rate keep to the
+ * target at the cost of sharpness. The framebuffer is allocated at the full size
+ * of the rect, changes of scale only changing how much of it is drawn into.
+ */
+
+#include "render/private/opengl.h"
+#include <stdbool.h>
+
+typedef struct resolution_object resolution_object;
+
+/*
+ * The smallest scale used when no minimum is given.
+ */
+#define RESOLUTION_MIN_SCALE_DEFAULT 0.5f
+
+/*
+ * Returns NULL upon failure. The scale starts at full resolution.
+ */
+resolution_object* resolution_create();
+
+void resolution_destroy(resolution_object* const resolution);
+
+/*
+ * Adjust the scale by the GPU time of a frame, in milliseconds, against the
+ * target, keeping the scale at least min_scale. Must only be called with the
+ * times of newly measured frames, as the scale is left alone for a few frames
+ * after each change, for the times of the frames drawn at the new scale to be
+ * measured.
+ */
+void resolution_update(resolution_object* const resolution, const double gpu_milliseconds, const double target_milliseconds, const float min_scale);
+
+float resolution_scale_get(const resolution_object* const resolution);
+
+/*
+ * Start drawing a frame to be upscaled into the rect of the default
+ * framebuffer: the offscreen framebuffer is bound and cleared to opaque black,
+ * like the screen, and the viewport and scissor are set to the scaled rect.
+ * Returns false if the framebuffer couldn't be allocated for the rect, leaving
+ * the default framebuffer bound.
+ */
+bool resolution_begin(resolution_object* const resolution, const GLint x, const GLint y, const GLsizei width, const GLsizei height);
+
+/*
+ * Upscale what was drawn since resolution_begin into the rect of the default
+ * framebuffer, with nearest filtering for pixel art, otherwise linear, leaving
+ * the default framebuffer bound, with the viewport and scissor set to the rect.
+ */
+bool resolution_end(resolution_object* const resolution, const bool nearest);
@@ -0,0 +1,74 @@
+#pragma once
+
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Conversion between sprite_type and packed_sprite_type, shared by the sprites
+ * library and the benchmarks, which can't link the sprites library without a
+ * GL context.
+ */
+
+#include "render/render_types.h"
+#include <stdint.h>
+#include <stddef.h>
+
+static inline uint16_t sprite_src_pack(const float src) {
+	if (!(src > 0.0f)) {
+		return 0u;
+	}
+	else if (src >= (float)UINT16_MAX) {
+		return UINT16_MAX;
+	}
+	else {
+		return (uint16_t)(src + 0.5f);
+	}
+}
+
+static inline int16_t sprite_dst_pack(const float dst) {
+	const float scaled = dst * PACKED_SPRITE_DST_SCALE;
+	if (scaled <= (float)INT16_MIN) {
+		return INT16_MIN;
+	}
+	else if (scaled >= (float)INT16_MAX) {
+		return INT16_MAX;
+	}
+	else {
+		return (int16_t)(scaled < 0.0f ? scaled - 0.5f : scaled + 0.5f);
+	}
+}
+
+static inline void sprite_pack(packed_sprite_type* const packed, const sprite_type* const sprite) {
+	for (size_t i = 0u; i < 4u; i++) {
+		packed->src[i] = sprite_src_pack(sprite->src[i]);
+		packed->dst[i] = sprite_dst_pack(sprite->dst[i]);
+	}
+}
+
+static inline void sprite_unpack(sprite_type* const sprite, const packed_sprite_type* const packed) {
+	for (size_t i = 0u; i < 4u; i++) {
+		sprite->src[i] = packed->src[i];
+		sprite->dst[i] = (float)packed->dst[i] / PACKED_SPRITE_DST_SCALE;
+	}
+}
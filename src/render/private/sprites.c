@@ -23,26 +23,42 @@
  */
 
 #include "render/private/sprites.h"
+#include "render/private/sprite_pack.h"
 #include "render/private/opengl.h"
 #include "util/log.h"
 #include "util/maths.h"
 #include "util/mem.h"
+#include "util/trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <float.h>
 #include <assert.h>
 
-// TODO: Switch to using a transform matrix instead of a bunch of scalar math
-// for vertex positions in the shaders.
+#define SRC_LOCATION 0
+#define DST_LOCATION 1
+#define LAYER_LOCATION 2
+#define TRANSFORM_LOCATION 3
+#define TINT_LOCATION 4
+#define ROTATION_LOCATION 5
 
-static const char* const vertex_src = "\
+#define GLSL_STRINGIFY(x) #x
+#define GLSL_VALUE(x) GLSL_STRINGIFY(x)
+#define GLSL_LOCATION(location) "layout(location = " GLSL_VALUE(location) ") "
+
+/*
+ * The vertex shaders of each format only differ in how dst is scaled, the
+ * packed format's dst being in fixed point. The view maps screen coordinates to
+ * clip space, through the current view transform of the sprites.
+ */
+#define VERTEX_SRC(dst_scale) "\
 #version 330\n\
-in vec4 src;\
-in vec4 dst;\
+" GLSL_LOCATION(SRC_LOCATION) "in vec4 src;\
+" GLSL_LOCATION(DST_LOCATION) "in vec4 dst;\
 out vec2 f_position;\
-uniform vec2 screen_dimensions;\
+uniform mat4 view;\
 uniform vec2 sheet_dimensions;\
+const float dst_scale = " dst_scale ";\
 const vec2 vertices[6] = vec2[] (\
 	vec2(0.0, 1.0),\
 	vec2(1.0, 0.0),\
@@ -52,10 +68,11 @@ const vec2 vertices[6] = vec2[] (\
 	vec2(1.0, 0.0)\
 );\
 void main() {\
-	gl_Position = vec4(((dst.xy + dst.zw * vertices[gl_VertexID % 6]) * screen_dimensions) * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);\
+	vec4 scaled_dst = dst * dst_scale;\
+	gl_Position = view * vec4(scaled_dst.xy + scaled_dst.zw * vertices[gl_VertexID % 6], 0.0, 1.0);\
 	f_position = (src.xy + vertices[gl_VertexID % 6] * src.zw) * sheet_dimensions;\
 }\
-";
+"
 
 static const char* const fragment_src = "\
 #version 330\n\
@@ -67,228 +84,1183 @@ void main() {\
 }\
 ";
 
+/*
+ * Variant of the shaders for sheets in a texture array, with the layer of the
+ * sheet within the array provided per instance. The sheet dimensions are the
+ * dimensions of the array's layers.
+ */
+#define ARRAY_VERTEX_SRC(dst_scale) "\
+#version 330\n\
+" GLSL_LOCATION(SRC_LOCATION) "in vec4 src;\
+" GLSL_LOCATION(DST_LOCATION) "in vec4 dst;\
+" GLSL_LOCATION(LAYER_LOCATION) "in uint layer;\
+out vec3 f_position;\
+uniform mat4 view;\
+uniform vec2 sheet_dimensions;\
+const float dst_scale = " dst_scale ";\
+const vec2 vertices[6] = vec2[] (\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 0.0),\
+	vec2(0.0, 0.0),\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 1.0),\
+	vec2(1.0, 0.0)\
+);\
+void main() {\
+	vec4 scaled_dst = dst * dst_scale;\
+	gl_Position = view * vec4(scaled_dst.xy + scaled_dst.zw * vertices[gl_VertexID % 6], 0.0, 1.0);\
+	f_position = vec3((src.xy + vertices[gl_VertexID % 6] * src.zw) * sheet_dimensions, float(layer));\
+}\
+"
+
+static const char* const array_fragment_src = "\
+#version 330\n\
+in vec3 f_position;\
+out vec4 out_color;\
+uniform sampler2DArray sheet;\
+void main() {\
+	out_color = texture(sheet, f_position);\
+}\
+";
+
+/*
+ * Variant of the shaders for extended sprites, transformed and tinted in the
+ * vertex shader; the layer is only used by the texture array variant. The
+ * corners are scaled and rotated about the origin, relative to the top-left
+ * of dst.
+ */
+#define EXTENDED_VERTEX_SRC(position_type, position_value) "\
+#version 330\n\
+" GLSL_LOCATION(SRC_LOCATION) "in vec4 src;\
+" GLSL_LOCATION(DST_LOCATION) "in vec4 dst;\
+" GLSL_LOCATION(LAYER_LOCATION) "in uint layer;\
+" GLSL_LOCATION(TRANSFORM_LOCATION) "in vec4 transform;\
+" GLSL_LOCATION(TINT_LOCATION) "in vec4 tint;\
+" GLSL_LOCATION(ROTATION_LOCATION) "in float rotation;\
+out " position_type " f_position;\
+out vec4 f_tint;\
+uniform mat4 view;\
+uniform vec2 sheet_dimensions;\
+const vec2 vertices[6] = vec2[] (\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 0.0),\
+	vec2(0.0, 0.0),\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 1.0),\
+	vec2(1.0, 0.0)\
+);\
+void main() {\
+	vec2 vertex = vertices[gl_VertexID % 6];\
+	vec2 corner = (vertex * dst.zw - transform.xy) * transform.zw;\
+	float c = cos(rotation);\
+	float s = sin(rotation);\
+	vec2 position = dst.xy + transform.xy + vec2(corner.x * c - corner.y * s, corner.x * s + corner.y * c);\
+	gl_Position = view * vec4(position, 0.0, 1.0);\
+	vec2 sheet_position = (src.xy + vertex * src.zw) * sheet_dimensions;\
+	f_position = " position_value ";\
+	f_tint = tint;\
+}\
+"
+
+static const char* const extended_fragment_src = "\
+#version 330\n\
+in vec2 f_position;\
+in vec4 f_tint;\
+out vec4 out_color;\
+uniform sampler2D sheet;\
+void main() {\
+	out_color = texture(sheet, f_position) * f_tint;\
+}\
+";
+
+static const char* const extended_array_fragment_src = "\
+#version 330\n\
+in vec3 f_position;\
+in vec4 f_tint;\
+out vec4 out_color;\
+uniform sampler2DArray sheet;\
+void main() {\
+	out_color = texture(sheet, f_position) * f_tint;\
+}\
+";
+
+/*
+ * Variants of the fragment shaders for signed distance field sheets, turning
+ * the distance in the alpha channel into coverage antialiased over about one
+ * pixel of the screen, however the sheet is scaled.
+ */
+#define FIELD_FRAGMENT_SRC(tint_declaration, tint) "\
+#version 330\n\
+in vec2 f_position;\
+" tint_declaration "\
+out vec4 out_color;\
+uniform sampler2D sheet;\
+uniform float distance_range;\
+void main() {\
+	vec4 texel = texture(sheet, f_position);\
+	vec2 unit_range = vec2(distance_range) / vec2(textureSize(sheet, 0));\
+	float screen_range = max(0.5 * dot(unit_range, 1.0 / fwidth(f_position)), 1.0);\
+	float coverage = clamp(screen_range * (texel.a - 0.5) + 0.5, 0.0, 1.0);\
+	out_color = vec4(texel.rgb, coverage)" tint ";\
+}\
+"
+
+static const char* const field_fragment_src = FIELD_FRAGMENT_SRC("", "");
+
+static const char* const extended_field_fragment_src = FIELD_FRAGMENT_SRC("in vec4 f_tint;", " * f_tint");
+
+#define PACKED_DST_SCALE "(1.0 / " GLSL_VALUE(PACKED_SPRITE_DST_SCALE) ".0)"
+
+/*
+ * The types of instances in the vertex buffers. The types of the sprites
+ * formats use the instances of the same value; extended instances can be added
+ * to any sprites object, regardless of format.
+ */
+typedef enum instance_type {
+	INSTANCE_FLOAT = SPRITES_FORMAT_FLOAT,
+	INSTANCE_PACKED = SPRITES_FORMAT_PACKED,
+	INSTANCE_EXTENDED = SPRITES_FORMAT_NUM,
+	INSTANCE_NUM
+} instance_type;
+
+static const char* const vertex_srcs[INSTANCE_NUM] = {
+	[INSTANCE_FLOAT] = VERTEX_SRC("1.0"),
+	[INSTANCE_PACKED] = VERTEX_SRC(PACKED_DST_SCALE),
+	[INSTANCE_EXTENDED] = EXTENDED_VERTEX_SRC("vec2", "sheet_position")
+};
+
+static const char* const array_vertex_srcs[INSTANCE_NUM] = {
+	[INSTANCE_FLOAT] = ARRAY_VERTEX_SRC("1.0"),
+	[INSTANCE_PACKED] = ARRAY_VERTEX_SRC(PACKED_DST_SCALE),
+	[INSTANCE_EXTENDED] = EXTENDED_VERTEX_SRC("vec3", "vec3(sheet_position, float(layer))")
+};
+
+/*
+ * The variants of the programs of each instance type, for sheets drawn on
+ * their own, sheets in the texture array, and distance field sheets.
+ */
+typedef enum program_variant {
+	PROGRAM_SHEET,
+	PROGRAM_ARRAY,
+	PROGRAM_FIELD,
+	PROGRAM_VARIANT_NUM
+} program_variant;
+
+static const char* vertex_src_get(const instance_type type, const program_variant variant) {
+	return variant == PROGRAM_ARRAY ? array_vertex_srcs[type] : vertex_srcs[type];
+}
+
+static const char* fragment_src_get(const instance_type type, const program_variant variant) {
+	if (type == INSTANCE_EXTENDED) {
+		return
+			variant == PROGRAM_ARRAY ? extended_array_fragment_src :
+			variant == PROGRAM_FIELD ? extended_field_fragment_src :
+			extended_fragment_src;
+	}
+	else {
+		return
+			variant == PROGRAM_ARRAY ? array_fragment_src :
+			variant == PROGRAM_FIELD ? field_fragment_src :
+			fragment_src;
+	}
+}
+
+/*
+ * The instance formats used when a texture array is in use. Instances of
+ * sheets that aren't in the array are also stored this way, their layer being
+ * unused.
+ */
+typedef struct array_sprite_type {
+	sprite_type sprite;
+	GLuint layer;
+} array_sprite_type;
+
+typedef struct packed_array_sprite_type {
+	packed_sprite_type sprite;
+	GLuint layer;
+} packed_array_sprite_type;
+
+typedef struct array_sprite_ex_type {
+	sprite_ex_type sprite;
+	GLuint layer;
+} array_sprite_ex_type;
+
+static const size_t instance_sizes[INSTANCE_NUM][2] = {
+	[INSTANCE_FLOAT] = { sizeof(sprite_type), sizeof(array_sprite_type) },
+	[INSTANCE_PACKED] = { sizeof(packed_sprite_type), sizeof(packed_array_sprite_type) },
+	[INSTANCE_EXTENDED] = { sizeof(sprite_ex_type), sizeof(array_sprite_ex_type) }
+};
+
+/*
+ * Sprites are written directly into a ring of NUM_BUFFER_SEGMENTS segments of
+ * the vertex buffer, each segment holding sprites_size sprites. Each
+ * sprites_draw uses one segment, with a fence inserted after the draws, then
+ * the sprites of the next frame go into the next segment, so the CPU never has
+ * to wait on the GPU reading the previous frames' sprites, and never writes
+ * into a segment the GPU hasn't finished reading.
+ *
+ * Where buffer storage is supported, the whole buffer is persistently and
+ * coherently mapped once, and segments still in use by the GPU are waited on.
+ * Otherwise, the current segment is mapped unsynchronized while sprites are
+ * added, and the buffer is orphaned instead of waiting when the ring wraps
+ * around onto a segment still in use.
+ */
+#define NUM_BUFFER_SEGMENTS 3u
+
+/*
+ * A sequence either has its sprites in the ring, draws a batch, or is a
+ * timestamp, target or view change, or a draw callback, only sprite sequences
+ * taking up sprites in the ring. Timestamp, target, view and draw sequences
+ * have no sheet, the n'th timestamp sequence being the n'th of the object's
+ * timestamps, and likewise for target sequences and the object's targets, view
+ * sequences and the object's views, and draw sequences and the object's draw
+ * callbacks. The ring is allocated in slots of
+ * the object's instance size, start being the first slot of the sequence;
+ * extended sequences take up as many slots as their instances span.
+ */
 typedef struct sprites_sequence {
 	data_texture_object* sheet;
+	GLint layer;
+	sprites_batch_object* batch;
+	instance_type type;
 	size_t start;
 	size_t num_sprites;
+	bool target;
+	bool view;
+	bool draw;
 } sprites_sequence;
 
+typedef struct sprites_timestamp {
+	gpu_timer_object* timer;
+	size_t zone;
+	sprites_stats_type stats;
+} sprites_timestamp;
+
+typedef struct sprites_target {
+	GLuint framebuffer;
+	GLsizei width;
+	GLsizei height;
+	sprites_blend_type blend;
+} sprites_target;
+
+/*
+ * A view change, to the screen transform, or the identity if identity is set.
+ */
+typedef struct sprites_view {
+	mat4 transform;
+	bool identity;
+} sprites_view;
+
+typedef struct sprites_draw_callback {
+	sprites_draw_func func;
+	void* data;
+} sprites_draw_callback;
+
+/*
+ * The state changed by target changes, saved at the first target change of a
+ * draw, and restored at the end of the draw.
+ */
+typedef struct sprites_target_state {
+	bool saved;
+	GLint framebuffer;
+	GLint viewport[4];
+	GLboolean scissor;
+	GLfloat clear_color[4];
+	GLint blend[4];
+} sprites_target_state;
+
+typedef struct sprites_program {
+	/*
+	 * Programs not yet needed are built in the background, started when the
+	 * sprites object is created, and finished when first used.
+	 */
+	opengl_program_build build;
+	bool building;
+
+	GLuint program;
+	GLint view_location;
+	GLint sheet_dimensions_location;
+	GLint sheet_location;
+	GLint distance_range_location;
+
+	/*
+	 * The version of the sprites object's view last set in the program.
+	 */
+	uint64_t view_version;
+} sprites_program;
+
 struct sprites_object {
 	sprites_sequence* sequences;
 	size_t sequences_length, sequences_size;
 
-	sprite_type* sprites;
+	sprites_timestamp* timestamps;
+	size_t timestamps_length, timestamps_size;
+	sprites_stats_type stats;
+
+	sprites_target* targets;
+	size_t targets_length, targets_size;
+
+	sprites_view* views;
+	size_t views_length, views_size;
+
+	sprites_draw_callback* draws;
+	size_t draws_length, draws_size;
+
 	size_t sprites_length, sprites_size;
+	sprites_format_type format;
+	size_t instance_size;
 
 	GLuint array;
 	GLuint buffer;
-	size_t new_sprites_start;
-	bool buffer_changed;
+	bool persistent;
+	unsigned char* mapped;
+	size_t segment;
+	bool segment_drawn;
+	GLsync fences[NUM_BUFFER_SEGMENTS];
+
+	/*
+	 * With the OpenGL 4.5 backend, each instance type has its own vertex
+	 * array, with the type's attribute formats set once, so a run of sprites
+	 * only has to point its array's buffer binding at the run, instead of the
+	 * one array's attributes being repointed. Runs in the ring that share
+	 * all other state, but aren't contiguous, are drawn together by one
+	 * multi-draw, their commands uploaded to the indirect buffer.
+	 */
+	bool dsa;
+	GLuint arrays[INSTANCE_NUM];
+	opengl_draw_arrays_command* commands;
+	GLuint indirect_buffer;
+	size_t commands_size;
 
-	GLuint shader;
+	texture_array_object* texture_array;
+
+	/*
+	 * Programs are indexed by instance type, then variant. Only the programs
+	 * of the object's own format are created up front; others are created
+	 * when first drawn.
+	 */
+	sprites_program programs[INSTANCE_NUM][PROGRAM_VARIANT_NUM];
 	vec2 last_screen;
-	GLint screen_dimensions_location;
-	GLint sheet_dimensions_location;
-	GLint sheet_location;
+
+	/*
+	 * The projection from screen coordinates to clip space, and the view
+	 * programs draw with, the projection times the current view transform.
+	 * Programs are only given the view when its version changes, so a view's
+	 * change only costs a uniform update per program drawn with.
+	 */
+	mat4 projection;
+	mat4 view;
+	bool view_projected;
+	uint64_t view_version;
 };
 
-sprites_object* sprites_create(const size_t initial_size) {
-	sprites_object* const sprites = (sprites_object*)mem_malloc(sizeof(sprites_object));
-	if (sprites == NULL) {
-		return NULL;
+struct sprites_batch_object {
+	data_texture_object* sheet;
+	texture_array_object* texture_array;
+	GLint layer;
+	sprites_format_type format;
+	bool dsa;
+	GLuint array;
+	GLuint buffer;
+	size_t num_sprites;
+	uint64_t version;
+};
+
+/*
+ * Batch versions are taken from one counter, so they're unique across all
+ * batches, even batches created where a destroyed batch was.
+ */
+static uint64_t next_batch_version = 0u;
+
+static void fences_delete(sprites_object* const sprites) {
+	for (size_t i = 0u; i < NUM_BUFFER_SEGMENTS; i++) {
+		if (sprites->fences[i] != NULL) {
+			glDeleteSync(sprites->fences[i]);
+			sprites->fences[i] = NULL;
+		}
 	}
+}
 
-	sprites->sequences = NULL;
-	sprites->sequences_length = 0u;
-	sprites->sequences_size = 0u;
+/*
+ * Returns the start of the current segment in the mapping. The current segment
+ * must already be mapped.
+ */
+static unsigned char* segment_get(sprites_object* const sprites) {
+	assert(sprites->mapped != NULL);
 
-	if (initial_size == 0u) {
-		sprites->sprites = NULL;
+	if (sprites->persistent) {
+		return sprites->mapped + sprites->segment * sprites->sprites_size * sprites->instance_size;
 	}
 	else {
-		sprites->sprites = (sprite_type*)mem_malloc(sizeof(sprite_type) * initial_size);
-		if (sprites->sprites == NULL) {
-			mem_free(sprites);
-		}
+		return sprites->mapped;
 	}
+}
 
-	sprites->sprites_length = 0u;
-	sprites->sprites_size = initial_size;
+static bool segment_map(sprites_object* const sprites) {
+	assert(!sprites->persistent);
+	assert(sprites->buffer != 0u);
 
-	glGenVertexArrays(1, &sprites->array);
-	if (opengl_error("Error from glGenVertexArrays in sprites_create: ")) {
-		if (sprites->sprites != NULL) {
-			mem_free(sprites->sprites);
-		}
-		mem_free(sprites);
-		return NULL;
+	if (sprites->mapped != NULL) {
+		return true;
 	}
-	glBindVertexArray(sprites->array);
 
-	glGenBuffers(1, &sprites->buffer);
-	if (opengl_error("Error from glGenBuffers in sprites_create: ")) {
-		glDeleteVertexArrays(1, &sprites->array);
-		if (sprites->sprites != NULL) {
-			mem_free(sprites->sprites);
-		}
-		mem_free(sprites);
-		return NULL;
+	/*
+	 * Only the sprites after sprites_length are written while mapped, and the
+	 * fences guarantee the GPU is done with those, so the mapping doesn't have
+	 * to be synchronized.
+	 */
+	GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+	if (sprites->sprites_length == 0u) {
+		access |= GL_MAP_INVALIDATE_RANGE_BIT;
 	}
+
 	glBindBuffer(GL_ARRAY_BUFFER, sprites->buffer);
-	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(initial_size * sizeof(sprite_type)), NULL, GL_DYNAMIC_DRAW);
-	if (opengl_error("Error from glBufferData in sprites_create: ")) {
-		glDeleteBuffers(1, &sprites->buffer);
-		glDeleteVertexArrays(1, &sprites->array);
-		if (sprites->sprites != NULL) {
-			mem_free(sprites->sprites);
-		}
-		mem_free(sprites);
-		return NULL;
+	sprites->mapped = glMapBufferRange(
+		GL_ARRAY_BUFFER,
+		(GLintptr)(sprites->segment * sprites->sprites_size * sprites->instance_size),
+		(GLsizeiptr)(sprites->sprites_size * sprites->instance_size),
+		access
+	);
+	if (sprites->mapped == NULL) {
+		opengl_error("Error from glMapBufferRange in sprites: ");
+		return false;
 	}
 
-	sprites->new_sprites_start = 0u;
-	sprites->buffer_changed = false;
+	return true;
+}
 
-	sprites->shader = opengl_program_create(vertex_src, fragment_src);
-	if (sprites->shader == 0u) {
-		log_printf("Error in sprites_create: Failed to create the sprite shader\n");
-		glDeleteBuffers(1, &sprites->buffer);
-		glDeleteVertexArrays(1, &sprites->array);
-		if (sprites->sprites != NULL) {
-			mem_free(sprites->sprites);
-		}
-		mem_free(sprites);
-		return NULL;
+static bool segment_unmap(sprites_object* const sprites) {
+	if (sprites->persistent || sprites->mapped == NULL) {
+		return true;
 	}
-	glUseProgram(sprites->shader);
-
-	const GLint dst_location = glGetAttribLocation(sprites->shader, "dst");
-	const GLint src_location = glGetAttribLocation(sprites->shader, "src");
-	glBindFragDataLocation(sprites->shader, 0u, "out_color");
-	sprites->sheet_location = glGetUniformLocation(sprites->shader, "sheet");
-	glUniform1i(sprites->sheet_location, 0);
-	sprites->last_screen[0] = -1.0f;
-	sprites->last_screen[1] = -1.0f;
-	sprites->screen_dimensions_location = glGetUniformLocation(sprites->shader, "screen_dimensions");
-	sprites->sheet_dimensions_location = glGetUniformLocation(sprites->shader, "sheet_dimensions");
 
 	glBindBuffer(GL_ARRAY_BUFFER, sprites->buffer);
-	glEnableVertexAttribArray(dst_location);
-	glEnableVertexAttribArray(src_location);
-	glVertexAttribPointer(dst_location, 4, GL_FLOAT, GL_FALSE, sizeof(sprite_type), (void*)offsetof(sprite_type, dst));
-	glVertexAttribPointer(src_location, 4, GL_FLOAT, GL_FALSE, sizeof(sprite_type), (void*)offsetof(sprite_type, src));
-	glVertexAttribDivisor(dst_location, 1u);
-	glVertexAttribDivisor(src_location, 1u);
-	sprites->new_sprites_start = 0u;
-	sprites->buffer_changed = false;
-
-	if (initial_size > 0u && !sprites_resize(sprites, initial_size)) {
-		glDeleteBuffers(1, &sprites->buffer);
-		glDeleteVertexArrays(1, &sprites->array);
-		if (sprites->sprites != NULL) {
-			mem_free(sprites->sprites);
-		}
-		mem_free(sprites);
-		return NULL;
+	sprites->mapped = NULL;
+	if (!glUnmapBuffer(GL_ARRAY_BUFFER)) {
+		log_printf("Error from glUnmapBuffer in sprites: The sprite buffer's contents were lost\n");
+		return false;
 	}
 
-	sprites_screen_reset(sprites);
-	glBindBuffer(GL_ARRAY_BUFFER, 0u);
-
-	return sprites;
+	return true;
 }
 
-void sprites_destroy(sprites_object* const sprites) {
-	assert(sprites != NULL);
+/*
+ * Switch to the next segment in the ring, so the segment drawn from last
+ * remains untouched until the GPU is done with it.
+ */
+static bool segment_next(sprites_object* const sprites) {
+	assert(sprites->sprites_length == 0u);
 
-	if (sprites->sequences != NULL) {
-		mem_free(sprites->sequences);
-	}
-	if (sprites->sprites != NULL) {
-		mem_free(sprites->sprites);
-	}
-	if (sprites->array != 0u) {
-		glDeleteVertexArrays(1, &sprites->array);
-	}
-	if (sprites->buffer != 0u) {
-		glDeleteBuffers(1, &sprites->buffer);
+	if (!segment_unmap(sprites)) {
+		return false;
 	}
-	mem_free(sprites);
-}
 
-bool sprites_resize(sprites_object* const sprites, const size_t num_sprites) {
-	assert(sprites != NULL);
+	sprites->segment = (sprites->segment + 1u) % NUM_BUFFER_SEGMENTS;
+	sprites->segment_drawn = false;
 
-	if (num_sprites == sprites->sprites_size) {
+	GLsync const fence = sprites->fences[sprites->segment];
+	if (fence == NULL) {
 		return true;
 	}
-	else if (num_sprites == 0u) {
-		if (sprites->sequences_size > 0u) {
-			mem_free(sprites->sequences);
-			sprites->sequences = NULL;
-		}
+	sprites->fences[sprites->segment] = NULL;
 
-		if (sprites->sprites_size > 0u) {
-			mem_free(sprites->sprites);
-			sprites->sprites = NULL;
+	if (sprites->persistent) {
+		GLenum status;
+		while ((status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, UINT64_C(1000000000))) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		if (status == GL_WAIT_FAILED) {
+			opengl_error("Error from glClientWaitSync in sprites: ");
+			return false;
 		}
-
-		sprites->sequences_length = 0u;
-		sprites->sequences_size = 0u;
-
-		sprites->sprites_length = 0u;
-		sprites->sprites_size = 0u;
-
-		sprites->new_sprites_start = 0u;
-		sprites->buffer_changed = true;
-
-		return true;
 	}
 	else {
-		if (sprites->sequences_length > 0u && num_sprites < sprites->sprites_length) {
-			sprites_sequence* sequence = &sprites->sequences[0u];
-			size_t new_sequences_length = 1u;
-			while(sequence->start + sequence->num_sprites < num_sprites) {
-				sequence++;
-				new_sequences_length++;
-			}
-			sequence->num_sprites = num_sprites - sequence->start;
-			if (new_sequences_length < sprites->sequences_length) {
-				sprites_sequence* const new_sequences = (sprites_sequence*)mem_realloc(sprites->sequences, new_sequences_length * sizeof(sprites_sequence));
-				if (new_sequences == NULL) {
-					mem_free(sprites->sequences);
-					sprites->sequences = NULL;
-					return false;
-				}
-				sprites->sequences = new_sequences;
+		const GLenum status = glClientWaitSync(fence, 0u, 0u);
+		glDeleteSync(fence);
+		if (status == GL_WAIT_FAILED) {
+			opengl_error("Error from glClientWaitSync in sprites: ");
+			return false;
+		}
+		else if (status == GL_TIMEOUT_EXPIRED) {
+			fences_delete(sprites);
+			glBindBuffer(GL_ARRAY_BUFFER, sprites->buffer);
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(NUM_BUFFER_SEGMENTS * sprites->sprites_size * sprites->instance_size), NULL, GL_STREAM_DRAW);
+			if (opengl_error("Error from glBufferData in sprites: ")) {
+				return false;
 			}
-			sprites->sequences_length = new_sequences_length;
-			sprites->sequences_size = new_sequences_length;
 		}
+	}
 
-		sprite_type* const new_sprites = (sprite_type*)mem_realloc(sprites->sprites, num_sprites * sizeof(sprite_type));
-		if (new_sprites == NULL) {
-			return false;
-		}
-		sprites->sprites = new_sprites;
+	return true;
+}
+
+/*
+ * Create the buffer of the OpenGL 4.5 backend, always immutable storage,
+ * persistently mapped, with the first num_kept sprites of the current segment
+ * copied into it.
+ */
+static bool dsa_buffer_create(sprites_object* const sprites, const GLsizeiptr size, const size_t num_kept, GLuint* const buffer, unsigned char** const mapped) {
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	GLuint new_buffer = 0u;
+	glCreateBuffers(1, &new_buffer);
+	if (opengl_error("Error from glCreateBuffers in sprites: ")) {
+		return false;
+	}
+	opengl_label(GL_BUFFER, new_buffer, "sprites instances");
+	glNamedBufferStorage(new_buffer, size, NULL, flags);
+	if (opengl_error("Error from glNamedBufferStorage in sprites: ")) {
+		glDeleteBuffers(1, &new_buffer);
+		return false;
+	}
 
-		sprites->sprites_size = num_sprites;
-		if (num_sprites < sprites->sprites_length) {
-			sprites->sprites_length = num_sprites;
+	if (num_kept > 0u) {
+		glCopyNamedBufferSubData(
+			sprites->buffer,
+			new_buffer,
+			(GLintptr)(sprites->segment * sprites->sprites_size * sprites->instance_size),
+			0,
+			(GLsizeiptr)(num_kept * sprites->instance_size)
+		);
+		if (opengl_error("Error from glCopyNamedBufferSubData in sprites: ")) {
+			glDeleteBuffers(1, &new_buffer);
+			return false;
 		}
-		return true;
 	}
-}
 
-bool sprites_shrink(sprites_object* const sprites) {
-	assert(sprites != NULL);
+	unsigned char* const new_mapped = glMapNamedBufferRange(new_buffer, 0, size, flags);
+	if (new_mapped == NULL) {
+		opengl_error("Error from glMapNamedBufferRange in sprites: ");
+		glDeleteBuffers(1, &new_buffer);
+		return false;
+	}
 
-	return sprites_resize(sprites, sprites->sprites_length);
+	*buffer = new_buffer;
+	*mapped = new_mapped;
+	return true;
 }
 
-void sprites_screen_reset(sprites_object* const sprites) {
-	assert(sprites != NULL);
-
+/*
+ * Replace the buffer with one with segments of num_sprites sprites each,
+ * preserving as many of the sprites of the current segment as fit.
+ */
+static bool buffer_replace(sprites_object* const sprites, const size_t num_sprites) {
+	if (!segment_unmap(sprites)) {
+		return false;
+	}
+
+	const size_t num_kept = num_sprites < sprites->sprites_length ? num_sprites : sprites->sprites_length;
+
+	GLuint new_buffer = 0u;
+	unsigned char* new_mapped = NULL;
+	if (num_sprites > 0u && sprites->dsa) {
+		const GLsizeiptr new_buffer_size = (GLsizeiptr)(NUM_BUFFER_SEGMENTS * num_sprites * sprites->instance_size);
+		if (!dsa_buffer_create(sprites, new_buffer_size, num_kept, &new_buffer, &new_mapped)) {
+			return false;
+		}
+	}
+	else if (num_sprites > 0u) {
+		const GLsizeiptr new_buffer_size = (GLsizeiptr)(NUM_BUFFER_SEGMENTS * num_sprites * sprites->instance_size);
+
+		glGenBuffers(1, &new_buffer);
+		if (opengl_error("Error from glGenBuffers in sprites: ")) {
+			return false;
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, new_buffer);
+		opengl_label(GL_BUFFER, new_buffer, "sprites instances");
+		if (sprites->persistent) {
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_ARRAY_BUFFER, new_buffer_size, NULL, flags);
+			if (opengl_error("Error from glBufferStorage in sprites: ")) {
+				glDeleteBuffers(1, &new_buffer);
+				return false;
+			}
+		}
+		else {
+			glBufferData(GL_ARRAY_BUFFER, new_buffer_size, NULL, GL_STREAM_DRAW);
+			if (opengl_error("Error from glBufferData in sprites: ")) {
+				glDeleteBuffers(1, &new_buffer);
+				return false;
+			}
+		}
+
+		if (num_kept > 0u) {
+			glBindBuffer(GL_COPY_READ_BUFFER, sprites->buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, new_buffer);
+			glCopyBufferSubData(
+				GL_COPY_READ_BUFFER,
+				GL_COPY_WRITE_BUFFER,
+				(GLintptr)(sprites->segment * sprites->sprites_size * sprites->instance_size),
+				0,
+				(GLsizeiptr)(num_kept * sprites->instance_size)
+			);
+			glBindBuffer(GL_COPY_READ_BUFFER, 0u);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, 0u);
+			if (opengl_error("Error from glCopyBufferSubData in sprites: ")) {
+				glDeleteBuffers(1, &new_buffer);
+				return false;
+			}
+		}
+
+		if (sprites->persistent) {
+			glBindBuffer(GL_ARRAY_BUFFER, new_buffer);
+			new_mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, new_buffer_size, GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+			if (new_mapped == NULL) {
+				opengl_error("Error from glMapBufferRange in sprites: ");
+				glDeleteBuffers(1, &new_buffer);
+				return false;
+			}
+		}
+	}
+
+	fences_delete(sprites);
+	if (sprites->buffer != 0u) {
+		glDeleteBuffers(1, &sprites->buffer);
+	}
+
+	sprites->buffer = new_buffer;
+	sprites->mapped = new_mapped;
+	sprites->segment = 0u;
+	sprites->segment_drawn = false;
+	sprites->sprites_size = num_sprites;
+	sprites->sprites_length = num_kept;
+
+	return true;
+}
+
+/*
+ * Start building the program in the background, if it isn't built or being
+ * built already.
+ */
+static void program_build_start(sprites_object* const sprites, const instance_type type, const program_variant variant) {
+	sprites_program* const program = &sprites->programs[type][variant];
+	if (program->program != 0u || program->building) {
+		return;
+	}
+
+	program->building = opengl_program_build_start(
+		&program->build,
+		vertex_src_get(type, variant),
+		fragment_src_get(type, variant)
+	);
+}
+
+static sprites_program* program_get(sprites_object* const sprites, const instance_type type, const program_variant variant) {
+	sprites_program* const program = &sprites->programs[type][variant];
+	if (program->program != 0u) {
+		return program;
+	}
+
+	program_build_start(sprites, type, variant);
+	if (program->building) {
+		program->program = opengl_program_build_finish(&program->build);
+		program->building = false;
+	}
+	if (program->program == 0u) {
+		log_printf("Error in sprites: Failed to create a sprite shader\n");
+		return NULL;
+	}
+	glUseProgram(program->program);
+	opengl_label(GL_PROGRAM, program->program, "sprites program");
+
+	glBindFragDataLocation(program->program, 0u, "out_color");
+	program->sheet_location = glGetUniformLocation(program->program, "sheet");
+	glUniform1i(program->sheet_location, 0);
+	program->view_location = glGetUniformLocation(program->program, "view");
+	program->sheet_dimensions_location = glGetUniformLocation(program->program, "sheet_dimensions");
+	program->distance_range_location = glGetUniformLocation(program->program, "distance_range");
+	glUniformMatrix4fv(program->view_location, 1, GL_FALSE, sprites->view);
+	program->view_version = sprites->view_version;
+
+	if (variant == PROGRAM_ARRAY) {
+		GLsizei array_width, array_height;
+		texture_array_dimensions_get(sprites->texture_array, &array_width, &array_height);
+		glUniform2f(program->sheet_dimensions_location, 1.0f / array_width, 1.0f / array_height);
+	}
+
+	return program;
+}
+
+/*
+ * Finish the background builds that are done, without blocking.
+ */
+static void programs_poll(sprites_object* const sprites) {
+	for (size_t i = 0u; i < INSTANCE_NUM; i++) {
+		for (size_t j = 0u; j < PROGRAM_VARIANT_NUM; j++) {
+			if (sprites->programs[i][j].building && opengl_program_build_done(&sprites->programs[i][j].build)) {
+				program_get(sprites, (instance_type)i, (program_variant)j);
+			}
+		}
+	}
+}
+
+static void programs_delete(sprites_object* const sprites) {
+	for (size_t i = 0u; i < INSTANCE_NUM; i++) {
+		for (size_t j = 0u; j < PROGRAM_VARIANT_NUM; j++) {
+			if (sprites->programs[i][j].building) {
+				opengl_program_build_cancel(&sprites->programs[i][j].build);
+				sprites->programs[i][j].building = false;
+			}
+			if (sprites->programs[i][j].program != 0u) {
+				glDeleteProgram(sprites->programs[i][j].program);
+				sprites->programs[i][j].program = 0u;
+			}
+		}
+	}
+}
+
+static void view_screen_set(sprites_object* const sprites, const float inverse_width, const float inverse_height) {
+	mat4_ortho(sprites->projection, 0.0f, 1.0f / inverse_width, 1.0f / inverse_height, 0.0f, -1.0f, 1.0f);
+	mat4_copy(sprites->view, sprites->projection);
+	sprites->view_projected = true;
+	sprites->view_version++;
+}
+
+/*
+ * Set the view of the sprites to the projection times the transform, or just
+ * the projection if transform is NULL.
+ */
+static void view_change(sprites_object* const sprites, const float* const transform) {
+	if (transform != NULL) {
+		mat4_multiply(sprites->view, sprites->projection, transform);
+		sprites->view_projected = false;
+	}
+	else if (!sprites->view_projected) {
+		mat4_copy(sprites->view, sprites->projection);
+		sprites->view_projected = true;
+	}
+	else {
+		return;
+	}
+	sprites->view_version++;
+}
+
+/*
+ * Enable the instance attributes of the format in the currently bound vertex
+ * array.
+ */
+static void attribs_enable(const bool has_layer) {
+	glEnableVertexAttribArray(SRC_LOCATION);
+	glEnableVertexAttribArray(DST_LOCATION);
+	glVertexAttribDivisor(SRC_LOCATION, 1u);
+	glVertexAttribDivisor(DST_LOCATION, 1u);
+	if (has_layer) {
+		glEnableVertexAttribArray(LAYER_LOCATION);
+		glVertexAttribDivisor(LAYER_LOCATION, 1u);
+	}
+}
+
+/*
+ * Point the instance attributes of the currently bound vertex array at
+ * instances of the type starting offset bytes into the currently bound array
+ * buffer. The attributes only used by extended instances are enabled or
+ * disabled to match the type.
+ */
+static void attribs_point(const instance_type type, const bool has_layer, const size_t offset) {
+	const GLsizei stride = (GLsizei)instance_sizes[type][has_layer];
+	if (type == INSTANCE_PACKED) {
+		glVertexAttribPointer(SRC_LOCATION, 4, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)(offsetof(packed_sprite_type, src) + offset));
+		glVertexAttribPointer(DST_LOCATION, 4, GL_SHORT, GL_FALSE, stride, (void*)(offsetof(packed_sprite_type, dst) + offset));
+	}
+	else {
+		// The extended type starts with the same members as sprite_type.
+		glVertexAttribPointer(SRC_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(sprite_type, src) + offset));
+		glVertexAttribPointer(DST_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(sprite_type, dst) + offset));
+	}
+	if (has_layer) {
+		// The layer directly follows the sprite in all types.
+		glVertexAttribIPointer(LAYER_LOCATION, 1, GL_UNSIGNED_INT, stride, (void*)(instance_sizes[type][0] + offset));
+	}
+
+	if (type == INSTANCE_EXTENDED) {
+		glEnableVertexAttribArray(TRANSFORM_LOCATION);
+		glEnableVertexAttribArray(TINT_LOCATION);
+		glEnableVertexAttribArray(ROTATION_LOCATION);
+		glVertexAttribDivisor(TRANSFORM_LOCATION, 1u);
+		glVertexAttribDivisor(TINT_LOCATION, 1u);
+		glVertexAttribDivisor(ROTATION_LOCATION, 1u);
+		// The origin and scale are read together as one vec4.
+		glVertexAttribPointer(TRANSFORM_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(sprite_ex_type, origin) + offset));
+		glVertexAttribPointer(TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(sprite_ex_type, tint) + offset));
+		glVertexAttribPointer(ROTATION_LOCATION, 1, GL_FLOAT, GL_FALSE, stride, (void*)(offsetof(sprite_ex_type, rotation) + offset));
+	}
+	else {
+		glDisableVertexAttribArray(TRANSFORM_LOCATION);
+		glDisableVertexAttribArray(TINT_LOCATION);
+		glDisableVertexAttribArray(ROTATION_LOCATION);
+	}
+}
+
+static void array_attrib_enable(const GLuint array, const GLuint location) {
+	glEnableVertexArrayAttrib(array, location);
+	glVertexArrayAttribBinding(array, location, 0u);
+}
+
+/*
+ * Set the attribute formats of a vertex array of the OpenGL 4.5 backend to
+ * instances of the type, all read per instance from buffer binding 0.
+ */
+static void array_format(const GLuint array, const instance_type type, const bool has_layer) {
+	glVertexArrayBindingDivisor(array, 0u, 1u);
+	if (type == INSTANCE_PACKED) {
+		glVertexArrayAttribFormat(array, SRC_LOCATION, 4, GL_UNSIGNED_SHORT, GL_FALSE, (GLuint)offsetof(packed_sprite_type, src));
+		glVertexArrayAttribFormat(array, DST_LOCATION, 4, GL_SHORT, GL_FALSE, (GLuint)offsetof(packed_sprite_type, dst));
+	}
+	else {
+		glVertexArrayAttribFormat(array, SRC_LOCATION, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(sprite_type, src));
+		glVertexArrayAttribFormat(array, DST_LOCATION, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(sprite_type, dst));
+	}
+	array_attrib_enable(array, SRC_LOCATION);
+	array_attrib_enable(array, DST_LOCATION);
+	if (has_layer) {
+		glVertexArrayAttribIFormat(array, LAYER_LOCATION, 1, GL_UNSIGNED_INT, (GLuint)instance_sizes[type][0]);
+		array_attrib_enable(array, LAYER_LOCATION);
+	}
+	if (type == INSTANCE_EXTENDED) {
+		glVertexArrayAttribFormat(array, TRANSFORM_LOCATION, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(sprite_ex_type, origin));
+		glVertexArrayAttribFormat(array, TINT_LOCATION, 4, GL_FLOAT, GL_FALSE, (GLuint)offsetof(sprite_ex_type, tint));
+		glVertexArrayAttribFormat(array, ROTATION_LOCATION, 1, GL_FLOAT, GL_FALSE, (GLuint)offsetof(sprite_ex_type, rotation));
+		array_attrib_enable(array, TRANSFORM_LOCATION);
+		array_attrib_enable(array, TINT_LOCATION);
+		array_attrib_enable(array, ROTATION_LOCATION);
+	}
+}
+
+static void arrays_delete(sprites_object* const sprites) {
+	if (sprites->array != 0u) {
+		glDeleteVertexArrays(1, &sprites->array);
+		sprites->array = 0u;
+	}
+	// Zero names are ignored, so arrays that weren't created can be included.
+	glDeleteVertexArrays(INSTANCE_NUM, sprites->arrays);
+	for (size_t i = 0u; i < INSTANCE_NUM; i++) {
+		sprites->arrays[i] = 0u;
+	}
+}
+
+/*
+ * Make room for num multi-draw commands, in both the commands and the indirect
+ * buffer. Each draw uploads at most one command per sequence.
+ */
+static bool commands_reserve(sprites_object* const sprites, const size_t num) {
+	if (num <= sprites->commands_size) {
+		return true;
+	}
+
+	const size_t new_commands_size = num * 2u;
+	opengl_draw_arrays_command* const new_commands = (opengl_draw_arrays_command*)mem_realloc(sprites->commands, new_commands_size * sizeof(opengl_draw_arrays_command));
+	if (new_commands == NULL) {
+		return false;
+	}
+	sprites->commands = new_commands;
+
+	GLuint new_indirect_buffer = 0u;
+	glCreateBuffers(1, &new_indirect_buffer);
+	if (opengl_error("Error from glCreateBuffers in sprites: ")) {
+		return false;
+	}
+	opengl_label(GL_BUFFER, new_indirect_buffer, "sprites commands");
+	glNamedBufferStorage(new_indirect_buffer, (GLsizeiptr)(new_commands_size * sizeof(opengl_draw_arrays_command)), NULL, GL_DYNAMIC_STORAGE_BIT);
+	if (opengl_error("Error from glNamedBufferStorage in sprites: ")) {
+		glDeleteBuffers(1, &new_indirect_buffer);
+		return false;
+	}
+	if (sprites->indirect_buffer != 0u) {
+		glDeleteBuffers(1, &sprites->indirect_buffer);
+	}
+	sprites->indirect_buffer = new_indirect_buffer;
+	sprites->commands_size = new_commands_size;
+
+	return true;
+}
+
+/*
+ * The number of slots of the ring num instances of the type take up.
+ */
+static size_t slots_get(const sprites_object* const sprites, const instance_type type, const size_t num) {
+	const size_t type_size = instance_sizes[type][sprites->texture_array != NULL];
+	return (num * type_size + sprites->instance_size - 1u) / sprites->instance_size;
+}
+
+/*
+ * Write num instances of the format to dst, converting the sprites if the
+ * format isn't the float format.
+ */
+static void instances_write(unsigned char* const dst, const sprites_format_type format, const bool has_layer, const GLuint layer, const size_t num, const sprite_type* const src) {
+	if (format == SPRITES_FORMAT_FLOAT && !has_layer) {
+		memcpy(dst, src, num * sizeof(sprite_type));
+	}
+	else if (format == SPRITES_FORMAT_FLOAT) {
+		array_sprite_type* const dst_sprites = (array_sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			dst_sprites[i].sprite = src[i];
+			dst_sprites[i].layer = layer;
+		}
+	}
+	else if (!has_layer) {
+		packed_sprite_type* const dst_sprites = (packed_sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			sprite_pack(&dst_sprites[i], &src[i]);
+		}
+	}
+	else {
+		packed_array_sprite_type* const dst_sprites = (packed_array_sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			sprite_pack(&dst_sprites[i].sprite, &src[i]);
+			dst_sprites[i].layer = layer;
+		}
+	}
+}
+
+static void ex_instances_write(unsigned char* const dst, const bool has_layer, const GLuint layer, const size_t num, const sprite_ex_type* const src) {
+	if (!has_layer) {
+		memcpy(dst, src, num * sizeof(sprite_ex_type));
+	}
+	else {
+		array_sprite_ex_type* const dst_sprites = (array_sprite_ex_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			dst_sprites[i].sprite = src[i];
+			dst_sprites[i].layer = layer;
+		}
+	}
+}
+
+static void packed_instances_write(unsigned char* const dst, const sprites_format_type format, const bool has_layer, const GLuint layer, const size_t num, const packed_sprite_type* const src) {
+	if (format == SPRITES_FORMAT_PACKED && !has_layer) {
+		memcpy(dst, src, num * sizeof(packed_sprite_type));
+	}
+	else if (format == SPRITES_FORMAT_PACKED) {
+		packed_array_sprite_type* const dst_sprites = (packed_array_sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			dst_sprites[i].sprite = src[i];
+			dst_sprites[i].layer = layer;
+		}
+	}
+	else if (!has_layer) {
+		sprite_type* const dst_sprites = (sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			sprite_unpack(&dst_sprites[i], &src[i]);
+		}
+	}
+	else {
+		array_sprite_type* const dst_sprites = (array_sprite_type*)dst;
+		for (size_t i = 0u; i < num; i++) {
+			sprite_unpack(&dst_sprites[i].sprite, &src[i]);
+			dst_sprites[i].layer = layer;
+		}
+	}
+}
+
+sprites_object* sprites_create(const size_t initial_size, const sprites_format_type format, texture_array_object* const texture_array) {
+	assert(format < SPRITES_FORMAT_NUM);
+
+	sprites_object* const sprites = (sprites_object*)mem_calloc(1u, sizeof(sprites_object));
+	if (sprites == NULL) {
+		return NULL;
+	}
+
+	sprites->sequences = NULL;
+	sprites->sequences_length = 0u;
+	sprites->sequences_size = 0u;
+
+	sprites->sprites_length = 0u;
+	sprites->sprites_size = 0u;
+	sprites->format = format;
+	sprites->instance_size = instance_sizes[format][texture_array != NULL];
+
+	sprites->buffer = 0u;
+	sprites->dsa = opengl_backend_get() == OPENGL_BACKEND_GL45;
+	sprites->persistent = sprites->dsa || opengl_extension_supported(OPENGL_EXTENSION_BUFFER_STORAGE);
+	sprites->mapped = NULL;
+	sprites->segment = 0u;
+	sprites->segment_drawn = false;
+
+	sprites->texture_array = texture_array;
+
+	if (sprites->dsa) {
+		glCreateVertexArrays(INSTANCE_NUM, sprites->arrays);
+		if (opengl_error("Error from glCreateVertexArrays in sprites_create: ")) {
+			mem_free(sprites);
+			return NULL;
+		}
+		for (size_t i = 0u; i < INSTANCE_NUM; i++) {
+			opengl_label(GL_VERTEX_ARRAY, sprites->arrays[i], "sprites");
+			array_format(sprites->arrays[i], (instance_type)i, texture_array != NULL);
+		}
+	}
+	else {
+		glGenVertexArrays(1, &sprites->array);
+		if (opengl_error("Error from glGenVertexArrays in sprites_create: ")) {
+			mem_free(sprites);
+			return NULL;
+		}
+		glBindVertexArray(sprites->array);
+		opengl_label(GL_VERTEX_ARRAY, sprites->array, "sprites");
+	}
+
+	sprites->last_screen[0] = -1.0f;
+	sprites->last_screen[1] = -1.0f;
+	mat4_identity(sprites->projection);
+	mat4_identity(sprites->view);
+	sprites->view_projected = true;
+	sprites->view_version = 1u;
+	/*
+	 * The programs of the object's format are needed right away, but the
+	 * other variants are built in the background, in case they're used later.
+	 * Distance field programs are only built once distance field sheets are
+	 * drawn.
+	 */
+	for (size_t i = 0u; i < INSTANCE_NUM; i++) {
+		program_build_start(sprites, (instance_type)i, PROGRAM_SHEET);
+		if (texture_array != NULL) {
+			program_build_start(sprites, (instance_type)i, PROGRAM_ARRAY);
+		}
+	}
+	if (
+		program_get(sprites, (instance_type)format, PROGRAM_SHEET) == NULL ||
+		(texture_array != NULL && program_get(sprites, (instance_type)format, PROGRAM_ARRAY) == NULL)
+	) {
+		log_printf("Error in sprites_create: Failed to create the sprite shaders\n");
+		programs_delete(sprites);
+		arrays_delete(sprites);
+		mem_free(sprites);
+		return NULL;
+	}
+
+	if (!sprites->dsa) {
+		attribs_enable(texture_array != NULL);
+	}
+
+	if (initial_size > 0u && !sprites_resize(sprites, initial_size)) {
+		programs_delete(sprites);
+		arrays_delete(sprites);
+		mem_free(sprites);
+		return NULL;
+	}
+
+	sprites_screen_reset(sprites);
+	glBindBuffer(GL_ARRAY_BUFFER, 0u);
+
+	return sprites;
+}
+
+void sprites_destroy(sprites_object* const sprites) {
+	assert(sprites != NULL);
+
+	if (sprites->sequences != NULL) {
+		mem_free(sprites->sequences);
+	}
+	if (sprites->timestamps != NULL) {
+		mem_free(sprites->timestamps);
+	}
+	if (sprites->targets != NULL) {
+		mem_free(sprites->targets);
+	}
+	if (sprites->views != NULL) {
+		mem_free(sprites->views);
+	}
+	if (sprites->draws != NULL) {
+		mem_free(sprites->draws);
+	}
+	if (sprites->commands != NULL) {
+		mem_free(sprites->commands);
+	}
+	segment_unmap(sprites);
+	fences_delete(sprites);
+	arrays_delete(sprites);
+	if (sprites->buffer != 0u) {
+		glDeleteBuffers(1, &sprites->buffer);
+	}
+	if (sprites->indirect_buffer != 0u) {
+		glDeleteBuffers(1, &sprites->indirect_buffer);
+	}
+	programs_delete(sprites);
+	mem_free(sprites);
+}
+
+bool sprites_resize(sprites_object* const sprites, const size_t num_sprites) {
+	assert(sprites != NULL);
+
+	if (num_sprites == sprites->sprites_size) {
+		return true;
+	}
+	else if (num_sprites == 0u) {
+		if (sprites->sequences_size > 0u) {
+			mem_free(sprites->sequences);
+			sprites->sequences = NULL;
+		}
+
+		sprites->sequences_length = 0u;
+		sprites->sequences_size = 0u;
+		sprites->timestamps_length = 0u;
+		sprites->targets_length = 0u;
+		sprites->views_length = 0u;
+		sprites->draws_length = 0u;
+
+		return buffer_replace(sprites, 0u);
+	}
+	else {
+		if (sprites->sequences_length > 0u && num_sprites < sprites->sprites_length) {
+			sprites_sequence* sequence = &sprites->sequences[0u];
+			size_t new_sequences_length = 1u;
+			while(sequence->start + slots_get(sprites, sequence->type, sequence->num_sprites) < num_sprites) {
+				sequence++;
+				new_sequences_length++;
+			}
+			if (sequence->batch == NULL && sequence->sheet != NULL) {
+				const size_t type_size = instance_sizes[sequence->type][sprites->texture_array != NULL];
+				sequence->num_sprites = (num_sprites - sequence->start) * sprites->instance_size / type_size;
+			}
+			if (new_sequences_length < sprites->sequences_length) {
+				sprites_sequence* const new_sequences = (sprites_sequence*)mem_realloc(sprites->sequences, new_sequences_length * sizeof(sprites_sequence));
+				if (new_sequences == NULL) {
+					mem_free(sprites->sequences);
+					sprites->sequences = NULL;
+					return false;
+				}
+				sprites->sequences = new_sequences;
+			}
+			sprites->sequences_length = new_sequences_length;
+			sprites->sequences_size = new_sequences_length;
+
+			size_t new_timestamps_length = 0u;
+			size_t new_targets_length = 0u;
+			size_t new_views_length = 0u;
+			size_t new_draws_length = 0u;
+			for (size_t i = 0u; i < new_sequences_length; i++) {
+				if (sprites->sequences[i].sheet == NULL) {
+					if (sprites->sequences[i].target) {
+						new_targets_length++;
+					}
+					else if (sprites->sequences[i].view) {
+						new_views_length++;
+					}
+					else if (sprites->sequences[i].draw) {
+						new_draws_length++;
+					}
+					else {
+						new_timestamps_length++;
+					}
+				}
+			}
+			sprites->timestamps_length = new_timestamps_length;
+			sprites->targets_length = new_targets_length;
+			sprites->views_length = new_views_length;
+			sprites->draws_length = new_draws_length;
+		}
+
+		return buffer_replace(sprites, num_sprites);
+	}
+}
+
+bool sprites_shrink(sprites_object* const sprites) {
+	assert(sprites != NULL);
+
+	return sprites_resize(sprites, sprites->sprites_length);
+}
+
+void sprites_screen_reset(sprites_object* const sprites) {
+	assert(sprites != NULL);
+
 	GLfloat viewport[4];
 	glGetFloatv(GL_VIEWPORT, viewport);
 	assert(viewport[2] > 0.0f);
@@ -297,8 +1269,7 @@ void sprites_screen_reset(sprites_object* const sprites) {
 	assert(viewport[3] <= FLT_MAX);
 	sprites->last_screen[0] = 1.0f / viewport[2];
 	sprites->last_screen[1] = 1.0f / viewport[3];
-	glUseProgram(sprites->shader);
-	glUniform2fv(sprites->screen_dimensions_location, 1, sprites->last_screen);
+	view_screen_set(sprites, sprites->last_screen[0], sprites->last_screen[1]);
 }
 
 void sprites_screen_set(sprites_object* const sprites, const float screen_width, const float screen_height) {
@@ -314,12 +1285,96 @@ void sprites_screen_set(sprites_object* const sprites, const float screen_width,
 	else if (sprites->last_screen[0] != screen_height || sprites->last_screen[1] != screen_width) {
 		sprites->last_screen[0] = screen_width;
 		sprites->last_screen[1] = screen_height;
-		glUseProgram(sprites->shader);
-		glUniform2f(sprites->screen_dimensions_location, 1.0f / screen_width, 1.0f / screen_height);
+		view_screen_set(sprites, 1.0f / screen_width, 1.0f / screen_height);
+	}
+}
+
+static bool sequences_grow(sprites_object* const sprites) {
+	const size_t new_sequences_length = sprites->sequences_length + 1u;
+	if (new_sequences_length > sprites->sequences_size) {
+		const size_t new_sequences_size = new_sequences_length * 2u;
+		sprites_sequence* const new_sequences = (sprites_sequence*)mem_realloc(sprites->sequences, new_sequences_size * sizeof(sprites_sequence));
+		if (new_sequences == NULL) {
+			return false;
+		}
+		sprites->sequences = new_sequences;
+		sprites->sequences_size = new_sequences_size;
+	}
+
+	return true;
+}
+
+/*
+ * Add a sequence of num_added sprites of the sheet, returning where in the
+ * buffer the sequence's instances are to be written, and the sheet's layer in
+ * the texture array.
+ */
+static unsigned char* sequence_add(sprites_object* const sprites, data_texture_object* const sheet, const instance_type type, const size_t num_added, GLuint* const layer) {
+	if (!sequences_grow(sprites)) {
+		return NULL;
+	}
+
+	if (sprites->sprites_length == 0u && sprites->segment_drawn && !segment_next(sprites)) {
+		return NULL;
+	}
+
+	const size_t num_slots = slots_get(sprites, type, num_added);
+	const size_t new_sprites_length = sprites->sprites_length + num_slots;
+	if (new_sprites_length > sprites->sprites_size && !buffer_replace(sprites, new_sprites_length * 2u)) {
+		return NULL;
+	}
+
+	if (!sprites->persistent && !segment_map(sprites)) {
+		return NULL;
+	}
+
+	GLint array_layer = -1;
+	if (sprites->texture_array != NULL) {
+		array_layer = texture_array_layer_get(sprites->texture_array, sheet);
+	}
+	*layer = (GLuint)(array_layer >= 0 ? array_layer : 0);
+
+	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
+	new_sequence->sheet = sheet;
+	new_sequence->layer = array_layer;
+	new_sequence->batch = NULL;
+	new_sequence->type = type;
+	new_sequence->start = sprites->sprites_length;
+	new_sequence->num_sprites = num_added;
+	new_sequence->target = false;
+	new_sequence->view = false;
+	new_sequence->draw = false;
+
+	sprites->sequences_length++;
+
+	unsigned char* const dst = segment_get(sprites) + sprites->sprites_length * sprites->instance_size;
+	sprites->sprites_length += num_slots;
+
+	return dst;
+}
+
+bool sprites_add(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const sprite_type* const added_sprites) {
+	assert(sprites != NULL);
+	assert(sheet != NULL);
+	assert(num_added <= UINT16_MAX);
+	assert(sprites->sprites_length <= UINT16_MAX - num_added);
+	assert(added_sprites != NULL);
+	
+	if (num_added == 0u) {
+		return true;
 	}
+
+	GLuint layer;
+	unsigned char* const dst = sequence_add(sprites, sheet, (instance_type)sprites->format, num_added, &layer);
+	if (dst == NULL) {
+		return false;
+	}
+	instances_write(dst, sprites->format, sprites->texture_array != NULL, layer, num_added, added_sprites);
+
+	return true;
 }
 
-bool sprites_add(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, sprite_type* const added_sprites) {
+bool sprites_add_packed(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const packed_sprite_type* const added_sprites) {
 	assert(sprites != NULL);
 	assert(sheet != NULL);
 	assert(num_added <= UINT16_MAX);
@@ -330,110 +1385,742 @@ bool sprites_add(sprites_object* const sprites, data_texture_object* const sheet
 		return true;
 	}
 
-	const size_t new_sequences_length = sprites->sequences_length + 1u;
-	if (new_sequences_length > sprites->sequences_size) {
-		const size_t new_sequences_size = new_sequences_length * 2u;
-		sprites_sequence* const new_sequences = (sprites_sequence*)mem_realloc(sprites->sequences, new_sequences_size * sizeof(sprites_sequence));
-		if (new_sequences == NULL) {
+	GLuint layer;
+	unsigned char* const dst = sequence_add(sprites, sheet, (instance_type)sprites->format, num_added, &layer);
+	if (dst == NULL) {
+		return false;
+	}
+	packed_instances_write(dst, sprites->format, sprites->texture_array != NULL, layer, num_added, added_sprites);
+
+	return true;
+}
+
+bool sprites_add_ex(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const sprite_ex_type* const added_sprites) {
+	assert(sprites != NULL);
+	assert(sheet != NULL);
+	assert(num_added <= UINT16_MAX);
+	assert(added_sprites != NULL);
+
+	if (num_added == 0u) {
+		return true;
+	}
+
+	assert(sprites->sprites_length <= UINT16_MAX - slots_get(sprites, INSTANCE_EXTENDED, num_added));
+
+	GLuint layer;
+	unsigned char* const dst = sequence_add(sprites, sheet, INSTANCE_EXTENDED, num_added, &layer);
+	if (dst == NULL) {
+		return false;
+	}
+	ex_instances_write(dst, sprites->texture_array != NULL, layer, num_added, added_sprites);
+
+	return true;
+}
+
+bool sprites_add_batch(sprites_object* const sprites, sprites_batch_object* const batch) {
+	assert(sprites != NULL);
+	assert(batch != NULL);
+	assert(batch->texture_array == NULL || batch->texture_array == sprites->texture_array);
+
+	if (batch->num_sprites == 0u) {
+		return true;
+	}
+
+	if (!sequences_grow(sprites)) {
+		return false;
+	}
+
+	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
+	new_sequence->sheet = batch->sheet;
+	new_sequence->layer = batch->layer;
+	new_sequence->batch = batch;
+	new_sequence->type = (instance_type)batch->format;
+	new_sequence->start = sprites->sprites_length;
+	new_sequence->num_sprites = 0u;
+	new_sequence->target = false;
+	new_sequence->view = false;
+	new_sequence->draw = false;
+
+	sprites->sequences_length++;
+
+	return true;
+}
+
+bool sprites_add_timestamp(sprites_object* const sprites, gpu_timer_object* const timer, const size_t zone) {
+	assert(sprites != NULL);
+
+	if (!sequences_grow(sprites)) {
+		return false;
+	}
+
+	if (sprites->timestamps_length == sprites->timestamps_size) {
+		const size_t new_timestamps_size = sprites->timestamps_size > 0u ? sprites->timestamps_size * 2u : 16u;
+		sprites_timestamp* const new_timestamps = (sprites_timestamp*)mem_realloc(sprites->timestamps, new_timestamps_size * sizeof(sprites_timestamp));
+		if (new_timestamps == NULL) {
 			return false;
 		}
-		sprites->sequences = new_sequences;
-		sprites->sequences_size = new_sequences_size;
+		sprites->timestamps = new_timestamps;
+		sprites->timestamps_size = new_timestamps_size;
 	}
 
+	sprites_timestamp* const new_timestamp = &sprites->timestamps[sprites->timestamps_length];
+	new_timestamp->timer = timer;
+	new_timestamp->zone = zone;
+	new_timestamp->stats = (sprites_stats_type) { 0 };
+	sprites->timestamps_length++;
+
 	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
-	new_sequence->sheet = sheet;
+	new_sequence->sheet = NULL;
+	new_sequence->layer = -1;
+	new_sequence->batch = NULL;
+	new_sequence->type = (instance_type)sprites->format;
 	new_sequence->start = sprites->sprites_length;
-	new_sequence->num_sprites = num_added;
+	new_sequence->num_sprites = 0u;
+	new_sequence->target = false;
+	new_sequence->view = false;
+	new_sequence->draw = false;
+
+	sprites->sequences_length++;
+
+	return true;
+}
+
+bool sprites_add_target(sprites_object* const sprites, const GLuint framebuffer, const GLsizei width, const GLsizei height, const sprites_blend_type blend) {
+	assert(sprites != NULL);
+	assert(framebuffer == 0u || (width > 0 && height > 0));
+
+	if (!sequences_grow(sprites)) {
+		return false;
+	}
+
+	if (sprites->targets_length == sprites->targets_size) {
+		const size_t new_targets_size = sprites->targets_size > 0u ? sprites->targets_size * 2u : 16u;
+		sprites_target* const new_targets = (sprites_target*)mem_realloc(sprites->targets, new_targets_size * sizeof(sprites_target));
+		if (new_targets == NULL) {
+			return false;
+		}
+		sprites->targets = new_targets;
+		sprites->targets_size = new_targets_size;
+	}
+
+	sprites_target* const new_target = &sprites->targets[sprites->targets_length];
+	new_target->framebuffer = framebuffer;
+	new_target->width = width;
+	new_target->height = height;
+	new_target->blend = blend;
+	sprites->targets_length++;
+
+	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
+	new_sequence->sheet = NULL;
+	new_sequence->layer = -1;
+	new_sequence->batch = NULL;
+	new_sequence->type = (instance_type)sprites->format;
+	new_sequence->start = sprites->sprites_length;
+	new_sequence->num_sprites = 0u;
+	new_sequence->target = true;
+	new_sequence->view = false;
+	new_sequence->draw = false;
 
 	sprites->sequences_length++;
 
-	const size_t new_sprites_length = sprites->sprites_length + num_added;
-	if (new_sprites_length > sprites->sprites_size && !sprites_resize(sprites, new_sprites_length * 2u)) {
+	return true;
+}
+
+bool sprites_add_view(sprites_object* const sprites, const mat4 transform) {
+	assert(sprites != NULL);
+
+	if (!sequences_grow(sprites)) {
 		return false;
 	}
 
-	memcpy(sprites->sprites + sprites->sprites_length, added_sprites, num_added * sizeof(sprite_type));
+	if (sprites->views_length == sprites->views_size) {
+		const size_t new_views_size = sprites->views_size > 0u ? sprites->views_size * 2u : 16u;
+		sprites_view* const new_views = (sprites_view*)mem_realloc(sprites->views, new_views_size * sizeof(sprites_view));
+		if (new_views == NULL) {
+			return false;
+		}
+		sprites->views = new_views;
+		sprites->views_size = new_views_size;
+	}
 
-	sprites->sprites_length += num_added;
-	if (!sprites->buffer_changed) {
-		sprites->new_sprites_start = new_sequence->start;
-		sprites->buffer_changed = true;
+	sprites_view* const new_view = &sprites->views[sprites->views_length];
+	new_view->identity = transform == NULL;
+	if (transform != NULL) {
+		mat4_copy(new_view->transform, transform);
 	}
+	sprites->views_length++;
+
+	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
+	new_sequence->sheet = NULL;
+	new_sequence->layer = -1;
+	new_sequence->batch = NULL;
+	new_sequence->type = (instance_type)sprites->format;
+	new_sequence->start = sprites->sprites_length;
+	new_sequence->num_sprites = 0u;
+	new_sequence->target = false;
+	new_sequence->view = true;
+	new_sequence->draw = false;
+
+	sprites->sequences_length++;
 
 	return true;
 }
 
-bool sprites_draw(sprites_object* const sprites) {
+bool sprites_add_draw(sprites_object* const sprites, const sprites_draw_func func, void* const data) {
 	assert(sprites != NULL);
+	assert(func != NULL);
+
+	if (!sequences_grow(sprites)) {
+		return false;
+	}
+
+	if (sprites->draws_length == sprites->draws_size) {
+		const size_t new_draws_size = sprites->draws_size > 0u ? sprites->draws_size * 2u : 16u;
+		sprites_draw_callback* const new_draws = (sprites_draw_callback*)mem_realloc(sprites->draws, new_draws_size * sizeof(sprites_draw_callback));
+		if (new_draws == NULL) {
+			return false;
+		}
+		sprites->draws = new_draws;
+		sprites->draws_size = new_draws_size;
+	}
+
+	sprites_draw_callback* const new_draw = &sprites->draws[sprites->draws_length];
+	new_draw->func = func;
+	new_draw->data = data;
+	sprites->draws_length++;
+
+	sprites_sequence* const new_sequence = &sprites->sequences[sprites->sequences_length];
+	new_sequence->sheet = NULL;
+	new_sequence->layer = -1;
+	new_sequence->batch = NULL;
+	new_sequence->type = (instance_type)sprites->format;
+	new_sequence->start = sprites->sprites_length;
+	new_sequence->num_sprites = 0u;
+	new_sequence->target = false;
+	new_sequence->view = false;
+	new_sequence->draw = true;
+
+	sprites->sequences_length++;
+
+	return true;
+}
+
+static void target_change(sprites_target_state* const state, const sprites_target* const target) {
+	if (!state->saved) {
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &state->framebuffer);
+		glGetIntegerv(GL_VIEWPORT, state->viewport);
+		state->scissor = glIsEnabled(GL_SCISSOR_TEST);
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, state->clear_color);
+		glGetIntegerv(GL_BLEND_SRC_RGB, &state->blend[0]);
+		glGetIntegerv(GL_BLEND_DST_RGB, &state->blend[1]);
+		glGetIntegerv(GL_BLEND_SRC_ALPHA, &state->blend[2]);
+		glGetIntegerv(GL_BLEND_DST_ALPHA, &state->blend[3]);
+		state->saved = true;
+	}
+
+	if (target->framebuffer != 0u) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, target->framebuffer);
+		glViewport(0, 0, target->width, target->height);
+		glDisable(GL_SCISSOR_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		glClearColor(state->clear_color[0], state->clear_color[1], state->clear_color[2], state->clear_color[3]);
+	}
+	else {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)state->framebuffer);
+		glViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+		if (state->scissor) {
+			glEnable(GL_SCISSOR_TEST);
+		}
+	}
+
+	/*
+	 * Alpha is accumulated as in premultiplied blending, so what's rendered
+	 * into a framebuffer can be composited with premultiplied blending.
+	 */
+	if (target->blend == SPRITES_BLEND_PREMULTIPLIED) {
+		glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else if (target->framebuffer != 0u) {
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	else {
+		glBlendFuncSeparate((GLenum)state->blend[0], (GLenum)state->blend[1], (GLenum)state->blend[2], (GLenum)state->blend[3]);
+	}
+}
+
+static void target_restore(const sprites_target_state* const state) {
+	if (!state->saved) {
+		return;
+	}
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)state->framebuffer);
+	glViewport(state->viewport[0], state->viewport[1], state->viewport[2], state->viewport[3]);
+	if (state->scissor) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+	glBlendFuncSeparate((GLenum)state->blend[0], (GLenum)state->blend[1], (GLenum)state->blend[2], (GLenum)state->blend[3]);
+}
+
+/*
+ * Returns true if the sequence can be drawn along with preceding sequences of
+ * the type, which are either all in the texture array, or all of the sheet.
+ */
+static bool sequence_joins(const sprites_sequence* const sequence, const instance_type type, const bool in_array, const data_texture_object* const sheet) {
+	return
+		sequence->batch == NULL &&
+		sequence->sheet != NULL &&
+		sequence->type == type &&
+		(in_array ? sequence->layer >= 0 : sequence->sheet == sheet);
+}
+
+static bool sequences_draw(sprites_object* const sprites) {
+	sprites->stats = (sprites_stats_type) { 0 };
 
 	if (
-		sprites->sprites_length == 0u ||
+		sprites->sequences_length == 0u ||
 		sprites->last_screen[0] <= 0.0f ||
 		sprites->last_screen[1] <= 0.0f
 	) {
 		return true;
 	}
 
-	glBindVertexArray(0u);
-	GLint buffer_size;
-	glBindBuffer(GL_ARRAY_BUFFER, sprites->buffer);
-	glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &buffer_size);
-
-	if (sprites->sprites_size != buffer_size / sizeof(sprite_type)) {
-		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(sprites->sprites_size * sizeof(sprite_type)), NULL, GL_DYNAMIC_DRAW);
-		if (opengl_error("Error from glBufferData in sprites_draw: ")) {
-			return false;
-		}
-		glBufferSubData(GL_ARRAY_BUFFER, 0, sprites->sprites_length * sizeof(sprite_type), sprites->sprites);
-		sprites->new_sprites_start = sprites->sprites_length;
-		sprites->buffer_changed = false;
+	if (!segment_unmap(sprites)) {
+		return false;
 	}
-	else if (sprites->buffer_changed && sprites->new_sprites_start < sprites->sprites_length) {
-		glBufferSubData(GL_ARRAY_BUFFER, 0, (sprites->sprites_length - sprites->new_sprites_start) * sizeof(sprite_type), sprites->sprites + sprites->new_sprites_start);
-		sprites->new_sprites_start = sprites->sprites_length;
-		sprites->buffer_changed = false;
+	if (sprites->dsa && !commands_reserve(sprites, sprites->sequences_length)) {
+		return false;
 	}
 
 	glDisable(GL_DEPTH_TEST);
-	glUseProgram(sprites->shader);
-	glBindVertexArray(sprites->array);
 	glActiveTexture(GL_TEXTURE0);
-	const GLint dst_location = glGetAttribLocation(sprites->shader, "dst");
-	const GLint src_location = glGetAttribLocation(sprites->shader, "src");
+	const size_t segment_start = sprites->segment * sprites->sprites_size;
+	sprites_program* current_program = NULL;
+	GLuint current_array = 0u;
+
+	/*
+	 * Extended sprites can be mirrored by negative scales, flipping their
+	 * winding, so culling is disabled while drawing them.
+	 */
+	const bool culling = glIsEnabled(GL_CULL_FACE);
+	bool current_culling = culling;
+
+	size_t num_timestamps = 0u;
+	sprites_stats_type* timestamp_stats = NULL;
+	size_t num_targets = 0u;
+	sprites_target_state target_state = { .saved = false };
+	size_t num_views = 0u;
+	size_t num_draws = 0u;
+	size_t num_commands_uploaded = 0u;
+	view_change(sprites, NULL);
 
 	for (size_t i = 0u; i < sprites->sequences_length; i++) {
-		size_t start_sprites_batched = sprites->sequences[i].start;
+		if (sprites->sequences[i].target) {
+			target_change(&target_state, &sprites->targets[num_targets++]);
+			continue;
+		}
+		else if (sprites->sequences[i].view) {
+			const sprites_view* const view = &sprites->views[num_views++];
+			view_change(sprites, view->identity ? NULL : view->transform);
+			continue;
+		}
+		else if (sprites->sequences[i].draw) {
+			/*
+			 * Callbacks bind their own programs, arrays and textures, so
+			 * all of those are rebound after the callback.
+			 */
+			const sprites_draw_callback* const draw = &sprites->draws[num_draws++];
+			sprites_stats_type draw_stats = { 0 };
+			const bool drawn = draw->func(draw->data, sprites->view, &draw_stats);
+			glActiveTexture(GL_TEXTURE0);
+			current_program = NULL;
+			current_array = 0u;
+			if (!drawn) {
+				if (culling && !current_culling) {
+					glEnable(GL_CULL_FACE);
+				}
+				target_restore(&target_state);
+				return false;
+			}
+
+			sprites->stats.draws += draw_stats.draws;
+			sprites->stats.instances += draw_stats.instances;
+			sprites->stats.bytes += draw_stats.bytes;
+			if (timestamp_stats != NULL) {
+				timestamp_stats->draws += draw_stats.draws;
+				timestamp_stats->instances += draw_stats.instances;
+				timestamp_stats->bytes += draw_stats.bytes;
+			}
+			continue;
+		}
+		else if (sprites->sequences[i].sheet == NULL) {
+			sprites_timestamp* const timestamp = &sprites->timestamps[num_timestamps++];
+			if (timestamp->timer != NULL) {
+				gpu_timer_timestamp(timestamp->timer, timestamp->zone);
+			}
+			timestamp_stats = &timestamp->stats;
+			continue;
+		}
+
+		sprites_batch_object* const batch = sprites->sequences[i].batch;
+		size_t start_sprites_batched = segment_start + sprites->sequences[i].start;
 		size_t num_sprites_batched = sprites->sequences[i].num_sprites;
 		data_texture_object* current_sheet = sprites->sequences[i].sheet;
-		while (i + 1u < sprites->sequences_length) {
-			if (sprites->sequences[i + 1u].sheet == current_sheet) {
+		const bool in_array = sprites->sequences[i].layer >= 0;
+		const instance_type type = sprites->sequences[i].type;
+
+		const size_t type_size = instance_sizes[type][sprites->texture_array != NULL];
+		opengl_draw_arrays_command* const commands = sprites->commands + num_commands_uploaded;
+		size_t num_commands = 0u;
+		if (batch != NULL) {
+			num_sprites_batched = batch->num_sprites;
+		}
+		else if (sprites->dsa) {
+			/*
+			 * Following sequences that can't be batched into the same
+			 * instances, due to gaps left by extended instances, still
+			 * join the multi-draw as their own commands, as long as they
+			 * start a whole number of instances after the first sequence,
+			 * where the buffer binding points.
+			 */
+			const size_t first_start = sprites->sequences[i].start;
+			commands[0] = (opengl_draw_arrays_command) { 6u, (GLuint)num_sprites_batched, 0u, 0u };
+			num_commands = 1u;
+			while (
+				i + 1u < sprites->sequences_length &&
+				sequence_joins(&sprites->sequences[i + 1u], type, in_array, current_sheet)
+			) {
+				const size_t offset = (sprites->sequences[i + 1u].start - first_start) * sprites->instance_size;
+				if (offset % type_size != 0u) {
+					break;
+				}
+
+				i++;
+				const GLuint first = (GLuint)(offset / type_size);
+				const GLuint num = (GLuint)sprites->sequences[i].num_sprites;
+				opengl_draw_arrays_command* const last = &commands[num_commands - 1u];
+				if (first == last->base_instance + last->instance_count) {
+					last->instance_count += num;
+				}
+				else {
+					commands[num_commands++] = (opengl_draw_arrays_command) { 6u, num, 0u, first };
+				}
+				num_sprites_batched += sprites->sequences[i].num_sprites;
+			}
+		}
+		else {
+			/*
+			 * Sequences of sheets in the texture array are all batched
+			 * together, regardless of sheet, while other sequences are
+			 * only batched with following sequences of the same sheet.
+			 * Only sequences of the same type with no gap between them in
+			 * the ring can be batched, as extended instances don't
+			 * necessarily fill their slots.
+			 */
+			while (
+				i + 1u < sprites->sequences_length &&
+				sequence_joins(&sprites->sequences[i + 1u], type, in_array, current_sheet) &&
+				(segment_start + sprites->sequences[i + 1u].start) * sprites->instance_size == start_sprites_batched * sprites->instance_size + num_sprites_batched * type_size
+			) {
 				i++;
 				num_sprites_batched += sprites->sequences[i].num_sprites;
 			}
+		}
+
+		const program_variant variant =
+			in_array ? PROGRAM_ARRAY :
+			current_sheet->distance_range > 0.0f ? PROGRAM_FIELD :
+			PROGRAM_SHEET;
+		sprites_program* const program = program_get(sprites, type, variant);
+		if (program == NULL) {
+			target_restore(&target_state);
+			return false;
+		}
+		if (program != current_program) {
+			glUseProgram(program->program);
+			current_program = program;
+		}
+		if (program->view_version != sprites->view_version) {
+			glUniformMatrix4fv(program->view_location, 1, GL_FALSE, sprites->view);
+			program->view_version = sprites->view_version;
+		}
+		if (in_array && sprites->dsa) {
+			glBindTextureUnit(0u, texture_array_name_get(sprites->texture_array));
+		}
+		else if (in_array) {
+			glBindTexture(GL_TEXTURE_2D_ARRAY, texture_array_name_get(sprites->texture_array));
+		}
+		else {
+			if (sprites->dsa) {
+				glBindTextureUnit(0u, current_sheet->name);
+			}
+			else {
+				glBindTexture(GL_TEXTURE_2D, current_sheet->name);
+			}
+			glUniform2f(program->sheet_dimensions_location, 1.0f / current_sheet->width, 1.0f / current_sheet->height);
+			if (variant == PROGRAM_FIELD) {
+				glUniform1f(program->distance_range_location, current_sheet->distance_range);
+			}
+		}
+
+		if (batch != NULL) {
+			if (current_array != batch->array) {
+				glBindVertexArray(batch->array);
+				current_array = batch->array;
+			}
+		}
+		else if (sprites->dsa) {
+			const GLuint array = sprites->arrays[type];
+			if (current_array != array) {
+				glBindVertexArray(array);
+				current_array = array;
+			}
+			glVertexArrayVertexBuffer(array, 0u, sprites->buffer, (GLintptr)(start_sprites_batched * sprites->instance_size), (GLsizei)type_size);
+		}
+		else {
+			if (current_array != sprites->array) {
+				glBindVertexArray(sprites->array);
+				glBindBuffer(GL_ARRAY_BUFFER, sprites->buffer);
+				current_array = sprites->array;
+			}
+			attribs_point(type, sprites->texture_array != NULL, start_sprites_batched * sprites->instance_size);
+		}
+		if (culling && current_culling != (type != INSTANCE_EXTENDED)) {
+			current_culling = type != INSTANCE_EXTENDED;
+			if (current_culling) {
+				glEnable(GL_CULL_FACE);
+			}
 			else {
-				break;
+				glDisable(GL_CULL_FACE);
+			}
+		}
+		if (num_commands > 1u) {
+			const size_t commands_offset = num_commands_uploaded * sizeof(opengl_draw_arrays_command);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, sprites->indirect_buffer);
+			glNamedBufferSubData(sprites->indirect_buffer, (GLintptr)commands_offset, (GLsizeiptr)(num_commands * sizeof(opengl_draw_arrays_command)), commands);
+			glMultiDrawArraysIndirect(GL_TRIANGLES, (const void*)commands_offset, (GLsizei)num_commands, 0);
+			num_commands_uploaded += num_commands;
+		}
+		else {
+			glDrawArraysInstanced(GL_TRIANGLES, 0, 6, num_sprites_batched);
+		}
+		if (opengl_error(num_commands > 1u ? "Error from glMultiDrawArraysIndirect in sprites_draw: " : "Error from glDrawArraysInstanced in sprites_draw: ")) {
+			if (culling) {
+				glEnable(GL_CULL_FACE);
 			}
+			target_restore(&target_state);
+			return false;
+		}
+
+		const size_t bytes = batch != NULL ? 0u : num_sprites_batched * instance_sizes[type][sprites->texture_array != NULL];
+		sprites->stats.draws++;
+		sprites->stats.instances += num_sprites_batched;
+		sprites->stats.bytes += bytes;
+		if (timestamp_stats != NULL) {
+			timestamp_stats->draws++;
+			timestamp_stats->instances += num_sprites_batched;
+			timestamp_stats->bytes += bytes;
 		}
+	}
+	if (culling && !current_culling) {
+		glEnable(GL_CULL_FACE);
+	}
+	target_restore(&target_state);
 
-		glBindTexture(GL_TEXTURE_2D, current_sheet->name);
-		glUniform2f(sprites->sheet_dimensions_location, 1.0f / current_sheet->width, 1.0f / current_sheet->height);
-		glVertexAttribPointer(dst_location, 4, GL_FLOAT, GL_FALSE, sizeof(sprite_type), (void*)(offsetof(sprite_type, dst) + start_sprites_batched * sizeof(sprite_type)));
-		glVertexAttribPointer(src_location, 4, GL_FLOAT, GL_FALSE, sizeof(sprite_type), (void*)(offsetof(sprite_type, src) + start_sprites_batched * sizeof(sprite_type)));
-		glDrawArraysInstanced(GL_TRIANGLES, 0, 6, num_sprites_batched);
-		if (opengl_error("Error from glDrawArraysInstanced in sprites_draw: ")) {
+	if (sprites->sprites_length > 0u) {
+		if (sprites->fences[sprites->segment] != NULL) {
+			glDeleteSync(sprites->fences[sprites->segment]);
+		}
+		sprites->fences[sprites->segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0u);
+		if (sprites->fences[sprites->segment] == NULL) {
+			opengl_error("Error from glFenceSync in sprites_draw: ");
 			return false;
 		}
+		sprites->segment_drawn = true;
 	}
 
 	return true;
 }
 
+bool sprites_draw(sprites_object* const sprites) {
+	assert(sprites != NULL);
+
+	trace_begin("sprites_draw");
+	const bool drawn = sequences_draw(sprites);
+	programs_poll(sprites);
+	trace_end();
+	return drawn;
+}
+
 void sprites_restart(sprites_object* const sprites) {
 	assert(sprites != NULL);
 
 	sprites->sequences_length = 0u;
 	sprites->sprites_length = 0u;
-	sprites->new_sprites_start = 0u;
-	sprites->buffer_changed = true;
+	sprites->timestamps_length = 0u;
+	sprites->targets_length = 0u;
+	sprites->views_length = 0u;
+	sprites->draws_length = 0u;
+}
+
+void sprites_stats_get(sprites_object* const sprites, sprites_stats_type* const stats) {
+	assert(sprites != NULL);
+	assert(stats != NULL);
+
+	*stats = sprites->stats;
+}
+
+void sprites_timestamp_stats_get(sprites_object* const sprites, const size_t index, sprites_stats_type* const stats) {
+	assert(sprites != NULL);
+	assert(index < sprites->timestamps_length);
+	assert(stats != NULL);
+
+	*stats = sprites->timestamps[index].stats;
+}
+
+sprites_batch_object* sprites_batch_create(const sprites_format_type format, texture_array_object* const texture_array, data_texture_object* const sheet, const size_t num_sprites, const sprite_type* const batch_sprites) {
+	assert(format < SPRITES_FORMAT_NUM);
+	assert(sheet != NULL);
+	assert(num_sprites == 0u || batch_sprites != NULL);
+
+	sprites_batch_object* const batch = mem_calloc(1u, sizeof(sprites_batch_object));
+	if (batch == NULL) {
+		return NULL;
+	}
+
+	batch->sheet = sheet;
+	batch->texture_array = texture_array;
+	batch->layer = -1;
+	if (texture_array != NULL) {
+		batch->layer = texture_array_layer_get(texture_array, sheet);
+	}
+	batch->format = format;
+	batch->dsa = opengl_backend_get() == OPENGL_BACKEND_GL45;
+	batch->num_sprites = num_sprites;
+	batch->version = next_batch_version++;
+
+	if (num_sprites == 0u) {
+		return batch;
+	}
+
+	const bool has_layer = texture_array != NULL;
+	const size_t instance_size = instance_sizes[format][has_layer];
+	if (batch->dsa) {
+		glCreateVertexArrays(1, &batch->array);
+		if (opengl_error("Error from glCreateVertexArrays in sprites_batch_create: ")) {
+			mem_free(batch);
+			return NULL;
+		}
+		glCreateBuffers(1, &batch->buffer);
+		if (opengl_error("Error from glCreateBuffers in sprites_batch_create: ")) {
+			glDeleteVertexArrays(1, &batch->array);
+			mem_free(batch);
+			return NULL;
+		}
+		opengl_label(GL_VERTEX_ARRAY, batch->array, "sprites batch");
+		opengl_label(GL_BUFFER, batch->buffer, "sprites batch instances");
+		glNamedBufferStorage(batch->buffer, (GLsizeiptr)(num_sprites * instance_size), NULL, GL_MAP_WRITE_BIT);
+		if (opengl_error("Error from glNamedBufferStorage in sprites_batch_create: ")) {
+			sprites_batch_destroy(batch);
+			return NULL;
+		}
+		array_format(batch->array, (instance_type)format, has_layer);
+		glVertexArrayVertexBuffer(batch->array, 0u, batch->buffer, 0, (GLsizei)instance_size);
+
+		if (!sprites_batch_update(batch, 0u, num_sprites, batch_sprites)) {
+			sprites_batch_destroy(batch);
+			return NULL;
+		}
+		return batch;
+	}
+
+	glGenVertexArrays(1, &batch->array);
+	if (opengl_error("Error from glGenVertexArrays in sprites_batch_create: ")) {
+		mem_free(batch);
+		return NULL;
+	}
+	glGenBuffers(1, &batch->buffer);
+	if (opengl_error("Error from glGenBuffers in sprites_batch_create: ")) {
+		glDeleteVertexArrays(1, &batch->array);
+		mem_free(batch);
+		return NULL;
+	}
+
+	glBindVertexArray(batch->array);
+	glBindBuffer(GL_ARRAY_BUFFER, batch->buffer);
+	opengl_label(GL_VERTEX_ARRAY, batch->array, "sprites batch");
+	opengl_label(GL_BUFFER, batch->buffer, "sprites batch instances");
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(num_sprites * instance_size), NULL, GL_STATIC_DRAW);
+	if (opengl_error("Error from glBufferData in sprites_batch_create: ")) {
+		sprites_batch_destroy(batch);
+		return NULL;
+	}
+	attribs_enable(has_layer);
+	attribs_point((instance_type)format, has_layer, 0u);
+
+	if (!sprites_batch_update(batch, 0u, num_sprites, batch_sprites)) {
+		sprites_batch_destroy(batch);
+		return NULL;
+	}
+
+	return batch;
+}
+
+void sprites_batch_destroy(sprites_batch_object* const batch) {
+	assert(batch != NULL);
+
+	if (batch->array != 0u) {
+		glDeleteVertexArrays(1, &batch->array);
+	}
+	if (batch->buffer != 0u) {
+		glDeleteBuffers(1, &batch->buffer);
+	}
+	mem_free(batch);
+}
+
+data_texture_object* sprites_batch_sheet_get(sprites_batch_object* const batch) {
+	assert(batch != NULL);
+
+	return batch->sheet;
+}
+
+bool sprites_batch_update(sprites_batch_object* const batch, const size_t start, const size_t num_updated, const sprite_type* const updated_sprites) {
+	assert(batch != NULL);
+	assert(start <= batch->num_sprites);
+	assert(num_updated <= batch->num_sprites - start);
+	assert(num_updated == 0u || updated_sprites != NULL);
+
+	if (num_updated == 0u) {
+		return true;
+	}
+
+	const bool has_layer = batch->texture_array != NULL;
+	const size_t instance_size = instance_sizes[batch->format][has_layer];
+	const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+	unsigned char* mapped;
+	if (batch->dsa) {
+		mapped = glMapNamedBufferRange(batch->buffer, (GLintptr)(start * instance_size), (GLsizeiptr)(num_updated * instance_size), access);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, batch->buffer);
+		mapped = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)(start * instance_size), (GLsizeiptr)(num_updated * instance_size), access);
+	}
+	if (mapped == NULL) {
+		opengl_error("Error from mapping the buffer in sprites_batch_update: ");
+		return false;
+	}
+	instances_write(mapped, batch->format, has_layer, (GLuint)(batch->layer >= 0 ? batch->layer : 0), num_updated, updated_sprites);
+	if (batch->dsa ? !glUnmapNamedBuffer(batch->buffer) : !glUnmapBuffer(GL_ARRAY_BUFFER)) {
+		log_printf("Error from glUnmapBuffer in sprites_batch_update: The batch's contents were lost\n");
+		return false;
+	}
+	batch->version = next_batch_version++;
+
+	return true;
+}
+
+uint64_t sprites_batch_version_get(sprites_batch_object* const batch) {
+	assert(batch != NULL);
+
+	return batch->version;
 }
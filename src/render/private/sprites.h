@@ -42,13 +42,36 @@
  */
 
 #include "render/render_types.h"
+#include "render/private/texture_array.h"
+#include "render/private/gpu_timer.h"
 #include "data/data_texture.h"
+#include "util/maths.h"
 #include <stdbool.h>
 #include <stddef.h>
 
 typedef struct sprites_object sprites_object;
+typedef struct sprites_batch_object sprites_batch_object;
 
-sprites_object* sprites_create(const size_t initial_size);
+/*
+ * The format sprites are stored in for drawing. The packed format halves the
+ * memory written and read per sprite, but sprites are rounded to the precision
+ * of packed_sprite_type. Either format accepts either type of sprite, though
+ * adding the type matching the format avoids converting the sprites.
+ */
+typedef enum sprites_format_type {
+	SPRITES_FORMAT_FLOAT,
+	SPRITES_FORMAT_PACKED,
+	SPRITES_FORMAT_NUM
+} sprites_format_type;
+
+/*
+ * Create a sprites object. If texture_array isn't NULL, sheets are copied into
+ * the texture array where possible, so consecutive sprites of sheets in the
+ * array are drawn together, regardless of which sheet they use; sheets that
+ * don't fit in the array are drawn separately. The texture array must outlive
+ * the sprites object.
+ */
+sprites_object* sprites_create(const size_t initial_size, const sprites_format_type format, texture_array_object* const texture_array);
 void sprites_destroy(sprites_object* const sprites);
 
 bool sprites_resize(sprites_object*const sprites, const size_t num_sprites);
@@ -59,5 +82,114 @@ void sprites_restart(sprites_object* const sprites);
 void sprites_screen_reset(sprites_object* const sprites);
 void sprites_screen_set(sprites_object* const sprites, const float width, const float height);
 
-bool sprites_add(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, sprite_type* const added_sprites);
+bool sprites_add(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const sprite_type* const added_sprites);
+bool sprites_add_packed(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const packed_sprite_type* const added_sprites);
+
+/*
+ * Add extended sprites, transformed and tinted on the GPU. Extended sprites can
+ * be added to sprites objects of either format, but take up more of the buffer
+ * than either format's sprites.
+ */
+bool sprites_add_ex(sprites_object* const sprites, data_texture_object* const sheet, const size_t num_added, const sprite_ex_type* const added_sprites);
+
+/*
+ * Add a batch to be drawn in sequence with the other added sprites. The batch
+ * must remain valid until the sprites object has been drawn or restarted.
+ */
+bool sprites_add_batch(sprites_object* const sprites, sprites_batch_object* const batch);
+
+/*
+ * Add a timestamp, recorded in the GPU timer's zone when the sprites are drawn,
+ * between the sprites added before and after it; the timer can be NULL, to
+ * only gather stats between timestamps. Sprites are never drawn together across
+ * timestamps.
+ */
+bool sprites_add_timestamp(sprites_object* const sprites, gpu_timer_object* const timer, const size_t zone);
+
+typedef enum sprites_blend_type {
+	/*
+	 * Straight alpha blending, the default.
+	 */
+	SPRITES_BLEND_ALPHA,
+
+	/*
+	 * Premultiplied alpha blending, for drawing sheets rendered into with
+	 * sprites_add_target.
+	 */
+	SPRITES_BLEND_PREMULTIPLIED
+} sprites_blend_type;
+
+/*
+ * Add a change of render target, the sprites added after it being drawn into
+ * the framebuffer, with a viewport of width by height, and blended with the
+ * blend mode. A nonzero framebuffer is cleared to transparent black when
+ * changed to; framebuffer zero changes back to the framebuffer and viewport
+ * current when drawing started, without clearing. Colors blended into a
+ * framebuffer end up premultiplied by alpha. The original framebuffer, viewport,
+ * and blend mode are restored at the end of sprites_draw. Sprites are never
+ * drawn together across target changes.
+ */
+bool sprites_add_target(sprites_object* const sprites, const GLuint framebuffer, const GLsizei width, const GLsizei height, const sprites_blend_type blend);
+
+/*
+ * Add a change of view transform, the sprites added after it being drawn with
+ * their screen coordinates transformed by the matrix, before the projection
+ * onto the screen; NULL changes back to the identity, the view at the start of
+ * each draw. Changing the view only costs a uniform update per shader drawn
+ * with, and sprites are never drawn together across view changes.
+ */
+bool sprites_add_view(sprites_object* const sprites, const mat4 transform);
+
 bool sprites_draw(sprites_object* const sprites);
+
+/*
+ * Stats of the last sprites_draw. bytes counts the bytes of sprites written to
+ * the buffer; drawing batches writes none.
+ */
+typedef struct sprites_stats_type {
+	size_t draws;
+	size_t instances;
+	size_t bytes;
+} sprites_stats_type;
+
+void sprites_stats_get(sprites_object* const sprites, sprites_stats_type* const stats);
+
+/*
+ * A draw callback, drawing with its own GL state in sequence with the sprites,
+ * given the view sprites at that point are drawn with; the callback adds what
+ * it drew to stats, and returns false upon failure. The callback can change
+ * the bound program, vertex array, and textures, but must leave all other
+ * state as it was.
+ */
+typedef bool (* sprites_draw_func)(void* const data, const mat4 view, sprites_stats_type* const stats);
+
+/*
+ * Add a draw callback, called with data when the sprites are drawn, between
+ * the sprites added before and after it. The data must remain valid until the
+ * sprites object has been drawn or restarted.
+ */
+bool sprites_add_draw(sprites_object* const sprites, const sprites_draw_func func, void* const data);
+
+/*
+ * Stats of what was drawn after the index'th timestamp added since the last
+ * restart, up to the next timestamp, in the last sprites_draw.
+ */
+void sprites_timestamp_stats_get(sprites_object* const sprites, const size_t index, sprites_stats_type* const stats);
+
+/*
+ * Batches are sprites uploaded once into their own vertex buffer, drawn with
+ * sprites_add_batch without copying the sprites again, for sprites that rarely
+ * change. A batch can be drawn by any sprites object using the same texture
+ * array as the batch. Updating a batch that's still being drawn by the GPU can
+ * stall, so batches should only be updated infrequently.
+ */
+sprites_batch_object* sprites_batch_create(const sprites_format_type format, texture_array_object* const texture_array, data_texture_object* const sheet, const size_t num_sprites, const sprite_type* const batch_sprites);
+void sprites_batch_destroy(sprites_batch_object* const batch);
+data_texture_object* sprites_batch_sheet_get(sprites_batch_object* const batch);
+bool sprites_batch_update(sprites_batch_object* const batch, const size_t start, const size_t num_updated, const sprite_type* const updated_sprites);
+
+/*
+ * Get the batch's version, which is unique among all batches, and changes
+ * whenever the batch is updated.
+ */
+uint64_t sprites_batch_version_get(sprites_batch_object* const batch);
@@ -0,0 +1,300 @@
+/*
+ * MIT License
+ *
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/texture_array.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include <assert.h>
+
+/*
+ * Layers are allocated this many at a time at first, then the count doubles
+ * each time the array is full.
+ */
+#define INITIAL_NUM_LAYERS 4
+
+struct texture_array_object {
+	GLuint name;
+	GLsizei width;
+	GLsizei height;
+	GLsizei num_layers;
+	GLsizei size_layers;
+	GLsizei max_layers;
+
+	/*
+	 * Released layers, reused before adding new layers.
+	 */
+	GLint* free_layers;
+	GLsizei num_free_layers;
+
+	GLuint read_framebuffer;
+	GLuint draw_framebuffer;
+};
+
+/*
+ * The state that copying between textures with framebuffer blits disturbs.
+ */
+typedef struct blit_state {
+	GLint read_framebuffer;
+	GLint draw_framebuffer;
+	GLboolean scissor_test;
+} blit_state;
+
+static void blit_state_save(blit_state* const state) {
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &state->read_framebuffer);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &state->draw_framebuffer);
+	state->scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+	glDisable(GL_SCISSOR_TEST);
+}
+
+static void blit_state_restore(const blit_state* const state) {
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, (GLuint)state->read_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, (GLuint)state->draw_framebuffer);
+	if (state->scissor_test) {
+		glEnable(GL_SCISSOR_TEST);
+	}
+}
+
+static GLuint storage_create(texture_array_object* const array, const GLsizei num_layers) {
+	GLuint name;
+	glGenTextures(1, &name);
+	if (opengl_error("Error from glGenTextures in texture_array: ")) {
+		return 0u;
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, name);
+	opengl_label(GL_TEXTURE, name, "texture array");
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, array->width, array->height, num_layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0u);
+	if (opengl_error("Error from glTexImage3D in texture_array: ")) {
+		glDeleteTextures(1, &name);
+		return 0u;
+	}
+
+	return name;
+}
+
+/*
+ * Double the number of layers, copying the existing layers into the new
+ * storage.
+ */
+static bool grow(texture_array_object* const array) {
+	GLsizei new_size_layers = array->size_layers * 2;
+	if (new_size_layers > array->max_layers) {
+		new_size_layers = array->max_layers;
+	}
+	assert(new_size_layers > array->size_layers);
+
+	const GLuint new_name = storage_create(array, new_size_layers);
+	if (new_name == 0u) {
+		return false;
+	}
+
+	for (GLsizei layer = 0; layer < array->num_layers; layer++) {
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array->name, 0, layer);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, new_name, 0, layer);
+		glBlitFramebuffer(0, 0, array->width, array->height, 0, 0, array->width, array->height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+	}
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0u, 0, 0);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0u, 0, 0);
+	if (opengl_error("Error from glBlitFramebuffer while growing a texture array: ")) {
+		glDeleteTextures(1, &new_name);
+		return false;
+	}
+
+	glDeleteTextures(1, &array->name);
+	array->name = new_name;
+	array->size_layers = new_size_layers;
+
+	log_printf("Grew a texture array to %d layers\n", (int)new_size_layers);
+
+	return true;
+}
+
+texture_array_object* texture_array_create(const GLsizei width, const GLsizei height) {
+	GLint max_size, max_layers;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+	if (width <= 0 || height <= 0 || width > max_size || height > max_size || max_layers <= 0) {
+		log_printf("Error: Texture array dimensions of %dx%d are unsupported\n", (int)width, (int)height);
+		return NULL;
+	}
+
+	texture_array_object* const array = mem_calloc(1u, sizeof(texture_array_object));
+	if (array == NULL) {
+		return NULL;
+	}
+
+	array->width = width;
+	array->height = height;
+	array->num_layers = 0;
+	array->max_layers = max_layers;
+	array->size_layers = INITIAL_NUM_LAYERS < max_layers ? INITIAL_NUM_LAYERS : max_layers;
+
+	array->name = storage_create(array, array->size_layers);
+	if (array->name == 0u) {
+		mem_free(array);
+		return NULL;
+	}
+
+	glGenFramebuffers(1, &array->read_framebuffer);
+	glGenFramebuffers(1, &array->draw_framebuffer);
+	if (opengl_error("Error from glGenFramebuffers in texture_array_create: ")) {
+		texture_array_destroy(array);
+		return NULL;
+	}
+
+	return array;
+}
+
+void texture_array_destroy(texture_array_object* const array) {
+	assert(array != NULL);
+
+	if (array->read_framebuffer != 0u) {
+		glDeleteFramebuffers(1, &array->read_framebuffer);
+	}
+	if (array->draw_framebuffer != 0u) {
+		glDeleteFramebuffers(1, &array->draw_framebuffer);
+	}
+	if (array->name != 0u) {
+		glDeleteTextures(1, &array->name);
+	}
+	if (array->free_layers != NULL) {
+		mem_free(array->free_layers);
+	}
+	mem_free(array);
+}
+
+GLuint texture_array_name_get(texture_array_object* const array) {
+	assert(array != NULL);
+
+	return array->name;
+}
+
+void texture_array_dimensions_get(texture_array_object* const array, GLsizei* const width, GLsizei* const height) {
+	assert(array != NULL);
+
+	if (width != NULL) {
+		*width = array->width;
+	}
+	if (height != NULL) {
+		*height = array->height;
+	}
+}
+
+GLint texture_array_layer_get(texture_array_object* const array, data_texture_object* const texture) {
+	assert(array != NULL);
+	assert(texture != NULL);
+
+	if (texture->array_layer >= 0) {
+		assert(texture->array_layer < array->num_layers);
+		return texture->array_layer;
+	}
+	else if (
+		texture->array_layer == DATA_TEXTURE_ARRAY_EXCLUDED ||
+		texture->width > (float)array->width ||
+		texture->height > (float)array->height ||
+		(array->num_free_layers == 0 && array->num_layers == array->max_layers)
+	) {
+		return -1;
+	}
+
+	blit_state state;
+	blit_state_save(&state);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, array->read_framebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, array->draw_framebuffer);
+
+	if (array->num_free_layers == 0 && array->num_layers == array->size_layers && !grow(array)) {
+		blit_state_restore(&state);
+		return -1;
+	}
+
+	const bool reused = array->num_free_layers > 0;
+	const GLint layer = reused ? array->free_layers[array->num_free_layers - 1] : array->num_layers;
+	const GLint width = (GLint)texture->width;
+	const GLint height = (GLint)texture->height;
+
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture->name, 0);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, array->name, 0, layer);
+	if (
+		glCheckFramebufferStatus(GL_READ_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE ||
+		glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE
+	) {
+		log_printf("Error: Incomplete framebuffer while adding a texture to a texture array\n");
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0u, 0);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0u, 0, 0);
+		blit_state_restore(&state);
+		return -1;
+	}
+
+	/*
+	 * The area of the layer outside the texture is cleared to transparent
+	 * black, matching the border color of separate textures.
+	 */
+	const GLfloat transparent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, transparent);
+	glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0u, 0);
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, 0u, 0, 0);
+	blit_state_restore(&state);
+	if (opengl_error("Error from glBlitFramebuffer while adding a texture to a texture array: ")) {
+		return -1;
+	}
+
+	if (reused) {
+		array->num_free_layers--;
+	}
+	else {
+		array->num_layers++;
+	}
+	texture->array_layer = layer;
+	return layer;
+}
+
+void texture_array_layer_release(texture_array_object* const array, data_texture_object* const texture) {
+	assert(array != NULL);
+	assert(texture != NULL);
+
+	if (texture->array_layer < 0) {
+		return;
+	}
+	assert(texture->array_layer < array->num_layers);
+
+	/*
+	 * At most every layer is free, so the list is sized for every layer the
+	 * array has.
+	 */
+	GLint* const free_layers = mem_realloc(array->free_layers, (size_t)array->num_layers * sizeof(GLint));
+	if (free_layers == NULL) {
+		texture->array_layer = -1;
+		return;
+	}
+	array->free_layers = free_layers;
+	array->free_layers[array->num_free_layers++] = texture->array_layer;
+	texture->array_layer = -1;
+}
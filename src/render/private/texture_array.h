@@ -0,0 +1,69 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Texture array of equally-sized layers, that textures no larger than a layer
+ * are copied into, one texture per layer, so draws using any of the textures in
+ * the array can be batched together into a single draw. The array grows as
+ * textures are added, up to the OpenGL implementation's limit on the number of
+ * layers. Layers are reclaimed when textures are released from the array, such
+ * as when they're evicted from the data cache.
+ */
+
+#include "render/private/opengl.h"
+#include "data/data_texture.h"
+
+typedef struct texture_array_object texture_array_object;
+
+/*
+ * Create an empty texture array with layers of the requested dimensions.
+ * Returns NULL if creation failed, such as when the dimensions aren't
+ * supported.
+ */
+texture_array_object* texture_array_create(const GLsizei width, const GLsizei height);
+
+void texture_array_destroy(texture_array_object* const array);
+
+/*
+ * Get the OpenGL name of the GL_TEXTURE_2D_ARRAY texture. The name changes
+ * when the array grows, so get the name again after adding textures.
+ */
+GLuint texture_array_name_get(texture_array_object* const array);
+
+void texture_array_dimensions_get(texture_array_object* const array, GLsizei* const width, GLsizei* const height);
+
+/*
+ * Get the layer of a texture within the array, copying the texture into a new
+ * layer if it isn't already in the array. Returns a negative value if the
+ * texture isn't in the array and can't be added to it, in which case the
+ * texture has to be drawn from separately.
+ */
+GLint texture_array_layer_get(texture_array_object* const array, data_texture_object* const texture);
+
+/*
+ * Release the texture's layer, if it's in the array, for reuse by other
+ * textures. Nothing drawn later may still reference the layer.
+ */
+void texture_array_layer_release(texture_array_object* const array, data_texture_object* const texture);
@@ -0,0 +1,612 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/texture_loader.h"
+#include "render/private/opengl.h"
+#include "util/private/conqueue.h"
+#include "util/private/threads.h"
+#include "util/jobs.h"
+#include "util/str.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL.h"
+#include <string.h>
+#include <assert.h>
+
+#define NUM_UPLOAD_BUFFERS 3u
+
+/*
+ * At most this many separate uploads are made from a buffer per update.
+ */
+#define MAX_UPLOAD_REGIONS 16u
+
+/*
+ * At most this many requests are decoded at once by the loader thread.
+ */
+#define MAX_DECODE_BATCH 32u
+
+/*
+ * At most this many requests are in flight between the render thread and the
+ * loader thread, so neither ring queue can overflow; requests beyond that wait
+ * in the render thread until earlier ones come back decoded.
+ */
+#define MAX_IN_FLIGHT 64u
+
+typedef struct texture_loader_waiter {
+	texture_loader_done_func done;
+	void* data;
+} texture_loader_waiter;
+
+/*
+ * Requests are owned by the render thread, only being lent to the loader
+ * thread between being enqueued for decoding and being enqueued back as
+ * decoded.
+ */
+typedef struct texture_load_request texture_load_request;
+struct texture_load_request {
+	texture_load_request* next;
+	texture_load_request* next_upload;
+	char* filename;
+	data_cache_object* cache;
+
+	/*
+	 * The decoded image, set by the loader thread; NULL if decoding failed.
+	 */
+	SDL_Surface* surface;
+
+	/*
+	 * The whole file, if it's a KTX2 file, set by the loader thread instead of
+	 * the surface. KTX2 files are uploaded directly, without going through the
+	 * upload buffers, as they're already in their GPU format.
+	 */
+	void* ktx2_bytes;
+	size_t ktx2_size;
+
+	GLuint name;
+	int uploaded_rows;
+
+	/*
+	 * Whether the request has been sent to the loader thread yet.
+	 */
+	bool queued;
+
+	texture_loader_waiter* waiters;
+	size_t num_waiters;
+};
+
+typedef struct upload_region {
+	texture_load_request* request;
+	int row;
+	int num_rows;
+	size_t offset;
+} upload_region;
+
+struct texture_loader_object {
+	data_cache_object* cache;
+	size_t upload_budget;
+
+	SDL_Thread* thread;
+	SDL_sem* decode_sem;
+	SDL_atomic_t quit;
+	conqueue_ring_object* decode_queue;
+	conqueue_ring_object* decoded_queue;
+
+	texture_load_request* requests;
+	size_t num_in_flight;
+	texture_load_request* uploads_head;
+	texture_load_request** uploads_tail;
+
+	GLuint buffers[NUM_UPLOAD_BUFFERS];
+	GLsync fences[NUM_UPLOAD_BUFFERS];
+	size_t buffer;
+};
+
+/*
+ * Read the whole file into the request if it's a KTX2 file. Returns false if
+ * the file isn't a KTX2 file.
+ */
+static bool ktx2_read(texture_load_request* const request, SDL_RWops* const rwops) {
+	unsigned char identifier[12];
+	if (SDL_RWread(rwops, identifier, 1u, sizeof(identifier)) != sizeof(identifier) || !data_texture_is_ktx2(identifier, sizeof(identifier))) {
+		return false;
+	}
+
+	const Sint64 size = SDL_RWsize(rwops);
+	if (size < 0 || SDL_RWseek(rwops, 0, RW_SEEK_SET) != 0) {
+		return true;
+	}
+	unsigned char* const bytes = mem_malloc((size_t)size);
+	if (bytes == NULL) {
+		return true;
+	}
+	if (SDL_RWread(rwops, bytes, 1u, (size_t)size) != (size_t)size) {
+		mem_free(bytes);
+		return true;
+	}
+	request->ktx2_bytes = bytes;
+	request->ktx2_size = (size_t)size;
+	return true;
+}
+
+static void request_decode(void* const data) {
+	texture_load_request* const request = data;
+
+	SDL_RWops* const rwops = data_file_open(request->cache, DATA_PATH_RESOURCE, request->filename);
+	if (rwops != NULL) {
+		if (!ktx2_read(request, rwops) && SDL_RWseek(rwops, 0, RW_SEEK_SET) == 0) {
+			request->surface = data_texture_decode_cached(request->cache, DATA_PATH_RESOURCE, request->filename, rwops);
+		}
+		SDL_RWclose(rwops);
+	}
+}
+
+static int SDLCALL loader_thread_func(void* const data) {
+	texture_loader_object* const loader = data;
+
+	threads_current_set(THREADS_CLASS_BACKGROUND);
+
+	while (true) {
+		SDL_SemWait(loader->decode_sem);
+		if (SDL_AtomicGet(&loader->quit)) {
+			break;
+		}
+
+		/*
+		 * All requests queued so far are decoded together, in parallel on the
+		 * job system's workers; the semaphore posts of requests taken early
+		 * just find the queue empty.
+		 */
+		texture_load_request* batch[MAX_DECODE_BATCH];
+		size_t num_batch = 0u;
+		while (num_batch < MAX_DECODE_BATCH && (batch[num_batch] = conqueue_ring_dequeue(loader->decode_queue)) != NULL) {
+			num_batch++;
+		}
+		if (num_batch == 0u) {
+			continue;
+		}
+
+		jobs_counter_type counter;
+		jobs_counter_init(&counter);
+		for (size_t i = 1u; i < num_batch; i++) {
+			jobs_run(request_decode, batch[i], &counter);
+		}
+		request_decode(batch[0u]);
+		jobs_wait(&counter);
+
+		SDL_MemoryBarrierRelease();
+		for (size_t i = 0u; i < num_batch; i++) {
+			if (!conqueue_ring_enqueue(loader->decoded_queue, batch[i])) {
+				log_printf("Error returning a decoded texture to the render thread\n");
+			}
+		}
+	}
+
+	/*
+	 * The loader thread is the consumer of the decode queue, so it must be
+	 * the thread destroying it. Requests left in the queue are still owned by
+	 * the render thread.
+	 */
+	conqueue_ring_destroy(loader->decode_queue);
+	loader->decode_queue = NULL;
+
+	return 0;
+}
+
+texture_loader_object* texture_loader_create(data_cache_object* const cache, const size_t upload_budget) {
+	assert(cache != NULL);
+	assert(upload_budget > 0u);
+
+	texture_loader_object* const loader = mem_calloc(1u, sizeof(texture_loader_object));
+	if (loader == NULL) {
+		return NULL;
+	}
+	loader->cache = cache;
+	loader->upload_budget = upload_budget;
+	loader->uploads_tail = &loader->uploads_head;
+	SDL_AtomicSet(&loader->quit, 0);
+
+	glGenBuffers(NUM_UPLOAD_BUFFERS, loader->buffers);
+	if (opengl_error("Error from glGenBuffers in texture_loader_create: ")) {
+		mem_free(loader);
+		return NULL;
+	}
+	for (size_t i = 0u; i < NUM_UPLOAD_BUFFERS; i++) {
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader->buffers[i]);
+		opengl_label(GL_BUFFER, loader->buffers[i], "texture upload buffer");
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)upload_budget, NULL, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	if (opengl_error("Error from glBufferData in texture_loader_create: ")) {
+		glDeleteBuffers(NUM_UPLOAD_BUFFERS, loader->buffers);
+		mem_free(loader);
+		return NULL;
+	}
+
+	loader->decode_queue = conqueue_ring_create(MAX_IN_FLIGHT);
+	loader->decoded_queue = conqueue_ring_create(MAX_IN_FLIGHT);
+	loader->decode_sem = SDL_CreateSemaphore(0u);
+	if (loader->decode_queue == NULL || loader->decoded_queue == NULL || loader->decode_sem == NULL) {
+		log_printf("Error creating the texture loader's queues\n");
+		if (loader->decode_queue != NULL) {
+			conqueue_ring_destroy(loader->decode_queue);
+		}
+		if (loader->decoded_queue != NULL) {
+			conqueue_ring_destroy(loader->decoded_queue);
+		}
+		if (loader->decode_sem != NULL) {
+			SDL_DestroySemaphore(loader->decode_sem);
+		}
+		glDeleteBuffers(NUM_UPLOAD_BUFFERS, loader->buffers);
+		mem_free(loader);
+		return NULL;
+	}
+
+	loader->thread = SDL_CreateThread(loader_thread_func, "texture_loader_thread", loader);
+	if (loader->thread == NULL) {
+		log_printf("Error creating the texture loader thread: %s\n", SDL_GetError());
+		conqueue_ring_destroy(loader->decode_queue);
+		conqueue_ring_destroy(loader->decoded_queue);
+		SDL_DestroySemaphore(loader->decode_sem);
+		glDeleteBuffers(NUM_UPLOAD_BUFFERS, loader->buffers);
+		mem_free(loader);
+		return NULL;
+	}
+
+	return loader;
+}
+
+static void request_free(texture_load_request* const request) {
+	if (request->surface != NULL) {
+		SDL_FreeSurface(request->surface);
+	}
+	if (request->ktx2_bytes != NULL) {
+		mem_free(request->ktx2_bytes);
+	}
+	if (request->name != 0u) {
+		glDeleteTextures(1, &request->name);
+	}
+	if (request->waiters != NULL) {
+		mem_free(request->waiters);
+	}
+	mem_free(request->filename);
+	mem_free(request);
+}
+
+/*
+ * Remove the request from the loads in flight and notify its waiters. The
+ * request must no longer be in the upload list.
+ */
+static void request_complete(texture_loader_object* const loader, texture_load_request* const request, const bool success) {
+	for (texture_load_request** link = &loader->requests; *link != NULL; link = &(*link)->next) {
+		if (*link == request) {
+			*link = request->next;
+			break;
+		}
+	}
+
+	for (size_t i = 0u; i < request->num_waiters; i++) {
+		request->waiters[i].done(request->waiters[i].data, success);
+	}
+	request_free(request);
+}
+
+void texture_loader_destroy(texture_loader_object* const loader) {
+	assert(loader != NULL);
+
+	SDL_AtomicSet(&loader->quit, 1);
+	SDL_SemPost(loader->decode_sem);
+	SDL_WaitThread(loader->thread, NULL);
+	SDL_DestroySemaphore(loader->decode_sem);
+
+	SDL_MemoryBarrierAcquire();
+	conqueue_ring_destroy(loader->decoded_queue);
+	while (loader->requests != NULL) {
+		request_complete(loader, loader->requests, false);
+	}
+
+	for (size_t i = 0u; i < NUM_UPLOAD_BUFFERS; i++) {
+		if (loader->fences[i] != NULL) {
+			glDeleteSync(loader->fences[i]);
+		}
+	}
+	glDeleteBuffers(NUM_UPLOAD_BUFFERS, loader->buffers);
+	mem_free(loader);
+}
+
+static texture_load_request* request_find(texture_loader_object* const loader, const char* const filename) {
+	for (texture_load_request* request = loader->requests; request != NULL; request = request->next) {
+		if (strcmp(request->filename, filename) == 0) {
+			return request;
+		}
+	}
+
+	return NULL;
+}
+
+static bool request_wait(texture_load_request* const request, const texture_loader_done_func done, void* const done_data) {
+	texture_loader_waiter* const new_waiters = mem_realloc(request->waiters, (request->num_waiters + 1u) * sizeof(texture_loader_waiter));
+	if (new_waiters == NULL) {
+		return false;
+	}
+	request->waiters = new_waiters;
+	request->waiters[request->num_waiters].done = done;
+	request->waiters[request->num_waiters].data = done_data;
+	request->num_waiters++;
+
+	return true;
+}
+
+/*
+ * Send requests not yet sent to the loader thread, while there's room in the
+ * ring queues.
+ */
+static void requests_queue(texture_loader_object* const loader) {
+	for (texture_load_request* request = loader->requests; request != NULL && loader->num_in_flight < MAX_IN_FLIGHT; request = request->next) {
+		if (request->queued) {
+			continue;
+		}
+
+		SDL_MemoryBarrierRelease();
+		const bool enqueued = conqueue_ring_enqueue(loader->decode_queue, request);
+		assert(enqueued);
+		if (!enqueued) {
+			break;
+		}
+		request->queued = true;
+		loader->num_in_flight++;
+		SDL_SemPost(loader->decode_sem);
+	}
+}
+
+bool texture_loader_load(texture_loader_object* const loader, const char* const filename, const texture_loader_done_func done, void* const done_data) {
+	assert(loader != NULL);
+	assert(filename != NULL);
+	assert(done != NULL);
+
+	texture_load_request* const pending = request_find(loader, filename);
+	if (pending != NULL) {
+		return request_wait(pending, done, done_data);
+	}
+
+	texture_load_request* const request = mem_calloc(1u, sizeof(texture_load_request));
+	if (request == NULL) {
+		return false;
+	}
+	request->filename = alloc_sprintf("%s", filename);
+	request->cache = loader->cache;
+	if (request->filename == NULL || !request_wait(request, done, done_data)) {
+		if (request->filename != NULL) {
+			mem_free(request->filename);
+		}
+		mem_free(request);
+		return false;
+	}
+
+	request->next = loader->requests;
+	loader->requests = request;
+	requests_queue(loader);
+
+	return true;
+}
+
+bool texture_loader_pending(texture_loader_object* const loader, const char* const filename) {
+	assert(loader != NULL);
+	assert(filename != NULL);
+
+	return request_find(loader, filename) != NULL;
+}
+
+bool texture_loader_busy(texture_loader_object* const loader) {
+	assert(loader != NULL);
+
+	return loader->requests != NULL;
+}
+
+/*
+ * Create the request's texture, and cache it once fully uploaded.
+ */
+static bool request_finish(texture_loader_object* const loader, texture_load_request* const request, const GLsizei width, const GLsizei height, const size_t gpu_size) {
+	if (request->surface != NULL) {
+		SDL_FreeSurface(request->surface);
+		request->surface = NULL;
+	}
+
+	/*
+	 * A synchronous load of the texture while uploading wins, so the texture
+	 * already in the cache stays valid for anything referencing it.
+	 */
+	if (data_cache_contains(loader->cache, DATA_TYPE_TEXTURE, DATA_PATH_RESOURCE, request->filename)) {
+		request_complete(loader, request, true);
+		return true;
+	}
+
+	const data_object* const data = data_texture_create(loader->cache, DATA_PATH_RESOURCE, request->filename, request->name, width, height, gpu_size);
+	if (data == NULL) {
+		request_complete(loader, request, false);
+		return false;
+	}
+	request->name = 0u;
+	if (!data_cache_add(data)) {
+		data_unload(data);
+		request_complete(loader, request, false);
+		return false;
+	}
+
+	request_complete(loader, request, true);
+	return true;
+}
+
+bool texture_loader_update(texture_loader_object* const loader) {
+	assert(loader != NULL);
+
+	texture_load_request* decoded;
+	while ((decoded = conqueue_ring_dequeue(loader->decoded_queue)) != NULL) {
+		SDL_MemoryBarrierAcquire();
+		loader->num_in_flight--;
+		if (decoded->ktx2_bytes != NULL) {
+			GLsizei width, height;
+			size_t gpu_size;
+			decoded->name = data_texture_ktx2_upload(decoded->ktx2_bytes, decoded->ktx2_size, &width, &height, &gpu_size);
+			mem_free(decoded->ktx2_bytes);
+			decoded->ktx2_bytes = NULL;
+			if (decoded->name == 0u) {
+				log_printf("Error loading texture \"%s\"\n", decoded->filename);
+				request_complete(loader, decoded, false);
+			}
+			else {
+				request_finish(loader, decoded, width, height, gpu_size);
+			}
+		}
+		else if (decoded->surface == NULL) {
+			log_printf("Error decoding texture \"%s\"\n", decoded->filename);
+			request_complete(loader, decoded, false);
+		}
+		else if ((size_t)decoded->surface->w * 4u > loader->upload_budget) {
+			log_printf("Error: Texture \"%s\" is too wide to upload\n", decoded->filename);
+			request_complete(loader, decoded, false);
+		}
+		else {
+			decoded->next_upload = NULL;
+			*loader->uploads_tail = decoded;
+			loader->uploads_tail = &decoded->next_upload;
+		}
+	}
+	requests_queue(loader);
+
+	if (loader->uploads_head == NULL) {
+		return true;
+	}
+
+	GLsync const fence = loader->fences[loader->buffer];
+	if (fence != NULL) {
+		const GLenum status = glClientWaitSync(fence, 0u, 0u);
+		if (status == GL_TIMEOUT_EXPIRED) {
+			return true;
+		}
+		glDeleteSync(fence);
+		loader->fences[loader->buffer] = NULL;
+		if (status == GL_WAIT_FAILED) {
+			opengl_error("Error from glClientWaitSync in texture_loader_update: ");
+			return false;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader->buffers[loader->buffer]);
+	unsigned char* const mapped = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER,
+		0,
+		(GLsizeiptr)loader->upload_budget,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT
+	);
+	if (mapped == NULL) {
+		opengl_error("Error from glMapBufferRange in texture_loader_update: ");
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		return false;
+	}
+
+	/*
+	 * Rows are copied tightly packed into the buffer, in as many whole rows
+	 * of as many textures as fit. The buffer must be unmapped before uploading
+	 * from it, so the regions are uploaded afterwards.
+	 */
+	upload_region regions[MAX_UPLOAD_REGIONS];
+	size_t num_regions = 0u;
+	size_t offset = 0u;
+	for (texture_load_request* request = loader->uploads_head; request != NULL && num_regions < MAX_UPLOAD_REGIONS; request = request->next_upload) {
+		const SDL_Surface* const surface = request->surface;
+		const size_t row_size = (size_t)surface->w * 4u;
+		int num_rows = (int)((loader->upload_budget - offset) / row_size);
+		if (num_rows == 0) {
+			break;
+		}
+		if (num_rows > surface->h - request->uploaded_rows) {
+			num_rows = surface->h - request->uploaded_rows;
+		}
+
+		const unsigned char* const pixels = (const unsigned char*)surface->pixels;
+		for (int row = 0; row < num_rows; row++) {
+			memcpy(mapped + offset + row * row_size, pixels + (size_t)(request->uploaded_rows + row) * surface->pitch, row_size);
+		}
+		regions[num_regions].request = request;
+		regions[num_regions].row = request->uploaded_rows;
+		regions[num_regions].num_rows = num_rows;
+		regions[num_regions].offset = offset;
+		num_regions++;
+		offset += num_rows * row_size;
+		request->uploaded_rows += num_rows;
+	}
+
+	if (!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER)) {
+		log_printf("Error from glUnmapBuffer in texture_loader_update: The upload buffer's contents were lost\n");
+		for (size_t i = 0u; i < num_regions; i++) {
+			regions[i].request->uploaded_rows = regions[i].row;
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+		return true;
+	}
+
+	/*
+	 * The textures' storage is allocated with the buffer unbound, as the
+	 * NULL pixels would otherwise be read from the buffer.
+	 */
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	for (size_t i = 0u; i < num_regions; i++) {
+		texture_load_request* const request = regions[i].request;
+		if (request->name == 0u) {
+			glGenTextures(1, &request->name);
+			glBindTexture(GL_TEXTURE_2D, request->name);
+			opengl_label(GL_TEXTURE, request->name, request->filename);
+			data_texture_parameters_set();
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, request->surface->w, request->surface->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, loader->buffers[loader->buffer]);
+	for (size_t i = 0u; i < num_regions; i++) {
+		texture_load_request* const request = regions[i].request;
+		glBindTexture(GL_TEXTURE_2D, request->name);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, regions[i].row, request->surface->w, regions[i].num_rows, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)regions[i].offset);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0u);
+	if (opengl_error("Error uploading textures in texture_loader_update: ")) {
+		return false;
+	}
+
+	loader->fences[loader->buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0u);
+	loader->buffer = (loader->buffer + 1u) % NUM_UPLOAD_BUFFERS;
+
+	bool success = true;
+	while (loader->uploads_head != NULL && loader->uploads_head->uploaded_rows == loader->uploads_head->surface->h) {
+		texture_load_request* const request = loader->uploads_head;
+		loader->uploads_head = request->next_upload;
+		if (loader->uploads_head == NULL) {
+			loader->uploads_tail = &loader->uploads_head;
+		}
+		const GLsizei width = request->surface->w;
+		const GLsizei height = request->surface->h;
+		success = request_finish(loader, request, width, height, (size_t)width * height * 4u) && success;
+	}
+
+	return success;
+}
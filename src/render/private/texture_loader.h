@@ -0,0 +1,76 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Asynchronous texture loader. Images are decoded in the loader's own thread,
+ * then uploaded by the render thread through a ring of pixel buffer objects,
+ * at most upload_budget bytes per texture_loader_update, streaming large
+ * textures across frames. Loaded textures are added to the data cache, which
+ * must outlive the loader. All functions must be called in the render thread.
+ */
+
+#include "data/data.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct texture_loader_object texture_loader_object;
+
+/*
+ * Called in the render thread when a load completes, success being whether the
+ * texture has been loaded and is cached.
+ */
+typedef void (* texture_loader_done_func)(void* const data, const bool success);
+
+texture_loader_object* texture_loader_create(data_cache_object* const cache, const size_t upload_budget);
+
+/*
+ * Destroy the loader, failing all loads still in flight.
+ */
+void texture_loader_destroy(texture_loader_object* const loader);
+
+/*
+ * Start loading the texture of the file in the resource path, done being
+ * called with done_data when the load completes. Loads of a file already being
+ * loaded share the same load.
+ */
+bool texture_loader_load(texture_loader_object* const loader, const char* const filename, const texture_loader_done_func done, void* const done_data);
+
+/*
+ * Returns true if the texture of the file is still being loaded.
+ */
+bool texture_loader_pending(texture_loader_object* const loader, const char* const filename);
+
+/*
+ * Returns true if any loads haven't completed yet.
+ */
+bool texture_loader_busy(texture_loader_object* const loader);
+
+/*
+ * Upload decoded textures, within the upload budget, completing the loads of
+ * fully uploaded textures. Uploading is skipped when the GPU is still reading
+ * from the next buffer of the ring, rather than waiting for it. Should be
+ * called once per frame.
+ */
+bool texture_loader_update(texture_loader_object* const loader);
@@ -0,0 +1,390 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "render/private/tilemap.h"
+#include "render/private/opengl.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include <math.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Changed tiles are tracked in square chunks of CHUNK_SIZE tiles, only changed
+ * chunks being uploaded, so a change of a few tiles of a large map uploads
+ * little of the map.
+ */
+#define CHUNK_SIZE 32u
+
+#define TILES_TEXTURE_UNIT 1
+
+/*
+ * Each instance is a tile of the visible range, range.xy being the first tile
+ * and range.z the number of columns of the range. Empty tiles are collapsed
+ * onto a point outside of clip space, so they produce no fragments.
+ */
+static const char* const vertex_src = "\
+#version 330\n\
+out vec2 f_position;\
+uniform mat4 view;\
+uniform usampler2D tiles;\
+uniform ivec3 range;\
+uniform vec2 tile_size;\
+uniform vec2 sheet_dimensions;\
+uniform uint sheet_columns;\
+const vec2 vertices[6] = vec2[] (\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 0.0),\
+	vec2(0.0, 0.0),\
+	vec2(0.0, 1.0),\
+	vec2(1.0, 1.0),\
+	vec2(1.0, 0.0)\
+);\
+void main() {\
+	ivec2 cell = range.xy + ivec2(gl_InstanceID % range.z, gl_InstanceID / range.z);\
+	uint tile = texelFetch(tiles, cell, 0).r;\
+	if (tile == 0u) {\
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);\
+		f_position = vec2(0.0);\
+		return;\
+	}\
+	tile -= 1u;\
+	vec2 vertex = vertices[gl_VertexID % 6];\
+	gl_Position = view * vec4((vec2(cell) + vertex) * tile_size, 0.0, 1.0);\
+	f_position = (vec2(float(tile % sheet_columns), float(tile / sheet_columns)) + vertex) * tile_size * sheet_dimensions;\
+}\
+";
+
+static const char* const fragment_src = "\
+#version 330\n\
+in vec2 f_position;\
+out vec4 out_color;\
+uniform sampler2D sheet;\
+void main() {\
+	out_color = texture(sheet, f_position);\
+}\
+";
+
+struct tilemaps_object {
+	GLuint program;
+	GLint view_location;
+	GLint range_location;
+	GLint tile_size_location;
+	GLint sheet_dimensions_location;
+	GLint sheet_columns_location;
+
+	/*
+	 * Tilemaps have no vertex attributes, but drawing requires a vertex
+	 * array be bound.
+	 */
+	GLuint array;
+};
+
+struct tilemap_object {
+	tilemaps_object* tilemaps;
+	data_texture_object* sheet;
+	size_t width, height;
+	float tile_width, tile_height;
+	GLuint texture;
+
+	/*
+	 * The tiles, row by row, as they'll be once changed chunks are uploaded.
+	 */
+	uint16_t* tiles;
+
+	bool* chunks_changed;
+	size_t chunks_width, chunks_height;
+	bool changed;
+
+	uint64_t version;
+};
+
+/*
+ * Tilemap versions are taken from one counter, so they're unique across all
+ * tilemaps, even tilemaps created where a destroyed tilemap was.
+ */
+static uint64_t next_tilemap_version = 0u;
+
+tilemaps_object* tilemaps_create() {
+	tilemaps_object* const tilemaps = mem_calloc(1u, sizeof(tilemaps_object));
+	if (tilemaps == NULL) {
+		return NULL;
+	}
+
+	tilemaps->program = opengl_program_create(vertex_src, fragment_src);
+	if (tilemaps->program == 0u) {
+		log_printf("Error creating the tilemap program\n");
+		mem_free(tilemaps);
+		return NULL;
+	}
+	glUseProgram(tilemaps->program);
+	opengl_label(GL_PROGRAM, tilemaps->program, "tilemap program");
+	glUniform1i(glGetUniformLocation(tilemaps->program, "sheet"), 0);
+	glUniform1i(glGetUniformLocation(tilemaps->program, "tiles"), TILES_TEXTURE_UNIT);
+	tilemaps->view_location = glGetUniformLocation(tilemaps->program, "view");
+	tilemaps->range_location = glGetUniformLocation(tilemaps->program, "range");
+	tilemaps->tile_size_location = glGetUniformLocation(tilemaps->program, "tile_size");
+	tilemaps->sheet_dimensions_location = glGetUniformLocation(tilemaps->program, "sheet_dimensions");
+	tilemaps->sheet_columns_location = glGetUniformLocation(tilemaps->program, "sheet_columns");
+
+	glGenVertexArrays(1, &tilemaps->array);
+	if (opengl_error("Error from glGenVertexArrays in tilemaps_create: ")) {
+		tilemaps->array = 0u;
+		tilemaps_destroy(tilemaps);
+		return NULL;
+	}
+
+	return tilemaps;
+}
+
+void tilemaps_destroy(tilemaps_object* const tilemaps) {
+	assert(tilemaps != NULL);
+
+	if (tilemaps->array != 0u) {
+		glDeleteVertexArrays(1, &tilemaps->array);
+	}
+	if (tilemaps->program != 0u) {
+		glDeleteProgram(tilemaps->program);
+	}
+	mem_free(tilemaps);
+}
+
+/*
+ * Upload the rectangle of the tiles within the tilemap's texture, which must
+ * be bound. The tiles' rows are the width of the tilemap, so unpacking is set
+ * to pick the rectangle out of them, then set back to the defaults.
+ */
+static bool tiles_upload(tilemap_object* const tilemap, const size_t x, const size_t y, const size_t width, const size_t height) {
+	GLint alignment;
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)tilemap->width);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, (GLint)x);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, (GLint)y);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint)x, (GLint)y, (GLsizei)width, (GLsizei)height, GL_RED_INTEGER, GL_UNSIGNED_SHORT, tilemap->tiles);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+	return !opengl_error("Error from glTexSubImage2D uploading tilemap tiles: ");
+}
+
+tilemap_object* tilemap_create(tilemaps_object* const tilemaps, data_texture_object* const sheet, const size_t width, const size_t height, const float tile_width, const float tile_height, const uint16_t* const tiles) {
+	assert(tilemaps != NULL);
+	assert(sheet != NULL);
+	assert(tile_width > 0.0f && tile_height > 0.0f);
+
+	GLint max_size;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	if (width == 0u || height == 0u || width > (size_t)max_size || height > (size_t)max_size) {
+		log_printf("Error: Tilemap dimensions of %zux%zu are unsupported\n", width, height);
+		return NULL;
+	}
+
+	tilemap_object* const tilemap = mem_calloc(1u, sizeof(tilemap_object));
+	if (tilemap == NULL) {
+		return NULL;
+	}
+	tilemap->tilemaps = tilemaps;
+	tilemap->sheet = sheet;
+	tilemap->width = width;
+	tilemap->height = height;
+	tilemap->tile_width = tile_width;
+	tilemap->tile_height = tile_height;
+	tilemap->chunks_width = (width + CHUNK_SIZE - 1u) / CHUNK_SIZE;
+	tilemap->chunks_height = (height + CHUNK_SIZE - 1u) / CHUNK_SIZE;
+	tilemap->version = next_tilemap_version++;
+
+	tilemap->tiles = mem_calloc(width * height, sizeof(uint16_t));
+	tilemap->chunks_changed = mem_calloc(tilemap->chunks_width * tilemap->chunks_height, sizeof(bool));
+	if (tilemap->tiles == NULL || tilemap->chunks_changed == NULL) {
+		tilemap_destroy(tilemap);
+		return NULL;
+	}
+	if (tiles != NULL) {
+		memcpy(tilemap->tiles, tiles, width * height * sizeof(uint16_t));
+	}
+
+	glGenTextures(1, &tilemap->texture);
+	if (opengl_error("Error from glGenTextures in tilemap_create: ")) {
+		tilemap->texture = 0u;
+		tilemap_destroy(tilemap);
+		return NULL;
+	}
+	glActiveTexture(GL_TEXTURE0 + TILES_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, tilemap->texture);
+	opengl_label(GL_TEXTURE, tilemap->texture, "tilemap");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16UI, (GLsizei)width, (GLsizei)height, 0, GL_RED_INTEGER, GL_UNSIGNED_SHORT, NULL);
+	const bool uploaded =
+		!opengl_error("Error from glTexImage2D in tilemap_create: ") &&
+		tiles_upload(tilemap, 0u, 0u, width, height);
+	glActiveTexture(GL_TEXTURE0);
+	if (!uploaded) {
+		tilemap_destroy(tilemap);
+		return NULL;
+	}
+
+	return tilemap;
+}
+
+void tilemap_destroy(tilemap_object* const tilemap) {
+	assert(tilemap != NULL);
+
+	if (tilemap->texture != 0u) {
+		glDeleteTextures(1, &tilemap->texture);
+	}
+	if (tilemap->chunks_changed != NULL) {
+		mem_free(tilemap->chunks_changed);
+	}
+	if (tilemap->tiles != NULL) {
+		mem_free(tilemap->tiles);
+	}
+	mem_free(tilemap);
+}
+
+data_texture_object* tilemap_sheet_get(tilemap_object* const tilemap) {
+	assert(tilemap != NULL);
+
+	return tilemap->sheet;
+}
+
+void tilemap_update(tilemap_object* const tilemap, const size_t x, const size_t y, const size_t width, const size_t height, const uint16_t* const tiles) {
+	assert(tilemap != NULL);
+	assert(x + width <= tilemap->width && y + height <= tilemap->height);
+	assert(width == 0u || height == 0u || tiles != NULL);
+
+	if (width == 0u || height == 0u) {
+		return;
+	}
+
+	for (size_t row = 0u; row < height; row++) {
+		memcpy(&tilemap->tiles[(y + row) * tilemap->width + x], &tiles[row * width], width * sizeof(uint16_t));
+	}
+	for (size_t chunk_y = y / CHUNK_SIZE; chunk_y <= (y + height - 1u) / CHUNK_SIZE; chunk_y++) {
+		for (size_t chunk_x = x / CHUNK_SIZE; chunk_x <= (x + width - 1u) / CHUNK_SIZE; chunk_x++) {
+			tilemap->chunks_changed[chunk_y * tilemap->chunks_width + chunk_x] = true;
+		}
+	}
+	tilemap->changed = true;
+	tilemap->version = next_tilemap_version++;
+}
+
+uint64_t tilemap_version_get(tilemap_object* const tilemap) {
+	assert(tilemap != NULL);
+
+	return tilemap->version;
+}
+
+/*
+ * Upload the changed chunks, returning the bytes uploaded in bytes. The
+ * tilemap's texture must be bound.
+ */
+static bool chunks_upload(tilemap_object* const tilemap, size_t* const bytes) {
+	*bytes = 0u;
+	if (!tilemap->changed) {
+		return true;
+	}
+
+	for (size_t chunk_y = 0u; chunk_y < tilemap->chunks_height; chunk_y++) {
+		for (size_t chunk_x = 0u; chunk_x < tilemap->chunks_width; chunk_x++) {
+			bool* const chunk_changed = &tilemap->chunks_changed[chunk_y * tilemap->chunks_width + chunk_x];
+			if (!*chunk_changed) {
+				continue;
+			}
+
+			const size_t x = chunk_x * CHUNK_SIZE;
+			const size_t y = chunk_y * CHUNK_SIZE;
+			const size_t width = x + CHUNK_SIZE <= tilemap->width ? CHUNK_SIZE : tilemap->width - x;
+			const size_t height = y + CHUNK_SIZE <= tilemap->height ? CHUNK_SIZE : tilemap->height - y;
+			if (!tiles_upload(tilemap, x, y, width, height)) {
+				return false;
+			}
+			*chunk_changed = false;
+			*bytes += width * height * sizeof(uint16_t);
+		}
+	}
+	tilemap->changed = false;
+	return true;
+}
+
+/*
+ * Get the range of tiles along one axis overlapping the interval, clamped to
+ * the tilemap.
+ */
+static void range_get(const float start, const float end, const float tile_size, const size_t num_tiles, size_t* const first, size_t* const last) {
+	const float first_tile = floorf(start / tile_size);
+	const float last_tile = ceilf(end / tile_size);
+	*first = first_tile > 0.0f ? (first_tile < (float)num_tiles ? (size_t)first_tile : num_tiles) : 0u;
+	*last = last_tile > 0.0f ? (last_tile < (float)num_tiles ? (size_t)last_tile : num_tiles) : 0u;
+}
+
+bool tilemap_draw(tilemap_object* const tilemap, const vec4 bounds, const mat4 view, sprites_stats_type* const stats) {
+	assert(tilemap != NULL);
+	assert(bounds != NULL);
+	assert(view != NULL);
+	assert(stats != NULL);
+
+	tilemaps_object* const tilemaps = tilemap->tilemaps;
+
+	glActiveTexture(GL_TEXTURE0 + TILES_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D, tilemap->texture);
+	size_t bytes;
+	const bool uploaded = chunks_upload(tilemap, &bytes);
+	glActiveTexture(GL_TEXTURE0);
+	if (!uploaded) {
+		return false;
+	}
+	stats->bytes += bytes;
+
+	size_t first_column, last_column, first_row, last_row;
+	range_get(bounds[0], bounds[2], tilemap->tile_width, tilemap->width, &first_column, &last_column);
+	range_get(bounds[1], bounds[3], tilemap->tile_height, tilemap->height, &first_row, &last_row);
+	if (first_column >= last_column || first_row >= last_row) {
+		return true;
+	}
+	const size_t num_columns = last_column - first_column;
+	const size_t num_tiles = num_columns * (last_row - first_row);
+
+	const float sheet_columns = floorf(tilemap->sheet->width / tilemap->tile_width);
+	glUseProgram(tilemaps->program);
+	glUniformMatrix4fv(tilemaps->view_location, 1, GL_FALSE, view);
+	glUniform3i(tilemaps->range_location, (GLint)first_column, (GLint)first_row, (GLint)num_columns);
+	glUniform2f(tilemaps->tile_size_location, tilemap->tile_width, tilemap->tile_height);
+	glUniform2f(tilemaps->sheet_dimensions_location, 1.0f / tilemap->sheet->width, 1.0f / tilemap->sheet->height);
+	glUniform1ui(tilemaps->sheet_columns_location, sheet_columns >= 1.0f ? (GLuint)sheet_columns : 1u);
+	glBindTexture(GL_TEXTURE_2D, tilemap->sheet->name);
+	glBindVertexArray(tilemaps->array);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)num_tiles);
+	if (opengl_error("Error from glDrawArraysInstanced in tilemap_draw: ")) {
+		return false;
+	}
+
+	stats->draws++;
+	stats->instances += num_tiles;
+	return true;
+}
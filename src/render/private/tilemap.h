@@ -0,0 +1,84 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Tilemaps, grids of tiles of a sheet, with the tile indices stored in an
+ * integer texture on the GPU. A tilemap is drawn with a single instanced draw
+ * of only the tiles within the visible rectangle, each tile's src rectangle in
+ * the sheet computed in the vertex shader from the sheet's grid of tiles, so
+ * drawing a tilemap costs the same however many tiles it has. Tiles are
+ * changed in a copy of the map kept on the CPU, only the changed chunks of the
+ * map being uploaded when the map is next drawn. All functions must be called
+ * in the render thread.
+ */
+
+#include "data/data_texture.h"
+#include "render/private/sprites.h"
+#include "util/maths.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The tilemaps object holds the shader program shared by all tilemaps, and
+ * must outlive all the tilemaps created with it.
+ */
+typedef struct tilemaps_object tilemaps_object;
+typedef struct tilemap_object tilemap_object;
+
+tilemaps_object* tilemaps_create();
+void tilemaps_destroy(tilemaps_object* const tilemaps);
+
+/*
+ * Create a tilemap of width by height tiles, each tile being tile_width by
+ * tile_height both in texels of the sheet, and in the units of the tilemap's
+ * layer. The sheet is split into a grid of tiles from its top-left, row by
+ * row. Tile values are indices into the grid plus one, with zero for empty
+ * tiles, so tiles can be NULL for an empty map, or must be width * height
+ * tiles, row by row. The tilemap's top-left is at the origin of its layer.
+ * Returns NULL upon failure, such as when the map is larger than the largest
+ * texture supported.
+ */
+tilemap_object* tilemap_create(tilemaps_object* const tilemaps, data_texture_object* const sheet, const size_t width, const size_t height, const float tile_width, const float tile_height, const uint16_t* const tiles);
+void tilemap_destroy(tilemap_object* const tilemap);
+data_texture_object* tilemap_sheet_get(tilemap_object* const tilemap);
+
+/*
+ * Replace the width by height rectangle of tiles at x, y with the tiles, row by
+ * row. The change is uploaded upon the next draw.
+ */
+void tilemap_update(tilemap_object* const tilemap, const size_t x, const size_t y, const size_t width, const size_t height, const uint16_t* const tiles);
+
+/*
+ * Returns a version that changes whenever the tilemap's tiles change.
+ */
+uint64_t tilemap_version_get(tilemap_object* const tilemap);
+
+/*
+ * Draw the tiles covering the visible bounds, in the tilemap's layer's
+ * coordinates, in the order left, top, right, bottom, with the view from the
+ * layer's coordinates to clip space.
+ */
+bool tilemap_draw(tilemap_object* const tilemap, const vec4 bounds, const mat4 view, sprites_stats_type* const stats);
@@ -24,7 +24,8 @@
  */
 
 /*
- * Simple render API. Layer indices are ordered bottom-to-top, 0 on up.
+ * Simple render API. Layer indices are ordered bottom-to-top, 0 on up, and
+ * must be less than RENDER_LAYERS_MAX.
  */
 
 #include "render/render_types.h"
@@ -32,9 +33,59 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#define RENDER_LAYERS_MAX ((size_t)1u << 16)
+
 typedef struct render_settings_type {
 	float width;
 	float height;
+
+	/*
+	 * Draw sprites in the compact format of packed_sprite_type, halving the
+	 * memory used per sprite, at the cost of the precision of sprite_type
+	 * sprites being reduced to that of packed_sprite_type. Best for pixel art
+	 * on screens no larger than 4096x4096. Sprites can be submitted as either
+	 * type regardless of this setting, but submitting the type matching the
+	 * setting avoids converting them.
+	 */
+	bool packed_sprites;
+
+	/*
+	 * Gather per layer stats, reported by render_stats_get. Sprites of
+	 * different layers are never drawn together while enabled, so only enable
+	 * this while profiling.
+	 */
+	bool layer_stats;
+
+	/*
+	 * The budget of GPU bytes for cached sheets, or zero for no budget. Beyond
+	 * the budget, the sheets least recently drawn before the current frame are
+	 * unloaded, so they're reloaded when next drawn. Sheets of batches are
+	 * kept loaded while the batches exist.
+	 */
+	size_t texture_budget;
+
+	/*
+	 * Cull sprites entirely outside of the width by height screen when
+	 * they're submitted, before they're copied into the layers. Only sprites
+	 * submitted with render_sprites, render_sprites_commit,
+	 * render_packed_sprites, and render_sprites_ex are culled.
+	 */
+	bool cull_sprites;
+
+	/*
+	 * Draw frames at a reduced resolution while they take longer than the
+	 * target of GPU time, upscaling them to the screen. The resolution is
+	 * restored a step at a time as frames get under the target again. Only
+	 * has an effect where GPU timing is supported, reported by the gpu_timed
+	 * stat. target_gpu_milliseconds of zero targets 90% of the duration of
+	 * render frames, and min_resolution_scale of zero allows down to half the
+	 * resolution on each axis. nearest_upscale upscales with nearest
+	 * filtering, for pixel art, otherwise linear filtering.
+	 */
+	bool dynamic_resolution;
+	float target_gpu_milliseconds;
+	float min_resolution_scale;
+	bool nearest_upscale;
 } render_settings_type;
 
 /*
@@ -46,10 +97,69 @@ bool render_start(const render_settings_type* const settings);
 
 /*
  * End a render frame. Must be called; it's fatally erroneous to not pair start
- * and end.
+ * and end. The end of the frame is ordered after everything recorded into the
+ * frame, regardless of order keys.
  */
 bool render_end();
 
+/*
+ * Capture the render API calls of the next num_frames frames, starting with
+ * the next render_start, into the named file in the save path, written once
+ * the last frame ends; the frames can then be replayed as a benchmark, with
+ * --benchmark replay --benchmark-capture <file>. Sprites, text, clears and
+ * cameras are captured, along with the filenames of the sheets and fonts they
+ * use, but calls in threads other than the app's thread and the commands of
+ * retained objects, such as batches, tilemaps and emitters, aren't. Must be
+ * called in the app's thread. Returns false if frames are already being
+ * captured, or upon failure.
+ */
+bool render_capture_start(const char* const filename, const uint64_t num_frames);
+
+/*
+ * Returns true while frames are being captured.
+ */
+bool render_capturing();
+
+/*
+ * Render lists let threads other than the app's thread call render API
+ * functions concurrently, such as jobs preparing sprites in parallel. While a
+ * thread is recording into a list, the render API functions it calls are
+ * recorded into the list; when the thread ends recording, the list is
+ * submitted to the current frame. All lists must be ended before the app's
+ * thread calls render_end. When the frame ends, what was rendered into it is
+ * ordered by ascending key, the app thread's own calls going before lists'
+ * calls of the same key, so the result is deterministic so long as the lists
+ * of a frame have unique keys. render_start and render_end must only be called
+ * by the app's thread.
+ *
+ * Lists must only be created and destroyed in the app's thread, while not
+ * recording, and only record in one thread at a time.
+ */
+typedef struct render_list_object render_list_object;
+
+render_list_object* render_list_create();
+void render_list_destroy(render_list_object* const list);
+
+/*
+ * Begin recording into the list in the calling thread, after the app's thread
+ * has called render_start. The thread must not already be recording. The key
+ * must be less than UINT64_MAX, which is reserved for render_end.
+ */
+bool render_list_begin(render_list_object* const list, const uint64_t key);
+
+/*
+ * End recording into the list in the calling thread, submitting it to the
+ * current frame.
+ */
+bool render_list_end(render_list_object* const list);
+
+/*
+ * Set the key of the app thread's own render API calls from now on in the
+ * current frame, to order them relative to lists. The key is 0 at the start of
+ * each frame.
+ */
+bool render_order_set(const uint64_t key);
+
 /*
  * Clear the rendered screen using the specified RGBA color. Colors are
  * specified in the range [0.0f, 1.0f], 0.0f as no-color (black) and 1.0f as
@@ -60,12 +170,259 @@ bool render_end();
  */
 bool render_clear(const float red, const float green, const float blue, const float alpha);
 
+/*
+ * Handles of sheets and fonts, for the *_handle variants of the render API
+ * functions that take sheet and font filenames. The filename variants get the
+ * handle for each call, so getting handles once and reusing them saves looking
+ * up filenames every call. Getting the handle of a filename again returns the
+ * same handle, and handles remain valid until the render API is deinitialized.
+ * Handles can be gotten by any thread, including threads recording into render
+ * lists, and gotten handles can be passed between threads. Returns
+ * RENDER_HANDLE_NONE upon failure.
+ */
+typedef uint32_t render_handle;
+#define RENDER_HANDLE_NONE ((render_handle)0u)
+render_handle render_sheet_handle_get(const char* const sheet_filename);
+render_handle render_font_handle_get(const char* const font_filename);
+
+/*
+ * Handle of the font loaded as a signed distance field font, whose pages are
+ * converted into distance fields when loaded, so text printed with the font
+ * stays sharp when scaled, and one font covers every text size. The handle is
+ * separate from the handle of the same font from render_font_handle_get.
+ */
+render_handle render_font_sdf_handle_get(const char* const font_filename);
+
+/*
+ * Get the sheet and src rectangle of the sprite of the name in the atlas, as
+ * packed by the directmedia_atlas tool, for drawing the sprite with the
+ * *_handle variants of the render API. Atlases are loaded by the first lookup
+ * and kept loaded, but each lookup still searches the atlas, so sprites should
+ * be looked up once and reused. Returns false if the atlas couldn't be loaded,
+ * or has no sprite of the name.
+ */
+bool render_atlas_sprite_get(const char* const atlas_filename, const char* const name, render_handle* const sheet, vec4 src);
+
 /*
  * Render the requested list of sprites. For best performance, batch up sprites
  * as largely as possible, into fewer render_sprites calls.
  */
 bool render_sprites(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites);
 
+/*
+ * Retained sprite batches, for sprites that rarely change, such as backgrounds.
+ * A batch's sprites are uploaded to the GPU once when the batch is created, and
+ * drawing the batch doesn't copy its sprites again. Like the other render API
+ * functions, these must be called between render_start and render_end; the
+ * batch functions return false or NULL upon failure.
+ */
+typedef struct render_batch_object render_batch_object;
+
+/*
+ * Create a batch of sprites of the sheet, drawn into layer layer_index. The
+ * batch's sprites are stored in the sprite format that's current at creation.
+ */
+render_batch_object* render_batch_create(const char* const sheet_filename, const size_t layer_index, const size_t num_sprites, const sprite_type* const batch_sprites);
+
+/*
+ * Replace the batch's sprites from start on with the updated sprites, in the
+ * current frame and all later frames.
+ */
+bool render_batch_update(render_batch_object* const batch, const size_t start, const size_t num_updated, const sprite_type* const updated_sprites);
+
+/*
+ * Destroy the batch. The batch can still be drawn in the current frame before
+ * it's destroyed, but can't be used in later frames.
+ */
+bool render_batch_destroy(render_batch_object* const batch);
+
+/*
+ * Draw the batch into its layer in the current frame, in order with other
+ * sprites drawn into the layer.
+ */
+bool render_batch_draw(render_batch_object* const batch);
+
+/*
+ * Tilemaps, grids of tiles of a sheet, such as the levels of tile-based games.
+ * The tiles are kept on the GPU, and only the tiles within the screen, as seen
+ * through the layer's camera, are drawn, in a single draw; so large maps cost
+ * no more to draw than small ones, and changing a few tiles only uploads those
+ * tiles' part of the map. Like batches, tilemap functions must be called
+ * between render_start and render_end, and return false or NULL upon failure.
+ */
+typedef struct render_tilemap_object render_tilemap_object;
+
+/*
+ * Create a tilemap of width by height tiles, drawn into layer layer_index, with
+ * its top-left at the layer's origin. Each tile is tile_width by tile_height,
+ * both in the sheet's pixels and the layer's coordinates, the sheet being split
+ * into a grid of tiles from its top-left, row by row. Each tile is zero for an
+ * empty tile, or one plus the index of a tile of the sheet's grid. tiles is
+ * width * height tiles row by row, or NULL for an empty map.
+ */
+render_tilemap_object* render_tilemap_create(const char* const sheet_filename, const size_t layer_index, const size_t width, const size_t height, const float tile_width, const float tile_height, const uint16_t* const tiles);
+
+/*
+ * Replace the width by height rectangle of the tilemap's tiles at x, y with
+ * the tiles, row by row, in the current frame and all later frames.
+ */
+bool render_tilemap_update(render_tilemap_object* const tilemap, const size_t x, const size_t y, const size_t width, const size_t height, const uint16_t* const tiles);
+
+/*
+ * Destroy the tilemap. The tilemap can still be drawn in the current frame
+ * before it's destroyed, but can't be used in later frames.
+ */
+bool render_tilemap_destroy(render_tilemap_object* const tilemap);
+
+/*
+ * Draw the tilemap into its layer in the current frame, in order with other
+ * sprites drawn into the layer.
+ */
+bool render_tilemap_draw(render_tilemap_object* const tilemap);
+
+/*
+ * Particle emitters, simulated on the GPU, so the only cost of an emitter's
+ * particles to the app is an update of the emitter's parameters each tick,
+ * however many particles there are. Like batches, emitter functions must be
+ * called between render_start and render_end, and return false or NULL upon
+ * failure.
+ */
+typedef struct render_emitter_object render_emitter_object;
+
+/*
+ * Create an emitter of up to capacity particles of the sheet, drawn into layer
+ * layer_index. Newly spawned particles replace the oldest particles, so the
+ * capacity should be at least the rate times the longest lifetime. The emitter
+ * spawns nothing until updated.
+ */
+render_emitter_object* render_emitter_create(const char* const sheet_filename, const size_t layer_index, const size_t capacity);
+
+/*
+ * Step the emitter's particles one tick with the parameters, which are used
+ * until the next update. Call once per app tick for the emitter's particles to
+ * move; the particles stay still in ticks the emitter isn't updated.
+ */
+bool render_emitter_update(render_emitter_object* const emitter, const emitter_type* const params);
+
+/*
+ * Destroy the emitter. The emitter can still be drawn in the current frame
+ * before it's destroyed, but can't be used in later frames.
+ */
+bool render_emitter_destroy(render_emitter_object* const emitter);
+
+/*
+ * Draw the emitter's particles into its layer in the current frame, in order
+ * with other sprites drawn into the layer.
+ */
+bool render_emitter_draw(render_emitter_object* const emitter);
+
+/*
+ * Set whether the sprites of a layer are grouped by sheet, rather than drawn in
+ * submission order, from the current frame on. Grouping can cut the number of
+ * draws of layers that mix many sheets, but should only be enabled for layers
+ * where the order of overlapping sprites of different sheets doesn't matter.
+ * Layers aren't grouped by default.
+ */
+bool render_layer_sheet_sorted_set(const size_t layer_index, const bool sheet_sorted);
+
+/*
+ * Set whether a layer is cached from the current frame on. A cached layer is
+ * rendered into an offscreen texture, only rendered again when the sprites
+ * submitted to it change, and otherwise drawn with just that texture, suiting
+ * layers with many sprites that rarely change. The layer's sprites have to be
+ * submitted every frame as usual. Layers aren't cached by default.
+ */
+bool render_layer_cached_set(const size_t layer_index, const bool cached);
+
+/*
+ * Set the camera of a layer from the current frame on, or NULL to draw the
+ * layer in screen coordinates again, the default. The camera transforms all
+ * the layer's sprites on the GPU, so scrolling, zooming or rotating a layer
+ * only costs changing its camera, not rewriting its sprites; the sprites are
+ * submitted in the layer's own coordinates, and culled against the screen as
+ * seen through the camera.
+ */
+bool render_layer_camera_set(const size_t layer_index, const camera_type* const camera);
+
+/*
+ * Force a cached layer to be rendered again, for changes not visible in the
+ * submitted sprites, such as a sheet reloaded in place.
+ */
+bool render_layer_invalidate(const size_t layer_index);
+
+/*
+ * Asynchronous loading of sprite sheets. Sheets not loaded this way are loaded
+ * synchronously, stalling the render thread, when first drawn. Sprites of a
+ * sheet submitted while it's loading are skipped, until the sheet is resident;
+ * creating a batch of a loading sheet loads it synchronously. The handle must be released with render_texture_load_release, which
+ * can be done at any time, even while the load is still in progress.
+ */
+typedef struct render_texture_load_object render_texture_load_object;
+
+typedef enum render_texture_load_status {
+	RENDER_TEXTURE_LOAD_PENDING,
+	RENDER_TEXTURE_LOAD_RESIDENT,
+	RENDER_TEXTURE_LOAD_FAILED
+} render_texture_load_status;
+
+/*
+ * Start loading the sheet, decoding it in a loader thread and uploading it
+ * across frames. Returns NULL upon failure.
+ */
+render_texture_load_object* render_texture_load(const char* const sheet_filename);
+
+/*
+ * Get the status of the load. Can be called at any time from any thread.
+ */
+render_texture_load_status render_texture_load_status_get(render_texture_load_object* const load);
+
+void render_texture_load_release(render_texture_load_object* const load);
+
+/*
+ * Same as render_sprites, but for packed sprites.
+ */
+bool render_packed_sprites(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const packed_sprite_type* const added_sprites);
+
+/*
+ * Same as render_sprites, but for extended sprites, with rotation, scaling and
+ * tinting done on the GPU. Sprites that don't need those should still use
+ * render_sprites, as extended sprites are over twice the size.
+ */
+bool render_sprites_ex(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_ex_type* const added_sprites);
+
+/*
+ * Same as render_sprites, but the sprites are tracked across app ticks by
+ * their IDs, ids[i] being the ID of added_sprites[i], for interpolation. While
+ * the program interpolates between app ticks, as set by
+ * prog_interpolation_set, frames are drawn at the display's refresh rate, each
+ * tracked sprite's dst being blended from the dst of the sprite of the same ID
+ * in the previous tick, to its dst in this tick. IDs must be unique among a
+ * frame's tracked sprites. Sprites whose ID wasn't in the previous tick, and
+ * all sprites while not interpolating, are drawn as given. Only use these for
+ * moving sprites, as they cost more than other sprites.
+ */
+bool render_sprites_tracked(const char* const sheet_filename, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites, const uint32_t* const ids);
+
+/*
+ * Reserve memory for num_reserved sprites to be rendered, owned by the current
+ * render frame, for filling in sprites in place rather than copying them in
+ * with render_sprites. Fill in the returned sprites, then call
+ * render_sprites_commit with the returned pointer; render API calls may be
+ * made between reserving and committing, committed sprites being ordered
+ * within the layer at the point of commit. The memory must not be accessed
+ * after committing, and is automatically released after the frame has been
+ * rendered, so there's no need to free it. Returns NULL upon failure.
+ */
+sprite_type* render_sprites_reserve(const char* const sheet_filename, const size_t layer_index, const size_t num_reserved);
+
+/*
+ * Commit the first num_committed sprites of reserved memory returned by
+ * render_sprites_reserve, for rendering. num_committed may be less than the
+ * count reserved, including zero, in which case nothing is rendered; the
+ * reserved memory of every reservation must be committed exactly once.
+ */
+bool render_sprites_commit(sprite_type* const reserved_sprites, const size_t num_committed);
+
 /*
  * Render the requested string directly, without formatting interpretation, using the indicated font.
  */
@@ -75,3 +432,104 @@ bool render_string(const char* const font_filename, const size_t layer_index, co
  * Render the requested formatted string, using the indicated font.
  */
 bool render_printf(const char* const font_filename, const size_t layer_index, const float x, const float y, const char* const format, ...);
+
+/*
+ * Same as the functions of the same name without "_handle", but with
+ * handles from render_sheet_handle_get and render_font_handle_get.
+ */
+bool render_sprites_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites);
+bool render_packed_sprites_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const packed_sprite_type* const added_sprites);
+bool render_sprites_ex_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_ex_type* const added_sprites);
+sprite_type* render_sprites_reserve_handle(const render_handle sheet, const size_t layer_index, const size_t num_reserved);
+bool render_sprites_tracked_handle(const render_handle sheet, const size_t layer_index, const size_t num_added, const sprite_type* const added_sprites, const uint32_t* const ids);
+bool render_string_handle(const render_handle font, const size_t layer_index, const float x, const float y, const char* const string);
+bool render_printf_handle(const render_handle font, const size_t layer_index, const float x, const float y, const char* const format, ...);
+
+/*
+ * Same as render_string_handle and render_printf_handle, but with the font's
+ * glyphs scaled; scaled text is only sharp with fonts from
+ * render_font_sdf_handle_get.
+ */
+bool render_string_scaled_handle(const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const string);
+bool render_printf_scaled_handle(const render_handle font, const size_t layer_index, const float x, const float y, const float scale, const char* const format, ...);
+
+/*
+ * Statistics of the cache of laid out text used by render_string and
+ * render_printf, as of the start of the latest rendered frame. Repeatedly
+ * printing identical text at the same position hits the cache.
+ */
+typedef struct render_print_cache_stats_type {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t num_layouts;
+	size_t num_bytes;
+} render_print_cache_stats_type;
+
+/*
+ * Get the text layout cache statistics. Can be called at any time from any
+ * thread.
+ */
+void render_print_cache_stats_get(render_print_cache_stats_type* const stats);
+
+/*
+ * Stats of up to this many layers are reported by render_stats_get.
+ */
+#define RENDER_STATS_LAYERS_MAX ((size_t)64u)
+
+typedef struct render_layer_stats_type {
+	size_t layer_index;
+	size_t draws;
+	size_t instances;
+	size_t bytes;
+} render_layer_stats_type;
+
+typedef struct render_layer_gpu_stats_type {
+	size_t layer_index;
+	double gpu_milliseconds;
+} render_layer_gpu_stats_type;
+
+/*
+ * Statistics of the latest drawn frame. bytes counts the sprite instances
+ * written to the streaming vertex buffers. GPU times are read back a few frames
+ * after being recorded, so they lag behind the other stats, and are only valid
+ * if gpu_timed is true, as not all OpenGL implementations support timing. The
+ * layers' stats are only gathered when the layer_stats setting is enabled, for
+ * the lowest RENDER_STATS_LAYERS_MAX layers drawn; the layers' GPU times are of
+ * the layers drawn in the frame the GPU times were measured in, which can differ
+ * from the layers of the latest frame. culled counts the sprites
+ * culled by the cull_sprites setting. texture_gpu_bytes counts
+ * the GPU memory of the textures_cached textures, excluding the texture array.
+ * resolution_scale is the scale of the resolution frames are drawn at, only
+ * below 1 with the dynamic_resolution setting enabled, and
+ * upscale_gpu_milliseconds the time taken to upscale them.
+ */
+typedef struct render_stats_type {
+	size_t draws;
+	size_t instances;
+	size_t bytes;
+
+	bool gpu_timed;
+	double frame_gpu_milliseconds;
+	double clear_gpu_milliseconds;
+	double sprites_gpu_milliseconds;
+	double layers_gpu_milliseconds;
+	double upscale_gpu_milliseconds;
+
+	size_t culled;
+
+	size_t textures_cached;
+	size_t texture_gpu_bytes;
+
+	float resolution_scale;
+
+	size_t num_layers;
+	render_layer_stats_type layers[RENDER_STATS_LAYERS_MAX];
+	size_t num_gpu_layers;
+	render_layer_gpu_stats_type gpu_layers[RENDER_STATS_LAYERS_MAX];
+} render_stats_type;
+
+/*
+ * Get the render statistics. Can be called at any time from any thread.
+ */
+void render_stats_get(render_stats_type* const stats);
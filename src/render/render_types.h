@@ -24,8 +24,78 @@
  */
 
 #include "util/maths.h"
+#include <stdint.h>
 
 typedef struct sprite_type {
 	vec4 src;
 	vec4 dst;
 } sprite_type;
+
+/*
+ * Compact alternative to sprite_type, half the size, for sprites that don't
+ * need full float precision, such as pixel art. src is in whole texels, and
+ * dst is in fixed point, in units of 1/PACKED_SPRITE_DST_SCALE pixels, so dst
+ * can only represent [-4096.0f, 4096.0f) in 1/8 pixel steps.
+ */
+#define PACKED_SPRITE_DST_SCALE 8
+
+typedef struct packed_sprite_type {
+	uint16_t src[4];
+	int16_t dst[4];
+} packed_sprite_type;
+
+/*
+ * Sprite with a transform and tint applied on the GPU. The sprite is scaled by
+ * scale and rotated by rotation radians, clockwise on screen, about origin,
+ * which is relative to the top-left of dst; negative scales mirror the sprite.
+ * The texels are multiplied by tint. Only use these where the transform or tint
+ * is needed, as they're over twice the size of sprite_type.
+ */
+typedef struct sprite_ex_type {
+	vec4 src;
+	vec4 dst;
+	vec2 origin;
+	vec2 scale;
+	vec4 tint;
+	float rotation;
+} sprite_ex_type;
+
+/*
+ * View of a layer, with the point of the layer at x, y drawn at the center of
+ * the screen, the layer magnified by zoom and rotated by rotation radians,
+ * clockwise on screen, about the center of the screen.
+ */
+typedef struct camera_type {
+	float x;
+	float y;
+	float zoom;
+	float rotation;
+} camera_type;
+
+/*
+ * Parameters of a particle emitter, with time in app ticks. Each tick, rate
+ * particles are spawned at position, heading angle radians, clockwise on screen
+ * from the positive x axis, plus or minus spread radians, at a speed between
+ * the speeds, in layer units per tick; particles are then accelerated by
+ * acceleration each tick, and live between the lifetimes in ticks. Particles
+ * are drawn as the src of the emitter's sheet, centered on their positions,
+ * size_start wide when spawned, growing or shrinking to size_end wide when they
+ * die, keeping src's aspect ratio, and tinted from tint_start to tint_end over
+ * their lives.
+ */
+typedef struct emitter_type {
+	vec4 src;
+	vec2 position;
+	float rate;
+	float angle;
+	float spread;
+	float speed_min;
+	float speed_max;
+	vec2 acceleration;
+	float lifetime_min;
+	float lifetime_max;
+	float size_start;
+	float size_end;
+	vec4 tint_start;
+	vec4 tint_end;
+} emitter_type;
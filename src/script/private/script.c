@@ -0,0 +1,120 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "script/script.h"
+#include "script/private/script_private.h"
+#include "script/private/script_render.h"
+#include "main/prog.h"
+#include "data/data.h"
+#include "util/log.h"
+#include "util/private/mem_private.h"
+#include "lua/lualib.h"
+#include "lua/lauxlib.h"
+#include <assert.h>
+
+static lua_State* lua_state = NULL;
+static data_cache_object* data_cache = NULL;
+
+bool script_init() {
+	assert(lua_state == NULL);
+	assert(data_cache == NULL);
+
+	data_cache = data_cache_create(prog_resource_path_get(), prog_save_path_get());
+	if (data_cache == NULL) {
+		log_printf("Error creating the data cache for scripts\n");
+		return false;
+	}
+
+	lua_state = lua_newstate(mem_lua_alloc, NULL);
+	if (lua_state == NULL) {
+		log_printf("Error creating the Lua state\n");
+		data_cache_destroy(data_cache);
+		data_cache = NULL;
+		return false;
+	}
+	luaL_openlibs(lua_state);
+	script_render_open(lua_state);
+
+	return true;
+}
+
+void script_deinit() {
+	if (lua_state != NULL) {
+		lua_close(lua_state);
+		lua_state = NULL;
+	}
+	if (data_cache != NULL) {
+		data_cache_destroy(data_cache);
+		data_cache = NULL;
+	}
+}
+
+bool script_load(const char* const filename) {
+	assert(lua_state != NULL);
+	assert(filename != NULL);
+
+	data_load_status status;
+	const data_object* const data = data_load(data_cache, DATA_TYPE_RAW, DATA_PATH_SAVE_THEN_RESOURCE, filename, &status);
+	if (status != DATA_LOAD_STATUS_SUCCESS) {
+		log_printf("Error loading script \"%s\"\n", filename);
+		return false;
+	}
+
+	const char* const chunk_name = lua_pushfstring(lua_state, "@%s", filename);
+	const bool success =
+		luaL_loadbufferx(lua_state, (const char*)data->raw->bytes, data->raw->size, chunk_name, "t") == LUA_OK &&
+		lua_pcall(lua_state, 0, 0, 0) == LUA_OK;
+	data_unload(data);
+	if (!success) {
+		log_printf("Error running script \"%s\": %s\n", filename, lua_tostring(lua_state, -1));
+		lua_pop(lua_state, 2);
+		return false;
+	}
+	lua_pop(lua_state, 1);
+
+	return true;
+}
+
+bool script_update(const uint64_t current_time) {
+	assert(lua_state != NULL);
+
+	if (lua_getglobal(lua_state, "update") != LUA_TFUNCTION) {
+		lua_pop(lua_state, 1);
+		return true;
+	}
+	lua_pushinteger(lua_state, (lua_Integer)current_time);
+	if (lua_pcall(lua_state, 1, 0, 0) != LUA_OK) {
+		log_printf("Error running the script update function: %s\n", lua_tostring(lua_state, -1));
+		lua_pop(lua_state, 1);
+		return false;
+	}
+
+	return true;
+}
+
+lua_State* script_state_get() {
+	assert(lua_state != NULL);
+
+	return lua_state;
+}
@@ -0,0 +1,247 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "script/private/script_render.h"
+#include "render/render.h"
+#include "lua/lauxlib.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SPRITE_ARRAY_METATABLE "render.sprite_array"
+
+/*
+ * Userdata of sprite arrays; the sprites are stored inline, exactly as
+ * render_sprites_handle takes them.
+ */
+typedef struct sprite_array_type {
+	lua_Integer capacity;
+	lua_Integer count;
+	sprite_type sprites[];
+} sprite_array_type;
+
+static sprite_array_type* sprite_array_check(lua_State* const L, const int arg) {
+	return luaL_checkudata(L, arg, SPRITE_ARRAY_METATABLE);
+}
+
+/*
+ * Get the sprite at the 1-based index argument, which must be within
+ * [1, limit].
+ */
+static sprite_type* sprite_check(lua_State* const L, sprite_array_type* const array, const int arg, const lua_Integer limit) {
+	const lua_Integer i = luaL_checkinteger(L, arg);
+	luaL_argcheck(L, i >= 1 && i <= limit, arg, "sprite index out of range");
+	return &array->sprites[i - 1];
+}
+
+static render_handle handle_check(lua_State* const L, const int arg) {
+	const lua_Integer handle = luaL_checkinteger(L, arg);
+	luaL_argcheck(L, handle > 0 && handle <= UINT32_MAX, arg, "invalid handle");
+	return (render_handle)handle;
+}
+
+static size_t layer_check(lua_State* const L, const int arg) {
+	const lua_Integer layer_index = luaL_checkinteger(L, arg);
+	luaL_argcheck(L, layer_index >= 0, arg, "invalid layer index");
+	return (size_t)layer_index;
+}
+
+static int sprite_array_set(lua_State* const L) {
+	sprite_array_type* const array = sprite_array_check(L, 1);
+	sprite_type* const sprite = sprite_check(L, array, 2, array->capacity);
+	for (int i = 0; i < 4; i++) {
+		sprite->src[i] = (float)luaL_checknumber(L, 3 + i);
+		sprite->dst[i] = (float)luaL_checknumber(L, 7 + i);
+	}
+	const lua_Integer index = sprite - array->sprites + 1;
+	if (array->count < index) {
+		array->count = index;
+	}
+	return 0;
+}
+
+static int sprite_array_get(lua_State* const L) {
+	sprite_array_type* const array = sprite_array_check(L, 1);
+	const sprite_type* const sprite = sprite_check(L, array, 2, array->capacity);
+	for (int i = 0; i < 4; i++) {
+		lua_pushnumber(L, sprite->src[i]);
+	}
+	for (int i = 0; i < 4; i++) {
+		lua_pushnumber(L, sprite->dst[i]);
+	}
+	return 8;
+}
+
+static int sprite_array_move(lua_State* const L) {
+	sprite_array_type* const array = sprite_array_check(L, 1);
+	sprite_type* const sprite = sprite_check(L, array, 2, array->capacity);
+	sprite->dst[0] = (float)luaL_checknumber(L, 3);
+	sprite->dst[1] = (float)luaL_checknumber(L, 4);
+	return 0;
+}
+
+static int sprite_array_translate(lua_State* const L) {
+	sprite_array_type* const array = sprite_array_check(L, 1);
+	const lua_Integer first = luaL_checkinteger(L, 2);
+	const lua_Integer last = luaL_checkinteger(L, 3);
+	luaL_argcheck(L, first >= 1, 2, "sprite index out of range");
+	luaL_argcheck(L, last <= array->capacity, 3, "sprite index out of range");
+	const float dx = (float)luaL_checknumber(L, 4);
+	const float dy = (float)luaL_checknumber(L, 5);
+	for (lua_Integer i = first - 1; i < last; i++) {
+		array->sprites[i].dst[0] += dx;
+		array->sprites[i].dst[1] += dy;
+	}
+	return 0;
+}
+
+static int sprite_array_resize(lua_State* const L) {
+	sprite_array_type* const array = sprite_array_check(L, 1);
+	const lua_Integer count = luaL_checkinteger(L, 2);
+	luaL_argcheck(L, count >= 0 && count <= array->capacity, 2, "count out of range");
+	array->count = count;
+	return 0;
+}
+
+static int sprite_array_capacity(lua_State* const L) {
+	lua_pushinteger(L, sprite_array_check(L, 1)->capacity);
+	return 1;
+}
+
+static int sprite_array_len(lua_State* const L) {
+	lua_pushinteger(L, sprite_array_check(L, 1)->count);
+	return 1;
+}
+
+static int binding_sprite_array(lua_State* const L) {
+	const lua_Integer capacity = luaL_checkinteger(L, 1);
+	luaL_argcheck(L, capacity >= 0 && (size_t)capacity <= (SIZE_MAX - sizeof(sprite_array_type)) / sizeof(sprite_type), 1, "invalid capacity");
+
+	const size_t size = sizeof(sprite_array_type) + sizeof(sprite_type) * (size_t)capacity;
+	sprite_array_type* const array = lua_newuserdatauv(L, size, 0);
+	memset(array, 0, size);
+	array->capacity = capacity;
+	luaL_setmetatable(L, SPRITE_ARRAY_METATABLE);
+	return 1;
+}
+
+static int binding_sheet(lua_State* const L) {
+	const char* const filename = luaL_checkstring(L, 1);
+	const render_handle sheet = render_sheet_handle_get(filename);
+	if (sheet == RENDER_HANDLE_NONE) {
+		return luaL_error(L, "error getting the handle of sheet \"%s\"", filename);
+	}
+	lua_pushinteger(L, sheet);
+	return 1;
+}
+
+static int binding_font(lua_State* const L) {
+	const char* const filename = luaL_checkstring(L, 1);
+	const render_handle font = render_font_handle_get(filename);
+	if (font == RENDER_HANDLE_NONE) {
+		return luaL_error(L, "error getting the handle of font \"%s\"", filename);
+	}
+	lua_pushinteger(L, font);
+	return 1;
+}
+
+static int binding_sprites(lua_State* const L) {
+	const render_handle sheet = handle_check(L, 1);
+	const size_t layer_index = layer_check(L, 2);
+	sprite_array_type* const array = sprite_array_check(L, 3);
+	const lua_Integer count = luaL_optinteger(L, 4, array->count);
+	luaL_argcheck(L, count >= 0 && count <= array->count, 4, "count out of range");
+
+	lua_pushboolean(L, count == 0 || render_sprites_handle(sheet, layer_index, (size_t)count, array->sprites));
+	return 1;
+}
+
+static int binding_print(lua_State* const L) {
+	const render_handle font = handle_check(L, 1);
+	const size_t layer_index = layer_check(L, 2);
+	const float x = (float)luaL_checknumber(L, 3);
+	const float y = (float)luaL_checknumber(L, 4);
+	const char* const string = luaL_checkstring(L, 5);
+
+	lua_pushboolean(L, render_string_handle(font, layer_index, x, y, string));
+	return 1;
+}
+
+static int binding_camera(lua_State* const L) {
+	const size_t layer_index = layer_check(L, 1);
+	if (lua_gettop(L) < 2) {
+		lua_pushboolean(L, render_layer_camera_set(layer_index, NULL));
+		return 1;
+	}
+
+	const camera_type camera = {
+		.x = (float)luaL_checknumber(L, 2),
+		.y = (float)luaL_checknumber(L, 3),
+		.zoom = (float)luaL_optnumber(L, 4, 1.0),
+		.rotation = (float)luaL_optnumber(L, 5, 0.0)
+	};
+	lua_pushboolean(L, render_layer_camera_set(layer_index, &camera));
+	return 1;
+}
+
+static int binding_clear(lua_State* const L) {
+	const float red = (float)luaL_checknumber(L, 1);
+	const float green = (float)luaL_checknumber(L, 2);
+	const float blue = (float)luaL_checknumber(L, 3);
+	const float alpha = (float)luaL_checknumber(L, 4);
+
+	lua_pushboolean(L, render_clear(red, green, blue, alpha));
+	return 1;
+}
+
+void script_render_open(lua_State* const L) {
+	static const luaL_Reg sprite_array_methods[] = {
+		{ "set", sprite_array_set },
+		{ "get", sprite_array_get },
+		{ "move", sprite_array_move },
+		{ "translate", sprite_array_translate },
+		{ "resize", sprite_array_resize },
+		{ "capacity", sprite_array_capacity },
+		{ NULL, NULL }
+	};
+	luaL_newmetatable(L, SPRITE_ARRAY_METATABLE);
+	lua_pushcfunction(L, sprite_array_len);
+	lua_setfield(L, -2, "__len");
+	luaL_newlib(L, sprite_array_methods);
+	lua_setfield(L, -2, "__index");
+	lua_pop(L, 1);
+
+	static const luaL_Reg render_functions[] = {
+		{ "sheet", binding_sheet },
+		{ "font", binding_font },
+		{ "sprite_array", binding_sprite_array },
+		{ "sprites", binding_sprites },
+		{ "print", binding_print },
+		{ "clear", binding_clear },
+		{ "camera", binding_camera },
+		{ NULL, NULL }
+	};
+	luaL_newlib(L, render_functions);
+	lua_setglobal(L, "render");
+}
@@ -0,0 +1,87 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Lua scripting for app code. The Lua state is created before app_init is
+ * called, and is only used in the app thread.
+ *
+ * Scripts get a global "render" table of bindings designed for batching, as a
+ * Lua-to-C call per sprite would cost far more than drawing the sprite:
+ *
+ * render.sheet(filename) and render.font(filename) return the interned handles
+ * of sheets and fonts, as from render_sheet_handle_get and
+ * render_font_handle_get. Get them once, when the script is loaded, and pass
+ * them to the other bindings, so no filenames are looked up per call.
+ *
+ * render.sprite_array(capacity) creates a sprite array, a userdata storing
+ * capacity sprite_type sprites, all zeroed, with a count of zero. Its methods
+ * use 1-based indices, like Lua tables do:
+ *   array:set(i, src_x, src_y, src_w, src_h, dst_x, dst_y, dst_w, dst_h)
+ *     sets sprite i, raising the count to i if it's below i.
+ *   array:get(i) returns the eight values of sprite i.
+ *   array:move(i, dst_x, dst_y) sets only the destination position of sprite i.
+ *   array:translate(first, last, dx, dy) offsets the destination positions of
+ *     sprites first through last.
+ *   array:resize(count) sets the count, up to the capacity.
+ *   array:capacity() returns the capacity, and #array returns the count.
+ *
+ * render.sprites(sheet, layer, array[, count]) submits the first count sprites
+ * of the array, by default all counted sprites, in one call to
+ * render_sprites_handle. The sprites are copied straight from the array, with
+ * no conversion.
+ *
+ * render.print(font, layer, x, y, string) and render.clear(red, green, blue,
+ * alpha) are the same as render_string_handle and render_clear.
+ *
+ * render.camera(layer, x, y[, zoom[, rotation]]) sets the camera of the layer,
+ * as render_layer_camera_set, zoom defaulting to 1 and rotation to 0, and
+ * render.camera(layer) removes it, so scrolling scripts move the camera
+ * rather than their sprites.
+ *
+ * The render bindings return what their C functions return, and raise errors
+ * on invalid arguments.
+ */
+
+#include "lua/lua.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Load and run the script file from the save directory, falling back to
+ * the resource directory. Returns false on errors, logging the error.
+ */
+bool script_load(const char* const filename);
+
+/*
+ * Call the global function "update" defined by loaded scripts, if it's
+ * defined, with current_time as its argument. Returns false if the call
+ * raised an error, logging the error.
+ */
+bool script_update(const uint64_t current_time);
+
+/*
+ * Get the Lua state, for registering the app's own bindings.
+ */
+lua_State* script_state_get();
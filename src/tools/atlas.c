@@ -0,0 +1,400 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Packer of loose images into atlases for the data library:
+ *
+ *     directmedia_atlas [--size SIZE] [--padding PADDING] OUTPUT ROOT IMAGE...
+ *
+ * Packs the images, named by their paths relative to the ROOT directory, into
+ * as few power-of-two sheets of at most SIZE by SIZE as it can, SIZE defaulting
+ * to 1024, the size of the renderer's texture array layers, so the sheets are
+ * drawn together with other sheets in the array. Images are PADDING texels
+ * apart, 1 by default, so filtering doesn't bleed images into each other.
+ *
+ * The sheets are written next to OUTPUT, named as OUTPUT without its extension,
+ * followed by _0.png, _1.png, and so on, and OUTPUT is written as the atlas
+ * metadata loaded as DATA_TYPE_ATLAS, in the format described in
+ * data/data_atlas.h.
+ */
+
+#include "data/data_atlas.h"
+#include "SDL_surface.h"
+#include "SDL_image.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+typedef struct atlas_rect {
+	int x, y, w, h;
+} atlas_rect;
+
+typedef struct atlas_image {
+	const char* name;
+	SDL_Surface* surface;
+	atlas_rect rect;
+	int sheet;
+} atlas_image;
+
+/*
+ * A sheet being packed with the MaxRects algorithm: free is the set of maximal
+ * free rectangles, each image placed in the free rectangle where it leaves the
+ * shortest leftover side, the free rectangles overlapping the placed image
+ * then being split around it.
+ */
+typedef struct atlas_sheet {
+	atlas_rect* free;
+	size_t free_length, free_size;
+	int used_w, used_h;
+} atlas_sheet;
+
+static bool free_add(atlas_sheet* const sheet, const atlas_rect rect) {
+	if (sheet->free_length == sheet->free_size) {
+		const size_t new_size = sheet->free_size > 0u ? sheet->free_size * 2u : 64u;
+		atlas_rect* const new_free = realloc(sheet->free, new_size * sizeof(atlas_rect));
+		if (new_free == NULL) {
+			return false;
+		}
+		sheet->free = new_free;
+		sheet->free_size = new_size;
+	}
+	sheet->free[sheet->free_length++] = rect;
+	return true;
+}
+
+static bool rect_contains(const atlas_rect* const outer, const atlas_rect* const inner) {
+	return
+		inner->x >= outer->x && inner->y >= outer->y &&
+		inner->x + inner->w <= outer->x + outer->w &&
+		inner->y + inner->h <= outer->y + outer->h;
+}
+
+/*
+ * Find the position for a w by h rectangle, returning false if it doesn't fit.
+ */
+static bool sheet_find(const atlas_sheet* const sheet, const int w, const int h, int* const x, int* const y) {
+	int best_short = INT_MAX;
+	int best_long = INT_MAX;
+	for (size_t i = 0u; i < sheet->free_length; i++) {
+		const atlas_rect* const free = &sheet->free[i];
+		if (free->w < w || free->h < h) {
+			continue;
+		}
+		const int leftover_w = free->w - w;
+		const int leftover_h = free->h - h;
+		const int leftover_short = leftover_w < leftover_h ? leftover_w : leftover_h;
+		const int leftover_long = leftover_w < leftover_h ? leftover_h : leftover_w;
+		if (leftover_short < best_short || (leftover_short == best_short && leftover_long < best_long)) {
+			best_short = leftover_short;
+			best_long = leftover_long;
+			*x = free->x;
+			*y = free->y;
+		}
+	}
+	return best_short != INT_MAX;
+}
+
+static bool sheet_place(atlas_sheet* const sheet, const atlas_rect* const placed) {
+	const size_t old_length = sheet->free_length;
+	for (size_t i = 0u; i < old_length; i++) {
+		const atlas_rect free = sheet->free[i];
+		if (
+			placed->x >= free.x + free.w || placed->x + placed->w <= free.x ||
+			placed->y >= free.y + free.h || placed->y + placed->h <= free.y
+		) {
+			continue;
+		}
+
+		// Mark the split rectangle for removal, then add what's left of it
+		// on each side of the placed rectangle.
+		sheet->free[i].w = 0;
+		if (placed->x > free.x && !free_add(sheet, (atlas_rect) { free.x, free.y, placed->x - free.x, free.h })) {
+			return false;
+		}
+		if (placed->x + placed->w < free.x + free.w && !free_add(sheet, (atlas_rect) { placed->x + placed->w, free.y, free.x + free.w - (placed->x + placed->w), free.h })) {
+			return false;
+		}
+		if (placed->y > free.y && !free_add(sheet, (atlas_rect) { free.x, free.y, free.w, placed->y - free.y })) {
+			return false;
+		}
+		if (placed->y + placed->h < free.y + free.h && !free_add(sheet, (atlas_rect) { free.x, placed->y + placed->h, free.w, free.y + free.h - (placed->y + placed->h) })) {
+			return false;
+		}
+	}
+
+	// Remove the split rectangles, and rectangles within other rectangles, so
+	// only maximal free rectangles remain.
+	size_t length = 0u;
+	for (size_t i = 0u; i < sheet->free_length; i++) {
+		const atlas_rect* const rect = &sheet->free[i];
+		bool redundant = rect->w == 0;
+		for (size_t j = 0u; !redundant && j < sheet->free_length; j++) {
+			const atlas_rect* const other = &sheet->free[j];
+			redundant =
+				j != i && other->w > 0 && rect_contains(other, rect) &&
+				(!rect_contains(rect, other) || j < i);
+		}
+		if (!redundant) {
+			sheet->free[length++] = *rect;
+		}
+	}
+	sheet->free_length = length;
+
+	if (placed->x + placed->w > sheet->used_w) {
+		sheet->used_w = placed->x + placed->w;
+	}
+	if (placed->y + placed->h > sheet->used_h) {
+		sheet->used_h = placed->y + placed->h;
+	}
+	return true;
+}
+
+static int power_of_two_get(const int value) {
+	int power = 1;
+	while (power < value) {
+		power *= 2;
+	}
+	return power;
+}
+
+/*
+ * Larger images are placed first, as smaller images fill the gaps between
+ * them better than the other way around.
+ */
+static int image_compare(const void* const lhs_data, const void* const rhs_data) {
+	const atlas_image* const lhs = lhs_data;
+	const atlas_image* const rhs = rhs_data;
+	const int lhs_long = lhs->surface->w > lhs->surface->h ? lhs->surface->w : lhs->surface->h;
+	const int rhs_long = rhs->surface->w > rhs->surface->h ? rhs->surface->w : rhs->surface->h;
+	if (lhs_long != rhs_long) {
+		return lhs_long > rhs_long ? -1 : 1;
+	}
+	const int lhs_area = lhs->surface->w * lhs->surface->h;
+	const int rhs_area = rhs->surface->w * rhs->surface->h;
+	if (lhs_area != rhs_area) {
+		return lhs_area > rhs_area ? -1 : 1;
+	}
+	return strcmp(lhs->name, rhs->name);
+}
+
+/*
+ * Copy the images of the sheet into a transparent surface of the sheet's size,
+ * and save it as a PNG.
+ */
+static bool sheet_write(const char* const filename, const int w, const int h, const atlas_image* const images, const size_t num_images, const int sheet) {
+	SDL_Surface* const surface = SDL_CreateRGBSurfaceWithFormat(0u, w, h, 32, SDL_PIXELFORMAT_RGBA32);
+	if (surface == NULL) {
+		return false;
+	}
+	for (int row = 0; row < h; row++) {
+		memset((uint8_t*)surface->pixels + (size_t)row * surface->pitch, 0, (size_t)w * 4u);
+	}
+	for (size_t i = 0u; i < num_images; i++) {
+		const atlas_image* const image = &images[i];
+		if (image->sheet != sheet) {
+			continue;
+		}
+		for (int row = 0; row < image->rect.h; row++) {
+			memcpy(
+				(uint8_t*)surface->pixels + (size_t)(image->rect.y + row) * surface->pitch + (size_t)image->rect.x * 4u,
+				(const uint8_t*)image->surface->pixels + (size_t)row * image->surface->pitch,
+				(size_t)image->rect.w * 4u
+			);
+		}
+	}
+	const bool saved = IMG_SavePNG(surface, filename) == 0;
+	SDL_FreeSurface(surface);
+	return saved;
+}
+
+int main(int argc, char** argv) {
+	int max_size = 1024;
+	int padding = 1;
+	int arg = 1;
+	while (arg + 1 < argc && (strcmp(argv[arg], "--size") == 0 || strcmp(argv[arg], "--padding") == 0)) {
+		const long value = strtol(argv[arg + 1], NULL, 10);
+		if (strcmp(argv[arg], "--size") == 0) {
+			max_size = value > 0 && value <= 16384 ? (int)value : 0;
+		}
+		else {
+			padding = value >= 0 && value <= 64 ? (int)value : -1;
+		}
+		arg += 2;
+	}
+	if (argc - arg < 3 || max_size == 0 || padding < 0) {
+		fprintf(stderr, "Usage: %s [--size SIZE] [--padding PADDING] OUTPUT ROOT IMAGE...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const char* const output_filename = argv[arg++];
+	const char* const root = argv[arg++];
+	const size_t num_images = (size_t)(argc - arg);
+
+	atlas_image* const images = calloc(num_images, sizeof(atlas_image));
+	if (images == NULL) {
+		fprintf(stderr, "Error allocating the images\n");
+		return EXIT_FAILURE;
+	}
+
+	bool success = true;
+	for (size_t i = 0u; success && i < num_images; i++) {
+		atlas_image* const image = &images[i];
+		image->name = argv[arg + (int)i];
+		image->sheet = -1;
+		if (strpbrk(image->name, "\r\n") != NULL) {
+			fprintf(stderr, "Error: Invalid image name \"%s\"\n", image->name);
+			success = false;
+			break;
+		}
+
+		const size_t path_size = strlen(root) + 1u + strlen(image->name) + 1u;
+		char* const path = malloc(path_size);
+		if (path == NULL) {
+			success = false;
+			break;
+		}
+		snprintf(path, path_size, "%s/%s", root, image->name);
+		SDL_Surface* const loaded = IMG_Load(path);
+		free(path);
+		if (loaded == NULL) {
+			fprintf(stderr, "Error loading \"%s\": %s\n", image->name, IMG_GetError());
+			success = false;
+			break;
+		}
+		image->surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0u);
+		SDL_FreeSurface(loaded);
+		if (image->surface == NULL) {
+			fprintf(stderr, "Error converting \"%s\"\n", image->name);
+			success = false;
+			break;
+		}
+		if (image->surface->w + padding > max_size || image->surface->h + padding > max_size) {
+			fprintf(stderr, "Error: \"%s\" is too large for %dx%d sheets\n", image->name, max_size, max_size);
+			success = false;
+			break;
+		}
+	}
+
+	if (success) {
+		qsort(images, num_images, sizeof(atlas_image), image_compare);
+	}
+
+	/*
+	 * Each sheet is filled with as many of the remaining images as fit, then
+	 * shrunk to the smallest power of two dimensions holding its images.
+	 */
+	size_t num_placed = 0u;
+	int num_sheets = 0;
+	int* sheet_sizes = NULL;
+	while (success && num_placed < num_images) {
+		int* const new_sheet_sizes = realloc(sheet_sizes, (size_t)(num_sheets + 1) * 2u * sizeof(int));
+		if (new_sheet_sizes == NULL) {
+			success = false;
+			break;
+		}
+		sheet_sizes = new_sheet_sizes;
+
+		atlas_sheet sheet = { 0 };
+		success = free_add(&sheet, (atlas_rect) { 0, 0, max_size, max_size });
+		for (size_t i = 0u; success && i < num_images; i++) {
+			atlas_image* const image = &images[i];
+			if (image->sheet >= 0) {
+				continue;
+			}
+			const int w = image->surface->w + padding;
+			const int h = image->surface->h + padding;
+			int x = 0, y = 0;
+			if (sheet_find(&sheet, w, h, &x, &y)) {
+				success = sheet_place(&sheet, &(atlas_rect) { x, y, w, h });
+				image->rect = (atlas_rect) { x, y, image->surface->w, image->surface->h };
+				image->sheet = num_sheets;
+				num_placed++;
+			}
+		}
+		free(sheet.free);
+		sheet_sizes[num_sheets * 2] = power_of_two_get(sheet.used_w);
+		sheet_sizes[num_sheets * 2 + 1] = power_of_two_get(sheet.used_h);
+		num_sheets++;
+	}
+
+	/*
+	 * Sheets are named after the output, relative to the output's directory.
+	 */
+	const char* const slash = strrchr(output_filename, '/');
+	const char* const base = slash != NULL ? slash + 1 : output_filename;
+	const char* const dot = strrchr(base, '.');
+	const size_t base_length = dot != NULL ? (size_t)(dot - base) : strlen(base);
+	const size_t directory_length = (size_t)(base - output_filename);
+	const size_t sheet_filename_size = directory_length + base_length + 32u;
+	char* const sheet_filename = malloc(sheet_filename_size);
+	if (sheet_filename == NULL) {
+		success = false;
+	}
+
+	FILE* output = NULL;
+	if (success && (output = fopen(output_filename, "w")) == NULL) {
+		fprintf(stderr, "Error opening \"%s\" for writing\n", output_filename);
+		success = false;
+	}
+	if (success) {
+		success = fprintf(output, "%s %d\n", DATA_ATLAS_MAGIC, DATA_ATLAS_VERSION) > 0;
+	}
+	for (int sheet = 0; success && sheet < num_sheets; sheet++) {
+		snprintf(sheet_filename, sheet_filename_size, "%.*s%.*s_%d.png", (int)directory_length, output_filename, (int)base_length, base, sheet);
+		if (!sheet_write(sheet_filename, sheet_sizes[sheet * 2], sheet_sizes[sheet * 2 + 1], images, num_images, sheet)) {
+			fprintf(stderr, "Error writing \"%s\"\n", sheet_filename);
+			success = false;
+			break;
+		}
+		success = fprintf(output, "sheet %.*s_%d.png\n", (int)base_length, base, sheet) > 0;
+	}
+	for (size_t i = 0u; success && i < num_images; i++) {
+		const atlas_image* const image = &images[i];
+		success = fprintf(output, "sprite %d %d %d %d %d %s\n", image->sheet, image->rect.x, image->rect.y, image->rect.w, image->rect.h, image->name) > 0;
+	}
+	if (output != NULL && fclose(output) != 0) {
+		success = false;
+	}
+	if (!success && output != NULL) {
+		fprintf(stderr, "Error writing \"%s\"\n", output_filename);
+		remove(output_filename);
+	}
+
+	free(sheet_filename);
+	free(sheet_sizes);
+	for (size_t i = 0u; i < num_images; i++) {
+		if (images[i].surface != NULL) {
+			SDL_FreeSurface(images[i].surface);
+		}
+	}
+	free(images);
+	if (!success) {
+		return EXIT_FAILURE;
+	}
+
+	printf("Packed %zu images into %d sheets\n", num_images, num_sheets);
+	return EXIT_SUCCESS;
+}
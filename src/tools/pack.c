@@ -0,0 +1,327 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Packer of pack files for the data library:
+ *
+ *     directmedia_pack [--lz4 | --zstd] OUTPUT ROOT FILE...
+ *
+ * Packs the files, named by their paths relative to the ROOT directory, into
+ * OUTPUT. With a compression option, each file is compressed as a single
+ * block, but stored uncompressed if compressing it doesn't save at least an
+ * eighth of its size, so already compressed files, such as PNG images, aren't
+ * decompressed for nothing when loaded. --zstd is only available in builds
+ * with PACK_ZSTD.
+ */
+
+#include "data/private/data_pack_format.h"
+#include "util/lz4.h"
+#ifdef PACK_ZSTD
+#include <zstd.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+typedef struct pack_entry {
+	const char* name;
+	size_t name_size;
+	uint64_t name_hash;
+	uint64_t offset;
+	uint64_t size;
+	uint64_t stored_size;
+	uint32_t name_offset;
+	data_pack_compression compression;
+} pack_entry;
+
+static void write_u16(uint8_t* const bytes, const uint16_t value) {
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void write_u32(uint8_t* const bytes, const uint32_t value) {
+	write_u16(bytes, (uint16_t)value);
+	write_u16(bytes + 2, (uint16_t)(value >> 16));
+}
+
+static void write_u64(uint8_t* const bytes, const uint64_t value) {
+	write_u32(bytes, (uint32_t)value);
+	write_u32(bytes + 4, (uint32_t)(value >> 32));
+}
+
+static int entry_compare(const void* const lhs_data, const void* const rhs_data) {
+	const pack_entry* const lhs = lhs_data;
+	const pack_entry* const rhs = rhs_data;
+	if (lhs->name_hash != rhs->name_hash) {
+		return lhs->name_hash < rhs->name_hash ? -1 : 1;
+	}
+	const size_t common_size = lhs->name_size < rhs->name_size ? lhs->name_size : rhs->name_size;
+	const int order = memcmp(lhs->name, rhs->name, common_size);
+	if (order != 0 || lhs->name_size == rhs->name_size) {
+		return order;
+	}
+	return lhs->name_size < rhs->name_size ? -1 : 1;
+}
+
+static uint8_t* file_read(const char* const root, const char* const name, size_t* const size) {
+	const size_t path_size = strlen(root) + 1u + strlen(name) + 1u;
+	char* const path = malloc(path_size);
+	if (path == NULL) {
+		return NULL;
+	}
+	snprintf(path, path_size, "%s/%s", root, name);
+
+	FILE* const file = fopen(path, "rb");
+	free(path);
+	if (file == NULL) {
+		return NULL;
+	}
+	uint8_t* bytes = NULL;
+	long file_size;
+	if (fseek(file, 0, SEEK_END) == 0 && (file_size = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0 && (bytes = malloc((size_t)file_size)) != NULL) {
+		if (fread(bytes, 1u, (size_t)file_size, file) != (size_t)file_size) {
+			free(bytes);
+			bytes = NULL;
+		}
+		else {
+			*size = (size_t)file_size;
+		}
+	}
+	fclose(file);
+	return bytes;
+}
+
+/*
+ * Compress the file, returning NULL if compressing it isn't worth it.
+ */
+static uint8_t* file_compress(const uint8_t* const bytes, const size_t size, const data_pack_compression compression, size_t* const stored_size) {
+	size_t capacity;
+	switch (compression) {
+	case DATA_PACK_COMPRESSION_LZ4:
+		capacity = lz4_compress_bound(size);
+		break;
+
+#ifdef PACK_ZSTD
+	case DATA_PACK_COMPRESSION_ZSTD:
+		capacity = ZSTD_compressBound(size);
+		break;
+#endif
+
+	default:
+		return NULL;
+	}
+
+	uint8_t* const stored = malloc(capacity);
+	if (stored == NULL) {
+		return NULL;
+	}
+	size_t compressed_size = 0u;
+	switch (compression) {
+	case DATA_PACK_COMPRESSION_LZ4:
+		compressed_size = lz4_compress(bytes, size, stored, capacity);
+		break;
+
+#ifdef PACK_ZSTD
+	case DATA_PACK_COMPRESSION_ZSTD:
+		compressed_size = ZSTD_compress(stored, capacity, bytes, size, 19);
+		if (ZSTD_isError(compressed_size)) {
+			compressed_size = 0u;
+		}
+		break;
+#endif
+
+	default:
+		break;
+	}
+
+	if (compressed_size == 0u || compressed_size > size - size / 8u) {
+		free(stored);
+		return NULL;
+	}
+	*stored_size = compressed_size;
+	return stored;
+}
+
+static bool padding_write(FILE* const file, uint64_t* const offset, const uint64_t alignment) {
+	static const uint8_t zeros[DATA_PACK_ALIGNMENT] = { 0u };
+	const uint64_t padding = (alignment - *offset % alignment) % alignment;
+	if (padding > 0u && fwrite(zeros, 1u, (size_t)padding, file) != (size_t)padding) {
+		return false;
+	}
+	*offset += padding;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	data_pack_compression compression = DATA_PACK_COMPRESSION_NONE;
+	int arg = 1;
+	if (arg < argc && strcmp(argv[arg], "--lz4") == 0) {
+		compression = DATA_PACK_COMPRESSION_LZ4;
+		arg++;
+	}
+	else if (arg < argc && strcmp(argv[arg], "--zstd") == 0) {
+#ifdef PACK_ZSTD
+		compression = DATA_PACK_COMPRESSION_ZSTD;
+		arg++;
+#else
+		fprintf(stderr, "Error: Zstd compression isn't supported by this build\n");
+		return EXIT_FAILURE;
+#endif
+	}
+	if (argc - arg < 3) {
+		fprintf(stderr, "Usage: %s [--lz4 | --zstd] OUTPUT ROOT FILE...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	const char* const output_filename = argv[arg++];
+	const char* const root = argv[arg++];
+	const size_t num_entries = (size_t)(argc - arg);
+	if (num_entries > UINT32_MAX) {
+		fprintf(stderr, "Error: Too many files\n");
+		return EXIT_FAILURE;
+	}
+
+	pack_entry* const entries = calloc(num_entries, sizeof(pack_entry));
+	if (entries == NULL) {
+		fprintf(stderr, "Error allocating the index\n");
+		return EXIT_FAILURE;
+	}
+
+	FILE* const output = fopen(output_filename, "wb");
+	if (output == NULL) {
+		fprintf(stderr, "Error opening \"%s\" for writing\n", output_filename);
+		free(entries);
+		return EXIT_FAILURE;
+	}
+
+	/*
+	 * The header is written last, once the index's offset is known.
+	 */
+	uint8_t header[DATA_PACK_HEADER_SIZE] = { 0u };
+	uint64_t offset = 0u;
+	bool success = fwrite(header, 1u, sizeof(header), output) == sizeof(header);
+	offset += sizeof(header);
+
+	uint64_t total_size = 0u;
+	uint64_t total_stored_size = 0u;
+	uint64_t names_size = 0u;
+	for (size_t i = 0u; success && i < num_entries; i++) {
+		pack_entry* const entry = &entries[i];
+		entry->name = argv[arg + (int)i];
+		entry->name_size = strlen(entry->name);
+		entry->name_hash = data_pack_hash(entry->name, entry->name_size);
+		if (entry->name_size == 0u || entry->name_size > UINT16_MAX || names_size > UINT32_MAX - entry->name_size) {
+			fprintf(stderr, "Error: Invalid file name \"%s\"\n", entry->name);
+			success = false;
+			break;
+		}
+		entry->name_offset = (uint32_t)names_size;
+		names_size += entry->name_size;
+
+		size_t size;
+		uint8_t* const bytes = file_read(root, entry->name, &size);
+		if (bytes == NULL) {
+			fprintf(stderr, "Error reading \"%s\"; empty files can't be packed\n", entry->name);
+			success = false;
+			break;
+		}
+		if (size > INT_MAX) {
+			fprintf(stderr, "Error: \"%s\" is too large to pack\n", entry->name);
+			free(bytes);
+			success = false;
+			break;
+		}
+
+		size_t stored_size = size;
+		uint8_t* const compressed = file_compress(bytes, size, compression, &stored_size);
+		entry->compression = compressed != NULL ? compression : DATA_PACK_COMPRESSION_NONE;
+		entry->size = size;
+		entry->stored_size = stored_size;
+
+		success = padding_write(output, &offset, DATA_PACK_ALIGNMENT);
+		entry->offset = offset;
+		const uint8_t* const stored = compressed != NULL ? compressed : bytes;
+		if (success && fwrite(stored, 1u, stored_size, output) != stored_size) {
+			success = false;
+		}
+		offset += stored_size;
+		total_size += size;
+		total_stored_size += stored_size;
+		free(compressed);
+		free(bytes);
+	}
+
+	qsort(entries, num_entries, sizeof(pack_entry), entry_compare);
+	for (size_t i = 1u; success && i < num_entries; i++) {
+		if (entry_compare(&entries[i - 1u], &entries[i]) == 0) {
+			fprintf(stderr, "Error: \"%s\" is listed more than once\n", entries[i].name);
+			success = false;
+		}
+	}
+
+	const uint64_t index_offset = (offset + 7u) & ~(uint64_t)7u;
+	success = success && padding_write(output, &offset, 8u);
+	for (size_t i = 0u; success && i < num_entries; i++) {
+		uint8_t bytes[DATA_PACK_ENTRY_SIZE];
+		write_u64(bytes, entries[i].name_hash);
+		write_u64(bytes + 8, entries[i].offset);
+		write_u64(bytes + 16, entries[i].size);
+		write_u64(bytes + 24, entries[i].stored_size);
+		write_u32(bytes + 32, entries[i].name_offset);
+		write_u16(bytes + 36, (uint16_t)entries[i].name_size);
+		write_u16(bytes + 38, (uint16_t)entries[i].compression);
+		success = fwrite(bytes, 1u, sizeof(bytes), output) == sizeof(bytes);
+	}
+	const uint64_t names_offset = index_offset + (uint64_t)num_entries * DATA_PACK_ENTRY_SIZE;
+
+	/*
+	 * Names are written in their original order, matching their offsets.
+	 */
+	for (int i = arg; success && i < argc; i++) {
+		const size_t name_size = strlen(argv[i]);
+		success = fwrite(argv[i], 1u, name_size, output) == name_size;
+	}
+
+	memcpy(header, DATA_PACK_MAGIC, DATA_PACK_MAGIC_SIZE);
+	write_u32(header + 8, DATA_PACK_VERSION);
+	write_u32(header + 12, (uint32_t)num_entries);
+	write_u64(header + 16, index_offset);
+	write_u64(header + 24, names_offset);
+	success = success && fseek(output, 0, SEEK_SET) == 0 && fwrite(header, 1u, sizeof(header), output) == sizeof(header);
+
+	if (fclose(output) != 0) {
+		success = false;
+	}
+	free(entries);
+	if (!success) {
+		fprintf(stderr, "Error writing \"%s\"\n", output_filename);
+		remove(output_filename);
+		return EXIT_FAILURE;
+	}
+
+	printf("Packed %zu files, %llu bytes stored as %llu bytes\n", num_entries, (unsigned long long)total_size, (unsigned long long)total_stored_size);
+	return EXIT_SUCCESS;
+}
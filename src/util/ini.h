@@ -90,3 +90,61 @@ bool ini_setf(ini_object* const ini, const char* const section, const char* cons
  * false if creating the printout failed.
  */
 bool ini_printout_get(ini_object* const ini, void** const printout, size_t* const size);
+
+/*
+ * Write a printout of the INI piece by piece through the write function,
+ * without building the whole printout in memory; write returns false if
+ * writing failed. Returns false if any write failed.
+ */
+typedef bool (* ini_write_func)(void* const data, const void* const bytes, const size_t size);
+bool ini_printout_write(ini_object* const ini, const ini_write_func write, void* const data);
+
+/*
+ * INI views parse INI text without copying it, keeping offsets into the text
+ * for each section, key, and value; the text must stay valid and unmodified
+ * for the lifetime of the view. Views are read-only. Section and key names are
+ * case-insensitive, as with INI objects.
+ */
+typedef struct ini_view_object ini_view_object;
+
+/*
+ * A string in a view's text, that is *NOT* NUL-terminated.
+ */
+typedef struct ini_string {
+	const char* text;
+	size_t length;
+} ini_string;
+
+/*
+ * A key resolved in a view, for reading its value without looking the key up
+ * again.
+ */
+typedef size_t ini_handle;
+#define INI_HANDLE_NONE ((ini_handle)0u)
+
+/*
+ * Create and return an INI view of the text. Returns NULL if the text is
+ * invalid or creation failed.
+ */
+ini_view_object* ini_view_create(const char* const data, const size_t size);
+
+void ini_view_destroy(ini_view_object* const view);
+
+/*
+ * Resolve a key of a section to a handle. If the key appears more than once in
+ * the section, the last is used, like with INI objects. Returns
+ * INI_HANDLE_NONE if the key isn't present.
+ */
+ini_handle ini_view_resolve(const ini_view_object* const view, const char* const section, const char* const key);
+
+/*
+ * Get the value of a resolved key, in constant time. Returns a string with a
+ * NULL text for INI_HANDLE_NONE.
+ */
+ini_string ini_view_get(const ini_view_object* const view, const ini_handle handle);
+
+/*
+ * Get the value of a resolved key with sscanf, like ini_getf. Returns EOF for
+ * INI_HANDLE_NONE.
+ */
+int ini_view_getf(const ini_view_object* const view, const ini_handle handle, const char* const format, ...);
@@ -0,0 +1,121 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Work-stealing job system, for spreading CPU-heavy work across all the cores.
+ * Each worker thread, and the thread that initialized the job system, has its
+ * own deque of jobs, pushing and popping jobs at one end, while idle threads
+ * steal jobs from the other end of other threads' deques. Jobs run from other
+ * threads, such as the data loaders' threads, are handed to the workers
+ * through a shared queue.
+ *
+ * Jobs must not block on anything other than jobs_wait, as blocked jobs hold
+ * up a worker. Jobs can run more jobs, and wait on them.
+ *
+ * If the job system isn't initialized, jobs are run immediately, in the
+ * thread running them, so code using jobs works the same either way.
+ */
+
+#include "SDL_atomic.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef void (* jobs_func)(void* const data);
+typedef void (* jobs_range_func)(void* const data, const size_t start, const size_t end);
+
+typedef struct jobs_waiter jobs_waiter;
+
+/*
+ * Counters track completion of groups of jobs: running a job with a counter
+ * increments the counter, and finishing the job decrements it, so the jobs
+ * are all done once it's back to zero. Counters must be initialized with
+ * jobs_counter_init before use, and must remain valid until waited on with
+ * jobs_wait. The fields are private.
+ */
+typedef struct jobs_counter_type {
+	SDL_atomic_t count;
+	SDL_SpinLock lock;
+	jobs_waiter* waiters;
+} jobs_counter_type;
+
+void jobs_counter_init(jobs_counter_type* const counter);
+
+/*
+ * Returns true if all jobs of the counter are done.
+ */
+bool jobs_counter_done(jobs_counter_type* const counter);
+
+/*
+ * Initialize the job system, starting num_workers worker threads, or a worker
+ * for every core not taken by the program's main and render threads if
+ * num_workers is zero. The calling thread gets its own deque. Must only be
+ * called once, before any jobs are run, in the main thread. Returns false
+ * upon failure.
+ */
+bool jobs_init(const size_t num_workers);
+
+/*
+ * Wait for the workers to finish their current jobs and stop them. Jobs not
+ * yet started are dropped.
+ */
+void jobs_deinit();
+
+/*
+ * Returns the number of threads that run jobs, including the thread that
+ * initialized the job system, or 1 if it's not initialized.
+ */
+size_t jobs_num_threads_get();
+
+/*
+ * Run func(data) as a job. If counter isn't NULL, it's incremented now, and
+ * decremented once the job is done. If the job can't be queued, it's run
+ * immediately instead.
+ */
+void jobs_run(const jobs_func func, void* const data, jobs_counter_type* const counter);
+
+/*
+ * Same as jobs_run, but the job is only started once all the jobs of
+ * dependency are done; if they already are, it's run immediately. counter is
+ * incremented now, so waiting on counter also waits on the deferred job.
+ * Returns false upon failure, in which case the job isn't run and counter
+ * isn't incremented.
+ */
+bool jobs_run_after(jobs_counter_type* const dependency, const jobs_func func, void* const data, jobs_counter_type* const counter);
+
+/*
+ * Wait for all jobs of the counter to be done, running other jobs while
+ * waiting rather than blocking, so any thread can wait, including jobs.
+ */
+void jobs_wait(jobs_counter_type* const counter);
+
+/*
+ * Call func(data, start, end) over subranges of [0, count) in parallel,
+ * returning once the whole range has been processed; the calling thread
+ * processes part of the range itself. The range is split into subranges of at
+ * least grain, unless the whole range is smaller; a grain of zero splits the
+ * range into a few subranges per thread. Subranges are processed in no
+ * particular order.
+ */
+void jobs_parallel_for(const size_t count, const size_t grain, const jobs_range_func func, void* const data);
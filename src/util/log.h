@@ -31,6 +31,7 @@
  */
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 /*
@@ -53,3 +54,66 @@ void log_printf(const char* const format, ...);
  * operations before setting the filename for the current thread.
  */
 void log_vprintf(const char* const format, va_list args);
+
+/*
+ * Log some text printf-style, deferring the formatting to the log writer
+ * thread. Only a compact record of the timestamp, the format pointer, and the
+ * raw arguments is stored in the current thread's log ring, so this costs far
+ * less in the calling thread than log_printf; only the first call in a thread
+ * allocates, creating the thread's ring.
+ *
+ * The format must remain valid for the whole run of the program, so should be
+ * a string literal. String arguments are copied into the record, truncated to
+ * fit; %n and wide character conversions aren't supported, and long double
+ * arguments are formatted as double. Formatted lines are prefixed with the
+ * thread name and the time in seconds since deferred logging started, and are
+ * written in large batches, to stdout when all logging goes to stdout,
+ * otherwise to log_deferred.txt. When the calling thread's ring is full, the
+ * record is dropped and counted, and the writer thread logs the number
+ * dropped.
+ *
+ * Before the deferred log writer is initialized, this behaves the same as
+ * log_printf.
+ */
+void log_deferred_printf(const char* const format, ...);
+
+/*
+ * What happens to text logged while the all-output queue, written by the log
+ * output thread, is as deep as the limit. Blocking waits for the writer thread
+ * to catch up, so nothing is lost; dropping discards the text, counting it,
+ * and the writer thread then outputs the number dropped.
+ */
+typedef enum log_overflow_policy {
+	LOG_OVERFLOW_BLOCK,
+	LOG_OVERFLOW_DROP,
+	LOG_OVERFLOW_NUM
+} log_overflow_policy;
+
+#define LOG_DEPTH_LIMIT_DEFAULT 65536
+
+/*
+ * Set the overflow policy and the depth limit of the all-output queue; a limit
+ * of zero leaves the queue unbounded. Can be called from any thread.
+ */
+void log_overflow_set(const log_overflow_policy policy, const size_t limit);
+
+typedef struct log_stats {
+	/*
+	 * The number of texts queued for the writer thread now, and the most
+	 * ever queued.
+	 */
+	size_t depth;
+	size_t depth_max;
+
+	size_t dropped;
+
+	/*
+	 * Whether writing the output has failed.
+	 */
+	bool failed;
+} log_stats;
+
+/*
+ * Get the statistics of the all-output queue. Can be called from any thread.
+ */
+void log_stats_get(log_stats* const stats);
@@ -0,0 +1,52 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * LZ4 block format compression, compatible with the reference LZ4 library's
+ * blocks. Compression is a fast greedy match search; decompression validates
+ * everything, so it's safe on untrusted data.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+ * The largest compressed size of size bytes.
+ */
+size_t lz4_compress_bound(const size_t size);
+
+/*
+ * Compress size bytes of src into dst, which has room for capacity bytes.
+ * Returns the compressed size, or 0 if dst is too small; a capacity of
+ * lz4_compress_bound(size) is always large enough.
+ */
+size_t lz4_compress(const void* const src, const size_t size, void* const dst, const size_t capacity);
+
+/*
+ * Decompress a block of src_size bytes into dst, which must be exactly the
+ * decompressed size, dst_size. Returns false if the block is invalid, or
+ * doesn't decompress to exactly dst_size bytes.
+ */
+bool lz4_decompress(const void* const src, const size_t src_size, void* const dst, const size_t dst_size);
@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <float.h>
 #include <limits.h>
+#include <stddef.h>
 
 #define MATHS_PId 3.14159265358979323846
 #define MATHS_PIf 3.14159265358979323846f
@@ -93,3 +94,29 @@ void mat4_rotatey(mat4 dst, const float angle);
 void mat4_rotatez(mat4 dst, const float angle);
 void mat4_scale(mat4 dst, const vec4 scale);
 void mat4_translate(mat4 dst, const vec3 translate);
+
+/*
+ * Batch kernels, processing whole arrays of tightly packed vectors at a time.
+ * dst can be the same array as the source, but the arrays can't otherwise
+ * overlap.
+ */
+
+/*
+ * Transform count vec4s by the matrix.
+ */
+void mat4_transform_vec4s(float* const dst, const mat4 transform, const float* const src, const size_t count);
+
+/*
+ * Transform count vec2s by the matrix, as points with a z of zero and a w of
+ * one, keeping x and y of the transformed points.
+ */
+void mat4_transform_vec2s(float* const dst, const mat4 transform, const float* const src, const size_t count);
+
+/*
+ * Build count rectangles of x, y, width, height from vec2 positions and sizes,
+ * each rectangle's position being offset by its size multiplied by anchor, so
+ * an anchor of { 0.5f, 0.5f } centers the rectangles on the positions. The
+ * rectangles are dst_stride floats apart, so they can be written directly into
+ * the dst fields of sprite arrays.
+ */
+void rects_build(float* const dst, const size_t dst_stride, const float* const positions, const float* const sizes, const vec2 anchor, const size_t count);
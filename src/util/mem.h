@@ -26,6 +26,7 @@
 #include "SDL_stdinc.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <stdint.h>
 #include <stddef.h>
 #include <stdbool.h>
@@ -58,6 +59,27 @@ typedef enum bytes_per_type {
 	BYTES_PER_MAX = SIZE_MAX
 } bytes_per_type;
 
+/*
+ * Subsystems allocations are counted against, with memory debugging. Each
+ * thread has a current tag that its allocations are counted against, set with
+ * mem_tag_set.
+ */
+typedef enum mem_tag_type {
+	MEM_TAG_NONE,
+	MEM_TAG_RENDER,
+	MEM_TAG_DATA,
+	MEM_TAG_LOG,
+	MEM_TAG_AUDIO,
+	MEM_TAG_COUNT
+} mem_tag_type;
+
+/*
+ * Allocations are counted in histogram buckets by requested size; bucket i
+ * counts sizes up to 16 << i bytes, above the previous bucket's, with the last
+ * bucket counting all larger sizes.
+ */
+#define MEM_HISTOGRAM_BUCKETS 16u
+
 #ifdef MEM_DEBUG
 void* SDLCALL mem_malloc(size_t size);
 void* SDLCALL mem_calloc(size_t nmemb, size_t size);
@@ -72,6 +94,38 @@ void mem_aligned_free(void* mem);
  */
 size_t mem_total();
 
+/*
+ * Returns the number of allocations made so far, counting reallocations.
+ */
+size_t mem_num_allocs();
+
+typedef struct mem_stats {
+	size_t total;
+	size_t allocs;
+	size_t frees;
+	size_t histogram[MEM_HISTOGRAM_BUCKETS];
+
+	/*
+	 * The allocations made and bytes allocated with each tag so far.
+	 */
+	size_t tag_allocs[MEM_TAG_COUNT];
+	size_t tag_bytes[MEM_TAG_COUNT];
+} mem_stats;
+
+/*
+ * Get the counts of all allocations made so far by all threads. Each thread
+ * counts its own allocations, so the allocating functions never contend
+ * between threads; getting the stats sums all threads' counts, so it's more
+ * expensive than allocating, though still fine to do every frame.
+ */
+void mem_stats_get(mem_stats* const stats);
+
+/*
+ * Set the calling thread's current tag, returning the previous tag, for
+ * restoring it after tagged allocations.
+ */
+mem_tag_type mem_tag_set(const mem_tag_type tag);
+
 #else
 #define mem_malloc SDL_malloc
 #define mem_calloc SDL_calloc
@@ -94,6 +148,12 @@ size_t mem_total();
 #endif
 
 #define mem_total() ((size_t)0)
+#define mem_num_allocs() ((size_t)0)
+
+static inline mem_tag_type mem_tag_set(const mem_tag_type tag) {
+	(void)tag;
+	return MEM_TAG_NONE;
+}
 
 #endif
 
@@ -150,23 +210,129 @@ size_t mem_total();
 size_t mem_left();
 
 /*
- * TODO: Implement and use a game-development-optimized bump memory allocator,
- * that accumulates allocation request sizes between update points, returning
- * typical mem_malloc allocations when the bump allocation memory buffer is
- * exhausted, extending the bump memory buffer upon calling some "update"
- * function (mem_bump_update?); that would result in the bump memory allocator
- * magically producing good performance without requiring the developer
- * preallocate sufficient memory ahead of time (though provide that as an
- * option).
+ * Arenas are bump allocators, for temporary allocations freed all at once.
+ * Allocations are carved out of blocks in order, with more blocks allocated as
+ * needed; resetting an arena that needed more than one block replaces its
+ * blocks with one block the size of all of them, so an arena used the same way
+ * each time settles into a single block, and allocating never calls into the
+ * heap. An arena must only be used by one thread at a time.
+ */
+typedef struct mem_arena_object mem_arena_object;
+
+/*
+ * A position in an arena, for freeing all the allocations made after it.
+ */
+typedef struct mem_arena_mark {
+	void* block;
+	size_t pos;
+} mem_arena_mark;
+
+/*
+ * Create an arena, with its first block of block_size bytes. Returns NULL if
+ * creation failed.
+ */
+mem_arena_object* mem_arena_create(const size_t block_size);
+
+void mem_arena_destroy(mem_arena_object* const arena);
+
+/*
+ * Allocate size bytes aligned to alignment, which must be a power of two.
+ * Returns NULL if allocation failed.
+ */
+void* mem_arena_alloc(mem_arena_object* const arena, const size_t size, const size_t alignment);
+
+/*
+ * Allocate nmemb zeroed elements of size bytes, aligned for any type. Returns
+ * NULL if allocation failed.
+ */
+void* mem_arena_calloc(mem_arena_object* const arena, const size_t nmemb, const size_t size);
+
+/*
+ * Format a string into the arena, like alloc_sprintf. Returns NULL if
+ * formatting or allocation failed.
+ */
+char* mem_arena_sprintf(mem_arena_object* const arena, const char* const format, ...);
+char* mem_arena_vsprintf(mem_arena_object* const arena, const char* const format, va_list args);
+
+mem_arena_mark mem_arena_mark_get(mem_arena_object* const arena);
+
+/*
+ * Free all the allocations made after the mark was gotten. Marks must be
+ * rewound to in the reverse order they were gotten in, and a mark is invalid
+ * after a reset.
+ */
+void mem_arena_rewind(mem_arena_object* const arena, const mem_arena_mark mark);
+
+/*
+ * Free all of the arena's allocations.
+ */
+void mem_arena_reset(mem_arena_object* const arena);
+
+/*
+ * Get the bytes allocated from the arena now, and the most allocated from it
+ * at once since it was created.
  */
+size_t mem_arena_used(const mem_arena_object* const arena);
+size_t mem_arena_high_water(const mem_arena_object* const arena);
 
-// TODO: Finalize the bump allocator code and use it once finalized.
-// TODO: Memory alignment must be indicated to the alloc functions, and handled appropriately.
+/*
+ * Get the calling thread's scratch arena, created on first use and destroyed
+ * when the thread exits. The main thread's scratch is reset at the end of
+ * each tick, and the render thread's at the end of each frame; other threads'
+ * scratches are never reset, so they must rewind to a mark after use. Returns
+ * NULL if the scratch couldn't be created.
+ */
+mem_arena_object* mem_scratch_get();
 
-typedef struct mem_bump_object mem_bump_object;
+/*
+ * Reset the calling thread's scratch arena, if it has one.
+ */
+void mem_scratch_reset();
+
+/*
+ * Get the most bytes allocated at once from any thread's scratch arena.
+ */
+size_t mem_scratch_high_water();
 
-mem_bump_object* mem_bump_create(const size_t total_size);
-void mem_bump_destroy(mem_bump_object* const allocator);
-void* mem_bump_malloc(mem_bump_object* const allocator, const size_t size);
-void* mem_bump_calloc(mem_bump_object* const allocator, const size_t nmemb, const size_t size);
-bool mem_bump_update(mem_bump_object* const allocator);
+/*
+ * Slab pools, for small objects allocated and freed often. Sizes up to
+ * MEM_SLAB_MAX_SIZE are rounded up to one of MEM_SLAB_CLASSES size classes,
+ * each with its own pool; larger sizes go straight to mem_malloc. Each thread
+ * keeps a cache of free objects per class, so allocating and freeing usually
+ * only touches the calling thread's cache. Objects freed by a thread other
+ * than the one that allocated them go into the freeing thread's cache, and
+ * caches hand their excess back to the pools in batches, for other threads to
+ * take a batch at a time. Slab memory is only returned to the heap by
+ * mem_deinit.
+ *
+ * Objects must be freed with the size they were allocated with, and are
+ * aligned for any type.
+ */
+#define MEM_SLAB_MAX_SIZE ((size_t)256u)
+#define MEM_SLAB_CLASSES 5u
+
+/*
+ * Returns NULL if allocation failed.
+ */
+void* mem_slab_alloc(const size_t size);
+
+void mem_slab_free(void* const mem, const size_t size);
+
+#ifdef MEM_DEBUG
+typedef struct mem_slab_stats {
+	size_t object_size;
+
+	/*
+	 * Objects carved out of the pool's slabs, and how many of them are
+	 * allocated.
+	 */
+	size_t capacity;
+	size_t used;
+} mem_slab_stats;
+
+/*
+ * Get the occupancy of each size class' pool, in ascending size order.
+ */
+void mem_slab_stats_get(mem_slab_stats stats[MEM_SLAB_CLASSES]);
+
+#endif
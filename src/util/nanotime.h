@@ -163,18 +163,71 @@ extern void (* const nanotime_yield)();
  */
 uint64_t nanotime_interval(const uint64_t start, const uint64_t end, const uint64_t max);
 
+/*
+ * The stepper calibrates itself online: it measures how far each of its sleeps
+ * overshoots the requested duration, keeping running estimates of the mean
+ * overshoot and mean deviation from it. Sleeps are requested to end short of
+ * the deadline by a margin of the mean plus NANOTIME_STEP_MARGIN_DEVIATIONS
+ * deviations, then the rest of the time up to the deadline is spent
+ * spin-yielding. So the stepper adapts to however coarse the OS's sleeps are,
+ * spinning little where sleeps are precise, and rarely missing deadlines where
+ * they aren't. Estimates are updated with weight 1/2^NANOTIME_STEP_WEIGHT_SHIFT
+ * per sleep, and start at NANOTIME_STEP_INITIAL_OVERSHOOT.
+ */
+#ifndef NANOTIME_STEP_MARGIN_DEVIATIONS
+#define NANOTIME_STEP_MARGIN_DEVIATIONS INT64_C(4)
+#endif
+#ifndef NANOTIME_STEP_WEIGHT_SHIFT
+#define NANOTIME_STEP_WEIGHT_SHIFT 4
+#endif
+#ifndef NANOTIME_STEP_INITIAL_OVERSHOOT
+#define NANOTIME_STEP_INITIAL_OVERSHOOT INT64_C(1000000)
+#endif
+
+/*
+ * Statistics of a stepper, all durations in nanoseconds.
+ */
+typedef struct nanotime_step_stats {
+	/*
+	 * The count of steps done, and how many of them skipped sleeping to catch
+	 * up to the correct wall-clock time.
+	 */
+	uint64_t steps;
+	uint64_t skips;
+
+	/*
+	 * The count of steps where a sleep overshot the deadline, despite the
+	 * margin.
+	 */
+	uint64_t late;
+
+	/*
+	 * How far past the deadline the latest step that slept ended, and the
+	 * running mean and maximum of that.
+	 */
+	uint64_t jitter;
+	uint64_t jitter_mean;
+	uint64_t jitter_max;
+
+	/*
+	 * The current estimates of sleep overshoot, and the resulting margin.
+	 */
+	uint64_t overshoot_mean;
+	uint64_t overshoot_deviation;
+	uint64_t margin;
+} nanotime_step_stats;
+
 typedef struct nanotime_step_data {
 	uint64_t sleep_duration;
 	uint64_t now_max;
 	uint64_t (* now)();
 	void (* sleep)(uint64_t nsec_count);
 
- 	#ifdef __APPLE__
-	uint64_t overhead_numer;
-	uint64_t overhead_denom;
-	uint64_t backoff;
-	#endif
-	uint64_t zero_sleep_duration;
+	int64_t overshoot_mean;
+	int64_t overshoot_deviation;
+	uint64_t margin;
+	nanotime_step_stats stats;
+
 	uint64_t accumulator;
 	uint64_t sleep_point;
 } nanotime_step_data;
@@ -185,6 +238,12 @@ typedef struct nanotime_step_data {
  */
 void nanotime_step_init(nanotime_step_data* const stepper, const uint64_t sleep_duration, const uint64_t now_max, uint64_t (* const now)(), void (* const sleep)(uint64_t nsec_count));
 
+/*
+ * Restarts stepping from now, with a new sleep duration, like
+ * nanotime_step_init, but keeps the stepper's calibration and statistics.
+ */
+void nanotime_step_restart(nanotime_step_data* const stepper, const uint64_t sleep_duration);
+
 /*
  * Does one step of sleeping for a fixed timestep logic update cycle. It makes
  * a best-attempt at a precise delay per iteration, but might skip a cycle of
@@ -194,6 +253,11 @@ void nanotime_step_init(nanotime_step_data* const stepper, const uint64_t sleep_
  */
 bool nanotime_step(nanotime_step_data* const stepper);
 
+/*
+ * Gets the statistics of the stepper.
+ */
+void nanotime_step_stats_get(const nanotime_step_data* const stepper, nanotime_step_stats* const stats);
+
 #if !defined(NANOTIME_ONLY_STEP) && defined(NANOTIME_IMPLEMENTATION)
 
 /*
@@ -518,6 +582,27 @@ uint64_t nanotime_interval(const uint64_t start, const uint64_t end, const uint6
 	}
 }
 
+static uint64_t nanotime_step_margin(const nanotime_step_data* const stepper) {
+	const int64_t margin = stepper->overshoot_mean + NANOTIME_STEP_MARGIN_DEVIATIONS * stepper->overshoot_deviation;
+	if (margin <= INT64_C(0)) {
+		return UINT64_C(0);
+	}
+	else if ((uint64_t)margin > stepper->sleep_duration) {
+		return stepper->sleep_duration;
+	}
+	else {
+		return (uint64_t)margin;
+	}
+}
+
+static void nanotime_step_calibrate(nanotime_step_data* const stepper, const int64_t overshoot) {
+	const int64_t difference = overshoot - stepper->overshoot_mean;
+	stepper->overshoot_mean += difference / (INT64_C(1) << NANOTIME_STEP_WEIGHT_SHIFT);
+	const int64_t deviation = (difference >= INT64_C(0) ? difference : -difference) - stepper->overshoot_deviation;
+	stepper->overshoot_deviation += deviation / (INT64_C(1) << NANOTIME_STEP_WEIGHT_SHIFT);
+	stepper->margin = nanotime_step_margin(stepper);
+}
+
 void nanotime_step_init(nanotime_step_data* const stepper, const uint64_t sleep_duration, const uint64_t now_max, uint64_t (* const now)(), void (* const sleep)(uint64_t nsec_count)) {
 	assert(
 		stepper != NULL &&
@@ -532,158 +617,110 @@ void nanotime_step_init(nanotime_step_data* const stepper, const uint64_t sleep_
 	stepper->now = now;
 	stepper->sleep = sleep;
 
-	const uint64_t start = now();
-	nanotime_sleep(UINT64_C(0));
-	stepper->zero_sleep_duration = nanotime_interval(start, now(), now_max);
-	#ifdef __APPLE__
-	stepper->overhead_numer = UINT64_C(1);
-	stepper->overhead_denom = UINT64_C(1);
-	stepper->backoff = UINT64_C(0);
-	#endif
+	stepper->overshoot_mean = NANOTIME_STEP_INITIAL_OVERSHOOT;
+	stepper->overshoot_deviation = NANOTIME_STEP_INITIAL_OVERSHOOT / INT64_C(4);
+	{
+		const nanotime_step_stats zero_stats = { 0 };
+		stepper->stats = zero_stats;
+	}
+
+	nanotime_step_restart(stepper, sleep_duration);
+}
+
+void nanotime_step_restart(nanotime_step_data* const stepper, const uint64_t sleep_duration) {
+	assert(stepper != NULL && sleep_duration > UINT64_C(0));
+
+	stepper->sleep_duration = sleep_duration;
+	stepper->margin = nanotime_step_margin(stepper);
 	stepper->accumulator = UINT64_C(0);
 
 	// This should be last here, so the sleep point is close to what it
 	// should be.
-	stepper->sleep_point = now();
+	stepper->sleep_point = stepper->now();
 }
 
 bool nanotime_step(nanotime_step_data* const stepper) {
 	assert(stepper != NULL);
 
 	bool slept;
+	stepper->stats.steps++;
 	if (stepper->accumulator < stepper->sleep_duration) {
 		const uint64_t total_sleep_duration = stepper->sleep_duration - stepper->accumulator;
-		uint64_t current_sleep_duration = total_sleep_duration;
-		const uint64_t shift = UINT64_C(4);
-
-		#ifdef __APPLE__
-		// Start with a big sleep. This helps reduce CPU/power use vs. many
-		// shorter sleeps. Shorter sleeps are still done below, but this reduces
-		// the number of shorter sleeps. It appears that the actually-slept
-		// duration is roughly equal to the requested delay time multiplied by a
-		// factor that remains relatively constant over the short run, greater
-		// than 1.0, in testing on ARM macOS; such behavior doesn't appear to be
-		// the case on all platforms, but is the case in testing on an M1 Mac.
-		// By only setting the overhead factor when the sleep overshoots, it
-		// levels off to a pretty stable value in a feedback loop, resulting in
-		// the big sleep approaching a value that does as big as possible of a
-		// big sleep while reducing overshoots.  Also, a "backoff" duration is
-		// subtracted from the overhead factor-adjusted sleep duration, which
-		// reduces the frequency of overshoots, while still maintaining the
-		// desired longer sleep duration before the higher cost/higher precision
-		// sleeping below; the backoff duration is also updated in a feedback
-		// loop that causes it to approach a reasonably correct value.
-		// TODO: This was carefully tuned to be well-behaved on Apple Silicon
-		// M1, but hasn't been tested on any Intel Mac; test on an Intel Mac to
-		// see if this algorithm is appropriate there, if not, special-case for
-		// each CPU type.
-		// TODO: Implement "initial big sleep" for other platforms; it really
-		// does reduce wasted cycles regardless of platform. Or, if this
-		// algorithm seems to work fine on other platforms, change it to be used
-		// on all platforms, not just Apple's.
-		uint64_t overhead_sleep_duration = (current_sleep_duration * stepper->overhead_numer) / stepper->overhead_denom;
-		if (overhead_sleep_duration > stepper->backoff) {
-			overhead_sleep_duration -= stepper->backoff;
-		}
-		else {
-			stepper->backoff = UINT64_C(0);
-		}
-		const uint64_t overhead_start = stepper->now();
-		stepper->sleep(overhead_sleep_duration);
-		const uint64_t big_sleep_duration = nanotime_interval(overhead_start, stepper->now(), stepper->now_max);
-		const uint64_t slept_so_far = nanotime_interval(stepper->sleep_point, stepper->now(), stepper->now_max);
-		if (slept_so_far <= total_sleep_duration) {
-			if (stepper->backoff >= total_sleep_duration - slept_so_far) {
-				stepper->backoff -= total_sleep_duration - slept_so_far;
-			}
-			current_sleep_duration -= slept_so_far;
-		}
-		else {
-			stepper->overhead_numer = overhead_sleep_duration;
-			stepper->overhead_denom = big_sleep_duration > UINT64_C(0) ? big_sleep_duration : UINT64_C(1);
-			if (stepper->backoff <= UINT64_MAX - slept_so_far - total_sleep_duration) {
-				stepper->backoff += slept_so_far - total_sleep_duration;
-			}
-			if (stepper->overhead_numer > stepper->overhead_denom) {
-				stepper->overhead_numer = UINT64_C(1);
-				stepper->overhead_denom = UINT64_C(1);
-			}
-			goto step_end;
-		}
-		#endif
 
-		// This has the flavor of Zeno's dichotomous paradox of motion, as it
-		// successively divides the time remaining to sleep, but attempts to
-		// stop short of the deadline to hopefully be able to precisely sleep up
-		// to the deadline below this loop. The divisor is larger than two
-		// though, as it produces better behavior, and seems to work fine in
-		// testing on real hardware. This loop, and the one below, take the
-		// assumption that sleep requests of the same amount are roughly equal;
-		// by keeping track of the max of all the sleeps, the loops can be
-		// broken out of when the remaining time is less than the max, allowing
-		// the loop after this one to do shorter sleeps, with a corresponding
-		// smaller max of the sleeps. The overshoot possible in the loop below
-		// this one won't overshoot much, or in the best case won't overshoot so
-		// the busyloop can finish up the sleep precisely.
-		current_sleep_duration >>= shift;
-		for (
-			uint64_t max = stepper->zero_sleep_duration;
-			nanotime_interval(stepper->sleep_point, stepper->now(), stepper->now_max) + max < total_sleep_duration && current_sleep_duration > UINT64_C(0);
-			current_sleep_duration >>= shift
-		) {
-			max = stepper->zero_sleep_duration;
-			uint64_t start;
-			while (max < stepper->sleep_duration && nanotime_interval(stepper->sleep_point, start = stepper->now(), stepper->now_max) + max < total_sleep_duration) {
-				stepper->sleep(current_sleep_duration);
-				uint64_t slept_duration;
-				if ((slept_duration = nanotime_interval(start, stepper->now(), stepper->now_max)) > max) {
-					max = slept_duration;
-				}
-			}
+		// Sleep coarsely up to the margin short of the deadline, measuring
+		// each sleep's overshoot to refine the margin. Usually one sleep gets
+		// there, but a sleep that ended early is followed by another.
+		bool sleep_done = false;
+		uint64_t start;
+		uint64_t elapsed;
+		while ((elapsed = nanotime_interval(stepper->sleep_point, start = stepper->now(), stepper->now_max)) < total_sleep_duration && total_sleep_duration - elapsed > stepper->margin) {
+			const uint64_t requested = total_sleep_duration - elapsed - stepper->margin;
+			stepper->sleep(requested);
+			const uint64_t slept_duration = nanotime_interval(start, stepper->now(), stepper->now_max);
+			nanotime_step_calibrate(stepper, (int64_t)slept_duration - (int64_t)requested);
+			sleep_done = true;
 		}
-
-		{
-			// After (hopefully) stopping short of the deadline by a small
-			// amount, do small sleeps here to get closer to the deadline, but
-			// again attempting to stop short by an even smaller amount. It's
-			// best to do larger sleeps as done in the above loop, to reduce
-			// CPU/power usage, as each sleep iteration has a CPU/power usage
-			// cost.
-			uint64_t max = stepper->zero_sleep_duration;
-			uint64_t start;
-			while (nanotime_interval(stepper->sleep_point, start = stepper->now(), stepper->now_max) + max < total_sleep_duration) {
-				stepper->sleep(UINT64_C(0));
-				if ((stepper->zero_sleep_duration = nanotime_interval(start, stepper->now(), stepper->now_max)) > max) {
-					max = stepper->zero_sleep_duration;
-				}
+		if (elapsed > total_sleep_duration) {
+			if (sleep_done) {
+				stepper->stats.late++;
 			}
 		}
+		else if (!sleep_done && total_sleep_duration - elapsed > (uint64_t)stepper->overshoot_mean) {
+			// The margin was too wide for any sleep, though an average
+			// overshoot would have fit. Decay the estimates, so the margin is
+			// probed again eventually, rather than spinning every step after
+			// a burst of bad sleeps.
+			stepper->overshoot_mean -= stepper->overshoot_mean / (INT64_C(1) << NANOTIME_STEP_WEIGHT_SHIFT);
+			stepper->overshoot_deviation -= stepper->overshoot_deviation / (INT64_C(1) << NANOTIME_STEP_WEIGHT_SHIFT);
+			stepper->margin = nanotime_step_margin(stepper);
+		}
 
-		#ifdef __APPLE__
-		step_end:
-		#endif
 		{
-			// Finally, do a busyloop to precisely sleep up to the
-			// deadline. The code above this loop attempts to reduce the
-			// remaining time to sleep to a minimum via process-yielding
-			// sleeps, so the amount of time spent spinning here is
-			// hopefully quite low.
+			// Finally, spin up to the deadline precisely, yielding to other
+			// threads where possible. The margin is hopefully small, so the
+			// amount of time spent spinning here is hopefully quite low.
 			uint64_t current_time;
 			uint64_t accumulated;
-			while ((accumulated = nanotime_interval(stepper->sleep_point, current_time = stepper->now(), stepper->now_max)) < total_sleep_duration);
+			while ((accumulated = nanotime_interval(stepper->sleep_point, current_time = stepper->now(), stepper->now_max)) < total_sleep_duration) {
+				#if !defined(NANOTIME_ONLY_STEP) && defined(NANOTIME_YIELD_IMPLEMENTED) && !defined(NANOTIME_YIELD_NOP)
+				nanotime_yield();
+				#endif
+			}
 
 			stepper->accumulator += accumulated;
 			stepper->sleep_point = current_time;
 			slept = true;
+
+			const uint64_t jitter = accumulated - total_sleep_duration;
+			stepper->stats.jitter = jitter;
+			if (jitter > stepper->stats.jitter_max) {
+				stepper->stats.jitter_max = jitter;
+			}
+			if (jitter >= stepper->stats.jitter_mean) {
+				stepper->stats.jitter_mean += (jitter - stepper->stats.jitter_mean) >> NANOTIME_STEP_WEIGHT_SHIFT;
+			}
+			else {
+				stepper->stats.jitter_mean -= (stepper->stats.jitter_mean - jitter) >> NANOTIME_STEP_WEIGHT_SHIFT;
+			}
 		}
 	}
 	else {
+		stepper->stats.skips++;
 		slept = false;
 	}
 	stepper->accumulator -= stepper->sleep_duration;
 	return slept;
 }
 
+void nanotime_step_stats_get(const nanotime_step_data* const stepper, nanotime_step_stats* const stats) {
+	assert(stepper != NULL && stats != NULL);
+
+	*stats = stepper->stats;
+	stats->overshoot_mean = stepper->overshoot_mean > INT64_C(0) ? (uint64_t)stepper->overshoot_mean : UINT64_C(0);
+	stats->overshoot_deviation = stepper->overshoot_deviation > INT64_C(0) ? (uint64_t)stepper->overshoot_deviation : UINT64_C(0);
+	stats->margin = stepper->margin;
+}
+
 #ifdef __cplusplus
 }
 #endif
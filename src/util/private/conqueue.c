@@ -26,20 +26,46 @@
 #include "util/mem.h"
 #include "SDL_atomic.h"
 #include "SDL_thread.h"
+#include <limits.h>
 #include <stdlib.h>
 #include <assert.h>
 
+#define CACHE_LINE_SIZE 64u
+
+/*
+ * At most this many dequeued nodes are kept for reuse per queue; nodes beyond
+ * that are freed.
+ */
+#define MAX_FREE_NODES 256
+
 typedef struct node_object node_object;
 struct node_object {
 	void* value;
 	node_object* next;
 };
 
+/*
+ * Producers only ever touch the node they exchange out of enqueue, which the
+ * consumer can't dequeue until its next pointer has been set. So, unlike
+ * queues that have producers walk the list, dequeued nodes can be reused
+ * without the risk of a stalled producer writing into a reused node.
+ *
+ * Dequeued nodes are pushed onto the free stack by the consumer and popped by
+ * producers. Only one producer pops at a time, and a producer that can't take
+ * the pop lock immediately allocates a new node instead of waiting. With a
+ * single popper, the stack is free of the ABA problem.
+ */
 typedef struct conqueue_object conqueue_object;
 struct conqueue_object {
 	node_object* enqueue;
+	unsigned char enqueue_pad[CACHE_LINE_SIZE - sizeof(node_object*)];
+
 	node_object* dequeue;
 
+	node_object* free;
+	SDL_SpinLock free_lock;
+	SDL_atomic_t num_free;
+
 	#ifndef NDEBUG
 	SDL_atomic_t consumer_set;
 	SDL_threadID consumer;
@@ -72,7 +98,38 @@ static void assert_current_thread_is_consumer(conqueue_object* const queue) {
 
 #endif
 
-void* conqueue_dequeue(conqueue_object* const queue);
+static node_object* node_get(conqueue_object* const queue) {
+	if (SDL_AtomicGetPtr((void**)&queue->free) != NULL && SDL_AtomicTryLock(&queue->free_lock)) {
+		node_object* node;
+		do {
+			node = SDL_AtomicGetPtr((void**)&queue->free);
+			SDL_MemoryBarrierAcquire();
+		} while (node != NULL && !SDL_AtomicCASPtr((void**)&queue->free, node, node->next));
+		SDL_AtomicUnlock(&queue->free_lock);
+
+		if (node != NULL) {
+			SDL_AtomicAdd(&queue->num_free, -1);
+			return node;
+		}
+	}
+
+	return mem_slab_alloc(sizeof(node_object));
+}
+
+static void node_put(conqueue_object* const queue, node_object* const node) {
+	if (SDL_AtomicGet(&queue->num_free) >= MAX_FREE_NODES) {
+		mem_slab_free(node, sizeof(node_object));
+		return;
+	}
+
+	SDL_AtomicAdd(&queue->num_free, 1);
+	node_object* free;
+	do {
+		free = SDL_AtomicGetPtr((void**)&queue->free);
+		node->next = free;
+		SDL_MemoryBarrierRelease();
+	} while (!SDL_AtomicCASPtr((void**)&queue->free, free, node));
+}
 
 conqueue_object* conqueue_create() {
 	conqueue_object* const queue = mem_malloc(sizeof(conqueue_object));
@@ -80,7 +137,7 @@ conqueue_object* conqueue_create() {
 		return NULL;
 	}
 
-	node_object* const node = mem_malloc(sizeof(node_object));
+	node_object* const node = mem_slab_alloc(sizeof(node_object));
 	if (node == NULL) {
 		mem_free(queue);
 		return NULL;
@@ -95,6 +152,10 @@ conqueue_object* conqueue_create() {
 	SDL_AtomicSet(&queue->consumer_set, 0);
 	#endif
 
+	queue->free = NULL;
+	queue->free_lock = 0;
+	SDL_AtomicSet(&queue->num_free, 0);
+
 	SDL_MemoryBarrierRelease();
 	SDL_AtomicSetPtr((void**)&queue->enqueue, node);
 
@@ -108,7 +169,16 @@ void conqueue_destroy(conqueue_object* const queue) {
 	assert_current_thread_is_consumer(queue);
 
 	while (conqueue_dequeue(queue) != NULL) continue;
-	mem_free(queue->dequeue);
+	mem_slab_free(queue->dequeue, sizeof(node_object));
+
+	SDL_MemoryBarrierAcquire();
+	node_object* node = queue->free;
+	while (node != NULL) {
+		node_object* const next = node->next;
+		mem_slab_free(node, sizeof(node_object));
+		node = next;
+	}
+
 	mem_free(queue);
 }
 
@@ -116,7 +186,7 @@ bool conqueue_enqueue(conqueue_object* const queue, void* const value) {
 	assert(queue != NULL);
 	assert(value != NULL);
 
-	node_object* node = mem_malloc(sizeof(node_object));
+	node_object* const node = node_get(queue);
 	if (node == NULL) {
 		return false;
 	}
@@ -125,28 +195,14 @@ bool conqueue_enqueue(conqueue_object* const queue, void* const value) {
 	SDL_MemoryBarrierRelease();
 	SDL_AtomicSetPtr((void**)&node->next, NULL);
 
-	node_object* enqueue;
-	SDL_bool enqueue_next;
-
-	do {
-		enqueue = SDL_AtomicGetPtr((void**)&queue->enqueue);
-		SDL_MemoryBarrierAcquire();
-
-		node_object* const next = SDL_AtomicGetPtr((void**)&enqueue->next);
-		SDL_MemoryBarrierAcquire();
-
-		if (next != NULL) {
-			continue;
-		}
-
-		SDL_MemoryBarrierRelease();
-		enqueue_next = SDL_AtomicCASPtr((void**)&enqueue->next, next, node);
-		SDL_MemoryBarrierAcquire();
-	} while (!enqueue_next);
-
+	// The exchange orders this producer's node after all prior nodes, then
+	// linking the node in makes it visible to the consumer.
 	SDL_MemoryBarrierRelease();
-	SDL_AtomicCASPtr((void**)&queue->enqueue, enqueue, node);
+	node_object* const prev = SDL_AtomicSetPtr((void**)&queue->enqueue, node);
 	SDL_MemoryBarrierAcquire();
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSetPtr((void**)&prev->next, node);
 	return true;
 }
 
@@ -162,10 +218,96 @@ void* conqueue_dequeue(conqueue_object* const queue) {
 	if (next != NULL) {
 		queue->dequeue = next;
 		void* const value = next->value;
-		mem_free(dequeue);
+		node_put(queue, dequeue);
 		return value;
 	}
 	else {
 		return NULL;
 	}
 }
+
+/*
+ * The indices only ever increase, wrapping around, and are masked to get
+ * slots. Each index is written by one thread only, and each thread keeps a
+ * cached copy of the other thread's index on its own cache line, only
+ * reloading it when the cached copy says the ring is full or empty.
+ */
+struct conqueue_ring_object {
+	SDL_atomic_t head;
+	unsigned head_cached_tail;
+	unsigned char head_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t) - sizeof(unsigned)];
+
+	SDL_atomic_t tail;
+	unsigned tail_cached_head;
+	unsigned char tail_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t) - sizeof(unsigned)];
+
+	unsigned mask;
+	void* values[];
+};
+
+conqueue_ring_object* conqueue_ring_create(const size_t capacity) {
+	assert(capacity > 0u);
+	assert(capacity <= (size_t)INT_MAX);
+
+	size_t size = 1u;
+	while (size < capacity) {
+		size *= 2u;
+	}
+
+	conqueue_ring_object* const ring = mem_malloc(sizeof(conqueue_ring_object) + size * sizeof(void*));
+	if (ring == NULL) {
+		return NULL;
+	}
+	ring->head_cached_tail = 0u;
+	ring->tail_cached_head = 0u;
+	ring->mask = (unsigned)(size - 1u);
+
+	SDL_AtomicSet(&ring->head, 0);
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->tail, 0);
+
+	return ring;
+}
+
+void conqueue_ring_destroy(conqueue_ring_object* const ring) {
+	assert(ring != NULL);
+
+	mem_free(ring);
+}
+
+bool conqueue_ring_enqueue(conqueue_ring_object* const ring, void* const value) {
+	assert(ring != NULL);
+	assert(value != NULL);
+
+	const unsigned tail = (unsigned)SDL_AtomicGet(&ring->tail);
+	if (tail - ring->tail_cached_head > ring->mask) {
+		ring->tail_cached_head = (unsigned)SDL_AtomicGet(&ring->head);
+		SDL_MemoryBarrierAcquire();
+		if (tail - ring->tail_cached_head > ring->mask) {
+			return false;
+		}
+	}
+
+	ring->values[tail & ring->mask] = value;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->tail, (int)(tail + 1u));
+	return true;
+}
+
+void* conqueue_ring_dequeue(conqueue_ring_object* const ring) {
+	assert(ring != NULL);
+
+	const unsigned head = (unsigned)SDL_AtomicGet(&ring->head);
+	if (head == ring->head_cached_tail) {
+		ring->head_cached_tail = (unsigned)SDL_AtomicGet(&ring->tail);
+		SDL_MemoryBarrierAcquire();
+		if (head == ring->head_cached_tail) {
+			return NULL;
+		}
+	}
+
+	void* const value = ring->values[head & ring->mask];
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->head, (int)(head + 1u));
+	return value;
+}
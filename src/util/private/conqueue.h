@@ -34,10 +34,19 @@
 
 // TODO: Change the implementation to support multiple consumer threads. But do
 // provide an option to select between single-consumer/multiple-consumer, as
-// multiple-consumer has higher overhead than single-consumer. And investigate
-// if single-producer can have lower overhead than multiple-producer; if so,
-// also provide that option.
+// multiple-consumer has higher overhead than single-consumer.
 
+/*
+ * Nodes dequeued by the consumer are kept for reuse by later enqueues, so once
+ * a queue has held as many values as it usually does, enqueueing and
+ * dequeueing no longer allocate or free memory.
+ *
+ * For a single producer and single consumer with a known limit on the number
+ * of values in flight, the bounded ring queue (conqueue_ring_object) has lower
+ * overhead still, never allocating after creation.
+ */
+
+#include <stddef.h>
 #include <stdbool.h>
 
 typedef struct conqueue_object conqueue_object;
@@ -68,3 +77,31 @@ bool conqueue_enqueue(conqueue_object* const queue, void* const value);
  * must only be called by the consumer thread.
  */
 void* conqueue_dequeue(conqueue_object* const queue);
+
+typedef struct conqueue_ring_object conqueue_ring_object;
+
+/*
+ * Create an empty, bounded, single producer, single consumer ring queue, that
+ * can hold at least capacity values. Returns NULL if creation failed.
+ */
+conqueue_ring_object* conqueue_ring_create(const size_t capacity);
+
+/*
+ * Destroy a ring queue object. Values still enqueued are discarded. This
+ * function must only be called by the consumer thread, or once the producer
+ * and consumer threads are done with the queue.
+ */
+void conqueue_ring_destroy(conqueue_ring_object* const ring);
+
+/*
+ * Enqueue a value pointer onto the ring queue. Returns false if the queue is
+ * full, leaving it unchanged. It's invalid to enqueue NULL. This function must
+ * only be called by the producer thread.
+ */
+bool conqueue_ring_enqueue(conqueue_ring_object* const ring, void* const value);
+
+/*
+ * Dequeue a value pointer from the ring queue. Returns NULL if the queue is
+ * empty. This function must only be called by the consumer thread.
+ */
+void* conqueue_ring_dequeue(conqueue_ring_object* const ring);
@@ -22,6 +22,12 @@
  * SOFTWARE.
  */
 
+/*
+ * Chained hash table dictionary, only built if DICT_CHAINED is defined; the
+ * open addressing dictionary in dict_open.c is used otherwise.
+ */
+#ifdef DICT_CHAINED
+
 #include "util/dict.h"
 #include "util/mem.h"
 #include <string.h>
@@ -92,7 +98,7 @@ bool dict_destroy(dict_object* const dict) {
 		for (size_t i = 0u; count > 0u; i++) {
 			for (entry_object* entry = dict->entries[i], * next = NULL; entry != NULL; entry = next) {
 				next = entry->next;
-				mem_free(entry->key);
+				mem_slab_free(entry->key, entry->key_size);
 				if (entry->value_destroy != NULL) {
 					if (!entry->value_destroy(entry->value)) {
 						return false;
@@ -101,7 +107,7 @@ bool dict_destroy(dict_object* const dict) {
 				else {
 					mem_free((void*)entry->value);
 				}
-				mem_free(entry);
+				mem_slab_free(entry, sizeof(entry_object));
 				count--;
 			}
 		}
@@ -223,11 +229,11 @@ static inline bool grow(dict_object* const dict) {
 	for (size_t i = 0u; i < dict2->size; i++) {
 		for (entry_object* entry = dict2->entries[i], * next = NULL; entry != NULL; entry = next) {
 			next = entry->next;
-			mem_free(entry->key);
+			mem_slab_free(entry->key, entry->key_size);
 			if (entry->value_destroy == NULL) {
 				mem_free((void*)entry->value);
 			}
-			mem_free(entry);
+			mem_slab_free(entry, sizeof(entry_object));
 		}
 	}
 
@@ -254,14 +260,14 @@ bool dict_set(
 			if (key_size == (*prev)->key_size && memcmp((*prev)->key, key, key_size) == 0) {
 				entry = *prev;
 				*prev = entry->next;
-				mem_free(entry->key);
+				mem_slab_free(entry->key, entry->key_size);
 				if (entry->value_destroy != NULL) {
 					entry->value_destroy(entry->value);
 				}
 				else {
 					mem_free(entry->value);
 				}
-				mem_free(entry);
+				mem_slab_free(entry, sizeof(entry_object));
 				dict->count--;
 				return true;
 			}
@@ -286,8 +292,8 @@ bool dict_set(
 		else {
 			entry->value = mem_malloc(value_size);
 			if (entry->value == NULL) {
-				mem_free(entry->key);
-				mem_free(entry);
+				mem_slab_free(entry->key, entry->key_size);
+				mem_slab_free(entry, sizeof(entry_object));
 				return false;
 			}
 			memcpy(entry->value, value, value_size);
@@ -298,14 +304,14 @@ bool dict_set(
 		}
 	}
 	else {
-		entry = mem_malloc(sizeof(entry_object));
+		entry = mem_slab_alloc(sizeof(entry_object));
 		if (entry == NULL) {
 			return false;
 		}
 
-		entry->key = mem_malloc(key_size);
+		entry->key = mem_slab_alloc(key_size);
 		if (entry->key == NULL) {
-			mem_free(entry);
+			mem_slab_free(entry, sizeof(entry_object));
 			return false;
 		}
 		entry->key_size = key_size;
@@ -320,8 +326,8 @@ bool dict_set(
 		else {
 			entry->value = mem_malloc(value_size);
 			if (entry->value == NULL) {
-				mem_free(entry->key);
-				mem_free(entry);
+				mem_slab_free(entry->key, entry->key_size);
+				mem_slab_free(entry, sizeof(entry_object));
 				return false;
 			}
 			memcpy(entry->value, value, value_size);
@@ -359,8 +365,8 @@ bool dict_remove(dict_object* const dict, const void* const key, const size_t ke
 				*value_size = entry->value_size;
 			}
 
-			mem_free(entry->key);
-			mem_free(entry);
+			mem_slab_free(entry->key, entry->key_size);
+			mem_slab_free(entry, sizeof(entry_object));
 			dict->count--;
 
 			return true;
@@ -438,7 +444,7 @@ bool dict_only(dict_object* const dict, const size_t count, const void* const* c
 	for (size_t i = 0u; dict->count > 0u; i++) {
 		assert(i < dict->size);
 		if (dict->entries[i] != NULL) {
-			mem_free(dict->entries[i]->key);
+			mem_slab_free(dict->entries[i]->key, dict->entries[i]->key_size);
 			if (dict->entries[i]->value_destroy != NULL) {
 				if (!dict->entries[i]->value_destroy(dict->entries[i]->value)) {
 					mem_free(only_entries);
@@ -448,7 +454,7 @@ bool dict_only(dict_object* const dict, const size_t count, const void* const* c
 			else {
 				mem_free((void*)dict->entries[i]->value);
 			}
-			mem_free(dict->entries[i]);
+			mem_slab_free(dict->entries[i], sizeof(entry_object));
 			dict->entries[i] = NULL;
 			dict->count--;
 		}
@@ -516,3 +522,5 @@ bool dict_map(dict_object* const dict, void* const data, bool (* const map)(void
 	}
 	return true;
 }
+
+#endif
@@ -0,0 +1,794 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef DICT_CHAINED
+
+#include "util/dict.h"
+#include "util/mem.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <assert.h>
+
+/*
+ * Open addressing dictionary, using Robin Hood hashing with backward shift
+ * deletion. Each slot has a 32-bit metadata word, holding a fingerprint of the
+ * hash in the upper 24 bits and the probe distance plus one in the lower 8 bits,
+ * zero meaning the slot is empty; probes only touch the metadata array until a
+ * fingerprint matches, and stop early at the first slot richer than the key
+ * would be. Keys up to INLINE_KEY_SIZE bytes are stored in the entries.
+ *
+ * Growing is incremental: when the table is too full, a table of double the
+ * capacity is allocated, new entries go into it, and every insert migrates
+ * whole clusters of the old table into it, until the old table is empty. The
+ * old table stays valid for lookups, as migrating whole clusters never leaves
+ * an entry separated from its home slot by an empty slot.
+ */
+
+#define INLINE_KEY_SIZE 16u
+#define MIN_CAPACITY 8u
+
+/*
+ * Tables are grown when they'd be over 3/4 full.
+ */
+#define MAX_LOAD_NUMERATOR 3u
+#define MAX_LOAD_DENOMINATOR 4u
+
+/*
+ * Old table slots scanned for migration per insert. The old table holds at most
+ * 3/4 of its capacity in entries, and the doubled table can take that many more
+ * inserts before it's full, so at least 4/3 slots per insert must be scanned
+ * for migration to always finish in time.
+ */
+#define MIGRATE_SLOTS 4u
+
+#define DISTANCE_BITS 8u
+#define DISTANCE_MASK UINT32_C(0xFF)
+#define DISTANCE_MAX 255u
+
+/*
+ * This is the 64-bit xxHash algorithm, XXH64, reading eight bytes at a time.
+ */
+#define XXH_PRIME64_1 UINT64_C(0x9E3779B185EBCA87)
+#define XXH_PRIME64_2 UINT64_C(0xC2B2AE3D27D4EB4F)
+#define XXH_PRIME64_3 UINT64_C(0x165667B19E3779F9)
+#define XXH_PRIME64_4 UINT64_C(0x85EBCA77C2B2AE63)
+#define XXH_PRIME64_5 UINT64_C(0x27D4EB2F165667C5)
+
+static inline uint64_t rotl64(const uint64_t x, const unsigned r) {
+	return (x << r) | (x >> (64u - r));
+}
+
+static inline uint64_t read64(const uint8_t* const p) {
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint32_t read32(const uint8_t* const p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+static inline uint64_t xxh64_round(uint64_t acc, const uint64_t input) {
+	acc += input * XXH_PRIME64_2;
+	acc = rotl64(acc, 31u);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t xxh64_merge_round(uint64_t acc, const uint64_t value) {
+	acc ^= xxh64_round(0u, value);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static inline uint64_t hash(const void* const data, const size_t size) {
+	const uint8_t* p = data;
+	const uint8_t* const end = p + size;
+	uint64_t h;
+
+	if (size >= 32u) {
+		uint64_t v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+		uint64_t v2 = XXH_PRIME64_2;
+		uint64_t v3 = 0u;
+		uint64_t v4 = 0u - XXH_PRIME64_1;
+		for (const uint8_t* const limit = end - 32u; p <= limit; p += 32u) {
+			v1 = xxh64_round(v1, read64(p));
+			v2 = xxh64_round(v2, read64(p + 8u));
+			v3 = xxh64_round(v3, read64(p + 16u));
+			v4 = xxh64_round(v4, read64(p + 24u));
+		}
+		h = rotl64(v1, 1u) + rotl64(v2, 7u) + rotl64(v3, 12u) + rotl64(v4, 18u);
+		h = xxh64_merge_round(h, v1);
+		h = xxh64_merge_round(h, v2);
+		h = xxh64_merge_round(h, v3);
+		h = xxh64_merge_round(h, v4);
+	}
+	else {
+		h = XXH_PRIME64_5;
+	}
+	h += (uint64_t)size;
+
+	for (; end - p >= 8; p += 8u) {
+		h ^= xxh64_round(0u, read64(p));
+		h = rotl64(h, 27u) * XXH_PRIME64_1 + XXH_PRIME64_4;
+	}
+	if (end - p >= 4) {
+		h ^= (uint64_t)read32(p) * XXH_PRIME64_1;
+		h = rotl64(h, 23u) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4u;
+	}
+	for (; p < end; p++) {
+		h ^= *p * XXH_PRIME64_5;
+		h = rotl64(h, 11u) * XXH_PRIME64_1;
+	}
+
+	h ^= h >> 33u;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29u;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32u;
+	return h;
+}
+
+static inline uint32_t fingerprint_get(const uint64_t h) {
+	return (uint32_t)(h >> 40u) << DISTANCE_BITS;
+}
+
+/*
+ * The type used for key-value entries in dictionaries.
+ */
+typedef struct entry_object {
+	uint64_t hash;
+	size_t key_size;
+	union {
+		uint8_t bytes[INLINE_KEY_SIZE];
+		void* pointer;
+	} key;
+	void* value;
+	size_t value_size;
+	bool (* value_destroy)(void* const data);
+	bool (* value_copy)(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size);
+} entry_object;
+
+typedef struct table_type {
+	size_t capacity;
+	size_t count;
+	uint32_t* metas;
+	entry_object* entries;
+} table_type;
+
+struct dict_object {
+	table_type table;
+
+	/*
+	 * The table being migrated into table while growing, with capacity zero
+	 * when not growing. The slots from migrate_start up to migrate_start +
+	 * migrate_position, wrapping around, have been migrated.
+	 */
+	table_type old;
+	size_t migrate_start;
+	size_t migrate_position;
+};
+
+static inline const void* entry_key(const entry_object* const entry) {
+	return entry->key_size <= INLINE_KEY_SIZE ? entry->key.bytes : entry->key.pointer;
+}
+
+static inline void entry_key_free(entry_object* const entry) {
+	if (entry->key_size > INLINE_KEY_SIZE) {
+		mem_slab_free(entry->key.pointer, entry->key_size);
+	}
+}
+
+static bool entry_key_set(entry_object* const entry, const void* const key, const size_t key_size) {
+	entry->key_size = key_size;
+	if (key_size <= INLINE_KEY_SIZE) {
+		memcpy(entry->key.bytes, key, key_size);
+	}
+	else {
+		entry->key.pointer = mem_slab_alloc(key_size);
+		if (entry->key.pointer == NULL) {
+			return false;
+		}
+		memcpy(entry->key.pointer, key, key_size);
+	}
+	return true;
+}
+
+/*
+ * Destroy the entry's value, returning false if its destructor failed.
+ */
+static bool entry_value_destroy(entry_object* const entry) {
+	if (entry->value_destroy != NULL) {
+		return entry->value_destroy(entry->value);
+	}
+	else {
+		mem_free(entry->value);
+		return true;
+	}
+}
+
+/*
+ * Set the entry's value, copying it if it doesn't have a destructor.
+ */
+static bool entry_value_set(
+	entry_object* const entry,
+	void* const value, const size_t value_size,
+	bool (* const value_destroy)(void* const data),
+	bool (* const value_copy)(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size)
+) {
+	if (value_destroy != NULL) {
+		entry->value = value;
+		entry->value_size = value_size;
+		entry->value_destroy = value_destroy;
+		entry->value_copy = value_copy;
+	}
+	else {
+		entry->value = mem_malloc(value_size);
+		if (entry->value == NULL) {
+			return false;
+		}
+		memcpy(entry->value, value, value_size);
+		entry->value_size = value_size;
+		entry->value_destroy = NULL;
+		entry->value_copy = NULL;
+	}
+	return true;
+}
+
+static bool table_init(table_type* const table, const size_t capacity) {
+	assert(capacity > 0u && (capacity & (capacity - 1u)) == 0u);
+
+	table->metas = mem_calloc(capacity, sizeof(uint32_t));
+	table->entries = mem_malloc(capacity * sizeof(entry_object));
+	if (table->metas == NULL || table->entries == NULL) {
+		mem_free(table->metas);
+		mem_free(table->entries);
+		return false;
+	}
+	table->capacity = capacity;
+	table->count = 0u;
+	return true;
+}
+
+static void table_free(table_type* const table) {
+	if (table->capacity > 0u) {
+		mem_free(table->metas);
+		mem_free(table->entries);
+	}
+	*table = (table_type) { 0 };
+}
+
+/*
+ * Destroy all the table's entries, returning false if a value destructor
+ * failed, in which case the failed entry and those after it are left in the
+ * table.
+ */
+static bool table_clear(table_type* const table) {
+	for (size_t i = 0u; i < table->capacity && table->count > 0u; i++) {
+		if (table->metas[i] != 0u) {
+			entry_object* const entry = &table->entries[i];
+			if (!entry_value_destroy(entry)) {
+				return false;
+			}
+			entry_key_free(entry);
+			table->metas[i] = 0u;
+			table->count--;
+		}
+	}
+	return true;
+}
+
+/*
+ * Returns the index of the entry with the key in the table, or SIZE_MAX if it's
+ * not in the table.
+ */
+static inline size_t table_find(const table_type* const table, const uint64_t h, const void* const key, const size_t key_size) {
+	if (table->count == 0u) {
+		return SIZE_MAX;
+	}
+
+	const size_t mask = table->capacity - 1u;
+	const uint32_t fingerprint = fingerprint_get(h);
+	size_t i = (size_t)h & mask;
+	for (uint32_t distance = 1u; ; distance++, i = (i + 1u) & mask) {
+		const uint32_t meta = table->metas[i];
+		if ((meta & DISTANCE_MASK) < distance) {
+			return SIZE_MAX;
+		}
+		if ((meta & ~DISTANCE_MASK) == fingerprint) {
+			const entry_object* const entry = &table->entries[i];
+			if (entry->hash == h && entry->key_size == key_size && memcmp(entry_key(entry), key, key_size) == 0) {
+				return i;
+			}
+		}
+	}
+}
+
+/*
+ * Insert an entry known not to be in the table, displacing entries closer to
+ * their home slots along the way. Returns false if an entry would have to be
+ * placed too far from its home slot, leaving the table unchanged.
+ */
+static bool table_insert(table_type* const table, const entry_object* const inserted) {
+	assert(table->count < table->capacity);
+
+	const size_t mask = table->capacity - 1u;
+	size_t i = (size_t)inserted->hash & mask;
+	uint32_t meta = fingerprint_get(inserted->hash) | 1u;
+
+	// Find the slot the entry goes into, and the empty slot ending the run of
+	// entries that have to be shifted over to make room for it.
+	size_t slot = SIZE_MAX;
+	size_t end;
+	for (end = i; ; end = (end + 1u) & mask) {
+		const uint32_t current = table->metas[end];
+		if (current == 0u) {
+			break;
+		}
+		if (slot == SIZE_MAX && (current & DISTANCE_MASK) < (meta & DISTANCE_MASK)) {
+			slot = end;
+		}
+		if (slot == SIZE_MAX) {
+			if ((meta & DISTANCE_MASK) == DISTANCE_MAX) {
+				return false;
+			}
+			meta++;
+		}
+		else if ((current & DISTANCE_MASK) == DISTANCE_MAX) {
+			return false;
+		}
+	}
+	if (slot == SIZE_MAX) {
+		slot = end;
+	}
+
+	for (size_t j = end; j != slot; ) {
+		const size_t prev = (j - 1u) & mask;
+		table->metas[j] = table->metas[prev] + 1u;
+		table->entries[j] = table->entries[prev];
+		j = prev;
+	}
+	table->metas[slot] = meta;
+	table->entries[slot] = *inserted;
+	table->count++;
+	return true;
+}
+
+/*
+ * Remove the entry at the index, shifting back the entries after it that
+ * aren't in their home slots. The entry's key and value are left to the
+ * caller.
+ */
+static void table_remove(table_type* const table, size_t i) {
+	const size_t mask = table->capacity - 1u;
+	for (size_t next = (i + 1u) & mask; (table->metas[next] & DISTANCE_MASK) > 1u; i = next, next = (next + 1u) & mask) {
+		table->metas[i] = table->metas[next] - 1u;
+		table->entries[i] = table->entries[next];
+	}
+	table->metas[i] = 0u;
+	table->count--;
+}
+
+static size_t capacity_get(const size_t count) {
+	size_t capacity = MIN_CAPACITY;
+	while (capacity / MAX_LOAD_DENOMINATOR * MAX_LOAD_NUMERATOR < count) {
+		capacity *= 2u;
+	}
+	return capacity;
+}
+
+/*
+ * Migrate whole clusters of the old table, until at least max_slots slots were
+ * scanned, or the migration is finished. Pass SIZE_MAX to finish migrating.
+ */
+static bool migrate(dict_object* const dict, const size_t max_slots) {
+	table_type* const old = &dict->old;
+	if (old->capacity == 0u) {
+		return true;
+	}
+
+	const size_t mask = old->capacity - 1u;
+	for (size_t scanned = 0u; scanned < max_slots && dict->migrate_position < old->capacity; ) {
+		size_t i = (dict->migrate_start + dict->migrate_position) & mask;
+		while (old->metas[i] != 0u) {
+			if (!table_insert(&dict->table, &old->entries[i])) {
+				return false;
+			}
+			old->metas[i] = 0u;
+			old->count--;
+			dict->migrate_position++;
+			scanned++;
+			i = (i + 1u) & mask;
+		}
+		dict->migrate_position++;
+		scanned++;
+	}
+
+	if (dict->migrate_position >= old->capacity) {
+		assert(old->count == 0u);
+		table_free(old);
+	}
+	return true;
+}
+
+/*
+ * Make room for inserting another entry, starting to grow the table if it's
+ * too full, and migrating some of the old table if growing.
+ */
+static bool reserve(dict_object* const dict) {
+	table_type* const table = &dict->table;
+	if ((table->count + 1u) * MAX_LOAD_DENOMINATOR > table->capacity * MAX_LOAD_NUMERATOR) {
+		// If the table filled up before the previous growth finished, which
+		// can only happen if a migration failed, finish it first.
+		if (!migrate(dict, SIZE_MAX)) {
+			return false;
+		}
+
+		table_type grown;
+		if (!table_init(&grown, table->capacity * 2u)) {
+			return false;
+		}
+		dict->old = *table;
+		*table = grown;
+
+		// Migration starts at an empty slot, so it always starts at the start
+		// of a cluster.
+		dict->migrate_start = 0u;
+		while (dict->old.metas[dict->migrate_start] != 0u) {
+			dict->migrate_start++;
+		}
+		dict->migrate_position = 0u;
+	}
+
+	return migrate(dict, MIGRATE_SLOTS);
+}
+
+/*
+ * Find the entry with the key in either table, setting *table_found to the
+ * table it's in. Returns the entry's index, or SIZE_MAX if it's not found.
+ */
+static inline size_t find(dict_object* const dict, const uint64_t h, const void* const key, const size_t key_size, table_type** const table_found) {
+	size_t i = table_find(&dict->table, h, key, key_size);
+	if (i != SIZE_MAX) {
+		*table_found = &dict->table;
+		return i;
+	}
+	if (dict->old.capacity > 0u) {
+		i = table_find(&dict->old, h, key, key_size);
+		*table_found = &dict->old;
+	}
+	return i;
+}
+
+dict_object* dict_create(const size_t size) {
+	if (size == 0u) {
+		return NULL;
+	}
+
+	dict_object* const dict = mem_calloc(1u, sizeof(dict_object));
+	if (dict == NULL) {
+		return NULL;
+	}
+
+	if (!table_init(&dict->table, capacity_get(size))) {
+		mem_free(dict);
+		return NULL;
+	}
+
+	return dict;
+}
+
+bool dict_destroy(dict_object* const dict) {
+	if (dict != NULL) {
+		if (!table_clear(&dict->table) || !table_clear(&dict->old)) {
+			return false;
+		}
+		table_free(&dict->table);
+		table_free(&dict->old);
+		mem_free(dict);
+	}
+	return true;
+}
+
+static bool copy_table(dict_object* const copy, const table_type* const table) {
+	for (size_t i = 0u; i < table->capacity; i++) {
+		if (table->metas[i] == 0u) {
+			continue;
+		}
+		const entry_object* const entry = &table->entries[i];
+		void* value = entry->value;
+		size_t value_size = entry->value_size;
+		if (entry->value_copy != NULL) {
+			if (!entry->value_copy(entry->value, entry->value_size, &value, &value_size)) {
+				return false;
+			}
+		}
+		if (!dict_set(copy, entry_key(entry), entry->key_size, value, value_size, entry->value_destroy, entry->value_copy)) {
+			if (entry->value_destroy != NULL) {
+				entry->value_destroy(value);
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+dict_object* dict_copy(dict_object* const dict) {
+	dict_object* const copy = dict_create(dict->table.count + dict->old.count + 1u);
+	if (copy == NULL) {
+		return NULL;
+	}
+
+	if (!copy_table(copy, &dict->table) || !copy_table(copy, &dict->old)) {
+		dict_destroy(copy);
+		return NULL;
+	}
+
+	return copy;
+}
+
+bool dict_get(
+	dict_object* const dict,
+	const void* const key, const size_t key_size,
+	void** const value, size_t* const value_size
+) {
+	if (dict == NULL || key == NULL || key_size == 0u || value == NULL) {
+		return false;
+	}
+
+	table_type* table;
+	const size_t i = find(dict, hash(key, key_size), key, key_size, &table);
+	if (i == SIZE_MAX) {
+		return false;
+	}
+
+	const entry_object* const entry = &table->entries[i];
+	*value = entry->value;
+	if (value_size != NULL) {
+		*value_size = entry->value_size;
+	}
+	return true;
+}
+
+bool dict_set(
+	dict_object* const dict,
+	const void* const key, const size_t key_size,
+	void* const value, const size_t value_size,
+	bool (* const value_destroy)(void* const data),
+	bool (* const value_copy)(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size)
+) {
+	if (dict == NULL || key == NULL || key_size == 0u || (value != NULL && value_size == 0u)) {
+		return false;
+	}
+
+	const uint64_t h = hash(key, key_size);
+	table_type* table;
+	const size_t i = find(dict, h, key, key_size, &table);
+
+	if (value == NULL) {
+		if (i != SIZE_MAX) {
+			entry_object entry = table->entries[i];
+			table_remove(table, i);
+			entry_key_free(&entry);
+			entry_value_destroy(&entry);
+		}
+		return true;
+	}
+	else if (i != SIZE_MAX) {
+		entry_object* const entry = &table->entries[i];
+		entry_value_destroy(entry);
+		if (!entry_value_set(entry, value, value_size, value_destroy, value_copy)) {
+			entry_object removed = *entry;
+			table_remove(table, i);
+			entry_key_free(&removed);
+			return false;
+		}
+		return true;
+	}
+	else {
+		if (!reserve(dict)) {
+			return false;
+		}
+
+		entry_object entry;
+		entry.hash = h;
+		if (!entry_key_set(&entry, key, key_size)) {
+			return false;
+		}
+		if (!entry_value_set(&entry, value, value_size, value_destroy, value_copy)) {
+			entry_key_free(&entry);
+			return false;
+		}
+		if (!table_insert(&dict->table, &entry)) {
+			entry_key_free(&entry);
+			entry_value_destroy(&entry);
+			return false;
+		}
+		return true;
+	}
+}
+
+bool dict_remove(dict_object* const dict, const void* const key, const size_t key_size, void** const value, size_t* const value_size) {
+	if (dict == NULL || key == NULL || key_size == 0u || value == NULL) {
+		return false;
+	}
+
+	table_type* table;
+	const size_t i = find(dict, hash(key, key_size), key, key_size, &table);
+	if (i == SIZE_MAX) {
+		return false;
+	}
+
+	entry_object entry = table->entries[i];
+	table_remove(table, i);
+	*value = entry.value;
+	if (value_size != NULL) {
+		*value_size = entry.value_size;
+	}
+	entry_key_free(&entry);
+
+	return true;
+}
+
+bool dict_replace(
+	dict_object* const dict,
+	const void* const key, const size_t key_size,
+	void* const src_value, const size_t src_value_size,
+	bool (* const src_destroy_value)(void* const data),
+	bool (* const src_copy_value)(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size),
+	void** const dst_value, size_t* const dst_value_size,
+	bool (** const dst_destroy_value)(void* const data),
+	bool (** const dst_copy_value)(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size)
+) {
+	if (
+		dict == NULL ||
+		key == NULL || key_size == 0u ||
+		src_value == NULL || src_value_size == 0u
+	) {
+		return false;
+	}
+
+	table_type* table;
+	const size_t i = find(dict, hash(key, key_size), key, key_size, &table);
+	if (i == SIZE_MAX) {
+		return false;
+	}
+
+	entry_object* const entry = &table->entries[i];
+	if (dst_value != NULL) {
+		*dst_value = entry->value;
+	}
+	if (dst_value_size != NULL) {
+		*dst_value_size = entry->value_size;
+	}
+	if (dst_destroy_value != NULL) {
+		*dst_destroy_value = entry->value_destroy;
+	}
+	if (dst_copy_value != NULL) {
+		*dst_copy_value = entry->value_copy;
+	}
+
+	entry->value = src_value;
+	entry->value_size = src_value_size;
+	entry->value_destroy = src_destroy_value;
+	entry->value_copy = src_copy_value;
+
+	return true;
+}
+
+bool dict_only(dict_object* const dict, const size_t count, const void* const* const keys, const size_t* const key_sizes) {
+	if (dict == NULL || (count > 0u && (keys == NULL || key_sizes == NULL))) {
+		return false;
+	}
+
+	entry_object* only_entries = NULL;
+	size_t num_only = 0u;
+	if (count > 0u) {
+		// Save an array of what should be kept.
+		only_entries = mem_malloc(sizeof(entry_object) * count);
+		if (only_entries == NULL) {
+			return false;
+		}
+		for (size_t i = 0u; i < count; i++) {
+			table_type* table;
+			const size_t j = find(dict, hash(keys[i], key_sizes[i]), keys[i], key_sizes[i], &table);
+			if (j != SIZE_MAX) {
+				only_entries[num_only++] = table->entries[j];
+				table_remove(table, j);
+			}
+		}
+	}
+
+	// Delete all entries that should not be kept, ending any growth in
+	// progress.
+	if (!table_clear(&dict->table) || !table_clear(&dict->old)) {
+		mem_free(only_entries);
+		return false;
+	}
+	table_free(&dict->old);
+
+	// Put back the entries that should be kept.
+	for (size_t i = 0u; i < num_only; i++) {
+		if (!reserve(dict) || !table_insert(&dict->table, &only_entries[i])) {
+			for (; i < num_only; i++) {
+				entry_key_free(&only_entries[i]);
+				entry_value_destroy(&only_entries[i]);
+			}
+			mem_free(only_entries);
+			return false;
+		}
+	}
+	mem_free(only_entries);
+
+	return true;
+}
+
+size_t dict_tokey(void* const buf, const size_t buf_size, const size_t pairs_count, ...) {
+	assert(buf == NULL || (buf != NULL && buf_size > 0u));
+	assert(pairs_count > 0u);
+
+	va_list args;
+	va_start(args, pairs_count);
+	size_t total = 0u;
+	if (buf == NULL) {
+		for (size_t i = 0u; i < pairs_count; i++) {
+			(void)va_arg(args, const void* const);
+			const size_t size = va_arg(args, const size_t);
+			total += size;
+		}
+	}
+	else {
+		for (size_t i = 0u; i < pairs_count; i++) {
+			const void* const data = va_arg(args, const void* const);
+			const size_t size = va_arg(args, const size_t);
+			assert(total + size <= buf_size);
+			memcpy((uint8_t*)buf + total, data, size);
+			total += size;
+		}
+	}
+	va_end(args);
+	return total;
+}
+
+static bool map_table(table_type* const table, void* const data, bool (* const map)(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size)) {
+	for (size_t i = 0u; i < table->capacity; i++) {
+		if (table->metas[i] != 0u) {
+			const entry_object* const entry = &table->entries[i];
+			if (!map(data, entry_key(entry), entry->key_size, entry->value, entry->value_size)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool dict_map(dict_object* const dict, void* const data, bool (* const map)(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size)) {
+	return map_table(&dict->table, data, map) && map_table(&dict->old, data, map);
+}
+
+#endif
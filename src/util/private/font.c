@@ -23,7 +23,6 @@
  */
 
 #include "util/font.h"
-#include "util/dict.h"
 #include "util/mem.h"
 #include <stdlib.h>
 #include <string.h>
@@ -53,13 +52,160 @@ typedef enum font_block_type {
 	FONT_BLOCK_KERNING_PAIRS
 } font_block_type;
 
-static bool destroy_kerning_pair(void* unused) {
-	return true;
+/*
+ * Glyphs are looked up through a direct-indexed table for Latin-1, a two-level
+ * table of 256-glyph blocks for the rest of the BMP, and a binary search of the
+ * glyphs sorted by ID beyond the BMP. The tables, glyphs and IDs are all in the
+ * one allocation of the font_chars_object.
+ */
+#define CHARS_BLOCK_BITS 8u
+#define CHARS_BLOCK_SIZE ((size_t)1u << CHARS_BLOCK_BITS)
+#define CHARS_NUM_BLOCKS (UINT32_C(0x10000) >> CHARS_BLOCK_BITS)
+
+struct font_chars_object {
+	const font_char_object* latin1[CHARS_BLOCK_SIZE];
+	const font_char_object** blocks[CHARS_NUM_BLOCKS];
+	size_t num_chars;
+	const font_char_object* chars;
+	const uint32_t* ids;
+};
+
+/*
+ * Kerning pairs are sorted by their first and second glyph IDs combined into
+ * one key, for binary search.
+ */
+struct font_kerning_pairs_object {
+	size_t num_pairs;
+	const uint64_t* keys;
+	const int16_t* amounts;
+};
+
+typedef struct parsed_char {
+	uint32_t id;
+	size_t order;
+	font_char_object font_char;
+} parsed_char;
+
+typedef struct parsed_kerning_pair {
+	uint64_t key;
+	size_t order;
+	int16_t amount;
+} parsed_kerning_pair;
+
+#define KERNING_KEY(first, second) (((uint64_t)(first) << 32) | (uint64_t)(second))
+
+/*
+ * Duplicates are ordered by their order in the font data, so the last of them
+ * can be kept, just as if they were set into a dictionary one after another.
+ */
+static int parsed_char_compare(const void* const a, const void* const b) {
+	const parsed_char* const char_a = a;
+	const parsed_char* const char_b = b;
+	if (char_a->id != char_b->id) {
+		return char_a->id < char_b->id ? -1 : 1;
+	}
+	return char_a->order < char_b->order ? -1 : char_a->order > char_b->order;
 }
 
-static bool destroy_font_char(void* data) {
-	mem_free(data);
-	return true;
+static int parsed_kerning_pair_compare(const void* const a, const void* const b) {
+	const parsed_kerning_pair* const pair_a = a;
+	const parsed_kerning_pair* const pair_b = b;
+	if (pair_a->key != pair_b->key) {
+		return pair_a->key < pair_b->key ? -1 : 1;
+	}
+	return pair_a->order < pair_b->order ? -1 : pair_a->order > pair_b->order;
+}
+
+/*
+ * Build the compact glyph tables from the parsed glyphs, sorting the parsed
+ * glyphs in the process.
+ */
+static font_chars_object* chars_compact(parsed_char* const parsed, const size_t num_parsed) {
+	qsort(parsed, num_parsed, sizeof(parsed_char), parsed_char_compare);
+
+	size_t num_chars = 0u;
+	size_t num_blocks = 0u;
+	for (size_t i = 0u; i < num_parsed; i++) {
+		if (i + 1u < num_parsed && parsed[i + 1u].id == parsed[i].id) {
+			continue;
+		}
+		if (
+			parsed[i].id >= CHARS_BLOCK_SIZE && parsed[i].id < UINT32_C(0x10000) &&
+			(num_chars == 0u || (parsed[num_chars - 1u].id >> CHARS_BLOCK_BITS) != (parsed[i].id >> CHARS_BLOCK_BITS))
+		) {
+			num_blocks++;
+		}
+		parsed[num_chars++] = parsed[i];
+	}
+
+	const size_t blocks_offset = sizeof(font_chars_object);
+	const size_t chars_offset = blocks_offset + sizeof(const font_char_object*) * CHARS_BLOCK_SIZE * num_blocks;
+	const size_t ids_offset = chars_offset + sizeof(font_char_object) * num_chars;
+	uint8_t* const data = mem_calloc(1u, ids_offset + sizeof(uint32_t) * num_chars);
+	if (data == NULL) {
+		return NULL;
+	}
+
+	font_chars_object* const chars = (font_chars_object*)data;
+	const font_char_object** const blocks = (const font_char_object**)(data + blocks_offset);
+	font_char_object* const chars_array = (font_char_object*)(data + chars_offset);
+	uint32_t* const ids = (uint32_t*)(data + ids_offset);
+	chars->num_chars = num_chars;
+	chars->chars = chars_array;
+	chars->ids = ids;
+
+	size_t next_block = 0u;
+	for (size_t i = 0u; i < num_chars; i++) {
+		const uint32_t id = parsed[i].id;
+		chars_array[i] = parsed[i].font_char;
+		ids[i] = id;
+		if (id < CHARS_BLOCK_SIZE) {
+			chars->latin1[id] = &chars_array[i];
+		}
+		else if (id < UINT32_C(0x10000)) {
+			const font_char_object** block = chars->blocks[id >> CHARS_BLOCK_BITS];
+			if (block == NULL) {
+				block = &blocks[next_block++ * CHARS_BLOCK_SIZE];
+				chars->blocks[id >> CHARS_BLOCK_BITS] = block;
+			}
+			block[id & (CHARS_BLOCK_SIZE - 1u)] = &chars_array[i];
+		}
+	}
+	assert(next_block == num_blocks);
+
+	return chars;
+}
+
+static font_kerning_pairs_object* kerning_pairs_compact(parsed_kerning_pair* const parsed, const size_t num_parsed) {
+	qsort(parsed, num_parsed, sizeof(parsed_kerning_pair), parsed_kerning_pair_compare);
+
+	size_t num_pairs = 0u;
+	for (size_t i = 0u; i < num_parsed; i++) {
+		if (i + 1u < num_parsed && parsed[i + 1u].key == parsed[i].key) {
+			continue;
+		}
+		parsed[num_pairs++] = parsed[i];
+	}
+
+	const size_t keys_offset = sizeof(font_kerning_pairs_object);
+	const size_t amounts_offset = keys_offset + sizeof(uint64_t) * num_pairs;
+	uint8_t* const data = mem_malloc(amounts_offset + sizeof(int16_t) * num_pairs);
+	if (data == NULL) {
+		return NULL;
+	}
+
+	font_kerning_pairs_object* const kerning_pairs = (font_kerning_pairs_object*)data;
+	uint64_t* const keys = (uint64_t*)(data + keys_offset);
+	int16_t* const amounts = (int16_t*)(data + amounts_offset);
+	for (size_t i = 0u; i < num_pairs; i++) {
+		keys[i] = parsed[i].key;
+		amounts[i] = parsed[i].amount;
+	}
+	kerning_pairs->num_pairs = num_pairs;
+	kerning_pairs->keys = keys;
+	kerning_pairs->amounts = amounts;
+
+	return kerning_pairs;
 }
 
 font_object* font_create(const void* const data, const size_t size) {
@@ -221,8 +367,8 @@ font_object* font_create(const void* const data, const size_t size) {
 
 	block_data = blob_data + blob_offset;
 	const size_t num_chars = block_size / 20u;
-	dict_object* const font_chars = dict_create(num_chars);
-	if (font_chars == NULL) {
+	parsed_char* const parsed_chars = mem_malloc(sizeof(parsed_char) * num_chars);
+	if (parsed_chars == NULL) {
 		mem_free(*font->page_names);
 		mem_free(font->page_names);
 		if (font->font_name != NULL) {
@@ -232,20 +378,11 @@ font_object* font_create(const void* const data, const size_t size) {
 		return NULL;
 	}
 	for (size_t i = 0u; i < num_chars; i++) {
-		font_char_object* const font_char = (font_char_object*)mem_malloc(sizeof(font_char_object));
-		if (font_char == NULL) {
-			dict_destroy(font_chars);
-			mem_free(*font->page_names);
-			mem_free(font->page_names);
-			if (font->font_name != NULL) {
-				mem_free(font->font_name);
-			}
-			mem_free(font);
-			return NULL;
-		}
+		font_char_object* const font_char = &parsed_chars[i].font_char;
 
 		const uint8_t* const char_data = block_data + i * 20u;
-		const size_t id = GET_UINT32(char_data + 0u);
+		parsed_chars[i].id = GET_UINT32(char_data + 0u);
+		parsed_chars[i].order = i;
 		font_char->x = GET_UINT16(char_data + 4);
 		font_char->y = GET_UINT16(char_data + 6);
 		font_char->w = GET_UINT16(char_data + 8);
@@ -255,25 +392,24 @@ font_object* font_create(const void* const data, const size_t size) {
 		font_char->x_advance = GET_INT16(char_data + 16);
 		font_char->page = char_data[18];
 		font_char->channel = char_data[19];
-
-		if (!dict_set(font_chars, &id, sizeof(id), font_char, sizeof(font_char), destroy_font_char, NULL)) {
-			mem_free(font_char);
-			dict_destroy(font_chars);
-			mem_free(*font->page_names);
-			mem_free(font->page_names);
-			if (font->font_name != NULL) {
-				mem_free(font->font_name);
-			}
-			mem_free(font);
-			return NULL;
+	}
+	font_chars_object* const font_chars = chars_compact(parsed_chars, num_chars);
+	mem_free(parsed_chars);
+	if (font_chars == NULL) {
+		mem_free(*font->page_names);
+		mem_free(font->page_names);
+		if (font->font_name != NULL) {
+			mem_free(font->font_name);
 		}
+		mem_free(font);
+		return NULL;
 	}
-	font->chars = (font_chars_object*)font_chars;
+	font->chars = font_chars;
 	blob_offset += block_size;
 
 	if (blob_size > blob_offset) {
 		if (blob_size < blob_offset + 1u + 4u || blob_data[blob_offset + 0u] != FONT_BLOCK_KERNING_PAIRS || (block_size = GET_UINT32(blob_data + blob_offset + 1u), block_size % 10u != 0u) || blob_size < blob_offset + 1u + 4u + block_size) {
-			dict_destroy(font_chars);
+			mem_free(font_chars);
 			mem_free(*font->page_names);
 			mem_free(font->page_names);
 			if (font->font_name != NULL) {
@@ -286,9 +422,9 @@ font_object* font_create(const void* const data, const size_t size) {
 
 		block_data = blob_data + blob_offset;
 		size_t num_kerning_pairs = block_size / 10u;
-		dict_object* const kerning_pairs = dict_create(num_kerning_pairs);
-		if (kerning_pairs == NULL) {
-			dict_destroy(font_chars);
+		parsed_kerning_pair* const parsed_pairs = mem_malloc(sizeof(parsed_kerning_pair) * (num_kerning_pairs > 0u ? num_kerning_pairs : 1u));
+		if (parsed_pairs == NULL) {
+			mem_free(font_chars);
 			mem_free(*font->page_names);
 			mem_free(font->page_names);
 			if (font->font_name != NULL) {
@@ -299,24 +435,26 @@ font_object* font_create(const void* const data, const size_t size) {
 		}
 		for (size_t i = 0u; i < num_kerning_pairs; i++) {
 			const uint8_t* const kerning_pair_data = block_data + i * 10u;
-			const size_t pair[2] = {
+			parsed_pairs[i].key = KERNING_KEY(
 				GET_UINT32(kerning_pair_data + 0u),
 				GET_UINT32(kerning_pair_data + 4u)
-			};
-			const ptrdiff_t amount = GET_INT16(kerning_pair_data + 8u);
-			if (!dict_set(kerning_pairs, (const void*)pair, sizeof(pair), (void*)(intptr_t)amount, sizeof(void*), destroy_kerning_pair, NULL)) {
-				dict_destroy(kerning_pairs);
-				dict_destroy(font_chars);
-				mem_free(*font->page_names);
-				mem_free(font->page_names);
-				if (font->font_name != NULL) {
-					mem_free(font->font_name);
-				}
-				mem_free(font);
-				return NULL;
+			);
+			parsed_pairs[i].order = i;
+			parsed_pairs[i].amount = GET_INT16(kerning_pair_data + 8u);
+		}
+		font_kerning_pairs_object* const kerning_pairs = kerning_pairs_compact(parsed_pairs, num_kerning_pairs);
+		mem_free(parsed_pairs);
+		if (kerning_pairs == NULL) {
+			mem_free(font_chars);
+			mem_free(*font->page_names);
+			mem_free(font->page_names);
+			if (font->font_name != NULL) {
+				mem_free(font->font_name);
 			}
+			mem_free(font);
+			return NULL;
 		}
-		font->kerning_pairs = (font_kerning_pairs_object*)kerning_pairs;
+		font->kerning_pairs = kerning_pairs;
 	}
 	else {
 		font->kerning_pairs = NULL;
@@ -326,8 +464,10 @@ font_object* font_create(const void* const data, const size_t size) {
 }
 
 bool font_destroy(font_object* const font) {
-	dict_destroy((dict_object*)font->kerning_pairs);
-	dict_destroy((dict_object*)font->chars);
+	if (font->kerning_pairs != NULL) {
+		mem_free(font->kerning_pairs);
+	}
+	mem_free(font->chars);
 	mem_free(*font->page_names);
 	mem_free(font->page_names);
 	if (font->font_name != NULL) {
@@ -338,22 +478,61 @@ bool font_destroy(font_object* const font) {
 }
 
 bool font_kerning_amount_get(font_object* const font, const size_t first, const size_t second, ptrdiff_t* const amount) {
-	const size_t pair[2] = { first, second };
-	void* amount_value;
-	if (!dict_get((dict_object*)font->kerning_pairs, (const void*)pair, sizeof(pair), &amount_value, NULL)) {
+	const font_kerning_pairs_object* const kerning_pairs = font->kerning_pairs;
+	if (kerning_pairs == NULL || first > UINT32_MAX || second > UINT32_MAX) {
+		return false;
+	}
+
+	const uint64_t key = KERNING_KEY(first, second);
+	size_t low = 0u, high = kerning_pairs->num_pairs;
+	while (low < high) {
+		const size_t mid = low + (high - low) / 2u;
+		if (kerning_pairs->keys[mid] < key) {
+			low = mid + 1u;
+		}
+		else {
+			high = mid;
+		}
+	}
+	if (low == kerning_pairs->num_pairs || kerning_pairs->keys[low] != key) {
 		return false;
 	}
 
-	*amount = (int16_t)(intptr_t)amount_value;
+	*amount = kerning_pairs->amounts[low];
 	return true;
 }
 
 bool font_char_get(font_object* const font, const size_t id, const font_char_object** const font_char) {
-	dict_object* const font_chars = (dict_object*)font->chars;
-	if (dict_get(font_chars, &id, sizeof(id), (void**)font_char, NULL)) {
-		return true;
+	const font_chars_object* const chars = font->chars;
+	const font_char_object* found = NULL;
+	if (id < CHARS_BLOCK_SIZE) {
+		found = chars->latin1[id];
 	}
-	else {
+	else if (id < UINT32_C(0x10000)) {
+		const font_char_object* const* const block = chars->blocks[id >> CHARS_BLOCK_BITS];
+		if (block != NULL) {
+			found = block[id & (CHARS_BLOCK_SIZE - 1u)];
+		}
+	}
+	else if (id <= UINT32_MAX) {
+		size_t low = 0u, high = chars->num_chars;
+		while (low < high) {
+			const size_t mid = low + (high - low) / 2u;
+			if (chars->ids[mid] < id) {
+				low = mid + 1u;
+			}
+			else {
+				high = mid;
+			}
+		}
+		if (low < chars->num_chars && chars->ids[low] == id) {
+			found = &chars->chars[low];
+		}
+	}
+
+	if (found == NULL) {
 		return false;
 	}
+	*font_char = found;
+	return true;
 }
@@ -63,27 +63,18 @@ static void next_line(const char** line, size_t* const len, const char* const en
 	*len = line_end - *line;
 }
 
-static bool destroy_section(void* const data) {
-    dict_object* const section = (dict_object*)data;
-	return dict_destroy(section);
-}
-
-static bool copy_section(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size) {
-	*dst_value = dict_copy((dict_object*)src_value);
-	return *dst_value != NULL;
-}
-
-ini_object* ini_create(const char* const data, const size_t size) {
-	dict_object* const ini_sections = dict_create(1u);
-	if (ini_sections == NULL) {
-		return NULL;
-	}
-	if (data == NULL || size == 0u) {
-		return (ini_object*)ini_sections;
-	}
+/*
+ * Parse INI text, calling section_func for each section line and key_func for
+ * each key-value line, with views of the names and values in the text. Names
+ * and unquoted values are trimmed of surrounding whitespace, and quoted values
+ * are passed without their quotation marks. Returns false if the text is
+ * invalid or a callback returned false.
+ */
+typedef bool (* section_func_type)(void* const state, const char* const name, const size_t name_len);
+typedef bool (* key_func_type)(void* const state, const char* const key, const size_t key_len, const char* const value, const size_t value_len);
 
-	char* section_str = NULL;
-	size_t section_len = 0u;
+static bool parse(const char* const data, const size_t size, void* const state, const section_func_type section_func, const key_func_type key_func) {
+	bool in_section = false;
 
 	const char* line = data;
 	size_t len;
@@ -92,13 +83,9 @@ ini_object* ini_create(const char* const data, const size_t size) {
 	next_line(&line, &len, end);
 	while (line < end) {
 		if (line[0] == '[' && line[len - 1] == ']' && len >= 3u) {
-			if (section_str != NULL) {
-				mem_free(section_str);
-			}
-
 			if (len == 3u && (line[1] == ' ' || line[1] == '\t')) {
 				log_printf("Invalid empty section\n");
-				return NULL;
+				return false;
 			}
 
 			size_t start = 1u;
@@ -111,29 +98,18 @@ ini_object* ini_create(const char* const data, const size_t size) {
 			}
 			if (start > end) {
 				log_printf("Invalid empty section\n");
-				return NULL;
+				return false;
 			}
 
-			section_len = end - start + 1u;
-			section_str = (char*)mem_malloc(len);
-			memcpy(section_str, line + start, section_len);
-			strntoupper(section_str, section_len);
-
-			dict_object* const section = dict_create(1u);
-			if (section == NULL) {
-				mem_free(section_str);
-				return NULL;
-			}
-
-			if (!dict_set(ini_sections, section_str, section_len, section, sizeof(section), destroy_section, copy_section)) {
-				mem_free(section_str);
-				return NULL;
+			if (!section_func(state, line + start, end - start + 1u)) {
+				return false;
 			}
+			in_section = true;
 		}
 		else if (line[0] != '=') {
-			if (section_str == NULL) {
+			if (!in_section) {
 				log_printf("Key-value line present without a section preceding it\n");
-				return NULL;
+				return false;
 			}
 
 			size_t end_key;
@@ -149,7 +125,7 @@ ini_object* ini_create(const char* const data, const size_t size) {
 			}
 			if (!found_name || end_key == len || end_key == len - 1u) {
 				log_printf("Invalid key-value line\n");
-				return NULL;
+				return false;
 			}
 			start_value = end_key + 1u;
 
@@ -157,25 +133,19 @@ ini_object* ini_create(const char* const data, const size_t size) {
 				end_key--;
 			} while (line[end_key] == ' ' || line[end_key] == '\t');
 
-			char* const key_str = (char*)mem_malloc(end_key + 1u);
-			memcpy(key_str, line, end_key + 1u);
-			strntoupper(key_str, end_key + 1u);
-
 			while (start_value < len && (line[start_value] == ' ' || line[start_value] == '\t')) {
 				start_value++;
 			}
 			if (start_value == len) {
 				log_printf("Invalid key-value line\n");
-				mem_free(key_str);
-				return NULL;
+				return false;
 			}
 
 			size_t end_value = len;
 			if (line[start_value] == '"') {
 				if (line[start_value + 1u] == '"') {
 					log_printf("Invalid empty string for key's value\n");
-					mem_free(key_str);
-					return NULL;
+					return false;
 				}
 
 				start_value++;
@@ -184,74 +154,130 @@ ini_object* ini_create(const char* const data, const size_t size) {
 				} while (end_value >= start_value && (line[end_value] == ' ' || line[end_value] == '\t'));
 				if (line[end_value] != '"') {
 					log_printf("Invalid quoted value for key; no ending quotation mark\n");
-					mem_free(key_str);
-					return NULL;
-				}
-
-				dict_object* section = NULL;
-				if (!dict_get(ini_sections, section_str, section_len, (void**)&section, NULL)) {
-					mem_free(key_str);
-					return NULL;
-				}
-
-				char* const value_str = (char*)mem_malloc(end_value - start_value + 1u);
-				if (value_str == NULL) {
-					mem_free(key_str);
-					return NULL;
-				}
-				memcpy(value_str, line + start_value, end_value - start_value);
-				value_str[end_value - start_value] = '\0';
-
-				if (!dict_set(section, key_str, end_key + 1u, value_str, end_value - start_value + 1u, NULL, NULL)) {
-					mem_free(value_str);
-					mem_free(key_str);
-					return NULL;
+					return false;
 				}
-				mem_free(value_str);
 			}
 			else {
 				do {
 					end_value--;
 				} while (end_value >= start_value && (line[end_value] == ' ' || line[end_value] == '\t'));
+				end_value++;
+			}
 
-				dict_object* section = NULL;
-				if (!dict_get(ini_sections, section_str, section_len, (void**)&section, NULL)) {
-					mem_free(key_str);
-					return NULL;
-				}
-
-				char* const value_str = (char*)mem_malloc(end_value - start_value + 2u);
-				if (value_str == NULL) {
-					mem_free(key_str);
-					return NULL;
-				}
-				memcpy(value_str, line + start_value, end_value - start_value + 1u);
-				value_str[end_value - start_value + 1u] = '\0';
-
-				if (!dict_set(section, key_str, end_key + 1u, value_str, end_value - start_value + 2u, NULL, NULL)) {
-					mem_free(value_str);
-					mem_free(key_str);
-					return NULL;
-				}
-				mem_free(value_str);
+			if (!key_func(state, line, end_key + 1u, line + start_value, end_value - start_value)) {
+				return false;
 			}
-			mem_free(key_str);
 		}
 		else {
 			log_printf("Invalid key-value line starting with =\n");
-			return NULL;
+			return false;
 		}
 
 		line += len;
 		next_line(&line, &len, end);
 	}
-	if (section_str != NULL) {
-		mem_free(section_str);
+
+	return true;
+}
+
+static bool destroy_section(void* const data) {
+    dict_object* const section = (dict_object*)data;
+	return dict_destroy(section);
+}
+
+static bool copy_section(void* const src_value, const size_t src_size, void** const dst_value, size_t* const dst_size) {
+	*dst_value = dict_copy((dict_object*)src_value);
+	return *dst_value != NULL;
+}
+
+typedef struct create_state {
+	dict_object* sections;
+	dict_object* section;
+} create_state;
+
+static bool create_section(void* const state, const char* const name, const size_t name_len) {
+	create_state* const create = state;
+
+	mem_arena_object* const scratch = mem_scratch_get();
+	if (scratch == NULL) {
+		return false;
+	}
+	const mem_arena_mark mark = mem_arena_mark_get(scratch);
+	char* const section_str = mem_arena_alloc(scratch, name_len, 1u);
+	if (section_str == NULL) {
+		mem_arena_rewind(scratch, mark);
+		return false;
 	}
+	memcpy(section_str, name, name_len);
+	strntoupper(section_str, name_len);
+
+	// Sections appearing again add to the keys they already have.
+	dict_object* section = NULL;
+	if (dict_get(create->sections, section_str, name_len, (void**)&section, NULL)) {
+		mem_arena_rewind(scratch, mark);
+		create->section = section;
+		return true;
+	}
+
+	section = dict_create(1u);
+	if (section == NULL) {
+		mem_arena_rewind(scratch, mark);
+		return false;
+	}
+
+	const bool set = dict_set(create->sections, section_str, name_len, section, sizeof(section), destroy_section, copy_section);
+	mem_arena_rewind(scratch, mark);
+	if (!set) {
+		dict_destroy(section);
+		return false;
+	}
+	create->section = section;
+	return true;
+}
 
-	return (ini_object*)ini_sections;
+static bool create_key(void* const state, const char* const key, const size_t key_len, const char* const value, const size_t value_len) {
+	create_state* const create = state;
+
+	mem_arena_object* const scratch = mem_scratch_get();
+	if (scratch == NULL) {
+		return false;
+	}
+	const mem_arena_mark mark = mem_arena_mark_get(scratch);
+	char* const key_str = mem_arena_alloc(scratch, key_len, 1u);
+	char* const value_str = mem_arena_alloc(scratch, value_len + 1u, 1u);
+	if (key_str == NULL || value_str == NULL) {
+		mem_arena_rewind(scratch, mark);
+		return false;
+	}
+	memcpy(key_str, key, key_len);
+	strntoupper(key_str, key_len);
+	memcpy(value_str, value, value_len);
+	value_str[value_len] = '\0';
+
+	const bool set = dict_set(create->section, key_str, key_len, value_str, value_len + 1u, NULL, NULL);
+	mem_arena_rewind(scratch, mark);
+	return set;
 }
 
+ini_object* ini_create(const char* const data, const size_t size) {
+	create_state state = {
+		.sections = dict_create(1u),
+		.section = NULL
+	};
+	if (state.sections == NULL) {
+		return NULL;
+	}
+	if (data == NULL || size == 0u) {
+		return (ini_object*)state.sections;
+	}
+
+	if (!parse(data, size, &state, create_section, create_key)) {
+		dict_destroy(state.sections);
+		return NULL;
+	}
+
+	return (ini_object*)state.sections;
+}
 
 void ini_destroy(ini_object* const ini) {
 	dict_destroy((dict_object*)ini);
@@ -422,33 +448,48 @@ static bool map_sections_size(void* const data, const void* const key, const siz
 	return status;
 }
 
-static bool map_keys_print(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size) {
-	char** const printout = (char**)data;
-
-	memcpy(*printout, key, key_size);
-	strcpy(*printout + key_size, " = \"");
-	memcpy(*printout + key_size + 4u, value, value_size - 1u);
-	strcpy(*printout + key_size + 4u + value_size - 1u, "\"\n");
+typedef struct printout_state {
+	ini_write_func write;
+	void* data;
+} printout_state;
 
-	*printout += key_size + 4u + value_size + 1u;
+static bool map_keys_print(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size) {
+	const printout_state* const printout = data;
 
-	return true;
+	return
+		printout->write(printout->data, key, key_size) &&
+		printout->write(printout->data, " = \"", 4u) &&
+		printout->write(printout->data, value, value_size - 1u) &&
+		printout->write(printout->data, "\"\n", 2u);
 }
 
 static bool map_sections_print(void* const data, const void* const key, const size_t key_size, void* const value, const size_t value_size) {
-	char** const printout = (char**)data;
-
-	**printout = '[';
-	memcpy(*printout + 1u, key, key_size);
-	strcpy(*printout + 1u + key_size, "]\n");
-
-	*printout += 1u + key_size + 2u;
+	const printout_state* const printout = data;
+
+	return
+		printout->write(printout->data, "[", 1u) &&
+		printout->write(printout->data, key, key_size) &&
+		printout->write(printout->data, "]\n", 2u) &&
+		dict_map((dict_object*)value, data, map_keys_print) &&
+		printout->write(printout->data, "\n", 1u);
+}
 
-	dict_map((dict_object*)value, data, map_keys_print);
+bool ini_printout_write(ini_object* const ini, const ini_write_func write, void* const data) {
+	if (ini == NULL || write == NULL) {
+		return false;
+	}
 
-	**printout = '\n';
-	(*printout)++;
+	printout_state printout = {
+		.write = write,
+		.data = data
+	};
+	return dict_map((dict_object*)ini, &printout, map_sections_print);
+}
 
+static bool buffer_write(void* const data, const void* const bytes, const size_t size) {
+	char** const buffer = data;
+	memcpy(*buffer, bytes, size);
+	*buffer += size;
 	return true;
 }
 
@@ -465,8 +506,169 @@ bool ini_printout_get(ini_object* const ini, void** const printout, size_t* cons
 		return false;
 	}
 
-	void* map_printout = *printout;
-	dict_map((dict_object*)ini, &map_printout, map_sections_print);
+	char* buffer = *printout;
+	ini_printout_write(ini, buffer_write, &buffer);
 
 	return true;
 }
+
+/*
+ * Views keep the source text, with sections and keys as offsets into it, in
+ * the order they appear. Names are compared case-insensitively, as the other
+ * INI functions uppercase them.
+ */
+typedef struct view_span {
+	size_t offset;
+	size_t length;
+} view_span;
+
+typedef struct view_entry {
+	size_t section;
+	view_span key;
+	view_span value;
+} view_entry;
+
+struct ini_view_object {
+	const char* data;
+
+	view_span* sections;
+	size_t num_sections;
+	size_t sections_size;
+
+	view_entry* entries;
+	size_t num_entries;
+	size_t entries_size;
+};
+
+static bool view_section(void* const state, const char* const name, const size_t name_len) {
+	ini_view_object* const view = state;
+
+	if (view->num_sections == view->sections_size) {
+		const size_t new_size = view->sections_size * 2u;
+		view_span* const new_sections = mem_realloc(view->sections, sizeof(view_span) * new_size);
+		if (new_sections == NULL) {
+			return false;
+		}
+		view->sections = new_sections;
+		view->sections_size = new_size;
+	}
+	view->sections[view->num_sections++] = (view_span) { (size_t)(name - view->data), name_len };
+	return true;
+}
+
+static bool view_key(void* const state, const char* const key, const size_t key_len, const char* const value, const size_t value_len) {
+	ini_view_object* const view = state;
+
+	if (view->num_entries == view->entries_size) {
+		const size_t new_size = view->entries_size * 2u;
+		view_entry* const new_entries = mem_realloc(view->entries, sizeof(view_entry) * new_size);
+		if (new_entries == NULL) {
+			return false;
+		}
+		view->entries = new_entries;
+		view->entries_size = new_size;
+	}
+	view->entries[view->num_entries++] = (view_entry) {
+		.section = view->num_sections - 1u,
+		.key = { (size_t)(key - view->data), key_len },
+		.value = { (size_t)(value - view->data), value_len }
+	};
+	return true;
+}
+
+ini_view_object* ini_view_create(const char* const data, const size_t size) {
+	ini_view_object* const view = mem_malloc(sizeof(ini_view_object));
+	if (view == NULL) {
+		return NULL;
+	}
+
+	*view = (ini_view_object) {
+		.data = data,
+		.sections = mem_malloc(sizeof(view_span) * 8u),
+		.sections_size = 8u,
+		.entries = mem_malloc(sizeof(view_entry) * 32u),
+		.entries_size = 32u
+	};
+	if (view->sections == NULL || view->entries == NULL) {
+		ini_view_destroy(view);
+		return NULL;
+	}
+
+	if (data != NULL && size > 0u && !parse(data, size, view, view_section, view_key)) {
+		ini_view_destroy(view);
+		return NULL;
+	}
+
+	return view;
+}
+
+void ini_view_destroy(ini_view_object* const view) {
+	if (view != NULL) {
+		mem_free(view->sections);
+		mem_free(view->entries);
+		mem_free(view);
+	}
+}
+
+static bool span_equals(const ini_view_object* const view, const view_span span, const char* const name) {
+	const char* const text = view->data + span.offset;
+	for (size_t i = 0u; i < span.length; i++) {
+		if (name[i] == '\0' || toupper((unsigned char)text[i]) != toupper((unsigned char)name[i])) {
+			return false;
+		}
+	}
+	return name[span.length] == '\0';
+}
+
+ini_handle ini_view_resolve(const ini_view_object* const view, const char* const section, const char* const key) {
+	assert(view != NULL);
+	assert(section != NULL);
+	assert(key != NULL);
+
+	// Later keys override earlier ones, so the search is from the end.
+	for (size_t i = view->num_entries; i > 0u; i--) {
+		const view_entry* const entry = &view->entries[i - 1u];
+		if (span_equals(view, entry->key, key) && span_equals(view, view->sections[entry->section], section)) {
+			return (ini_handle)i;
+		}
+	}
+	return INI_HANDLE_NONE;
+}
+
+ini_string ini_view_get(const ini_view_object* const view, const ini_handle handle) {
+	assert(view != NULL);
+	assert(handle <= view->num_entries);
+
+	if (handle == INI_HANDLE_NONE) {
+		return (ini_string) { NULL, 0u };
+	}
+	const view_span value = view->entries[handle - 1u].value;
+	return (ini_string) { view->data + value.offset, value.length };
+}
+
+int ini_view_getf(const ini_view_object* const view, const ini_handle handle, const char* const format, ...) {
+	const ini_string value = ini_view_get(view, handle);
+	if (value.text == NULL) {
+		return EOF;
+	}
+
+	// Values are copied to be NUL-terminated for sscanf, on the stack when
+	// they're short, as they nearly always are.
+	char short_text[128];
+	char* const text = value.length < sizeof(short_text) ? short_text : mem_malloc(value.length + 1u);
+	if (text == NULL) {
+		return EOF;
+	}
+	memcpy(text, value.text, value.length);
+	text[value.length] = '\0';
+
+	va_list args;
+	va_start(args, format);
+	const int n = vsscanf(text, format, args);
+	va_end(args);
+
+	if (text != short_text) {
+		mem_free(text);
+	}
+	return n;
+}
@@ -0,0 +1,583 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/jobs.h"
+#include "util/private/log_private.h"
+#include "util/private/threads.h"
+#include "main/private/prog_private.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "util/str.h"
+#include "util/nanotime.h"
+#include "SDL_thread.h"
+#include "SDL_cpuinfo.h"
+#include "SDL_timer.h"
+#include <stdint.h>
+#include <assert.h>
+
+/*
+ * Deques are fixed size, so thieves never see a deque's jobs move; when a
+ * thread's deque is full, it just runs the jobs it would have pushed itself.
+ * Must be a power of two.
+ */
+#define DEQUE_SIZE ((size_t)4096u)
+
+#define CACHE_LINE_SIZE 64u
+
+/*
+ * Idle workers sleep until woken by new jobs, but also wake this often to look
+ * for jobs, in case a wakeup was missed.
+ */
+#define IDLE_TIMEOUT_MS 10u
+
+/*
+ * At most this many subranges are run by one jobs_parallel_for.
+ */
+#define PARALLEL_FOR_MAX_JOBS ((size_t)256u)
+
+typedef struct job_type {
+	jobs_func func;
+	void* data;
+	jobs_counter_type* counter;
+} job_type;
+
+/*
+ * Jobs deferred until their dependency is done, or run from threads without a
+ * deque.
+ */
+struct jobs_waiter {
+	job_type job;
+	jobs_waiter* next;
+};
+
+/*
+ * Chase-Lev deque. The owner pushes and pops at bottom, thieves steal at top.
+ * The indices only ever increase, wrapping around, so they're only compared by
+ * their difference. top and bottom are kept on separate cache lines, so
+ * thieves contending on top don't slow down the owner.
+ */
+typedef struct jobs_deque {
+	SDL_atomic_t top;
+	unsigned char top_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+	SDL_atomic_t bottom;
+	unsigned char bottom_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+	job_type jobs[DEQUE_SIZE];
+} jobs_deque;
+
+static bool inited = false;
+static size_t num_workers = 0u;
+static SDL_Thread** workers = NULL;
+
+/*
+ * Deque zero belongs to the thread that initialized the job system, the rest
+ * to the workers. The thread local value is the index of the thread's deque
+ * plus one, so threads without a deque get zero.
+ */
+static jobs_deque* deques = NULL;
+static SDL_TLSID deque_tls = 0;
+
+static SDL_SpinLock injected_lock;
+static jobs_waiter* injected_head = NULL;
+static jobs_waiter** injected_tail = &injected_head;
+
+static SDL_sem* wake_sem = NULL;
+static SDL_atomic_t num_sleeping = { 0 };
+static SDL_atomic_t quit = { 0 };
+static SDL_atomic_t steal_start = { 0 };
+
+static int index_add(const int index, const int value) {
+	return (int)((unsigned)index + (unsigned)value);
+}
+
+static int index_diff(const int a, const int b) {
+	return (int)((unsigned)a - (unsigned)b);
+}
+
+static bool deque_push(jobs_deque* const deque, const job_type* const job) {
+	const int bottom = SDL_AtomicGet(&deque->bottom);
+	const int top = SDL_AtomicGet(&deque->top);
+	SDL_MemoryBarrierAcquire();
+	if ((size_t)index_diff(bottom, top) >= DEQUE_SIZE) {
+		return false;
+	}
+
+	deque->jobs[(unsigned)bottom & (DEQUE_SIZE - 1u)] = *job;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&deque->bottom, index_add(bottom, 1));
+	return true;
+}
+
+static bool deque_pop(jobs_deque* const deque, job_type* const job) {
+	// The add is a full barrier, so thieves see the reservation of the bottom
+	// job before top is read.
+	const int bottom = index_add(SDL_AtomicAdd(&deque->bottom, -1), -1);
+	const int top = SDL_AtomicGet(&deque->top);
+	SDL_MemoryBarrierAcquire();
+
+	const int size = index_diff(bottom, top);
+	if (size < 0) {
+		SDL_AtomicSet(&deque->bottom, top);
+		return false;
+	}
+
+	*job = deque->jobs[(unsigned)bottom & (DEQUE_SIZE - 1u)];
+	if (size > 0) {
+		return true;
+	}
+
+	// Taking the last job races with thieves.
+	const bool taken = SDL_AtomicCAS(&deque->top, top, index_add(top, 1));
+	SDL_AtomicSet(&deque->bottom, index_add(top, 1));
+	return taken;
+}
+
+static bool deque_steal(jobs_deque* const deque, job_type* const job) {
+	const int top = SDL_AtomicGet(&deque->top);
+	SDL_MemoryBarrierAcquire();
+	const int bottom = SDL_AtomicGet(&deque->bottom);
+	SDL_MemoryBarrierAcquire();
+	if (index_diff(bottom, top) <= 0) {
+		return false;
+	}
+
+	const job_type stolen = deque->jobs[(unsigned)top & (DEQUE_SIZE - 1u)];
+	if (!SDL_AtomicCAS(&deque->top, top, index_add(top, 1))) {
+		return false;
+	}
+	*job = stolen;
+	return true;
+}
+
+static bool deque_empty(jobs_deque* const deque) {
+	const int top = SDL_AtomicGet(&deque->top);
+	const int bottom = SDL_AtomicGet(&deque->bottom);
+	return index_diff(bottom, top) <= 0;
+}
+
+static bool injected_pop(job_type* const job) {
+	if (SDL_AtomicGetPtr((void**)&injected_head) == NULL) {
+		return false;
+	}
+
+	SDL_AtomicLock(&injected_lock);
+	jobs_waiter* const waiter = injected_head;
+	if (waiter != NULL) {
+		SDL_AtomicSetPtr((void**)&injected_head, waiter->next);
+		if (waiter->next == NULL) {
+			injected_tail = &injected_head;
+		}
+	}
+	SDL_AtomicUnlock(&injected_lock);
+
+	if (waiter == NULL) {
+		return false;
+	}
+	*job = waiter->job;
+	mem_free(waiter);
+	return true;
+}
+
+static void injected_push(jobs_waiter* const waiter) {
+	waiter->next = NULL;
+	SDL_AtomicLock(&injected_lock);
+	*injected_tail = waiter;
+	injected_tail = &waiter->next;
+	SDL_AtomicUnlock(&injected_lock);
+}
+
+/*
+ * Returns the index of the calling thread's deque, or -1 if it has none.
+ */
+static int self_get() {
+	return (int)(intptr_t)SDL_TLSGet(deque_tls) - 1;
+}
+
+static void workers_wake() {
+	if (SDL_AtomicGet(&num_sleeping) > 0) {
+		SDL_SemPost(wake_sem);
+	}
+}
+
+static void job_execute(const job_type* const job);
+
+/*
+ * Queue the job, or run it immediately if it can't be queued. Takes ownership
+ * of waiter, if it isn't NULL, which must hold the job.
+ */
+static void job_push(const job_type* const job, jobs_waiter* waiter) {
+	const int self = self_get();
+	if (self >= 0 && deque_push(&deques[self], job)) {
+		if (waiter != NULL) {
+			mem_free(waiter);
+		}
+		workers_wake();
+		return;
+	}
+	else if (self < 0) {
+		if (waiter == NULL) {
+			waiter = mem_malloc(sizeof(jobs_waiter));
+		}
+		if (waiter != NULL) {
+			waiter->job = *job;
+			injected_push(waiter);
+			workers_wake();
+			return;
+		}
+	}
+	else if (waiter != NULL) {
+		mem_free(waiter);
+	}
+
+	job_execute(job);
+}
+
+static void counter_decrement(jobs_counter_type* const counter) {
+	SDL_AtomicLock(&counter->lock);
+	jobs_waiter* waiters = NULL;
+	if (SDL_AtomicAdd(&counter->count, -1) == 1) {
+		waiters = counter->waiters;
+		counter->waiters = NULL;
+	}
+	SDL_AtomicUnlock(&counter->lock);
+
+	// The counter must not be touched beyond here, as a waiter could now see
+	// it done and destroy it.
+	while (waiters != NULL) {
+		jobs_waiter* const next = waiters->next;
+		job_push(&waiters->job, waiters);
+		waiters = next;
+	}
+}
+
+static void job_execute(const job_type* const job) {
+	job->func(job->data);
+	if (job->counter != NULL) {
+		counter_decrement(job->counter);
+	}
+}
+
+static bool job_find(const int self, job_type* const job) {
+	if (self >= 0 && deque_pop(&deques[self], job)) {
+		return true;
+	}
+	else if (injected_pop(job)) {
+		return true;
+	}
+
+	// Thieves start at different deques, so they don't all contend on the
+	// same deque.
+	const size_t num_deques = num_workers + 1u;
+	const size_t start = (size_t)(unsigned)SDL_AtomicAdd(&steal_start, 1);
+	for (size_t i = 0u; i < num_deques; i++) {
+		const size_t victim = (start + i) % num_deques;
+		if ((int)victim != self && deque_steal(&deques[victim], job)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool jobs_available() {
+	if (SDL_AtomicGetPtr((void**)&injected_head) != NULL) {
+		return true;
+	}
+	for (size_t i = 0u; i < num_workers + 1u; i++) {
+		if (!deque_empty(&deques[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int SDLCALL worker_func(void* const data) {
+	const size_t index = (size_t)(uintptr_t)data;
+
+	char* const name = alloc_sprintf("jobs %zu", index);
+	if (name == NULL || !prog_this_thread_name_set(name)) {
+		log_printf("Error setting the name of job worker %zu\n", index);
+	}
+	if (name != NULL) {
+		mem_free(name);
+	}
+#ifndef STDOUT_LOG
+	char* const log_filename = alloc_sprintf("log_jobs_%zu.txt", index);
+	if (log_filename == NULL || !log_filename_set(log_filename)) {
+		log_printf("Error setting the log filename of job worker %zu\n", index);
+	}
+	if (log_filename != NULL) {
+		mem_free(log_filename);
+	}
+#endif
+	threads_current_set(THREADS_CLASS_WORKER);
+	SDL_TLSSet(deque_tls, (void*)(intptr_t)(index + 1u), NULL);
+
+	while (!SDL_AtomicGet(&quit)) {
+		job_type job;
+		if (job_find((int)index, &job)) {
+			job_execute(&job);
+			continue;
+		}
+
+		SDL_AtomicIncRef(&num_sleeping);
+		if (!jobs_available() && !SDL_AtomicGet(&quit)) {
+			SDL_SemWaitTimeout(wake_sem, IDLE_TIMEOUT_MS);
+		}
+		SDL_AtomicDecRef(&num_sleeping);
+	}
+
+	prog_this_thread_name_set(NULL);
+	return 0;
+}
+
+void jobs_counter_init(jobs_counter_type* const counter) {
+	assert(counter != NULL);
+
+	SDL_AtomicSet(&counter->count, 0);
+	counter->lock = 0;
+	counter->waiters = NULL;
+}
+
+bool jobs_counter_done(jobs_counter_type* const counter) {
+	assert(counter != NULL);
+
+	return SDL_AtomicGet(&counter->count) == 0;
+}
+
+bool jobs_init(size_t requested_workers) {
+	assert(!inited);
+
+	log_printf("Initializing the job system\n");
+
+	if (requested_workers == 0u) {
+		const int num_cpus = SDL_GetCPUCount();
+		requested_workers = num_cpus > 3 ? (size_t)num_cpus - 2u : 1u;
+	}
+
+	deque_tls = SDL_TLSCreate();
+	if (deque_tls == 0) {
+		log_printf("Error creating the job system's thread local storage: %s\n", SDL_GetError());
+		return false;
+	}
+
+	wake_sem = SDL_CreateSemaphore(0u);
+	if (wake_sem == NULL) {
+		log_printf("Error creating the job system's semaphore: %s\n", SDL_GetError());
+		return false;
+	}
+
+	deques = mem_calloc(requested_workers + 1u, sizeof(jobs_deque));
+	workers = mem_calloc(requested_workers, sizeof(SDL_Thread*));
+	if (deques == NULL || workers == NULL) {
+		log_printf("Error allocating the job system's deques\n");
+		jobs_deinit();
+		return false;
+	}
+	if (SDL_TLSSet(deque_tls, (void*)(intptr_t)1, NULL) < 0) {
+		log_printf("Error setting the job system's thread local storage: %s\n", SDL_GetError());
+		jobs_deinit();
+		return false;
+	}
+
+	SDL_AtomicSet(&quit, 0);
+	inited = true;
+	for (num_workers = 0u; num_workers < requested_workers; num_workers++) {
+		workers[num_workers] = SDL_CreateThread(worker_func, "jobs_thread", (void*)(uintptr_t)(num_workers + 1u));
+		if (workers[num_workers] == NULL) {
+			log_printf("Error creating a job worker thread: %s\n", SDL_GetError());
+			jobs_deinit();
+			return false;
+		}
+	}
+
+	log_printf("Successfully initialized the job system with %zu workers\n", num_workers);
+	return true;
+}
+
+void jobs_deinit() {
+	if (workers != NULL) {
+		SDL_AtomicSet(&quit, 1);
+		for (size_t i = 0u; i < num_workers; i++) {
+			SDL_SemPost(wake_sem);
+		}
+		for (size_t i = 0u; i < num_workers; i++) {
+			SDL_WaitThread(workers[i], NULL);
+		}
+		mem_free(workers);
+		workers = NULL;
+	}
+	num_workers = 0u;
+	inited = false;
+
+	while (injected_head != NULL) {
+		jobs_waiter* const next = injected_head->next;
+		mem_free(injected_head);
+		injected_head = next;
+	}
+	injected_tail = &injected_head;
+
+	if (deques != NULL) {
+		mem_free(deques);
+		deques = NULL;
+	}
+	if (wake_sem != NULL) {
+		SDL_DestroySemaphore(wake_sem);
+		wake_sem = NULL;
+	}
+	if (deque_tls != 0) {
+		SDL_TLSSet(deque_tls, NULL, NULL);
+	}
+}
+
+size_t jobs_num_threads_get() {
+	return inited ? num_workers + 1u : 1u;
+}
+
+void jobs_run(const jobs_func func, void* const data, jobs_counter_type* const counter) {
+	assert(func != NULL);
+
+	const job_type job = {
+		.func = func,
+		.data = data,
+		.counter = counter
+	};
+	if (counter != NULL) {
+		SDL_AtomicIncRef(&counter->count);
+	}
+
+	if (!inited) {
+		job_execute(&job);
+	}
+	else {
+		job_push(&job, NULL);
+	}
+}
+
+bool jobs_run_after(jobs_counter_type* const dependency, const jobs_func func, void* const data, jobs_counter_type* const counter) {
+	assert(dependency != NULL);
+	assert(func != NULL);
+
+	jobs_waiter* const waiter = mem_malloc(sizeof(jobs_waiter));
+	if (waiter == NULL) {
+		return false;
+	}
+	waiter->job.func = func;
+	waiter->job.data = data;
+	waiter->job.counter = counter;
+	if (counter != NULL) {
+		SDL_AtomicIncRef(&counter->count);
+	}
+
+	SDL_AtomicLock(&dependency->lock);
+	const bool done = SDL_AtomicGet(&dependency->count) == 0;
+	if (!done) {
+		waiter->next = dependency->waiters;
+		dependency->waiters = waiter;
+	}
+	SDL_AtomicUnlock(&dependency->lock);
+
+	if (done) {
+		if (!inited) {
+			job_execute(&waiter->job);
+			mem_free(waiter);
+		}
+		else {
+			job_push(&waiter->job, waiter);
+		}
+	}
+	return true;
+}
+
+void jobs_wait(jobs_counter_type* const counter) {
+	assert(counter != NULL);
+
+	const int self = inited ? self_get() : -1;
+	while (SDL_AtomicGet(&counter->count) != 0) {
+		job_type job;
+		if (inited && job_find(self, &job)) {
+			job_execute(&job);
+		}
+		else {
+			nanotime_yield();
+		}
+	}
+
+	// The last decrement of the counter is done while holding its lock, so
+	// once the lock is free, nothing else is using the counter.
+	SDL_AtomicLock(&counter->lock);
+	SDL_AtomicUnlock(&counter->lock);
+}
+
+typedef struct parallel_for_job {
+	jobs_range_func func;
+	void* data;
+	size_t start;
+	size_t end;
+} parallel_for_job;
+
+static void parallel_for_func(void* const data) {
+	const parallel_for_job* const job = data;
+	job->func(job->data, job->start, job->end);
+}
+
+void jobs_parallel_for(const size_t count, size_t grain, const jobs_range_func func, void* const data) {
+	assert(func != NULL);
+
+	if (count == 0u) {
+		return;
+	}
+
+	const size_t num_threads = jobs_num_threads_get();
+	if (grain == 0u) {
+		grain = count / (num_threads * 4u);
+		if (grain == 0u) {
+			grain = 1u;
+		}
+	}
+	if (num_threads == 1u || count <= grain) {
+		func(data, 0u, count);
+		return;
+	}
+
+	size_t num_jobs = (count + grain - 1u) / grain;
+	if (num_jobs > PARALLEL_FOR_MAX_JOBS) {
+		num_jobs = PARALLEL_FOR_MAX_JOBS;
+		grain = (count + num_jobs - 1u) / num_jobs;
+		num_jobs = (count + grain - 1u) / grain;
+	}
+
+	parallel_for_job jobs[PARALLEL_FOR_MAX_JOBS];
+	jobs_counter_type counter;
+	jobs_counter_init(&counter);
+	for (size_t i = 0u; i < num_jobs; i++) {
+		jobs[i].func = func;
+		jobs[i].data = data;
+		jobs[i].start = i * grain;
+		jobs[i].end = i * grain + grain < count ? i * grain + grain : count;
+	}
+	for (size_t i = 1u; i < num_jobs; i++) {
+		jobs_run(parallel_for_func, &jobs[i], &counter);
+	}
+	parallel_for_func(&jobs[0u]);
+	jobs_wait(&counter);
+}
@@ -29,10 +29,27 @@
 #include "util/mem.h"
 #include "main/main.h"
 #include "SDL_thread.h"
+#include "SDL_mutex.h"
+#include "SDL_timer.h"
 #include "SDL_rwops.h"
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <assert.h>
 
+/*
+ * The all-output writer thread gathers queued text into a buffer of this size,
+ * writing the buffer once full, and once the queue is empty.
+ */
+#define OUTPUT_BUFFER_SIZE ((size_t)1u << 16)
+
+/*
+ * The writer thread wakes up to drain the queue this often, or sooner, once
+ * WAKE_DEPTH texts are queued.
+ */
+#define WRITER_PERIOD_MS 10u
+#define WAKE_DEPTH 256
+
 static SDL_atomic_t inited_flag = { 0 };
 static bool print_to_all_output = true;
 
@@ -40,6 +57,22 @@ static bool print_all_output_to_stdout;
 static SDL_RWops* all_output_file = NULL;
 static conqueue_object* all_output_queue = NULL;
 
+static SDL_Thread* writer_thread = NULL;
+static SDL_sem* wake_sem = NULL;
+static SDL_atomic_t writer_quit = { 0 };
+static SDL_atomic_t writer_failed = { 0 };
+static SDL_threadID writer_thread_id;
+static char* output_buffer = NULL;
+static size_t output_length;
+
+static SDL_atomic_t overflow_policy = { LOG_OVERFLOW_BLOCK };
+static SDL_atomic_t depth_limit = { LOG_DEPTH_LIMIT_DEFAULT };
+
+static SDL_atomic_t queue_depth = { 0 };
+static SDL_atomic_t queue_depth_max = { 0 };
+static SDL_atomic_t dropped_total = { 0 };
+static SDL_atomic_t dropped_pending = { 0 };
+
 static SDL_TLSID output_files = 0;
 
 static void SDLCALL file_destroy(void* data) {
@@ -68,6 +101,115 @@ static bool inited() {
 	return !!current_inited;
 }
 
+static bool output_flush() {
+	if (output_length == 0u) {
+		return true;
+	}
+
+	bool wrote;
+	if (print_all_output_to_stdout) {
+		wrote = fwrite(output_buffer, 1u, output_length, stdout) == output_length && fflush(stdout) != EOF;
+	}
+	else {
+		wrote = SDL_RWwrite(all_output_file, output_buffer, output_length, 1u) == 1u;
+	}
+	output_length = 0u;
+	return wrote;
+}
+
+static bool output_put(const char* const text, const size_t length) {
+	if (output_length + length > OUTPUT_BUFFER_SIZE && !output_flush()) {
+		return false;
+	}
+
+	if (length > OUTPUT_BUFFER_SIZE) {
+		if (print_all_output_to_stdout) {
+			return fwrite(text, 1u, length, stdout) == length;
+		}
+		else {
+			return SDL_RWwrite(all_output_file, text, length, 1u) == 1u;
+		}
+	}
+
+	memcpy(output_buffer + output_length, text, length);
+	output_length += length;
+	return true;
+}
+
+/*
+ * Write all the queued text. Returns whether there was any.
+ */
+static bool queue_drain() {
+	bool any = false;
+	bool success = true;
+	char* text;
+	while ((text = conqueue_dequeue(all_output_queue)) != NULL) {
+		SDL_AtomicAdd(&queue_depth, -1);
+		success = output_put(text, strlen(text)) && success;
+		mem_free(text);
+		any = true;
+	}
+
+	const int dropped = SDL_AtomicSet(&dropped_pending, 0);
+	if (dropped > 0) {
+		char notice[64];
+		const int length = snprintf(notice, sizeof(notice), "%d log messages dropped\n", dropped);
+		success = length > 0 && output_put(notice, (size_t)length) && success;
+	}
+
+	success = output_flush() && success;
+	if (!success) {
+		SDL_AtomicSet(&writer_failed, 1);
+	}
+	return any;
+}
+
+/*
+ * The writer thread is the queue's consumer, so it also destroys the queue,
+ * once it's been drained for the last time. The writer thread never logs, as
+ * it would then be waiting on itself when blocking on a full queue.
+ */
+static int SDLCALL writer_func(void* const data) {
+	(void)data;
+
+	mem_tag_set(MEM_TAG_LOG);
+
+	while (true) {
+		const bool quitting = SDL_AtomicGet(&writer_quit);
+		SDL_MemoryBarrierAcquire();
+
+		const bool any = queue_drain();
+		if (quitting) {
+			break;
+		}
+		else if (!any) {
+			SDL_SemWaitTimeout(wake_sem, WRITER_PERIOD_MS);
+		}
+	}
+
+	conqueue_destroy(all_output_queue);
+	all_output_queue = NULL;
+	return 0;
+}
+
+static bool writer_init() {
+	output_buffer = mem_malloc(OUTPUT_BUFFER_SIZE);
+	wake_sem = SDL_CreateSemaphore(0u);
+	if (output_buffer == NULL || wake_sem == NULL) {
+		return false;
+	}
+	output_length = 0u;
+	SDL_AtomicSet(&writer_quit, 0);
+	SDL_AtomicSet(&writer_failed, 0);
+
+	writer_thread = SDL_CreateThread(writer_func, "log_output_thread", NULL);
+	if (writer_thread == NULL) {
+		return false;
+	}
+	writer_thread_id = SDL_GetThreadID(writer_thread);
+	return true;
+}
+
 bool log_init(const char* const all_output) {
 	assert(main_thread_is_this_thread());
 	assert(output_files == 0);
@@ -105,6 +247,12 @@ bool log_init(const char* const all_output) {
 			return false;
 		}
 
+		const bool writer_inited = writer_init();
+		assert(writer_inited);
+		if (!writer_inited) {
+			return false;
+		}
+
 		print_to_all_output = true;
 	}
 	else {
@@ -130,11 +278,31 @@ bool log_all_output_deinit() {
 	else if (!print_to_all_output) {
 		return true;
 	}
-	else if (!log_all_output_dequeue(LOG_ALL_OUTPUT_DEQUEUE_EMPTY)) {
-		return false;
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&inited_flag, 0);
+
+	if (writer_thread != NULL) {
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&writer_quit, 1);
+		SDL_SemPost(wake_sem);
+		SDL_WaitThread(writer_thread, NULL);
+		writer_thread = NULL;
 	}
+	else if (all_output_queue != NULL) {
+		conqueue_destroy(all_output_queue);
+		all_output_queue = NULL;
+	}
+	const bool success = !SDL_AtomicGet(&writer_failed);
 
-	conqueue_destroy(all_output_queue);
+	if (wake_sem != NULL) {
+		SDL_DestroySemaphore(wake_sem);
+		wake_sem = NULL;
+	}
+	if (output_buffer != NULL) {
+		mem_free(output_buffer);
+		output_buffer = NULL;
+	}
 
 	if (print_all_output_to_stdout) {
 		fflush(stdout);
@@ -144,66 +312,65 @@ bool log_all_output_deinit() {
 		all_output_file = NULL;
 	}
 
-	SDL_MemoryBarrierRelease();
-	SDL_AtomicSet(&inited_flag, 0);
-
-	return true;
+	return success;
 }
 
-bool log_all_output_dequeue(const uint64_t allotted_time) {
-	const uint64_t start_time = nanotime_now();
-	const uint64_t now_max = nanotime_now_max();
+void log_overflow_set(const log_overflow_policy policy, const size_t limit) {
+	assert(policy >= 0 && policy < LOG_OVERFLOW_NUM);
+	assert(limit <= INT_MAX);
 
-	if (!inited()) {
-		return true;
-	}
+	SDL_AtomicSet(&overflow_policy, (int)policy);
+	SDL_AtomicSet(&depth_limit, (int)limit);
+}
 
-	assert(print_to_all_output);
-	if (!print_to_all_output) {
-		return true;
-	}
+void log_stats_get(log_stats* const stats) {
+	assert(stats != NULL);
 
-	if (print_all_output_to_stdout) {
-		const bool is_main_thread = main_thread_is_this_thread();
-		assert(is_main_thread);
-		if (!is_main_thread) {
-			return false;
-		}
+	const int depth = SDL_AtomicGet(&queue_depth);
+	stats->depth = depth > 0 ? (size_t)depth : 0u;
+	stats->depth_max = (size_t)SDL_AtomicGet(&queue_depth_max);
+	stats->dropped = (size_t)SDL_AtomicGet(&dropped_total);
+	stats->failed = !!SDL_AtomicGet(&writer_failed);
+}
 
-		for (
-			char* text = conqueue_dequeue(all_output_queue);
-			(allotted_time == LOG_ALL_OUTPUT_DEQUEUE_EMPTY || nanotime_interval(start_time, nanotime_now(), now_max) < allotted_time) && text != NULL;
-			text = conqueue_dequeue(all_output_queue)
-		) {
-			const bool put = fputs(text, stdout) != EOF;
+/*
+ * Queue the text for the writer thread, which takes ownership of the text.
+ * Once the queue is as deep as the limit, the text is either dropped or waits
+ * for the writer thread to catch up, per the overflow policy.
+ */
+static void all_output_enqueue(char* const text) {
+	const int limit = SDL_AtomicGet(&depth_limit);
+	if (limit > 0 && SDL_AtomicGet(&queue_depth) >= limit) {
+		if (SDL_AtomicGet(&overflow_policy) == LOG_OVERFLOW_DROP) {
+			SDL_AtomicAdd(&dropped_total, 1);
+			SDL_AtomicAdd(&dropped_pending, 1);
 			mem_free(text);
-			assert(put);
-			if (!put) {
-				return false;
-			}
-		}
-		const bool flushed = fflush(stdout) != EOF;
-		assert(flushed);
-		if (!flushed) {
-			return false;
+			return;
 		}
-	}
-	else {
-		for (
-			char* text = conqueue_dequeue(all_output_queue);
-			(allotted_time == LOG_ALL_OUTPUT_DEQUEUE_EMPTY || nanotime_interval(start_time, nanotime_now(), now_max) < allotted_time) && text != NULL;
-			text = conqueue_dequeue(all_output_queue)
-		) {
-			const bool wrote = SDL_RWwrite(all_output_file, text, strlen(text), 1u) == 1u;
-			mem_free(text);
-			assert(wrote);
-			if (!wrote) {
-				return false;
+		else if (SDL_ThreadID() != writer_thread_id) {
+			while (SDL_AtomicGet(&queue_depth) >= limit) {
+				SDL_SemPost(wake_sem);
+				SDL_Delay(1u);
 			}
 		}
 	}
 
-	return true;
+	const bool enqueued = conqueue_enqueue(all_output_queue, text);
+	assert(enqueued);
+	if (!enqueued) {
+		mem_free(text);
+		abort();
+	}
+
+	const int depth = SDL_AtomicAdd(&queue_depth, 1) + 1;
+	for (int depth_max = SDL_AtomicGet(&queue_depth_max); depth > depth_max; depth_max = SDL_AtomicGet(&queue_depth_max)) {
+		if (SDL_AtomicCAS(&queue_depth_max, depth_max, depth)) {
+			break;
+		}
+	}
+	if (depth == WAKE_DEPTH) {
+		SDL_SemPost(wake_sem);
+	}
 }
 
 bool log_filename_set(const char* const filename) {
@@ -269,6 +436,7 @@ void log_text(const char* const text) {
 	}
 	else if (print_to_all_output) {
 		const char* const thread_name = prog_this_thread_name_get();
+		const mem_tag_type tag = mem_tag_set(MEM_TAG_LOG);
 		char* enqueued_text;
 		if (thread_name == NULL) {
 			enqueued_text = alloc_sprintf("%s", text);
@@ -276,19 +444,13 @@ void log_text(const char* const text) {
 		else {
 			enqueued_text = alloc_sprintf("[%s thread] %s", thread_name, text);
 		}
+		mem_tag_set(tag);
 		assert(enqueued_text != NULL);
 		if (enqueued_text == NULL) {
 			abort();
 		}
-		const bool enqueued = conqueue_enqueue(all_output_queue, enqueued_text);
-		assert(enqueued);
-		if (!enqueued) {
-			mem_free(enqueued_text);
-			abort();
-		}
-		else {
-			return;
-		}
+		all_output_enqueue(enqueued_text);
+		return;
 	}
 	else {
 		SDL_RWops* const file = file_get();
@@ -306,6 +468,7 @@ void log_text(const char* const text) {
 }
 
 static char* formatted_text_alloc(const char* const format, va_list args) {
+	const mem_tag_type tag = mem_tag_set(MEM_TAG_LOG);
 	char* text;
 	if (inited() && print_to_all_output) {
 		char* const base_text = alloc_vsprintf(format, args);
@@ -326,6 +489,7 @@ static char* formatted_text_alloc(const char* const format, va_list args) {
 		text = alloc_vsprintf(format, args);
 	}
 
+	mem_tag_set(tag);
 	return text;
 }
 
@@ -352,15 +516,8 @@ void log_printf(const char* const format, ...) {
 		return;
 	}
 	else if (print_to_all_output) {
-		const bool enqueued = conqueue_enqueue(all_output_queue, text);
-		assert(enqueued);
-		if (!enqueued) {
-			mem_free(text);
-			abort();
-		}
-		else {
-			return;
-		}
+		all_output_enqueue(text);
+		return;
 	}
 	else {
 		SDL_RWops* const file = file_get();
@@ -400,15 +557,8 @@ void log_vprintf(const char* const format, va_list args) {
 		return;
 	}
 	else if (print_to_all_output) {
-		const bool enqueued = conqueue_enqueue(all_output_queue, text);
-		assert(enqueued);
-		if (!enqueued) {
-			mem_free(text);
-			abort();
-		}
-		else {
-			return;
-		}
+		all_output_enqueue(text);
+		return;
 	}
 	else {
 		SDL_RWops* const file = file_get();
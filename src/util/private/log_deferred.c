@@ -0,0 +1,781 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/private/log_private.h"
+#include "util/private/threads.h"
+#include "main/private/prog_private.h"
+#include "util/str.h"
+#include "util/mem.h"
+#include "util/nanotime.h"
+#include "main/main.h"
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include "SDL_mutex.h"
+#include "SDL_rwops.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <assert.h>
+
+/*
+ * Size in bytes of each thread's ring of records. Must be a power of two.
+ */
+#define RING_SIZE ((uint32_t)1u << 16)
+
+/*
+ * Records are padded to multiples of this, so every record header is aligned.
+ */
+#define RECORD_ALIGN 8u
+
+#define MAX_RECORD_SIZE 1024u
+#define MAX_ARGS 32u
+#define MAX_SPEC_LENGTH 32u
+
+#define OUTPUT_BUFFER_SIZE ((size_t)1u << 16)
+
+/*
+ * The writer thread wakes up to drain the rings this often, or sooner, when a
+ * ring is getting full.
+ */
+#define WRITER_PERIOD_MS 10u
+
+#define CACHE_LINE_SIZE 64u
+
+/*
+ * A record is the header, followed by num_args argument values, followed by
+ * the bytes of the string arguments. A record with a NULL format is padding
+ * to the end of the ring.
+ */
+typedef struct record_header {
+	uint32_t size;
+	uint32_t num_args;
+	uint64_t time;
+	const char* format;
+} record_header;
+
+/*
+ * String arguments are stored as the offset of their bytes from the start of
+ * the strings in the record.
+ */
+typedef union arg_value {
+	long long i;
+	unsigned long long u;
+	double d;
+	const void* p;
+} arg_value;
+
+typedef enum length_type {
+	LENGTH_NONE,
+	LENGTH_HH,
+	LENGTH_H,
+	LENGTH_L,
+	LENGTH_LL,
+	LENGTH_J,
+	LENGTH_Z,
+	LENGTH_T,
+	LENGTH_BIG_L
+} length_type;
+
+/*
+ * A parsed conversion specification. The text from start up to length_start
+ * is the flags, width, and precision, which are reused as is when formatting.
+ */
+typedef struct spec_type {
+	const char* start;
+	const char* length_start;
+	const char* end;
+	bool width_star;
+	bool precision_star;
+	bool has_precision;
+	size_t precision;
+	length_type length;
+	char conversion;
+} spec_type;
+
+/*
+ * Single producer, single consumer ring of records. The owning thread writes
+ * records at tail, the writer thread consumes them at head.
+ */
+typedef struct log_ring log_ring;
+struct log_ring {
+	SDL_atomic_t head;
+	unsigned char head_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+	SDL_atomic_t tail;
+	unsigned char tail_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+	SDL_atomic_t dropped;
+	SDL_atomic_t orphaned;
+	char* thread_name;
+	log_ring* next;
+
+	uint64_t words[RING_SIZE / sizeof(uint64_t)];
+};
+
+static SDL_atomic_t inited_flag = { 0 };
+static SDL_TLSID ring_tls = 0;
+
+/*
+ * Rings are only ever added at the head of the list, by their threads, and
+ * only removed by the writer thread, so the writer can walk the list without
+ * locking.
+ */
+static SDL_SpinLock rings_lock;
+static log_ring* rings = NULL;
+
+static SDL_Thread* writer_thread = NULL;
+static SDL_sem* wake_sem = NULL;
+static SDL_atomic_t wake_pending = { 0 };
+static SDL_atomic_t quit = { 0 };
+
+static bool output_to_stdout = false;
+static SDL_RWops* output_file = NULL;
+static char* output_buffer = NULL;
+static size_t output_length = 0u;
+static uint64_t start_time = 0u;
+
+static const char* spec_parse(const char* const start, spec_type* const spec) {
+	const char* cur = start + 1;
+
+	spec->start = start;
+	while (*cur != '\0' && strchr("-+ #0'", *cur) != NULL) {
+		cur++;
+	}
+
+	spec->width_star = *cur == '*';
+	if (spec->width_star) {
+		cur++;
+	}
+	else {
+		while (*cur >= '0' && *cur <= '9') {
+			cur++;
+		}
+	}
+
+	spec->has_precision = *cur == '.';
+	spec->precision_star = false;
+	spec->precision = 0u;
+	if (spec->has_precision) {
+		cur++;
+		spec->precision_star = *cur == '*';
+		if (spec->precision_star) {
+			cur++;
+		}
+		else {
+			while (*cur >= '0' && *cur <= '9') {
+				spec->precision = spec->precision * 10u + (size_t)(*cur - '0');
+				cur++;
+			}
+		}
+	}
+
+	spec->length_start = cur;
+	switch (*cur) {
+	case 'h':
+		cur++;
+		if (*cur == 'h') {
+			spec->length = LENGTH_HH;
+			cur++;
+		}
+		else {
+			spec->length = LENGTH_H;
+		}
+		break;
+
+	case 'l':
+		cur++;
+		if (*cur == 'l') {
+			spec->length = LENGTH_LL;
+			cur++;
+		}
+		else {
+			spec->length = LENGTH_L;
+		}
+		break;
+
+	case 'j': spec->length = LENGTH_J; cur++; break;
+	case 'z': spec->length = LENGTH_Z; cur++; break;
+	case 't': spec->length = LENGTH_T; cur++; break;
+	case 'L': spec->length = LENGTH_BIG_L; cur++; break;
+	default: spec->length = LENGTH_NONE; break;
+	}
+
+	spec->conversion = *cur;
+	spec->end = *cur != '\0' ? cur + 1 : cur;
+	return spec->end;
+}
+
+static bool spec_is_signed(const char conversion) {
+	return conversion == 'd' || conversion == 'i';
+}
+
+static bool spec_is_unsigned(const char conversion) {
+	return conversion == 'u' || conversion == 'o' || conversion == 'x' || conversion == 'X';
+}
+
+static bool spec_is_double(const char conversion) {
+	return strchr("fFeEgGaA", conversion) != NULL;
+}
+
+static void SDLCALL ring_orphan(void* const data) {
+	log_ring* const ring = data;
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->orphaned, 1);
+}
+
+static log_ring* ring_get() {
+	log_ring* ring = SDL_TLSGet(ring_tls);
+	if (ring != NULL) {
+		return ring;
+	}
+
+	ring = mem_malloc(sizeof(log_ring));
+	if (ring == NULL) {
+		return NULL;
+	}
+	SDL_AtomicSet(&ring->head, 0);
+	SDL_AtomicSet(&ring->tail, 0);
+	SDL_AtomicSet(&ring->dropped, 0);
+	SDL_AtomicSet(&ring->orphaned, 0);
+	const char* const thread_name = prog_this_thread_name_get();
+	ring->thread_name = thread_name != NULL ? alloc_sprintf("%s", thread_name) : NULL;
+
+	if (SDL_TLSSet(ring_tls, ring, ring_orphan) < 0) {
+		if (ring->thread_name != NULL) {
+			mem_free(ring->thread_name);
+		}
+		mem_free(ring);
+		return NULL;
+	}
+
+	SDL_AtomicLock(&rings_lock);
+	ring->next = rings;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSetPtr((void**)&rings, ring);
+	SDL_AtomicUnlock(&rings_lock);
+
+	return ring;
+}
+
+/*
+ * Capture the arguments of the format into the record, returning the size of
+ * the record, before padding.
+ */
+static uint32_t record_capture(unsigned char* const record, const char* const format, va_list args) {
+	arg_value values[MAX_ARGS];
+	unsigned char strings[MAX_RECORD_SIZE];
+	size_t num_values = 0u;
+	size_t strings_length = 0u;
+
+	for (const char* cur = strchr(format, '%'); cur != NULL && num_values + 3u <= MAX_ARGS; cur = strchr(cur, '%')) {
+		spec_type spec;
+		cur = spec_parse(cur, &spec);
+		if (spec.conversion == '%') {
+			continue;
+		}
+
+		if (spec.width_star) {
+			values[num_values++].i = va_arg(args, int);
+		}
+		if (spec.precision_star) {
+			const int precision = va_arg(args, int);
+			values[num_values++].i = precision;
+			spec.has_precision = precision >= 0;
+			spec.precision = (size_t)precision;
+		}
+
+		arg_value* const value = &values[num_values++];
+		if (spec_is_signed(spec.conversion)) {
+			switch (spec.length) {
+			case LENGTH_HH: value->i = (signed char)va_arg(args, int); break;
+			case LENGTH_H: value->i = (short)va_arg(args, int); break;
+			case LENGTH_L: value->i = va_arg(args, long); break;
+			case LENGTH_LL: value->i = va_arg(args, long long); break;
+			case LENGTH_J: value->i = (long long)va_arg(args, intmax_t); break;
+			case LENGTH_Z: value->i = (long long)va_arg(args, size_t); break;
+			case LENGTH_T: value->i = (long long)va_arg(args, ptrdiff_t); break;
+			default: value->i = va_arg(args, int); break;
+			}
+		}
+		else if (spec_is_unsigned(spec.conversion)) {
+			switch (spec.length) {
+			case LENGTH_HH: value->u = (unsigned char)va_arg(args, unsigned); break;
+			case LENGTH_H: value->u = (unsigned short)va_arg(args, unsigned); break;
+			case LENGTH_L: value->u = va_arg(args, unsigned long); break;
+			case LENGTH_LL: value->u = va_arg(args, unsigned long long); break;
+			case LENGTH_J: value->u = (unsigned long long)va_arg(args, uintmax_t); break;
+			case LENGTH_Z: value->u = va_arg(args, size_t); break;
+			case LENGTH_T: value->u = (unsigned long long)va_arg(args, ptrdiff_t); break;
+			default: value->u = va_arg(args, unsigned); break;
+			}
+		}
+		else if (spec_is_double(spec.conversion)) {
+			value->d = spec.length == LENGTH_BIG_L ? (double)va_arg(args, long double) : va_arg(args, double);
+		}
+		else if (spec.conversion == 'c') {
+			value->i = va_arg(args, int);
+		}
+		else if (spec.conversion == 'p' || spec.conversion == 'n') {
+			value->p = va_arg(args, void*);
+		}
+		else if (spec.conversion == 's' && spec.length == LENGTH_NONE) {
+			const char* const string = va_arg(args, const char*);
+			const size_t max_strings_length = MAX_RECORD_SIZE - sizeof(record_header) - MAX_ARGS * sizeof(arg_value);
+			if (strings_length >= max_strings_length) {
+				// No room left, so point at the previous string's terminator,
+				// an empty string.
+				value->u = strings_length - 1u;
+				continue;
+			}
+			const size_t available = max_strings_length - strings_length - 1u;
+			const size_t limit = spec.has_precision && spec.precision < available ? spec.precision : available;
+			size_t length = 0u;
+			while (length < limit && string[length] != '\0') {
+				length++;
+			}
+			value->u = strings_length;
+			memcpy(strings + strings_length, string, length);
+			strings_length += length;
+			strings[strings_length++] = '\0';
+		}
+		else {
+			// Unsupported conversion; the writer outputs the rest of the
+			// format verbatim.
+			num_values--;
+			break;
+		}
+	}
+
+	const record_header header = {
+		.size = 0u,
+		.num_args = (uint32_t)num_values,
+		.time = nanotime_now(),
+		.format = format
+	};
+	memcpy(record, &header, sizeof(header));
+	memcpy(record + sizeof(header), values, num_values * sizeof(arg_value));
+	memcpy(record + sizeof(header) + num_values * sizeof(arg_value), strings, strings_length);
+	return (uint32_t)(sizeof(header) + num_values * sizeof(arg_value) + strings_length);
+}
+
+static void ring_write(log_ring* const ring, const unsigned char* const record, const uint32_t size) {
+	unsigned char* const bytes = (unsigned char*)ring->words;
+	const uint32_t tail = (uint32_t)SDL_AtomicGet(&ring->tail);
+	const uint32_t head = (uint32_t)SDL_AtomicGet(&ring->head);
+	SDL_MemoryBarrierAcquire();
+
+	const uint32_t offset = tail & (RING_SIZE - 1u);
+	const uint32_t contiguous = RING_SIZE - offset;
+	const uint32_t padding = contiguous < size ? contiguous : 0u;
+	const uint32_t used = tail - head;
+	if (RING_SIZE - used < padding + size) {
+		SDL_AtomicIncRef(&ring->dropped);
+		return;
+	}
+
+	if (padding >= sizeof(record_header)) {
+		const record_header header = {
+			.size = padding,
+			.num_args = 0u,
+			.time = 0u,
+			.format = NULL
+		};
+		memcpy(bytes + offset, &header, sizeof(header));
+	}
+	memcpy(bytes + ((tail + padding) & (RING_SIZE - 1u)), record, size);
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->tail, (int)(tail + padding + size));
+
+	if (used + padding + size > RING_SIZE / 2u && SDL_AtomicCAS(&wake_pending, 0, 1)) {
+		SDL_SemPost(wake_sem);
+	}
+}
+
+void log_deferred_printf(const char* const format, ...) {
+	assert(format != NULL);
+
+	va_list args;
+	va_start(args, format);
+	if (!SDL_AtomicGet(&inited_flag)) {
+		log_vprintf(format, args);
+		va_end(args);
+		return;
+	}
+	SDL_MemoryBarrierAcquire();
+
+	log_ring* const ring = ring_get();
+	if (ring == NULL) {
+		log_vprintf(format, args);
+		va_end(args);
+		return;
+	}
+
+	uint64_t record_words[MAX_RECORD_SIZE / sizeof(uint64_t)];
+	unsigned char* const record = (unsigned char*)record_words;
+	const uint32_t length = record_capture(record, format, args);
+	va_end(args);
+
+	const uint32_t size = (length + RECORD_ALIGN - 1u) & ~(uint32_t)(RECORD_ALIGN - 1u);
+	memcpy(record, &size, sizeof(size));
+	ring_write(ring, record, size);
+}
+
+static bool output_flush() {
+	if (output_length == 0u) {
+		return true;
+	}
+
+	bool wrote;
+	if (output_to_stdout) {
+		wrote = fwrite(output_buffer, 1u, output_length, stdout) == output_length && fflush(stdout) != EOF;
+	}
+	else {
+		wrote = SDL_RWwrite(output_file, output_buffer, output_length, 1u) == 1u;
+	}
+	output_length = 0u;
+	return wrote;
+}
+
+static void output_append(const char* const text, const size_t length) {
+	if (output_length + length > OUTPUT_BUFFER_SIZE) {
+		output_flush();
+	}
+	const size_t fitting = length < OUTPUT_BUFFER_SIZE ? length : OUTPUT_BUFFER_SIZE;
+	memcpy(output_buffer + output_length, text, fitting);
+	output_length += fitting;
+}
+
+/*
+ * Format into the output buffer, flushing it first if the formatted text
+ * doesn't fit; text longer than the whole buffer is truncated.
+ */
+static void output_printf(const char* const format, ...) {
+	for (int attempt = 0; attempt < 2; attempt++) {
+		va_list args;
+		va_start(args, format);
+		const int length = vsnprintf(output_buffer + output_length, OUTPUT_BUFFER_SIZE - output_length, format, args);
+		va_end(args);
+		if (length < 0) {
+			return;
+		}
+		else if ((size_t)length < OUTPUT_BUFFER_SIZE - output_length || output_length == 0u) {
+			const size_t written = (size_t)length < OUTPUT_BUFFER_SIZE - output_length ? (size_t)length : OUTPUT_BUFFER_SIZE - output_length - 1u;
+			output_length += written;
+			return;
+		}
+		output_flush();
+	}
+}
+
+/*
+ * Format a single argument with the spec. Integer conversions always use the
+ * long long length, as the captured values already have their proper width.
+ */
+static void spec_output(const spec_type* const spec, const arg_value* const values, size_t* const index, const char* const strings) {
+	char format[MAX_SPEC_LENGTH];
+	const size_t prefix_length = (size_t)(spec->length_start - spec->start);
+	if (prefix_length + 4u > sizeof(format)) {
+		output_append(spec->start, (size_t)(spec->end - spec->start));
+		return;
+	}
+	memcpy(format, spec->start, prefix_length);
+	size_t length = prefix_length;
+	if (spec_is_signed(spec->conversion) || spec_is_unsigned(spec->conversion)) {
+		format[length++] = 'l';
+		format[length++] = 'l';
+	}
+	format[length++] = spec->conversion;
+	format[length] = '\0';
+
+	int stars[2];
+	int num_stars = 0;
+	if (spec->width_star) {
+		stars[num_stars++] = (int)values[(*index)++].i;
+	}
+	if (spec->precision_star) {
+		stars[num_stars++] = (int)values[(*index)++].i;
+	}
+	const arg_value value = values[(*index)++];
+
+	#define SPEC_OUTPUT(arg) \
+	do { \
+		switch (num_stars) { \
+		case 0: output_printf(format, (arg)); break; \
+		case 1: output_printf(format, stars[0], (arg)); break; \
+		default: output_printf(format, stars[0], stars[1], (arg)); break; \
+		} \
+	} while (false)
+
+	if (spec_is_signed(spec->conversion)) {
+		SPEC_OUTPUT(value.i);
+	}
+	else if (spec_is_unsigned(spec->conversion)) {
+		SPEC_OUTPUT(value.u);
+	}
+	else if (spec_is_double(spec->conversion)) {
+		SPEC_OUTPUT(value.d);
+	}
+	else if (spec->conversion == 'c') {
+		SPEC_OUTPUT((int)value.i);
+	}
+	else if (spec->conversion == 'p') {
+		SPEC_OUTPUT(value.p);
+	}
+	else if (spec->conversion == 's') {
+		SPEC_OUTPUT(strings + value.u);
+	}
+
+	#undef SPEC_OUTPUT
+}
+
+static void record_output(const log_ring* const ring, const record_header* const header, const unsigned char* const record) {
+	arg_value values[MAX_ARGS];
+	memcpy(values, record + sizeof(record_header), header->num_args * sizeof(arg_value));
+	const char* const strings = (const char*)record + sizeof(record_header) + header->num_args * sizeof(arg_value);
+
+	const double seconds = (double)nanotime_interval(start_time, header->time, nanotime_now_max()) / NANOTIME_NSEC_PER_SEC;
+	if (ring->thread_name != NULL) {
+		output_printf("[%s thread] [%.6f] ", ring->thread_name, seconds);
+	}
+	else {
+		output_printf("[%.6f] ", seconds);
+	}
+
+	const char* cur = header->format;
+	size_t index = 0u;
+	while (*cur != '\0') {
+		const char* const percent = strchr(cur, '%');
+		if (percent == NULL) {
+			output_append(cur, strlen(cur));
+			break;
+		}
+		output_append(cur, (size_t)(percent - cur));
+
+		spec_type spec;
+		const char* const next = spec_parse(percent, &spec);
+		const size_t needed = (size_t)spec.width_star + (size_t)spec.precision_star + 1u;
+		if (spec.conversion == '%') {
+			output_append("%", 1u);
+		}
+		else if (spec.conversion == 'n') {
+			index++;
+		}
+		else if (index + needed <= header->num_args && (spec.conversion != 's' || spec.length == LENGTH_NONE)) {
+			spec_output(&spec, values, &index, strings);
+		}
+		else {
+			output_append(percent, strlen(percent));
+			break;
+		}
+		cur = next;
+	}
+}
+
+/*
+ * Format and output all records in the ring, returning whether there were any.
+ */
+static bool ring_drain(log_ring* const ring) {
+	const unsigned char* const bytes = (const unsigned char*)ring->words;
+	uint32_t head = (uint32_t)SDL_AtomicGet(&ring->head);
+	const uint32_t tail = (uint32_t)SDL_AtomicGet(&ring->tail);
+	SDL_MemoryBarrierAcquire();
+
+	const bool any = head != tail;
+	while (head != tail) {
+		const uint32_t offset = head & (RING_SIZE - 1u);
+		if (RING_SIZE - offset < sizeof(record_header)) {
+			head += RING_SIZE - offset;
+			continue;
+		}
+
+		record_header header;
+		memcpy(&header, bytes + offset, sizeof(header));
+		if (header.format != NULL) {
+			record_output(ring, &header, bytes + offset);
+		}
+		head += header.size;
+	}
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&ring->head, (int)head);
+
+	const int dropped = SDL_AtomicSet(&ring->dropped, 0);
+	if (dropped > 0) {
+		output_printf("[%s thread] %d deferred log records dropped\n", ring->thread_name != NULL ? ring->thread_name : "unnamed", dropped);
+	}
+
+	return any;
+}
+
+static void ring_free(log_ring* const ring) {
+	if (ring->thread_name != NULL) {
+		mem_free(ring->thread_name);
+	}
+	mem_free(ring);
+}
+
+/*
+ * Drain all rings, freeing rings whose threads have exited. Returns whether
+ * there were any records.
+ */
+static bool rings_drain() {
+	bool any = false;
+	log_ring* ring = SDL_AtomicGetPtr((void**)&rings);
+	SDL_MemoryBarrierAcquire();
+	while (ring != NULL) {
+		const bool orphaned = SDL_AtomicGet(&ring->orphaned);
+		SDL_MemoryBarrierAcquire();
+		any = ring_drain(ring) || any;
+
+		log_ring* const next = ring->next;
+		if (orphaned) {
+			SDL_AtomicLock(&rings_lock);
+			for (log_ring** link = &rings; *link != NULL; link = &(*link)->next) {
+				if (*link == ring) {
+					*link = ring->next;
+					break;
+				}
+			}
+			SDL_AtomicUnlock(&rings_lock);
+			ring_free(ring);
+		}
+		ring = next;
+	}
+
+	return any;
+}
+
+static int SDLCALL writer_func(void* const data) {
+	(void)data;
+
+	mem_tag_set(MEM_TAG_LOG);
+
+	prog_this_thread_name_set("log writer");
+	threads_current_set(THREADS_CLASS_BACKGROUND);
+
+	while (true) {
+		const bool quitting = SDL_AtomicGet(&quit);
+		SDL_MemoryBarrierAcquire();
+
+		const bool any = rings_drain();
+		if (!output_flush()) {
+			log_printf("Error writing deferred log output\n");
+		}
+		if (quitting) {
+			break;
+		}
+		else if (!any) {
+			SDL_SemWaitTimeout(wake_sem, WRITER_PERIOD_MS);
+		}
+		SDL_AtomicSet(&wake_pending, 0);
+	}
+
+	prog_this_thread_name_set(NULL);
+	return 0;
+}
+
+bool log_deferred_init(const char* const output) {
+	assert(main_thread_is_this_thread());
+	assert(output != NULL);
+	assert(!SDL_AtomicGet(&inited_flag));
+
+	output_to_stdout = !strcmp(output, "stdout");
+	if (!output_to_stdout) {
+		char* const full_filename = alloc_sprintf("%s%s", prog_save_path_get(), output);
+		if (full_filename == NULL) {
+			return false;
+		}
+		output_file = SDL_RWFromFile(full_filename, "wb");
+		mem_free(full_filename);
+		if (output_file == NULL) {
+			log_printf("Error opening the deferred log output file: %s\n", SDL_GetError());
+			return false;
+		}
+	}
+
+	output_buffer = mem_malloc(OUTPUT_BUFFER_SIZE);
+	ring_tls = ring_tls != 0 ? ring_tls : SDL_TLSCreate();
+	wake_sem = SDL_CreateSemaphore(0u);
+	if (output_buffer == NULL || ring_tls == 0 || wake_sem == NULL) {
+		log_printf("Error initializing deferred logging\n");
+		log_deferred_deinit();
+		return false;
+	}
+	output_length = 0u;
+	start_time = nanotime_now();
+	SDL_AtomicSet(&quit, 0);
+	SDL_AtomicSet(&wake_pending, 0);
+
+	writer_thread = SDL_CreateThread(writer_func, "log_writer_thread", NULL);
+	if (writer_thread == NULL) {
+		log_printf("Error creating the log writer thread: %s\n", SDL_GetError());
+		log_deferred_deinit();
+		return false;
+	}
+
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&inited_flag, 1);
+	return true;
+}
+
+bool log_deferred_deinit() {
+	assert(main_thread_is_this_thread());
+
+	SDL_AtomicSet(&inited_flag, 0);
+	SDL_MemoryBarrierRelease();
+
+	bool success = true;
+	if (writer_thread != NULL) {
+		SDL_AtomicSet(&quit, 1);
+		SDL_SemPost(wake_sem);
+		SDL_WaitThread(writer_thread, NULL);
+		writer_thread = NULL;
+	}
+
+	while (rings != NULL) {
+		log_ring* const next = rings->next;
+		ring_free(rings);
+		rings = next;
+	}
+	if (ring_tls != 0) {
+		SDL_TLSSet(ring_tls, NULL, NULL);
+	}
+
+	if (wake_sem != NULL) {
+		SDL_DestroySemaphore(wake_sem);
+		wake_sem = NULL;
+	}
+	if (output_buffer != NULL) {
+		mem_free(output_buffer);
+		output_buffer = NULL;
+	}
+	if (output_file != NULL) {
+		success = SDL_RWclose(output_file) == 0;
+		output_file = NULL;
+	}
+
+	return success;
+}
@@ -38,6 +38,9 @@
  * might be out of order with respect to the real time the threads have
  * submitted logging operations, but at the very least each log operation will
  * fully complete before the next; log operations won't interrupt each other.
+ * All output is written by a writer thread of its own, in large batches, so
+ * threads logging never wait on the output, unless the queue is full under
+ * the LOG_OVERFLOW_BLOCK policy.
  *
  * Returns true if initializing was successful, otherwise false in the case of
  * errors.
@@ -46,38 +49,39 @@ bool log_init(const char* const all_output);
 
 /*
  * When a filename/stdout is set for all log output, this completes all pending
- * log operations and deinitializes such support.
+ * log operations, stopping the writer thread, and deinitializes such support.
+ * Must be called in the main thread, once no other threads are logging.
  *
- * Returns true if deinitializing was successful, otherwise false in the case of
- * errors.
+ * Returns true if deinitializing was successful and all output was written,
+ * otherwise false in the case of errors.
  */
 bool log_all_output_deinit();
 
-#define LOG_ALL_OUTPUT_DEQUEUE_EMPTY UINT64_MAX
-
 /*
- * This dequeues and outputs to the all_output filename/stdout all pending log
- * operations. If the amount of time spent dequeueing/outputting goes past the
- * allotted_time, this function immediately returns, possible leaving some log
- * operations still in the queue; it's the responsibility of the user of the
- * logging API to ensure continual dequeues with enough throughput to keep up
- * with submitted log operations, not allowing the queue to grow out of control.
+ * Set the log filename used for the current thread.
  *
- * However, if it's desired to completely empty the queue,
- * LOG_ALL_OUTPUT_DEQUEUE_EMPTY can be passed as a parameter.
- * LOG_ALL_OUTPUT_DEQUEUE_EMPTY should *only* be used when it's guaranteed no
- * other threads are enqueueing log operations, as it's a race condition if
- * other threads are enqueueing at the same time this function is called.
+ * Returns true if setting was successful, otherwise false in the case of
+ * errors.
+ */
+bool log_filename_set(const char* const filename);
+
+/*
+ * Initialize deferred logging, starting the log writer thread that formats and
+ * writes log_deferred_printf records. Must be called in the main thread, after
+ * log_init. The records are written to the named file in the save path, or to
+ * stdout if output is the exact string "stdout".
  *
- * Returns true if dequeueing was successful, otherwise false in the case of
+ * Returns true if initializing was successful, otherwise false in the case of
  * errors.
  */
-bool log_all_output_dequeue(const uint64_t allotted_time);
+bool log_deferred_init(const char* const output);
 
 /*
- * Set the log filename used for the current thread.
+ * Write all pending log_deferred_printf records, then stop the log writer
+ * thread. Must be called in the main thread, once no other threads are using
+ * deferred logging.
  *
- * Returns true if setting was successful, otherwise false in the case of
+ * Returns true if deinitializing was successful, otherwise false in the case of
  * errors.
  */
-bool log_filename_set(const char* const filename);
+bool log_deferred_deinit();
@@ -0,0 +1,224 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/lz4.h"
+#include <stdint.h>
+#include <string.h>
+
+#define MIN_MATCH 4u
+#define MAX_OFFSET 65535u
+
+/*
+ * The format requires the last MATCH_END_MARGIN bytes to be literals, and the
+ * last match to start at least MATCH_START_MARGIN bytes before the end.
+ */
+#define MATCH_END_MARGIN 5u
+#define MATCH_START_MARGIN 12u
+
+#define HASH_BITS 12u
+#define HASH_SIZE ((size_t)1u << HASH_BITS)
+
+static uint32_t read_u32(const uint8_t* const bytes) {
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+	return value;
+}
+
+static size_t hash(const uint32_t sequence) {
+	return (size_t)((sequence * UINT32_C(2654435761)) >> (32u - HASH_BITS));
+}
+
+size_t lz4_compress_bound(const size_t size) {
+	return size + size / 255u + 16u;
+}
+
+/*
+ * Write the length's extension bytes, for lengths of at least 15.
+ */
+static size_t length_write(uint8_t* const out, size_t length) {
+	size_t written = 0u;
+	length -= 15u;
+	while (length >= 255u) {
+		out[written++] = 255u;
+		length -= 255u;
+	}
+	out[written++] = (uint8_t)length;
+	return written;
+}
+
+/*
+ * Write a sequence of literals, followed by a match unless match_length is
+ * zero, for the final sequence. Returns false if there's no room for it.
+ */
+static bool sequence_write(uint8_t* const out, size_t* const out_size, const size_t capacity, const uint8_t* const literals, const size_t num_literals, const size_t offset, const size_t match_length) {
+	const size_t needed = 1u + num_literals / 255u + 1u + num_literals + (match_length > 0u ? 2u + match_length / 255u + 1u : 0u);
+	if (needed > capacity - *out_size) {
+		return false;
+	}
+
+	size_t pos = *out_size;
+	uint8_t* const token = &out[pos++];
+	*token = (uint8_t)((num_literals < 15u ? num_literals : 15u) << 4);
+	if (num_literals >= 15u) {
+		pos += length_write(&out[pos], num_literals);
+	}
+	memcpy(&out[pos], literals, num_literals);
+	pos += num_literals;
+
+	if (match_length > 0u) {
+		out[pos++] = (uint8_t)(offset & 0xFFu);
+		out[pos++] = (uint8_t)(offset >> 8);
+		const size_t length = match_length - MIN_MATCH;
+		*token |= (uint8_t)(length < 15u ? length : 15u);
+		if (length >= 15u) {
+			pos += length_write(&out[pos], length);
+		}
+	}
+
+	*out_size = pos;
+	return true;
+}
+
+size_t lz4_compress(const void* const src, const size_t size, void* const dst, const size_t capacity) {
+	const uint8_t* const in = src;
+	uint8_t* const out = dst;
+	size_t out_size = 0u;
+	size_t anchor = 0u;
+
+	if (size > MATCH_START_MARGIN) {
+		/*
+		 * Positions are stored plus one, so zero is an empty entry.
+		 */
+		uint32_t table[HASH_SIZE];
+		memset(table, 0, sizeof(table));
+
+		const size_t match_start_limit = size - MATCH_START_MARGIN;
+		const size_t match_end_limit = size - MATCH_END_MARGIN;
+		size_t pos = 0u;
+		while (pos < match_start_limit) {
+			const uint32_t sequence = read_u32(&in[pos]);
+			const size_t h = hash(sequence);
+			const size_t candidate = table[h];
+			table[h] = (uint32_t)(pos + 1u);
+			if (candidate == 0u || pos - (candidate - 1u) > MAX_OFFSET || read_u32(&in[candidate - 1u]) != sequence) {
+				pos++;
+				continue;
+			}
+
+			const size_t match = candidate - 1u;
+			size_t length = MIN_MATCH;
+			while (pos + length < match_end_limit && in[match + length] == in[pos + length]) {
+				length++;
+			}
+
+			if (!sequence_write(out, &out_size, capacity, &in[anchor], pos - anchor, pos - match, length)) {
+				return 0u;
+			}
+			pos += length;
+			anchor = pos;
+		}
+	}
+
+	if (!sequence_write(out, &out_size, capacity, &in[anchor], size - anchor, 0u, 0u)) {
+		return 0u;
+	}
+	return out_size;
+}
+
+/*
+ * Read a length's extension bytes. Returns false if the block ends first.
+ */
+static bool length_read(const uint8_t* const in, const size_t in_size, size_t* const pos, size_t* const length) {
+	uint8_t byte;
+	do {
+		if (*pos >= in_size) {
+			return false;
+		}
+		byte = in[(*pos)++];
+		*length += byte;
+	} while (byte == 255u);
+	return true;
+}
+
+bool lz4_decompress(const void* const src, const size_t src_size, void* const dst, const size_t dst_size) {
+	const uint8_t* const in = src;
+	uint8_t* const out = dst;
+	size_t in_pos = 0u;
+	size_t out_pos = 0u;
+
+	while (in_pos < src_size) {
+		const uint8_t token = in[in_pos++];
+
+		size_t num_literals = token >> 4;
+		if (num_literals == 15u && !length_read(in, src_size, &in_pos, &num_literals)) {
+			return false;
+		}
+		if (num_literals > src_size - in_pos || num_literals > dst_size - out_pos) {
+			return false;
+		}
+		memcpy(&out[out_pos], &in[in_pos], num_literals);
+		in_pos += num_literals;
+		out_pos += num_literals;
+
+		// The final sequence is only literals.
+		if (in_pos == src_size) {
+			break;
+		}
+
+		if (src_size - in_pos < 2u) {
+			return false;
+		}
+		const size_t offset = (size_t)in[in_pos] | ((size_t)in[in_pos + 1u] << 8);
+		in_pos += 2u;
+		if (offset == 0u || offset > out_pos) {
+			return false;
+		}
+
+		size_t length = token & 0xFu;
+		if (length == 15u && !length_read(in, src_size, &in_pos, &length)) {
+			return false;
+		}
+		length += MIN_MATCH;
+		if (length > dst_size - out_pos) {
+			return false;
+		}
+
+		/*
+		 * Matches can overlap what they're copying, repeating it, so they're
+		 * copied bytewise unless they don't overlap.
+		 */
+		const uint8_t* const match = &out[out_pos - offset];
+		if (offset >= length) {
+			memcpy(&out[out_pos], match, length);
+		}
+		else {
+			for (size_t i = 0u; i < length; i++) {
+				out[out_pos + i] = match[i];
+			}
+		}
+		out_pos += length;
+	}
+
+	return out_pos == dst_size;
+}
@@ -23,6 +23,9 @@
  */
 
 #include "util/maths.h"
+#include "util/private/maths_private.h"
+#include "util/private/simd.h"
+#include <assert.h>
 
 void vec3_copy(vec3 dst, const vec3 src) {
 	for (unsigned i = 0u; i < 3u; i++) {
@@ -64,7 +67,7 @@ void vec4_copy(vec4 dst, const vec4 src) {
 	}
 }
 
-float vec4_dot(const vec4 lhs, const vec4 rhs) {
+float vec4_dot_scalar(const vec4 lhs, const vec4 rhs) {
 	float dot = 0.0f;
 	for (unsigned comp = 0u; comp < 4u; comp++) {
 		dot += lhs[comp] * rhs[comp];
@@ -72,6 +75,14 @@ float vec4_dot(const vec4 lhs, const vec4 rhs) {
 	return dot;
 }
 
+float vec4_dot(const vec4 lhs, const vec4 rhs) {
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	return simd_sum(simd_mul(simd_load(lhs), simd_load(rhs)));
+#else
+	return vec4_dot_scalar(lhs, rhs);
+#endif
+}
+
 void mat4_identity(mat4 dst) {
 	for (unsigned i = 0u; i < 16u; i++) {
 		dst[i] = (i & 3u) == (i >> 2) ? 1.0f : 0.0f;
@@ -84,7 +95,7 @@ void mat4_copy(mat4 dst, const mat4 src) {
 	}
 }
 
-void mat4_multiply(mat4 dst, const mat4 lhs, const mat4 rhs) {
+void mat4_multiply_scalar(mat4 dst, const mat4 lhs, const mat4 rhs) {
 	vec4 lhs_row = { 0 };
 	for (unsigned row = 0u; row < 4u; row++) {
 		lhs_row[0] = lhs[row + 4u * 0u];
@@ -93,11 +104,40 @@ void mat4_multiply(mat4 dst, const mat4 lhs, const mat4 rhs) {
 		lhs_row[3] = lhs[row + 4u * 3u];
 
 		for (unsigned col = 0u; col < 16u; col += 4u) {
-			dst[col + row] = vec4_dot(lhs_row, &rhs[col]);
+			dst[col + row] = vec4_dot_scalar(lhs_row, &rhs[col]);
 		}
 	}
 }
 
+void mat4_multiply(mat4 dst, const mat4 lhs, const mat4 rhs) {
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	/*
+	 * Each column of the product is the lhs columns weighted by the rhs
+	 * column's components. All columns are computed before storing, so dst
+	 * can be either operand.
+	 */
+	const simd_float4 lhs_cols[4] = {
+		simd_load(&lhs[0]),
+		simd_load(&lhs[4]),
+		simd_load(&lhs[8]),
+		simd_load(&lhs[12])
+	};
+	simd_float4 dst_cols[4];
+	for (unsigned col = 0u; col < 4u; col++) {
+		const float* const rhs_col = &rhs[col * 4u];
+		simd_float4 dst_col = simd_mul(lhs_cols[0], simd_splat(rhs_col[0]));
+		dst_col = simd_madd(lhs_cols[1], simd_splat(rhs_col[1]), dst_col);
+		dst_col = simd_madd(lhs_cols[2], simd_splat(rhs_col[2]), dst_col);
+		dst_cols[col] = simd_madd(lhs_cols[3], simd_splat(rhs_col[3]), dst_col);
+	}
+	for (unsigned col = 0u; col < 4u; col++) {
+		simd_store(&dst[col * 4u], dst_cols[col]);
+	}
+#else
+	mat4_multiply_scalar(dst, lhs, rhs);
+#endif
+}
+
 void mat4_ortho(mat4 dst, const float left, const float right, const float bottom, const float top, const float near, const float far) {
 	const float right_minus_left = 1.0f / (right - left);
 	const float top_minus_bottom = 1.0f / (top - bottom);
@@ -200,11 +240,43 @@ void mat4_lookat(mat4 dst, const vec3 eye, const vec3 center, const vec3 up) {
 	mat4_translate(dst, eye);
 }
 
+/*
+ * Rotate the xyz components of each column of dst by the row-major rotation.
+ */
+static void rotate_apply(mat4 dst, const mat3 rotate) {
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	const simd_float4 rotate_cols[3] = {
+		simd_set(rotate[0], rotate[3], rotate[6], 0.0f),
+		simd_set(rotate[1], rotate[4], rotate[7], 0.0f),
+		simd_set(rotate[2], rotate[5], rotate[8], 0.0f)
+	};
+	const simd_float4 w_only = simd_set(0.0f, 0.0f, 0.0f, 1.0f);
+	for (unsigned col = 0u; col < 16u; col += 4u) {
+		simd_float4 dst_col = simd_mul(w_only, simd_splat(dst[col + 3u]));
+		dst_col = simd_madd(rotate_cols[0], simd_splat(dst[col + 0u]), dst_col);
+		dst_col = simd_madd(rotate_cols[1], simd_splat(dst[col + 1u]), dst_col);
+		dst_col = simd_madd(rotate_cols[2], simd_splat(dst[col + 2u]), dst_col);
+		simd_store(&dst[col], dst_col);
+	}
+#else
+	vec3 dst_col = { 0 };
+	for (unsigned col = 0u; col < 16u; col += 4u) {
+		dst_col[0] = dst[col + 0u];
+		dst_col[1] = dst[col + 1u];
+		dst_col[2] = dst[col + 2u];
+
+		for (unsigned row = 0u; row < 3u; row++) {
+			dst[col + row] = vec3_dot(dst_col, &rotate[row * 3u]);
+		}
+	}
+#endif
+}
+
 void mat4_rotate(mat4 dst, const float angle, const vec3 axis) {
 	const float angle_radians = MATHS_TO_RADIANS(angle);
 	const float cosine_pos = cosf(angle_radians);
 	const float cosine_neg = 1.0f - cosine_pos;
-	const float sine_pos = cosf(angle_radians);
+	const float sine_pos = sinf(angle_radians);
 	const mat3 rotate = {
 		axis[0] * axis[0] * cosine_neg + cosine_pos,
 		axis[0] * axis[1] * cosine_neg - axis[2] * sine_pos,
@@ -218,18 +290,7 @@ void mat4_rotate(mat4 dst, const float angle, const vec3 axis) {
 		axis[1] * axis[2] * cosine_neg + axis[0] * sine_pos,
 		axis[2] * axis[2] * cosine_neg + cosine_pos
 	};
-	unsigned col, row;
-	vec3 dst_col = { 0 };
-
-	for (col = 0u; col < 16u; col += 4u) {
-		dst_col[0] = dst[col + 0u];
-		dst_col[1] = dst[col + 1u];
-		dst_col[2] = dst[col + 2u];
-
-		for (row = 0u; row < 3u; row++ ) {
-			dst[col + row] = vec3_dot(dst_col, &rotate[row * 3u]);
-		}
-	}
+	rotate_apply(dst, rotate);
 }
 
 void mat4_rotatex(mat4 dst, const float angle) {
@@ -249,18 +310,7 @@ void mat4_rotatex(mat4 dst, const float angle) {
 		sine,
 		cosine
 	};
-	unsigned col, row;
-	vec3 dst_col = { 0 };
-
-	for (col = 0u; col < 16u; col += 4u) {
-		dst_col[0] = dst[col + 0u];
-		dst_col[1] = dst[col + 1u];
-		dst_col[2] = dst[col + 2u];
-
-		for (row = 0u; row < 3u; row++ ) {
-			dst[col + row] = vec3_dot(dst_col, &rotate[row * 3u]);
-		}
-	}
+	rotate_apply(dst, rotate);
 }
 
 void mat4_rotatey(mat4 dst, const float angle) {
@@ -280,18 +330,7 @@ void mat4_rotatey(mat4 dst, const float angle) {
 		0.0f,
 		cosine
 	};
-	unsigned col, row;
-	vec3 dst_col = { 0 };
-
-	for (col = 0u; col < 16u; col += 4u) {
-		dst_col[0] = dst[col + 0u];
-		dst_col[1] = dst[col + 1u];
-		dst_col[2] = dst[col + 2u];
-
-		for (row = 0u; row < 3u; row++ ) {
-			dst[col + row] = vec3_dot(dst_col, &rotate[row * 3u]);
-		}
-	}
+	rotate_apply(dst, rotate);
 }
 
 void mat4_rotatez(mat4 dst, const float angle) {
@@ -311,30 +350,32 @@ void mat4_rotatez(mat4 dst, const float angle) {
 		0.0f,
 		1.0f
 	};
-	unsigned col, row;
-	vec3 dst_col = { 0 };
-
-	for (col = 0u; col < 16u; col += 4u) {
-		dst_col[0] = dst[col + 0u];
-		dst_col[1] = dst[col + 1u];
-		dst_col[2] = dst[col + 2u];
-
-		for (row = 0u; row < 3u; row++ ) {
-			dst[col + row] = vec3_dot(dst_col, &rotate[row * 3u]);
-		}
-	}
+	rotate_apply(dst, rotate);
 }
 
 void mat4_scale(mat4 dst, const vec4 scale) {
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	const simd_float4 col_scale = simd_set(scale[0], scale[1], scale[2], 1.0f);
+	for (unsigned col = 0u; col < 16u; col += 4u) {
+		simd_store(&dst[col], simd_mul(simd_load(&dst[col]), col_scale));
+	}
+#else
 	unsigned col, row;
 	for (col = 0u; col < 16u; col += 4u) {
 		for (row = 0u; row < 3u; row++) {
 			dst[col + row] *= scale[row];
 		}
 	}
+#endif
 }
 
 void mat4_translate(mat4 dst, const vec3 translate) {
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	const simd_float4 col_translate = simd_set(translate[0], translate[1], translate[2], 0.0f);
+	for (unsigned col = 0u; col < 16u; col += 4u) {
+		simd_store(&dst[col], simd_madd(col_translate, simd_splat(dst[col + 3u]), simd_load(&dst[col])));
+	}
+#else
 	unsigned col = 0u, row = 0u;
 	float dst_lhs;
 	for (unsigned col = 0u; col < 16u; col += 4u) {
@@ -343,4 +384,154 @@ void mat4_translate(mat4 dst, const vec3 translate) {
 			dst[col + row] += dst_lhs * translate[row];
 		}
 	}
+#endif
+}
+
+void mat4_transform_vec4s_scalar(float* const dst, const mat4 transform, const float* const src, const size_t count) {
+	for (size_t i = 0u; i < count; i++) {
+		const float* const vector = &src[i * 4u];
+		const float x = vector[0], y = vector[1], z = vector[2], w = vector[3];
+		for (unsigned row = 0u; row < 4u; row++) {
+			dst[i * 4u + row] =
+				transform[row + 0u] * x +
+				transform[row + 4u] * y +
+				transform[row + 8u] * z +
+				transform[row + 12u] * w;
+		}
+	}
+}
+
+void mat4_transform_vec4s(float* const dst, const mat4 transform, const float* const src, const size_t count) {
+	assert(count == 0u || (dst != NULL && src != NULL));
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	size_t i = 0u;
+#if defined(SIMD_AVX)
+	/*
+	 * Two vectors at a time, one per 128-bit lane.
+	 */
+	const __m256 cols_x2[4] = {
+		_mm256_broadcast_ps((const __m128*)&transform[0]),
+		_mm256_broadcast_ps((const __m128*)&transform[4]),
+		_mm256_broadcast_ps((const __m128*)&transform[8]),
+		_mm256_broadcast_ps((const __m128*)&transform[12])
+	};
+	for (; i + 2u <= count; i += 2u) {
+		const __m256 vectors = _mm256_loadu_ps(&src[i * 4u]);
+		__m256 transformed = _mm256_mul_ps(cols_x2[0], _mm256_permute_ps(vectors, _MM_SHUFFLE(0, 0, 0, 0)));
+		transformed = _mm256_add_ps(transformed, _mm256_mul_ps(cols_x2[1], _mm256_permute_ps(vectors, _MM_SHUFFLE(1, 1, 1, 1))));
+		transformed = _mm256_add_ps(transformed, _mm256_mul_ps(cols_x2[2], _mm256_permute_ps(vectors, _MM_SHUFFLE(2, 2, 2, 2))));
+		transformed = _mm256_add_ps(transformed, _mm256_mul_ps(cols_x2[3], _mm256_permute_ps(vectors, _MM_SHUFFLE(3, 3, 3, 3))));
+		_mm256_storeu_ps(&dst[i * 4u], transformed);
+	}
+#endif
+	const simd_float4 cols[4] = {
+		simd_load(&transform[0]),
+		simd_load(&transform[4]),
+		simd_load(&transform[8]),
+		simd_load(&transform[12])
+	};
+	for (; i < count; i++) {
+		const float* const vector = &src[i * 4u];
+		simd_float4 transformed = simd_mul(cols[0], simd_splat(vector[0]));
+		transformed = simd_madd(cols[1], simd_splat(vector[1]), transformed);
+		transformed = simd_madd(cols[2], simd_splat(vector[2]), transformed);
+		transformed = simd_madd(cols[3], simd_splat(vector[3]), transformed);
+		simd_store(&dst[i * 4u], transformed);
+	}
+#else
+	mat4_transform_vec4s_scalar(dst, transform, src, count);
+#endif
+}
+
+void mat4_transform_vec2s_scalar(float* const dst, const mat4 transform, const float* const src, const size_t count) {
+	for (size_t i = 0u; i < count; i++) {
+		const float x = src[i * 2u + 0u];
+		const float y = src[i * 2u + 1u];
+		dst[i * 2u + 0u] = transform[0] * x + transform[4] * y + transform[12];
+		dst[i * 2u + 1u] = transform[1] * x + transform[5] * y + transform[13];
+	}
+}
+
+void mat4_transform_vec2s(float* const dst, const mat4 transform, const float* const src, const size_t count) {
+	assert(count == 0u || (dst != NULL && src != NULL));
+
+	size_t i = 0u;
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	/*
+	 * Two points at a time, with the x and y columns of the matrix repeated
+	 * for each point.
+	 */
+	const simd_float4 col_x = simd_set(transform[0], transform[1], transform[0], transform[1]);
+	const simd_float4 col_y = simd_set(transform[4], transform[5], transform[4], transform[5]);
+	const simd_float4 col_w = simd_set(transform[12], transform[13], transform[12], transform[13]);
+	for (; i + 2u <= count; i += 2u) {
+		const simd_float4 points = simd_load(&src[i * 2u]);
+#if defined(SIMD_SSE2)
+		const simd_float4 xs = _mm_shuffle_ps(points, points, _MM_SHUFFLE(2, 2, 0, 0));
+		const simd_float4 ys = _mm_shuffle_ps(points, points, _MM_SHUFFLE(3, 3, 1, 1));
+#else
+		const float32x4x2_t transposed = vtrnq_f32(points, points);
+		const simd_float4 xs = transposed.val[0];
+		const simd_float4 ys = transposed.val[1];
+#endif
+		simd_store(&dst[i * 2u], simd_madd(col_y, ys, simd_madd(col_x, xs, col_w)));
+	}
+#endif
+	mat4_transform_vec2s_scalar(&dst[i * 2u], transform, &src[i * 2u], count - i);
+}
+
+void rects_build_scalar(float* const dst, const size_t dst_stride, const float* const positions, const float* const sizes, const vec2 anchor, const size_t count) {
+	for (size_t i = 0u; i < count; i++) {
+		float* const rect = &dst[i * dst_stride];
+		const float w = sizes[i * 2u + 0u];
+		const float h = sizes[i * 2u + 1u];
+		rect[0] = positions[i * 2u + 0u] - w * anchor[0];
+		rect[1] = positions[i * 2u + 1u] - h * anchor[1];
+		rect[2] = w;
+		rect[3] = h;
+	}
+}
+
+void rects_build(float* const dst, const size_t dst_stride, const float* const positions, const float* const sizes, const vec2 anchor, const size_t count) {
+	assert(count == 0u || (dst != NULL && positions != NULL && sizes != NULL));
+	assert(dst_stride >= 4u);
+
+#if defined(SIMD_SSE2) || defined(SIMD_NEON)
+	/*
+	 * Each rectangle is the position, with zero size, plus the size
+	 * multiplied by the negated anchor for the position, and by one for the
+	 * size. Two rectangles' positions and sizes are loaded at a time.
+	 */
+	const simd_float4 weights = simd_set(-anchor[0], -anchor[1], 1.0f, 1.0f);
+	size_t i = 0u;
+	for (; i + 2u <= count; i += 2u) {
+		const simd_float4 position_pair = simd_load(&positions[i * 2u]);
+		const simd_float4 size_pair = simd_load(&sizes[i * 2u]);
+#if defined(SIMD_SSE2)
+		const simd_float4 origins[2] = {
+			_mm_movelh_ps(position_pair, _mm_setzero_ps()),
+			_mm_movehl_ps(_mm_setzero_ps(), position_pair)
+		};
+		const simd_float4 rect_sizes[2] = {
+			_mm_movelh_ps(size_pair, size_pair),
+			_mm_movehl_ps(size_pair, size_pair)
+		};
+#else
+		const simd_float4 origins[2] = {
+			vcombine_f32(vget_low_f32(position_pair), vdup_n_f32(0.0f)),
+			vcombine_f32(vget_high_f32(position_pair), vdup_n_f32(0.0f))
+		};
+		const simd_float4 rect_sizes[2] = {
+			vcombine_f32(vget_low_f32(size_pair), vget_low_f32(size_pair)),
+			vcombine_f32(vget_high_f32(size_pair), vget_high_f32(size_pair))
+		};
+#endif
+		simd_store(&dst[(i + 0u) * dst_stride], simd_madd(rect_sizes[0], weights, origins[0]));
+		simd_store(&dst[(i + 1u) * dst_stride], simd_madd(rect_sizes[1], weights, origins[1]));
+	}
+	rects_build_scalar(&dst[i * dst_stride], dst_stride, &positions[i * 2u], &sizes[i * 2u], anchor, count - i);
+#else
+	rects_build_scalar(dst, dst_stride, positions, sizes, anchor, count);
+#endif
 }
@@ -0,0 +1,38 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/maths.h"
+
+/*
+ * Scalar reference implementations of the functions with SIMD
+ * implementations, for comparing against the SIMD implementations. The public
+ * functions use these when no SIMD instruction set is available.
+ */
+
+float vec4_dot_scalar(const vec4 lhs, const vec4 rhs);
+void mat4_multiply_scalar(mat4 dst, const mat4 lhs, const mat4 rhs);
+void mat4_transform_vec4s_scalar(float* const dst, const mat4 transform, const float* const src, const size_t count);
+void mat4_transform_vec2s_scalar(float* const dst, const mat4 transform, const float* const src, const size_t count);
+void rects_build_scalar(float* const dst, const size_t dst_stride, const float* const positions, const float* const sizes, const vec2 anchor, const size_t count);
@@ -1,7 +1,10 @@
 #include "util/mem.h"
 #include "util/log.h"
-#include "util/queue.h"
+#include "util/private/mem_private.h"
 #include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include <string.h>
+#include <limits.h>
 
 // TODO: Support more than Linux here?
 #if defined(__linux__)
@@ -92,19 +95,228 @@ size_t mem_left() {
 
 #endif
 
+/*
+ * Each thread's scratch arena is kept in thread-local storage, created by
+ * mem_init.
+ */
+static SDL_TLSID scratch_tls = 0;
+static SDL_atomic_t scratch_high_water;
+
+static bool scratch_init() {
+	scratch_tls = SDL_TLSCreate();
+	SDL_AtomicSet(&scratch_high_water, 0);
+	return scratch_tls != 0;
+}
+
 #ifdef MEM_DEBUG
-static SDL_SpinLock total_alloc_lock;
-static size_t total_alloc = 0u;
+#if defined(_MSC_VER) && !defined(__clang__)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+#define MEM_HISTOGRAM_MIN_SIZE ((size_t)16u)
+
+/*
+ * Each thread counts its allocations in its own counters, so no allocation
+ * takes a lock shared between threads; readers sum the counters of all
+ * threads. Bytes allocated and freed are counted separately, as memory is
+ * often freed by another thread than allocated it, and a thread's difference
+ * between the two doesn't mean anything by itself.
+ *
+ * Only the owning thread writes its counters, bracketing each update by odd
+ * and even sequence numbers, so readers can tell they got a consistent copy.
+ * Counters are created with the C library, not the mem_* functions, and are
+ * reused by later threads once their thread exits, so they're only freed by
+ * mem_deinit. Allocations made by a thread after its counters were released
+ * go into the shared late counters, under a lock.
+ */
+typedef struct mem_counters mem_counters;
+struct mem_counters {
+	mem_counters* next;
+	bool in_use;
+	SDL_atomic_t sequence;
+
+	size_t allocated;
+	size_t freed;
+	size_t allocs;
+	size_t frees;
+	size_t histogram[MEM_HISTOGRAM_BUCKETS];
+	size_t tag_allocs[MEM_TAG_COUNT];
+	size_t tag_bytes[MEM_TAG_COUNT];
+};
+
+static SDL_SpinLock counters_lock;
+static mem_counters* counters_list = NULL;
+static mem_counters late_counters;
+static SDL_SpinLock late_lock;
+static SDL_TLSID counters_tls = 0;
+
+static THREAD_LOCAL mem_counters* this_counters = NULL;
+static THREAD_LOCAL bool this_counters_released = false;
+static THREAD_LOCAL mem_tag_type this_tag = MEM_TAG_NONE;
 
 static void *(SDLCALL *orig_malloc)(size_t size) = NULL;
 static void *(SDLCALL *orig_calloc)(size_t nmemb, size_t size) = NULL;
 static void *(SDLCALL *orig_realloc)(void *mem, size_t size) = NULL;
 static void (SDLCALL *orig_free)(void *mem) = NULL;
 
+static void SDLCALL counters_release(void* const data) {
+	mem_counters* const counters = data;
+	this_counters = NULL;
+	this_counters_released = true;
+	SDL_AtomicLock(&counters_lock);
+	counters->in_use = false;
+	SDL_AtomicUnlock(&counters_lock);
+}
+
+/*
+ * Get the calling thread's counters, or NULL if the thread has to use the
+ * late counters.
+ */
+static mem_counters* counters_get() {
+	if (this_counters != NULL || this_counters_released) {
+		return this_counters;
+	}
+
+	SDL_AtomicLock(&counters_lock);
+	mem_counters* counters = counters_list;
+	while (counters != NULL && counters->in_use) {
+		counters = counters->next;
+	}
+	if (counters == NULL) {
+		counters = calloc(1u, sizeof(mem_counters));
+		if (counters == NULL) {
+			SDL_AtomicUnlock(&counters_lock);
+			return NULL;
+		}
+		counters->next = counters_list;
+		counters_list = counters;
+	}
+	counters->in_use = true;
+	SDL_AtomicUnlock(&counters_lock);
+
+	// Setting the thread-local storage can allocate, which has to find the
+	// counters already set.
+	this_counters = counters;
+	if (counters_tls != 0) {
+		SDL_TLSSet(counters_tls, counters, counters_release);
+	}
+	return counters;
+}
+
+static size_t histogram_bucket(const size_t size) {
+	size_t bucket = 0u;
+	for (size_t bucket_size = MEM_HISTOGRAM_MIN_SIZE; bucket_size < size && bucket < MEM_HISTOGRAM_BUCKETS - 1u; bucket_size <<= 1) {
+		bucket++;
+	}
+	return bucket;
+}
+
+static void counters_write_begin(mem_counters* const counters) {
+	SDL_AtomicAdd(&counters->sequence, 1);
+	SDL_MemoryBarrierRelease();
+}
+
+static void counters_write_end(mem_counters* const counters) {
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicAdd(&counters->sequence, 1);
+}
+
+static void count_alloc(void* const mem, const size_t requested_size) {
+	const size_t size = mem_sizeof(mem);
+	mem_counters* counters = counters_get();
+	if (counters == NULL) {
+		SDL_AtomicLock(&late_lock);
+		counters = &late_counters;
+	}
+
+	counters_write_begin(counters);
+	counters->allocated += size;
+	counters->allocs++;
+	counters->histogram[histogram_bucket(requested_size)]++;
+	counters->tag_allocs[this_tag]++;
+	counters->tag_bytes[this_tag] += size;
+	counters_write_end(counters);
+
+	if (counters == &late_counters) {
+		SDL_AtomicUnlock(&late_lock);
+	}
+}
+
+static void count_free(const size_t size) {
+	mem_counters* counters = counters_get();
+	if (counters == NULL) {
+		SDL_AtomicLock(&late_lock);
+		counters = &late_counters;
+	}
+
+	counters_write_begin(counters);
+	counters->freed += size;
+	counters->frees++;
+	counters_write_end(counters);
+
+	if (counters == &late_counters) {
+		SDL_AtomicUnlock(&late_lock);
+	}
+}
+
+/*
+ * Copy the counters consistently, retrying while their owner is writing them.
+ */
+static void counters_read(const mem_counters* const counters, mem_counters* const copy) {
+	while (true) {
+		const int sequence = SDL_AtomicGet((SDL_atomic_t*)&counters->sequence);
+		SDL_MemoryBarrierAcquire();
+		if (sequence % 2 == 0) {
+			memcpy(copy, counters, sizeof(mem_counters));
+			SDL_MemoryBarrierAcquire();
+			if (SDL_AtomicGet((SDL_atomic_t*)&counters->sequence) == sequence) {
+				return;
+			}
+		}
+	}
+}
+
+static void counters_add(mem_counters* const sum, const mem_counters* const counters) {
+	sum->allocated += counters->allocated;
+	sum->freed += counters->freed;
+	sum->allocs += counters->allocs;
+	sum->frees += counters->frees;
+	for (size_t i = 0u; i < MEM_HISTOGRAM_BUCKETS; i++) {
+		sum->histogram[i] += counters->histogram[i];
+	}
+	for (size_t i = 0u; i < MEM_TAG_COUNT; i++) {
+		sum->tag_allocs[i] += counters->tag_allocs[i];
+		sum->tag_bytes[i] += counters->tag_bytes[i];
+	}
+}
+
+/*
+ * Sum the counters of all threads.
+ */
+static void counters_sum(mem_counters* const sum) {
+	memset(sum, 0, sizeof(mem_counters));
+
+	SDL_AtomicLock(&counters_lock);
+	for (const mem_counters* counters = counters_list; counters != NULL; counters = counters->next) {
+		mem_counters copy;
+		counters_read(counters, &copy);
+		counters_add(sum, &copy);
+	}
+	SDL_AtomicUnlock(&counters_lock);
+
+	SDL_AtomicLock(&late_lock);
+	counters_add(sum, &late_counters);
+	SDL_AtomicUnlock(&late_lock);
+}
+
 bool mem_init() {
-	SDL_AtomicLock(&total_alloc_lock);
-	total_alloc = 0u;
-	SDL_AtomicUnlock(&total_alloc_lock);
+	counters_tls = SDL_TLSCreate();
+	if (counters_tls == 0) {
+		log_printf("Failed to create the memory counters' thread-local storage\n");
+		return false;
+	}
 
 	SDL_GetMemoryFunctions(
 		&orig_malloc,
@@ -121,11 +333,14 @@ bool mem_init() {
 	);
 	if (status != 0) {
 		log_printf("Failed to set SDL's memory functions to the mem_* functions\n");
+		return false;
 	}
-	return status == 0;
+	return scratch_init() && mem_slab_init();
 }
 
 bool mem_deinit() {
+	mem_slab_deinit();
+
 	assert(orig_malloc != NULL);
 	assert(orig_calloc != NULL);
 	assert(orig_realloc != NULL);
@@ -140,42 +355,26 @@ bool mem_deinit() {
 	if (status != 0) {
 		log_printf("Failed to restore SDL's memory functions to their initial defaults\n");
 	}
-	return status == 0;
-}
 
-static bool total_alloc_add(void* const mem) {
-	const size_t size = mem_sizeof(mem);
-	SDL_AtomicLock(&total_alloc_lock);
-	if (size > SIZE_MAX - total_alloc) {
-		SDL_AtomicUnlock(&total_alloc_lock);
-		log_printf("Error allocating memory: size > SIZE_MAX - total_alloc\n");
-		return false;
+	// Anything freed from here on is counted in the late counters.
+	SDL_AtomicLock(&counters_lock);
+	for (mem_counters* counters = counters_list, * next; counters != NULL; counters = next) {
+		next = counters->next;
+		free(counters);
 	}
-	total_alloc += size;
-	SDL_AtomicUnlock(&total_alloc_lock);
-	return true;
-}
+	counters_list = NULL;
+	SDL_AtomicUnlock(&counters_lock);
+	this_counters = NULL;
+	this_counters_released = true;
 
-static void total_alloc_sub(void* const mem) {
-	const size_t size = mem_sizeof(mem);
-	SDL_AtomicLock(&total_alloc_lock);
-	if (size > total_alloc) {
-		SDL_AtomicUnlock(&total_alloc_lock);
-		log_printf("Error freeing memory: size > total_alloc\n");
-		abort();
-	}
-	total_alloc -= size;
-	SDL_AtomicUnlock(&total_alloc_lock);
+	return status == 0;
 }
 
 void* SDLCALL mem_malloc(size_t size) {
 	if (size <= mem_left()) {
 		void* const mem = malloc(size);
 		if (mem != NULL) {
-			if (!total_alloc_add(mem)) {
-				mem_free(mem);
-				return NULL;
-			}
+			count_alloc(mem, size);
 		}
 		return mem;
 	}
@@ -188,10 +387,7 @@ void* SDLCALL mem_calloc(size_t nmemb, size_t size) {
 	if (nmemb <= mem_left() / size) {
 		void* const mem = calloc(nmemb, size);
 		if (mem != NULL) {
-			if (!total_alloc_add(mem)) {
-				mem_free(mem);
-				return NULL;
-			}
+			count_alloc(mem, nmemb * size);
 		}
 		return mem;
 	}
@@ -202,21 +398,19 @@ void* SDLCALL mem_calloc(size_t nmemb, size_t size) {
 
 void* SDLCALL mem_realloc(void* mem, size_t size) {
 	if (size <= mem_left()) {
+		size_t old_size = 0u;
 		if (mem != NULL) {
-			const size_t old_size = mem_sizeof(mem);
+			old_size = mem_sizeof(mem);
 			if (old_size == 0u) {
 				return NULL;
 			}
-			total_alloc_sub(mem);
 		}
 		void* const realloc_mem = realloc(mem, size);
 		if (realloc_mem != NULL) {
-			if (!total_alloc_add(realloc_mem)) {
-				if (realloc_mem != mem) {
-					mem_free(realloc_mem);
-				}
-				return NULL;
+			if (mem != NULL) {
+				count_free(old_size);
 			}
+			count_alloc(realloc_mem, size);
 		}
 		return realloc_mem;
 	}
@@ -226,7 +420,10 @@ void* SDLCALL mem_realloc(void* mem, size_t size) {
 }
 
 void SDLCALL mem_free(void* mem) {
-	total_alloc_sub(mem);
+	if (mem == NULL) {
+		return;
+	}
+	count_free(mem_sizeof(mem));
 	free(mem);
 }
 
@@ -249,10 +446,7 @@ void* mem_aligned_alloc(size_t alignment, size_t size) {
 	if (size <= mem_left()) {
 		void* const mem = real_aligned_alloc(alignment, size);
 		if (mem != NULL) {
-			if (!total_alloc_add(mem)) {
-				real_aligned_free(mem);
-				return NULL;
-			}
+			count_alloc(mem, size);
 		}
 		return mem;
 	}
@@ -262,23 +456,53 @@ void* mem_aligned_alloc(size_t alignment, size_t size) {
 }
 
 void mem_aligned_free(void* mem) {
-	total_alloc_sub(mem);
+	if (mem == NULL) {
+		return;
+	}
+	count_free(mem_sizeof(mem));
 	real_aligned_free(mem);
 }
 
 size_t mem_total() {
-	SDL_AtomicLock(&total_alloc_lock);
-	const register size_t current_total_alloc = total_alloc;
-	SDL_AtomicUnlock(&total_alloc_lock);
-	return current_total_alloc;
+	mem_counters sum;
+	counters_sum(&sum);
+	return sum.allocated - sum.freed;
+}
+
+size_t mem_num_allocs() {
+	mem_counters sum;
+	counters_sum(&sum);
+	return sum.allocs;
+}
+
+void mem_stats_get(mem_stats* const stats) {
+	assert(stats != NULL);
+
+	mem_counters sum;
+	counters_sum(&sum);
+	stats->total = sum.allocated - sum.freed;
+	stats->allocs = sum.allocs;
+	stats->frees = sum.frees;
+	memcpy(stats->histogram, sum.histogram, sizeof(stats->histogram));
+	memcpy(stats->tag_allocs, sum.tag_allocs, sizeof(stats->tag_allocs));
+	memcpy(stats->tag_bytes, sum.tag_bytes, sizeof(stats->tag_bytes));
+}
+
+mem_tag_type mem_tag_set(const mem_tag_type tag) {
+	assert(tag >= 0 && tag < MEM_TAG_COUNT);
+
+	const mem_tag_type old_tag = this_tag;
+	this_tag = tag;
+	return old_tag;
 }
 
 #else
 bool mem_init() {
-	return true;
+	return scratch_init() && mem_slab_init();
 }
 
 bool mem_deinit() {
+	mem_slab_deinit();
 	return true;
 }
 
@@ -294,138 +518,256 @@ void* mem_lua_alloc(void* userdata, void* mem, size_t old_size, size_t new_size)
 	return NULL;
 }
 
-// TODO: Make mem_bump_* thread-safe. Probably require that create/destroy are
-// called in a "controlling" thread, where the object is passed down to other
-// threads, with the controlling thread calling update once the subordinate
-// threads' usage is guaranteed to be completed at the point update is called,
-// then the controlling thread allowing the subordinate threads to use the
-// object up until the next update, etc. The API can be "difficult" to use for
-// better performance/safety, as it's intended for the engine internals managed
-// by engine-developers, not engine-users.
-
-struct mem_bump_object {
-	uint8_t* chunk;
-	size_t chunk_pos;
-	size_t chunk_size;
-	size_t next_size;
-
-	// TODO: Looks like chunk_pos could just be advanced every allocation, then
-	// if pos is beyond the current size in update, reallocate the chunk up to
-	// pos in update, negating the need for bumps_waiting entirely.
-	bool bumps_waiting;
-
-	// TODO: This can probably can be a multiple-producer/single-consumer
-	// conqueue.
-	queue_object* bumps;
+/*
+ * Blocks are linked from the newest back to the oldest, with the allocations
+ * following each block's header.
+ */
+typedef struct mem_arena_block {
+	struct mem_arena_block* prev;
+	size_t size;
+} mem_arena_block;
+
+struct mem_arena_object {
+	mem_arena_block* block;
+	size_t pos;
+
+	/*
+	 * The bytes allocated from blocks before the current one, and the most
+	 * allocated at once, including the bytes wasted at the ends of blocks.
+	 */
+	size_t prev_used;
+	size_t high_water;
+	size_t block_size;
 };
 
-mem_bump_object* mem_bump_create(const size_t total_size) {
-	mem_bump_object* const allocator = mem_malloc(sizeof(mem_bump_object));
-	if (allocator == NULL) {
+#define ARENA_ALIGNMENT (sizeof(max_align_t))
+#define ARENA_HEADER_SIZE ((sizeof(mem_arena_block) + ARENA_ALIGNMENT - 1u) & ~(ARENA_ALIGNMENT - 1u))
+
+static mem_arena_block* arena_block_create(mem_arena_block* const prev, const size_t size) {
+	mem_arena_block* const block = mem_malloc(ARENA_HEADER_SIZE + size);
+	if (block == NULL) {
+		return NULL;
+	}
+	block->prev = prev;
+	block->size = size;
+	return block;
+}
+
+mem_arena_object* mem_arena_create(const size_t block_size) {
+	mem_arena_object* const arena = mem_malloc(sizeof(mem_arena_object));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	arena->block_size = block_size > 0u ? block_size : ARENA_ALIGNMENT;
+	arena->block = arena_block_create(NULL, arena->block_size);
+	if (arena->block == NULL) {
+		mem_free(arena);
 		return NULL;
 	}
+	arena->pos = 0u;
+	arena->prev_used = 0u;
+	arena->high_water = 0u;
+
+	return arena;
+}
+
+static void arena_blocks_free(mem_arena_block* block, const mem_arena_block* const until) {
+	while (block != until) {
+		mem_arena_block* const prev = block->prev;
+		mem_free(block);
+		block = prev;
+	}
+}
+
+void mem_arena_destroy(mem_arena_object* const arena) {
+	assert(arena != NULL);
+
+	arena_blocks_free(arena->block, NULL);
+	mem_free(arena);
+}
+
+void* mem_arena_alloc(mem_arena_object* const arena, const size_t size, const size_t alignment) {
+	assert(arena != NULL);
+	assert(alignment > 0u && (alignment & (alignment - 1u)) == 0u);
+	assert(alignment <= ARENA_ALIGNMENT);
 
-	if (total_size > 0u) {
-		allocator->chunk = mem_malloc(total_size);
-		if (allocator->chunk == NULL) {
-			mem_free(allocator);
+	size_t start = (arena->pos + alignment - 1u) & ~(alignment - 1u);
+	if (start + size > arena->block->size) {
+		const size_t new_size = size > arena->block_size ? size : arena->block_size;
+		mem_arena_block* const block = arena_block_create(arena->block, new_size);
+		if (block == NULL) {
 			return NULL;
 		}
+		arena->prev_used += arena->block->size;
+		arena->block = block;
+		start = 0u;
 	}
-	else {
-		allocator->chunk = NULL;
+
+	arena->pos = start + size;
+	const size_t used = arena->prev_used + arena->pos;
+	if (used > arena->high_water) {
+		arena->high_water = used;
 	}
-	allocator->chunk_size = total_size;
-	allocator->chunk_pos = 0u;
-	allocator->next_size = 0u;
+	return (uint8_t*)arena->block + ARENA_HEADER_SIZE + start;
+}
 
-	allocator->bumps = queue_create();
-	if (allocator->bumps == NULL) {
-		mem_free(allocator->chunk);
-		mem_free(allocator);
+void* mem_arena_calloc(mem_arena_object* const arena, const size_t nmemb, const size_t size) {
+	assert(arena != NULL);
+
+	if (size > 0u && nmemb > SIZE_MAX / size) {
 		return NULL;
 	}
-	allocator->bumps_waiting = false;
-
-	return allocator;
+	void* const mem = mem_arena_alloc(arena, nmemb * size, ARENA_ALIGNMENT);
+	if (mem != NULL) {
+		memset(mem, 0, nmemb * size);
+	}
+	return mem;
 }
 
-void mem_bump_destroy(mem_bump_object* const allocator) {
-	assert(allocator != NULL);
+char* mem_arena_vsprintf(mem_arena_object* const arena, const char* const format, va_list args) {
+	assert(arena != NULL);
+	assert(format != NULL);
 
-	for (void* bump = queue_dequeue(allocator->bumps); bump != NULL; bump = queue_dequeue(allocator->bumps)) {
-		mem_free(bump);
+	va_list size_args;
+	va_copy(size_args, args);
+	const int len = vsnprintf(NULL, 0u, format, size_args);
+	va_end(size_args);
+	if (len < 0) {
+		return NULL;
+	}
+
+	char* const string = mem_arena_alloc(arena, (size_t)len + 1u, 1u);
+	if (string == NULL) {
+		return NULL;
 	}
-	queue_destroy(allocator->bumps);
-	mem_free(allocator->chunk);
-	mem_free(allocator);
+	vsnprintf(string, (size_t)len + 1u, format, args);
+	return string;
 }
 
-void* mem_bump_malloc(mem_bump_object* const allocator, const size_t size) {
-	assert(allocator != NULL);
-	assert(size > 0u);
+char* mem_arena_sprintf(mem_arena_object* const arena, const char* const format, ...) {
+	va_list args;
+	va_start(args, format);
+	char* const string = mem_arena_vsprintf(arena, format, args);
+	va_end(args);
+	return string;
+}
 
-	if (allocator->chunk_pos + size > allocator->chunk_size) {
-		void* const bump = mem_malloc(size);
-		if (bump == NULL) {
-			return NULL;
+mem_arena_mark mem_arena_mark_get(mem_arena_object* const arena) {
+	assert(arena != NULL);
+
+	return (mem_arena_mark) { .block = arena->block, .pos = arena->pos };
+}
+
+void mem_arena_rewind(mem_arena_object* const arena, const mem_arena_mark mark) {
+	assert(arena != NULL);
+	assert(mark.block != NULL);
+
+	while (arena->block != mark.block) {
+		mem_arena_block* const prev = arena->block->prev;
+		assert(prev != NULL);
+		mem_free(arena->block);
+		arena->block = prev;
+		arena->prev_used -= prev->size;
+	}
+	assert(mark.pos <= arena->pos);
+	arena->pos = mark.pos;
+}
+
+void mem_arena_reset(mem_arena_object* const arena) {
+	assert(arena != NULL);
+
+	if (arena->block->prev != NULL) {
+		// More than one block was needed, so they're replaced with one
+		// block big enough for all of them. If that fails, the first
+		// block is kept.
+		const size_t total = arena->prev_used + arena->block->size;
+		mem_arena_block* first = arena->block;
+		while (first->prev != NULL) {
+			first = first->prev;
 		}
-		allocator->next_size += size;
-		if (!queue_enqueue(allocator->bumps, bump)) {
-			mem_free(bump);
-			return NULL;
+		mem_arena_block* const block = arena_block_create(NULL, total);
+		if (block != NULL) {
+			arena_blocks_free(arena->block, NULL);
+			arena->block = block;
+			arena->block_size = total;
+		}
+		else {
+			arena_blocks_free(arena->block, first);
+			arena->block = first;
 		}
-		allocator->bumps_waiting = true;
-		return bump;
-	}
-	else {
-		void* const bump = allocator->chunk + allocator->chunk_pos;
-		allocator->chunk_pos += size;
-		return bump;
 	}
+	arena->pos = 0u;
+	arena->prev_used = 0u;
+}
+
+size_t mem_arena_used(const mem_arena_object* const arena) {
+	assert(arena != NULL);
+
+	return arena->prev_used + arena->pos;
+}
+
+size_t mem_arena_high_water(const mem_arena_object* const arena) {
+	assert(arena != NULL);
+
+	return arena->high_water;
+}
+
+/*
+ * Scratch arenas start small, growing to fit how they're used at their first
+ * resets.
+ */
+#define SCRATCH_BLOCK_SIZE ((size_t)64u << 10)
+
+static void scratch_high_water_record(const mem_arena_object* const arena) {
+	const int high_water = mem_arena_high_water(arena) > INT_MAX ? INT_MAX : (int)mem_arena_high_water(arena);
+	int peak;
+	do {
+		peak = SDL_AtomicGet(&scratch_high_water);
+	} while (high_water > peak && !SDL_AtomicCAS(&scratch_high_water, peak, high_water));
+}
+
+static void SDLCALL scratch_destroy(void* const data) {
+	mem_arena_object* const arena = data;
+	scratch_high_water_record(arena);
+	mem_arena_destroy(arena);
 }
 
-void* mem_bump_calloc(mem_bump_object* const allocator, const size_t nmemb, const size_t size) {
-	assert(allocator != NULL);
-	assert(size > 0u);
+mem_arena_object* mem_scratch_get() {
+	assert(scratch_tls != 0);
 
-	if (allocator->chunk_pos + nmemb * size > allocator->chunk_size) {
-		void* const bump = mem_calloc(nmemb, size);
-		if (bump == NULL) {
+	mem_arena_object* arena = SDL_TLSGet(scratch_tls);
+	if (arena == NULL) {
+		arena = mem_arena_create(SCRATCH_BLOCK_SIZE);
+		if (arena == NULL) {
 			return NULL;
 		}
-		allocator->next_size += nmemb * size;
-		if (!queue_enqueue(allocator->bumps, bump)) {
-			mem_free(bump);
+		if (SDL_TLSSet(scratch_tls, arena, scratch_destroy) < 0) {
+			mem_arena_destroy(arena);
 			return NULL;
 		}
-		allocator->bumps_waiting = true;
-		return bump;
-	}
-	else {
-		void* const bump = allocator->chunk + allocator->chunk_pos;
-		memset(bump, 0, nmemb * size);
-		allocator->chunk_pos += nmemb * size;
-		return bump;
 	}
+	return arena;
 }
 
-bool mem_bump_update(mem_bump_object* const allocator) {
-	if (allocator->bumps_waiting) {
-		for (void* bump = queue_dequeue(allocator->bumps); bump != NULL; bump = queue_dequeue(allocator->bumps)) {
-			mem_free(bump);
-		}
+void mem_scratch_reset() {
+	mem_arena_object* const arena = SDL_TLSGet(scratch_tls);
+	if (arena == NULL) {
+		return;
+	}
 
-		mem_free(allocator->chunk);
-		allocator->chunk_size = allocator->next_size;
-		allocator->chunk = mem_malloc(allocator->next_size);
-		if (allocator->chunk == NULL) {
-			return false;
-		}
+	scratch_high_water_record(arena);
+	mem_arena_reset(arena);
+}
 
-		allocator->bumps_waiting = false;
-	}
+size_t mem_scratch_high_water() {
+	return (size_t)SDL_AtomicGet(&scratch_high_water);
+}
 
-	allocator->next_size = 0u;
-	return true;
+void mem_scratch_destroy() {
+	mem_arena_object* const arena = SDL_TLSGet(scratch_tls);
+	if (arena != NULL) {
+		SDL_TLSSet(scratch_tls, NULL, NULL);
+		scratch_destroy(arena);
+	}
 }
@@ -48,6 +48,21 @@ bool mem_init();
  */
 bool mem_deinit();
 
+/*
+ * Set up the slab pools, and free all their slabs, called by mem_init and
+ * mem_deinit. Deinitializing returns the calling thread's cache to the pools
+ * first; all other threads using the pools must have exited by then.
+ */
+bool mem_slab_init();
+void mem_slab_deinit();
+
+/*
+ * Destroy the calling thread's scratch arena. Threads created with SDL have
+ * theirs destroyed when they exit; the main thread must destroy its own,
+ * before mem_deinit.
+ */
+void mem_scratch_destroy();
+
 /*
  * Allocation function suitable for passing to lua_newstate().
  */
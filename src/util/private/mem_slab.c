@@ -0,0 +1,307 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/mem.h"
+#include "util/private/mem_private.h"
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include <assert.h>
+
+/*
+ * Size classes are powers of two, starting from SLAB_MIN_SIZE.
+ */
+#define SLAB_MIN_SIZE ((size_t)16u)
+
+/*
+ * Free objects move between thread caches and pools this many at a time. A
+ * cache holding twice this many objects of a class gives a batch back.
+ */
+#define SLAB_BATCH 32u
+
+/*
+ * Slabs are carved into objects a batch at a time, as the objects are needed.
+ */
+#define SLAB_SIZE ((size_t)64u << 10)
+
+#define SLAB_ALIGNMENT _Alignof(max_align_t)
+#define SLAB_HEADER_SIZE ((sizeof(slab_object) + SLAB_ALIGNMENT - 1u) & ~(SLAB_ALIGNMENT - 1u))
+
+_Static_assert(SLAB_MIN_SIZE << (MEM_SLAB_CLASSES - 1u) == MEM_SLAB_MAX_SIZE, "The size classes must end at the maximum slab size");
+_Static_assert(SLAB_MIN_SIZE % SLAB_ALIGNMENT == 0u, "Slab objects must be aligned for any type");
+
+/*
+ * Free objects are linked through their first bytes. The first object of a
+ * batch links to the next batch; every object has room for both links.
+ */
+typedef struct slab_free_object slab_free_object;
+struct slab_free_object {
+	slab_free_object* next;
+	slab_free_object* next_batch;
+};
+
+_Static_assert(sizeof(slab_free_object) <= SLAB_MIN_SIZE, "Free objects must fit in the smallest size class");
+
+typedef struct slab_object slab_object;
+struct slab_object {
+	slab_object* next;
+};
+
+typedef struct slab_pool {
+	SDL_SpinLock lock;
+	slab_free_object* batches;
+	slab_object* slabs;
+	unsigned char* carve;
+	size_t carve_left;
+
+	#ifdef MEM_DEBUG
+	SDL_atomic_t capacity;
+	SDL_atomic_t used;
+	#endif
+} slab_pool;
+
+/*
+ * Batches returned by exiting threads or without a cache aren't of exactly
+ * SLAB_BATCH objects, so a class' num_free is only an estimate, used to decide
+ * when to give a batch back.
+ */
+typedef struct slab_cache {
+	struct {
+		slab_free_object* free;
+		size_t num_free;
+	} classes[MEM_SLAB_CLASSES];
+} slab_cache;
+
+static slab_pool pools[MEM_SLAB_CLASSES];
+static SDL_TLSID cache_tls = 0;
+
+static size_t class_get(const size_t size) {
+	size_t index = 0u;
+	for (size_t class_size = SLAB_MIN_SIZE; class_size < size; class_size <<= 1) {
+		index++;
+	}
+	return index;
+}
+
+static size_t class_size_get(const size_t index) {
+	return SLAB_MIN_SIZE << index;
+}
+
+static void pool_batch_put(slab_pool* const pool, slab_free_object* const batch) {
+	SDL_AtomicLock(&pool->lock);
+	batch->next_batch = pool->batches;
+	pool->batches = batch;
+	SDL_AtomicUnlock(&pool->lock);
+}
+
+/*
+ * Take a batch from the pool, carving a new one out of the pool's slabs if it
+ * has none. Returns NULL if a new slab couldn't be allocated.
+ */
+static slab_free_object* pool_batch_take(slab_pool* const pool, const size_t object_size) {
+	SDL_AtomicLock(&pool->lock);
+	slab_free_object* batch = pool->batches;
+	if (batch != NULL) {
+		pool->batches = batch->next_batch;
+		SDL_AtomicUnlock(&pool->lock);
+		return batch;
+	}
+
+	if (pool->carve_left < object_size * SLAB_BATCH) {
+		slab_object* const slab = mem_malloc(SLAB_SIZE);
+		if (slab == NULL) {
+			SDL_AtomicUnlock(&pool->lock);
+			return NULL;
+		}
+		slab->next = pool->slabs;
+		pool->slabs = slab;
+		pool->carve = (unsigned char*)slab + SLAB_HEADER_SIZE;
+		pool->carve_left = SLAB_SIZE - SLAB_HEADER_SIZE;
+	}
+	unsigned char* const carve = pool->carve;
+	pool->carve += object_size * SLAB_BATCH;
+	pool->carve_left -= object_size * SLAB_BATCH;
+	SDL_AtomicUnlock(&pool->lock);
+
+	#ifdef MEM_DEBUG
+	SDL_AtomicAdd(&pool->capacity, (int)SLAB_BATCH);
+	#endif
+
+	batch = (slab_free_object*)carve;
+	slab_free_object* object = batch;
+	for (size_t i = 1u; i < SLAB_BATCH; i++) {
+		object->next = (slab_free_object*)(carve + object_size * i);
+		object = object->next;
+	}
+	object->next = NULL;
+	return batch;
+}
+
+/*
+ * Return the whole cache to the pools, and free the cache.
+ */
+static void SDLCALL cache_destroy(void* const data) {
+	slab_cache* const cache = data;
+	for (size_t i = 0u; i < MEM_SLAB_CLASSES; i++) {
+		if (cache->classes[i].free != NULL) {
+			pool_batch_put(&pools[i], cache->classes[i].free);
+		}
+	}
+	mem_free(cache);
+}
+
+static slab_cache* cache_get() {
+	slab_cache* cache = SDL_TLSGet(cache_tls);
+	if (cache == NULL) {
+		cache = mem_calloc(1u, sizeof(slab_cache));
+		if (cache == NULL) {
+			return NULL;
+		}
+		if (SDL_TLSSet(cache_tls, cache, cache_destroy) < 0) {
+			mem_free(cache);
+			return NULL;
+		}
+	}
+	return cache;
+}
+
+bool mem_slab_init() {
+	for (size_t i = 0u; i < MEM_SLAB_CLASSES; i++) {
+		pools[i] = (slab_pool) { 0 };
+	}
+	cache_tls = SDL_TLSCreate();
+	return cache_tls != 0;
+}
+
+void mem_slab_deinit() {
+	if (cache_tls == 0) {
+		return;
+	}
+
+	slab_cache* const cache = SDL_TLSGet(cache_tls);
+	if (cache != NULL) {
+		SDL_TLSSet(cache_tls, NULL, NULL);
+		cache_destroy(cache);
+	}
+	for (size_t i = 0u; i < MEM_SLAB_CLASSES; i++) {
+		for (slab_object* slab = pools[i].slabs, * next; slab != NULL; slab = next) {
+			next = slab->next;
+			mem_free(slab);
+		}
+		pools[i] = (slab_pool) { 0 };
+	}
+	cache_tls = 0;
+}
+
+void* mem_slab_alloc(const size_t size) {
+	assert(cache_tls != 0);
+
+	if (size > MEM_SLAB_MAX_SIZE) {
+		return mem_malloc(size);
+	}
+
+	slab_cache* const cache = cache_get();
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	const size_t index = class_get(size);
+	if (cache->classes[index].free == NULL) {
+		cache->classes[index].free = pool_batch_take(&pools[index], class_size_get(index));
+		if (cache->classes[index].free == NULL) {
+			return NULL;
+		}
+		cache->classes[index].num_free = SLAB_BATCH;
+	}
+
+	slab_free_object* const object = cache->classes[index].free;
+	cache->classes[index].free = object->next;
+	if (cache->classes[index].num_free > 0u) {
+		cache->classes[index].num_free--;
+	}
+
+	#ifdef MEM_DEBUG
+	SDL_AtomicAdd(&pools[index].used, 1);
+	#endif
+
+	return object;
+}
+
+void mem_slab_free(void* const mem, const size_t size) {
+	assert(cache_tls != 0);
+
+	if (mem == NULL) {
+		return;
+	}
+	else if (size > MEM_SLAB_MAX_SIZE) {
+		mem_free(mem);
+		return;
+	}
+
+	const size_t index = class_get(size);
+	slab_free_object* const object = mem;
+
+	#ifdef MEM_DEBUG
+	SDL_AtomicAdd(&pools[index].used, -1);
+	#endif
+
+	// Without a cache, the object goes back to the pool as a batch of one.
+	slab_cache* const cache = cache_get();
+	if (cache == NULL) {
+		object->next = NULL;
+		pool_batch_put(&pools[index], object);
+		return;
+	}
+
+	object->next = cache->classes[index].free;
+	cache->classes[index].free = object;
+	if (++cache->classes[index].num_free < SLAB_BATCH * 2u) {
+		return;
+	}
+
+	// The most recently freed objects stay in the cache, as they're the most
+	// likely to still be in the CPU's cache; the rest go back to the pool.
+	slab_free_object* last = object;
+	for (size_t i = 1u; i < SLAB_BATCH && last->next != NULL; i++) {
+		last = last->next;
+	}
+	slab_free_object* const batch = last->next;
+	last->next = NULL;
+	cache->classes[index].num_free = SLAB_BATCH;
+	if (batch != NULL) {
+		pool_batch_put(&pools[index], batch);
+	}
+}
+
+#ifdef MEM_DEBUG
+void mem_slab_stats_get(mem_slab_stats stats[MEM_SLAB_CLASSES]) {
+	assert(stats != NULL);
+
+	for (size_t i = 0u; i < MEM_SLAB_CLASSES; i++) {
+		stats[i].object_size = class_size_get(i);
+		stats[i].capacity = (size_t)SDL_AtomicGet(&pools[i].capacity);
+		stats[i].used = (size_t)SDL_AtomicGet(&pools[i].used);
+	}
+}
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/private/mpmcqueue.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "SDL_atomic.h"
+#include "SDL_mutex.h"
+#include <limits.h>
+#include <assert.h>
+
+#define CACHE_LINE_SIZE 64u
+
+/*
+ * A cell is free for the enqueue at position pos when its sequence is pos, and
+ * holds the value for the dequeue at position pos once its sequence is
+ * pos + 1. Dequeueing sets the sequence to the position of the enqueue one lap
+ * later. Positions and sequences only ever increase, wrapping around, so
+ * they're only compared by their difference.
+ */
+typedef struct cell_type {
+	SDL_atomic_t sequence;
+	void* value;
+} cell_type;
+
+struct mpmcqueue_object {
+	SDL_atomic_t enqueue_pos;
+	unsigned char enqueue_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+	SDL_atomic_t dequeue_pos;
+	unsigned char dequeue_pad[CACHE_LINE_SIZE - sizeof(SDL_atomic_t)];
+
+	/*
+	 * Threads blocked in the waiting functions. Threads that changed the
+	 * queue only post a semaphore when there are waiters, so the semaphores
+	 * cost nothing while the queue is neither empty nor full.
+	 */
+	SDL_atomic_t num_enqueue_waiters;
+	SDL_atomic_t num_dequeue_waiters;
+	SDL_sem* not_full_sem;
+	SDL_sem* not_empty_sem;
+
+	unsigned mask;
+	cell_type cells[];
+};
+
+static int sequence_diff(const int a, const unsigned b) {
+	return (int)((unsigned)a - b);
+}
+
+mpmcqueue_object* mpmcqueue_create(const size_t capacity) {
+	assert(capacity > 0u);
+	assert(capacity <= (size_t)INT_MAX);
+
+	size_t size = 1u;
+	while (size < capacity) {
+		size *= 2u;
+	}
+
+	mpmcqueue_object* const queue = mem_malloc(sizeof(mpmcqueue_object) + size * sizeof(cell_type));
+	if (queue == NULL) {
+		return NULL;
+	}
+
+	queue->not_full_sem = SDL_CreateSemaphore(0u);
+	queue->not_empty_sem = SDL_CreateSemaphore(0u);
+	if (queue->not_full_sem == NULL || queue->not_empty_sem == NULL) {
+		log_printf("Error creating semaphores for a concurrent queue: %s\n", SDL_GetError());
+		if (queue->not_full_sem != NULL) {
+			SDL_DestroySemaphore(queue->not_full_sem);
+		}
+		if (queue->not_empty_sem != NULL) {
+			SDL_DestroySemaphore(queue->not_empty_sem);
+		}
+		mem_free(queue);
+		return NULL;
+	}
+
+	queue->mask = (unsigned)(size - 1u);
+	for (size_t i = 0u; i < size; i++) {
+		queue->cells[i].value = NULL;
+		SDL_AtomicSet(&queue->cells[i].sequence, (int)i);
+	}
+	SDL_AtomicSet(&queue->enqueue_pos, 0);
+	SDL_AtomicSet(&queue->dequeue_pos, 0);
+	SDL_AtomicSet(&queue->num_enqueue_waiters, 0);
+	SDL_AtomicSet(&queue->num_dequeue_waiters, 0);
+	SDL_MemoryBarrierRelease();
+
+	return queue;
+}
+
+void mpmcqueue_destroy(mpmcqueue_object* const queue) {
+	assert(queue != NULL);
+
+	SDL_DestroySemaphore(queue->not_full_sem);
+	SDL_DestroySemaphore(queue->not_empty_sem);
+	mem_free(queue);
+}
+
+/*
+ * Wake up to count threads waiting on the semaphore. The add is a full barrier,
+ * ordering the preceding queue change before the load of the waiter count; the
+ * waiter increments its count before retrying, so one of the two sees the
+ * other.
+ */
+static void waiters_wake(SDL_atomic_t* const num_waiters, SDL_sem* const sem, const size_t count) {
+	if (count == 0u) {
+		return;
+	}
+
+	const int waiting = SDL_AtomicAdd(num_waiters, 0);
+	for (size_t i = 0u; (int)i < waiting && i < count; i++) {
+		SDL_SemPost(sem);
+	}
+}
+
+/*
+ * Claim up to count adjacent positions, whose cells must all be in the state
+ * indicated by offset (0 for free cells, 1 for full cells) relative to their
+ * positions. Returns the number claimed, storing the first position into
+ * first_pos.
+ */
+static size_t positions_claim(mpmcqueue_object* const queue, SDL_atomic_t* const pos_atomic, const unsigned offset, const size_t count, unsigned* const first_pos) {
+	unsigned pos = (unsigned)SDL_AtomicGet(pos_atomic);
+	while (true) {
+		size_t ready = 0u;
+		for (; ready < count && ready <= queue->mask; ready++) {
+			cell_type* const cell = &queue->cells[(pos + (unsigned)ready) & queue->mask];
+			const int sequence = SDL_AtomicGet(&cell->sequence);
+			SDL_MemoryBarrierAcquire();
+			const int diff = sequence_diff(sequence, pos + (unsigned)ready + offset);
+			if (diff != 0) {
+				if (diff > 0 && ready == 0u) {
+					// Another thread has claimed this position already.
+					goto reload;
+				}
+				break;
+			}
+		}
+		if (ready == 0u) {
+			return 0u;
+		}
+		if (SDL_AtomicCAS(pos_atomic, (int)pos, (int)(pos + (unsigned)ready))) {
+			*first_pos = pos;
+			return ready;
+		}
+
+		reload:
+		pos = (unsigned)SDL_AtomicGet(pos_atomic);
+	}
+}
+
+size_t mpmcqueue_enqueue_batch(mpmcqueue_object* const queue, void* const* const values, const size_t count) {
+	assert(queue != NULL);
+	assert(values != NULL || count == 0u);
+
+	if (count == 0u) {
+		return 0u;
+	}
+
+	unsigned pos;
+	const size_t claimed = positions_claim(queue, &queue->enqueue_pos, 0u, count, &pos);
+	for (size_t i = 0u; i < claimed; i++) {
+		assert(values[i] != NULL);
+		cell_type* const cell = &queue->cells[(pos + (unsigned)i) & queue->mask];
+		cell->value = values[i];
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&cell->sequence, (int)(pos + (unsigned)i + 1u));
+	}
+
+	waiters_wake(&queue->num_dequeue_waiters, queue->not_empty_sem, claimed);
+	return claimed;
+}
+
+size_t mpmcqueue_dequeue_batch(mpmcqueue_object* const queue, void** const values, const size_t max_count) {
+	assert(queue != NULL);
+	assert(values != NULL || max_count == 0u);
+
+	if (max_count == 0u) {
+		return 0u;
+	}
+
+	unsigned pos;
+	const size_t claimed = positions_claim(queue, &queue->dequeue_pos, 1u, max_count, &pos);
+	for (size_t i = 0u; i < claimed; i++) {
+		cell_type* const cell = &queue->cells[(pos + (unsigned)i) & queue->mask];
+		values[i] = cell->value;
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSet(&cell->sequence, (int)(pos + (unsigned)i + queue->mask + 1u));
+	}
+
+	waiters_wake(&queue->num_enqueue_waiters, queue->not_full_sem, claimed);
+	return claimed;
+}
+
+bool mpmcqueue_enqueue(mpmcqueue_object* const queue, void* const value) {
+	assert(value != NULL);
+
+	return mpmcqueue_enqueue_batch(queue, &value, 1u) == 1u;
+}
+
+void* mpmcqueue_dequeue(mpmcqueue_object* const queue) {
+	void* value;
+	return mpmcqueue_dequeue_batch(queue, &value, 1u) == 1u ? value : NULL;
+}
+
+bool mpmcqueue_enqueue_wait(mpmcqueue_object* const queue, void* const value) {
+	assert(queue != NULL);
+	assert(value != NULL);
+
+	while (!mpmcqueue_enqueue(queue, value)) {
+		SDL_AtomicIncRef(&queue->num_enqueue_waiters);
+		const bool enqueued = mpmcqueue_enqueue(queue, value);
+		const bool waited = enqueued || SDL_SemWait(queue->not_full_sem) == 0;
+		SDL_AtomicDecRef(&queue->num_enqueue_waiters);
+		if (enqueued) {
+			break;
+		}
+		else if (!waited) {
+			log_printf("Error waiting on a full concurrent queue: %s\n", SDL_GetError());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void* mpmcqueue_dequeue_wait(mpmcqueue_object* const queue) {
+	assert(queue != NULL);
+
+	void* value;
+	while ((value = mpmcqueue_dequeue(queue)) == NULL) {
+		SDL_AtomicIncRef(&queue->num_dequeue_waiters);
+		value = mpmcqueue_dequeue(queue);
+		const bool waited = value != NULL || SDL_SemWait(queue->not_empty_sem) == 0;
+		SDL_AtomicDecRef(&queue->num_dequeue_waiters);
+		if (value != NULL) {
+			break;
+		}
+		else if (!waited) {
+			log_printf("Error waiting on an empty concurrent queue: %s\n", SDL_GetError());
+			return NULL;
+		}
+	}
+
+	return value;
+}
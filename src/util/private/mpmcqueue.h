@@ -0,0 +1,89 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Bounded, multiple producer, multiple consumer concurrent queue. Any thread
+ * can enqueue and dequeue. Unlike conqueue (util/private/conqueue.h), the queue
+ * has a fixed capacity, so it never allocates after creation, but enqueueing
+ * fails when it's full.
+ *
+ * The nonblocking functions never wait on other threads beyond retrying a
+ * contended atomic operation. The waiting functions only block, on a
+ * semaphore, while the queue is full or empty.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct mpmcqueue_object mpmcqueue_object;
+
+/*
+ * Create an empty queue object that can hold at least capacity values. Returns
+ * NULL if creation failed.
+ */
+mpmcqueue_object* mpmcqueue_create(const size_t capacity);
+
+/*
+ * Destroy a queue object. Values still enqueued are discarded. No other thread
+ * may be using the queue.
+ */
+void mpmcqueue_destroy(mpmcqueue_object* const queue);
+
+/*
+ * Enqueue a value pointer onto the queue. Returns false if the queue is full,
+ * leaving it unchanged. It's invalid to enqueue NULL.
+ */
+bool mpmcqueue_enqueue(mpmcqueue_object* const queue, void* const value);
+
+/*
+ * Dequeue a value pointer from the queue. Returns NULL if the queue is empty.
+ */
+void* mpmcqueue_dequeue(mpmcqueue_object* const queue);
+
+/*
+ * Enqueue up to count value pointers from values, in order, returning the
+ * number enqueued, which is only less than count if the queue filled up. The
+ * values enqueued are adjacent in the queue, and are claimed at once, rather
+ * than one at a time.
+ */
+size_t mpmcqueue_enqueue_batch(mpmcqueue_object* const queue, void* const* const values, const size_t count);
+
+/*
+ * Dequeue up to max_count value pointers into values, in order, returning the
+ * number dequeued, which is zero if the queue is empty.
+ */
+size_t mpmcqueue_dequeue_batch(mpmcqueue_object* const queue, void** const values, const size_t max_count);
+
+/*
+ * Enqueue a value pointer onto the queue, waiting while the queue is full.
+ * Returns false if waiting failed.
+ */
+bool mpmcqueue_enqueue_wait(mpmcqueue_object* const queue, void* const value);
+
+/*
+ * Dequeue a value pointer from the queue, waiting while the queue is empty.
+ * Returns NULL if waiting failed.
+ */
+void* mpmcqueue_dequeue_wait(mpmcqueue_object* const queue);
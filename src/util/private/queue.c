@@ -45,11 +45,13 @@ queue_object* queue_create() {
         return NULL;
     }
 
-    queue->dequeue = queue->enqueue = mem_calloc(1u, sizeof(node_object));
+    queue->dequeue = queue->enqueue = mem_slab_alloc(sizeof(node_object));
     if (queue->enqueue == NULL) {
         mem_free(queue);
         return false;
     }
+    queue->enqueue->value = NULL;
+    queue->enqueue->next = NULL;
     queue->cache = NULL;
 
 	return queue;
@@ -59,7 +61,7 @@ void queue_destroy(queue_object* const queue) {
     assert(queue != NULL);
 
     while (queue_dequeue(queue) != NULL) continue;
-    mem_free(queue->dequeue);
+    mem_slab_free(queue->dequeue, sizeof(node_object));
     queue_empty_cache(queue);
     mem_free(queue);
 }
@@ -74,7 +76,7 @@ bool queue_enqueue(queue_object* const queue, void* const value) {
         queue->cache = queue->cache->next;
     }
     else {
-        node = mem_malloc(sizeof(node_object));
+        node = mem_slab_alloc(sizeof(node_object));
     }
     if (node == NULL) {
         return false;
@@ -109,7 +111,8 @@ void queue_empty_cache(queue_object* const queue) {
 
     for (node_object* current = queue->cache; current != NULL;) {
         node_object* const next = current->next;
-        mem_free(current);
+        mem_slab_free(current, sizeof(node_object));
         current = next;
     }
+    queue->cache = NULL;
 }
@@ -0,0 +1,139 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Compile-time selection of SIMD instruction sets. Exactly one of SIMD_SSE2 or
+ * SIMD_NEON is defined when the target supports it, and SIMD_AVX and
+ * SIMD_AVX2 are also defined when AVX and AVX2 are enabled for the target. simd_float4 is a vector of four
+ * floats, with the few operations shared by all the instruction sets; code
+ * needing more than that uses the intrinsics directly.
+ */
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define SIMD_AVX
+#include <immintrin.h>
+#endif
+#if defined(__AVX2__)
+#define SIMD_AVX2
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(SIMD_SSE2)
+typedef __m128 simd_float4;
+
+static inline simd_float4 simd_load(const float* const src) {
+	return _mm_loadu_ps(src);
+}
+
+static inline void simd_store(float* const dst, const simd_float4 src) {
+	_mm_storeu_ps(dst, src);
+}
+
+static inline simd_float4 simd_splat(const float value) {
+	return _mm_set1_ps(value);
+}
+
+static inline simd_float4 simd_set(const float x, const float y, const float z, const float w) {
+	return _mm_setr_ps(x, y, z, w);
+}
+
+static inline simd_float4 simd_add(const simd_float4 lhs, const simd_float4 rhs) {
+	return _mm_add_ps(lhs, rhs);
+}
+
+static inline simd_float4 simd_mul(const simd_float4 lhs, const simd_float4 rhs) {
+	return _mm_mul_ps(lhs, rhs);
+}
+
+static inline simd_float4 simd_min(const simd_float4 lhs, const simd_float4 rhs) {
+	return _mm_min_ps(lhs, rhs);
+}
+
+static inline simd_float4 simd_max(const simd_float4 lhs, const simd_float4 rhs) {
+	return _mm_max_ps(lhs, rhs);
+}
+
+/*
+ * Returns lhs * rhs + add.
+ */
+static inline simd_float4 simd_madd(const simd_float4 lhs, const simd_float4 rhs, const simd_float4 add) {
+	return _mm_add_ps(_mm_mul_ps(lhs, rhs), add);
+}
+
+static inline float simd_sum(const simd_float4 src) {
+	const __m128 pairs = _mm_add_ps(src, _mm_movehl_ps(src, src));
+	return _mm_cvtss_f32(_mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+#elif defined(SIMD_NEON)
+typedef float32x4_t simd_float4;
+
+static inline simd_float4 simd_load(const float* const src) {
+	return vld1q_f32(src);
+}
+
+static inline void simd_store(float* const dst, const simd_float4 src) {
+	vst1q_f32(dst, src);
+}
+
+static inline simd_float4 simd_splat(const float value) {
+	return vdupq_n_f32(value);
+}
+
+static inline simd_float4 simd_set(const float x, const float y, const float z, const float w) {
+	const float values[4] = { x, y, z, w };
+	return vld1q_f32(values);
+}
+
+static inline simd_float4 simd_add(const simd_float4 lhs, const simd_float4 rhs) {
+	return vaddq_f32(lhs, rhs);
+}
+
+static inline simd_float4 simd_mul(const simd_float4 lhs, const simd_float4 rhs) {
+	return vmulq_f32(lhs, rhs);
+}
+
+static inline simd_float4 simd_min(const simd_float4 lhs, const simd_float4 rhs) {
+	return vminq_f32(lhs, rhs);
+}
+
+static inline simd_float4 simd_max(const simd_float4 lhs, const simd_float4 rhs) {
+	return vmaxq_f32(lhs, rhs);
+}
+
+static inline simd_float4 simd_madd(const simd_float4 lhs, const simd_float4 rhs, const simd_float4 add) {
+	return vmlaq_f32(add, lhs, rhs);
+}
+
+static inline float simd_sum(const simd_float4 src) {
+	const float32x2_t pairs = vadd_f32(vget_low_f32(src), vget_high_f32(src));
+	return vget_lane_f32(vpadd_f32(pairs, pairs), 0);
+}
+#endif
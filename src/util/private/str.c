@@ -24,12 +24,19 @@
 
 #include "util/str.h"
 #include "util/mem.h"
+#include "util/private/simd.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <stddef.h>
+#include <limits.h>
+#include <math.h>
 #include <assert.h>
 
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
 char* alloc_sprintf(const char* const fmt, ...) {
 	assert(fmt != NULL);
 
@@ -81,6 +88,289 @@ char* alloc_vsprintf(const char* const fmt, va_list args) {
 	return printout;
 }
 
+typedef struct format_output {
+	char* buffer;
+	size_t size;
+	size_t length;
+} format_output;
+
+static inline void output_chars(format_output* const output, const char* const chars, const size_t count) {
+	if (output->length < output->size) {
+		const size_t room = output->size - output->length;
+		memcpy(output->buffer + output->length, chars, count < room ? count : room);
+	}
+	output->length += count;
+}
+
+static inline void output_fill(format_output* const output, const char c, size_t count) {
+	for (; count > 0u; count--) {
+		if (output->length < output->size) {
+			output->buffer[output->length] = c;
+		}
+		output->length++;
+	}
+}
+
+/*
+ * Output the converted text, padded to width. Zero padding goes after the
+ * sign, if the text has one.
+ */
+static void output_field(format_output* const output, const char* const text, const size_t length, const size_t width, const bool left, const bool zero) {
+	const size_t padding = width > length ? width - length : 0u;
+	if (left) {
+		output_chars(output, text, length);
+		output_fill(output, ' ', padding);
+	}
+	else if (zero) {
+		const size_t sign = length > 0u && text[0] == '-' ? 1u : 0u;
+		output_chars(output, text, sign);
+		output_fill(output, '0', padding);
+		output_chars(output, text + sign, length - sign);
+	}
+	else {
+		output_fill(output, ' ', padding);
+		output_chars(output, text, length);
+	}
+}
+
+/*
+ * Write the digits of value into the end of the digits buffer, returning the
+ * first digit.
+ */
+static char* digits_write(char* const end, unsigned long long value, const unsigned base, const bool upper) {
+	const char* const chars = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char* digit = end;
+	do {
+		*--digit = chars[value % base];
+		value /= base;
+	} while (value > 0u);
+	return digit;
+}
+
+/*
+ * Values are only formatted here if scaling them to an integer leaves them
+ * clear of a rounding tie, so rounding the scaled value gives the same result
+ * as the exact decimal rounding vsnprintf does; the scaled value is kept small
+ * enough that the scaling's error can't move it across a tie.
+ */
+#define FLOAT_SCALED_MAX 1099511627776.0
+#define FLOAT_TIE_MARGIN 0.001
+
+static const unsigned long long powers_of_ten[] = {
+	1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull, 100000000ull, 1000000000ull
+};
+
+static bool float_write(char* const buffer, size_t* const length, const double value, const size_t precision) {
+	if (!isfinite(value) || precision >= lengthof(powers_of_ten)) {
+		return false;
+	}
+
+	const double scaled = fabs(value) * (double)powers_of_ten[precision];
+	if (scaled >= FLOAT_SCALED_MAX) {
+		return false;
+	}
+	const double whole = floor(scaled);
+	const double fraction = scaled - whole;
+	if (fabs(fraction - 0.5) < FLOAT_TIE_MARGIN) {
+		return false;
+	}
+	const unsigned long long rounded = (unsigned long long)whole + (fraction > 0.5 ? 1u : 0u);
+
+	char digits[32];
+	char* const end = digits + sizeof(digits);
+	char* first = end;
+	if (precision > 0u) {
+		const char* const fraction_digits = digits_write(end, rounded % powers_of_ten[precision], 10u, false);
+		first = end - precision;
+		memset(first, '0', (size_t)(fraction_digits - first));
+		*--first = '.';
+	}
+	first = digits_write(first, rounded / powers_of_ten[precision], 10u, false);
+	if (signbit(value)) {
+		*--first = '-';
+	}
+	*length = (size_t)(end - first);
+	memcpy(buffer, first, *length);
+	return true;
+}
+
+typedef enum format_length {
+	FORMAT_LENGTH_NONE,
+	FORMAT_LENGTH_LONG,
+	FORMAT_LENGTH_LONG_LONG,
+	FORMAT_LENGTH_SIZE
+} format_length;
+
+/*
+ * Returns false if the format needs anything not handled here, in which case
+ * the output is incomplete, and had args partly consumed.
+ */
+static bool fast_format(format_output* const output, const char* format, va_list args) {
+	while (*format != '\0') {
+		const char* const literal = format;
+		while (*format != '\0' && *format != '%') {
+			format++;
+		}
+		output_chars(output, literal, (size_t)(format - literal));
+		if (*format == '\0') {
+			break;
+		}
+		format++;
+
+		bool left = false;
+		bool zero = false;
+		for (; *format == '-' || *format == '0'; format++) {
+			if (*format == '-') {
+				left = true;
+			}
+			else {
+				zero = true;
+			}
+		}
+		size_t width = 0u;
+		for (; *format >= '0' && *format <= '9'; format++) {
+			width = width * 10u + (size_t)(*format - '0');
+		}
+		bool has_precision = false;
+		size_t precision = 0u;
+		if (*format == '.') {
+			has_precision = true;
+			for (format++; *format >= '0' && *format <= '9'; format++) {
+				precision = precision * 10u + (size_t)(*format - '0');
+			}
+		}
+		format_length length = FORMAT_LENGTH_NONE;
+		if (format[0] == 'l' && format[1] == 'l') {
+			length = FORMAT_LENGTH_LONG_LONG;
+			format += 2;
+		}
+		else if (*format == 'l') {
+			length = FORMAT_LENGTH_LONG;
+			format++;
+		}
+		else if (*format == 'z') {
+			length = FORMAT_LENGTH_SIZE;
+			format++;
+		}
+
+		char text[64];
+		char* const end = text + sizeof(text);
+		const char conversion = *format++;
+		switch (conversion) {
+		case 'd':
+		case 'i': {
+			if (has_precision || length == FORMAT_LENGTH_SIZE) {
+				return false;
+			}
+			long long value;
+			switch (length) {
+			case FORMAT_LENGTH_LONG: value = va_arg(args, long); break;
+			case FORMAT_LENGTH_LONG_LONG: value = va_arg(args, long long); break;
+			default: value = va_arg(args, int); break;
+			}
+			const unsigned long long magnitude = value < 0 ? 0ull - (unsigned long long)value : (unsigned long long)value;
+			char* first = digits_write(end, magnitude, 10u, false);
+			if (value < 0) {
+				*--first = '-';
+			}
+			output_field(output, first, (size_t)(end - first), width, left, zero);
+			break;
+		}
+
+		case 'u':
+		case 'x':
+		case 'X': {
+			if (has_precision) {
+				return false;
+			}
+			unsigned long long value;
+			switch (length) {
+			case FORMAT_LENGTH_LONG: value = va_arg(args, unsigned long); break;
+			case FORMAT_LENGTH_LONG_LONG: value = va_arg(args, unsigned long long); break;
+			case FORMAT_LENGTH_SIZE: value = va_arg(args, size_t); break;
+			default: value = va_arg(args, unsigned); break;
+			}
+			char* const first = digits_write(end, value, conversion == 'u' ? 10u : 16u, conversion == 'X');
+			output_field(output, first, (size_t)(end - first), width, left, zero);
+			break;
+		}
+
+		case 'f': {
+			if (length == FORMAT_LENGTH_LONG_LONG || length == FORMAT_LENGTH_SIZE) {
+				return false;
+			}
+			size_t text_length;
+			if (!float_write(text, &text_length, va_arg(args, double), has_precision ? precision : 6u)) {
+				return false;
+			}
+			output_field(output, text, text_length, width, left, zero);
+			break;
+		}
+
+		case 's': {
+			if (length != FORMAT_LENGTH_NONE || zero) {
+				return false;
+			}
+			const char* const string = va_arg(args, const char*);
+			if (string == NULL) {
+				// Printed however vsnprintf prints NULL strings, such as
+				// glibc's "(null)".
+				return false;
+			}
+			size_t string_length = 0u;
+			while ((!has_precision || string_length < precision) && string[string_length] != '\0') {
+				string_length++;
+			}
+			output_field(output, string, string_length, width, left, false);
+			break;
+		}
+
+		case 'c': {
+			if (length != FORMAT_LENGTH_NONE || has_precision || zero) {
+				return false;
+			}
+			text[0] = (char)va_arg(args, int);
+			output_field(output, text, 1u, width, left, false);
+			break;
+		}
+
+		case '%':
+			if (left || zero || width > 0u || has_precision || length != FORMAT_LENGTH_NONE) {
+				return false;
+			}
+			output_chars(output, "%", 1u);
+			break;
+
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+int str_vsnprintf(char* const buffer, const size_t size, const char* const format, va_list args) {
+	assert(buffer != NULL || size == 0u);
+	assert(format != NULL);
+
+	format_output output = {
+		.buffer = buffer,
+		.size = size > 0u ? size - 1u : 0u,
+		.length = 0u
+	};
+	va_list fast_args;
+	va_copy(fast_args, args);
+	const bool fast = fast_format(&output, format, fast_args);
+	va_end(fast_args);
+	if (!fast || output.length > INT_MAX) {
+		return vsnprintf(buffer, size, format, args);
+	}
+
+	if (size > 0u) {
+		buffer[output.length < output.size ? output.length : output.size] = '\0';
+	}
+	return (int)output.length;
+}
+
 #ifndef _MSC_VER
 int stricmp(const char* lhs, const char* rhs) {
 	assert(lhs != NULL);
@@ -166,3 +456,207 @@ size_t utf8_strlen(const char* const str) {
 	);
 	return len;
 }
+
+/*
+ * ASCII runs are found a block at a time: block_ascii_length returns how many
+ * of the block's bytes are ASCII before the first that isn't, and block_widen
+ * zero-extends all the block's bytes to codepoints.
+ */
+#if defined(SIMD_SSE2)
+static inline size_t ctz32(const uint32_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return (size_t)index;
+#else
+	return (size_t)__builtin_ctz(value);
+#endif
+}
+#endif
+
+#if defined(SIMD_AVX2)
+#define ASCII_BLOCK_SIZE 32u
+
+static inline size_t block_ascii_length(const unsigned char* const block) {
+	const uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)block));
+	return mask == 0u ? ASCII_BLOCK_SIZE : ctz32(mask);
+}
+
+static inline void block_widen(const unsigned char* const block, uint32_t* const codepoints) {
+	for (size_t i = 0u; i < ASCII_BLOCK_SIZE; i += 8u) {
+		_mm256_storeu_si256((__m256i*)(codepoints + i), _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(block + i))));
+	}
+}
+
+#elif defined(SIMD_SSE2)
+#define ASCII_BLOCK_SIZE 16u
+
+static inline size_t block_ascii_length(const unsigned char* const block) {
+	const uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)block));
+	return mask == 0u ? ASCII_BLOCK_SIZE : ctz32(mask);
+}
+
+static inline void block_widen(const unsigned char* const block, uint32_t* const codepoints) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bytes = _mm_loadu_si128((const __m128i*)block);
+	const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+	const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+	_mm_storeu_si128((__m128i*)codepoints, _mm_unpacklo_epi16(low, zero));
+	_mm_storeu_si128((__m128i*)(codepoints + 4), _mm_unpackhi_epi16(low, zero));
+	_mm_storeu_si128((__m128i*)(codepoints + 8), _mm_unpacklo_epi16(high, zero));
+	_mm_storeu_si128((__m128i*)(codepoints + 12), _mm_unpackhi_epi16(high, zero));
+}
+
+#elif defined(SIMD_NEON)
+#define ASCII_BLOCK_SIZE 16u
+
+static inline size_t ctz64(const uint64_t value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (size_t)index;
+#else
+	return (size_t)__builtin_ctzll(value);
+#endif
+}
+
+/*
+ * NEON has no movemask, so the high bits are found in each half of the block,
+ * as a 64-bit lane; this assumes a little-endian target, as all NEON targets
+ * we build for are.
+ */
+static inline size_t block_ascii_length(const unsigned char* const block) {
+	const uint64x2_t high_bits = vreinterpretq_u64_u8(vandq_u8(vld1q_u8(block), vdupq_n_u8(0x80u)));
+	const uint64_t low = vgetq_lane_u64(high_bits, 0);
+	const uint64_t high = vgetq_lane_u64(high_bits, 1);
+	if (low != 0u) {
+		return ctz64(low) / 8u;
+	}
+	else if (high != 0u) {
+		return 8u + ctz64(high) / 8u;
+	}
+	return ASCII_BLOCK_SIZE;
+}
+
+static inline void block_widen(const unsigned char* const block, uint32_t* const codepoints) {
+	const uint8x16_t bytes = vld1q_u8(block);
+	const uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+	const uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+	vst1q_u32(codepoints, vmovl_u16(vget_low_u16(low)));
+	vst1q_u32(codepoints + 4, vmovl_u16(vget_high_u16(low)));
+	vst1q_u32(codepoints + 8, vmovl_u16(vget_low_u16(high)));
+	vst1q_u32(codepoints + 12, vmovl_u16(vget_high_u16(high)));
+}
+
+#endif
+
+/*
+ * Decode the multibyte sequence at str, which is before end, returning its
+ * length, or 0 if it's invalid.
+ */
+static size_t sequence_decode(const unsigned char* const str, const unsigned char* const end, uint32_t* const codepoint) {
+	const size_t left = (size_t)(end - str);
+	const uint32_t lead = str[0];
+	if (lead >= 0xC2u && lead <= 0xDFu) {
+		if (left < 2u || (str[1] & 0xC0u) != 0x80u) {
+			return 0u;
+		}
+		*codepoint = ((lead & 0x1Fu) << 6) | (str[1] & 0x3Fu);
+		return 2u;
+	}
+	else if (lead >= 0xE0u && lead <= 0xEFu) {
+		if (
+			left < 3u ||
+			(str[1] & 0xC0u) != 0x80u ||
+			(str[2] & 0xC0u) != 0x80u ||
+			(lead == 0xE0u && str[1] < 0xA0u) ||
+			(lead == 0xEDu && str[1] > 0x9Fu)
+		) {
+			return 0u;
+		}
+		*codepoint = ((lead & 0x0Fu) << 12) | ((uint32_t)(str[1] & 0x3Fu) << 6) | (str[2] & 0x3Fu);
+		return 3u;
+	}
+	else if (lead >= 0xF0u && lead <= 0xF4u) {
+		if (
+			left < 4u ||
+			(str[1] & 0xC0u) != 0x80u ||
+			(str[2] & 0xC0u) != 0x80u ||
+			(str[3] & 0xC0u) != 0x80u ||
+			(lead == 0xF0u && str[1] < 0x90u) ||
+			(lead == 0xF4u && str[1] > 0x8Fu)
+		) {
+			return 0u;
+		}
+		*codepoint = ((lead & 0x07u) << 18) | ((uint32_t)(str[1] & 0x3Fu) << 12) | ((uint32_t)(str[2] & 0x3Fu) << 6) | (str[3] & 0x3Fu);
+		return 4u;
+	}
+	return 0u;
+}
+
+size_t utf8_decode(const char* const str, const size_t size, uint32_t* const codepoints) {
+	assert(str != NULL || size == 0u);
+	assert(codepoints != NULL || size == 0u);
+
+	const unsigned char* s = (const unsigned char*)str;
+	const unsigned char* const end = s + size;
+	uint32_t* out = codepoints;
+	while (s < end) {
+		#ifdef ASCII_BLOCK_SIZE
+		// Each codepoint takes at least one byte, so there's always room to
+		// store a whole block; codepoints widened past the block's ASCII are
+		// overwritten as decoding continues.
+		if ((size_t)(end - s) >= ASCII_BLOCK_SIZE) {
+			const size_t ascii = block_ascii_length(s);
+			if (ascii > 0u) {
+				block_widen(s, out);
+				s += ascii;
+				out += ascii;
+				continue;
+			}
+		}
+		#endif
+
+		if (*s < 0x80u) {
+			*out++ = *s++;
+			continue;
+		}
+		const size_t bytes = sequence_decode(s, end, out);
+		if (bytes == 0u) {
+			return SIZE_MAX;
+		}
+		s += bytes;
+		out++;
+	}
+	return (size_t)(out - codepoints);
+}
+
+bool utf8_valid(const char* const str, const size_t size) {
+	assert(str != NULL || size == 0u);
+
+	const unsigned char* s = (const unsigned char*)str;
+	const unsigned char* const end = s + size;
+	while (s < end) {
+		#ifdef ASCII_BLOCK_SIZE
+		if ((size_t)(end - s) >= ASCII_BLOCK_SIZE) {
+			const size_t ascii = block_ascii_length(s);
+			if (ascii > 0u) {
+				s += ascii;
+				continue;
+			}
+		}
+		#endif
+
+		if (*s < 0x80u) {
+			s++;
+			continue;
+		}
+		uint32_t codepoint;
+		const size_t bytes = sequence_decode(s, end, &codepoint);
+		if (bytes == 0u) {
+			return false;
+		}
+		s += bytes;
+	}
+	return true;
+}
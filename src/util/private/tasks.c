@@ -0,0 +1,199 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/private/tasks_private.h"
+#include "util/nanotime.h"
+#include "util/mem.h"
+#include "util/log.h"
+#include <inttypes.h>
+#include <assert.h>
+
+typedef struct task_object task_object;
+
+struct task_object {
+	task_object* next;
+	tasks_func func;
+	tasks_cancel_func cancel;
+	void* data;
+};
+
+/*
+ * Each priority's tasks, in the order they take turns.
+ */
+typedef struct task_list_type {
+	task_object* head;
+	task_object* tail;
+} task_list_type;
+
+static bool inited = false;
+static task_list_type lists[TASKS_PRIORITY_NUM];
+static uint64_t num_pending;
+
+/*
+ * The time of the current run, only valid while running.
+ */
+static bool running = false;
+static uint64_t run_start;
+static uint64_t run_allotted_time;
+
+static void list_push(task_list_type* const list, task_object* const task) {
+	task->next = NULL;
+	if (list->tail != NULL) {
+		list->tail->next = task;
+	}
+	else {
+		list->head = task;
+	}
+	list->tail = task;
+}
+
+static task_object* list_pop(task_list_type* const list) {
+	task_object* const task = list->head;
+	if (task != NULL) {
+		list->head = task->next;
+		if (list->head == NULL) {
+			list->tail = NULL;
+		}
+	}
+	return task;
+}
+
+bool tasks_init() {
+	assert(!inited);
+
+	for (size_t i = 0u; i < TASKS_PRIORITY_NUM; i++) {
+		lists[i].head = NULL;
+		lists[i].tail = NULL;
+	}
+	num_pending = 0u;
+	running = false;
+	inited = true;
+	return true;
+}
+
+void tasks_deinit() {
+	if (!inited) {
+		return;
+	}
+
+	if (num_pending > 0u) {
+		log_printf("Cancelling %" PRIu64 " unfinished tasks\n", num_pending);
+	}
+	for (size_t i = 0u; i < TASKS_PRIORITY_NUM; i++) {
+		task_object* task;
+		while ((task = list_pop(&lists[i])) != NULL) {
+			if (task->cancel != NULL) {
+				task->cancel(task->data);
+			}
+			mem_slab_free(task, sizeof(task_object));
+		}
+	}
+	num_pending = 0u;
+	inited = false;
+}
+
+bool tasks_submit(const tasks_priority priority, const tasks_func func, const tasks_cancel_func cancel, void* const data) {
+	assert(inited);
+	assert(priority >= 0 && priority < TASKS_PRIORITY_NUM);
+	assert(func != NULL);
+
+	task_object* const task = mem_slab_alloc(sizeof(task_object));
+	if (task == NULL) {
+		log_printf("Error allocating task\n");
+		return false;
+	}
+	task->func = func;
+	task->cancel = cancel;
+	task->data = data;
+	list_push(&lists[priority], task);
+	num_pending++;
+	return true;
+}
+
+uint64_t tasks_time_left() {
+	if (!running) {
+		return 0u;
+	}
+
+	const uint64_t elapsed = nanotime_interval(run_start, nanotime_now(), nanotime_now_max());
+	return elapsed < run_allotted_time ? run_allotted_time - elapsed : 0u;
+}
+
+uint64_t tasks_pending_get() {
+	return num_pending;
+}
+
+bool tasks_run(const uint64_t allotted_time) {
+	assert(inited);
+	assert(!running);
+
+	if (num_pending == 0u || allotted_time == 0u) {
+		return true;
+	}
+
+	running = true;
+	run_start = nanotime_now();
+	run_allotted_time = allotted_time;
+	for (size_t i = 0u; i < TASKS_PRIORITY_NUM; i++) {
+		// Each task gets one turn per run, so a task that's waiting on
+		// something else doesn't spin out the rest of the tick; tasks
+		// submitted during the run, after the last, get their first turn
+		// in the next run.
+		task_list_type* const list = &lists[i];
+		task_object* const last = list->tail;
+		while (list->head != NULL) {
+			if (tasks_time_left() == 0u) {
+				running = false;
+				return true;
+			}
+
+			task_object* const task = list_pop(list);
+			const bool turns_done = task == last;
+			const tasks_status status = task->func(task->data);
+			switch (status) {
+			case TASKS_STATUS_DONE:
+				mem_slab_free(task, sizeof(task_object));
+				num_pending--;
+				break;
+
+			case TASKS_STATUS_CONTINUE:
+				list_push(list, task);
+				break;
+
+			default:
+				log_printf("Error running task\n");
+				mem_slab_free(task, sizeof(task_object));
+				num_pending--;
+				running = false;
+				return false;
+			}
+
+			if (turns_done) {
+				break;
+			}
+		}
+	}
+	running = false;
+	return true;
+}
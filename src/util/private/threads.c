@@ -0,0 +1,450 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// pthread_setaffinity_np and cpu_set_t are GNU extensions.
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
+#include "util/private/threads.h"
+#include "util/log.h"
+#include "SDL.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#include <pthread/qos.h>
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
+
+#define MAX_CORES 64u
+
+/*
+ * Only changed in the main thread before the threads of each class are
+ * started, so reading them is safe in the threads.
+ */
+static threads_config configs[THREADS_CLASS_NUM] = {
+	[THREADS_CLASS_APP] = {
+		.cores = 0u,
+#ifdef REALTIME
+		.priority = THREADS_PRIORITY_REALTIME
+#else
+		.priority = THREADS_PRIORITY_NORMAL
+#endif
+	},
+	[THREADS_CLASS_RENDER] = {
+		.cores = 0u,
+#ifdef REALTIME
+		.priority = THREADS_PRIORITY_REALTIME
+#else
+		.priority = THREADS_PRIORITY_NORMAL
+#endif
+	},
+	[THREADS_CLASS_AUDIO] = { .cores = 0u, .priority = THREADS_PRIORITY_NORMAL },
+	[THREADS_CLASS_INPUT] = { .cores = 0u, .priority = THREADS_PRIORITY_NORMAL },
+	[THREADS_CLASS_WORKER] = { .cores = 0u, .priority = THREADS_PRIORITY_NORMAL },
+	[THREADS_CLASS_BACKGROUND] = { .cores = 0u, .priority = THREADS_PRIORITY_LOW }
+};
+
+static const char* const class_names[THREADS_CLASS_NUM] = {
+	[THREADS_CLASS_APP] = "app",
+	[THREADS_CLASS_RENDER] = "render",
+	[THREADS_CLASS_AUDIO] = "audio",
+	[THREADS_CLASS_INPUT] = "input",
+	[THREADS_CLASS_WORKER] = "worker",
+	[THREADS_CLASS_BACKGROUND] = "background"
+};
+
+static const char* const priority_names[THREADS_PRIORITY_NUM] = {
+	[THREADS_PRIORITY_LOW] = "low",
+	[THREADS_PRIORITY_NORMAL] = "normal",
+	[THREADS_PRIORITY_HIGH] = "high",
+	[THREADS_PRIORITY_REALTIME] = "realtime"
+};
+
+const char* threads_class_name_get(const threads_class class) {
+	assert(class >= 0 && class < THREADS_CLASS_NUM);
+
+	return class_names[class];
+}
+
+const char* threads_priority_name_get(const threads_priority priority) {
+	assert(priority >= 0 && priority < THREADS_PRIORITY_NUM);
+
+	return priority_names[priority];
+}
+
+static bool core_parse(const char** const text, const char* const end, unsigned* const core) {
+	if (*text == end || **text < '0' || **text > '9') {
+		return false;
+	}
+	unsigned value = 0u;
+	while (*text != end && **text >= '0' && **text <= '9') {
+		value = value * 10u + (unsigned)(**text - '0');
+		if (value >= MAX_CORES) {
+			return false;
+		}
+		(*text)++;
+	}
+	*core = value;
+	return true;
+}
+
+bool threads_cores_parse(const char* const text, const size_t length, uint64_t* const cores) {
+	assert(text != NULL);
+	assert(cores != NULL);
+
+	const char* const end = text + length;
+	const char* current = text;
+	uint64_t parsed = 0u;
+	while (current != end) {
+		while (current != end && (*current == ' ' || *current == '\t')) {
+			current++;
+		}
+		unsigned first;
+		if (!core_parse(&current, end, &first)) {
+			return false;
+		}
+		unsigned last = first;
+		if (current != end && *current == '-') {
+			current++;
+			if (!core_parse(&current, end, &last) || last < first) {
+				return false;
+			}
+		}
+		for (unsigned core = first; core <= last; core++) {
+			parsed |= UINT64_C(1) << core;
+		}
+		while (current != end && (*current == ' ' || *current == '\t')) {
+			current++;
+		}
+		if (current != end) {
+			if (*current != ',') {
+				return false;
+			}
+			current++;
+		}
+	}
+
+	*cores = parsed;
+	return true;
+}
+
+void threads_config_set(const threads_class class, const threads_config* const config) {
+	assert(class >= 0 && class < THREADS_CLASS_NUM);
+	assert(config != NULL);
+	assert(config->priority >= 0 && config->priority < THREADS_PRIORITY_NUM);
+
+	configs[class] = *config;
+}
+
+void threads_config_get(const threads_class class, threads_config* const config) {
+	assert(class >= 0 && class < THREADS_CLASS_NUM);
+	assert(config != NULL);
+
+	*config = configs[class];
+}
+
+/*
+ * The platform's implementation of each setting, returning false if the
+ * setting couldn't be applied, describing what was applied in the description.
+ */
+#if defined(_WIN32)
+
+typedef HANDLE (WINAPI* mmcss_set_func)(LPCWSTR task_name, LPDWORD task_index);
+typedef BOOL (WINAPI* mmcss_revert_func)(HANDLE handle);
+
+static SDL_SpinLock mmcss_lock = 0;
+static bool mmcss_loaded = false;
+static mmcss_set_func mmcss_set = NULL;
+static mmcss_revert_func mmcss_revert = NULL;
+static THREAD_LOCAL HANDLE mmcss_handle = NULL;
+
+static bool affinity_set(const uint64_t cores, char* const description, const size_t size) {
+	DWORD_PTR process_mask;
+	DWORD_PTR system_mask;
+	if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+		snprintf(description, size, "unknown cores");
+		return false;
+	}
+	const DWORD_PTR mask = cores != 0u ? (DWORD_PTR)cores & process_mask : process_mask;
+	if (mask == 0u || SetThreadAffinityMask(GetCurrentThread(), mask) == 0u) {
+		snprintf(description, size, "all cores, setting cores 0x%llx failed", (unsigned long long)cores);
+		return false;
+	}
+	snprintf(description, size, "cores 0x%llx", (unsigned long long)mask);
+	return true;
+}
+
+/*
+ * MMCSS is loaded at runtime, so the program still runs where avrt.dll is
+ * missing.
+ */
+static bool mmcss_load() {
+	SDL_AtomicLock(&mmcss_lock);
+	if (!mmcss_loaded) {
+		void* const avrt = SDL_LoadObject("avrt.dll");
+		if (avrt != NULL) {
+			mmcss_set = (mmcss_set_func)SDL_LoadFunction(avrt, "AvSetMmThreadCharacteristicsW");
+			mmcss_revert = (mmcss_revert_func)SDL_LoadFunction(avrt, "AvRevertMmThreadCharacteristics");
+		}
+		mmcss_loaded = true;
+	}
+	SDL_AtomicUnlock(&mmcss_lock);
+	return mmcss_set != NULL && mmcss_revert != NULL;
+}
+
+static void mmcss_unset() {
+	if (mmcss_handle != NULL) {
+		mmcss_revert(mmcss_handle);
+		mmcss_handle = NULL;
+	}
+}
+
+static void power_throttling_set(const bool throttled) {
+#if defined(THREAD_POWER_THROTTLING_CURRENT_VERSION)
+	THREAD_POWER_THROTTLING_STATE state = {
+		.Version = THREAD_POWER_THROTTLING_CURRENT_VERSION,
+		.ControlMask = THREAD_POWER_THROTTLING_EXECUTION_SPEED,
+		.StateMask = throttled ? THREAD_POWER_THROTTLING_EXECUTION_SPEED : 0u
+	};
+	SetThreadInformation(GetCurrentThread(), ThreadPowerThrottling, &state, sizeof(state));
+#else
+	(void)throttled;
+#endif
+}
+
+static bool priority_set(const threads_class class, const threads_priority priority, char* const description, const size_t size) {
+	mmcss_unset();
+	power_throttling_set(priority == THREADS_PRIORITY_LOW);
+
+	if (priority == THREADS_PRIORITY_REALTIME) {
+		const wchar_t* const task = class == THREADS_CLASS_AUDIO ? L"Pro Audio" : L"Games";
+		DWORD task_index = 0u;
+		const bool mmcss = mmcss_load() && (mmcss_handle = mmcss_set(task, &task_index)) != NULL;
+		SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "1");
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_TIME_CRITICAL) == 0;
+		snprintf(description, size, "%s%s", set ? "time critical" : "normal", mmcss ? (class == THREADS_CLASS_AUDIO ? ", MMCSS \"Pro Audio\"" : ", MMCSS \"Games\"") : ", without MMCSS");
+		return set && mmcss;
+	}
+	else if (priority == THREADS_PRIORITY_HIGH) {
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) == 0;
+		snprintf(description, size, "%s", set ? "high" : "normal");
+		return set;
+	}
+	else if (priority == THREADS_PRIORITY_LOW) {
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW) == 0;
+		snprintf(description, size, "%s, power throttled", set ? "low" : "normal");
+		return set;
+	}
+	else {
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_NORMAL) == 0;
+		snprintf(description, size, "normal");
+		return set;
+	}
+}
+
+#elif defined(__linux__)
+
+static bool affinity_set(const uint64_t cores, char* const description, const size_t size) {
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (cores == 0u) {
+		const int num_cores = SDL_GetCPUCount();
+		for (int core = 0; core < num_cores && core < CPU_SETSIZE; core++) {
+			CPU_SET(core, &set);
+		}
+	}
+	else {
+		for (unsigned core = 0u; core < MAX_CORES; core++) {
+			if (cores & (UINT64_C(1) << core)) {
+				CPU_SET(core, &set);
+			}
+		}
+	}
+
+	const int error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (error != 0) {
+		snprintf(description, size, "all cores, setting cores 0x%llx failed: %s", (unsigned long long)cores, strerror(error));
+		return false;
+	}
+	snprintf(description, size, cores != 0u ? "cores 0x%llx" : "all cores", (unsigned long long)cores);
+	return true;
+}
+
+static bool policy_set(const int policy, const int priority) {
+	const struct sched_param param = { .sched_priority = priority };
+	return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
+static bool priority_set(const threads_class class, const threads_priority priority, char* const description, const size_t size) {
+	if (priority == THREADS_PRIORITY_REALTIME) {
+		// Just above the bottom of the realtime range, above everything
+		// not realtime, leaving room above for the system's threads. Audio
+		// is a step above the rest, as its deadlines are the strictest.
+		const int fifo_priority = sched_get_priority_min(SCHED_FIFO) + (class == THREADS_CLASS_AUDIO ? 2 : 1);
+		if (policy_set(SCHED_FIFO, fifo_priority)) {
+			snprintf(description, size, "SCHED_FIFO %d", fifo_priority);
+			return true;
+		}
+		// Usually not permitted without CAP_SYS_NICE or an RLIMIT_RTPRIO, so
+		// fall back to high priority.
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) == 0;
+		snprintf(description, size, "%s, SCHED_FIFO not permitted", set ? "high" : "normal");
+		return false;
+	}
+	else if (priority == THREADS_PRIORITY_HIGH) {
+		policy_set(SCHED_OTHER, 0);
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_HIGH) == 0;
+		snprintf(description, size, "%s", set ? "high" : "normal");
+		return set;
+	}
+	else if (priority == THREADS_PRIORITY_LOW) {
+		const bool batch = policy_set(SCHED_BATCH, 0);
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW) == 0;
+		snprintf(description, size, "%s%s", set ? "low" : "normal", batch ? ", SCHED_BATCH" : "");
+		return set && batch;
+	}
+	else {
+		const bool other = policy_set(SCHED_OTHER, 0);
+		const bool set = SDL_SetThreadPriority(SDL_THREAD_PRIORITY_NORMAL) == 0;
+		snprintf(description, size, "normal");
+		return other && set;
+	}
+}
+
+#elif defined(__APPLE__)
+
+static bool affinity_set(const uint64_t cores, char* const description, const size_t size) {
+	if (cores != 0u) {
+		snprintf(description, size, "all cores, core affinity unsupported");
+		return false;
+	}
+	snprintf(description, size, "all cores");
+	return true;
+}
+
+static bool priority_set(const threads_class class, const threads_priority priority, char* const description, const size_t size) {
+	(void)class;
+
+	qos_class_t qos;
+	const char* qos_name;
+	switch (priority) {
+	case THREADS_PRIORITY_REALTIME:
+	case THREADS_PRIORITY_HIGH:
+		qos = QOS_CLASS_USER_INTERACTIVE;
+		qos_name = "user interactive";
+		break;
+
+	case THREADS_PRIORITY_LOW:
+		qos = QOS_CLASS_UTILITY;
+		qos_name = "utility";
+		break;
+
+	default:
+		qos = QOS_CLASS_DEFAULT;
+		qos_name = "default";
+		break;
+	}
+	if (pthread_set_qos_class_self_np(qos, 0) != 0) {
+		snprintf(description, size, "setting QoS class %s failed", qos_name);
+		return false;
+	}
+	snprintf(description, size, "QoS class %s", qos_name);
+	return true;
+}
+
+#else
+
+static bool affinity_set(const uint64_t cores, char* const description, const size_t size) {
+	if (cores != 0u) {
+		snprintf(description, size, "all cores, core affinity unsupported");
+		return false;
+	}
+	snprintf(description, size, "all cores");
+	return true;
+}
+
+static bool priority_set(const threads_class class, const threads_priority priority, char* const description, const size_t size) {
+	(void)class;
+
+	static const SDL_ThreadPriority sdl_priorities[THREADS_PRIORITY_NUM] = {
+		[THREADS_PRIORITY_LOW] = SDL_THREAD_PRIORITY_LOW,
+		[THREADS_PRIORITY_NORMAL] = SDL_THREAD_PRIORITY_NORMAL,
+		[THREADS_PRIORITY_HIGH] = SDL_THREAD_PRIORITY_HIGH,
+		[THREADS_PRIORITY_REALTIME] = SDL_THREAD_PRIORITY_TIME_CRITICAL
+	};
+	if (priority == THREADS_PRIORITY_REALTIME) {
+		SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "1");
+	}
+	const bool set = SDL_SetThreadPriority(sdl_priorities[priority]) == 0;
+	snprintf(description, size, "%s", set ? priority_names[priority] : "normal");
+	return set;
+}
+
+#endif
+
+bool threads_current_set(const threads_class class) {
+	assert(class >= 0 && class < THREADS_CLASS_NUM);
+
+	const threads_config* const config = &configs[class];
+	char affinity_description[128];
+	char priority_description[128];
+	const bool affinity_applied = affinity_set(config->cores, affinity_description, sizeof(affinity_description));
+	const bool priority_applied = priority_set(class, config->priority, priority_description, sizeof(priority_description));
+	log_printf("Scheduling thread as %s class, %s priority: %s, %s\n",
+		class_names[class],
+		priority_names[config->priority],
+		priority_description,
+		affinity_description
+	);
+	return affinity_applied && priority_applied;
+}
+
+void threads_current_reset() {
+	char description[128];
+	affinity_set(0u, description, sizeof(description));
+	priority_set(THREADS_CLASS_APP, THREADS_PRIORITY_NORMAL, description, sizeof(description));
+#if defined(_WIN32) || !(defined(__linux__) || defined(__APPLE__))
+	SDL_SetHint(SDL_HINT_THREAD_FORCE_REALTIME_TIME_CRITICAL, "0");
+#endif
+}
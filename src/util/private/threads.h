@@ -0,0 +1,122 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Scheduling of the program's threads. Each thread of the program has a class,
+ * configured with the cores it may run on and its priority, applied by the
+ * thread itself once it starts. Pinning the threads with steady timing, such as
+ * the app and render threads, to their own cores keeps the OS from migrating
+ * them between cores, and keeps the other threads off of their cores.
+ *
+ * The priorities are mapped to what each platform provides:
+ * - Windows: MMCSS "Games" (or "Pro Audio" for audio) for realtime, along with
+ *   time critical priority; power throttling (EcoQoS) for low priority.
+ * - Linux: SCHED_FIFO for realtime, where permitted, otherwise high priority;
+ *   SCHED_BATCH for low priority.
+ * - macOS: the user interactive QoS class for realtime and high priority, and
+ *   the utility QoS class for low priority. Core affinity isn't supported.
+ * Elsewhere, SDL's thread priorities are used, without core affinity.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum threads_class {
+	THREADS_CLASS_APP,
+	THREADS_CLASS_RENDER,
+	THREADS_CLASS_AUDIO,
+	THREADS_CLASS_INPUT,
+
+	/*
+	 * The job system's workers.
+	 */
+	THREADS_CLASS_WORKER,
+
+	/*
+	 * Threads doing I/O and other work that isn't time sensitive, such as
+	 * the loaders and writers.
+	 */
+	THREADS_CLASS_BACKGROUND,
+
+	THREADS_CLASS_NUM
+} threads_class;
+
+typedef enum threads_priority {
+	THREADS_PRIORITY_LOW,
+	THREADS_PRIORITY_NORMAL,
+	THREADS_PRIORITY_HIGH,
+	THREADS_PRIORITY_REALTIME,
+	THREADS_PRIORITY_NUM
+} threads_priority;
+
+typedef struct threads_config {
+	/*
+	 * Bit N set allows running on core N; zero allows all cores.
+	 */
+	uint64_t cores;
+
+	threads_priority priority;
+} threads_config;
+
+/*
+ * The section names of the thread scheduling config file, in the save path,
+ * then the resource path, each of the lowercase class names with keys of
+ * "cores", a list of cores and core ranges such as "0,2-3", and "priority",
+ * one of the lowercase priority names.
+ */
+#define THREADS_CONFIG_FILENAME "threads.ini"
+
+const char* threads_class_name_get(const threads_class class);
+
+const char* threads_priority_name_get(const threads_priority priority);
+
+/*
+ * Parse a list of cores, of length bytes, into a core mask. Returns false if
+ * the list is invalid.
+ */
+bool threads_cores_parse(const char* const text, const size_t length, uint64_t* const cores);
+
+/*
+ * Set the config of the class, only in the main thread, before the threads of
+ * the class are started. The defaults are normal priority on all cores, other
+ * than low priority for background threads, and when REALTIME is defined,
+ * realtime priority for the app and render threads.
+ */
+void threads_config_set(const threads_class class, const threads_config* const config);
+
+void threads_config_get(const threads_class class, threads_config* const config);
+
+/*
+ * Apply the config of the class to the calling thread, logging the effective
+ * settings. Returns false if any of the config couldn't be applied, in which
+ * case the thread keeps running with what could be applied.
+ */
+bool threads_current_set(const threads_class class);
+
+/*
+ * Return the calling thread to normal priority on all cores.
+ */
+void threads_current_reset();
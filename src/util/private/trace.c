@@ -0,0 +1,437 @@
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "util/private/trace_private.h"
+
+#ifdef TRACE
+
+#include "main/private/prog_private.h"
+#include "util/log.h"
+#include "util/mem.h"
+#include "util/str.h"
+#include "util/nanotime.h"
+#include "SDL_atomic.h"
+#include "SDL_thread.h"
+#include "SDL_rwops.h"
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#ifdef TRACE_TRACY
+#include "tracy/TracyC.h"
+#endif
+
+#define CHUNK_EVENTS 4096u
+
+/*
+ * Each thread records at most this many chunks of events; events beyond that
+ * are dropped.
+ */
+#define MAX_CHUNKS 256u
+
+#define MAX_TRACY_DEPTH 64u
+
+#define EXPORT_BUFFER_SIZE ((size_t)1u << 16)
+
+typedef enum trace_event_type {
+	TRACE_EVENT_BEGIN,
+	TRACE_EVENT_END,
+	TRACE_EVENT_COUNTER,
+	TRACE_EVENT_FRAME
+} trace_event_type;
+
+typedef struct trace_event {
+	uint64_t time;
+	const char* name;
+	double value;
+	trace_event_type type;
+} trace_event;
+
+/*
+ * Only the owning thread appends events; count is published after the events
+ * are written, so exporting can read a chunk while events are appended.
+ */
+typedef struct trace_chunk trace_chunk;
+struct trace_chunk {
+	trace_chunk* next;
+	SDL_atomic_t count;
+	trace_event events[CHUNK_EVENTS];
+};
+
+typedef struct trace_thread trace_thread;
+struct trace_thread {
+	trace_thread* next;
+	int id;
+	char* name;
+	trace_chunk* first;
+	trace_chunk* last;
+	size_t num_chunks;
+
+	#ifdef TRACE_TRACY
+	TracyCZoneCtx zones[MAX_TRACY_DEPTH];
+	size_t depth;
+	#endif
+};
+
+static SDL_TLSID thread_tls = 0;
+static uint64_t start_time = 0u;
+
+/*
+ * Threads' records are kept until trace_deinit, even after the threads
+ * exit, so they can still be exported.
+ */
+static SDL_SpinLock threads_lock;
+static trace_thread* threads = NULL;
+static int next_thread_id = 1;
+
+bool trace_init() {
+	assert(thread_tls == 0);
+
+	thread_tls = SDL_TLSCreate();
+	if (thread_tls == 0) {
+		log_printf("Error creating the trace thread local storage: %s\n", SDL_GetError());
+		return false;
+	}
+	start_time = nanotime_now();
+
+	return true;
+}
+
+void trace_deinit() {
+	SDL_TLSSet(thread_tls, NULL, NULL);
+
+	while (threads != NULL) {
+		trace_thread* const next = threads->next;
+		for (trace_chunk* chunk = threads->first; chunk != NULL; ) {
+			trace_chunk* const next_chunk = chunk->next;
+			mem_free(chunk);
+			chunk = next_chunk;
+		}
+		if (threads->name != NULL) {
+			mem_free(threads->name);
+		}
+		mem_free(threads);
+		threads = next;
+	}
+}
+
+static trace_chunk* chunk_create() {
+	trace_chunk* const chunk = mem_malloc(sizeof(trace_chunk));
+	if (chunk == NULL) {
+		return NULL;
+	}
+	chunk->next = NULL;
+	SDL_AtomicSet(&chunk->count, 0);
+	return chunk;
+}
+
+static trace_thread* thread_get() {
+	assert(thread_tls != 0);
+
+	trace_thread* thread = SDL_TLSGet(thread_tls);
+	if (thread != NULL) {
+		return thread;
+	}
+
+	thread = mem_calloc(1u, sizeof(trace_thread));
+	if (thread == NULL) {
+		return NULL;
+	}
+	thread->first = chunk_create();
+	if (thread->first == NULL) {
+		mem_free(thread);
+		return NULL;
+	}
+	thread->last = thread->first;
+	thread->num_chunks = 1u;
+
+	const char* const name = prog_this_thread_name_get();
+	if (name != NULL) {
+		thread->name = alloc_sprintf("%s", name);
+	}
+	if (SDL_TLSSet(thread_tls, thread, NULL) < 0) {
+		if (thread->name != NULL) {
+			mem_free(thread->name);
+		}
+		mem_free(thread->first);
+		mem_free(thread);
+		return NULL;
+	}
+
+	#ifdef TRACE_TRACY
+	if (thread->name != NULL) {
+		___tracy_set_thread_name(thread->name);
+	}
+	#endif
+
+	SDL_AtomicLock(&threads_lock);
+	thread->id = next_thread_id++;
+	thread->next = threads;
+	SDL_MemoryBarrierRelease();
+	threads = thread;
+	SDL_AtomicUnlock(&threads_lock);
+
+	return thread;
+}
+
+static void event_add(trace_thread* const thread, const trace_event_type type, const char* const name, const double value) {
+	trace_chunk* chunk = thread->last;
+	int count = SDL_AtomicGet(&chunk->count);
+	if ((size_t)count == CHUNK_EVENTS) {
+		if (thread->num_chunks == MAX_CHUNKS) {
+			return;
+		}
+		trace_chunk* const next = chunk_create();
+		if (next == NULL) {
+			return;
+		}
+		SDL_MemoryBarrierRelease();
+		SDL_AtomicSetPtr((void**)&chunk->next, next);
+		thread->last = next;
+		thread->num_chunks++;
+		chunk = next;
+		count = 0;
+	}
+
+	trace_event* const event = &chunk->events[count];
+	event->time = nanotime_now();
+	event->name = name;
+	event->value = value;
+	event->type = type;
+	SDL_MemoryBarrierRelease();
+	SDL_AtomicSet(&chunk->count, count + 1);
+}
+
+void trace_begin(const char* const name) {
+	assert(name != NULL);
+
+	trace_thread* const thread = thread_get();
+	if (thread == NULL) {
+		return;
+	}
+	event_add(thread, TRACE_EVENT_BEGIN, name, 0.0);
+
+	#ifdef TRACE_TRACY
+	if (thread->depth < MAX_TRACY_DEPTH) {
+		const uint64_t location = ___tracy_alloc_srcloc_name(0u, "", 0u, "", 0u, name, strlen(name), 0u);
+		thread->zones[thread->depth] = ___tracy_emit_zone_begin_alloc(location, 1);
+	}
+	thread->depth++;
+	#endif
+}
+
+void trace_end() {
+	trace_thread* const thread = thread_get();
+	if (thread == NULL) {
+		return;
+	}
+	event_add(thread, TRACE_EVENT_END, NULL, 0.0);
+
+	#ifdef TRACE_TRACY
+	assert(thread->depth > 0u);
+	thread->depth--;
+	if (thread->depth < MAX_TRACY_DEPTH) {
+		___tracy_emit_zone_end(thread->zones[thread->depth]);
+	}
+	#endif
+}
+
+void trace_counter(const char* const name, const double value) {
+	assert(name != NULL);
+
+	trace_thread* const thread = thread_get();
+	if (thread == NULL) {
+		return;
+	}
+	event_add(thread, TRACE_EVENT_COUNTER, name, value);
+
+	#ifdef TRACE_TRACY
+	___tracy_emit_plot(name, value);
+	#endif
+}
+
+void trace_frame(const char* const name) {
+	assert(name != NULL);
+
+	trace_thread* const thread = thread_get();
+	if (thread == NULL) {
+		return;
+	}
+	event_add(thread, TRACE_EVENT_FRAME, name, 0.0);
+
+	#ifdef TRACE_TRACY
+	___tracy_emit_frame_mark(name);
+	#endif
+}
+
+typedef struct export_type {
+	SDL_RWops* file;
+	char* buffer;
+	size_t length;
+	bool failed;
+	bool first;
+} export_type;
+
+static void export_flush(export_type* const export) {
+	if (export->length > 0u && SDL_RWwrite(export->file, export->buffer, export->length, 1u) != 1u) {
+		export->failed = true;
+	}
+	export->length = 0u;
+}
+
+static void export_text(export_type* const export, const char* const text, const size_t length) {
+	if (export->length + length > EXPORT_BUFFER_SIZE) {
+		export_flush(export);
+	}
+	if (length > EXPORT_BUFFER_SIZE) {
+		if (SDL_RWwrite(export->file, text, length, 1u) != 1u) {
+			export->failed = true;
+		}
+		return;
+	}
+	memcpy(export->buffer + export->length, text, length);
+	export->length += length;
+}
+
+/*
+ * Output the name as a JSON string, escaping as needed.
+ */
+static void export_string(export_type* const export, const char* const string) {
+	export_text(export, "\"", 1u);
+	for (const char* cur = string; *cur != '\0'; cur++) {
+		if (*cur == '"' || *cur == '\\') {
+			const char escaped[2] = { '\\', *cur };
+			export_text(export, escaped, sizeof(escaped));
+		}
+		else if ((unsigned char)*cur < 0x20u) {
+			char escaped[8];
+			const int length = snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned)*cur);
+			export_text(export, escaped, (size_t)length);
+		}
+		else {
+			export_text(export, cur, 1u);
+		}
+	}
+	export_text(export, "\"", 1u);
+}
+
+static void export_event(export_type* const export, const trace_thread* const thread, const trace_event* const event) {
+	static const char* const phases[] = {
+		[TRACE_EVENT_BEGIN] = "B",
+		[TRACE_EVENT_END] = "E",
+		[TRACE_EVENT_COUNTER] = "C",
+		[TRACE_EVENT_FRAME] = "i"
+	};
+
+	char text[128];
+	const double timestamp = (double)nanotime_interval(start_time, event->time, nanotime_now_max()) / 1000.0;
+	int length = snprintf(text, sizeof(text), "%s{\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", export->first ? "" : ",\n", phases[event->type], timestamp, thread->id);
+	export->first = false;
+	export_text(export, text, (size_t)length);
+
+	if (event->name != NULL) {
+		export_text(export, ",\"name\":", 8u);
+		export_string(export, event->name);
+	}
+	if (event->type == TRACE_EVENT_COUNTER) {
+		length = snprintf(text, sizeof(text), ",\"args\":{\"value\":%.17g}", event->value);
+		export_text(export, text, (size_t)length);
+	}
+	else if (event->type == TRACE_EVENT_FRAME) {
+		export_text(export, ",\"s\":\"g\"", 8u);
+	}
+	export_text(export, "}", 1u);
+}
+
+bool trace_export(const char* const filename) {
+	assert(filename != NULL);
+
+	char* const full_filename = alloc_sprintf("%s%s", prog_save_path_get(), filename);
+	if (full_filename == NULL) {
+		return false;
+	}
+	export_type export = {
+		.file = SDL_RWFromFile(full_filename, "wb"),
+		.buffer = mem_malloc(EXPORT_BUFFER_SIZE),
+		.length = 0u,
+		.failed = false,
+		.first = true
+	};
+	mem_free(full_filename);
+	if (export.file == NULL || export.buffer == NULL) {
+		log_printf("Error opening the trace export file \"%s\"\n", filename);
+		if (export.file != NULL) {
+			SDL_RWclose(export.file);
+		}
+		if (export.buffer != NULL) {
+			mem_free(export.buffer);
+		}
+		return false;
+	}
+
+	export_text(&export, "{\"traceEvents\":[\n", 17u);
+
+	SDL_AtomicLock(&threads_lock);
+	trace_thread* const first_thread = threads;
+	SDL_AtomicUnlock(&threads_lock);
+
+	for (const trace_thread* thread = first_thread; thread != NULL; thread = thread->next) {
+		char text[64];
+		const int length = snprintf(text, sizeof(text), "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":", export.first ? "" : ",\n", thread->id);
+		export.first = false;
+		export_text(&export, text, (size_t)length);
+		if (thread->name != NULL) {
+			export_string(&export, thread->name);
+		}
+		else {
+			snprintf(text, sizeof(text), "thread %d", thread->id);
+			export_string(&export, text);
+		}
+		export_text(&export, "}}", 2u);
+
+		for (const trace_chunk* chunk = thread->first; chunk != NULL; chunk = SDL_AtomicGetPtr((void**)&chunk->next)) {
+			SDL_MemoryBarrierAcquire();
+			const int count = SDL_AtomicGet((SDL_atomic_t*)&chunk->count);
+			SDL_MemoryBarrierAcquire();
+			for (int i = 0; i < count; i++) {
+				export_event(&export, thread, &chunk->events[i]);
+			}
+		}
+	}
+
+	export_text(&export, "\n]}\n", 4u);
+	export_flush(&export);
+	mem_free(export.buffer);
+	if (SDL_RWclose(export.file) != 0) {
+		export.failed = true;
+	}
+
+	if (export.failed) {
+		log_printf("Error writing the trace export file \"%s\"\n", filename);
+		return false;
+	}
+	return true;
+}
+
+#endif
@@ -40,6 +40,17 @@ char* alloc_sprintf(const char* const fmt, ...);
  */
 char* alloc_vsprintf(const char* const fmt, va_list args);
 
+/*
+ * Same as vsnprintf, but faster for the conversions most used in per-frame
+ * text: %d, %i, %u, %x, %X, %f, %s, %c and %%, with the - and 0 flags, field
+ * widths, the l, ll and z length modifiers, and precisions for %f and %s. The
+ * PRId64/PRIu64 macros are covered where they expand to the l or ll lengths,
+ * but not MSVC's I64. Formats using anything else are passed to vsnprintf, as
+ * are %f values this can't round exactly the same as vsnprintf, and NULL %s
+ * strings, so they're printed however vsnprintf prints them.
+ */
+int str_vsnprintf(char* const buffer, const size_t size, const char* const format, va_list args);
+
 #ifdef _MSC_VER
 /*
  * Compare strings case insensitively. The return value is of the same
@@ -79,3 +90,19 @@ uint32_t utf8_get(const char* const str, size_t* const bytes);
  * the NUL terminator byte, such as in memory management code.
  */
 size_t utf8_strlen(const char* const str);
+
+/*
+ * Decode size bytes of UTF-8 encoded text into codepoints, which must have
+ * room for size codepoints, validating the text as it's decoded; overlong
+ * encodings, surrogates, codepoints past U+10FFFF, and truncated sequences
+ * are invalid. Runs of ASCII are decoded many bytes at a time with SIMD, where
+ * available. Returns the number of codepoints decoded, or SIZE_MAX if the text
+ * is invalid.
+ */
+size_t utf8_decode(const char* const str, const size_t size, uint32_t* const codepoints);
+
+/*
+ * Returns true if the size bytes of text are valid UTF-8, by the same rules as
+ * utf8_decode.
+ */
+bool utf8_valid(const char* const str, const size_t size);
@@ -0,0 +1,89 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Cooperative scheduler of resumable tasks, run in the main thread in the time
+ * left over in each app tick, once the tick's work is done, so background work
+ * such as finalizing loaded data, uploads, saves and cache eviction is spread
+ * over ticks without ever causing a missed tick. Tasks are functions called
+ * repeatedly until they report they're done, each call doing a slice of the
+ * task's work then returning, keeping their progress in their data between
+ * calls. Tasks should check tasks_time_left as they go, returning once it's
+ * zero.
+ *
+ * Higher priority tasks are always run before lower priority tasks, and tasks
+ * of the same priority take turns, in the order they were submitted. Only use
+ * the scheduler in the main thread.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum tasks_priority {
+	TASKS_PRIORITY_HIGH,
+	TASKS_PRIORITY_NORMAL,
+	TASKS_PRIORITY_LOW,
+	TASKS_PRIORITY_NUM
+} tasks_priority;
+
+typedef enum tasks_status {
+	/*
+	 * The task is done, and won't be called again.
+	 */
+	TASKS_STATUS_DONE,
+
+	/*
+	 * The task has more to do, and will be called again, after the other
+	 * tasks of its priority have had their turns.
+	 */
+	TASKS_STATUS_CONTINUE,
+
+	/*
+	 * The task failed, which is fatal, quitting the program.
+	 */
+	TASKS_STATUS_ERROR
+} tasks_status;
+
+typedef tasks_status (* tasks_func)(void* const data);
+typedef void (* tasks_cancel_func)(void* const data);
+
+/*
+ * Submit a task, first run in the current tick, if there's time left for it.
+ * The cancel function, which may be NULL, is called with the task's data if the
+ * task is still unfinished when the scheduler is deinitialized, so the data can
+ * be freed. Returns false upon failure.
+ */
+bool tasks_submit(const tasks_priority priority, const tasks_func func, const tasks_cancel_func cancel, void* const data);
+
+/*
+ * Returns the time, in nanoseconds, left for running tasks in the current
+ * tick; zero once the time is up, and when no tasks are being run.
+ */
+uint64_t tasks_time_left();
+
+/*
+ * Returns the number of unfinished tasks.
+ */
+uint64_t tasks_pending_get();
@@ -0,0 +1,82 @@
+#pragma once
+/*
+ * MIT License
+ * 
+ * Copyright (c) 2023 Brandon McGriff <nightmareci@gmail.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*
+ * Trace instrumentation, for seeing where time goes within app ticks and
+ * render frames. Zones, counters, and frame markers are recorded with
+ * nanotime_now timestamps into buffers owned by the recording thread, without
+ * locking, and can be exported as Chrome trace event JSON, viewable in
+ * chrome://tracing or Perfetto.
+ *
+ * All of this is only compiled in when TRACE is defined; otherwise, the
+ * functions are macros that compile to nothing, so instrumentation can be left
+ * in place. When TRACE_TRACY is defined too, everything is also streamed live
+ * to the Tracy profiler.
+ *
+ * Names must remain valid until the trace is exported, so should be string
+ * literals.
+ */
+
+#include <stdbool.h>
+
+#ifdef TRACE
+
+/*
+ * Begin a zone in the current thread. Zones nest, each ended by the next
+ * trace_end in the same thread.
+ */
+void trace_begin(const char* const name);
+
+/*
+ * End the current thread's innermost zone.
+ */
+void trace_end();
+
+/*
+ * Record the current value of a counter.
+ */
+void trace_counter(const char* const name, const double value);
+
+/*
+ * Mark the end of a frame, such as an app tick or a render frame.
+ */
+void trace_frame(const char* const name);
+
+/*
+ * Export everything recorded so far as Chrome trace event JSON, to the named
+ * file in the save path. Can be called from any thread, while other threads
+ * are still recording. Returns false if exporting failed.
+ */
+bool trace_export(const char* const filename);
+
+#else
+
+#define trace_begin(name) ((void)0)
+#define trace_end() ((void)0)
+#define trace_counter(name, value) ((void)0)
+#define trace_frame(name) ((void)0)
+#define trace_export(filename) (true)
+
+#endif